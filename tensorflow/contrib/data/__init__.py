@@ -51,6 +51,7 @@ See @{$guide/datasets$Importing Data} for an overview.
 @@parallel_interleave
 @@prefetch_to_device
 @@read_batch_features
+@@read_cache_shards
 @@rejection_resample
 @@reduce_dataset
 @@sample_from_datasets
@@ -58,6 +59,7 @@ See @{$guide/datasets$Importing Data} for an overview.
 @@shuffle_and_repeat
 @@sliding_window_batch
 @@sloppy_interleave
+@@spilling_shuffle
 @@unbatch
 @@unique
 """
@@ -74,6 +76,7 @@ from tensorflow.contrib.data.python.ops.batching import dense_to_sparse_batch
 from tensorflow.contrib.data.python.ops.batching import map_and_batch
 from tensorflow.contrib.data.python.ops.batching import padded_batch_and_drop_remainder
 from tensorflow.contrib.data.python.ops.batching import unbatch
+from tensorflow.contrib.data.python.ops.caching import read_cache_shards
 from tensorflow.contrib.data.python.ops.counter import Counter
 from tensorflow.contrib.data.python.ops.enumerate_ops import enumerate_dataset
 from tensorflow.contrib.data.python.ops.error_ops import ignore_errors
@@ -100,6 +103,7 @@ from tensorflow.contrib.data.python.ops.readers import SqlDataset
 from tensorflow.contrib.data.python.ops.resampling import rejection_resample
 from tensorflow.contrib.data.python.ops.scan_ops import scan
 from tensorflow.contrib.data.python.ops.shuffle_ops import shuffle_and_repeat
+from tensorflow.contrib.data.python.ops.shuffle_ops import spilling_shuffle
 from tensorflow.contrib.data.python.ops.sliding import sliding_window_batch
 from tensorflow.contrib.data.python.ops.unique import unique
 from tensorflow.contrib.data.python.ops.writers import TFRecordWriter
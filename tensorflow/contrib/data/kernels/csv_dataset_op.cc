@@ -22,6 +22,7 @@ limitations under the License.
 #include "tensorflow/core/lib/io/random_inputstream.h"
 #include "tensorflow/core/lib/io/zlib_compression_options.h"
 #include "tensorflow/core/lib/io/zlib_inputstream.h"
+#include "tensorflow/core/util/csv_scanner.h"
 
 namespace tensorflow {
 namespace {
@@ -148,6 +149,7 @@ class CSVDatasetOp : public DatasetOpKernel {
           select_cols_(std::move(select_cols)),
           use_quote_delim_(use_quote_delim),
           delim_(delim),
+          scanner_(delim, use_quote_delim),
           na_value_(std::move(na_value)),
           use_compression_(!compression_type.empty()),
           compression_type_(std::move(compression_type)),
@@ -487,7 +489,8 @@ class CSVDatasetOp : public DatasetOpKernel {
             }
 
           } else {
-            pos_++;
+            // Skip ahead to the next quote, or to the end of the buffer.
+            pos_ = dataset()->scanner_.FindQuote(buffer_, pos_ + 1);
           }
         }
       }
@@ -606,8 +609,9 @@ class CSVDatasetOp : public DatasetOpKernel {
             parse_result.Update(errors::InvalidArgument(
                 "Unquoted fields cannot have quotes inside"));
           }
-          // Otherwise, go to next character
-          pos_++;
+          // Otherwise, skip ahead to the next character that can end the
+          // field, or to the end of the buffer.
+          pos_ = dataset()->scanner_.FindFieldEnd(buffer_, pos_ + 1);
         }
       }
 
@@ -836,6 +840,8 @@ class CSVDatasetOp : public DatasetOpKernel {
     const std::vector<int64> select_cols_;
     const bool use_quote_delim_;
     const char delim_;
+    // Finds field boundaries with vector instructions where available.
+    const CsvScanner scanner_;
     const string na_value_;
     const bool use_compression_;
     const string compression_type_;
@@ -0,0 +1,600 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/partial_tensor_shape.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/io/record_reader.h"
+#include "tensorflow/core/lib/io/record_writer.h"
+#include "tensorflow/core/lib/random/philox_random.h"
+#include "tensorflow/core/lib/random/random.h"
+#include "tensorflow/core/lib/random/random_distributions.h"
+
+namespace tensorflow {
+namespace {
+
+// Spilled runs are compressed: elements that spill tend to be large and the
+// runs are read back while the next ones are written.
+constexpr char kRunCompressionType[] = "ZLIB";
+
+// Every run has an open reader, so the zlib buffers are kept small.
+constexpr int64 kRunBufferSize = 64 << 10;  // 64KB
+
+// Bounds the number of open runs: when there are more than `kMaxRuns` runs,
+// the `kNumRunsToMerge` smallest ones are merged into one.
+constexpr size_t kMaxRuns = 32;
+constexpr size_t kNumRunsToMerge = 16;
+
+// See documentation in ../ops/dataset_ops.cc for a high-level
+// description of the following op.
+
+class SpillingShuffleDatasetOp : public UnaryDatasetOpKernel {
+ public:
+  explicit SpillingShuffleDatasetOp(OpKernelConstruction* ctx)
+      : UnaryDatasetOpKernel(ctx) {}
+
+  void MakeDataset(OpKernelContext* ctx, DatasetBase* input,
+                   DatasetBase** output) override {
+    int64 buffer_size;
+    OP_REQUIRES_OK(
+        ctx, ParseScalarArgument<int64>(ctx, "buffer_size", &buffer_size));
+    OP_REQUIRES(
+        ctx, buffer_size > 0,
+        errors::InvalidArgument("buffer_size must be greater than zero."));
+
+    int64 memory_buffer_size;
+    OP_REQUIRES_OK(ctx, ParseScalarArgument<int64>(ctx, "memory_buffer_size",
+                                                   &memory_buffer_size));
+    OP_REQUIRES(ctx, memory_buffer_size > 0,
+                errors::InvalidArgument(
+                    "memory_buffer_size must be greater than zero."));
+
+    int64 seed;
+    OP_REQUIRES_OK(ctx, ParseScalarArgument<int64>(ctx, "seed", &seed));
+
+    int64 seed2;
+    OP_REQUIRES_OK(ctx, ParseScalarArgument<int64>(ctx, "seed2", &seed2));
+
+    string spill_directory;
+    OP_REQUIRES_OK(ctx, ParseScalarArgument<string>(ctx, "spill_directory",
+                                                    &spill_directory));
+    if (spill_directory.empty()) {
+      std::vector<string> temp_directories;
+      ctx->env()->GetLocalTempDirectories(&temp_directories);
+      OP_REQUIRES(ctx, !temp_directories.empty(),
+                  errors::FailedPrecondition(
+                      "No spill_directory was given and no local temporary "
+                      "directory was found."));
+      spill_directory = temp_directories[0];
+    }
+    OP_REQUIRES_OK(ctx, ctx->env()->RecursivelyCreateDir(spill_directory));
+
+    // By TensorFlow convention, if both seeds are 0, then shuffling should be
+    // seeded non-deterministically.
+    if (seed == 0 && seed2 == 0) {
+      seed = random::New64();
+      seed2 = random::New64();
+    }
+
+    *output = new Dataset(ctx, input, buffer_size, memory_buffer_size, seed,
+                          seed2, spill_directory);
+  }
+
+ private:
+  class Dataset : public GraphDatasetBase {
+   public:
+    Dataset(OpKernelContext* ctx, const DatasetBase* input, int64 buffer_size,
+            int64 memory_buffer_size, int64 seed, int64 seed2,
+            const string& spill_directory)
+        : GraphDatasetBase(ctx),
+          input_(input),
+          buffer_size_(buffer_size),
+          memory_buffer_size_(std::min(memory_buffer_size, buffer_size)),
+          seed_(seed),
+          seed2_(seed2),
+          spill_directory_(spill_directory) {
+      input_->Ref();
+    }
+
+    ~Dataset() override { input_->Unref(); }
+
+    std::unique_ptr<IteratorBase> MakeIteratorInternal(
+        const string& prefix) const override {
+      return std::unique_ptr<IteratorBase>(
+          new Iterator({this, strings::StrCat(prefix, "::SpillingShuffle")}));
+    }
+
+    const DataTypeVector& output_dtypes() const override {
+      return input_->output_dtypes();
+    }
+
+    const std::vector<PartialTensorShape>& output_shapes() const override {
+      return input_->output_shapes();
+    }
+
+    string DebugString() const override {
+      return strings::StrCat("SpillingShuffleDatasetOp(", buffer_size_, ", ",
+                             memory_buffer_size_, ", ", seed_, ", ", seed2_,
+                             ")::Dataset");
+    }
+
+   protected:
+    Status AsGraphDefInternal(OpKernelContext* ctx, DatasetGraphDefBuilder* b,
+                              Node** output) const override {
+      Node* input_graph_node = nullptr;
+      TF_RETURN_IF_ERROR(b->AddParentDataset(ctx, input_, &input_graph_node));
+      Node* buffer_size = nullptr;
+      Node* memory_buffer_size = nullptr;
+      Node* seed = nullptr;
+      Node* seed2 = nullptr;
+      Node* spill_directory = nullptr;
+      TF_RETURN_IF_ERROR(b->AddScalar(buffer_size_, &buffer_size));
+      TF_RETURN_IF_ERROR(
+          b->AddScalar(memory_buffer_size_, &memory_buffer_size));
+      TF_RETURN_IF_ERROR(b->AddScalar(seed_, &seed));
+      TF_RETURN_IF_ERROR(b->AddScalar(seed2_, &seed2));
+      TF_RETURN_IF_ERROR(b->AddScalar(spill_directory_, &spill_directory));
+      TF_RETURN_IF_ERROR(b->AddDataset(
+          this,
+          {input_graph_node, buffer_size, memory_buffer_size, seed, seed2,
+           spill_directory},
+          output));
+      return Status::OK();
+    }
+
+   private:
+    // The iterator keeps up to `buffer_size_` elements, of which at most
+    // `memory_buffer_size_` are in memory. When the memory buffer is full, it
+    // is shuffled and written to a file in `spill_directory_` as a "run". An
+    // output element is drawn uniformly at random from all the buffered
+    // elements: since every run is already shuffled, drawing an element from
+    // a run amounts to reading the next element of the run, so runs are only
+    // ever read sequentially.
+    //
+    // Runs are deleted once they have been read, except for the runs that the
+    // last checkpoint saved or restored by the iterator refers to: these are
+    // kept until a later checkpoint no longer refers to them.
+    class Iterator : public DatasetIterator<Dataset> {
+     public:
+      explicit Iterator(const Params& params)
+          : DatasetIterator<Dataset>(params),
+            parent_generator_(dataset()->seed_, dataset()->seed2_),
+            generator_(&parent_generator_),
+            run_prefix_(strings::StrCat("spilling_shuffle_",
+                                        strings::Hex(random::New64()))) {}
+
+      ~Iterator() override {
+        mutex_lock l(mu_);
+        for (const auto& run : runs_) {
+          ReleaseRun(*run);
+        }
+      }
+
+      Status GetNextInternal(IteratorContext* ctx,
+                             std::vector<Tensor>* out_tensors,
+                             bool* end_of_sequence) override {
+        mutex_lock l(mu_);
+        env_ = ctx->env();
+        if (!input_impl_ && !end_of_input_) {
+          TF_RETURN_IF_ERROR(
+              dataset()->input_->MakeIterator(ctx, prefix(), &input_impl_));
+        }
+        while (!end_of_input_ && num_elements() < dataset()->buffer_size_) {
+          std::vector<Tensor> input_element;
+          TF_RETURN_IF_ERROR(
+              input_impl_->GetNext(ctx, &input_element, &end_of_input_));
+          if (end_of_input_) {
+            input_impl_.reset();
+            break;
+          }
+          if (static_cast<int64>(memory_buffer_.size()) >=
+              dataset()->memory_buffer_size_) {
+            TF_RETURN_IF_ERROR(SpillMemoryBuffer());
+          }
+          memory_buffer_.push_back(std::move(input_element));
+        }
+
+        const int64 total = num_elements();
+        if (total == 0) {
+          *end_of_sequence = true;
+          return Status::OK();
+        }
+        *end_of_sequence = false;
+        int64 index = Random() % total;
+        if (index < static_cast<int64>(memory_buffer_.size())) {
+          *out_tensors = std::move(memory_buffer_[index]);
+          std::swap(memory_buffer_[index], memory_buffer_.back());
+          memory_buffer_.pop_back();
+          return Status::OK();
+        }
+        index -= memory_buffer_.size();
+        for (auto it = runs_.begin(); it != runs_.end(); ++it) {
+          Run* run = it->get();
+          if (index >= run->remaining) {
+            index -= run->remaining;
+            continue;
+          }
+          TF_RETURN_IF_ERROR(ReadElement(ctx, run, out_tensors));
+          if (run->remaining == 0) {
+            ReleaseRun(*run);
+            runs_.erase(it);
+          }
+          return Status::OK();
+        }
+        return errors::Internal("Spilled runs hold fewer than ", num_spilled_,
+                                " elements.");
+      }
+
+     protected:
+      Status SaveInternal(IteratorStateWriter* writer) override {
+        mutex_lock l(mu_);
+        // The runs are not copied into the checkpoint: it only records which
+        // files they are in and how far they have been read, so the files
+        // must outlive the iterator.
+        TF_RETURN_IF_ERROR(writer->WriteScalar(full_name("num_random_samples"),
+                                               num_random_samples_));
+        if (input_impl_) {
+          TF_RETURN_IF_ERROR(
+              writer->WriteScalar(full_name("input_impl_exists"), ""));
+          TF_RETURN_IF_ERROR(SaveParent(writer, input_impl_));
+        }
+        if (end_of_input_) {
+          TF_RETURN_IF_ERROR(
+              writer->WriteScalar(full_name("end_of_input_sequence"), ""));
+        }
+        TF_RETURN_IF_ERROR(writer->WriteScalar(full_name("memory_buffer_size"),
+                                               memory_buffer_.size()));
+        for (size_t i = 0; i < memory_buffer_.size(); ++i) {
+          const std::vector<Tensor>& element = memory_buffer_[i];
+          TF_RETURN_IF_ERROR(writer->WriteScalar(
+              full_name(strings::StrCat("memory_buffer_", i, "_size")),
+              element.size()));
+          for (size_t j = 0; j < element.size(); ++j) {
+            TF_RETURN_IF_ERROR(writer->WriteTensor(
+                full_name(strings::StrCat("memory_buffer_", i, "_", j)),
+                element[j]));
+          }
+        }
+        TF_RETURN_IF_ERROR(
+            writer->WriteScalar(full_name("num_runs"), runs_.size()));
+        for (size_t i = 0; i < runs_.size(); ++i) {
+          const Run& run = *runs_[i];
+          TF_RETURN_IF_ERROR(writer->WriteScalar(
+              full_name(strings::StrCat("run_", i, "_filename")),
+              run.filename));
+          TF_RETURN_IF_ERROR(writer->WriteScalar(
+              full_name(strings::StrCat("run_", i, "_remaining")),
+              run.remaining));
+          TF_RETURN_IF_ERROR(writer->WriteScalar(
+              full_name(strings::StrCat("run_", i, "_offset")),
+              static_cast<int64>(run.offset)));
+        }
+        CheckpointRuns();
+        return Status::OK();
+      }
+
+      Status RestoreInternal(IteratorContext* ctx,
+                             IteratorStateReader* reader) override {
+        mutex_lock l(mu_);
+        env_ = ctx->env();
+        TF_RETURN_IF_ERROR(reader->ReadScalar(full_name("num_random_samples"),
+                                              &num_random_samples_));
+        ResetRngs();
+
+        input_impl_.reset();
+        if (reader->Contains(full_name("input_impl_exists"))) {
+          TF_RETURN_IF_ERROR(
+              dataset()->input_->MakeIterator(ctx, prefix(), &input_impl_));
+          TF_RETURN_IF_ERROR(RestoreParent(ctx, reader, input_impl_));
+        }
+        end_of_input_ = reader->Contains(full_name("end_of_input_sequence"));
+
+        int64 memory_buffer_size;
+        TF_RETURN_IF_ERROR(reader->ReadScalar(full_name("memory_buffer_size"),
+                                              &memory_buffer_size));
+        memory_buffer_.clear();
+        memory_buffer_.reserve(dataset()->memory_buffer_size_);
+        for (int64 i = 0; i < memory_buffer_size; ++i) {
+          int64 element_size;
+          TF_RETURN_IF_ERROR(reader->ReadScalar(
+              full_name(strings::StrCat("memory_buffer_", i, "_size")),
+              &element_size));
+          std::vector<Tensor> element(element_size);
+          for (int64 j = 0; j < element_size; ++j) {
+            TF_RETURN_IF_ERROR(reader->ReadTensor(
+                full_name(strings::StrCat("memory_buffer_", i, "_", j)),
+                &element[j]));
+          }
+          memory_buffer_.push_back(std::move(element));
+        }
+
+        int64 num_runs;
+        TF_RETURN_IF_ERROR(
+            reader->ReadScalar(full_name("num_runs"), &num_runs));
+        std::vector<std::unique_ptr<Run>> runs;
+        std::set<string> filenames;
+        int64 num_spilled = 0;
+        for (int64 i = 0; i < num_runs; ++i) {
+          std::unique_ptr<Run> run(new Run);
+          int64 offset;
+          TF_RETURN_IF_ERROR(reader->ReadScalar(
+              full_name(strings::StrCat("run_", i, "_filename")),
+              &run->filename));
+          TF_RETURN_IF_ERROR(reader->ReadScalar(
+              full_name(strings::StrCat("run_", i, "_remaining")),
+              &run->remaining));
+          TF_RETURN_IF_ERROR(reader->ReadScalar(
+              full_name(strings::StrCat("run_", i, "_offset")), &offset));
+          run->offset = offset;
+          TF_RETURN_IF_ERROR(OpenRun(run.get()));
+          num_spilled += run->remaining;
+          filenames.insert(run->filename);
+          runs.push_back(std::move(run));
+        }
+        for (const auto& run : runs_) {
+          if (filenames.count(run->filename) == 0) {
+            ReleaseRun(*run);
+          }
+        }
+        runs_ = std::move(runs);
+        num_spilled_ = num_spilled;
+        CheckpointRuns();
+        return Status::OK();
+      }
+
+     private:
+      // A shuffled sequence of elements spilled to a file.
+      struct Run {
+        string filename;
+        // The number of elements that have not been read yet.
+        int64 remaining = 0;
+        // The offset of the next record in the file.
+        uint64 offset = 0;
+        std::unique_ptr<RandomAccessFile> file;
+        std::unique_ptr<io::RecordReader> reader;
+      };
+
+      int64 num_elements() const EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        return memory_buffer_.size() + num_spilled_;
+      }
+
+      // Shuffles the memory buffer and writes it to a new run.
+      Status SpillMemoryBuffer() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        for (size_t i = memory_buffer_.size(); i > 1; --i) {
+          std::swap(memory_buffer_[i - 1], memory_buffer_[Random() % i]);
+        }
+        std::unique_ptr<Run> run;
+        std::unique_ptr<WritableFile> file;
+        std::unique_ptr<io::RecordWriter> writer;
+        TF_RETURN_IF_ERROR(CreateRun(&run, &file, &writer));
+        string record;
+        for (const std::vector<Tensor>& element : memory_buffer_) {
+          for (const Tensor& t : element) {
+            TensorProto proto;
+            t.AsProtoTensorContent(&proto);
+            proto.SerializeToString(&record);
+            TF_RETURN_IF_ERROR(writer->WriteRecord(record));
+          }
+        }
+        TF_RETURN_IF_ERROR(AddRun(std::move(run), memory_buffer_.size(),
+                                  file.get(), writer.get()));
+        memory_buffer_.clear();
+        if (runs_.size() > kMaxRuns) {
+          TF_RETURN_IF_ERROR(MergeSmallestRuns());
+        }
+        return Status::OK();
+      }
+
+      // Merges the `kNumRunsToMerge` smallest runs into a new run. Like in
+      // GetNextInternal, the next element of the new run is read from one of
+      // the merged runs with a probability proportional to the number of
+      // elements left in it, so the new run is shuffled as well.
+      Status MergeSmallestRuns() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        std::stable_sort(
+            runs_.begin(), runs_.end(),
+            [](const std::unique_ptr<Run>& a, const std::unique_ptr<Run>& b) {
+              return a->remaining < b->remaining;
+            });
+        int64 num_elements = 0;
+        for (size_t i = 0; i < kNumRunsToMerge; ++i) {
+          num_elements += runs_[i]->remaining;
+        }
+        std::unique_ptr<Run> run;
+        std::unique_ptr<WritableFile> file;
+        std::unique_ptr<io::RecordWriter> writer;
+        TF_RETURN_IF_ERROR(CreateRun(&run, &file, &writer));
+        // Elements are copied without parsing their components.
+        const size_t num_components = dataset()->output_dtypes().size();
+        string record;
+        for (int64 n = num_elements; n > 0; --n) {
+          int64 index = Random() % n;
+          size_t i = 0;
+          while (index >= runs_[i]->remaining) {
+            index -= runs_[i]->remaining;
+            ++i;
+          }
+          Run* input = runs_[i].get();
+          for (size_t j = 0; j < num_components; ++j) {
+            TF_RETURN_IF_ERROR(
+                input->reader->ReadRecord(&input->offset, &record));
+            TF_RETURN_IF_ERROR(writer->WriteRecord(record));
+          }
+          --input->remaining;
+          --num_spilled_;
+        }
+        for (size_t i = 0; i < kNumRunsToMerge; ++i) {
+          ReleaseRun(*runs_[i]);
+        }
+        runs_.erase(runs_.begin(), runs_.begin() + kNumRunsToMerge);
+        return AddRun(std::move(run), num_elements, file.get(), writer.get());
+      }
+
+      // Creates the file of a new run and a writer for it. `*writer` must be
+      // destroyed before `*file`.
+      Status CreateRun(std::unique_ptr<Run>* run,
+                       std::unique_ptr<WritableFile>* file,
+                       std::unique_ptr<io::RecordWriter>* writer)
+          EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        run->reset(new Run);
+        (*run)->filename = io::JoinPath(
+            dataset()->spill_directory_,
+            strings::StrCat(run_prefix_, "_", next_run_id_++, ".zz"));
+        TF_RETURN_IF_ERROR(env_->NewWritableFile((*run)->filename, file));
+        io::RecordWriterOptions options =
+            io::RecordWriterOptions::CreateRecordWriterOptions(
+                kRunCompressionType);
+        options.zlib_options.input_buffer_size = kRunBufferSize;
+        options.zlib_options.output_buffer_size = kRunBufferSize;
+        writer->reset(new io::RecordWriter(file->get(), options));
+        return Status::OK();
+      }
+
+      // Closes `writer` and `file`, to which the `num_elements` elements of
+      // `run` were written, and adds `run` to the runs.
+      Status AddRun(std::unique_ptr<Run> run, int64 num_elements,
+                    WritableFile* file, io::RecordWriter* writer)
+          EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        TF_RETURN_IF_ERROR(writer->Close());
+        TF_RETURN_IF_ERROR(file->Close());
+        run->remaining = num_elements;
+        TF_RETURN_IF_ERROR(OpenRun(run.get()));
+        num_spilled_ += run->remaining;
+        runs_.push_back(std::move(run));
+        return Status::OK();
+      }
+
+      // Opens the file of `run` for reading from `run->offset`.
+      Status OpenRun(Run* run) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        TF_RETURN_IF_ERROR(
+            env_->NewRandomAccessFile(run->filename, &run->file));
+        io::RecordReaderOptions options =
+            io::RecordReaderOptions::CreateRecordReaderOptions(
+                kRunCompressionType);
+        options.zlib_options.input_buffer_size = kRunBufferSize;
+        options.zlib_options.output_buffer_size = kRunBufferSize;
+        run->reader.reset(new io::RecordReader(run->file.get(), options));
+        return Status::OK();
+      }
+
+      // Reads the next element of `run`.
+      Status ReadElement(IteratorContext* ctx, Run* run,
+                         std::vector<Tensor>* out_tensors)
+          EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        const size_t num_components = dataset()->output_dtypes().size();
+        out_tensors->clear();
+        out_tensors->reserve(num_components);
+        string record;
+        for (size_t i = 0; i < num_components; ++i) {
+          TF_RETURN_IF_ERROR(run->reader->ReadRecord(&run->offset, &record));
+          TensorProto proto;
+          if (!proto.ParseFromString(record)) {
+            return errors::DataLoss("Could not parse an element of ",
+                                    run->filename);
+          }
+          Tensor t;
+          if (!t.FromProto(ctx->allocator({}), proto)) {
+            return errors::DataLoss("Invalid tensor in ", run->filename);
+          }
+          out_tensors->push_back(std::move(t));
+        }
+        --run->remaining;
+        --num_spilled_;
+        return Status::OK();
+      }
+
+      // Deletes the file of `run`, which is no longer read, unless the last
+      // checkpoint refers to it.
+      void ReleaseRun(const Run& run) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        if (checkpointed_runs_.count(run.filename) == 0) {
+          DeleteRunFile(run.filename);
+        }
+      }
+
+      // Records that the last checkpoint refers to the runs in `runs_`, and
+      // deletes the files that only the previous checkpoint referred to.
+      void CheckpointRuns() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        std::set<string> filenames;
+        for (const auto& run : runs_) {
+          filenames.insert(run->filename);
+        }
+        for (const string& filename : checkpointed_runs_) {
+          if (filenames.count(filename) == 0) {
+            DeleteRunFile(filename);
+          }
+        }
+        checkpointed_runs_.swap(filenames);
+      }
+
+      void DeleteRunFile(const string& filename) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        Status s = env_->DeleteFile(filename);
+        if (!s.ok()) {
+          LOG(WARNING) << "Failed to delete " << filename << ": " << s;
+        }
+      }
+
+      random::SingleSampleAdapter<random::PhiloxRandom>::ResultType Random()
+          EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        num_random_samples_++;
+        return generator_();
+      }
+
+      void ResetRngs() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        parent_generator_ =
+            random::PhiloxRandom(dataset()->seed_, dataset()->seed2_);
+        generator_ = random::SingleSampleAdapter<random::PhiloxRandom>(
+            &parent_generator_);
+        generator_.Skip(num_random_samples_);
+      }
+
+      mutex mu_;
+      Env* env_ GUARDED_BY(mu_) = Env::Default();
+      std::unique_ptr<IteratorBase> input_impl_ GUARDED_BY(mu_);
+      bool end_of_input_ GUARDED_BY(mu_) = false;
+      std::vector<std::vector<Tensor>> memory_buffer_ GUARDED_BY(mu_);
+      std::vector<std::unique_ptr<Run>> runs_ GUARDED_BY(mu_);
+      // The number of elements in `runs_` that have not been read yet.
+      int64 num_spilled_ GUARDED_BY(mu_) = 0;
+      // The files of the runs that the last checkpoint saved or restored by
+      // the iterator refers to.
+      std::set<string> checkpointed_runs_ GUARDED_BY(mu_);
+      random::PhiloxRandom parent_generator_ GUARDED_BY(mu_);
+      random::SingleSampleAdapter<random::PhiloxRandom> generator_
+          GUARDED_BY(mu_);
+      int64 num_random_samples_ GUARDED_BY(mu_) = 0;
+      // Runs get unique names so that iterators can share a directory.
+      const string run_prefix_;
+      int64 next_run_id_ GUARDED_BY(mu_) = 0;
+    };
+
+    const DatasetBase* const input_;
+    const int64 buffer_size_;
+    const int64 memory_buffer_size_;
+    const int64 seed_;
+    const int64 seed2_;
+    const string spill_directory_;
+  };
+};
+
+REGISTER_KERNEL_BUILDER(Name("SpillingShuffleDataset").Device(DEVICE_CPU),
+                        SpillingShuffleDatasetOp);
+
+}  // namespace
+}  // namespace tensorflow
@@ -90,6 +90,49 @@ REGISTER_OP("UniqueDataset")
 Creates a dataset that contains the unique elements of `input_dataset`.
 )doc");
 
+REGISTER_OP("SpillingShuffleDataset")
+    .Input("input_dataset: variant")
+    .Input("buffer_size: int64")
+    .Input("memory_buffer_size: int64")
+    .Input("seed: int64")
+    .Input("seed2: int64")
+    .Input("spill_directory: string")
+    .Output("handle: variant")
+    .Attr("output_types: list(type) >= 1")
+    .Attr("output_shapes: list(shape) >= 1")
+    .SetShapeFn([](shape_inference::InferenceContext* c) {
+      shape_inference::ShapeHandle unused;
+      // All inputs but `input_dataset` must be scalars.
+      for (int i = 1; i < 6; ++i) {
+        TF_RETURN_IF_ERROR(c->WithRank(c->input(i), 0, &unused));
+      }
+      return shape_inference::ScalarShape(c);
+    })
+    .Doc(R"doc(
+Creates a dataset that shuffles elements from `input_dataset` pseudorandomly,
+keeping only part of its shuffle buffer in memory.
+
+Up to `buffer_size` elements are buffered, of which at most
+`memory_buffer_size` are held in memory. Whenever the memory buffer is full, it
+is shuffled and written to a compressed file in `spill_directory`, and elements
+are then read back sequentially from these files. The output has the same
+distribution as the output of `ShuffleDataset` with the same `buffer_size`.
+
+Checkpoints of the iterator refer to the files instead of holding the buffered
+elements. The files that the last checkpoint saved or restored by an iterator
+refers to are kept until the iterator saves a checkpoint that no longer refers
+to them, so only the last checkpoint of an iterator can be restored.
+
+buffer_size: The number of elements from which the next element is sampled.
+memory_buffer_size: The maximum number of buffered elements held in memory.
+seed: A scalar seed for the random number generator. If either seed or
+  seed2 is set to be non-zero, the random number generator is seeded
+  by the given seed.  Otherwise, a random seed is used.
+seed2: A second scalar seed to avoid seed collision.
+spill_directory: The directory of the spilled elements. If empty, a local
+  temporary directory is used.
+)doc");
+
 REGISTER_OP("IteratorGetDevice")
     .Input("resource: resource")
     .Output("device: string")
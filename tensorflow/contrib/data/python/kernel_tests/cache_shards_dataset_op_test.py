@@ -0,0 +1,88 @@
+# Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+"""Tests for the experimental input pipeline ops."""
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+
+import os
+
+from tensorflow.contrib.data.python.ops import caching
+from tensorflow.contrib.data.python.ops import interleave_ops
+from tensorflow.python.data.ops import dataset_ops
+from tensorflow.python.framework import errors
+from tensorflow.python.platform import test
+
+
+class CacheShardsDatasetTest(test.TestCase):
+
+  def setUp(self):
+    self.cache_prefix = os.path.join(self.get_temp_dir(), "cache")
+
+  def _gen_outputs(self, dataset):
+    get_next = dataset.make_one_shot_iterator().get_next()
+    outputs = []
+    with self.test_session() as sess:
+      while True:
+        try:
+          outputs.append(sess.run(get_next))
+        except errors.OutOfRangeError:
+          break
+    return outputs
+
+  def _write_cache(self, dataset, num_shards):
+    self.assertEqual(
+        self._gen_outputs(dataset.cache(
+            self.cache_prefix, num_shards=num_shards,
+            compression_type="ZLIB")),
+        self._gen_outputs(dataset))
+
+  def testReadShards(self):
+    dataset = dataset_ops.Dataset.range(20).map(lambda x: (x, x * x))
+    self._write_cache(dataset, 4)
+    for shards, expected in [([1], [1, 5, 9, 13, 17]),
+                             ([3, 0], [3, 7, 11, 15, 19, 0, 4, 8, 12, 16]),
+                             ([], [])]:
+      self.assertEqual([(x, x * x) for x in expected],
+                       self._gen_outputs(dataset.apply(
+                           caching.read_cache_shards(self.cache_prefix,
+                                                     shards))))
+
+  def testReadShardsInParallel(self):
+    dataset = dataset_ops.Dataset.range(100)
+    self._write_cache(dataset, 5)
+    sharded = dataset_ops.Dataset.range(5).apply(
+        interleave_ops.parallel_interleave(
+            lambda shard: dataset.apply(
+                caching.read_cache_shards(self.cache_prefix, [shard])),
+            cycle_length=5))
+    self.assertEqual(list(range(100)), sorted(self._gen_outputs(sharded)))
+
+  def testIncompleteCache(self):
+    dataset = dataset_ops.Dataset.range(10).apply(
+        caching.read_cache_shards(self.cache_prefix, [0]))
+    with self.assertRaises(errors.FailedPreconditionError):
+      self._gen_outputs(dataset)
+
+  def testInvalidShard(self):
+    dataset = dataset_ops.Dataset.range(10)
+    self._write_cache(dataset, 2)
+    with self.assertRaises(errors.InvalidArgumentError):
+      self._gen_outputs(dataset.apply(
+          caching.read_cache_shards(self.cache_prefix, [2])))
+
+
+if __name__ == "__main__":
+  test.main()
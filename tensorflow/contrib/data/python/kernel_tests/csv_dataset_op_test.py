@@ -554,7 +554,7 @@ class CsvDatasetBenchmark(test.Benchmark):
     gfile.MakeDirs(googletest.GetTempDir())
     self._temp_dir = tempfile.mkdtemp(dir=googletest.GetTempDir())
 
-    self._num_cols = [4, 64, 256]
+    self._num_cols = [4, 64, 200, 256]
     self._num_per_iter = 5000
     self._filenames = []
     for n in self._num_cols:
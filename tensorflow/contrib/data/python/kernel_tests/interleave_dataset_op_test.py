@@ -619,6 +619,32 @@ class ParallelInterleaveDatasetTest(test.TestCase):
   def testTooManyReadersSloppy(self):
     self._testTooManyReaders(sloppy=True)
 
+  def testAutotuneBufferOutputElements(self):
+
+    def interleave_fn(x):
+      dataset = dataset_ops.Dataset.from_tensors(x)
+      dataset = dataset.repeat(math_ops.cast(x, dtype=dtypes.int64))
+      return dataset.map(lambda y: y * y)
+
+    dataset = dataset_ops.Dataset.from_tensor_slices([4, 5, 6])
+    dataset = dataset.repeat(self.repeat_count)
+    # -1 is AUTOTUNE, which tunes the number of elements each worker buffers.
+    dataset = dataset.apply(
+        interleave_ops.parallel_interleave(
+            interleave_fn,
+            cycle_length=2,
+            block_length=3,
+            buffer_output_elements=-1))
+    get_next = dataset.make_one_shot_iterator().get_next()
+
+    with self.test_session() as sess:
+      for expected_element in self._interleave(
+          [[4] * 4, [5] * 5, [6] * 6] * self.repeat_count, 2, 3):
+        self.assertEqual(expected_element * expected_element,
+                         sess.run(get_next))
+      with self.assertRaises(errors.OutOfRangeError):
+        sess.run(get_next)
+
   def testSparse(self):
     def _map_fn(i):
       return sparse_tensor.SparseTensor(
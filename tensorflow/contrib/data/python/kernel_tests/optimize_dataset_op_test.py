@@ -17,9 +17,16 @@ from __future__ import absolute_import
 from __future__ import division
 from __future__ import print_function
 
+import time
+
+import numpy as np
+
 from tensorflow.contrib.data.python.ops import optimization
+from tensorflow.python.client import session
 from tensorflow.python.data.ops import dataset_ops
 from tensorflow.python.framework import errors
+from tensorflow.python.framework import ops
+from tensorflow.python.ops import math_ops
 from tensorflow.python.platform import test
 
 
@@ -99,6 +106,64 @@ class OptimizeDatasetTest(test.TestCase):
       with self.assertRaises(errors.OutOfRangeError):
         sess.run(get_next)
 
+  def testMapFusion(self):
+    dataset = dataset_ops.Dataset.range(10).apply(
+        optimization.assert_next(
+            ["Map", "Prefetch"])).map(lambda x: x * x).map(
+                lambda x: x + 1).map(lambda x: x * 2).prefetch(1).apply(
+                    optimization.optimize(["map_fusion"]))
+    iterator = dataset.make_one_shot_iterator()
+    get_next = iterator.get_next()
+
+    with self.test_session() as sess:
+      for x in range(10):
+        self.assertEqual((x * x + 1) * 2, sess.run(get_next))
+      with self.assertRaises(errors.OutOfRangeError):
+        sess.run(get_next)
+
+  def testMapAndFilterFusion(self):
+    dataset = dataset_ops.Dataset.range(10).apply(
+        optimization.assert_next(
+            ["Map", "FilterByLastComponent"])).map(lambda x: x * x).filter(
+                lambda x: math_ops.equal(x % 2, 0)).apply(
+                    optimization.optimize(["map_and_filter_fusion"]))
+    iterator = dataset.make_one_shot_iterator()
+    get_next = iterator.get_next()
+
+    with self.test_session() as sess:
+      for x in range(0, 10, 2):
+        self.assertEqual(x * x, sess.run(get_next))
+      with self.assertRaises(errors.OutOfRangeError):
+        sess.run(get_next)
+
+  def testMapVectorization(self):
+    dataset = dataset_ops.Dataset.range(10).apply(
+        optimization.assert_next(
+            ["Batch", "Map"])).map(lambda x: x * x + 1).batch(4).apply(
+                optimization.optimize(["map_vectorization"]))
+    iterator = dataset.make_one_shot_iterator()
+    get_next = iterator.get_next()
+
+    with self.test_session() as sess:
+      self.assertAllEqual([x * x + 1 for x in range(4)], sess.run(get_next))
+      self.assertAllEqual([x * x + 1 for x in range(4, 8)],
+                          sess.run(get_next))
+      self.assertAllEqual([x * x + 1 for x in range(8, 10)],
+                          sess.run(get_next))
+      with self.assertRaises(errors.OutOfRangeError):
+        sess.run(get_next)
+
+  def testMapVectorizationSkipsNonElementwiseFunction(self):
+    dataset = dataset_ops.Dataset.range(10).apply(
+        optimization.assert_next(
+            ["Map", "Batch"])).map(math_ops.reduce_sum).batch(10).apply(
+                optimization.optimize(["map_vectorization"]))
+    iterator = dataset.make_one_shot_iterator()
+    get_next = iterator.get_next()
+
+    with self.test_session() as sess:
+      self.assertAllEqual(list(range(10)), sess.run(get_next))
+
   def testFunctionLibraryDefinitionModification(self):
     dataset = dataset_ops.Dataset.from_tensors(0).map(lambda x: x).apply(
         optimization.optimize(["_test_only_function_rename"]))
@@ -111,5 +176,71 @@ class OptimizeDatasetTest(test.TestCase):
         sess.run(get_next)
 
 
+class OptimizeDatasetBenchmark(test.Benchmark):
+
+  # The purpose of these benchmarks is to compare the throughput of input
+  # pipelines with and without the optimizations that reduce the number of
+  # function invocations per element.
+  def _benchmark(self, label, dataset_fn, optimizations, num_elements=10000):
+    elements_per_sec = {}
+    for optimized in [False, True]:
+      with ops.Graph().as_default():
+        dataset = dataset_fn()
+        if optimized:
+          dataset = dataset.apply(optimization.optimize(optimizations))
+        # A batch counts as as many elements as it has rows.
+        get_next = dataset.make_one_shot_iterator().get_next()
+        with session.Session() as sess:
+          first = sess.run(get_next)
+          rows_per_run = first.shape[0] if first.shape else 1
+          num_runs = num_elements // rows_per_run
+          start = time.time()
+          for _ in range(num_runs):
+            sess.run(get_next.op)
+          wall_time = time.time() - start
+      name = "%s_%s" % (label, "optimized" if optimized else "chained")
+      elements_per_sec[optimized] = num_runs * rows_per_run / wall_time
+      self.report_benchmark(
+          iters=num_runs,
+          wall_time=wall_time / num_runs,
+          name=name,
+          extras={"elements_per_sec": elements_per_sec[optimized]})
+    print("%s: %.0f elements/sec chained, %.0f elements/sec optimized "
+          "(%.2fx)" % (label, elements_per_sec[False], elements_per_sec[True],
+                       elements_per_sec[True] / elements_per_sec[False]))
+
+  def benchmarkMapFusion(self):
+    for num_maps in [2, 4, 6]:
+
+      def dataset_fn(num_maps=num_maps):
+        dataset = dataset_ops.Dataset.from_tensors(np.float32(1.0)).repeat()
+        for _ in range(num_maps):
+          dataset = dataset.map(lambda x: x * 1.0001)
+        return dataset
+
+      self._benchmark("map_fusion_%d_maps" % num_maps, dataset_fn,
+                      ["map_fusion"])
+
+  def benchmarkMapAndFilterFusion(self):
+
+    def dataset_fn():
+      return dataset_ops.Dataset.from_tensors(np.float32(1.0)).repeat().map(
+          lambda x: x * 1.0001).filter(lambda x: math_ops.greater(x, 0.0))
+
+    self._benchmark("map_and_filter_fusion", dataset_fn,
+                    ["map_and_filter_fusion"])
+
+  def benchmarkMapVectorization(self):
+    for batch_size in [16, 128]:
+
+      def dataset_fn(batch_size=batch_size):
+        return dataset_ops.Dataset.from_tensors(
+            np.ones(64, dtype=np.float32)).repeat().map(
+                lambda x: x * 2.0 + 1.0).batch(batch_size)
+
+      self._benchmark("map_vectorization_batch_size_%d" % batch_size,
+                      dataset_fn, ["map_vectorization"])
+
+
 if __name__ == "__main__":
   test.main()
@@ -186,5 +186,14 @@ class CacheDatasetSerializationTest(
     self.assertSequenceEqual(outputs, list(range(10)) * 3)
 
 
+class ShardedCacheDatasetSerializationTest(CacheDatasetSerializationTest):
+
+  def ds_fn(self):
+    return dataset_ops.Dataset.range(self.range_size).cache(
+        os.path.join(self.get_temp_dir(), self.cache_file_prefix),
+        num_shards=3,
+        compression_type='ZLIB').repeat(self.num_repeats)
+
+
 if __name__ == '__main__':
   test.main()
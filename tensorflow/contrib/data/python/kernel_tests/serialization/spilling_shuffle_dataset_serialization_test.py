@@ -0,0 +1,52 @@
+# Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+"""Tests for the SpillingShuffleDataset serialization."""
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+
+import os
+
+from tensorflow.contrib.data.python.kernel_tests.serialization import dataset_serialization_test_base
+from tensorflow.contrib.data.python.ops import shuffle_ops
+from tensorflow.python.data.ops import dataset_ops
+from tensorflow.python.platform import gfile
+from tensorflow.python.platform import test
+
+
+class SpillingShuffleSerializationTest(
+    dataset_serialization_test_base.DatasetSerializationTestBase):
+
+  def _build_ds(self, seed):
+    return dataset_ops.Dataset.range(50).apply(
+        shuffle_ops.spilling_shuffle(
+            buffer_size=20,
+            memory_buffer_size=3,
+            spill_directory=self.get_temp_dir(),
+            seed=seed))
+
+  def testCore(self):
+    self.run_core_tests(lambda: self._build_ds(10), lambda: self._build_ds(20),
+                        50)
+
+  def testDeletesFilesNoLongerInCheckpoint(self):
+    self.gen_outputs(lambda: self._build_ds(10), [10, 20, 30], 50)
+    # The last checkpoint is of an exhausted iterator, which has no runs.
+    self.assertEqual(
+        [], gfile.Glob(os.path.join(self.get_temp_dir(), "spilling_shuffle_*")))
+
+
+if __name__ == "__main__":
+  test.main()
@@ -17,12 +17,15 @@ from __future__ import absolute_import
 from __future__ import division
 from __future__ import print_function
 
+import os
+
 import numpy as np
 
 from tensorflow.contrib.data.python.ops import shuffle_ops
 from tensorflow.python.data.ops import dataset_ops
 from tensorflow.python.framework import errors
 from tensorflow.python.framework import ops
+from tensorflow.python.platform import gfile
 from tensorflow.python.platform import test
 
 
@@ -110,5 +113,85 @@ class ShuffleAndRepeatTest(test.TestCase):
         sess.run(get_next_op)
 
 
+class SpillingShuffleTest(test.TestCase):
+
+  def _build_ds(self, seed, num_elements=100, buffer_size=50,
+                memory_buffer_size=7):
+    return dataset_ops.Dataset.range(num_elements).map(
+        lambda x: (x, [x] * 3)).apply(
+            shuffle_ops.spilling_shuffle(
+                buffer_size=buffer_size,
+                memory_buffer_size=memory_buffer_size,
+                spill_directory=self.get_temp_dir(),
+                seed=seed))
+
+  def _gen_outputs(self, ds_fn):
+    get_next = ds_fn().make_one_shot_iterator().get_next()
+    outputs = []
+    with self.test_session() as sess:
+      while True:
+        try:
+          x, y = sess.run(get_next)
+        except errors.OutOfRangeError:
+          break
+        self.assertAllEqual([x] * 3, y)
+        outputs.append(x)
+    return outputs
+
+  def _spilled_files(self):
+    return gfile.Glob(os.path.join(self.get_temp_dir(), "spilling_shuffle_*"))
+
+  def testCorrectOutput(self):
+    output = self._gen_outputs(lambda: self._build_ds(10))
+    self.assertSequenceEqual(sorted(output), range(100))
+    self.assertNotEqual(output, list(range(100)))
+
+  def testSameOrderForSameSeeds(self):
+    output1 = self._gen_outputs(lambda: self._build_ds(10))
+    output2 = self._gen_outputs(lambda: self._build_ds(10))
+    self.assertEqual(output1, output2)
+
+  def testDifferentOrderForDifferentSeeds(self):
+    output1 = self._gen_outputs(lambda: self._build_ds(10))
+    output2 = self._gen_outputs(lambda: self._build_ds(20))
+    self.assertNotEqual(output1, output2)
+
+  def testNothingSpilledIfBufferFitsInMemory(self):
+    output = self._gen_outputs(
+        lambda: self._build_ds(10, memory_buffer_size=50))
+    self.assertSequenceEqual(sorted(output), range(100))
+    self.assertEqual([], self._spilled_files())
+
+  def testDeletesSpilledFiles(self):
+    get_next = self._build_ds(10).make_one_shot_iterator().get_next()
+    with self.test_session() as sess:
+      for _ in range(10):
+        sess.run(get_next)
+      self.assertNotEqual([], self._spilled_files())
+      for _ in range(90):
+        sess.run(get_next)
+      with self.assertRaises(errors.OutOfRangeError):
+        sess.run(get_next)
+      self.assertEqual([], self._spilled_files())
+
+  def testMergesRuns(self):
+    # Every element is spilled to its own run, so runs are merged to bound the
+    # number of open files.
+    def ds_fn():
+      return self._build_ds(
+          10, num_elements=200, buffer_size=100, memory_buffer_size=1)
+
+    get_next = ds_fn().make_one_shot_iterator().get_next()
+    with self.test_session() as sess:
+      sess.run(get_next)
+      self.assertLessEqual(len(self._spilled_files()), 32)
+    output = self._gen_outputs(ds_fn)
+    self.assertSequenceEqual(sorted(output), range(200))
+
+  def testEmptyInput(self):
+    self.assertEqual([], self._gen_outputs(
+        lambda: self._build_ds(10, num_elements=0)))
+
+
 if __name__ == "__main__":
   test.main()
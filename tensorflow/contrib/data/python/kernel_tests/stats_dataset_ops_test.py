@@ -195,6 +195,38 @@ class StatsDatasetTest(StatsDatasetTestBase):
         sess.run(next_element)
       self._assertSummaryHasCount(sess.run(summary_t), "record_latency", 200.0)
 
+  def testPipelineStageStats(self):
+    stats_aggregator = stats_ops.StatsAggregator()
+    dataset = dataset_ops.Dataset.range(100).map(lambda x: x * 2).prefetch(
+        1).apply(stats_ops.set_stats_aggregator(stats_aggregator))
+    iterator = dataset.make_initializable_iterator()
+    next_element = iterator.get_next()
+    summary_t = stats_aggregator.get_summary()
+    prefetch = "Iterator::SetStatsAggregator::Prefetch"
+
+    with self.test_session() as sess:
+      sess.run(iterator.initializer)
+      for i in range(100):
+        self.assertEqual(i * 2, sess.run(next_element))
+        summary_str = sess.run(summary_t)
+        self._assertSummaryHasCount(summary_str, prefetch + "::latency",
+                                    float(i + 1))
+        self._assertSummaryHasCount(summary_str, prefetch + "::input_time",
+                                    float(i + 1))
+        self._assertSummaryHasCount(summary_str,
+                                    prefetch + "::buffered_elements",
+                                    float(i + 1))
+        self._assertSummaryHasSum(summary_str, prefetch + "::bytes_produced",
+                                  8.0 * (i + 1))
+      # The map stage runs ahead of the consumer on the prefetch thread, but
+      # has produced every element by now.
+      self._assertSummaryHasCount(summary_str, prefetch + "::Map::latency",
+                                  100.0)
+      self._assertSummaryHasSum(summary_str,
+                                prefetch + "::Map::bytes_produced", 800.0)
+      with self.assertRaises(errors.OutOfRangeError):
+        sess.run(next_element)
+
 
 class FeatureStatsDatasetTest(
     StatsDatasetTestBase,
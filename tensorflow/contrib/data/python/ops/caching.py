@@ -0,0 +1,93 @@
+# Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+"""Experimental transformations for reading sharded caches."""
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+
+from tensorflow.python.data.ops import dataset_ops
+from tensorflow.python.framework import dtypes
+from tensorflow.python.framework import ops
+from tensorflow.python.ops import gen_dataset_ops
+
+
+class _CacheShardsDataset(dataset_ops.Dataset):
+  """A `Dataset` that reads some shards of a sharded cache."""
+
+  def __init__(self, input_dataset, filename, shards):
+    """See `read_cache_shards()` for details."""
+    super(_CacheShardsDataset, self).__init__()
+    self._input_dataset = input_dataset
+    self._filename = ops.convert_to_tensor(
+        filename, dtype=dtypes.string, name="filename")
+    self._shards = ops.convert_to_tensor(
+        shards, dtype=dtypes.int64, name="shards")
+
+  def _as_variant_tensor(self):
+    return gen_dataset_ops.cache_shards_dataset(
+        self._input_dataset._as_variant_tensor(),  # pylint: disable=protected-access
+        filename=self._filename,
+        shards=self._shards,
+        **dataset_ops.flat_structure(self))
+
+  @property
+  def output_classes(self):
+    return self._input_dataset.output_classes
+
+  @property
+  def output_shapes(self):
+    return self._input_dataset.output_shapes
+
+  @property
+  def output_types(self):
+    return self._input_dataset.output_types
+
+
+def read_cache_shards(filename, shards):
+  """Reads some shards of a cache written with `Dataset.cache(num_shards=...)`.
+
+  `dataset.apply(tf.contrib.data.read_cache_shards(filename, shards))`
+  produces the elements of `dataset` that were cached in the given shards of
+  the cache at `filename`, without iterating `dataset`. The cache must have
+  been completely written by `dataset.cache(filename, num_shards)`. Element
+  `i` of `dataset` is in shard `i % num_shards`.
+
+  Datasets that read disjoint shards of the same cache can be iterated
+  concurrently, e.g. one per replica, or one per input element of
+  `tf.contrib.data.parallel_interleave`:
+
+  ```python
+  cached = tf.data.Dataset.range(num_shards).apply(
+      tf.contrib.data.parallel_interleave(
+          lambda shard: dataset.apply(
+              tf.contrib.data.read_cache_shards(filename, [shard])),
+          cycle_length=num_shards))
+  ```
+
+  Args:
+    filename: A `tf.string` scalar `tf.Tensor`, representing the name of the
+      cache.
+    shards: A `tf.int64` vector `tf.Tensor`, representing the indices of the
+      shards to read. The shards are read one after the other.
+
+  Returns:
+    A `Dataset` transformation function, which can be passed to
+    @{tf.data.Dataset.apply}.
+  """
+
+  def _apply_fn(dataset):
+    return _CacheShardsDataset(dataset, filename, shards)
+
+  return _apply_fn
@@ -49,6 +49,22 @@ def assert_next(transformations):
 def optimize(optimizations=None):
   """A transformation that applies optimizations.
 
+  The available optimizations include:
+
+  * `"map_and_batch_fusion"`: fuses `map` followed by `batch` into
+    `map_and_batch`.
+  * `"map_fusion"`: fuses consecutive `map` transformations, so that each
+    element takes a single function invocation.
+  * `"map_and_filter_fusion"`: fuses `map` followed by `filter`, so that the
+    map function and the predicate are evaluated in a single function
+    invocation.
+  * `"map_vectorization"`: moves `batch` before a `map` whose function is
+    elementwise, so that the function is invoked once per batch.
+  * `"noop_elimination"`: removes transformations that do nothing, such as
+    `repeat(1)`.
+  * `"shuffle_and_repeat_fusion"`: fuses `shuffle` followed by `repeat` into
+    `shuffle_and_repeat`.
+
   Args:
     optimizations: (Optional.) A `tf.string` vector `tf.Tensor` identifying
       optimizations to use. If not specified, the default set of optimizations
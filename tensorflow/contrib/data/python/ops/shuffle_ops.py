@@ -17,6 +17,8 @@ from __future__ import absolute_import
 from __future__ import division
 from __future__ import print_function
 
+from tensorflow.contrib.data.python.ops import contrib_op_loader  # pylint: disable=unused-import
+from tensorflow.contrib.data.python.ops import gen_dataset_ops as contrib_gen_dataset_ops
 from tensorflow.python.data.ops import dataset_ops
 from tensorflow.python.data.util import random_seed
 from tensorflow.python.framework import constant_op
@@ -70,6 +72,54 @@ class _ShuffleAndRepeatDataset(dataset_ops.Dataset):
     return self._input_dataset.output_types
 
 
+class _SpillingShuffleDataset(dataset_ops.Dataset):
+  """A `Dataset` that shuffles with a buffer that is partly kept on disk."""
+
+  def __init__(self,
+               input_dataset,
+               buffer_size,
+               memory_buffer_size,
+               spill_directory=None,
+               seed=None):
+    """See `spilling_shuffle()` for details."""
+    super(_SpillingShuffleDataset, self).__init__()
+    self._input_dataset = input_dataset
+    self._buffer_size = ops.convert_to_tensor(
+        buffer_size, dtype=dtypes.int64, name="buffer_size")
+    self._memory_buffer_size = ops.convert_to_tensor(
+        memory_buffer_size, dtype=dtypes.int64, name="memory_buffer_size")
+    self._spill_directory = ops.convert_to_tensor(
+        "" if spill_directory is None else spill_directory,
+        dtype=dtypes.string,
+        name="spill_directory")
+    self._seed, self._seed2 = random_seed.get_seed(seed)
+
+  def _as_variant_tensor(self):
+    # pylint: disable=protected-access
+    input_resource = self._input_dataset._as_variant_tensor()
+    return contrib_gen_dataset_ops.spilling_shuffle_dataset(
+        input_resource,
+        buffer_size=self._buffer_size,
+        memory_buffer_size=self._memory_buffer_size,
+        seed=self._seed,
+        seed2=self._seed2,
+        spill_directory=self._spill_directory,
+        **dataset_ops.flat_structure(self))
+    # pylint: enable=protected-access
+
+  @property
+  def output_classes(self):
+    return self._input_dataset.output_classes
+
+  @property
+  def output_shapes(self):
+    return self._input_dataset.output_shapes
+
+  @property
+  def output_types(self):
+    return self._input_dataset.output_types
+
+
 def shuffle_and_repeat(buffer_size, count=None, seed=None):
   """Shuffles and repeats a Dataset returning a new permutation for each epoch.
 
@@ -103,3 +153,50 @@ def shuffle_and_repeat(buffer_size, count=None, seed=None):
     return _ShuffleAndRepeatDataset(dataset, buffer_size, count, seed)
 
   return _apply_fn
+
+
+def spilling_shuffle(buffer_size,
+                     memory_buffer_size,
+                     spill_directory=None,
+                     seed=None):
+  """Shuffles a Dataset with a buffer that does not have to fit in memory.
+
+  `dataset.apply(tf.contrib.data.spilling_shuffle(buffer_size, n))`
+
+  produces elements in the same distribution as
+
+  `dataset.shuffle(buffer_size, reshuffle_each_iteration=False)`
+
+  but holds at most `n` of the buffered elements in memory. Whenever `n`
+  elements are buffered in memory, they are shuffled and written to a
+  compressed file in `spill_directory`, from which they are later read back
+  sequentially. This allows a large `buffer_size` for datasets with large
+  elements.
+
+  Saving the iterator does not copy the spilled elements into the checkpoint:
+  the checkpoint refers to the files in `spill_directory`, which are kept until
+  the iterator saves a checkpoint that no longer refers to them. Therefore only
+  the last checkpoint of the iterator can be restored.
+
+  Args:
+    buffer_size: A `tf.int64` scalar `tf.Tensor`, representing the number of
+      elements from which the next element is sampled.
+    memory_buffer_size: A `tf.int64` scalar `tf.Tensor`, representing the
+      maximum number of buffered elements that are held in memory.
+    spill_directory: (Optional.) A `tf.string` scalar `tf.Tensor`, representing
+      the directory in which the buffered elements are spilled. Defaults to a
+      local temporary directory.
+    seed: (Optional.) A `tf.int64` scalar `tf.Tensor`, representing the
+      random seed that will be used to create the distribution. See
+      @{tf.set_random_seed} for behavior.
+
+  Returns:
+    A `Dataset` transformation function, which can be passed to
+    @{tf.data.Dataset.apply}.
+  """
+
+  def _apply_fn(dataset):  # pylint: disable=missing-docstring
+    return _SpillingShuffleDataset(dataset, buffer_size, memory_buffer_size,
+                                   spill_directory, seed)
+
+  return _apply_fn
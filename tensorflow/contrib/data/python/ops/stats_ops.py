@@ -53,6 +53,15 @@ class StatsAggregator(object):
     sess.run(set_op)
   ```
 
+  In addition, every stage of the pipeline before a `set_stats_aggregator`
+  transformation records histograms of the latency (in microseconds), the
+  time spent waiting for its inputs (in microseconds) and the bytes of each
+  element it produces, under the tags `"<stage>::latency"`,
+  `"<stage>::input_time"` and `"<stage>::bytes_produced"`, where `<stage>` is
+  the name of the stage, e.g. `"Iterator::SetStatsAggregator::Prefetch::Map"`.
+  Stages that buffer elements, such as `prefetch`, also record the number of
+  buffered elements under `"<stage>::buffered_elements"`.
+
   To get a protocol buffer summary of the currently aggregated statistics,
   use the `StatsAggregator.get_summary()` tensor. The easiest way to do this
   is to add the returned tensor to the @{tf.GraphKeys.SUMMARIES} collection,
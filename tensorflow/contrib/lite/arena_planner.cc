@@ -13,6 +13,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 #include "tensorflow/contrib/lite/arena_planner.h"
+#include <algorithm>
 #include <utility>
 
 namespace tflite {
@@ -50,6 +51,37 @@ int64_t ArenaPlanner::BasePointer(TfLiteAllocationType type) {
   return 0;
 }
 
+void ArenaPlanner::SetNodeWaves(const std::vector<int>& node_waves) {
+  first_node_of_wave_.resize(node_waves.size());
+  for (int i = 0; i < node_waves.size(); ++i) {
+    const bool same_wave = i > 0 && node_waves[i] == node_waves[i - 1];
+    first_node_of_wave_[i] = same_wave ? first_node_of_wave_[i - 1] : i;
+  }
+}
+
+int ArenaPlanner::FirstNodeOfWave(int node_index) const {
+  if (node_index >= first_node_of_wave_.size()) return node_index;
+  return first_node_of_wave_[node_index];
+}
+
+bool ArenaPlanner::IsLastNodeOfWave(int node_index) const {
+  return node_index + 1 >= first_node_of_wave_.size() ||
+         first_node_of_wave_[node_index + 1] == node_index + 1;
+}
+
+int ArenaPlanner::LastNodeOfWave(int node_index) const {
+  while (!IsLastNodeOfWave(node_index)) {
+    ++node_index;
+  }
+  return node_index;
+}
+
+void ArenaPlanner::GetAllocInfo(size_t* arena_size,
+                                size_t* arena_persist_size) const {
+  *arena_size = arena_.high_water_mark();
+  *arena_persist_size = persistent_arena_.high_water_mark();
+}
+
 TfLiteStatus ArenaPlanner::ResetAllocations() {
   TF_LITE_ENSURE_STATUS(arena_.Clear());
   TF_LITE_ENSURE_STATUS(persistent_arena_.Clear());
@@ -147,6 +179,10 @@ TfLiteStatus ArenaPlanner::PlanAllocations() {
       TF_LITE_ENSURE_STATUS(allocate(0, tensor_index));
     }
   }
+  // Tensors that are no longer needed, but may still be read by other nodes
+  // of the current wave.
+  std::vector<int> pending_deallocations;
+
   // Go through the graph in execution order.
   for (int i = 0; i < graph_info_->num_nodes(); ++i) {
     const TfLiteNode& node = graph_info_->node(i);
@@ -167,11 +203,20 @@ TfLiteStatus ArenaPlanner::PlanAllocations() {
         if (tensor_index != kOptionalTensor) {
           refcounts[tensor_index]--;
           if (refcounts[tensor_index] == 0) {
-            TF_LITE_ENSURE_STATUS(deallocate(i, tensor_index));
+            pending_deallocations.push_back(tensor_index);
           }
         }
       }
     }
+
+    // Nothing is released before the whole wave is done with it, so that
+    // the outputs of a wave never share memory with its inputs.
+    if (IsLastNodeOfWave(i)) {
+      for (int tensor_index : pending_deallocations) {
+        TF_LITE_ENSURE_STATUS(deallocate(i, tensor_index));
+      }
+      pending_deallocations.clear();
+    }
   }
 
   // Note that graph outputs will never be scheduled for deallocation. We
@@ -185,7 +230,15 @@ TfLiteStatus ArenaPlanner::ExecuteAllocations(int first_node, int last_node) {
   TF_LITE_ENSURE(context_, graph_info_->num_tensors() >= allocs_.size());
   allocs_.resize(graph_info_->num_tensors());
 
-  TF_LITE_ENSURE_STATUS(CalculateAllocations(first_node, last_node));
+  // The whole graph can only be planned at once if all tensor sizes are known,
+  // i.e. if there are no dynamic tensors that make the interpreter prepare and
+  // allocate the graph in several steps.
+  if (strategy_ == ArenaPlanningStrategy::kLargestFirst && first_node == 0 &&
+      last_node + 1 >= graph_info_->num_nodes()) {
+    TF_LITE_ENSURE_STATUS(CalculateAllocationsLargestFirst());
+  } else {
+    TF_LITE_ENSURE_STATUS(CalculateAllocations(first_node, last_node));
+  }
   TF_LITE_ENSURE_STATUS(Commit());
 
   for (int i = 0; i < graph_info_->num_tensors(); ++i) {
@@ -214,12 +267,16 @@ TfLiteStatus ArenaPlanner::CalculateAllocations(int first_node, int last_node) {
   for (const auto& alloc_info : alloc_queue_) {
     if (alloc_info.node < first_node) continue;
     if (alloc_info.node > last_node) break;
-    if (alloc_info.node == active_node) {
+    while (alloc_info.node >= active_node) {
       // This is the first allocation/deallocation for a given node.  It is
       // time to deallocate the previous temporaries and allocate new ones.
-      if (active_node != first_node) {
-        TF_LITE_ENSURE_STATUS(
-            CalculateDeallocationOfInternalTensors(active_node - 1));
+      // The temporaries of a wave are kept until all of its nodes have theirs.
+      if (active_node != first_node &&
+          FirstNodeOfWave(active_node) == active_node) {
+        for (int node = std::max(first_node, FirstNodeOfWave(active_node - 1));
+             node < active_node; ++node) {
+          TF_LITE_ENSURE_STATUS(CalculateDeallocationOfInternalTensors(node));
+        }
       }
       TF_LITE_ENSURE_STATUS(CalculateAllocationOfInternalTensors(active_node));
       ++active_node;
@@ -232,10 +289,87 @@ TfLiteStatus ArenaPlanner::CalculateAllocations(int first_node, int last_node) {
     }
   }
 
-  // Don't forget to deallocate temporaries of last node.
-  TF_LITE_ENSURE_STATUS(
-      CalculateDeallocationOfInternalTensors(active_node - 1));
+  // Don't forget to deallocate temporaries of the last wave.
+  if (active_node != first_node) {
+    for (int node = std::max(first_node, FirstNodeOfWave(active_node - 1));
+         node < active_node; ++node) {
+      TF_LITE_ENSURE_STATUS(CalculateDeallocationOfInternalTensors(node));
+    }
+  }
+
+  return kTfLiteOk;
+}
+
+TfLiteStatus ArenaPlanner::CalculateAllocationsLargestFirst() {
+  const int num_tensors = graph_info_->num_tensors();
+  const int num_nodes = graph_info_->num_nodes();
+
+  // The first and last node that use each tensor. Tensors that are never
+  // deallocated stay in use until the end.
+  std::vector<int> first_use(num_tensors, -1);
+  std::vector<int> last_use(num_tensors, num_nodes);
+  for (const auto& alloc_info : alloc_queue_) {
+    if (alloc_info.type == AllocationInfo::ALLOC) {
+      first_use[alloc_info.tensor] = alloc_info.node;
+    } else {
+      last_use[alloc_info.tensor] = alloc_info.node;
+    }
+  }
+  for (int i = 0; i < num_nodes; ++i) {
+    const TfLiteIntArray* node_temporaries = graph_info_->node(i).temporaries;
+    for (int j = 0; j < node_temporaries->size; ++j) {
+      int tensor_index = node_temporaries->data[j];
+      first_use[tensor_index] = FirstNodeOfWave(i);
+      last_use[tensor_index] = LastNodeOfWave(i);
+    }
+  }
 
+  std::vector<int> tensors_to_place;
+  for (int i = 0; i < num_tensors; ++i) {
+    if (first_use[i] < 0) continue;
+    TfLiteTensor& tensor = *graph_info_->tensor(i);
+    if (tensor.allocation_type == kTfLiteArenaRwPersistent) {
+      TF_LITE_ENSURE_STATUS(CalculateTensorAllocation(i));
+    } else if (tensor.allocation_type == kTfLiteArenaRw) {
+      allocs_[i].offset = 0;
+      allocs_[i].size = tensor.bytes;
+      if (tensor.bytes > 0) {
+        tensors_to_place.push_back(i);
+      }
+    }
+  }
+  std::stable_sort(tensors_to_place.begin(), tensors_to_place.end(),
+                   [this](int a, int b) {
+                     return allocs_[a].size > allocs_[b].size;
+                   });
+
+  auto align = [this](size_t offset) {
+    return (offset + tensor_alignment_ - 1) / tensor_alignment_ *
+           tensor_alignment_;
+  };
+  size_t arena_size = 0;
+  // The tensors placed so far, ordered by offset.
+  std::vector<int> placed;
+  placed.reserve(tensors_to_place.size());
+  for (int i : tensors_to_place) {
+    size_t offset = 0;
+    for (int j : placed) {
+      if (last_use[i] < first_use[j] || last_use[j] < first_use[i]) {
+        continue;
+      }
+      if (offset + allocs_[i].size <= allocs_[j].offset) {
+        break;
+      }
+      offset = std::max(offset, align(allocs_[j].offset + allocs_[j].size));
+    }
+    allocs_[i].offset = offset;
+    arena_size = std::max(arena_size, offset + allocs_[i].size);
+    auto it = std::upper_bound(
+        placed.begin(), placed.end(), offset,
+        [this](size_t offset, int j) { return offset < allocs_[j].offset; });
+    placed.insert(it, i);
+  }
+  arena_.Reserve(arena_size);
   return kTfLiteOk;
 }
 
@@ -31,6 +31,19 @@ constexpr const int kDefaultTensorAlignment = 64;
 
 struct AllocationInfo;
 
+// How an ArenaPlanner chooses the offsets of tensors in the arena.
+enum class ArenaPlanningStrategy {
+  // Tensors are placed one at a time in execution order, each in the smallest
+  // gap that fits between the tensors still in use.
+  kExecutionOrder,
+  // Once the sizes of all tensors are known, the largest tensors are placed
+  // first, each at the lowest offset that doesn't overlap a tensor in use at
+  // the same time. This avoids most of the fragmentation left by
+  // kExecutionOrder. Graphs with dynamic tensors, whose sizes are only known
+  // as the graph runs, are planned in execution order.
+  kLargestFirst,
+};
+
 // A memory planner that makes all the allocations using arenas.
 //
 // Before a model is executed by the interpreter, this class determines when
@@ -60,10 +73,22 @@ class ArenaPlanner : public MemoryPlanner {
   TfLiteStatus ResetAllocations() override;
   TfLiteStatus PlanAllocations() override;
   TfLiteStatus ExecuteAllocations(int first_node, int last_node) override;
+  void GetAllocInfo(size_t* arena_size,
+                    size_t* arena_persist_size) const override;
 
   // Returns the base arena location for a given allocation type.
   int64_t BasePointer(TfLiteAllocationType type);
 
+  // Plans for the nodes of each wave to run concurrently. `node_waves` holds
+  // the wave of each node in execution order and must be non-decreasing. The
+  // tensors used by the nodes of a wave, temporaries included, are then never
+  // assigned overlapping memory. Must be called before PlanAllocations(); by
+  // default every node is a wave of its own.
+  void SetNodeWaves(const std::vector<int>& node_waves);
+
+  // Sets how offsets are chosen in subsequent calls to ExecuteAllocations().
+  void SetStrategy(ArenaPlanningStrategy strategy) { strategy_ = strategy; }
+
  private:
   // Make sure all the arenas have reserved enough memory to store all their
   // tensors.
@@ -73,6 +98,10 @@ class ArenaPlanner : public MemoryPlanner {
   // for all tensors affected by ops in the interval [first_node, last_node].
   TfLiteStatus CalculateAllocations(int first_node, int last_node);
 
+  // Reserve space for all the tensors of the graph at once, placing the
+  // largest tensors first.
+  TfLiteStatus CalculateAllocationsLargestFirst();
+
   // Assign absolute memory location to a tensor, based on its relative
   // position inside the corresponding arena buffer.
   TfLiteStatus ResolveTensorAllocation(int tensor_index);
@@ -91,6 +120,15 @@ class ArenaPlanner : public MemoryPlanner {
   // 'node_index'.
   TfLiteStatus CalculateDeallocationOfInternalTensors(int node_index);
 
+  // Returns the first node of the wave that 'node_index' belongs to.
+  int FirstNodeOfWave(int node_index) const;
+
+  // Returns true if 'node_index' is the last node of its wave.
+  bool IsLastNodeOfWave(int node_index) const;
+
+  // Returns the last node of the wave that 'node_index' belongs to.
+  int LastNodeOfWave(int node_index) const;
+
   TfLiteContext* context_;
   std::unique_ptr<GraphInfo> graph_info_;
 
@@ -120,6 +158,12 @@ class ArenaPlanner : public MemoryPlanner {
 
   // Number of bytes that tensor buffers should be aligned to.
   int tensor_alignment_;
+
+  ArenaPlanningStrategy strategy_ = ArenaPlanningStrategy::kExecutionOrder;
+
+  // The first node of the wave of each node, or empty if every node is a wave
+  // of its own.
+  std::vector<int> first_node_of_wave_;
 };
 
 }  // namespace tflite
@@ -153,12 +153,14 @@ void ReportError(TfLiteContext* context, const char* format, ...) {
 
 class ArenaPlannerTest : public ::testing::Test {
  protected:
-  void SetGraph(TestGraph* graph, bool preserve_inputs = false) {
+  void SetGraph(TestGraph* graph, bool preserve_inputs = false,
+                const std::vector<int>& node_waves = {}) {
     graph_ = graph;
     context_.ReportError = ReportError;
     planner_.reset(new ArenaPlanner(
         &context_, std::unique_ptr<GraphInfo>(new TestGraphInfo(graph)),
         preserve_inputs, /*preserve intermediates*/ false, kTensorAlignment));
+    planner_->SetNodeWaves(node_waves);
     CHECK(planner_->ResetAllocations() == kTfLiteOk);
     CHECK(planner_->PlanAllocations() == kTfLiteOk);
   }
@@ -186,6 +188,19 @@ class ArenaPlannerTest : public ::testing::Test {
     return offset;
   };
 
+  // Returns true if no two of the given tensors share memory.
+  bool Disjoint(const std::vector<int>& tensor_indices) {
+    for (int a : tensor_indices) {
+      for (int b : tensor_indices) {
+        if (a != b && GetOffset(a) < GetOffsetAfter(b) &&
+            GetOffset(b) < GetOffsetAfter(a)) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
   TfLiteContext context_;
   TestGraph* graph_;
   std::unique_ptr<ArenaPlanner> planner_;
@@ -493,6 +508,88 @@ TEST_F(ArenaPlannerTest, LargerGraphAndStepwiseAllocation) {
   EXPECT_EQ(GetOffset(10), 0);
 }
 
+TEST_F(ArenaPlannerTest, LargestFirst) {
+  // Same graph as in LargerGraphAndStepwiseAllocation.
+  TestGraph graph({0, 1},
+                  {
+                      /* in, out, tmp */
+                      {{0, 1}, {2, 3}, {}},
+                      {{2, 0}, {4, 5}, {6}},
+                      {{1, -1}, {7}, {}},
+                      {{7, 3}, {8}, {9}},
+                      {{4, 5, 8}, {10}, {}},
+                  },
+                  {10});
+  SetGraph(&graph);
+  Execute(0, 10);
+  size_t execution_order_size, persistent_size;
+  planner_->GetAllocInfo(&execution_order_size, &persistent_size);
+  EXPECT_EQ(persistent_size, 0);
+
+  planner_->SetStrategy(ArenaPlanningStrategy::kLargestFirst);
+  CHECK(planner_->ResetAllocations() == kTfLiteOk);
+  Execute(0, 10);
+  size_t largest_first_size;
+  planner_->GetAllocInfo(&largest_first_size, &persistent_size);
+  // 136 bytes instead of 155.
+  EXPECT_LT(largest_first_size, execution_order_size);
+
+  // Tensors in use at the same time by each op don't overlap.
+  EXPECT_TRUE(Disjoint({0, 1, 2, 3}));
+  EXPECT_TRUE(Disjoint({0, 1, 2, 3, 4, 5, 6}));
+  EXPECT_TRUE(Disjoint({1, 3, 4, 5, 7}));
+  EXPECT_TRUE(Disjoint({3, 4, 5, 7, 8, 9}));
+  EXPECT_TRUE(Disjoint({4, 5, 8, 10}));
+  // The largest tensor goes first.
+  EXPECT_EQ(GetOffset(10), 0);
+}
+
+TEST_F(ArenaPlannerTest, LargestFirstFallsBackForStepwiseAllocation) {
+  TestGraph graph({0, 1},
+                  {
+                      /* in, out, tmp */
+                      {{0, 1}, {2}, {}},     // First op
+                      {{2, 0}, {4, 5}, {}},  // Second op
+                      {{4, 5}, {3}, {}}      // Third op
+                  },
+                  {3});
+  SetGraph(&graph);
+  planner_->SetStrategy(ArenaPlanningStrategy::kLargestFirst);
+  // Same as in SimpleGraph, one op at a time.
+  Execute(0, 0);
+  Execute(1, 1);
+  Execute(2, 2);
+  EXPECT_EQ(GetOffset(0), 0);
+  EXPECT_EQ(GetOffset(1), GetOffsetAfter(0));
+  EXPECT_EQ(GetOffset(2), GetOffsetAfter(1));
+  EXPECT_EQ(GetOffset(4), GetOffsetAfter(2));
+  EXPECT_EQ(GetOffset(5), GetOffsetAfter(4));
+  EXPECT_EQ(GetOffset(3), 0);
+}
+
+TEST_F(ArenaPlannerTest, GraphWithWaves) {
+  TestGraph graph({0},
+                  {
+                      /* in, out, tmp */
+                      {{0}, {1}, {2}},    // Wave 0
+                      {{0}, {3}, {4}},    // Wave 0
+                      {{1}, {5}, {}},     // Wave 1
+                      {{3}, {6}, {}},     // Wave 1
+                      {{5, 6}, {7}, {}},  // Wave 2
+                  },
+                  {7});
+  SetGraph(&graph, /*preserve_inputs=*/false, {0, 0, 1, 1, 2});
+  Execute(0, 10);
+
+  // Alloc(+) and dealloc(-) order: +0 +2 +1 +4 +3 -0 -2 -4 +5 +6 -1 -3 +7 -5
+  // -6. Every tensor used by a wave is live until the whole wave is done.
+  EXPECT_TRUE(Disjoint({0, 1, 2, 3, 4}));
+  EXPECT_TRUE(Disjoint({1, 3, 5, 6}));
+  EXPECT_TRUE(Disjoint({5, 6, 7}));
+  // Memory is still reused across waves.
+  EXPECT_EQ(GetOffset(7), 0);
+}
+
 }  // namespace
 }  // namespace tflite
 
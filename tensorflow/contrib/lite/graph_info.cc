@@ -221,4 +221,51 @@ TfLiteStatus PartitionGraphIntoIndependentSubgraphs(
   return kTfLiteOk;
 }
 
+void AssignNodesToWaves(const GraphInfo* info, std::vector<int>* node_waves) {
+  const int num_tensors = info->num_tensors();
+  // The last wave that wrote each tensor, and the last wave that read it since
+  // then, or -1.
+  std::vector<int> last_write(num_tensors, -1);
+  std::vector<int> last_read(num_tensors, -1);
+  std::vector<int> is_variable(num_tensors, false);
+  for (int tensor_index : info->variables()) {
+    is_variable[tensor_index] = true;
+  }
+
+  node_waves->assign(info->num_nodes(), 0);
+  for (int i = 0; i < info->num_nodes(); ++i) {
+    const TfLiteNode& node = info->node(i);
+    int wave = 0;
+    for (int tensor_index : TfLiteIntArrayView(node.inputs)) {
+      if (tensor_index == kOptionalTensor) continue;
+      wave = std::max(wave, last_write[tensor_index] + 1);
+      if (is_variable[tensor_index]) {
+        wave = std::max(wave, last_read[tensor_index] + 1);
+      }
+    }
+    for (int tensor_index : TfLiteIntArrayView(node.outputs)) {
+      if (tensor_index == kOptionalTensor) continue;
+      const int last_use =
+          std::max(last_write[tensor_index], last_read[tensor_index]);
+      wave = std::max(wave, last_use + 1);
+    }
+    (*node_waves)[i] = wave;
+
+    for (int tensor_index : TfLiteIntArrayView(node.inputs)) {
+      if (tensor_index == kOptionalTensor) continue;
+      if (is_variable[tensor_index]) {
+        last_write[tensor_index] = wave;
+        last_read[tensor_index] = -1;
+      } else {
+        last_read[tensor_index] = std::max(last_read[tensor_index], wave);
+      }
+    }
+    for (int tensor_index : TfLiteIntArrayView(node.outputs)) {
+      if (tensor_index == kOptionalTensor) continue;
+      last_write[tensor_index] = wave;
+      last_read[tensor_index] = -1;
+    }
+  }
+}
+
 }  // namespace tflite
@@ -77,6 +77,15 @@ TfLiteStatus PartitionGraphIntoIndependentSubgraphs(
     const GraphInfo* info, const TfLiteIntArray* nodes_to_partition,
     std::vector<Subgraph>* subgraphs);
 
+// Groups the nodes of `info`, which are expected to be in a valid execution
+// order, into waves such that each node only depends on nodes of earlier
+// waves: a node comes after every node that wrote one of the tensors it reads
+// and after every node that read or wrote one of the tensors it writes.
+// Variable inputs are assumed to be updated by the node that reads them. The
+// nodes of a wave can therefore run concurrently once the earlier waves are
+// done. `node_waves` is filled with the wave of each node, starting at 0.
+void AssignNodesToWaves(const GraphInfo* info, std::vector<int>* node_waves);
+
 }  // namespace tflite
 
 #endif  // TENSORFLOW_CONTRIB_LITE_GRAPH_INFO_H_
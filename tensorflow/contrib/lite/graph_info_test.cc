@@ -63,6 +63,10 @@ class SimpleTestGraph : public GraphInfo {
     outputs_ = outputs;
   }
 
+  void SetVariables(const std::vector<int>& variables) {
+    variables_ = variables;
+  }
+
  private:
   std::vector<TfLiteNode> nodes_;
   std::vector<TfLiteTensor> tensors_;
@@ -262,6 +266,61 @@ TEST(PartitionTest, Nodes3PartitionNodes2) {
       {expected_subgraph0, expected_subgraph1, expected_subgraph2});
 }
 
+// Test two independent chains, which can run side by side.
+// Input: tensor(0) -> node(0) -> tensor(1) -> node(1) -> tensor(2)
+//        tensor(0) -> node(2) -> tensor(3) -> node(3) -> tensor(4)
+//        tensor(2), tensor(4) -> node(4) -> tensor(5)
+// Output: waves [0, 1, 0, 1, 2]
+TEST(WavesTest, IndependentChains) {
+  SimpleTestGraph graph;
+  graph.AddTensors(6);
+  graph.AddNode({0}, {1});
+  graph.AddNode({1}, {2});
+  graph.AddNode({0}, {3});
+  graph.AddNode({3}, {4});
+  graph.AddNode({2, 4}, {5});
+  graph.SetInputsAndOutputs({0}, {5});
+  std::vector<int> waves;
+  AssignNodesToWaves(&graph, &waves);
+  EXPECT_EQ(waves, std::vector<int>({0, 1, 0, 1, 2}));
+}
+
+// Test that a node that overwrites a tensor waits for its readers.
+// Input: tensor(0) -> node(0) -> tensor(1) -> node(1) -> tensor(2)
+//        tensor(0) -> node(2) -> tensor(1)
+// Output: waves [0, 1, 2]
+TEST(WavesTest, WriteAfterRead) {
+  SimpleTestGraph graph;
+  graph.AddTensors(3);
+  graph.AddNode({0}, {1});
+  graph.AddNode({1}, {2});
+  graph.AddNode({0}, {1});
+  graph.SetInputsAndOutputs({0}, {1, 2});
+  std::vector<int> waves;
+  AssignNodesToWaves(&graph, &waves);
+  EXPECT_EQ(waves, std::vector<int>({0, 1, 2}));
+}
+
+// Test that nodes sharing a variable tensor are serialized, since each of them
+// may update it.
+// Input: tensor(0), tensor(1) -> node(0) -> tensor(2)
+//        tensor(0), tensor(1) -> node(1) -> tensor(3)
+//        tensor(0) -> node(2) -> tensor(4)
+// where tensor(1) is a variable.
+// Output: waves [0, 1, 0]
+TEST(WavesTest, VariablesAreSerialized) {
+  SimpleTestGraph graph;
+  graph.AddTensors(5);
+  graph.AddNode({0, 1}, {2});
+  graph.AddNode({0, 1}, {3});
+  graph.AddNode({0}, {4});
+  graph.SetInputsAndOutputs({0}, {2, 3, 4});
+  graph.SetVariables({1});
+  std::vector<int> waves;
+  AssignNodesToWaves(&graph, &waves);
+  EXPECT_EQ(waves, std::vector<int>({0, 1, 0}));
+}
+
 }  // namespace
 }  // namespace tflite
 
@@ -15,10 +15,12 @@ limitations under the License.
 
 #include "tensorflow/contrib/lite/interpreter.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdarg>
 #include <cstdint>
 #include <cstring>
+#include <numeric>
 
 #include "tensorflow/contrib/lite/arena_planner.h"
 #include "tensorflow/contrib/lite/context.h"
@@ -31,11 +33,15 @@ limitations under the License.
 #endif
 #include "tensorflow/contrib/lite/profiling/profiler.h"
 #include "tensorflow/contrib/lite/schema/schema_generated.h"
+#ifndef TFLITE_MCU
+#include "tensorflow/contrib/lite/thread_pool.h"
+#endif
 #include "tensorflow/contrib/lite/util.h"
 
 namespace tflite {
 #ifdef TFLITE_MCU
 class NNAPIDelegate {};
+class ThreadPool {};
 #endif
 
 namespace {
@@ -80,6 +86,16 @@ bool HasDynamicTensorImpl(const TfLiteContext& context,
   return false;
 }
 
+// Returns true if at least one tensor of the graph is kTfLiteDynamic.
+bool HasDynamicTensors(const TfLiteContext& context) {
+  for (int i = 0; i < context.tensors_size; ++i) {
+    if (context.tensors[i].allocation_type == kTfLiteDynamic) {
+      return true;
+    }
+  }
+  return false;
+}
+
 }  // namespace
 
 // A trivial implementation of GraphInfo around the Interpreter.
@@ -263,6 +279,7 @@ TfLiteStatus Interpreter::ReplaceSubgraphsWithDelegateKernels(
   PartitionGraphIntoIndependentSubgraphs(&info, nodes_to_replace, &subgraphs);
 
   execution_plan_.clear();
+  InvalidateWaves();
   for (auto& subgraph : subgraphs) {
     // Subgraphs calimed by the delegate should have a "macro" op created, the
     // other subgraphs (kTfNonPartition) just have their nodes added back to
@@ -540,6 +557,7 @@ TfLiteStatus Interpreter::AddNodeWithParameters(
   node.delegate = nullptr;
   node_and_reg.second = *registration;
   execution_plan_.push_back(new_node_index);
+  InvalidateWaves();
   return kTfLiteOk;
 }
 
@@ -598,11 +616,57 @@ TfLiteStatus Interpreter::PrepareOpsStartingAt(
   return kTfLiteOk;
 }
 
+void Interpreter::PlanWaves(std::vector<int>* node_waves) {
+  node_waves->clear();
+  wave_starts_.clear();
+  for (int node_index : execution_plan_) {
+    if (nodes_and_registration_[node_index].first.delegate != nullptr) {
+      return;
+    }
+  }
+
+  InterpreterInfo info(this);
+  std::vector<int> waves;
+  AssignNodesToWaves(&info, &waves);
+  std::vector<int> order(execution_plan_.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&waves](int a, int b) { return waves[a] < waves[b]; });
+
+  std::vector<int> new_plan;
+  for (int i : order) {
+    if (node_waves->empty() || waves[i] != node_waves->back()) {
+      wave_starts_.push_back(new_plan.size());
+    }
+    new_plan.push_back(execution_plan_[i]);
+    node_waves->push_back(waves[i]);
+  }
+  wave_starts_.push_back(new_plan.size());
+  execution_plan_ = new_plan;
+}
+
+void Interpreter::InvalidateWaves() {
+  if (!parallel_execution_) return;
+  // Both the waves and the memory plan are made again by AllocateTensors().
+  wave_starts_.clear();
+  memory_planner_.reset();
+  state_ = kStateUninvokable;
+}
+
 TfLiteStatus Interpreter::PrepareOpsAndTensors() {
   if (!memory_planner_) {
-    memory_planner_.reset(new ArenaPlanner(
+    ArenaPlanner* planner = new ArenaPlanner(
         &context_, std::unique_ptr<GraphInfo>(new InterpreterInfo(this)),
-        /*preserve_inputs=*/true, /*preserve_intermediates*/ false));
+        /*preserve_inputs=*/true, /*preserve_intermediates*/ false);
+    memory_planner_.reset(planner);
+    if (largest_first_memory_planning_) {
+      planner->SetStrategy(ArenaPlanningStrategy::kLargestFirst);
+    }
+    if (parallel_execution_) {
+      std::vector<int> node_waves;
+      PlanWaves(&node_waves);
+      planner->SetNodeWaves(node_waves);
+    }
     memory_planner_->PlanAllocations();
   }
 
@@ -644,6 +708,28 @@ TfLiteStatus Interpreter::Invoke() {
   }
 #endif
 
+  // Nodes only run concurrently when no tensor is dynamic: the nodes that
+  // follow a dynamic tensor need to be prepared again whenever it is resized,
+  // which can't be done in parallel.
+  if (!wave_starts_.empty() && profiler_ == nullptr &&
+      next_execution_plan_index_to_prepare_ == execution_plan_.size() &&
+      !HasDynamicTensors(context_)) {
+    status = InvokeWaves();
+  } else {
+    status = InvokeSequentially();
+  }
+
+  if (!allow_buffer_handle_output_) {
+    for (int tensor_index : outputs_) {
+      EnsureTensorDataIsReadable(tensor_index);
+    }
+  }
+
+  return status;
+}
+
+TfLiteStatus Interpreter::InvokeSequentially() {
+  TfLiteStatus status = kTfLiteOk;
   // Invocations are always done in node order.
   // Note that calling Invoke repeatedly will cause the original memory plan to
   // be reused, unless either ResizeInputTensor() or AllocateTensors() has been
@@ -694,14 +780,61 @@ TfLiteStatus Interpreter::Invoke() {
       next_execution_plan_index_to_prepare_ = execution_plan_index + 1;
     }
   }
+  return status;
+}
 
-  if (!allow_buffer_handle_output_) {
-    for (int tensor_index : outputs_) {
-      EnsureTensorDataIsReadable(tensor_index);
+TfLiteStatus Interpreter::InvokeWaves() {
+#ifndef TFLITE_MCU
+  if (!thread_pool_) {
+    int num_threads = context_.recommended_num_threads;
+    if (num_threads <= 0) {
+      num_threads = std::max<int>(std::thread::hardware_concurrency(), 1);
     }
+    thread_pool_.reset(new ThreadPool(num_threads));
   }
 
+  TfLiteStatus status = kTfLiteOk;
+  std::vector<TfLiteStatus> node_status;
+  EnsureTensorsVectorCapacity();
+  for (int wave = 0; wave + 1 < wave_starts_.size(); ++wave) {
+    const int first_execution_plan_index = wave_starts_[wave];
+    const int num_nodes = wave_starts_[wave + 1] - first_execution_plan_index;
+    for (int i = 0; i < num_nodes; ++i) {
+      int node_index = execution_plan_[first_execution_plan_index + i];
+      const TfLiteNode& node = nodes_and_registration_[node_index].first;
+      for (int tensor_index : TfLiteIntArrayView(node.inputs)) {
+        if (tensor_index == kOptionalTensor) {
+          continue;
+        }
+        if (tensors_[tensor_index].data_is_stale) {
+          EnsureTensorDataIsReadable(tensor_index);
+        }
+      }
+    }
+
+    node_status.assign(num_nodes, kTfLiteOk);
+    thread_pool_->ParallelFor(num_nodes, [&](int i) {
+      int node_index = execution_plan_[first_execution_plan_index + i];
+      auto& node_and_registration = nodes_and_registration_[node_index];
+      node_status[i] = OpInvoke(node_and_registration.second,
+                                &node_and_registration.first);
+    });
+
+    // Errors are reported from this thread, in execution plan order.
+    for (int i = 0; i < num_nodes; ++i) {
+      if (node_status[i] == kTfLiteError) {
+        int node_index = execution_plan_[first_execution_plan_index + i];
+        const auto& node_and_registration = nodes_and_registration_[node_index];
+        status = ReportOpError(&context_, node_and_registration.first,
+                               node_and_registration.second, node_index,
+                               "failed to invoke");
+      }
+    }
+  }
   return status;
+#else
+  return InvokeSequentially();
+#endif
 }
 
 TfLiteStatus Interpreter::ResizeTensor(TfLiteContext* context,
@@ -859,6 +992,7 @@ TfLiteStatus Interpreter::SetExecutionPlan(const std::vector<int>& new_plan) {
     TF_LITE_ENSURE(&context_, node_index >= 0 && node_index < nodes_size());
   }
   execution_plan_ = new_plan;
+  InvalidateWaves();
   return kTfLiteOk;
 }
 
@@ -915,6 +1049,7 @@ void Interpreter::UseNNAPI(bool enable) {
 
 void Interpreter::SetNumThreads(int num_threads) {
   context_.recommended_num_threads = num_threads;
+  thread_pool_.reset();
 
   for (int i = 0; i < kTfLiteMaxExternalContexts; ++i) {
     auto* c = external_contexts_[i];
@@ -924,6 +1059,55 @@ void Interpreter::SetNumThreads(int num_threads) {
   }
 }
 
+TfLiteStatus Interpreter::UseParallelExecution(bool enable) {
+#ifdef TFLITE_MCU
+  if (enable) {
+    ReportError(&context_, "Parallel execution is not supported.");
+    return kTfLiteError;
+  }
+#endif
+  if (enable == parallel_execution_) {
+    return kTfLiteOk;
+  }
+  if (state_ == kStateInvokableAndImmutable) {
+    ReportError(&context_,
+                "UseParallelExecution is disallowed when graph is immutable.");
+    return kTfLiteError;
+  }
+  parallel_execution_ = enable;
+  // The memory plan depends on the order the nodes run in.
+  memory_planner_.reset();
+  wave_starts_.clear();
+  thread_pool_.reset();
+  state_ = kStateUninvokable;
+  return kTfLiteOk;
+}
+
+TfLiteStatus Interpreter::UseLargestFirstMemoryPlanning(bool enable) {
+  if (enable == largest_first_memory_planning_) {
+    return kTfLiteOk;
+  }
+  if (state_ == kStateInvokableAndImmutable) {
+    ReportError(&context_,
+                "UseLargestFirstMemoryPlanning is disallowed when graph is "
+                "immutable.");
+    return kTfLiteError;
+  }
+  largest_first_memory_planning_ = enable;
+  memory_planner_.reset();
+  state_ = kStateUninvokable;
+  return kTfLiteOk;
+}
+
+void Interpreter::GetArenaSizes(size_t* arena_size,
+                                size_t* arena_persist_size) const {
+  *arena_size = 0;
+  *arena_persist_size = 0;
+  if (memory_planner_) {
+    memory_planner_->GetAllocInfo(arena_size, arena_persist_size);
+  }
+}
+
 TfLiteStatus Interpreter::ModifyGraphWithDelegate(TfLiteDelegate* delegate,
                                                   bool allow_dynamic_tensors) {
   if (!allow_dynamic_tensors) {
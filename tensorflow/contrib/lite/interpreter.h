@@ -71,6 +71,8 @@ constexpr TfLiteType typeToTfLiteType<string>() {
 // Forward declare since NNAPIDelegate uses Interpreter.
 class NNAPIDelegate;
 
+class ThreadPool;
+
 // An interpreter for a graph of nodes that input and output from tensors.
 // Each node of the graph processes a set of input tensors and produces a
 // set of output Tensors. All inputs/output tensors are referenced by index.
@@ -330,6 +332,29 @@ class Interpreter {
   // Set the number of threads available to the interpreter.
   void SetNumThreads(int num_threads);
 
+  // Enable or disable running independent nodes concurrently, on as many
+  // threads as set by SetNumThreads() (all cores by default). The execution
+  // plan is reordered into waves of nodes that don't depend on each other, and
+  // tensors used by the nodes of a wave never share memory. The ops of the
+  // graph must be safe to invoke concurrently. Graphs with delegated nodes or
+  // dynamic tensors, and runs with a profiler attached, still run one node at a
+  // time. Requires a call to AllocateTensors() before the next Invoke().
+  // WARNING: This is an experimental API and subject to change.
+  TfLiteStatus UseParallelExecution(bool enable);
+
+  // Enable or disable planning the memory of all tensors at once, placing the
+  // largest tensors first, instead of one tensor at a time in execution order.
+  // This usually leaves less of the arena unused. Graphs with dynamic tensors
+  // are still planned in execution order. Requires a call to AllocateTensors()
+  // before the next Invoke().
+  // WARNING: This is an experimental API and subject to change.
+  TfLiteStatus UseLargestFirstMemoryPlanning(bool enable);
+
+  // Get the number of bytes needed by the arena that holds intermediate
+  // tensors and by the one that holds persistent tensors, as planned so far.
+  // WARNING: This is an experimental API and subject to change.
+  void GetArenaSizes(size_t* arena_size, size_t* arena_persist_size) const;
+
   // Allow a delegate to look at the graph and modify the graph to handle
   // parts of the graph themselves. After this is called, the graph may
   // contain new nodes that replace 1 more nodes.
@@ -457,6 +482,22 @@ class Interpreter {
   TfLiteStatus PrepareOpsStartingAt(int first_execution_plan_index,
                                     int* last_execution_plan_index_prepared);
 
+  // Reorder the execution plan so that it runs in waves of independent nodes,
+  // filling 'node_waves' with the wave of each node of the new plan and
+  // 'wave_starts_' with the execution plan index of each wave. Leaves both
+  // empty if the graph can't run in parallel.
+  void PlanWaves(std::vector<int>* node_waves);
+
+  // Drop the waves planned for an execution plan that has since changed.
+  void InvalidateWaves();
+
+  // Invoke the nodes of the execution plan one at a time, preparing nodes
+  // that follow dynamic tensors as needed.
+  TfLiteStatus InvokeSequentially();
+
+  // Invoke the nodes of each wave concurrently, one wave after the other.
+  TfLiteStatus InvokeWaves();
+
   // Tensors needed by the interpreter. Use `AddTensors` to add more blank
   // tensor entries. Note, `tensors_.data()` needs to be synchronized to the
   // `context_` whenever this std::vector is reallocated. Currently this
@@ -621,6 +662,16 @@ class Interpreter {
 
   std::unique_ptr<MemoryPlanner> memory_planner_;
 
+  // Whether independent nodes run concurrently, and if so, the execution plan
+  // index at which each wave starts followed by the size of the plan, and the
+  // threads that run them.
+  bool parallel_execution_ = false;
+  std::vector<int> wave_starts_;
+  std::unique_ptr<ThreadPool> thread_pool_;
+
+  // Whether the memory planner places the largest tensors first.
+  bool largest_first_memory_planning_ = false;
+
   bool allow_buffer_handle_output_ = false;
 
   // Tracking bit for whether a tensor was resized in the course of an op
@@ -1011,6 +1011,165 @@ TfLiteRegistration AddOpRegistration() {
   return reg;
 }
 
+// Build two independent chains of additions that are joined at the end, so
+// that tensor 6 = 4 * tensor 0 + 4 * tensor 1. The nodes of the two chains
+// are added one chain after the other.
+void BuildTwoChains(Interpreter* interpreter, int size) {
+  ASSERT_EQ(interpreter->AddTensors(7), kTfLiteOk);
+  interpreter->SetInputs({0, 1});
+  interpreter->SetOutputs({6});
+  TfLiteQuantizationParams quant;
+  for (int i = 0; i < 7; ++i) {
+    ASSERT_EQ(interpreter->SetTensorParametersReadWrite(i, kTfLiteFloat32, "",
+                                                        {size}, quant),
+              kTfLiteOk);
+  }
+  TfLiteRegistration reg = AddOpRegistration();
+  interpreter->AddNodeWithParameters({0, 0}, {2}, nullptr, 0, nullptr, &reg);
+  interpreter->AddNodeWithParameters({2, 2}, {3}, nullptr, 0, nullptr, &reg);
+  interpreter->AddNodeWithParameters({1, 1}, {4}, nullptr, 0, nullptr, &reg);
+  interpreter->AddNodeWithParameters({4, 4}, {5}, nullptr, 0, nullptr, &reg);
+  interpreter->AddNodeWithParameters({3, 5}, {6}, nullptr, 0, nullptr, &reg);
+}
+
+TEST(ParallelExecution, MatchesSequentialExecution) {
+  const int kSize = 1000;
+  Interpreter interpreter;
+  BuildTwoChains(&interpreter, kSize);
+  interpreter.SetNumThreads(2);
+  ASSERT_EQ(interpreter.UseParallelExecution(true), kTfLiteOk);
+  ASSERT_EQ(interpreter.AllocateTensors(), kTfLiteOk);
+  // The plan runs both chains side by side.
+  EXPECT_EQ(interpreter.execution_plan(), std::vector<int>({0, 2, 1, 3, 4}));
+
+  for (int run = 0; run < 10; ++run) {
+    float* input0 = interpreter.typed_tensor<float>(0);
+    float* input1 = interpreter.typed_tensor<float>(1);
+    for (int i = 0; i < kSize; ++i) {
+      input0[i] = i + run;
+      input1[i] = 2 * i;
+    }
+    ASSERT_EQ(interpreter.Invoke(), kTfLiteOk);
+    const float* output = interpreter.typed_tensor<float>(6);
+    for (int i = 0; i < kSize; ++i) {
+      ASSERT_EQ(output[i], 4 * (i + run) + 8 * i) << "run " << run;
+    }
+  }
+}
+
+TEST(ParallelExecution, RequiresAllocateTensors) {
+  Interpreter interpreter;
+  BuildTwoChains(&interpreter, 3);
+  ASSERT_EQ(interpreter.AllocateTensors(), kTfLiteOk);
+  ASSERT_EQ(interpreter.UseParallelExecution(true), kTfLiteOk);
+  ASSERT_NE(interpreter.Invoke(), kTfLiteOk);
+  ASSERT_EQ(interpreter.AllocateTensors(), kTfLiteOk);
+  ASSERT_EQ(interpreter.Invoke(), kTfLiteOk);
+
+  // Changing the plan needs another allocation.
+  interpreter.SetExecutionPlan({0, 1, 2, 3, 4});
+  ASSERT_NE(interpreter.Invoke(), kTfLiteOk);
+  ASSERT_EQ(interpreter.AllocateTensors(), kTfLiteOk);
+  ASSERT_EQ(interpreter.Invoke(), kTfLiteOk);
+
+  ASSERT_EQ(interpreter.UseParallelExecution(false), kTfLiteOk);
+  ASSERT_EQ(interpreter.AllocateTensors(), kTfLiteOk);
+  ASSERT_EQ(interpreter.Invoke(), kTfLiteOk);
+}
+
+// Build a kernel registration for an op whose output holds as many floats
+// as the value of its input, so its size is only known at invocation time.
+TfLiteRegistration DynamicRangeOpRegistration() {
+  TfLiteRegistration reg = {nullptr, nullptr, nullptr, nullptr};
+
+  reg.prepare = [](TfLiteContext* context, TfLiteNode* node) {
+    SetTensorToDynamic(&context->tensors[node->outputs->data[0]]);
+    return kTfLiteOk;
+  };
+
+  reg.invoke = [](TfLiteContext* context, TfLiteNode* node) {
+    TfLiteTensor* input = &context->tensors[node->inputs->data[0]];
+    TfLiteTensor* output = &context->tensors[node->outputs->data[0]];
+    const int size = static_cast<int>(input->data.f[0]);
+    TfLiteIntArray* dims = TfLiteIntArrayCreate(1);
+    dims->data[0] = size;
+    TF_LITE_ENSURE_STATUS(context->ResizeTensor(context, output, dims));
+    for (int i = 0; i < size; ++i) {
+      output->data.f[i] = i;
+    }
+    return kTfLiteOk;
+  };
+  return reg;
+}
+
+TEST(ParallelExecution, ResizesDynamicTensors) {
+  // Tensor 1 has a dynamic size, and feeds two additions in the same wave.
+  Interpreter interpreter;
+  ASSERT_EQ(interpreter.AddTensors(5), kTfLiteOk);
+  interpreter.SetInputs({0});
+  interpreter.SetOutputs({4});
+  TfLiteQuantizationParams quant;
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_EQ(interpreter.SetTensorParametersReadWrite(i, kTfLiteFloat32, "",
+                                                       {1}, quant),
+              kTfLiteOk);
+  }
+  TfLiteRegistration range_reg = DynamicRangeOpRegistration();
+  TfLiteRegistration add_reg = AddOpRegistration();
+  interpreter.AddNodeWithParameters({0}, {1}, nullptr, 0, nullptr,
+                                    &range_reg);
+  interpreter.AddNodeWithParameters({1, 1}, {2}, nullptr, 0, nullptr,
+                                    &add_reg);
+  interpreter.AddNodeWithParameters({1, 1}, {3}, nullptr, 0, nullptr,
+                                    &add_reg);
+  interpreter.AddNodeWithParameters({2, 3}, {4}, nullptr, 0, nullptr,
+                                    &add_reg);
+  interpreter.SetNumThreads(2);
+  ASSERT_EQ(interpreter.UseParallelExecution(true), kTfLiteOk);
+  ASSERT_EQ(interpreter.AllocateTensors(), kTfLiteOk);
+
+  for (int size : {4, 1000, 16, 2000}) {
+    interpreter.typed_tensor<float>(0)[0] = size;
+    ASSERT_EQ(interpreter.Invoke(), kTfLiteOk);
+    const TfLiteTensor* output = interpreter.tensor(4);
+    ASSERT_EQ(output->dims->size, 1);
+    ASSERT_EQ(output->dims->data[0], size);
+    for (int i = 0; i < size; ++i) {
+      ASSERT_EQ(output->data.f[i], 4 * i) << "size " << size;
+    }
+  }
+}
+
+TEST(LargestFirstMemoryPlanning, MatchesExecutionOrderPlanning) {
+  const int kSize = 1000;
+  Interpreter interpreter;
+  BuildTwoChains(&interpreter, kSize);
+  ASSERT_EQ(interpreter.AllocateTensors(), kTfLiteOk);
+  size_t execution_order_size, persist_size;
+  interpreter.GetArenaSizes(&execution_order_size, &persist_size);
+  EXPECT_EQ(persist_size, 0);
+
+  ASSERT_EQ(interpreter.UseLargestFirstMemoryPlanning(true), kTfLiteOk);
+  ASSERT_NE(interpreter.Invoke(), kTfLiteOk);
+  ASSERT_EQ(interpreter.AllocateTensors(), kTfLiteOk);
+  size_t largest_first_size;
+  interpreter.GetArenaSizes(&largest_first_size, &persist_size);
+  EXPECT_GT(largest_first_size, 0);
+  EXPECT_LE(largest_first_size, execution_order_size);
+
+  float* input0 = interpreter.typed_tensor<float>(0);
+  float* input1 = interpreter.typed_tensor<float>(1);
+  for (int i = 0; i < kSize; ++i) {
+    input0[i] = i;
+    input1[i] = 2 * i;
+  }
+  ASSERT_EQ(interpreter.Invoke(), kTfLiteOk);
+  const float* output = interpreter.typed_tensor<float>(6);
+  for (int i = 0; i < kSize; ++i) {
+    ASSERT_EQ(output[i], 12 * i);
+  }
+}
+
 class TestDelegate : public ::testing::Test {
  protected:
   void SetUp() override {
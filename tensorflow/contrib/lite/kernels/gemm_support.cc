@@ -15,6 +15,9 @@ limitations under the License.
 #include "tensorflow/contrib/lite/kernels/gemm_support.h"
 
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 
 #include "tensorflow/contrib/lite/kernels/op_macros.h"
 
@@ -25,6 +28,15 @@ namespace {
 struct RefCountedGemmContext : public TfLiteExternalContext {
   std::unique_ptr<gemmlowp::GemmContext> gemm_context;
   int num_references = 0;
+
+  // A GemmContext can't be used by two ops at the same time, so when the
+  // interpreter runs ops concurrently, every thread but the first one to ask
+  // for 'gemm_context' gets a GemmContext of its own. The ops already share
+  // the cores, so these contexts are single threaded.
+  std::mutex mutex;
+  std::thread::id owner;
+  std::unordered_map<std::thread::id, std::unique_ptr<gemmlowp::GemmContext>>
+      thread_gemm_contexts;
 };
 
 RefCountedGemmContext* GetGemmLowpContext(TfLiteContext* context) {
@@ -35,6 +47,7 @@ RefCountedGemmContext* GetGemmLowpContext(TfLiteContext* context) {
 TfLiteStatus Refresh(TfLiteContext* context) {
   auto* ptr = GetGemmLowpContext(context);
   if (ptr != nullptr) {
+    std::lock_guard<std::mutex> lock(ptr->mutex);
     ptr->gemm_context->set_max_num_threads(context->recommended_num_threads);
   }
   return kTfLiteOk;
@@ -77,7 +90,20 @@ gemmlowp::GemmContext* GetFromContext(TfLiteContext* context) {
     TF_LITE_FATAL(
         "Call to GetFromContext() not preceded by IncrementUsageCounter()");
   }
-  return ptr->gemm_context.get();
+  std::lock_guard<std::mutex> lock(ptr->mutex);
+  const std::thread::id this_thread = std::this_thread::get_id();
+  if (ptr->owner == std::thread::id()) {
+    ptr->owner = this_thread;
+  }
+  if (ptr->owner == this_thread) {
+    return ptr->gemm_context.get();
+  }
+  auto& thread_context = ptr->thread_gemm_contexts[this_thread];
+  if (!thread_context) {
+    thread_context.reset(new gemmlowp::GemmContext());
+    thread_context->set_max_num_threads(1);
+  }
+  return thread_context.get();
 }
 
 }  // namespace gemm_support
@@ -22,9 +22,11 @@ namespace tflite {
 namespace gemm_support {
 
 // Returns the GemmContext stored in 'context', allowing multiple ops to
-// share a single object, as long as they share a TfLiteContext. The caller
-// must ensure that this is called between IncrementUsageCounter() and
-// DecrementUsageCounter(). For example, in the implementation of an op:
+// share a single object, as long as they share a TfLiteContext. Ops that run
+// concurrently on other threads get a single-threaded GemmContext of their
+// own. The caller must ensure that this is called between
+// IncrementUsageCounter() and DecrementUsageCounter(). For example, in the
+// implementation of an op:
 //   void* Init(TfLiteContext* context, const char*, size_t) {
 //     gemm_support::IncrementUsageCounter(context);
 //     return nullptr;
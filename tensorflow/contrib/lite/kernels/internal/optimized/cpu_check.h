@@ -44,6 +44,27 @@ inline bool TestCPUFeatureNeon() { return false; }
 
 #endif
 
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+
+// Runtime checks for the x86 instruction sets used by sse_tensor_utils.
+inline bool TestCPUFeatureSse4() {
+  static bool kUseSse4 = __builtin_cpu_supports("sse4.1");
+  return kUseSse4;
+}
+
+inline bool TestCPUFeatureAvx2() {
+  static bool kUseAvx2 =
+      __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+  return kUseAvx2;
+}
+
+#else
+
+inline bool TestCPUFeatureSse4() { return false; }
+inline bool TestCPUFeatureAvx2() { return false; }
+
+#endif
+
 }  // namespace tflite
 
 // NEON_OR_PORTABLE(SomeFunc, arcs) calls NeonSomeFunc(args) if Neon is both
@@ -58,4 +79,15 @@ inline bool TestCPUFeatureNeon() { return false; }
                        : Portable##funcname(__VA_ARGS__)
 #endif
 
+// SSE4_OR_PORTABLE(SomeFunc, args) calls Sse4SomeFunc(args) if the CPU
+// supports SSE4.1, or PortableSomeFunc(args) otherwise.
+// AVX2_OR_SSE4_OR_PORTABLE(SomeFunc, args) additionally prefers
+// Avx2SomeFunc(args) if the CPU supports AVX2 and FMA.
+#define SSE4_OR_PORTABLE(funcname, ...)              \
+  TestCPUFeatureSse4() ? Sse4##funcname(__VA_ARGS__) \
+                       : Portable##funcname(__VA_ARGS__)
+#define AVX2_OR_SSE4_OR_PORTABLE(funcname, ...)      \
+  TestCPUFeatureAvx2() ? Avx2##funcname(__VA_ARGS__) \
+                       : SSE4_OR_PORTABLE(funcname, __VA_ARGS__)
+
 #endif  // TENSORFLOW_CONTRIB_LITE_KERNELS_INTERNAL_OPTIMIZED_CPU_CHECK_
@@ -0,0 +1,616 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "tensorflow/contrib/lite/kernels/internal/optimized/tensor_utils_impl.h"
+#include "tensorflow/contrib/lite/kernels/internal/round.h"
+#include "tensorflow/contrib/lite/kernels/op_macros.h"
+
+#ifdef USE_SSE
+
+#include <immintrin.h>
+
+// The file is built for the baseline x86 target; only the functions below
+// may use the newer instruction sets, and they are only called after
+// cpu_check.h has found them to be supported.
+#define TFLITE_SSE4_TARGET __attribute__((target("sse4.1")))
+#define TFLITE_AVX2_TARGET __attribute__((target("avx2,fma")))
+
+#define kFloatWeightsPerSseLane 4
+#define kFloatWeightsPerAvxLane 8
+#define kInt8WeightsPerSseLane 16
+
+namespace tflite {
+namespace tensor_utils {
+namespace {
+
+TFLITE_SSE4_TARGET inline float HorizontalSum(__m128 v) {
+  __m128 sum = _mm_add_ps(v, _mm_movehl_ps(v, v));
+  sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+  return _mm_cvtss_f32(sum);
+}
+
+TFLITE_SSE4_TARGET inline int32_t HorizontalSum(__m128i v) {
+  __m128i sum =
+      _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtsi128_si32(sum);
+}
+
+TFLITE_AVX2_TARGET inline float HorizontalSum(__m256 v) {
+  return HorizontalSum(
+      _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)));
+}
+
+TFLITE_AVX2_TARGET inline int32_t HorizontalSum(__m256i v) {
+  return HorizontalSum(_mm_add_epi32(_mm256_castsi256_si128(v),
+                                     _mm256_extracti128_si256(v, 1)));
+}
+
+// The largest float below 0.5f. Adding it instead of 0.5f before truncating
+// keeps values just below a half from being rounded up, e.g. 0.49999997f +
+// 0.5f rounds to 1.0f, while ties still round away from zero.
+constexpr float kJustBelowHalf = 0.49999997f;
+
+// Rounds half away from zero, like TfLiteRound(), and truncates to int32.
+TFLITE_SSE4_TARGET inline __m128i RoundToInt32(__m128 v) {
+  const __m128 sign = _mm_and_ps(v, _mm_set1_ps(-0.0f));
+  return _mm_cvttps_epi32(
+      _mm_add_ps(v, _mm_or_ps(sign, _mm_set1_ps(kJustBelowHalf))));
+}
+
+TFLITE_AVX2_TARGET inline __m256i RoundToInt32(__m256 v) {
+  const __m256 sign = _mm256_and_ps(v, _mm256_set1_ps(-0.0f));
+  return _mm256_cvttps_epi32(
+      _mm256_add_ps(v, _mm256_or_ps(sign, _mm256_set1_ps(kJustBelowHalf))));
+}
+
+// Shared by the SSE4 and AVX2 symmetric quantizers once min and max are
+// known. Returns false if all values are zero, in which case the output has
+// already been filled in.
+bool SymmetricQuantizationFactor(float min, float max, int size,
+                                 int8_t* quantized_values,
+                                 float* scaling_factor,
+                                 float* scaling_factor_inv) {
+  const int kScale = 127;
+  const float range = std::max(std::abs(min), std::abs(max));
+  if (range == 0) {
+    memset(quantized_values, 0, size * sizeof(int8_t));
+    *scaling_factor = 1;
+    return false;
+  }
+  *scaling_factor = range / kScale;
+  *scaling_factor_inv = 1.0f / *scaling_factor;
+  return true;
+}
+
+int8_t QuantizeValue(float value, float scaling_factor_inv) {
+  const int kScale = 127;
+  const int32_t quantized_value =
+      static_cast<int32_t>(TfLiteRound(value * scaling_factor_inv));
+  return std::min(kScale, std::max(-kScale, quantized_value));
+}
+
+}  // namespace
+
+TFLITE_SSE4_TARGET void Sse4MatrixBatchVectorMultiplyAccumulate(
+    const float* matrix, int m_rows, int m_cols, const float* vector,
+    int n_batch, float* result, int result_stride) {
+  // If m_cols is not divisible by kFloatWeightsPerSseLane, we cannot use the
+  // main vectorized loop, and we need to process sequentially.
+  // postamble_start shows the start index where this should happen.
+  const int postamble_start =
+      m_cols - (m_cols & (kFloatWeightsPerSseLane - 1));
+
+  for (int b = 0; b < n_batch; b++) {
+    float* result_in_batch = result + b * m_rows * result_stride;
+    const float* vector_in_batch = vector + b * m_cols;
+    const float* matrix_row = matrix;
+    for (int r = 0; r < m_rows; r++) {
+      __m128 acc = _mm_setzero_ps();
+      for (int c = 0; c < postamble_start; c += kFloatWeightsPerSseLane) {
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(matrix_row + c),
+                                         _mm_loadu_ps(vector_in_batch + c)));
+      }
+      float sum = HorizontalSum(acc);
+      for (int c = postamble_start; c < m_cols; c++) {
+        sum += matrix_row[c] * vector_in_batch[c];
+      }
+      *result_in_batch += sum;
+      matrix_row += m_cols;
+      result_in_batch += result_stride;
+    }
+  }
+}
+
+TFLITE_AVX2_TARGET void Avx2MatrixBatchVectorMultiplyAccumulate(
+    const float* matrix, int m_rows, int m_cols, const float* vector,
+    int n_batch, float* result, int result_stride) {
+  // Two accumulators per row hide the latency of the fused multiply-add.
+  const int kBlock = 2 * kFloatWeightsPerAvxLane;
+  const int block_end = m_cols - (m_cols & (kBlock - 1));
+  const int postamble_start =
+      m_cols - (m_cols & (kFloatWeightsPerAvxLane - 1));
+
+  for (int b = 0; b < n_batch; b++) {
+    float* result_in_batch = result + b * m_rows * result_stride;
+    const float* vector_in_batch = vector + b * m_cols;
+    const float* matrix_row = matrix;
+    for (int r = 0; r < m_rows; r++) {
+      __m256 acc0 = _mm256_setzero_ps();
+      __m256 acc1 = _mm256_setzero_ps();
+      int c = 0;
+      for (; c < block_end; c += kBlock) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(matrix_row + c),
+                               _mm256_loadu_ps(vector_in_batch + c), acc0);
+        acc1 = _mm256_fmadd_ps(
+            _mm256_loadu_ps(matrix_row + c + kFloatWeightsPerAvxLane),
+            _mm256_loadu_ps(vector_in_batch + c + kFloatWeightsPerAvxLane),
+            acc1);
+      }
+      for (; c < postamble_start; c += kFloatWeightsPerAvxLane) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(matrix_row + c),
+                               _mm256_loadu_ps(vector_in_batch + c), acc0);
+      }
+      float sum = HorizontalSum(_mm256_add_ps(acc0, acc1));
+      for (c = postamble_start; c < m_cols; c++) {
+        sum += matrix_row[c] * vector_in_batch[c];
+      }
+      *result_in_batch += sum;
+      matrix_row += m_cols;
+      result_in_batch += result_stride;
+    }
+  }
+}
+
+TFLITE_SSE4_TARGET void Sse4MatrixBatchVectorMultiplyAccumulate(
+    const int8_t* __restrict__ matrix, const int m_rows, const int m_cols,
+    const int8_t* __restrict__ vectors, const float* scaling_factors,
+    int n_batch, float* __restrict__ result, int result_stride) {
+  const int postamble_start =
+      m_cols - (m_cols & (kInt8WeightsPerSseLane - 1));
+
+  for (int batch = 0; batch < n_batch; ++batch, vectors += m_cols) {
+    const float batch_scaling_factor = scaling_factors[batch];
+    const int8_t* row_ptr = matrix;
+    for (int row = 0; row < m_rows; ++row, result += result_stride) {
+      __m128i dotprod = _mm_setzero_si128();
+      for (int col = 0; col < postamble_start; col += kInt8WeightsPerSseLane) {
+        const __m128i row_8x16 =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(row_ptr + col));
+        const __m128i vec_8x16 =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(vectors + col));
+        // Widen to 16 bits and let madd sum adjacent products into 32 bits.
+        const __m128i row_lo = _mm_cvtepi8_epi16(row_8x16);
+        const __m128i row_hi = _mm_cvtepi8_epi16(_mm_srli_si128(row_8x16, 8));
+        const __m128i vec_lo = _mm_cvtepi8_epi16(vec_8x16);
+        const __m128i vec_hi = _mm_cvtepi8_epi16(_mm_srli_si128(vec_8x16, 8));
+        dotprod = _mm_add_epi32(dotprod, _mm_madd_epi16(row_lo, vec_lo));
+        dotprod = _mm_add_epi32(dotprod, _mm_madd_epi16(row_hi, vec_hi));
+      }
+      int32_t sum = HorizontalSum(dotprod);
+      for (int col = postamble_start; col < m_cols; ++col) {
+        sum += row_ptr[col] * vectors[col];
+      }
+      *result += sum * batch_scaling_factor;
+      row_ptr += m_cols;
+    }
+  }
+}
+
+TFLITE_AVX2_TARGET void Avx2MatrixBatchVectorMultiplyAccumulate(
+    const int8_t* __restrict__ matrix, const int m_rows, const int m_cols,
+    const int8_t* __restrict__ vectors, const float* scaling_factors,
+    int n_batch, float* __restrict__ result, int result_stride) {
+  const int postamble_start =
+      m_cols - (m_cols & (kInt8WeightsPerSseLane - 1));
+
+  for (int batch = 0; batch < n_batch; ++batch, vectors += m_cols) {
+    const float batch_scaling_factor = scaling_factors[batch];
+    const int8_t* row_ptr = matrix;
+    for (int row = 0; row < m_rows; ++row, result += result_stride) {
+      __m256i dotprod = _mm256_setzero_si256();
+      for (int col = 0; col < postamble_start; col += kInt8WeightsPerSseLane) {
+        const __m256i row_16x16 = _mm256_cvtepi8_epi16(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(row_ptr + col)));
+        const __m256i vec_16x16 = _mm256_cvtepi8_epi16(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(vectors + col)));
+        dotprod =
+            _mm256_add_epi32(dotprod, _mm256_madd_epi16(row_16x16, vec_16x16));
+      }
+      int32_t sum = HorizontalSum(dotprod);
+      for (int col = postamble_start; col < m_cols; ++col) {
+        sum += row_ptr[col] * vectors[col];
+      }
+      *result += sum * batch_scaling_factor;
+      row_ptr += m_cols;
+    }
+  }
+}
+
+TFLITE_SSE4_TARGET void Sse4VectorVectorCwiseProduct(const float* vector1,
+                                                     const float* vector2,
+                                                     int v_size,
+                                                     float* result) {
+  const int postamble_start =
+      v_size - (v_size & (kFloatWeightsPerSseLane - 1));
+  for (int v = 0; v < postamble_start; v += kFloatWeightsPerSseLane) {
+    _mm_storeu_ps(result + v, _mm_mul_ps(_mm_loadu_ps(vector1 + v),
+                                         _mm_loadu_ps(vector2 + v)));
+  }
+  for (int v = postamble_start; v < v_size; v++) {
+    result[v] = vector1[v] * vector2[v];
+  }
+}
+
+TFLITE_AVX2_TARGET void Avx2VectorVectorCwiseProduct(const float* vector1,
+                                                     const float* vector2,
+                                                     int v_size,
+                                                     float* result) {
+  const int postamble_start =
+      v_size - (v_size & (kFloatWeightsPerAvxLane - 1));
+  for (int v = 0; v < postamble_start; v += kFloatWeightsPerAvxLane) {
+    _mm256_storeu_ps(result + v, _mm256_mul_ps(_mm256_loadu_ps(vector1 + v),
+                                               _mm256_loadu_ps(vector2 + v)));
+  }
+  for (int v = postamble_start; v < v_size; v++) {
+    result[v] = vector1[v] * vector2[v];
+  }
+}
+
+TFLITE_SSE4_TARGET void Sse4VectorVectorCwiseProductAccumulate(
+    const float* vector1, const float* vector2, int v_size, float* result) {
+  const int postamble_start =
+      v_size - (v_size & (kFloatWeightsPerSseLane - 1));
+  for (int v = 0; v < postamble_start; v += kFloatWeightsPerSseLane) {
+    const __m128 product =
+        _mm_mul_ps(_mm_loadu_ps(vector1 + v), _mm_loadu_ps(vector2 + v));
+    _mm_storeu_ps(result + v, _mm_add_ps(_mm_loadu_ps(result + v), product));
+  }
+  for (int v = postamble_start; v < v_size; v++) {
+    result[v] += vector1[v] * vector2[v];
+  }
+}
+
+TFLITE_AVX2_TARGET void Avx2VectorVectorCwiseProductAccumulate(
+    const float* vector1, const float* vector2, int v_size, float* result) {
+  const int postamble_start =
+      v_size - (v_size & (kFloatWeightsPerAvxLane - 1));
+  for (int v = 0; v < postamble_start; v += kFloatWeightsPerAvxLane) {
+    _mm256_storeu_ps(result + v, _mm256_fmadd_ps(_mm256_loadu_ps(vector1 + v),
+                                                 _mm256_loadu_ps(vector2 + v),
+                                                 _mm256_loadu_ps(result + v)));
+  }
+  for (int v = postamble_start; v < v_size; v++) {
+    result[v] += vector1[v] * vector2[v];
+  }
+}
+
+TFLITE_SSE4_TARGET void Sse4VectorBatchVectorCwiseProductAccumulate(
+    const float* vector, int v_size, const float* batch_vector, int n_batch,
+    float* result) {
+  for (int b = 0; b < n_batch; b++) {
+    Sse4VectorVectorCwiseProductAccumulate(vector, batch_vector, v_size,
+                                           result);
+    batch_vector += v_size;
+    result += v_size;
+  }
+}
+
+TFLITE_AVX2_TARGET void Avx2VectorBatchVectorCwiseProductAccumulate(
+    const float* vector, int v_size, const float* batch_vector, int n_batch,
+    float* result) {
+  for (int b = 0; b < n_batch; b++) {
+    Avx2VectorVectorCwiseProductAccumulate(vector, batch_vector, v_size,
+                                           result);
+    batch_vector += v_size;
+    result += v_size;
+  }
+}
+
+TFLITE_SSE4_TARGET float Sse4VectorVectorDotProduct(const float* vector1,
+                                                    const float* vector2,
+                                                    int v_size) {
+  const int postamble_start =
+      v_size - (v_size & (kFloatWeightsPerSseLane - 1));
+  __m128 acc = _mm_setzero_ps();
+  for (int v = 0; v < postamble_start; v += kFloatWeightsPerSseLane) {
+    acc = _mm_add_ps(
+        acc, _mm_mul_ps(_mm_loadu_ps(vector1 + v), _mm_loadu_ps(vector2 + v)));
+  }
+  float result = HorizontalSum(acc);
+  for (int v = postamble_start; v < v_size; v++) {
+    result += vector1[v] * vector2[v];
+  }
+  return result;
+}
+
+TFLITE_AVX2_TARGET float Avx2VectorVectorDotProduct(const float* vector1,
+                                                    const float* vector2,
+                                                    int v_size) {
+  const int postamble_start =
+      v_size - (v_size & (kFloatWeightsPerAvxLane - 1));
+  __m256 acc = _mm256_setzero_ps();
+  for (int v = 0; v < postamble_start; v += kFloatWeightsPerAvxLane) {
+    acc = _mm256_fmadd_ps(_mm256_loadu_ps(vector1 + v),
+                          _mm256_loadu_ps(vector2 + v), acc);
+  }
+  float result = HorizontalSum(acc);
+  for (int v = postamble_start; v < v_size; v++) {
+    result += vector1[v] * vector2[v];
+  }
+  return result;
+}
+
+TFLITE_SSE4_TARGET void Sse4BatchVectorBatchVectorDotProduct(
+    const float* vector1, const float* vector2, int v_size, int n_batch,
+    float* result, int result_stride) {
+  for (int b = 0; b < n_batch; b++) {
+    *result = Sse4VectorVectorDotProduct(vector1, vector2, v_size);
+    vector1 += v_size;
+    vector2 += v_size;
+    result += result_stride;
+  }
+}
+
+TFLITE_AVX2_TARGET void Avx2BatchVectorBatchVectorDotProduct(
+    const float* vector1, const float* vector2, int v_size, int n_batch,
+    float* result, int result_stride) {
+  for (int b = 0; b < n_batch; b++) {
+    *result = Avx2VectorVectorDotProduct(vector1, vector2, v_size);
+    vector1 += v_size;
+    vector2 += v_size;
+    result += result_stride;
+  }
+}
+
+TFLITE_SSE4_TARGET void Sse4Sub1Vector(const float* vector, int v_size,
+                                       float* result) {
+  const int postamble_start =
+      v_size - (v_size & (kFloatWeightsPerSseLane - 1));
+  const __m128 one = _mm_set1_ps(1.0f);
+  for (int v = 0; v < postamble_start; v += kFloatWeightsPerSseLane) {
+    _mm_storeu_ps(result + v, _mm_sub_ps(one, _mm_loadu_ps(vector + v)));
+  }
+  for (int v = postamble_start; v < v_size; v++) {
+    result[v] = 1.0f - vector[v];
+  }
+}
+
+TFLITE_SSE4_TARGET bool Sse4IsZeroVector(const float* vector, int v_size) {
+  const int postamble_start =
+      v_size - (v_size & (kFloatWeightsPerSseLane - 1));
+  const __m128 zero = _mm_setzero_ps();
+  for (int v = 0; v < postamble_start; v += kFloatWeightsPerSseLane) {
+    if (_mm_movemask_ps(_mm_cmpneq_ps(_mm_loadu_ps(vector + v), zero))) {
+      return false;
+    }
+  }
+  for (int v = postamble_start; v < v_size; v++) {
+    if (vector[v] != 0.0f) return false;
+  }
+  return true;
+}
+
+TFLITE_SSE4_TARGET void Sse4VectorScalarMultiply(const int8_t* vector,
+                                                 int v_size, float scale,
+                                                 float* result) {
+  const int postamble_start =
+      v_size - (v_size & (kFloatWeightsPerSseLane - 1));
+  const __m128 scale_f32x4 = _mm_set1_ps(scale);
+  for (int v = 0; v < postamble_start; v += kFloatWeightsPerSseLane) {
+    int32_t four_values;
+    memcpy(&four_values, vector + v, sizeof(four_values));
+    const __m128 values =
+        _mm_cvtepi32_ps(_mm_cvtepi8_epi32(_mm_cvtsi32_si128(four_values)));
+    _mm_storeu_ps(result + v, _mm_mul_ps(scale_f32x4, values));
+  }
+  for (int v = postamble_start; v < v_size; v++) {
+    result[v] = scale * vector[v];
+  }
+}
+
+TFLITE_AVX2_TARGET void Avx2VectorScalarMultiply(const int8_t* vector,
+                                                 int v_size, float scale,
+                                                 float* result) {
+  const int postamble_start =
+      v_size - (v_size & (kFloatWeightsPerAvxLane - 1));
+  const __m256 scale_f32x8 = _mm256_set1_ps(scale);
+  for (int v = 0; v < postamble_start; v += kFloatWeightsPerAvxLane) {
+    const __m256 values = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(vector + v))));
+    _mm256_storeu_ps(result + v, _mm256_mul_ps(scale_f32x8, values));
+  }
+  for (int v = postamble_start; v < v_size; v++) {
+    result[v] = scale * vector[v];
+  }
+}
+
+TFLITE_SSE4_TARGET void Sse4ClipVector(const float* vector, int v_size,
+                                       float abs_limit, float* result) {
+  const int postamble_start =
+      v_size - (v_size & (kFloatWeightsPerSseLane - 1));
+  const __m128 upper = _mm_set1_ps(abs_limit);
+  const __m128 lower = _mm_set1_ps(-abs_limit);
+  for (int v = 0; v < postamble_start; v += kFloatWeightsPerSseLane) {
+    // With the input as the second operand, NaNs pass through like they do
+    // in PortableClip().
+    const __m128 clipped =
+        _mm_max_ps(lower, _mm_min_ps(upper, _mm_loadu_ps(vector + v)));
+    _mm_storeu_ps(result + v, clipped);
+  }
+  for (int v = postamble_start; v < v_size; v++) {
+    result[v] = PortableClip(vector[v], abs_limit);
+  }
+}
+
+TFLITE_SSE4_TARGET void Sse4SymmetricQuantizeFloats(const float* values,
+                                                    const int size,
+                                                    int8_t* quantized_values,
+                                                    float* min, float* max,
+                                                    float* scaling_factor) {
+  const int postamble_start =
+      size - (size & (2 * kFloatWeightsPerSseLane - 1));
+  if (postamble_start == 0) {
+    PortableSymmetricQuantizeFloats(values, size, quantized_values, min, max,
+                                    scaling_factor);
+    return;
+  }
+
+  __m128 min_f32x4 = _mm_loadu_ps(values);
+  __m128 max_f32x4 = min_f32x4;
+  for (int i = kFloatWeightsPerSseLane; i < postamble_start;
+       i += kFloatWeightsPerSseLane) {
+    const __m128 v = _mm_loadu_ps(values + i);
+    min_f32x4 = _mm_min_ps(min_f32x4, v);
+    max_f32x4 = _mm_max_ps(max_f32x4, v);
+  }
+  min_f32x4 = _mm_min_ps(min_f32x4, _mm_movehl_ps(min_f32x4, min_f32x4));
+  min_f32x4 = _mm_min_ss(min_f32x4, _mm_shuffle_ps(min_f32x4, min_f32x4, 1));
+  max_f32x4 = _mm_max_ps(max_f32x4, _mm_movehl_ps(max_f32x4, max_f32x4));
+  max_f32x4 = _mm_max_ss(max_f32x4, _mm_shuffle_ps(max_f32x4, max_f32x4, 1));
+  *min = _mm_cvtss_f32(min_f32x4);
+  *max = _mm_cvtss_f32(max_f32x4);
+  for (int i = postamble_start; i < size; ++i) {
+    *min = std::min(*min, values[i]);
+    *max = std::max(*max, values[i]);
+  }
+
+  float scaling_factor_inv;
+  if (!SymmetricQuantizationFactor(*min, *max, size, quantized_values,
+                                   scaling_factor, &scaling_factor_inv)) {
+    return;
+  }
+
+  const __m128 q_factor = _mm_set1_ps(scaling_factor_inv);
+  const __m128i scale = _mm_set1_epi32(127);
+  const __m128i neg_scale = _mm_set1_epi32(-127);
+  for (int i = 0; i < postamble_start; i += 2 * kFloatWeightsPerSseLane) {
+    __m128i q0 =
+        RoundToInt32(_mm_mul_ps(_mm_loadu_ps(values + i), q_factor));
+    __m128i q1 = RoundToInt32(
+        _mm_mul_ps(_mm_loadu_ps(values + i + kFloatWeightsPerSseLane),
+                   q_factor));
+    q0 = _mm_min_epi32(_mm_max_epi32(q0, neg_scale), scale);
+    q1 = _mm_min_epi32(_mm_max_epi32(q1, neg_scale), scale);
+    const __m128i q_16x8 = _mm_packs_epi32(q0, q1);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(quantized_values + i),
+                     _mm_packs_epi16(q_16x8, q_16x8));
+  }
+  for (int i = postamble_start; i < size; ++i) {
+    quantized_values[i] = QuantizeValue(values[i], scaling_factor_inv);
+  }
+}
+
+TFLITE_AVX2_TARGET void Avx2SymmetricQuantizeFloats(const float* values,
+                                                    const int size,
+                                                    int8_t* quantized_values,
+                                                    float* min, float* max,
+                                                    float* scaling_factor) {
+  const int postamble_start =
+      size - (size & (kFloatWeightsPerAvxLane - 1));
+  if (postamble_start == 0) {
+    PortableSymmetricQuantizeFloats(values, size, quantized_values, min, max,
+                                    scaling_factor);
+    return;
+  }
+
+  __m256 min_f32x8 = _mm256_loadu_ps(values);
+  __m256 max_f32x8 = min_f32x8;
+  for (int i = kFloatWeightsPerAvxLane; i < postamble_start;
+       i += kFloatWeightsPerAvxLane) {
+    const __m256 v = _mm256_loadu_ps(values + i);
+    min_f32x8 = _mm256_min_ps(min_f32x8, v);
+    max_f32x8 = _mm256_max_ps(max_f32x8, v);
+  }
+  __m128 min_f32x4 = _mm_min_ps(_mm256_castps256_ps128(min_f32x8),
+                                _mm256_extractf128_ps(min_f32x8, 1));
+  __m128 max_f32x4 = _mm_max_ps(_mm256_castps256_ps128(max_f32x8),
+                                _mm256_extractf128_ps(max_f32x8, 1));
+  min_f32x4 = _mm_min_ps(min_f32x4, _mm_movehl_ps(min_f32x4, min_f32x4));
+  min_f32x4 = _mm_min_ss(min_f32x4, _mm_shuffle_ps(min_f32x4, min_f32x4, 1));
+  max_f32x4 = _mm_max_ps(max_f32x4, _mm_movehl_ps(max_f32x4, max_f32x4));
+  max_f32x4 = _mm_max_ss(max_f32x4, _mm_shuffle_ps(max_f32x4, max_f32x4, 1));
+  *min = _mm_cvtss_f32(min_f32x4);
+  *max = _mm_cvtss_f32(max_f32x4);
+  for (int i = postamble_start; i < size; ++i) {
+    *min = std::min(*min, values[i]);
+    *max = std::max(*max, values[i]);
+  }
+
+  float scaling_factor_inv;
+  if (!SymmetricQuantizationFactor(*min, *max, size, quantized_values,
+                                   scaling_factor, &scaling_factor_inv)) {
+    return;
+  }
+
+  const __m256 q_factor = _mm256_set1_ps(scaling_factor_inv);
+  const __m256i scale = _mm256_set1_epi32(127);
+  const __m256i neg_scale = _mm256_set1_epi32(-127);
+  for (int i = 0; i < postamble_start; i += kFloatWeightsPerAvxLane) {
+    __m256i q =
+        RoundToInt32(_mm256_mul_ps(_mm256_loadu_ps(values + i), q_factor));
+    q = _mm256_min_epi32(_mm256_max_epi32(q, neg_scale), scale);
+    const __m128i q_16x8 = _mm_packs_epi32(_mm256_castsi256_si128(q),
+                                           _mm256_extracti128_si256(q, 1));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(quantized_values + i),
+                     _mm_packs_epi16(q_16x8, q_16x8));
+  }
+  for (int i = postamble_start; i < size; ++i) {
+    quantized_values[i] = QuantizeValue(values[i], scaling_factor_inv);
+  }
+}
+
+TFLITE_SSE4_TARGET void Sse4VectorShiftLeft(float* vector, int v_size,
+                                            float shift_value) {
+  TF_LITE_ASSERT(v_size > 0);
+  // Every load reads ahead of the elements already overwritten.
+  int v = 0;
+  for (; v + kFloatWeightsPerSseLane < v_size; v += kFloatWeightsPerSseLane) {
+    _mm_storeu_ps(vector + v, _mm_loadu_ps(vector + v + 1));
+  }
+  for (; v < v_size - 1; v++) {
+    vector[v] = vector[v + 1];
+  }
+  vector[v_size - 1] = shift_value;
+}
+
+TFLITE_SSE4_TARGET void Sse4ReductionSumVector(const float* input_vector,
+                                               float* output_vector,
+                                               int output_size,
+                                               int reduction_size) {
+  const int postamble_start =
+      reduction_size - (reduction_size & (kFloatWeightsPerSseLane - 1));
+  for (int o = 0; o < output_size; o++) {
+    __m128 sum = _mm_setzero_ps();
+    for (int r = 0; r < postamble_start; r += kFloatWeightsPerSseLane) {
+      sum = _mm_add_ps(sum, _mm_loadu_ps(input_vector + r));
+    }
+    output_vector[o] += HorizontalSum(sum);
+    for (int r = postamble_start; r < reduction_size; r++) {
+      output_vector[o] += input_vector[r];
+    }
+    input_vector += reduction_size;
+  }
+}
+
+}  // namespace tensor_utils
+}  // namespace tflite
+
+#endif  // USE_SSE
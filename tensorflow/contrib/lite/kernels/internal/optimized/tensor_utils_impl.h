@@ -25,6 +25,12 @@ limitations under the License.
 #endif  //  defined(__ARM_NEON__) || defined(__ARM_NEON)
 #endif  //  USE_NEON
 
+#if !defined(USE_NEON) && !defined(USE_SSE)
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define USE_SSE
+#endif  //  (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#endif  //  !defined(USE_NEON) && !defined(USE_SSE)
+
 namespace tflite {
 namespace tensor_utils {
 
@@ -39,6 +45,14 @@ void NeonMatrixBatchVectorMultiplyAccumulate(const float* matrix, int m_rows,
                                              int m_cols, const float* vector,
                                              int n_batch, float* result,
                                              int result_stride);
+void Sse4MatrixBatchVectorMultiplyAccumulate(const float* matrix, int m_rows,
+                                             int m_cols, const float* vector,
+                                             int n_batch, float* result,
+                                             int result_stride);
+void Avx2MatrixBatchVectorMultiplyAccumulate(const float* matrix, int m_rows,
+                                             int m_cols, const float* vector,
+                                             int n_batch, float* result,
+                                             int result_stride);
 
 // Matrix multiplication for quantized values using symmetric quantization.
 void PortableMatrixBatchVectorMultiplyAccumulate(
@@ -49,6 +63,14 @@ void NeonMatrixBatchVectorMultiplyAccumulate(
     const int8_t* __restrict__ matrix, const int m_rows, const int m_cols,
     const int8_t* __restrict__ vectors, const float* scaling_factors,
     int n_batch, float* __restrict__ result, int result_stride);
+void Sse4MatrixBatchVectorMultiplyAccumulate(
+    const int8_t* __restrict__ matrix, const int m_rows, const int m_cols,
+    const int8_t* __restrict__ vectors, const float* scaling_factors,
+    int n_batch, float* __restrict__ result, int result_stride);
+void Avx2MatrixBatchVectorMultiplyAccumulate(
+    const int8_t* __restrict__ matrix, const int m_rows, const int m_cols,
+    const int8_t* __restrict__ vectors, const float* scaling_factors,
+    int n_batch, float* __restrict__ result, int result_stride);
 
 // Cwise product of two vectors.
 void PortableVectorVectorCwiseProduct(const float* vector1,
@@ -56,6 +78,10 @@ void PortableVectorVectorCwiseProduct(const float* vector1,
                                       float* result);
 void NeonVectorVectorCwiseProduct(const float* vector1, const float* vector2,
                                   int v_size, float* result);
+void Sse4VectorVectorCwiseProduct(const float* vector1, const float* vector2,
+                                  int v_size, float* result);
+void Avx2VectorVectorCwiseProduct(const float* vector1, const float* vector2,
+                                  int v_size, float* result);
 
 // Cwise product and accumulate of two vectors. Since it's a MAC operation, the
 // assumption here is that result array is initialized to valid values.
@@ -65,12 +91,22 @@ void PortableVectorVectorCwiseProductAccumulate(const float* vector1,
 void NeonVectorVectorCwiseProductAccumulate(const float* vector1,
                                             const float* vector2, int v_size,
                                             float* result);
+void Sse4VectorVectorCwiseProductAccumulate(const float* vector1,
+                                            const float* vector2, int v_size,
+                                            float* result);
+void Avx2VectorVectorCwiseProductAccumulate(const float* vector1,
+                                            const float* vector2, int v_size,
+                                            float* result);
 
 // Dot product of two vectors.
 float PortableVectorVectorDotProduct(const float* vector1, const float* vector2,
                                      int v_size);
 float NeonVectorVectorDotProduct(const float* vector1, const float* vector2,
                                  int v_size);
+float Sse4VectorVectorDotProduct(const float* vector1, const float* vector2,
+                                 int v_size);
+float Avx2VectorVectorDotProduct(const float* vector1, const float* vector2,
+                                 int v_size);
 
 // Dot product of two batch vectors.
 void PortableBatchVectorBatchVectorDotProduct(const float* vector1,
@@ -81,6 +117,14 @@ void NeonBatchVectorBatchVectorDotProduct(const float* vector1,
                                           const float* vector2, int v_size,
                                           int n_batch, float* result,
                                           int result_stride);
+void Sse4BatchVectorBatchVectorDotProduct(const float* vector1,
+                                          const float* vector2, int v_size,
+                                          int n_batch, float* result,
+                                          int result_stride);
+void Avx2BatchVectorBatchVectorDotProduct(const float* vector1,
+                                          const float* vector2, int v_size,
+                                          int n_batch, float* result,
+                                          int result_stride);
 
 // Cwise product and accumulate of a vector and a batch-vector. Since it's a MAC
 // operation, the assumption here is that result array is initialized to valid
@@ -94,16 +138,27 @@ void NeonVectorBatchVectorCwiseProductAccumulate(const float* vector,
                                                  int v_size,
                                                  const float* batch_vector,
                                                  int n_batch, float* result);
+void Sse4VectorBatchVectorCwiseProductAccumulate(const float* vector,
+                                                 int v_size,
+                                                 const float* batch_vector,
+                                                 int n_batch, float* result);
+void Avx2VectorBatchVectorCwiseProductAccumulate(const float* vector,
+                                                 int v_size,
+                                                 const float* batch_vector,
+                                                 int n_batch, float* result);
 
 // Compute "1.0f - elements of vector" (used in CIFG).
 void PortableSub1Vector(const float* vector, int v_size, float* result);
 void NeonSub1Vector(const float* vector, int v_size, float* result);
+void Sse4Sub1Vector(const float* vector, int v_size, float* result);
 
 // Clip elements of a vector using a abs_limit value.
 void PortableClipVector(const float* vector, int v_size, float abs_limit,
                         float* result);
 void NeonClipVector(const float* vector, int v_size, float abs_limit,
                     float* result);
+void Sse4ClipVector(const float* vector, int v_size, float abs_limit,
+                    float* result);
 
 // Batch vector initialization with another vector.
 void PortableVectorBatchVectorAssign(const float* vector, int v_size,
@@ -129,6 +184,10 @@ void PortableVectorScalarMultiply(const int8_t* vector, int v_size, float scale,
                                   float* result);
 void NeonVectorScalarMultiply(const int8_t* vector, int v_size, float scale,
                               float* result);
+void Sse4VectorScalarMultiply(const int8_t* vector, int v_size, float scale,
+                              float* result);
+void Avx2VectorScalarMultiply(const int8_t* vector, int v_size, float scale,
+                              float* result);
 
 // Limit a float input f between +abs_limit and -abs_limit.
 float PortableClip(float f, float abs_limit);
@@ -136,6 +195,7 @@ float PortableClip(float f, float abs_limit);
 // Check if all entries of a vector are zero.
 bool PortableIsZeroVector(const float* vector, int v_size);
 bool NeonIsZeroVector(const float* vector, int v_size);
+bool Sse4IsZeroVector(const float* vector, int v_size);
 
 // Symmetric quantizer.
 void PortableSymmetricQuantizeFloats(const float* values, const int size,
@@ -144,10 +204,17 @@ void PortableSymmetricQuantizeFloats(const float* values, const int size,
 void NeonSymmetricQuantizeFloats(const float* values, const int size,
                                  int8_t* quantized_values, float* min,
                                  float* max, float* scaling_factor);
+void Sse4SymmetricQuantizeFloats(const float* values, const int size,
+                                 int8_t* quantized_values, float* min,
+                                 float* max, float* scaling_factor);
+void Avx2SymmetricQuantizeFloats(const float* values, const int size,
+                                 int8_t* quantized_values, float* min,
+                                 float* max, float* scaling_factor);
 
 // Shift left a vector in place with v_size size.
 void PortableVectorShiftLeft(float* vector, int v_size, float shift_value);
 void NeonVectorShiftLeft(float* vector, int v_size, float shift_value);
+void Sse4VectorShiftLeft(float* vector, int v_size, float shift_value);
 
 // Reduce-sum on a float input vector:
 // input_vector: float pointer to input vector.
@@ -159,6 +226,8 @@ void PortableReductionSumVector(const float* input_vector, float* output_vector,
                                 int output_size, int reduction_size);
 void NeonReductionSumVector(const float* input_vector, float* output_vector,
                             int output_size, int reduction_size);
+void Sse4ReductionSumVector(const float* input_vector, float* output_vector,
+                            int output_size, int reduction_size);
 
 }  // namespace tensor_utils
 }  // namespace tflite
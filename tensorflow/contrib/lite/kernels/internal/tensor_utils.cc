@@ -21,8 +21,16 @@ limitations under the License.
 #endif  //  defined(__ARM_NEON__) || defined(__ARM_NEON)
 #endif  //  USE_NEON
 
-#ifdef USE_NEON
+#if !defined(USE_NEON) && !defined(USE_SSE)
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define USE_SSE
+#endif  //  (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#endif  //  !defined(USE_NEON) && !defined(USE_SSE)
+
+#if defined(USE_NEON)
 #include "tensorflow/contrib/lite/kernels/internal/optimized/neon_tensor_utils.h"
+#elif defined(USE_SSE)
+#include "tensorflow/contrib/lite/kernels/internal/optimized/sse_tensor_utils.h"
 #else
 #include "tensorflow/contrib/lite/kernels/internal/reference/portable_tensor_utils.h"
-#endif  // USE_NEON
+#endif  // defined(USE_NEON)
@@ -0,0 +1,139 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+// Compares the portable, SSE4 and AVX2 tensor_utils kernels used by the
+// LSTM, RNN and SVDF kernels on the weight shapes of typical models.
+#include <stdio.h>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "tensorflow/contrib/lite/kernels/internal/optimized/cpu_check.h"
+#include "tensorflow/contrib/lite/kernels/internal/optimized/tensor_utils_impl.h"
+#include "tensorflow/contrib/lite/profiling/time.h"
+
+#ifdef USE_SSE
+
+namespace tflite {
+namespace tensor_utils {
+namespace {
+
+constexpr int kMinIterations = 10;
+constexpr uint64_t kMinRunMicros = 200000;
+
+// Returns the average time of a call to "fn" in microseconds.
+double TimeMicros(const std::function<void()>& fn) {
+  fn();  // Warm up.
+  int iterations = 0;
+  const uint64_t start = profiling::time::NowMicros();
+  uint64_t elapsed = 0;
+  while (iterations < kMinIterations || elapsed < kMinRunMicros) {
+    fn();
+    ++iterations;
+    elapsed = profiling::time::NowMicros() - start;
+  }
+  return static_cast<double>(elapsed) / iterations;
+}
+
+struct Shape {
+  int rows;
+  int cols;
+  int batch;
+};
+
+void Report(const char* name, const Shape& shape, double portable, double sse4,
+            double avx2) {
+  printf("%-40s %5dx%-5d batch %-3d %10.2f %10.2f %10.2f", name, shape.rows,
+         shape.cols, shape.batch, portable, sse4, avx2);
+  if (sse4 > 0) printf("  sse4 x%.2f", portable / sse4);
+  if (avx2 > 0) printf("  avx2 x%.2f", portable / avx2);
+  printf("\n");
+}
+
+void BenchmarkShape(const Shape& shape) {
+  const int m_rows = shape.rows;
+  const int m_cols = shape.cols;
+  const int n_batch = shape.batch;
+  const bool has_sse4 = TestCPUFeatureSse4();
+  const bool has_avx2 = TestCPUFeatureAvx2();
+
+  std::vector<float> matrix(m_rows * m_cols);
+  std::vector<float> vectors(n_batch * m_cols);
+  for (size_t i = 0; i < matrix.size(); ++i) {
+    matrix[i] = (i % 17) * 0.1f - 0.8f;
+  }
+  for (size_t i = 0; i < vectors.size(); ++i) {
+    vectors[i] = (i % 13) * 0.1f;
+  }
+  std::vector<float> result(n_batch * m_rows);
+  std::vector<float> batch_result(matrix.size());
+
+  std::vector<int8_t> quantized_matrix(matrix.size());
+  std::vector<int8_t> quantized_vectors(vectors.size());
+  std::vector<float> scaling_factors(n_batch);
+  float min, max;
+  PortableSymmetricQuantizeFloats(matrix.data(), matrix.size(),
+                                  quantized_matrix.data(), &min, &max,
+                                  &scaling_factors[0]);
+  for (int b = 0; b < n_batch; ++b) {
+    PortableSymmetricQuantizeFloats(
+        vectors.data() + b * m_cols, m_cols,
+        quantized_vectors.data() + b * m_cols, &min, &max, &scaling_factors[b]);
+  }
+
+#define TIME_VARIANTS(label, name, ...)                                      \
+  Report(label, shape,                                                       \
+         TimeMicros([&]() { Portable##name(__VA_ARGS__); }),                 \
+         has_sse4 ? TimeMicros([&]() { Sse4##name(__VA_ARGS__); }) : 0,      \
+         has_avx2 ? TimeMicros([&]() { Avx2##name(__VA_ARGS__); }) : 0)
+
+  TIME_VARIANTS("MatrixBatchVectorMultiplyAccumulate",
+                MatrixBatchVectorMultiplyAccumulate, matrix.data(), m_rows,
+                m_cols, vectors.data(), n_batch, result.data(), 1);
+  TIME_VARIANTS("MatrixBatchVectorMultiplyAccumulate/int8",
+                MatrixBatchVectorMultiplyAccumulate, quantized_matrix.data(),
+                m_rows, m_cols, quantized_vectors.data(),
+                scaling_factors.data(), n_batch, result.data(), 1);
+  // The matrix stands in for a batch of m_rows vectors.
+  TIME_VARIANTS("VectorBatchVectorCwiseProductAccumulate",
+                VectorBatchVectorCwiseProductAccumulate, vectors.data(),
+                m_cols, matrix.data(), m_rows, batch_result.data());
+  TIME_VARIANTS("SymmetricQuantizeFloats", SymmetricQuantizeFloats,
+                matrix.data(), m_rows * m_cols, quantized_matrix.data(), &min,
+                &max, &scaling_factors[0]);
+
+#undef TIME_VARIANTS
+}
+
+}  // namespace
+}  // namespace tensor_utils
+}  // namespace tflite
+
+#endif  // USE_SSE
+
+int main(int argc, char** argv) {
+#ifndef USE_SSE
+  printf("The SSE4 and AVX2 kernels are only built for x86.\n");
+#else
+  printf("%-40s %-23s %10s %10s %10s  (microseconds per call)\n", "kernel",
+         "shape", "portable", "sse4", "avx2");
+  const tflite::tensor_utils::Shape kShapes[] = {
+      {512, 512, 1}, {512, 512, 8}, {1024, 256, 1}, {1024, 256, 8}};
+  for (const auto& shape : kShapes) {
+    tflite::tensor_utils::BenchmarkShape(shape);
+  }
+#endif  // USE_SSE
+  return 0;
+}
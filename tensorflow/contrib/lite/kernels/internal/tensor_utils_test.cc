@@ -15,6 +15,8 @@ limitations under the License.
 #include "tensorflow/contrib/lite/kernels/internal/tensor_utils.h"
 #include <gmock/gmock.h>
 #include "tensorflow/contrib/lite/builtin_op_data.h"
+#include "tensorflow/contrib/lite/kernels/internal/optimized/cpu_check.h"
+#include "tensorflow/contrib/lite/kernels/internal/optimized/tensor_utils_impl.h"
 #include "tensorflow/contrib/lite/kernels/test_util.h"
 
 namespace tflite {
@@ -596,5 +598,195 @@ TEST(uKernels, ReductionSumVectorTest) {
   EXPECT_THAT(result2, ElementsAreArray(ArrayFloatNear({1.0, 3.5})));
 }
 
+#ifdef USE_SSE
+
+// Sizes that exercise both the vectorized loops and their postambles.
+const int kSseTestSizes[] = {1, 3, 4, 7, 8, 15, 16, 17, 33, 100};
+
+std::vector<float> RandomFloats(int size) {
+  std::vector<float> values(size);
+  for (int i = 0; i < size; ++i) {
+    values[i] = static_cast<float>((i * 7919) % 199 - 99) / 37.0f;
+  }
+  return values;
+}
+
+std::vector<int8_t> RandomInt8s(int size) {
+  std::vector<int8_t> values(size);
+  for (int i = 0; i < size; ++i) {
+    values[i] = static_cast<int8_t>((i * 7919) % 255 - 127);
+  }
+  return values;
+}
+
+TEST(uKernels, SseMatrixBatchVectorMultiplyAccumulateMatchesPortable) {
+  for (int m_cols : kSseTestSizes) {
+    const int m_rows = 5;
+    const int n_batch = 3;
+    const std::vector<float> matrix = RandomFloats(m_rows * m_cols);
+    const std::vector<float> vector = RandomFloats(n_batch * m_cols);
+    std::vector<float> expected(m_rows * n_batch * 2, 1.0f);
+    PortableMatrixBatchVectorMultiplyAccumulate(matrix.data(), m_rows, m_cols,
+                                                vector.data(), n_batch,
+                                                expected.data(), 2);
+    std::vector<float> result(expected.size(), 1.0f);
+    Sse4MatrixBatchVectorMultiplyAccumulate(matrix.data(), m_rows, m_cols,
+                                            vector.data(), n_batch,
+                                            result.data(), 2);
+    EXPECT_THAT(result, ElementsAreArray(ArrayFloatNear(expected, 1e-4)));
+    if (TestCPUFeatureAvx2()) {
+      result.assign(expected.size(), 1.0f);
+      Avx2MatrixBatchVectorMultiplyAccumulate(matrix.data(), m_rows, m_cols,
+                                              vector.data(), n_batch,
+                                              result.data(), 2);
+      EXPECT_THAT(result, ElementsAreArray(ArrayFloatNear(expected, 1e-4)));
+    }
+  }
+}
+
+TEST(uKernels,
+     SseMatrixBatchVectorMultiplyAccumulateSymmetricQuantizedMatchesPortable) {
+  for (int m_cols : kSseTestSizes) {
+    const int m_rows = 5;
+    const int n_batch = 3;
+    const std::vector<int8_t> matrix = RandomInt8s(m_rows * m_cols);
+    const std::vector<int8_t> vectors = RandomInt8s(n_batch * m_cols + 11);
+    const float scaling_factors[] = {1.0f, 0.5f, 0.25f};
+    std::vector<float> expected(m_rows * n_batch, 1.0f);
+    PortableMatrixBatchVectorMultiplyAccumulate(
+        matrix.data(), m_rows, m_cols, vectors.data() + 11, scaling_factors,
+        n_batch, expected.data(), 1);
+    std::vector<float> result(expected.size(), 1.0f);
+    Sse4MatrixBatchVectorMultiplyAccumulate(
+        matrix.data(), m_rows, m_cols, vectors.data() + 11, scaling_factors,
+        n_batch, result.data(), 1);
+    EXPECT_EQ(expected, result);
+    if (TestCPUFeatureAvx2()) {
+      result.assign(expected.size(), 1.0f);
+      Avx2MatrixBatchVectorMultiplyAccumulate(
+          matrix.data(), m_rows, m_cols, vectors.data() + 11, scaling_factors,
+          n_batch, result.data(), 1);
+      EXPECT_EQ(expected, result);
+    }
+  }
+}
+
+TEST(uKernels, SseVectorOpsMatchPortable) {
+  for (int size : kSseTestSizes) {
+    const std::vector<float> vector1 = RandomFloats(size);
+    const std::vector<float> vector2 = RandomFloats(size + 5);
+    std::vector<float> expected(size, 0.5f);
+    std::vector<float> result(size, 0.5f);
+
+    PortableVectorVectorCwiseProductAccumulate(
+        vector1.data(), vector2.data() + 5, size, expected.data());
+    Sse4VectorVectorCwiseProductAccumulate(vector1.data(), vector2.data() + 5,
+                                           size, result.data());
+    EXPECT_THAT(result, ElementsAreArray(ArrayFloatNear(expected)));
+
+    PortableSub1Vector(vector1.data(), size, expected.data());
+    Sse4Sub1Vector(vector1.data(), size, result.data());
+    EXPECT_THAT(result, ElementsAreArray(ArrayFloatNear(expected)));
+
+    PortableClipVector(vector1.data(), size, 1.0f, expected.data());
+    Sse4ClipVector(vector1.data(), size, 1.0f, result.data());
+    EXPECT_THAT(result, ElementsAreArray(ArrayFloatNear(expected)));
+
+    EXPECT_NEAR(
+        PortableVectorVectorDotProduct(vector1.data(), vector2.data(), size),
+        Sse4VectorVectorDotProduct(vector1.data(), vector2.data(), size),
+        1e-4);
+
+    const std::vector<int8_t> int8s = RandomInt8s(size);
+    PortableVectorScalarMultiply(int8s.data(), size, 0.1f, expected.data());
+    Sse4VectorScalarMultiply(int8s.data(), size, 0.1f, result.data());
+    EXPECT_THAT(result, ElementsAreArray(ArrayFloatNear(expected)));
+
+    std::vector<float> shifted = vector1;
+    PortableVectorShiftLeft(shifted.data(), size, 2.0f);
+    std::vector<float> sse_shifted = vector1;
+    Sse4VectorShiftLeft(sse_shifted.data(), size, 2.0f);
+    EXPECT_EQ(shifted, sse_shifted);
+
+    if (TestCPUFeatureAvx2()) {
+      PortableVectorVectorCwiseProduct(vector1.data(), vector2.data(), size,
+                                       expected.data());
+      Avx2VectorVectorCwiseProduct(vector1.data(), vector2.data(), size,
+                                   result.data());
+      EXPECT_THAT(result, ElementsAreArray(ArrayFloatNear(expected)));
+
+      EXPECT_NEAR(
+          PortableVectorVectorDotProduct(vector1.data(), vector2.data(), size),
+          Avx2VectorVectorDotProduct(vector1.data(), vector2.data(), size),
+          1e-4);
+
+      PortableVectorScalarMultiply(int8s.data(), size, 0.1f, expected.data());
+      Avx2VectorScalarMultiply(int8s.data(), size, 0.1f, result.data());
+      EXPECT_THAT(result, ElementsAreArray(ArrayFloatNear(expected)));
+    }
+  }
+}
+
+TEST(uKernels, SseSymmetricQuantizeFloatsMatchesPortable) {
+  for (int size : kSseTestSizes) {
+    const std::vector<float> values = RandomFloats(size);
+    std::vector<int8_t> expected(size);
+    float expected_min, expected_max, expected_scaling_factor;
+    PortableSymmetricQuantizeFloats(values.data(), size, expected.data(),
+                                    &expected_min, &expected_max,
+                                    &expected_scaling_factor);
+
+    std::vector<int8_t> result(size);
+    float min, max, scaling_factor;
+    Sse4SymmetricQuantizeFloats(values.data(), size, result.data(), &min, &max,
+                                &scaling_factor);
+    EXPECT_EQ(expected_min, min);
+    EXPECT_EQ(expected_max, max);
+    EXPECT_EQ(expected_scaling_factor, scaling_factor);
+    EXPECT_EQ(expected, result);
+
+    if (TestCPUFeatureAvx2()) {
+      Avx2SymmetricQuantizeFloats(values.data(), size, result.data(), &min,
+                                  &max, &scaling_factor);
+      EXPECT_EQ(expected_min, min);
+      EXPECT_EQ(expected_max, max);
+      EXPECT_EQ(expected_scaling_factor, scaling_factor);
+      EXPECT_EQ(expected, result);
+    }
+  }
+}
+
+TEST(uKernels, SseSymmetricQuantizeFloatsRoundsLikePortable) {
+  // With a maximum of 127 the scaling factor is 1, so the values below are
+  // rounded as they are. 0.49999997f is the largest float below 0.5f.
+  const std::vector<float> pattern = {127.0f, 0.49999997f, -0.49999997f,
+                                      0.5f,   -0.5f,       1.5f,
+                                      -2.5f,  2.49999976f};
+  std::vector<float> values;
+  for (int i = 0; i < 4; ++i) {
+    values.insert(values.end(), pattern.begin(), pattern.end());
+  }
+  const int size = values.size();
+  std::vector<int8_t> expected(size);
+  float min, max, scaling_factor;
+  PortableSymmetricQuantizeFloats(values.data(), size, expected.data(), &min,
+                                  &max, &scaling_factor);
+  EXPECT_EQ(1.0f, scaling_factor);
+  EXPECT_THAT(std::vector<int8_t>(expected.begin(), expected.begin() + 8),
+              ElementsAreArray({127, 0, 0, 1, -1, 2, -3, 2}));
+
+  std::vector<int8_t> result(size);
+  Sse4SymmetricQuantizeFloats(values.data(), size, result.data(), &min, &max,
+                              &scaling_factor);
+  EXPECT_EQ(expected, result);
+  if (TestCPUFeatureAvx2()) {
+    Avx2SymmetricQuantizeFloats(values.data(), size, result.data(), &min, &max,
+                                &scaling_factor);
+    EXPECT_EQ(expected, result);
+  }
+}
+
+#endif  // USE_SSE
+
 }  // namespace tensor_utils
 }  // namespace tflite
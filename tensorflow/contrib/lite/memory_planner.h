@@ -38,6 +38,12 @@ class MemoryPlanner {
   // have changed. All planned allocations remain, but can't be used until
   // ExecuteAllocations() is called.
   virtual TfLiteStatus ResetAllocations() = 0;
+
+  // Returns the number of bytes needed by the tensors allocated so far, in the
+  // arena shared by the intermediate tensors and in the one that holds
+  // persistent tensors.
+  virtual void GetAllocInfo(size_t* arena_size,
+                            size_t* arena_persist_size) const = 0;
 };
 
 }  // namespace tflite
@@ -15,6 +15,7 @@ limitations under the License.
 #ifndef TENSORFLOW_CONTRIB_LITE_SIMPLE_MEMORY_ARENA_H_
 #define TENSORFLOW_CONTRIB_LITE_SIMPLE_MEMORY_ARENA_H_
 
+#include <algorithm>
 #include <list>
 #include <memory>
 #include "tensorflow/contrib/lite/context.h"
@@ -55,6 +56,16 @@ class SimpleMemoryArena {
 
   TfLiteStatus Deallocate(TfLiteContext* context, const ArenaAlloc& alloc);
 
+  // Makes room for allocations at offsets chosen by the caller, up to 'size'
+  // bytes. Such allocations are not tracked by the arena, and must not be
+  // passed to Deallocate().
+  void Reserve(size_t size) {
+    high_water_mark_ = std::max(high_water_mark_, size);
+  }
+
+  // Returns the number of bytes needed by all the allocations so far.
+  size_t high_water_mark() const { return high_water_mark_; }
+
   inline size_t RequiredBufferSize() {
     // Add in a small amount of padding to reduce the chance of resize events
     // for small allocations.
@@ -0,0 +1,83 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/contrib/lite/thread_pool.h"
+
+namespace tflite {
+
+ThreadPool::ThreadPool(int num_threads) {
+  for (int i = 1; i < num_threads; ++i) {
+    workers_.emplace_back([this]() { WorkerLoop(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  work_available_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPool::ParallelFor(int n, const std::function<void(int)>& fn) {
+  if (workers_.empty() || n <= 1) {
+    for (int i = 0; i < n; ++i) {
+      fn(i);
+    }
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  fn_ = &fn;
+  num_iterations_ = n;
+  next_iteration_ = 0;
+  num_iterations_done_ = 0;
+  ++generation_;
+  work_available_.notify_all();
+
+  RunIterations(&lock);
+  work_done_.wait(lock, [this, n]() { return num_iterations_done_ == n; });
+  fn_ = nullptr;
+}
+
+void ThreadPool::WorkerLoop() {
+  int generation_seen = 0;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    work_available_.wait(lock, [this, &generation_seen]() {
+      return stopping_ || generation_ != generation_seen;
+    });
+    if (stopping_) return;
+    generation_seen = generation_;
+    RunIterations(&lock);
+  }
+}
+
+void ThreadPool::RunIterations(std::unique_lock<std::mutex>* lock) {
+  while (next_iteration_ < num_iterations_) {
+    const int i = next_iteration_++;
+    const std::function<void(int)>& fn = *fn_;
+    lock->unlock();
+    fn(i);
+    lock->lock();
+    if (++num_iterations_done_ == num_iterations_) {
+      work_done_.notify_all();
+    }
+  }
+}
+
+}  // namespace tflite
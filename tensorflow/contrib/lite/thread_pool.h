@@ -0,0 +1,67 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CONTRIB_LITE_THREAD_POOL_H_
+#define TENSORFLOW_CONTRIB_LITE_THREAD_POOL_H_
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tflite {
+
+// A fixed set of threads that run the iterations of a loop concurrently. The
+// interpreter uses it to run independent nodes side by side.
+class ThreadPool {
+ public:
+  // Starts 'num_threads' - 1 worker threads; the thread that calls
+  // ParallelFor() does its share of the work too.
+  explicit ThreadPool(int num_threads);
+  ~ThreadPool();
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  int num_threads() const { return workers_.size() + 1; }
+
+  // Calls 'fn(i)' for every 'i' in [0, n) and returns once all the calls are
+  // done. Only one ParallelFor() may run at a time.
+  void ParallelFor(int n, const std::function<void(int)>& fn);
+
+ private:
+  void WorkerLoop();
+
+  // Runs iterations of the current loop until none are left. 'lock' holds
+  // 'mutex_' and is released while an iteration runs.
+  void RunIterations(std::unique_lock<std::mutex>* lock);
+
+  std::vector<std::thread> workers_;
+
+  std::mutex mutex_;
+  std::condition_variable work_available_;
+  std::condition_variable work_done_;
+  // The current loop, guarded by 'mutex_'. 'generation_' counts the loops so
+  // far, so that idle workers can tell when a new one starts.
+  const std::function<void(int)>* fn_ = nullptr;
+  int num_iterations_ = 0;
+  int next_iteration_ = 0;
+  int num_iterations_done_ = 0;
+  int generation_ = 0;
+  bool stopping_ = false;
+};
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_CONTRIB_LITE_THREAD_POOL_H_
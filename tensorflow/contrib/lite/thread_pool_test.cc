@@ -0,0 +1,68 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/contrib/lite/thread_pool.h"
+
+#include <atomic>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "tensorflow/contrib/lite/testing/util.h"
+
+namespace tflite {
+namespace {
+
+TEST(ThreadPoolTest, RunsEveryIterationOnce) {
+  ThreadPool pool(4);
+  EXPECT_EQ(pool.num_threads(), 4);
+  for (int n : {0, 1, 3, 100}) {
+    std::vector<std::atomic<int>> counts(n);
+    for (auto& count : counts) count = 0;
+    pool.ParallelFor(n, [&counts](int i) { ++counts[i]; });
+    for (int i = 0; i < n; ++i) {
+      EXPECT_EQ(counts[i], 1) << "iteration " << i << " of " << n;
+    }
+  }
+}
+
+TEST(ThreadPoolTest, RunsIterationsConcurrently) {
+  ThreadPool pool(2);
+  // Each iteration waits for the other one, so this only returns if they
+  // run at the same time.
+  std::atomic<int> started(0);
+  pool.ParallelFor(2, [&started](int) {
+    ++started;
+    while (started < 2) {
+    }
+  });
+  EXPECT_EQ(started, 2);
+}
+
+TEST(ThreadPoolTest, SingleThread) {
+  ThreadPool pool(1);
+  EXPECT_EQ(pool.num_threads(), 1);
+  int sum = 0;
+  pool.ParallelFor(10, [&sum](int i) { sum += i; });
+  EXPECT_EQ(sum, 45);
+}
+
+}  // namespace
+}  // namespace tflite
+
+int main(int argc, char** argv) {
+  ::tflite::LogToStderr();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,80 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+// Reports the tensor arena size each memory planning strategy needs for the
+// given models, e.g.
+//
+//   arena_size_report tensorflow/contrib/lite/testdata/multi_add.bin \
+//       /tmp/mobilenet_v1_1.0_224.tflite
+//
+// Models that cannot be loaded or allocated, for instance because they use
+// custom ops, are reported and skipped.
+#include <stdio.h>
+
+#include <memory>
+
+#include "tensorflow/contrib/lite/interpreter.h"
+#include "tensorflow/contrib/lite/kernels/register.h"
+#include "tensorflow/contrib/lite/model.h"
+
+namespace tflite {
+namespace {
+
+// Returns false if "model" cannot be planned with the given strategy.
+bool GetArenaSize(const FlatBufferModel& model, bool largest_first,
+                  size_t* arena_size, size_t* arena_persist_size) {
+  ops::builtin::BuiltinOpResolver resolver;
+  std::unique_ptr<Interpreter> interpreter;
+  if (InterpreterBuilder(model, resolver)(&interpreter) != kTfLiteOk) {
+    return false;
+  }
+  if (interpreter->UseLargestFirstMemoryPlanning(largest_first) != kTfLiteOk ||
+      interpreter->AllocateTensors() != kTfLiteOk) {
+    return false;
+  }
+  interpreter->GetArenaSizes(arena_size, arena_persist_size);
+  return true;
+}
+
+}  // namespace
+}  // namespace tflite
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s model.tflite...\n", argv[0]);
+    return 1;
+  }
+  printf("%-60s %14s %14s %8s %12s\n", "model", "in order", "largest first",
+         "saved", "persistent");
+  size_t total_in_order = 0;
+  size_t total_largest_first = 0;
+  for (int i = 1; i < argc; ++i) {
+    auto model = tflite::FlatBufferModel::BuildFromFile(argv[i]);
+    size_t in_order, largest_first, persist;
+    if (!model ||
+        !tflite::GetArenaSize(*model, false, &in_order, &persist) ||
+        !tflite::GetArenaSize(*model, true, &largest_first, &persist)) {
+      printf("%-60s skipped\n", argv[i]);
+      continue;
+    }
+    const double saved =
+        in_order == 0 ? 0 : 100.0 * (1.0 - 1.0 * largest_first / in_order);
+    printf("%-60s %14zu %14zu %7.1f%% %12zu\n", argv[i], in_order,
+           largest_first, saved, persist);
+    total_in_order += in_order;
+    total_largest_first += largest_first;
+  }
+  printf("%-60s %14zu %14zu\n", "total", total_in_order, total_largest_first);
+  return 0;
+}
@@ -0,0 +1,340 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/caching_allocator.h"
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+namespace {
+// Smallest size class. BFCAllocator rounds every request up to 256 bytes
+// anyway.
+constexpr size_t kMinSizeClassBytes = 256;
+// Number of size classes per power of two, bounding the internal
+// fragmentation from rounding up to 25%.
+constexpr int kSizeClassesPerDoubling = 4;
+}  // namespace
+
+constexpr int CachingAllocator::kNumPtrShards;
+
+string CachingAllocator::CacheStats::DebugString() const {
+  return strings::StrCat("Hits:        ", num_hits, "\nMisses:      ",
+                         num_misses, "\nHitRate:     ", hit_rate(),
+                         "\nFlushed:     ", num_flushed,
+                         "\nBytesCached: ", bytes_cached, "\n");
+}
+
+CachingAllocator::CachingAllocator(VisitableAllocator* wrapped,
+                                   const Options& options, const string& name)
+    : wrapped_(wrapped),
+      options_(options),
+      name_(name),
+      bytes_cached_(0),
+      num_flushed_(0) {
+  for (size_t base = kMinSizeClassBytes;
+       base <= options_.max_cached_allocation_size; base *= 2) {
+    const size_t step = base / kSizeClassesPerDoubling;
+    for (int i = 0; i < kSizeClassesPerDoubling; ++i) {
+      const size_t bytes = base + i * step;
+      if (bytes > options_.max_cached_allocation_size) break;
+      size_class_bytes_.push_back(bytes);
+    }
+  }
+  num_shards_ = options_.num_shards > 0 ? options_.num_shards
+                                        : 2 * port::NumSchedulableCPUs();
+  num_shards_ = std::max(num_shards_, 1);
+  shards_.reset(new Shard[num_shards_]);
+  for (int i = 0; i < num_shards_; ++i) {
+    mutex_lock l(shards_[i].mu);
+    shards_[i].free_lists.resize(size_class_bytes_.size());
+  }
+  ptr_shards_.reset(new PtrShard[kNumPtrShards]);
+  VLOG(1) << "CachingAllocator " << name_ << " wrapping " << wrapped_->Name()
+          << " with " << num_shards_ << " shards and "
+          << size_class_bytes_.size() << " size classes";
+}
+
+CachingAllocator::~CachingAllocator() {
+  Flush();
+  CacheStats stats;
+  GetCacheStats(&stats);
+  VLOG(1) << "CachingAllocator " << name_ << " stats:\n"
+          << stats.DebugString();
+}
+
+int CachingAllocator::SizeClass(size_t num_bytes) const {
+  if (num_bytes == 0 || num_bytes > options_.max_cached_allocation_size) {
+    return -1;
+  }
+  auto it = std::lower_bound(size_class_bytes_.begin(),
+                             size_class_bytes_.end(), num_bytes);
+  if (it == size_class_bytes_.end()) return -1;
+  return static_cast<int>(it - size_class_bytes_.begin());
+}
+
+CachingAllocator::Shard* CachingAllocator::ShardForCurrentThread() {
+  static std::hash<std::thread::id> hasher;
+  return &shards_[hasher(std::this_thread::get_id()) % num_shards_];
+}
+
+CachingAllocator::PtrShard* CachingAllocator::PtrShardFor(const void* ptr) {
+  // Chunks are at least kMinSizeClassBytes apart, so skip the low bits.
+  const uintptr_t bits = reinterpret_cast<uintptr_t>(ptr) >> 8;
+  return &ptr_shards_[(bits ^ (bits >> 6)) % kNumPtrShards];
+}
+
+void* CachingAllocator::AllocateRaw(size_t alignment, size_t num_bytes) {
+  return AllocateRaw(alignment, num_bytes, AllocationAttributes());
+}
+
+void* CachingAllocator::AllocateRaw(
+    size_t alignment, size_t num_bytes,
+    const AllocationAttributes& allocation_attr) {
+  // Cached chunks are all allocated with kAllocatorAlignment, so they can
+  // only serve requests with a smaller or equal alignment.
+  const int size_class = alignment <= Allocator::kAllocatorAlignment
+                             ? SizeClass(num_bytes)
+                             : -1;
+  if (size_class < 0) {
+    return AllocateFromWrapped(alignment, num_bytes, allocation_attr);
+  }
+  return AllocateCached(num_bytes, size_class, allocation_attr);
+}
+
+void* CachingAllocator::AllocateCached(
+    size_t num_bytes, int size_class,
+    const AllocationAttributes& allocation_attr) {
+  void* ptr = nullptr;
+  Shard* shard = ShardForCurrentThread();
+  {
+    mutex_lock l(shard->mu);
+    FreeList& free_list = shard->free_lists[size_class];
+    if (!free_list.chunks.empty()) {
+      ptr = free_list.chunks.back();
+      free_list.chunks.pop_back();
+      free_list.low_water =
+          std::min(free_list.low_water, free_list.chunks.size());
+      shard->bytes_cached -= size_class_bytes_[size_class];
+      ++shard->num_hits;
+    } else {
+      ++shard->num_misses;
+    }
+  }
+  if (ptr != nullptr) {
+    bytes_cached_.fetch_sub(size_class_bytes_[size_class],
+                            std::memory_order_relaxed);
+  } else {
+    ptr = AllocateFromWrapped(Allocator::kAllocatorAlignment,
+                              size_class_bytes_[size_class], allocation_attr);
+    if (ptr == nullptr) return nullptr;
+  }
+  PtrShard* ptr_shard = PtrShardFor(ptr);
+  mutex_lock l(ptr_shard->mu);
+  ptr_shard->chunks[ptr] = ChunkInfo{size_class, num_bytes};
+  return ptr;
+}
+
+void* CachingAllocator::AllocateFromWrapped(
+    size_t alignment, size_t num_bytes,
+    const AllocationAttributes& allocation_attr) {
+  if (bytes_cached_.load(std::memory_order_relaxed) > 0) {
+    // Memory held by the caches may be what the wrapped allocator is
+    // missing, so do not let it wait for other threads to free memory
+    // before the caches are flushed.
+    AllocationAttributes no_retry_attr = allocation_attr;
+    no_retry_attr.no_retry_on_failure = true;
+    void* ptr = wrapped_->AllocateRaw(alignment, num_bytes, no_retry_attr);
+    if (ptr != nullptr) return ptr;
+    VLOG(1) << name_ << ": flushing caches after failing to allocate "
+            << num_bytes << " bytes";
+    Flush();
+  }
+  return wrapped_->AllocateRaw(alignment, num_bytes, allocation_attr);
+}
+
+void CachingAllocator::DeallocateRaw(void* ptr) {
+  if (ptr == nullptr) return;
+  int size_class = -1;
+  {
+    PtrShard* ptr_shard = PtrShardFor(ptr);
+    mutex_lock l(ptr_shard->mu);
+    auto it = ptr_shard->chunks.find(ptr);
+    if (it != ptr_shard->chunks.end()) {
+      size_class = it->second.size_class;
+      ptr_shard->chunks.erase(it);
+    }
+  }
+  if (size_class < 0) {
+    wrapped_->DeallocateRaw(ptr);
+    return;
+  }
+
+  const size_t bytes = size_class_bytes_[size_class];
+  std::vector<void*> to_release;
+  size_t released_bytes = 0;
+  Shard* shard = ShardForCurrentThread();
+  {
+    mutex_lock l(shard->mu);
+    shard->free_lists[size_class].chunks.push_back(ptr);
+    shard->bytes_cached += bytes;
+    if (++shard->deallocs_since_flush >= options_.flush_interval) {
+      // Periodic flush of the chunks that were not reused recently.
+      released_bytes += CollectForRelease(shard, false /*all*/, &to_release);
+      shard->deallocs_since_flush = 0;
+    }
+    if (shard->bytes_cached > options_.max_cached_bytes_per_shard) {
+      // Over the limit: give back the oldest chunks of this size class
+      // first, then of the largest size classes, until the shard is at half
+      // its limit.
+      const size_t target = options_.max_cached_bytes_per_shard / 2;
+      for (int c = -1; c < static_cast<int>(size_class_bytes_.size()) &&
+                       shard->bytes_cached > target;
+           ++c) {
+        const int cls =
+            c < 0 ? size_class
+                  : static_cast<int>(size_class_bytes_.size()) - 1 - c;
+        FreeList& free_list = shard->free_lists[cls];
+        size_t n = 0;
+        while (n < free_list.chunks.size() && shard->bytes_cached > target) {
+          to_release.push_back(free_list.chunks[n++]);
+          shard->bytes_cached -= size_class_bytes_[cls];
+          released_bytes += size_class_bytes_[cls];
+        }
+        free_list.chunks.erase(free_list.chunks.begin(),
+                               free_list.chunks.begin() + n);
+        free_list.low_water = std::min(free_list.low_water,
+                                       free_list.chunks.size());
+      }
+    }
+  }
+  bytes_cached_.fetch_add(
+      static_cast<int64>(bytes) - static_cast<int64>(released_bytes),
+      std::memory_order_relaxed);
+  Release(to_release);
+}
+
+size_t CachingAllocator::CollectForRelease(Shard* shard, bool all,
+                                           std::vector<void*>* to_release) {
+  size_t released_bytes = 0;
+  for (int c = 0; c < static_cast<int>(shard->free_lists.size()); ++c) {
+    FreeList& free_list = shard->free_lists[c];
+    const size_t n = all ? free_list.chunks.size()
+                         : std::min(free_list.low_water,
+                                    free_list.chunks.size());
+    // The oldest chunks are at the front.
+    to_release->insert(to_release->end(), free_list.chunks.begin(),
+                       free_list.chunks.begin() + n);
+    free_list.chunks.erase(free_list.chunks.begin(),
+                           free_list.chunks.begin() + n);
+    free_list.low_water = free_list.chunks.size();
+    shard->bytes_cached -= n * size_class_bytes_[c];
+    released_bytes += n * size_class_bytes_[c];
+  }
+  return released_bytes;
+}
+
+void CachingAllocator::Release(const std::vector<void*>& chunks) {
+  if (chunks.empty()) return;
+  for (void* ptr : chunks) {
+    wrapped_->DeallocateRaw(ptr);
+  }
+  num_flushed_.fetch_add(chunks.size(), std::memory_order_relaxed);
+}
+
+void CachingAllocator::Flush() {
+  for (int i = 0; i < num_shards_; ++i) {
+    std::vector<void*> to_release;
+    size_t released_bytes;
+    {
+      Shard* shard = &shards_[i];
+      mutex_lock l(shard->mu);
+      released_bytes = CollectForRelease(shard, true /*all*/, &to_release);
+    }
+    bytes_cached_.fetch_sub(released_bytes, std::memory_order_relaxed);
+    Release(to_release);
+  }
+}
+
+void CachingAllocator::AddAllocVisitor(Visitor visitor) {
+  wrapped_->AddAllocVisitor(visitor);
+}
+
+void CachingAllocator::AddFreeVisitor(Visitor visitor) {
+  wrapped_->AddFreeVisitor(visitor);
+}
+
+bool CachingAllocator::TracksAllocationSizes() {
+  return wrapped_->TracksAllocationSizes();
+}
+
+size_t CachingAllocator::RequestedSize(const void* ptr) {
+  {
+    PtrShard* ptr_shard = PtrShardFor(ptr);
+    mutex_lock l(ptr_shard->mu);
+    auto it = ptr_shard->chunks.find(ptr);
+    if (it != ptr_shard->chunks.end()) return it->second.requested_size;
+  }
+  return wrapped_->RequestedSize(ptr);
+}
+
+size_t CachingAllocator::AllocatedSize(const void* ptr) {
+  return wrapped_->AllocatedSize(ptr);
+}
+
+int64 CachingAllocator::AllocationId(const void* ptr) {
+  return wrapped_->AllocationId(ptr);
+}
+
+void CachingAllocator::GetStats(AllocatorStats* stats) {
+  wrapped_->GetStats(stats);
+  int64 num_hits = 0;
+  for (int i = 0; i < num_shards_; ++i) {
+    mutex_lock l(shards_[i].mu);
+    num_hits += shards_[i].num_hits;
+  }
+  // Allocations served from the caches never reach the wrapped allocator.
+  stats->num_allocs += num_hits;
+  stats->bytes_in_use -= bytes_cached_.load(std::memory_order_relaxed);
+}
+
+void CachingAllocator::ClearStats() {
+  wrapped_->ClearStats();
+  for (int i = 0; i < num_shards_; ++i) {
+    mutex_lock l(shards_[i].mu);
+    shards_[i].num_hits = 0;
+    shards_[i].num_misses = 0;
+  }
+  num_flushed_ = 0;
+}
+
+void CachingAllocator::GetCacheStats(CacheStats* stats) {
+  *stats = CacheStats();
+  for (int i = 0; i < num_shards_; ++i) {
+    mutex_lock l(shards_[i].mu);
+    stats->num_hits += shards_[i].num_hits;
+    stats->num_misses += shards_[i].num_misses;
+  }
+  stats->num_flushed = num_flushed_.load(std::memory_order_relaxed);
+  stats->bytes_cached = bytes_cached_.load(std::memory_order_relaxed);
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,179 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_CACHING_ALLOCATOR_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_CACHING_ALLOCATOR_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/visitable_allocator.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// A front end for an allocator with a single global lock, such as
+// BFCAllocator, that keeps recently freed small chunks in lock-sharded
+// caches.
+//
+// Each calling thread is mapped to one of several shards. Every shard keeps
+// one free list per size class; AllocateRaw first tries to pop a chunk from
+// the calling thread's shard and only falls back to the wrapped allocator on
+// a miss. Chunks that have sat unused in a shard for a whole flush interval
+// are returned to the wrapped allocator, as is everything above a per-shard
+// byte limit, so that the cache does not hold on to memory that other
+// threads or other size classes need. If the wrapped allocator runs out of
+// memory, all the caches are flushed and the allocation is retried.
+//
+// The wrapper never touches the memory it hands out, so it can be used for
+// both host and device allocators.
+class CachingAllocator : public VisitableAllocator {
+ public:
+  struct Options {
+    // Number of cache shards. If 0, uses twice the number of schedulable
+    // CPUs.
+    int num_shards = 0;
+
+    // Allocations larger than this bypass the cache.
+    size_t max_cached_allocation_size = 64 << 10;
+
+    // Maximum number of bytes kept by a single shard.
+    size_t max_cached_bytes_per_shard = 4 << 20;
+
+    // Number of deallocations into a shard between two flushes of the
+    // chunks that were not reused since the previous flush.
+    int64 flush_interval = 1 << 14;
+  };
+
+  struct CacheStats {
+    int64 num_hits = 0;     // Allocations served from a cache.
+    int64 num_misses = 0;   // Cacheable allocations that were not.
+    int64 num_flushed = 0;  // Chunks returned to the wrapped allocator.
+    int64 bytes_cached = 0;
+
+    double hit_rate() const {
+      const int64 total = num_hits + num_misses;
+      return total == 0 ? 0.0 : static_cast<double>(num_hits) / total;
+    }
+    string DebugString() const;
+  };
+
+  // Takes ownership of "wrapped".
+  CachingAllocator(VisitableAllocator* wrapped, const Options& options,
+                   const string& name);
+  ~CachingAllocator() override;
+
+  string Name() override { return name_; }
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override;
+  void* AllocateRaw(size_t alignment, size_t num_bytes,
+                    const AllocationAttributes& allocation_attr) override;
+  void DeallocateRaw(void* ptr) override;
+
+  void AddAllocVisitor(Visitor visitor) override;
+  void AddFreeVisitor(Visitor visitor) override;
+
+  bool TracksAllocationSizes() override;
+  size_t RequestedSize(const void* ptr) override;
+  size_t AllocatedSize(const void* ptr) override;
+  int64 AllocationId(const void* ptr) override;
+
+  // Bytes sitting in the caches are not reported as in use.
+  void GetStats(AllocatorStats* stats) override;
+  void ClearStats() override;
+
+  void GetCacheStats(CacheStats* stats);
+
+  // Returns every cached chunk to the wrapped allocator.
+  void Flush();
+
+  // Returns the size class that "num_bytes" is rounded up to, or -1 if
+  // "num_bytes" is not cacheable. Visible for testing.
+  int SizeClass(size_t num_bytes) const;
+  size_t SizeClassBytes(int size_class) const {
+    return size_class_bytes_[size_class];
+  }
+
+ private:
+  // What is known about a chunk handed out from a size class.
+  struct ChunkInfo {
+    int size_class;
+    size_t requested_size;
+  };
+
+  struct FreeList {
+    // Most recently freed chunk last.
+    std::vector<void*> chunks;
+    // Smallest size of "chunks" since the last flush. That many chunks were
+    // not reused during the whole interval.
+    size_t low_water = 0;
+  };
+
+  struct Shard {
+    mutex mu;
+    std::vector<FreeList> free_lists GUARDED_BY(mu);
+    size_t bytes_cached GUARDED_BY(mu) = 0;
+    int64 deallocs_since_flush GUARDED_BY(mu) = 0;
+    int64 num_hits GUARDED_BY(mu) = 0;
+    int64 num_misses GUARDED_BY(mu) = 0;
+  };
+
+  // Chunks handed out from a size class, sharded by address.
+  struct PtrShard {
+    mutex mu;
+    std::unordered_map<const void*, ChunkInfo> chunks GUARDED_BY(mu);
+  };
+
+  void* AllocateCached(size_t num_bytes, int size_class,
+                       const AllocationAttributes& allocation_attr);
+  void* AllocateFromWrapped(size_t alignment, size_t num_bytes,
+                            const AllocationAttributes& allocation_attr);
+
+  // Moves the chunks of "shard" picked by the flush policy into
+  // "to_release" and returns their total size. If "all", picks everything.
+  size_t CollectForRelease(Shard* shard, bool all,
+                           std::vector<void*>* to_release)
+      EXCLUSIVE_LOCKS_REQUIRED(shard->mu);
+  void Release(const std::vector<void*>& chunks);
+
+  Shard* ShardForCurrentThread();
+  PtrShard* PtrShardFor(const void* ptr);
+
+  std::unique_ptr<VisitableAllocator> wrapped_;
+  const Options options_;
+  const string name_;
+
+  // Sorted, ascending.
+  std::vector<size_t> size_class_bytes_;
+
+  int num_shards_;
+  std::unique_ptr<Shard[]> shards_;
+  static constexpr int kNumPtrShards = 64;
+  std::unique_ptr<PtrShard[]> ptr_shards_;
+
+  std::atomic<int64> bytes_cached_;
+  std::atomic<int64> num_flushed_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(CachingAllocator);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_CACHING_ALLOCATOR_H_
@@ -0,0 +1,258 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/caching_allocator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/bfc_allocator.h"
+#include "tensorflow/core/common_runtime/pool_allocator.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace {
+
+VisitableAllocator* NewCPUBFCAllocator() {
+  return new BFCAllocator(new BasicCPUAllocator(-1), 1LL << 30,
+                          true /*allow_growth*/, "cpu_bfc");
+}
+
+CachingAllocator::Options TestOptions() {
+  CachingAllocator::Options options;
+  options.num_shards = 1;
+  return options;
+}
+
+TEST(CachingAllocatorTest, SizeClasses) {
+  CachingAllocator a(NewCPUBFCAllocator(), TestOptions(), "cached");
+  EXPECT_EQ(-1, a.SizeClass(0));
+  EXPECT_EQ(256, a.SizeClassBytes(a.SizeClass(1)));
+  EXPECT_EQ(256, a.SizeClassBytes(a.SizeClass(256)));
+  EXPECT_EQ(320, a.SizeClassBytes(a.SizeClass(257)));
+  EXPECT_EQ(1024, a.SizeClassBytes(a.SizeClass(1000)));
+  EXPECT_EQ(1280, a.SizeClassBytes(a.SizeClass(1025)));
+  EXPECT_EQ(64 << 10, a.SizeClassBytes(a.SizeClass(64 << 10)));
+  EXPECT_EQ(-1, a.SizeClass((64 << 10) + 1));
+  // Rounding up never wastes more than 25%.
+  for (size_t n = 256; n <= (64 << 10); n += 7) {
+    const size_t rounded = a.SizeClassBytes(a.SizeClass(n));
+    EXPECT_GE(rounded, n);
+    EXPECT_LE(rounded, n + n / 4);
+  }
+}
+
+TEST(CachingAllocatorTest, ReusesFreedChunks) {
+  CachingAllocator a(NewCPUBFCAllocator(), TestOptions(), "cached");
+  void* p1 = a.AllocateRaw(Allocator::kAllocatorAlignment, 1000);
+  ASSERT_NE(p1, nullptr);
+  EXPECT_EQ(1000, a.RequestedSize(p1));
+  a.DeallocateRaw(p1);
+  void* p2 = a.AllocateRaw(Allocator::kAllocatorAlignment, 900);
+  EXPECT_EQ(p1, p2);
+  EXPECT_EQ(900, a.RequestedSize(p2));
+  a.DeallocateRaw(p2);
+
+  CachingAllocator::CacheStats stats;
+  a.GetCacheStats(&stats);
+  EXPECT_EQ(1, stats.num_hits);
+  EXPECT_EQ(1, stats.num_misses);
+  EXPECT_EQ(0.5, stats.hit_rate());
+  EXPECT_EQ(1024, stats.bytes_cached);
+}
+
+TEST(CachingAllocatorTest, LargeAllocationsBypassCache) {
+  CachingAllocator a(NewCPUBFCAllocator(), TestOptions(), "cached");
+  void* p = a.AllocateRaw(Allocator::kAllocatorAlignment, 1 << 20);
+  ASSERT_NE(p, nullptr);
+  a.DeallocateRaw(p);
+  CachingAllocator::CacheStats stats;
+  a.GetCacheStats(&stats);
+  EXPECT_EQ(0, stats.num_hits);
+  EXPECT_EQ(0, stats.num_misses);
+  EXPECT_EQ(0, stats.bytes_cached);
+}
+
+TEST(CachingAllocatorTest, StatsExcludeCachedBytes) {
+  CachingAllocator a(NewCPUBFCAllocator(), TestOptions(), "cached");
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 10; ++i) {
+    ptrs.push_back(a.AllocateRaw(Allocator::kAllocatorAlignment, 1024));
+  }
+  AllocatorStats stats;
+  a.GetStats(&stats);
+  EXPECT_EQ(10 * 1024, stats.bytes_in_use);
+  for (void* p : ptrs) a.DeallocateRaw(p);
+  a.GetStats(&stats);
+  EXPECT_EQ(0, stats.bytes_in_use);
+
+  CachingAllocator::CacheStats cache_stats;
+  a.GetCacheStats(&cache_stats);
+  EXPECT_EQ(10 * 1024, cache_stats.bytes_cached);
+  a.Flush();
+  a.GetCacheStats(&cache_stats);
+  EXPECT_EQ(0, cache_stats.bytes_cached);
+  EXPECT_EQ(10, cache_stats.num_flushed);
+}
+
+TEST(CachingAllocatorTest, ShardByteLimit) {
+  CachingAllocator::Options options = TestOptions();
+  options.max_cached_bytes_per_shard = 8 * 1024;
+  CachingAllocator a(NewCPUBFCAllocator(), options, "cached");
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 32; ++i) {
+    ptrs.push_back(a.AllocateRaw(Allocator::kAllocatorAlignment, 1024));
+  }
+  for (void* p : ptrs) a.DeallocateRaw(p);
+  CachingAllocator::CacheStats stats;
+  a.GetCacheStats(&stats);
+  EXPECT_LE(stats.bytes_cached, 8 * 1024);
+  EXPECT_GT(stats.num_flushed, 0);
+}
+
+TEST(CachingAllocatorTest, PeriodicFlushReleasesIdleChunks) {
+  CachingAllocator::Options options = TestOptions();
+  options.flush_interval = 4;
+  CachingAllocator a(NewCPUBFCAllocator(), options, "cached");
+  // Park one chunk of a size class that is never used again.
+  a.DeallocateRaw(a.AllocateRaw(Allocator::kAllocatorAlignment, 4096));
+  // Churn through another size class for two flush intervals.
+  for (int i = 0; i < 8; ++i) {
+    a.DeallocateRaw(a.AllocateRaw(Allocator::kAllocatorAlignment, 256));
+  }
+  CachingAllocator::CacheStats stats;
+  a.GetCacheStats(&stats);
+  EXPECT_EQ(256, stats.bytes_cached);
+  EXPECT_EQ(1, stats.num_flushed);
+}
+
+TEST(CachingAllocatorTest, FlushesOnOutOfMemory) {
+  CachingAllocator::Options options = TestOptions();
+  options.max_cached_allocation_size = 1 << 20;
+  options.max_cached_bytes_per_shard = 1 << 30;
+  CachingAllocator a(
+      new BFCAllocator(new BasicCPUAllocator(-1), 4 << 20,
+                       false /*allow_growth*/, "cpu_bfc"),
+      options, "cached");
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 3; ++i) {
+    ptrs.push_back(a.AllocateRaw(Allocator::kAllocatorAlignment, 1 << 20));
+    ASSERT_NE(ptrs.back(), nullptr);
+  }
+  for (void* p : ptrs) a.DeallocateRaw(p);
+  // Does not fit next to the 3MB sitting in the cache.
+  void* p = a.AllocateRaw(Allocator::kAllocatorAlignment, 3 << 20);
+  ASSERT_NE(p, nullptr);
+  a.DeallocateRaw(p);
+}
+
+TEST(CachingAllocatorTest, ConcurrentAllocations) {
+  CachingAllocator::Options options;
+  options.num_shards = 4;
+  CachingAllocator a(NewCPUBFCAllocator(), options, "cached");
+  {
+    thread::ThreadPool pool(Env::Default(), "test", 8);
+    for (int t = 0; t < 8; ++t) {
+      pool.Schedule([&a, t]() {
+        std::vector<void*> live;
+        for (int i = 0; i < 2000; ++i) {
+          const size_t bytes = 64 + ((i * 37 + t) % 8192);
+          void* p = a.AllocateRaw(Allocator::kAllocatorAlignment, bytes);
+          CHECK(p != nullptr);
+          memset(p, t, bytes);
+          live.push_back(p);
+          if (live.size() > 16) {
+            a.DeallocateRaw(live.front());
+            live.erase(live.begin());
+          }
+        }
+        for (void* p : live) a.DeallocateRaw(p);
+      });
+    }
+  }
+  AllocatorStats stats;
+  a.GetStats(&stats);
+  EXPECT_EQ(0, stats.bytes_in_use);
+}
+
+// Multithreaded allocate/free churn of small tensors, the pattern that makes
+// the BFC allocator's global lock show up in contention profiles. Each thread
+// runs `iters` iterations.
+static void RunAllocationThreaded(Allocator* a, int iters, int num_threads) {
+  thread::ThreadPool pool(Env::Default(), "test", num_threads);
+  std::atomic_int_fast64_t count(static_cast<int64>(iters) * num_threads);
+  mutex done_lock;
+  condition_variable done;
+  bool done_flag = false;
+
+  for (int t = 0; t < num_threads; t++) {
+    pool.Schedule([a, &count, &done_lock, &done, &done_flag, iters]() {
+      std::vector<int> sizes = {256, 4096, 1024, 16384, 512, 2048, 65536, 768};
+      int size_index = 0;
+      void* held[4] = {nullptr, nullptr, nullptr, nullptr};
+      for (int i = 0; i < iters; i++) {
+        int bytes = sizes[size_index++ % sizes.size()];
+        void*& slot = held[i % 4];
+        if (slot != nullptr) a->DeallocateRaw(slot);
+        slot = a->AllocateRaw(Allocator::kAllocatorAlignment, bytes);
+        if (count.fetch_sub(1) == 1) {
+          mutex_lock l(done_lock);
+          done_flag = true;
+          done.notify_all();
+        }
+      }
+      for (void* p : held) {
+        if (p != nullptr) a->DeallocateRaw(p);
+      }
+    });
+  }
+  mutex_lock l(done_lock);
+  while (!done_flag) {
+    done.wait(l);
+  }
+}
+
+static void BM_BFCAllocationThreaded(int iters, int num_threads) {
+  testing::StopTiming();
+  std::unique_ptr<VisitableAllocator> a(NewCPUBFCAllocator());
+  testing::StartTiming();
+  RunAllocationThreaded(a.get(), iters, num_threads);
+  testing::ItemsProcessed(static_cast<int64>(iters) * num_threads);
+}
+BENCHMARK(BM_BFCAllocationThreaded)->Arg(1)->Arg(4)->Arg(16)->Arg(64);
+
+static void BM_CachingBFCAllocationThreaded(int iters, int num_threads) {
+  testing::StopTiming();
+  CachingAllocator a(NewCPUBFCAllocator(), CachingAllocator::Options(),
+                     "cached");
+  testing::StartTiming();
+  RunAllocationThreaded(&a, iters, num_threads);
+  testing::StopTiming();
+  testing::ItemsProcessed(static_cast<int64>(iters) * num_threads);
+  CachingAllocator::CacheStats stats;
+  a.GetCacheStats(&stats);
+  VLOG(1) << "Hit rate: " << stats.hit_rate();
+}
+BENCHMARK(BM_CachingBFCAllocationThreaded)->Arg(1)->Arg(4)->Arg(16)->Arg(64);
+
+}  // namespace
+}  // namespace tensorflow
@@ -554,6 +554,8 @@ Status DirectSession::RunInternal(int64 step_id, const RunOptions& run_options,
                                            pool](Executor::Args::Closure c) {
     SchedClosure(pool, std::move(c));
   };
+  const bool work_stealing =
+      options_.config.experimental().executor_work_stealing();
   for (const auto& item : executors_and_keys->items) {
     // TODO(zhengxq): support partial run.
     // TODO(zhengxq): if the device picks its own threadpool, we need to assign
@@ -562,11 +564,16 @@ Status DirectSession::RunInternal(int64 step_id, const RunOptions& run_options,
         item.device->tensorflow_device_thread_pool();
     if (!device_thread_pool) {
       args.runner = default_runner;
+      args.work_stealing_threads = work_stealing ? pool->NumThreads() : 0;
     } else {
       args.runner = [this, device_thread_pool](Executor::Args::Closure c) {
         SchedClosure(device_thread_pool, std::move(c));
       };
+      args.work_stealing_threads =
+          work_stealing ? device_thread_pool->NumThreads() : 0;
     }
+    args.step_allocator = item.planned_allocator.get();
+    if (item.planned_allocator) item.planned_allocator->BeginStep();
     item.executor->RunAsync(args, barrier->Get());
   }
 
@@ -575,6 +582,15 @@ Status DirectSession::RunInternal(int64 step_id, const RunOptions& run_options,
                           ? run_options.timeout_in_ms()
                           : operation_timeout_in_ms_);
 
+  {
+    mutex_lock l(run_state.mu_);
+    for (const auto& item : executors_and_keys->items) {
+      if (item.planned_allocator) {
+        item.planned_allocator->EndStep(run_state.status.ok());
+      }
+    }
+  }
+
   if (!cancellation_manager_->DeregisterCallback(cancellation_token)) {
     // The step has been cancelled: make sure we don't attempt to receive the
     // outputs as this would make it block forever.
@@ -1209,6 +1225,13 @@ Status DirectSession::CreateExecutors(
     TF_RETURN_IF_ERROR(
         NewLocalExecutor(params, std::move(partition_graph), &executor));
     item->executor.reset(executor);
+    const int memory_plan_recorded_steps =
+        options_.config.experimental().memory_plan_recorded_steps();
+    if (memory_plan_recorded_steps > 0 && !run_state_args->is_partial_run) {
+      item->planned_allocator.reset(new PlannedMemoryAllocator(
+          device->GetAllocator(AllocatorAttributes()),
+          memory_plan_recorded_steps));
+    }
   }
 
   // Cache the mapping from input/output names to graph elements to
@@ -504,6 +504,38 @@ TEST_F(DirectSessionMinusAXTest, TestPerSessionThreads) {
   delete tp;
 }
 
+TEST_F(DirectSessionMinusAXTest, TestMemoryPlan) {
+  Initialize({1, 2, 3, 4});
+
+  SessionOptions options;
+  options.config.mutable_experimental()->set_memory_plan_recorded_steps(2);
+  (*options.config.mutable_device_count())["CPU"] = 2;
+  std::unique_ptr<Session> session(NewSession(options));
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def_));
+
+  std::vector<string> output_names = {z_ + ":0"};
+  auto fn = [&session, output_names]() {
+    for (int i = 0; i < 100; ++i) {
+      std::vector<Tensor> outputs;
+      TF_ASSERT_OK(session->Run({}, output_names, {}, &outputs));
+      ASSERT_EQ(1, outputs.size());
+      auto mat = outputs[0].matrix<float>();
+      EXPECT_FLOAT_EQ(-3.0, mat(0, 0));
+      EXPECT_FLOAT_EQ(-7.0, mat(1, 0));
+    }
+  };
+
+  // Sequential steps first, so that a plan is made, then concurrent ones
+  // that compete for the planned buffers.
+  fn();
+  thread::ThreadPool* tp = new thread::ThreadPool(Env::Default(), "test", 4);
+  for (int i = 0; i < 4; ++i) {
+    tp->Schedule(fn);
+  }
+  delete tp;
+}
+
 TEST_F(DirectSessionMinusAXTest, TwoCreateCallsFails) {
   Initialize({1, 2, 3, 4});
   auto session = CreateSession();
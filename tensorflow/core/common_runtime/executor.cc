@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/executor.h"
 
+#include <algorithm>
 #include <atomic>
 #include <deque>
 #include <memory>
@@ -1288,6 +1289,39 @@ class ExecutorState {
     int front_index_;
   };
 
+  // A deque of ready nodes owned by one work-stealing worker. The owner
+  // pushes and pops at the back (LIFO, to keep producer/consumer pairs
+  // cache-warm), while other workers steal from the front.
+  class WorkStealingQueue {
+   public:
+    void PushBack(const TaggedNode& node) {
+      mutex_lock l(mu_);
+      nodes_.push_back(node);
+    }
+    bool PopBack(TaggedNode* node) {
+      mutex_lock l(mu_);
+      if (nodes_.empty()) return false;
+      *node = nodes_.back();
+      nodes_.pop_back();
+      return true;
+    }
+    bool StealFront(TaggedNode* node) {
+      mutex_lock l(mu_);
+      if (nodes_.empty()) return false;
+      *node = nodes_.front();
+      nodes_.pop_front();
+      return true;
+    }
+
+   private:
+    mutex mu_;
+    std::deque<TaggedNode> nodes_ GUARDED_BY(mu_);
+  };
+
+  // Used as the worker slot of nodes processed outside the work-stealing
+  // workers.
+  static constexpr int kNoWorkerSlot = -1;
+
   struct AsyncState;
 
   const bool vlog_;  // true if VLOG_IS_ON(1). Used to check vlog cheaply.
@@ -1303,6 +1337,7 @@ class ExecutorState {
   TensorStore* tensor_store_;
   // Step-local container.
   ScopedStepContainer* step_container_;
+  Allocator* step_allocator_;
   StepStatsCollector* stats_collector_;
   // QUESTION: Make it a checkpoint::TensorSliceReaderCacheWrapper
   // instead of a pointer?  (avoids having to delete).
@@ -1313,6 +1348,24 @@ class ExecutorState {
   Executor::Args::Runner runner_;
   bool sync_on_finish_;
 
+  // Work-stealing scheduling state. Only used if max_workers_ > 0, in
+  // which case every node is processed by one of at most max_workers_
+  // closures running WorkerLoop().
+  const int max_workers_;
+  std::unique_ptr<WorkStealingQueue[]> work_queues_;
+  // Number of nodes sitting in work_queues_.
+  std::atomic<int64> num_queued_nodes_;
+  // Number of closures running WorkerLoop().
+  std::atomic<int> num_active_workers_;
+  std::atomic<int> next_worker_slot_;
+  mutex workers_mu_;
+  // Number of threads outside WorkerLoop() that are queueing nodes. They
+  // keep this ExecutorState alive like active workers do.
+  int num_external_schedulers_ GUARDED_BY(workers_mu_) = 0;
+  // Set when the last outstanding op is done. The step is finished by the
+  // last worker or external scheduler to leave after that.
+  bool step_completed_ GUARDED_BY(workers_mu_) = false;
+
   // Owned.
 
   // A flag that is set on error after the frame state has been
@@ -1356,8 +1409,28 @@ class ExecutorState {
   void CleanupFramesIterations(FrameState* frame, int64 iter,
                                TaggedNodeSeq* ready);
 
-  // Process a ready node in current thread.
-  void Process(TaggedNode node, int64 scheduled_usec);
+  // Process a ready node in current thread. "worker_slot" is the index of
+  // the work-stealing deque owned by the calling worker, or kNoWorkerSlot.
+  void Process(TaggedNode node, int64 scheduled_usec, int worker_slot);
+
+  // Body of a work-stealing worker: processes nodes from the worker's own
+  // deque and steals from the other deques until no ready node is left.
+  void WorkerLoop();
+
+  // Pops a node from "worker_slot"'s deque, or steals one from another
+  // deque. Returns false if all the deques are empty.
+  bool PopOrSteal(int worker_slot, TaggedNode* node);
+
+  // Pushes "node" onto the deque at "worker_slot" without waking up
+  // workers; callers follow up with MaybeStartWorkers().
+  void PushToWorkQueue(int worker_slot, const TaggedNode& node);
+
+  // Dispatches new WorkerLoop() closures to runner_ for up to
+  // "num_new_nodes" freshly queued nodes, without exceeding max_workers_.
+  void MaybeStartWorkers(int64 num_new_nodes);
+
+  // Called when the last outstanding op of the step is done.
+  void StepCompleted();
 
   // Before invoking item->kernel, fills in its "inputs".
   Status PrepareInputs(const NodeItem& item, Entry* first_input,
@@ -1379,13 +1452,13 @@ class ExecutorState {
   // "node" just finishes. Takes ownership of "stats". Returns true if
   // execution has completed.
   bool NodeDone(const Status& s, const Node* node, const TaggedNodeSeq& ready,
-                NodeExecStatsWrapper* stats,
-                TaggedNodeReadyQueue* inline_ready);
+                NodeExecStatsWrapper* stats, TaggedNodeReadyQueue* inline_ready,
+                int worker_slot);
 
   // Schedule all the expensive nodes in 'ready', and put all the inexpensive
   // nodes in 'ready' into 'inline_ready'.
   void ScheduleReady(const TaggedNodeSeq& ready,
-                     TaggedNodeReadyQueue* inline_ready);
+                     TaggedNodeReadyQueue* inline_ready, int worker_slot);
 
   // For debugging/logging only.
   inline void MaybeMarkCompleted(FrameState* frame, int64 iter, int64 id);
@@ -1416,6 +1489,8 @@ class ExecutorState {
   }
 };
 
+constexpr int ExecutorState::kNoWorkerSlot;
+
 ExecutorState::ExecutorState(const Executor::Args& args, ExecutorImpl* impl)
     : vlog_(VLOG_IS_ON(1)),
       log_memory_(LogMemory::IsEnabled()),
@@ -1425,6 +1500,7 @@ ExecutorState::ExecutorState(const Executor::Args& args, ExecutorImpl* impl)
       session_state_(args.session_state),
       tensor_store_(args.tensor_store),
       step_container_(args.step_container),
+      step_allocator_(args.step_allocator),
       stats_collector_(args.stats_collector),
       slice_reader_cache_(new checkpoint::TensorSliceReaderCacheWrapper),
       call_frame_(args.call_frame),
@@ -1432,7 +1508,14 @@ ExecutorState::ExecutorState(const Executor::Args& args, ExecutorImpl* impl)
       cancellation_manager_(args.cancellation_manager),
       runner_(args.runner),
       sync_on_finish_(args.sync_on_finish),
+      max_workers_(std::max(args.work_stealing_threads, 0)),
+      num_queued_nodes_(0),
+      num_active_workers_(0),
+      next_worker_slot_(0),
       num_outstanding_ops_(0) {
+  if (max_workers_ > 0) {
+    work_queues_.reset(new WorkStealingQueue[max_workers_]);
+  }
   // We start the entire execution in iteration 0 of the root frame
   // so let us create the root frame and the state for iteration 0.
   // We assume root_frame_->frame_name.empty().
@@ -1565,7 +1648,7 @@ void ExecutorState::RunAsync(Executor::DoneCallback done) {
     root_frame_->iterations[0]->outstanding_ops = ready.size();
     done_cb_ = std::move(done);
     // Schedule to run all the ready ops in thread pool.
-    ScheduleReady(ready, nullptr);
+    ScheduleReady(ready, nullptr, kNoWorkerSlot);
   }
 }
 
@@ -1615,7 +1698,8 @@ struct ExecutorState::AsyncState {
   }
 };
 
-void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_usec) {
+void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_usec,
+                            int worker_slot) {
   const GraphView& gview = impl_->gview_;
   TaggedNodeSeq ready;
   TaggedNodeReadyQueue inline_ready;
@@ -1640,6 +1724,7 @@ void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_usec) {
   params.function_library = impl_->params_.function_library;
   params.resource_manager = device->resource_manager();
   params.step_container = step_container_;
+  params.step_allocator = step_allocator_;
   params.slice_reader_cache = slice_reader_cache_;
   params.inputs = &inputs;
   params.input_device_contexts = &input_device_contexts;
@@ -1715,7 +1800,8 @@ void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_usec) {
         }
         MaybeMarkCompleted(input_frame, input_iter, id);
         // Continue to process the nodes in 'inline_ready'.
-        completed = NodeDone(s, item.node, ready, stats, &inline_ready);
+        completed =
+            NodeDone(s, item.node, ready, stats, &inline_ready, worker_slot);
         continue;
       }
 
@@ -1775,10 +1861,10 @@ void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_usec) {
             device->ConsumeListOfAccessedTensors(state->ctx.op_device_context(),
                                                  accessed);
           }
-          const bool completed =
-              NodeDone(s, state->item->node, ready, stats, nullptr);
+          const bool completed = NodeDone(s, state->item->node, ready, stats,
+                                          nullptr, kNoWorkerSlot);
           delete state;
-          if (completed) Finish();
+          if (completed) StepCompleted();
         };
         nodestats::SetOpStart(stats);
         device->ComputeAsync(async, &state->ctx, done);
@@ -1826,12 +1912,13 @@ void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_usec) {
         scheduled_usec = nodestats::NowInUsec();
       }
       // Postprocess.
-      completed = NodeDone(s, item.node, ready, stats, &inline_ready);
+      completed =
+          NodeDone(s, item.node, ready, stats, &inline_ready, worker_slot);
     }
   }  // while !inline_ready.empty()
 
   // This thread of computation is done if completed = true.
-  if (completed) Finish();
+  if (completed) StepCompleted();
 }
 
 Status ExecutorState::PrepareInputs(const NodeItem& item, Entry* first_input,
@@ -2147,7 +2234,8 @@ void ExecutorState::PropagateOutputs(const TaggedNode& tagged_node,
 bool ExecutorState::NodeDone(const Status& s, const Node* node,
                              const TaggedNodeSeq& ready,
                              NodeExecStatsWrapper* stats,
-                             TaggedNodeReadyQueue* inline_ready) {
+                             TaggedNodeReadyQueue* inline_ready,
+                             int worker_slot) {
   nodestats::SetAllEnd(stats);
   if (stats_collector_ != nullptr && !SetTimelineLabel(node, stats)) {
     // Only record non-transfer nodes.
@@ -2189,15 +2277,77 @@ bool ExecutorState::NodeDone(const Status& s, const Node* node,
 
   // Schedule the ready nodes in 'ready'.
   if (s.ok()) {
-    ScheduleReady(ready, inline_ready);
+    ScheduleReady(ready, inline_ready, worker_slot);
   }
   return completed;
 }
 
 void ExecutorState::ScheduleReady(const TaggedNodeSeq& ready,
-                                  TaggedNodeReadyQueue* inline_ready) {
+                                  TaggedNodeReadyQueue* inline_ready,
+                                  int worker_slot) {
   if (ready.empty()) return;
 
+  if (max_workers_ > 0) {
+    // Work-stealing mode: nothing is handed to runner_ directly.
+    int64 num_queued = 0;
+    if (worker_slot == kNoWorkerSlot) {
+      // Called from RunAsync() or from an async kernel's done callback. The
+      // queued nodes may run to the end of the step before this thread is
+      // done here, so hold the ExecutorState alive until then.
+      {
+        mutex_lock l(workers_mu_);
+        ++num_external_schedulers_;
+      }
+      // Spread the nodes over the deques so that workers start without
+      // immediately contending on the same deque.
+      for (auto& tagged_node : ready) {
+        const int slot =
+            next_worker_slot_.fetch_add(1, std::memory_order_relaxed) %
+            max_workers_;
+        PushToWorkQueue(slot, tagged_node);
+        ++num_queued;
+      }
+      MaybeStartWorkers(num_queued);
+      bool finish;
+      {
+        mutex_lock l(workers_mu_);
+        --num_external_schedulers_;
+        finish = step_completed_ && num_external_schedulers_ == 0 &&
+                 num_active_workers_.load() == 0;
+      }
+      if (finish) Finish();
+      return;
+    } else {
+      // Same policy as below: run the inexpensive nodes and one expensive
+      // node inline, and make the remaining expensive nodes available to
+      // idle workers through this worker's deque.
+      const GraphView& gview = impl_->gview_;
+      const TaggedNode* curr_expensive_node = nullptr;
+      for (auto& tagged_node : ready) {
+        const NodeItem& item = *gview.node(tagged_node.node->id());
+        if (tagged_node.is_dead || !item.kernel_is_expensive) {
+          inline_ready->push_back(tagged_node);
+        } else {
+          if (curr_expensive_node) {
+            PushToWorkQueue(worker_slot, *curr_expensive_node);
+            ++num_queued;
+          }
+          curr_expensive_node = &tagged_node;
+        }
+      }
+      if (curr_expensive_node) {
+        if (inline_ready->empty()) {
+          inline_ready->push_back(*curr_expensive_node);
+        } else {
+          PushToWorkQueue(worker_slot, *curr_expensive_node);
+          ++num_queued;
+        }
+      }
+    }
+    MaybeStartWorkers(num_queued);
+    return;
+  }
+
   int64 scheduled_usec = 0;
   if (stats_collector_) {
     scheduled_usec = nodestats::NowInUsec();
@@ -2205,7 +2355,7 @@ void ExecutorState::ScheduleReady(const TaggedNodeSeq& ready,
   if (inline_ready == nullptr) {
     // Schedule to run all the ready ops in thread pool.
     for (auto& tagged_node : ready) {
-      runner_([=]() { Process(tagged_node, scheduled_usec); });
+      runner_([=]() { Process(tagged_node, scheduled_usec, kNoWorkerSlot); });
     }
     return;
   }
@@ -2221,7 +2371,7 @@ void ExecutorState::ScheduleReady(const TaggedNodeSeq& ready,
         // Dispatch to another thread since there is plenty of work to
         // do for this thread.
         runner_(std::bind(&ExecutorState::Process, this, *curr_expensive_node,
-                          scheduled_usec));
+                          scheduled_usec, kNoWorkerSlot));
       }
       curr_expensive_node = &tagged_node;
     }
@@ -2234,11 +2384,97 @@ void ExecutorState::ScheduleReady(const TaggedNodeSeq& ready,
       // There are inline nodes to run already. We dispatch this expensive
       // node to other thread.
       runner_(std::bind(&ExecutorState::Process, this, *curr_expensive_node,
-                        scheduled_usec));
+                        scheduled_usec, kNoWorkerSlot));
     }
   }
 }
 
+void ExecutorState::PushToWorkQueue(int worker_slot, const TaggedNode& node) {
+  work_queues_[worker_slot].PushBack(node);
+  // NOTE: The increment must be sequentially consistent with the load of
+  // num_active_workers_ in MaybeStartWorkers() and with the exit protocol in
+  // WorkerLoop(), so that a node is never queued with no worker to run it.
+  num_queued_nodes_.fetch_add(1);
+}
+
+void ExecutorState::MaybeStartWorkers(int64 num_new_nodes) {
+  if (num_new_nodes == 0 || num_active_workers_.load() >= max_workers_) {
+    return;
+  }
+  int num_to_start;
+  {
+    mutex_lock l(workers_mu_);
+    const int active = num_active_workers_.load();
+    num_to_start = static_cast<int>(
+        std::min<int64>(num_new_nodes, std::max(max_workers_ - active, 0)));
+    num_active_workers_.fetch_add(num_to_start);
+  }
+  for (int i = 0; i < num_to_start; ++i) {
+    runner_([this]() { WorkerLoop(); });
+  }
+}
+
+bool ExecutorState::PopOrSteal(int worker_slot, TaggedNode* node) {
+  if (num_queued_nodes_.load(std::memory_order_relaxed) == 0) return false;
+  if (work_queues_[worker_slot].PopBack(node)) {
+    num_queued_nodes_.fetch_sub(1);
+    return true;
+  }
+  for (int i = 1; i < max_workers_; ++i) {
+    const int victim = (worker_slot + i) % max_workers_;
+    if (work_queues_[victim].StealFront(node)) {
+      num_queued_nodes_.fetch_sub(1);
+      return true;
+    }
+  }
+  return false;
+}
+
+void ExecutorState::WorkerLoop() {
+  const int worker_slot =
+      next_worker_slot_.fetch_add(1, std::memory_order_relaxed) % max_workers_;
+  TaggedNode tagged_node(nullptr, nullptr, -1, false);
+  while (true) {
+    while (PopOrSteal(worker_slot, &tagged_node)) {
+      const int64 scheduled_usec =
+          stats_collector_ ? nodestats::NowInUsec() : 0;
+      Process(tagged_node, scheduled_usec, worker_slot);
+    }
+    bool finish = false;
+    {
+      mutex_lock l(workers_mu_);
+      // Retire first, then check the deques again: a concurrent
+      // PushToWorkQueue() either sees the decremented worker count and
+      // starts a new worker, or its node is seen here.
+      num_active_workers_.fetch_sub(1);
+      if (num_queued_nodes_.load() > 0) {
+        num_active_workers_.fetch_add(1);
+        continue;
+      }
+      finish = step_completed_ && num_external_schedulers_ == 0 &&
+               num_active_workers_.load() == 0;
+    }
+    // NOTE: Unless "finish" is true, another thread may delete this
+    // ExecutorState as soon as workers_mu_ is released.
+    if (finish) Finish();
+    return;
+  }
+}
+
+void ExecutorState::StepCompleted() {
+  if (max_workers_ == 0) {
+    Finish();
+    return;
+  }
+  bool finish;
+  {
+    mutex_lock l(workers_mu_);
+    step_completed_ = true;
+    finish = num_external_schedulers_ == 0 && num_active_workers_.load() == 0;
+  }
+  if (finish) Finish();
+}
+
 inline void ExecutorState::MaybeMarkCompleted(FrameState* frame, int64 iter,
                                               int64 node_id) {
   // TODO(misard) Replace with a finer-grain enabling flag once we
@@ -98,6 +98,18 @@ class Executor {
     typedef std::function<void(Closure)> Runner;
     Runner runner = nullptr;
 
+    // If > 0, ready nodes are kept in per-worker deques and at most
+    // "work_stealing_threads" closures are dispatched to "runner" at a
+    // time. Each of those closures keeps popping nodes from its own deque
+    // and steals from the others' until no ready node remains. Typically
+    // set to the number of threads backing "runner".
+    int work_stealing_threads = 0;
+
+    // If set, kernels allocate memory with default allocator attributes
+    // from it instead of from the device's allocator. It must allocate the
+    // same kind of memory as the device's allocator.
+    Allocator* step_allocator = nullptr;
+
     // A callback that is invoked each time a node has finished executing.
     typedef std::function<Status(const string& node_name, const int output_slot,
                                  const Tensor* tensor, const bool is_ref,
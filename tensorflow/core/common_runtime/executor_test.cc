@@ -79,9 +79,12 @@ class ExecutorTest : public ::testing::Test {
     args.rendezvous = rendez;
     args.stats_collector = &step_stats_collector_;
     args.runner = runner_;
+    args.work_stealing_threads =
+        work_stealing_ ? thread_pool_->NumThreads() : 0;
     return exec_->Run(args);
   }
 
+  bool work_stealing_ = false;
   thread::ThreadPool* thread_pool_ = nullptr;
   Device* device_ = nullptr;
   Executor* exec_ = nullptr;
@@ -243,6 +246,22 @@ TEST_F(ExecutorTest, RandomTree) {
   EXPECT_EQ(4096.0, V(out));
 }
 
+TEST_F(ExecutorTest, RandomTreeWorkStealing) {
+  work_stealing_ = true;
+  std::unique_ptr<Graph> g(new Graph(OpRegistry::Global()));
+  BuildTree(4096, g.get());
+  Create(std::move(g));
+  Rendezvous::Args args;
+  TF_ASSERT_OK(
+      rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args, V(1.0), false));
+  TF_ASSERT_OK(Run(rendez_));
+  Tensor out = V(-1);
+  bool is_dead = false;
+  TF_ASSERT_OK(
+      rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out, &is_dead));
+  EXPECT_EQ(4096.0, V(out));
+}
+
 void BuildConcurrentAddAssign(Graph* g) {
   auto one = test::graph::Constant(g, V(1.0));
   // A variable holds one float.
@@ -278,6 +297,24 @@ TEST_F(ExecutorTest, ConcurrentAddAssign) {
     rendez->Unref();
   }
 }
+
+TEST_F(ExecutorTest, ConcurrentAddAssignWorkStealing) {
+  work_stealing_ = true;
+  std::unique_ptr<Graph> g(new Graph(OpRegistry::Global()));
+  BuildConcurrentAddAssign(g.get());
+  Create(std::move(g));
+  for (int iters = 0; iters < 16; ++iters) {
+    Rendezvous* rendez = NewLocalRendezvous();
+    TF_ASSERT_OK(Run(rendez));
+    Rendezvous::Args args;
+    Tensor out;
+    bool is_dead;
+    TF_ASSERT_OK(rendez->Recv(Key(ALICE, kIncarnation, BOB, "out"), args, &out,
+                              &is_dead));
+    EXPECT_LE(V(out), 1025.0);
+    rendez->Unref();
+  }
+}
 #endif
 
 TEST_F(ExecutorTest, SimpleSwitchLive) {
@@ -370,6 +407,28 @@ TEST_F(ExecutorTest, Abort) {
     ;
 }
 
+TEST_F(ExecutorTest, AbortWorkStealing) {
+  // e = a + b, where "b" is never sent and the rendezvous is aborted.
+  work_stealing_ = true;
+  std::unique_ptr<Graph> g(new Graph(OpRegistry::Global()));
+  auto in0 = test::graph::Recv(g.get(), "a", "float", ALICE, 1, BOB);
+  auto in1 = test::graph::Recv(g.get(), "b", "float", ALICE, 1, BOB);
+  auto add = test::graph::Add(g.get(), in0, in1);
+  test::graph::Send(g.get(), add, "e", BOB, 1, ALICE);
+  Create(std::move(g));
+  TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"),
+                             Rendezvous::Args(), V(1.0), false));
+  rendez_->Ref();
+  SchedClosure([this]() {
+    Env::Default()->SleepForMicroseconds(100 * 1000);
+    rendez_->StartAbort(errors::Aborted(""));
+    rendez_->Unref();
+  });
+  EXPECT_TRUE(errors::IsAborted(Run(rendez_)));
+  while (!rendez_->RefCountIsOne())
+    ;
+}
+
 TEST_F(ExecutorTest, RecvInvalidDtype) {
   std::unique_ptr<Graph> g(new Graph(OpRegistry::Global()));
   // An input vector of type float of size 1.
@@ -413,11 +472,8 @@ TEST_F(ExecutorTest, RecvInvalidRefDtype) {
 // Create a graph that is 'depth' deep. At each level, fan-in and fan-out a
 // maximum of 'width' nodes. All nodes are no-ops and all dependencies are
 // control dependencies.
-static void BM_executor(int iters, int width, int depth) {
-#ifdef PLATFORM_GOOGLE
-  BenchmarkUseRealTime();
-#endif  // PLATFORM_GOOGLE
-  Graph* g = new Graph(OpRegistry::Global());
+static void BuildRandomWidthDepthGraph(int width, int depth, Graph* g,
+                                       uint64* num_nodes) {
   random::PhiloxRandom philox(1729, 17);
   random::SimplePhilox rand(&philox);
   uint64 cur = 0;
@@ -443,6 +499,16 @@ static void BM_executor(int iters, int width, int depth) {
       ++cur;
     }
   }
+  *num_nodes = cur;
+}
+
+static void BM_executor(int iters, int width, int depth) {
+#ifdef PLATFORM_GOOGLE
+  BenchmarkUseRealTime();
+#endif  // PLATFORM_GOOGLE
+  Graph* g = new Graph(OpRegistry::Global());
+  uint64 cur = 0;
+  BuildRandomWidthDepthGraph(width, depth, g, &cur);
 #ifdef PLATFORM_GOOGLE
   SetBenchmarkLabel(strings::StrCat("Nodes = ", cur));
   SetBenchmarkItemsProcessed(cur * static_cast<int64>(iters));
@@ -450,6 +516,23 @@ static void BM_executor(int iters, int width, int depth) {
   test::Benchmark("cpu", g).Run(iters);
 }
 
+// Same graphs as BM_executor, run with the work-stealing executor mode.
+static void BM_executor_work_stealing(int iters, int width, int depth) {
+#ifdef PLATFORM_GOOGLE
+  BenchmarkUseRealTime();
+#endif  // PLATFORM_GOOGLE
+  Graph* g = new Graph(OpRegistry::Global());
+  uint64 cur = 0;
+  BuildRandomWidthDepthGraph(width, depth, g, &cur);
+#ifdef PLATFORM_GOOGLE
+  SetBenchmarkLabel(strings::StrCat("Nodes = ", cur));
+  SetBenchmarkItemsProcessed(cur * static_cast<int64>(iters));
+#endif  // PLATFORM_GOOGLE
+  SessionOptions options;
+  options.config.mutable_experimental()->set_executor_work_stealing(true);
+  test::Benchmark("cpu", g, &options).Run(iters);
+}
+
 // Tall skinny graphs
 BENCHMARK(BM_executor)->ArgPair(16, 1024);
 BENCHMARK(BM_executor)->ArgPair(32, 8192);
@@ -461,6 +544,69 @@ BENCHMARK(BM_executor)->ArgPair(8192, 32);
 // Tall fat graph
 BENCHMARK(BM_executor)->ArgPair(1024, 1024);
 
+BENCHMARK(BM_executor_work_stealing)->ArgPair(16, 1024);
+BENCHMARK(BM_executor_work_stealing)->ArgPair(32, 8192);
+BENCHMARK(BM_executor_work_stealing)->ArgPair(1024, 16);
+BENCHMARK(BM_executor_work_stealing)->ArgPair(8192, 32);
+BENCHMARK(BM_executor_work_stealing)->ArgPair(1024, 1024);
+
+// Steps/sec on synthetic inference-like graphs of small ops. A "wide" graph
+// has 'width' independent chains of 'depth' scalar Adds that are joined at
+// the end; a "deep" graph is the special case width == 1. Items processed
+// counts steps, so items/sec is steps/sec.
+static void BM_executor_chains(int iters, int width, int depth,
+                               bool work_stealing) {
+#ifdef PLATFORM_GOOGLE
+  BenchmarkUseRealTime();
+#endif  // PLATFORM_GOOGLE
+  Graph* g = new Graph(OpRegistry::Global());
+  Node* one = test::graph::Constant(g, V(1.0));
+  std::vector<Node*> tails;
+  for (int i = 0; i < width; ++i) {
+    Node* n = one;
+    for (int j = 0; j < depth; ++j) {
+      n = test::graph::Add(g, n, one);
+    }
+    tails.push_back(n);
+  }
+  test::graph::NoOp(g, tails);
+#ifdef PLATFORM_GOOGLE
+  SetBenchmarkLabel(strings::StrCat("Nodes = ", width * depth + 2,
+                                    work_stealing ? " work stealing" : ""));
+  SetBenchmarkItemsProcessed(static_cast<int64>(iters));
+#endif  // PLATFORM_GOOGLE
+  SessionOptions options;
+  options.config.mutable_experimental()->set_executor_work_stealing(
+      work_stealing);
+  test::Benchmark("cpu", g, &options).Run(iters);
+}
+
+static void BM_executor_wide(int iters, int width) {
+  BM_executor_chains(iters, width, 1, /*work_stealing=*/false);
+}
+static void BM_executor_wide_work_stealing(int iters, int width) {
+  BM_executor_chains(iters, width, 1, /*work_stealing=*/true);
+}
+static void BM_executor_deep(int iters, int depth) {
+  BM_executor_chains(iters, 1, depth, /*work_stealing=*/false);
+}
+static void BM_executor_deep_work_stealing(int iters, int depth) {
+  BM_executor_chains(iters, 1, depth, /*work_stealing=*/true);
+}
+static void BM_executor_wide_and_deep(int iters, int width) {
+  BM_executor_chains(iters, width, 16, /*work_stealing=*/false);
+}
+static void BM_executor_wide_and_deep_work_stealing(int iters, int width) {
+  BM_executor_chains(iters, width, 16, /*work_stealing=*/true);
+}
+
+BENCHMARK(BM_executor_wide)->Arg(1024)->Arg(5000);
+BENCHMARK(BM_executor_wide_work_stealing)->Arg(1024)->Arg(5000);
+BENCHMARK(BM_executor_deep)->Arg(1024)->Arg(5000);
+BENCHMARK(BM_executor_deep_work_stealing)->Arg(1024)->Arg(5000);
+BENCHMARK(BM_executor_wide_and_deep)->Arg(64)->Arg(320);
+BENCHMARK(BM_executor_wide_and_deep_work_stealing)->Arg(64)->Arg(320);
+
 static void BM_FeedInputFetchOutput(int iters) {
   Graph* g = new Graph(OpRegistry::Global());
   // z = x + y: x and y are provided as benchmark inputs.  z is the
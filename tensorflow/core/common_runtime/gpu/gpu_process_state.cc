@@ -18,6 +18,7 @@ limitations under the License.
 #include <cstring>
 #include <vector>
 
+#include "tensorflow/core/common_runtime/caching_allocator.h"
 #include "tensorflow/core/common_runtime/gpu/cuda_host_allocator.h"
 #include "tensorflow/core/common_runtime/gpu/gpu_bfc_allocator.h"
 #include "tensorflow/core/common_runtime/gpu/gpu_cudamalloc_allocator.h"
@@ -53,6 +54,16 @@ bool useCudaMemoryGuardAllocator() {
          std::strcmp(debug_allocator_str, "memory_guard") == 0;
 }
 
+bool useAllocatorCache() {
+  bool use_allocator_cache = false;
+  Status status = ReadBoolFromEnvVar("TF_GPU_ALLOCATOR_USE_CACHE", false,
+                                     &use_allocator_cache);
+  if (!status.ok()) {
+    LOG(ERROR) << "GetGPUAllocator: " << status.error_message();
+  }
+  return use_allocator_cache;
+}
+
 }  // namespace
 
 GPUProcessState* GPUProcessState::instance_ = nullptr;
@@ -122,6 +133,12 @@ Allocator* GPUProcessState::GetGPUAllocator(const GPUOptions& options,
       // useful for doing memory debugging with tools like cuda-memcheck
       // **WARNING** probably will not work in a multi-gpu scenario
       gpu_allocator = new GPUcudaMallocAllocator(gpu_allocator, cuda_gpu_id);
+    } else if (useAllocatorCache()) {
+      // Serve small allocations from lock-sharded caches of freed chunks
+      // in front of the BFC allocator's global lock.
+      gpu_allocator = new CachingAllocator(
+          gpu_allocator, CachingAllocator::Options(),
+          strings::StrCat("GPU_", tf_gpu_id.value(), "_bfc_cached"));
     }
     gpu_allocators_[tf_gpu_id.value()] = gpu_allocator;
 
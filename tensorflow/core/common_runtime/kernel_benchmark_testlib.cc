@@ -61,6 +61,9 @@ Benchmark::Benchmark(const string& device, Graph* g,
 
   pool_ = new thread::ThreadPool(options->env, "blocking",
                                  port::NumSchedulableCPUs());
+  if (options->config.experimental().executor_work_stealing()) {
+    work_stealing_threads_ = pool_->NumThreads();
+  }
 
   auto runner = [this](std::function<void()> closure) {
     pool_->Schedule(closure);
@@ -93,6 +96,7 @@ Benchmark::Benchmark(const string& device, Graph* g,
     Executor::Args args;
     args.rendezvous = rendez_;
     args.runner = runner;
+    args.work_stealing_threads = work_stealing_threads_;
     TF_CHECK_OK(init_exec->Run(args));
   }
 
@@ -154,6 +158,7 @@ void Benchmark::RunWithArgs(
   args.runner = [this](std::function<void()> closure) {
     pool_->Schedule(closure);
   };
+  args.work_stealing_threads = work_stealing_threads_;
   static const int kWarmupRuns = 3;
   for (int i = 0; i < kWarmupRuns; ++i) {
     for (const auto& p : in) {
@@ -58,6 +58,8 @@ class Benchmark {
   Device* device_ = nullptr;
   Rendezvous* rendez_ = nullptr;
   std::unique_ptr<Executor> exec_;
+  // Executor::Args::work_stealing_threads for every run.
+  int work_stealing_threads_ = 0;
 
   TF_DISALLOW_COPY_AND_ASSIGN(Benchmark);
 };
@@ -0,0 +1,285 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/planned_memory_allocator.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+namespace {
+
+// Recording stops without a plan after this many times the requested
+// number of steps, e.g. when input shapes keep changing.
+constexpr int kMaxRecordingFactor = 4;
+
+size_t RoundUp(size_t num_bytes) {
+  return (num_bytes + Allocator::kAllocatorAlignment - 1) &
+         ~(Allocator::kAllocatorAlignment - 1);
+}
+
+bool LiveAtSameTime(const PlannedMemoryAllocator::Buffer& a,
+                    const PlannedMemoryAllocator::Buffer& b) {
+  return a.first_use <= b.last_use && b.first_use <= a.last_use;
+}
+
+}  // namespace
+
+string PlannedMemoryAllocator::PlanStats::DebugString() const {
+  if (!planned) return "not planned";
+  return strings::StrCat(num_planned_buffers, " buffers in a ", arena_bytes,
+                         "-byte arena (recorded peak ", peak_live_bytes,
+                         " bytes); ", num_arena_allocs,
+                         " allocations from the arena, ", num_fallback_allocs,
+                         " from the wrapped allocator");
+}
+
+PlannedMemoryAllocator::PlannedMemoryAllocator(Allocator* wrapped,
+                                               int num_recorded_steps)
+    : wrapped_(wrapped),
+      num_recorded_steps_(std::max(num_recorded_steps, 1)),
+      state_(kRecording) {}
+
+PlannedMemoryAllocator::~PlannedMemoryAllocator() {
+  if (arena_ != nullptr) wrapped_->DeallocateRaw(arena_);
+}
+
+string PlannedMemoryAllocator::Name() {
+  return strings::StrCat("planned_", wrapped_->Name());
+}
+
+void* PlannedMemoryAllocator::AllocateRaw(size_t alignment, size_t num_bytes) {
+  return AllocateRaw(alignment, num_bytes, AllocationAttributes());
+}
+
+void* PlannedMemoryAllocator::AllocateRaw(
+    size_t alignment, size_t num_bytes,
+    const AllocationAttributes& allocation_attr) {
+  const State state = state_.load(std::memory_order_acquire);
+  void* ptr = nullptr;
+  if (state == kPlanned && alignment <= kAllocatorAlignment) {
+    ptr = AllocateFromArena(num_bytes);
+  }
+  if (ptr == nullptr) {
+    ptr = wrapped_->AllocateRaw(alignment, num_bytes, allocation_attr);
+    if (ptr == nullptr) return nullptr;
+    if (state != kDisabled) {
+      mutex_lock l(mu_);
+      if (state == kPlanned) {
+        ++stats_.num_fallback_allocs;
+      } else if (recording_) {
+        recorded_live_[ptr] = recorded_.size();
+        recorded_.push_back({num_bytes, tick_++, -1});
+      }
+    }
+  }
+  Ref();
+  return ptr;
+}
+
+void* PlannedMemoryAllocator::AllocateFromArena(size_t num_bytes) {
+  mutex_lock l(mu_);
+  auto it = slots_by_size_.find(num_bytes);
+  if (it == slots_by_size_.end()) return nullptr;
+  SlotsOfSize& candidates = it->second;
+  const size_t n = candidates.slots.size();
+  for (size_t i = 0; i < n; ++i) {
+    const size_t k = (candidates.next + i) % n;
+    const Slot& slot = slots_[candidates.slots[k]];
+    if (!OverlapsLive(slot.offset, slot.size)) {
+      live_[slot.offset] = slot.offset + slot.size;
+      candidates.next = (k + 1) % n;
+      ++stats_.num_arena_allocs;
+      return arena_ + slot.offset;
+    }
+  }
+  return nullptr;
+}
+
+bool PlannedMemoryAllocator::OverlapsLive(size_t offset, size_t size) const {
+  auto it = live_.lower_bound(offset);
+  if (it != live_.end() && it->first < offset + size) return true;
+  if (it != live_.begin()) {
+    --it;
+    if (it->second > offset) return true;
+  }
+  return false;
+}
+
+void PlannedMemoryAllocator::DeallocateRaw(void* ptr) {
+  bool in_arena = false;
+  if (state_.load(std::memory_order_acquire) != kDisabled) {
+    mutex_lock l(mu_);
+    char* p = static_cast<char*>(ptr);
+    if (arena_ != nullptr && p >= arena_ && p < arena_ + arena_bytes_) {
+      live_.erase(p - arena_);
+      in_arena = true;
+    } else if (recording_) {
+      auto it = recorded_live_.find(ptr);
+      if (it != recorded_live_.end()) {
+        recorded_[it->second].last_use = tick_++;
+        recorded_live_.erase(it);
+      }
+    }
+  }
+  if (!in_arena) wrapped_->DeallocateRaw(ptr);
+  // May delete this.
+  Unref();
+}
+
+void PlannedMemoryAllocator::BeginStep() {
+  mutex_lock l(mu_);
+  ++steps_in_flight_;
+  if (state_.load(std::memory_order_relaxed) != kRecording) return;
+  // Allocations of overlapping steps cannot be told apart.
+  recording_ = steps_in_flight_ == 1;
+  tick_ = 0;
+  recorded_.clear();
+  recorded_live_.clear();
+}
+
+void PlannedMemoryAllocator::EndStep(bool ok) {
+  mutex_lock l(mu_);
+  --steps_in_flight_;
+  if (!recording_) return;
+  recording_ = false;
+  if (ok && steps_in_flight_ == 0) FinishRecordedStep();
+  recorded_.clear();
+  recorded_live_.clear();
+}
+
+void PlannedMemoryAllocator::FinishRecordedStep() {
+  // Only buffers freed within the step can be planned; the rest are
+  // outputs or state that outlive it.
+  std::vector<Buffer> buffers;
+  for (const Buffer& b : recorded_) {
+    if (b.last_use >= 0 && b.size > 0) buffers.push_back(b);
+  }
+  std::vector<size_t> sizes(buffers.size());
+  for (size_t i = 0; i < buffers.size(); ++i) sizes[i] = buffers[i].size;
+  std::sort(sizes.begin(), sizes.end());
+  if (sizes == last_sizes_) {
+    ++num_matching_steps_;
+  } else {
+    num_matching_steps_ = 1;
+    last_sizes_.swap(sizes);
+  }
+  ++num_steps_recorded_;
+
+  if (num_matching_steps_ >= num_recorded_steps_) {
+    MakePlan(buffers);
+  } else if (num_steps_recorded_ >= kMaxRecordingFactor * num_recorded_steps_) {
+    VLOG(1) << "No two consecutive steps out of " << num_steps_recorded_
+            << " allocated the same buffers; not planning " << Name();
+    state_.store(kDisabled, std::memory_order_release);
+  }
+}
+
+void PlannedMemoryAllocator::MakePlan(const std::vector<Buffer>& buffers) {
+  last_sizes_.clear();
+  std::vector<size_t> offsets;
+  const size_t arena_bytes = PlanOffsets(buffers, &offsets);
+  if (arena_bytes == 0) {
+    state_.store(kDisabled, std::memory_order_release);
+    return;
+  }
+  AllocationAttributes attr;
+  attr.no_retry_on_failure = true;
+  arena_ = static_cast<char*>(
+      wrapped_->AllocateRaw(kAllocatorAlignment, arena_bytes, attr));
+  if (arena_ == nullptr) {
+    LOG(WARNING) << "Could not reserve a " << arena_bytes
+                 << "-byte arena for " << Name()
+                 << "; continuing without a memory plan";
+    state_.store(kDisabled, std::memory_order_release);
+    return;
+  }
+  arena_bytes_ = arena_bytes;
+
+  // Slots of a size are tried in the order they were allocated in.
+  std::vector<int> order(buffers.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&buffers](int a, int b) {
+    return buffers[a].first_use < buffers[b].first_use;
+  });
+  slots_.reserve(buffers.size());
+  for (int i : order) {
+    slots_by_size_[buffers[i].size].slots.push_back(slots_.size());
+    slots_.push_back({offsets[i], RoundUp(buffers[i].size)});
+  }
+
+  // Replay the recorded step to find its peak.
+  std::vector<std::pair<int64, int64>> events;
+  events.reserve(2 * buffers.size());
+  for (const Buffer& b : buffers) {
+    events.emplace_back(b.first_use, RoundUp(b.size));
+    events.emplace_back(b.last_use, -static_cast<int64>(RoundUp(b.size)));
+  }
+  std::sort(events.begin(), events.end());
+  int64 live = 0;
+  for (const auto& e : events) {
+    live += e.second;
+    stats_.peak_live_bytes = std::max(stats_.peak_live_bytes, live);
+  }
+  stats_.planned = true;
+  stats_.arena_bytes = arena_bytes;
+  stats_.num_planned_buffers = buffers.size();
+  LOG(INFO) << "Memory plan for " << Name() << ": " << buffers.size()
+            << " buffers in a " << arena_bytes << "-byte arena; the recorded "
+            << "step had at most " << stats_.peak_live_bytes
+            << " bytes live at once";
+  state_.store(kPlanned, std::memory_order_release);
+}
+
+void PlannedMemoryAllocator::GetPlanStats(PlanStats* stats) {
+  mutex_lock l(mu_);
+  *stats = stats_;
+}
+
+/*static*/ size_t PlannedMemoryAllocator::PlanOffsets(
+    const std::vector<Buffer>& buffers, std::vector<size_t>* offsets) {
+  offsets->assign(buffers.size(), 0);
+  std::vector<int> order(buffers.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&buffers](int a, int b) {
+    return buffers[a].size > buffers[b].size;
+  });
+
+  size_t arena_bytes = 0;
+  // Placed buffers, ordered by offset.
+  std::vector<int> placed;
+  for (int i : order) {
+    const size_t size = RoundUp(buffers[i].size);
+    size_t offset = 0;
+    for (int j : placed) {
+      if (!LiveAtSameTime(buffers[i], buffers[j])) continue;
+      if (offset + size <= (*offsets)[j]) break;
+      offset = std::max(offset, (*offsets)[j] + RoundUp(buffers[j].size));
+    }
+    (*offsets)[i] = offset;
+    arena_bytes = std::max(arena_bytes, offset + size);
+    auto pos = std::upper_bound(
+        placed.begin(), placed.end(), offset,
+        [offsets](size_t o, int j) { return o < (*offsets)[j]; });
+    placed.insert(pos, i);
+  }
+  return arena_bytes;
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,158 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_PLANNED_MEMORY_ALLOCATOR_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_PLANNED_MEMORY_ALLOCATOR_H_
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/lib/core/refcount.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// An allocator for the intermediate tensors of a graph that is run over and
+// over with the same input shapes.
+//
+// It starts out recording the allocations made through it during each step
+// (delimited by BeginStep() and EndStep()). Once "num_recorded_steps"
+// consecutive steps have made the same allocations, it computes an offset
+// for every buffer that was allocated and freed within a step, such that
+// buffers that were live at the same time do not overlap, and reserves a
+// single arena from the wrapped allocator that holds all of them. Later
+// requests of a planned size are served from the arena. Since ops may run
+// in a different order than during recording, a buffer is only handed out
+// if its range does not overlap any arena buffer that is still live;
+// anything that cannot be served that way, including every request of a
+// size that was not planned, goes to the wrapped allocator.
+//
+// Tensors keep a pointer to their allocator, so the allocator holds a
+// reference on itself for each outstanding allocation and is only deleted
+// once its owner has called Unref() and all its allocations have been
+// freed.
+class PlannedMemoryAllocator : public Allocator, public core::RefCounted {
+ public:
+  struct PlanStats {
+    // Whether allocations are being served from an arena.
+    bool planned = false;
+    // Size of the arena.
+    int64 arena_bytes = 0;
+    // Largest number of bytes live at once during the last recorded step,
+    // i.e. the smallest arena any plan could use.
+    int64 peak_live_bytes = 0;
+    int64 num_planned_buffers = 0;
+    // Allocations served from the arena and from the wrapped allocator
+    // since the plan was made.
+    int64 num_arena_allocs = 0;
+    int64 num_fallback_allocs = 0;
+
+    string DebugString() const;
+  };
+
+  // A buffer that was live from allocation "first_use" to deallocation
+  // "last_use", counted in allocator events.
+  struct Buffer {
+    size_t size;
+    int64 first_use;
+    int64 last_use;
+  };
+
+  // Does not take ownership of "wrapped", which must outlive this allocator.
+  PlannedMemoryAllocator(Allocator* wrapped, int num_recorded_steps);
+
+  string Name() override;
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override;
+  void* AllocateRaw(size_t alignment, size_t num_bytes,
+                    const AllocationAttributes& allocation_attr) override;
+  void DeallocateRaw(void* ptr) override;
+  void GetStats(AllocatorStats* stats) override { wrapped_->GetStats(stats); }
+
+  // Delimit a step. "ok" is false if the step failed, in which case its
+  // allocations are not used for planning.
+  void BeginStep();
+  void EndStep(bool ok);
+
+  void GetPlanStats(PlanStats* stats);
+
+  // Assigns non-overlapping offsets, in "offsets", to the "buffers" that
+  // are live at the same time, and returns the number of bytes needed to
+  // hold all of them. Larger buffers are placed first, each in the lowest
+  // gap that fits. Visible for testing.
+  static size_t PlanOffsets(const std::vector<Buffer>& buffers,
+                            std::vector<size_t>* offsets);
+
+ private:
+  ~PlannedMemoryAllocator() override;
+
+  enum State { kRecording, kPlanned, kDisabled };
+
+  // A planned buffer and its place in the arena.
+  struct Slot {
+    size_t offset;
+    size_t size;
+  };
+  struct SlotsOfSize {
+    std::vector<int> slots;
+    // Where to start looking for a free slot.
+    size_t next = 0;
+  };
+
+  void* AllocateFromArena(size_t num_bytes);
+  // Returns true if [offset, offset + size) overlaps a live arena buffer.
+  bool OverlapsLive(size_t offset, size_t size) const
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  void FinishRecordedStep() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  void MakePlan(const std::vector<Buffer>& buffers)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  Allocator* const wrapped_;
+  const int num_recorded_steps_;
+  std::atomic<State> state_;
+
+  mutex mu_;
+  int steps_in_flight_ GUARDED_BY(mu_) = 0;
+
+  // Recording. Allocations are only recorded while a single step runs.
+  bool recording_ GUARDED_BY(mu_) = false;
+  int64 tick_ GUARDED_BY(mu_) = 0;
+  std::vector<Buffer> recorded_ GUARDED_BY(mu_);
+  std::unordered_map<const void*, int> recorded_live_ GUARDED_BY(mu_);
+  std::vector<size_t> last_sizes_ GUARDED_BY(mu_);
+  int num_matching_steps_ GUARDED_BY(mu_) = 0;
+  int num_steps_recorded_ GUARDED_BY(mu_) = 0;
+
+  // Planned.
+  char* arena_ GUARDED_BY(mu_) = nullptr;
+  size_t arena_bytes_ GUARDED_BY(mu_) = 0;
+  std::vector<Slot> slots_ GUARDED_BY(mu_);
+  std::unordered_map<size_t, SlotsOfSize> slots_by_size_ GUARDED_BY(mu_);
+  // Live arena buffers, offset to end.
+  std::map<size_t, size_t> live_ GUARDED_BY(mu_);
+  PlanStats stats_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(PlannedMemoryAllocator);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_PLANNED_MEMORY_ALLOCATOR_H_
@@ -0,0 +1,181 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/planned_memory_allocator.h"
+
+#include <cstring>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace {
+
+// Counts the allocations made through it.
+class CountingAllocator : public Allocator {
+ public:
+  string Name() override { return "counting"; }
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    ++num_allocs_;
+    return cpu_allocator()->AllocateRaw(alignment, num_bytes);
+  }
+  void DeallocateRaw(void* ptr) override {
+    ++num_frees_;
+    cpu_allocator()->DeallocateRaw(ptr);
+  }
+
+  int num_allocs_ = 0;
+  int num_frees_ = 0;
+};
+
+// Allocates two overlapping buffers and then one that can reuse the first.
+void RunStep(PlannedMemoryAllocator* a) {
+  a->BeginStep();
+  void* x = a->AllocateRaw(Allocator::kAllocatorAlignment, 1000);
+  void* y = a->AllocateRaw(Allocator::kAllocatorAlignment, 2000);
+  memset(x, 1, 1000);
+  memset(y, 2, 2000);
+  a->DeallocateRaw(x);
+  void* z = a->AllocateRaw(Allocator::kAllocatorAlignment, 1000);
+  memset(z, 3, 1000);
+  a->DeallocateRaw(y);
+  a->DeallocateRaw(z);
+  a->EndStep(true);
+}
+
+TEST(PlannedMemoryAllocatorTest, PlanOffsets) {
+  std::vector<PlannedMemoryAllocator::Buffer> buffers = {
+      {100, 0, 3}, {200, 1, 2}, {100, 4, 5}, {64, 2, 6}};
+  std::vector<size_t> offsets;
+  // Sizes are rounded up to 64 bytes; the 200-byte buffer goes first, the
+  // last 100-byte one reuses its space.
+  EXPECT_EQ(448, PlannedMemoryAllocator::PlanOffsets(buffers, &offsets));
+  EXPECT_EQ(256, offsets[0]);
+  EXPECT_EQ(0, offsets[1]);
+  EXPECT_EQ(0, offsets[2]);
+  EXPECT_EQ(384, offsets[3]);
+
+  // Buffers that are never live at the same time share their memory.
+  buffers = {{1000, 0, 1}, {1000, 2, 3}, {1000, 4, 5}};
+  EXPECT_EQ(1024, PlannedMemoryAllocator::PlanOffsets(buffers, &offsets));
+}
+
+TEST(PlannedMemoryAllocatorTest, ServesFromArenaAfterRecording) {
+  CountingAllocator wrapped;
+  core::RefCountPtr<PlannedMemoryAllocator> a(
+      new PlannedMemoryAllocator(&wrapped, 2));
+  RunStep(a.get());
+  PlannedMemoryAllocator::PlanStats stats;
+  a->GetPlanStats(&stats);
+  EXPECT_FALSE(stats.planned);
+
+  RunStep(a.get());
+  a->GetPlanStats(&stats);
+  EXPECT_TRUE(stats.planned);
+  EXPECT_EQ(3, stats.num_planned_buffers);
+  EXPECT_EQ(1024 + 2048, stats.arena_bytes);
+  EXPECT_EQ(1024 + 2048, stats.peak_live_bytes);
+
+  // Six recorded allocations plus the arena.
+  EXPECT_EQ(7, wrapped.num_allocs_);
+  for (int i = 0; i < 10; ++i) RunStep(a.get());
+  EXPECT_EQ(7, wrapped.num_allocs_);
+  a->GetPlanStats(&stats);
+  EXPECT_EQ(30, stats.num_arena_allocs);
+  EXPECT_EQ(0, stats.num_fallback_allocs);
+}
+
+TEST(PlannedMemoryAllocatorTest, FallsBackForUnplannedSizes) {
+  CountingAllocator wrapped;
+  core::RefCountPtr<PlannedMemoryAllocator> a(
+      new PlannedMemoryAllocator(&wrapped, 1));
+  RunStep(a.get());
+  const int num_allocs = wrapped.num_allocs_;
+  const int num_frees = wrapped.num_frees_;
+
+  a->BeginStep();
+  void* p = a->AllocateRaw(Allocator::kAllocatorAlignment, 4000);
+  EXPECT_EQ(num_allocs + 1, wrapped.num_allocs_);
+  a->DeallocateRaw(p);
+  EXPECT_EQ(num_frees + 1, wrapped.num_frees_);
+  a->EndStep(true);
+
+  PlannedMemoryAllocator::PlanStats stats;
+  a->GetPlanStats(&stats);
+  EXPECT_EQ(1, stats.num_fallback_allocs);
+}
+
+TEST(PlannedMemoryAllocatorTest, NeverHandsOutLiveMemory) {
+  CountingAllocator wrapped;
+  core::RefCountPtr<PlannedMemoryAllocator> a(
+      new PlannedMemoryAllocator(&wrapped, 1));
+  RunStep(a.get());
+
+  // Keep every buffer alive: x and z share their planned offset, so z must
+  // come from the wrapped allocator.
+  a->BeginStep();
+  char* x = static_cast<char*>(a->AllocateRaw(64, 1000));
+  char* y = static_cast<char*>(a->AllocateRaw(64, 2000));
+  char* z = static_cast<char*>(a->AllocateRaw(64, 1000));
+  EXPECT_TRUE(z + 1000 <= x || x + 1000 <= z);
+  EXPECT_TRUE(y + 2000 <= x || x + 1000 <= y);
+  a->DeallocateRaw(x);
+  a->DeallocateRaw(y);
+  a->DeallocateRaw(z);
+  a->EndStep(true);
+
+  PlannedMemoryAllocator::PlanStats stats;
+  a->GetPlanStats(&stats);
+  EXPECT_EQ(2, stats.num_arena_allocs);
+  EXPECT_EQ(1, stats.num_fallback_allocs);
+}
+
+TEST(PlannedMemoryAllocatorTest, DifferentStepsRestartRecording) {
+  CountingAllocator wrapped;
+  core::RefCountPtr<PlannedMemoryAllocator> a(
+      new PlannedMemoryAllocator(&wrapped, 2));
+  RunStep(a.get());
+  a->BeginStep();
+  a->DeallocateRaw(a->AllocateRaw(64, 10));
+  a->EndStep(true);
+  RunStep(a.get());
+  PlannedMemoryAllocator::PlanStats stats;
+  a->GetPlanStats(&stats);
+  EXPECT_FALSE(stats.planned);
+  RunStep(a.get());
+  a->GetPlanStats(&stats);
+  EXPECT_TRUE(stats.planned);
+}
+
+TEST(PlannedMemoryAllocatorTest, OutlivesOwnerWhileAllocationsAreLive) {
+  CountingAllocator wrapped;
+  PlannedMemoryAllocator* a = new PlannedMemoryAllocator(&wrapped, 1);
+  RunStep(a);
+  a->BeginStep();
+  void* p = a->AllocateRaw(64, 1000);
+  a->EndStep(true);
+  a->Unref();
+  // The arena is still around.
+  memset(p, 0, 1000);
+  const int num_frees = wrapped.num_frees_;
+  a->DeallocateRaw(p);
+  EXPECT_EQ(num_frees + 1, wrapped.num_frees_);
+  EXPECT_EQ(wrapped.num_allocs_, wrapped.num_frees_);
+}
+
+}  // namespace
+}  // namespace tensorflow
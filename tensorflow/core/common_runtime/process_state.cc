@@ -19,6 +19,7 @@ limitations under the License.
 #include <vector>
 
 #include "tensorflow/core/common_runtime/bfc_allocator.h"
+#include "tensorflow/core/common_runtime/caching_allocator.h"
 #include "tensorflow/core/common_runtime/pool_allocator.h"
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/log_memory.h"
@@ -109,6 +110,21 @@ VisitableAllocator* ProcessState::GetCPUAllocator(int numa_node) {
               << "numa_enabled_=" << numa_enabled_
               << " numa_node=" << numa_node;
     }
+    bool use_allocator_cache = false;
+    status = ReadBoolFromEnvVar("TF_CPU_ALLOCATOR_USE_CACHE", false,
+                                &use_allocator_cache);
+    if (!status.ok()) {
+      LOG(ERROR) << "GetCPUAllocator: " << status.error_message();
+    }
+    if (use_allocator_cache) {
+      // Serve small allocations from lock-sharded caches of freed chunks
+      // instead of taking the wrapped allocator's global lock every time.
+      allocator = new CachingAllocator(allocator, CachingAllocator::Options(),
+                                       strings::StrCat(allocator->Name(),
+                                                       "_cached"));
+      VLOG(2) << "Using CachingAllocator in front of the ProcessState CPU "
+              << "allocator";
+    }
     if (LogMemory::IsEnabled()) {
       // Wrap the allocator to track allocation ids for better logging
       // at the cost of performance.
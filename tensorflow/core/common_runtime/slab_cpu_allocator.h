@@ -0,0 +1,156 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_SLAB_CPU_ALLOCATOR_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_SLAB_CPU_ALLOCATOR_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// A CPU allocator for the many small, short-lived tensors of inference
+// graphs.
+//
+// Requests of up to kMaxSlabBlockBytes are rounded up to one of
+// kNumSizeClasses size classes, all multiples of 64 bytes. Each size class
+// is served from 2MB slabs carved out of a single virtual address range that
+// is reserved up front and advised to be backed by transparent huge pages.
+// Freed blocks go to a per-thread free list for their size class, so the
+// common allocate/free path takes no lock; batches of blocks move between
+// the per-thread lists and a central list per size class when a thread runs
+// dry or accumulates too many. Larger requests, and requests needing more
+// than 64-byte alignment, fall through to port::AlignedMalloc.
+//
+// Slab memory is never returned to the operating system.
+//
+// The allocator is registered with AllocatorFactoryRegistry as
+// "SlabCPUAllocator"; it becomes the cpu_allocator() when the
+// TF_CPU_ALLOCATOR_TYPE environment variable is set to "slab".
+class SlabCPUAllocator : public Allocator {
+ public:
+  static constexpr int kNumSizeClasses = 48;
+  static constexpr size_t kMaxSlabBlockBytes = 256 << 10;
+  static constexpr size_t kSlabBytes = 2 << 20;
+  static constexpr size_t kDefaultReservedBytes =
+      size_t{1} << (sizeof(void*) == 8 ? 36 : 28);
+
+  struct SizeClassStats {
+    size_t block_bytes = 0;
+    int64 num_allocs = 0;
+    int64 bytes_in_use = 0;
+    int64 num_slabs = 0;
+  };
+
+  // Reserves "reserved_bytes" of virtual address space for slabs. If the
+  // reservation fails, every request falls through to port::AlignedMalloc.
+  explicit SlabCPUAllocator(size_t reserved_bytes = kDefaultReservedBytes);
+  ~SlabCPUAllocator() override;
+
+  string Name() override { return "slab_cpu"; }
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override;
+  void DeallocateRaw(void* ptr) override;
+  size_t AllocatedSizeSlow(const void* ptr) override;
+
+  // "max_bytes_in_use" is only updated when stats are read.
+  void GetStats(AllocatorStats* stats) override;
+  void ClearStats() override;
+
+  // Returns one entry per size class.
+  void GetSizeClassStats(std::vector<SizeClassStats>* stats);
+
+  // Returns the size class for a request of "num_bytes", or -1 if it is
+  // too large to be served from slabs.
+  static int SizeClass(size_t num_bytes);
+  static size_t SizeClassBytes(int size_class);
+
+ private:
+  struct ThreadCache;
+  struct CentralList {
+    mutex mu;
+    void* head GUARDED_BY(mu) = nullptr;
+    int64 count GUARDED_BY(mu) = 0;
+    int64 num_slabs GUARDED_BY(mu) = 0;
+  };
+
+  ThreadCache* GetThreadCache();
+  void* AllocateLarge(size_t alignment, size_t num_bytes);
+  void DeallocateLarge(void* ptr);
+  // Moves a batch of blocks of "size_class" from the central list, carving
+  // a new slab if needed, into "cache". Returns false if out of slabs.
+  bool Refill(ThreadCache* cache, int size_class);
+  // Returns blocks of "size_class" from "cache" to the central list until
+  // "keep" are left.
+  void Drain(ThreadCache* cache, int size_class, int keep);
+  // Drains the caches of threads that have exited.
+  void ReclaimOrphanedCaches();
+  // Sums the per-thread counters of every size class.
+  void CollectCounts(int64* allocs, int64* frees)
+      EXCLUSIVE_LOCKS_REQUIRED(caches_mu_);
+  // Totals over all size classes and large allocations.
+  void CollectTotals(int64* num_allocs, int64* bytes_in_use)
+      EXCLUSIVE_LOCKS_REQUIRED(caches_mu_);
+  bool InSlabRegion(const void* ptr) const {
+    return region_begin_ != nullptr && ptr >= region_begin_ &&
+           ptr < region_end_;
+  }
+
+  // Unique among all SlabCPUAllocator instances of the process, so that
+  // thread caches are never matched with the wrong allocator.
+  const uint64 id_;
+
+  // Start of the mapping that contains the reserved range.
+  void* mapping_ = nullptr;
+  size_t mapping_bytes_ = 0;
+  // Reserved, kSlabBytes-aligned slab range.
+  char* region_begin_ = nullptr;
+  char* region_end_ = nullptr;
+
+  mutex region_mu_;
+  char* next_slab_ GUARDED_BY(region_mu_) = nullptr;
+  bool region_exhausted_ GUARDED_BY(region_mu_) = false;
+  // Size class of each carved slab, indexed by slab number.
+  std::unique_ptr<std::atomic<int8>[]> slab_size_class_;
+
+  CentralList central_[kNumSizeClasses];
+
+  mutex caches_mu_;
+  std::vector<std::shared_ptr<ThreadCache>> caches_ GUARDED_BY(caches_mu_);
+  // Counters of reclaimed thread caches.
+  int64 retired_allocs_[kNumSizeClasses] GUARDED_BY(caches_mu_);
+  int64 retired_frees_[kNumSizeClasses] GUARDED_BY(caches_mu_);
+
+  // Requests served by port::AlignedMalloc.
+  std::atomic<int64> num_large_allocs_;
+  std::atomic<int64> large_bytes_in_use_;
+  std::atomic<int64> max_alloc_size_;
+  int64 max_bytes_in_use_ GUARDED_BY(caches_mu_) = 0;
+  // Value of the "num_allocs" statistic at the last ClearStats().
+  int64 num_allocs_cleared_ GUARDED_BY(caches_mu_) = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(SlabCPUAllocator);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_SLAB_CPU_ALLOCATOR_H_
@@ -0,0 +1,227 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/slab_cpu_allocator.h"
+
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace {
+
+// Enough for the tests; the default reserves far more address space.
+constexpr size_t kTestReservedBytes = 256 << 20;
+
+size_t RoundUp(size_t num_bytes) {
+  return SlabCPUAllocator::SizeClassBytes(
+      SlabCPUAllocator::SizeClass(num_bytes));
+}
+
+TEST(SlabCPUAllocatorTest, SizeClasses) {
+  EXPECT_EQ(64, RoundUp(0));
+  EXPECT_EQ(64, RoundUp(1));
+  EXPECT_EQ(128, RoundUp(65));
+  EXPECT_EQ(1024, RoundUp(1024));
+  EXPECT_EQ(1280, RoundUp(1025));
+  EXPECT_EQ(SlabCPUAllocator::kMaxSlabBlockBytes,
+            RoundUp(SlabCPUAllocator::kMaxSlabBlockBytes));
+  EXPECT_EQ(SlabCPUAllocator::kNumSizeClasses - 1,
+            SlabCPUAllocator::SizeClass(SlabCPUAllocator::kMaxSlabBlockBytes));
+  EXPECT_EQ(-1, SlabCPUAllocator::SizeClass(
+                    SlabCPUAllocator::kMaxSlabBlockBytes + 1));
+  for (size_t n = 1; n <= SlabCPUAllocator::kMaxSlabBlockBytes; n += 13) {
+    const int size_class = SlabCPUAllocator::SizeClass(n);
+    const size_t bytes = SlabCPUAllocator::SizeClassBytes(size_class);
+    // The smallest class that fits, and a multiple of 64 bytes.
+    EXPECT_GE(bytes, n);
+    if (size_class > 0) {
+      EXPECT_LT(SlabCPUAllocator::SizeClassBytes(size_class - 1), n);
+    }
+    EXPECT_EQ(0, bytes % 64);
+  }
+}
+
+TEST(SlabCPUAllocatorTest, ReusesFreedBlocks) {
+  SlabCPUAllocator a(kTestReservedBytes);
+  void* p1 = a.AllocateRaw(Allocator::kAllocatorAlignment, 100);
+  ASSERT_NE(p1, nullptr);
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(p1) % 64);
+  EXPECT_EQ(128, a.AllocatedSizeSlow(p1));
+  a.DeallocateRaw(p1);
+  void* p2 = a.AllocateRaw(Allocator::kAllocatorAlignment, 128);
+  EXPECT_EQ(p1, p2);
+  a.DeallocateRaw(p2);
+}
+
+TEST(SlabCPUAllocatorTest, LargeAndOverAlignedAllocations) {
+  SlabCPUAllocator a(kTestReservedBytes);
+  void* large = a.AllocateRaw(Allocator::kAllocatorAlignment, 1 << 20);
+  ASSERT_NE(large, nullptr);
+  EXPECT_EQ(1 << 20, a.AllocatedSizeSlow(large));
+  void* aligned = a.AllocateRaw(4096, 100);
+  ASSERT_NE(aligned, nullptr);
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(aligned) % 4096);
+  memset(large, 0, 1 << 20);
+  memset(aligned, 0, 100);
+
+  std::vector<SlabCPUAllocator::SizeClassStats> stats;
+  a.GetSizeClassStats(&stats);
+  for (const auto& s : stats) EXPECT_EQ(0, s.num_slabs);
+
+  a.DeallocateRaw(large);
+  a.DeallocateRaw(aligned);
+}
+
+TEST(SlabCPUAllocatorTest, FallsBackWhenOutOfSlabs) {
+  SlabCPUAllocator a(SlabCPUAllocator::kSlabBytes);
+  std::vector<void*> ptrs;
+  // Two size classes, but room for a single slab.
+  ptrs.push_back(a.AllocateRaw(Allocator::kAllocatorAlignment, 64));
+  ptrs.push_back(a.AllocateRaw(Allocator::kAllocatorAlignment, 4096));
+  for (void* p : ptrs) ASSERT_NE(p, nullptr);
+  EXPECT_EQ(4096, a.AllocatedSizeSlow(ptrs[1]));
+  for (void* p : ptrs) a.DeallocateRaw(p);
+}
+
+TEST(SlabCPUAllocatorTest, Stats) {
+  SlabCPUAllocator a(kTestReservedBytes);
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 10; ++i) {
+    ptrs.push_back(a.AllocateRaw(Allocator::kAllocatorAlignment, 1000));
+  }
+  ptrs.push_back(a.AllocateRaw(Allocator::kAllocatorAlignment, 1 << 20));
+
+  AllocatorStats stats;
+  a.GetStats(&stats);
+  EXPECT_EQ(11, stats.num_allocs);
+  EXPECT_EQ(10 * 1024 + (1 << 20), stats.bytes_in_use);
+  EXPECT_EQ(1 << 20, stats.max_alloc_size);
+
+  std::vector<SlabCPUAllocator::SizeClassStats> class_stats;
+  a.GetSizeClassStats(&class_stats);
+  ASSERT_EQ(SlabCPUAllocator::kNumSizeClasses, class_stats.size());
+  const auto& s = class_stats[SlabCPUAllocator::SizeClass(1000)];
+  EXPECT_EQ(1024, s.block_bytes);
+  EXPECT_EQ(10, s.num_allocs);
+  EXPECT_EQ(10 * 1024, s.bytes_in_use);
+  EXPECT_EQ(1, s.num_slabs);
+
+  for (void* p : ptrs) a.DeallocateRaw(p);
+  a.GetStats(&stats);
+  EXPECT_EQ(0, stats.bytes_in_use);
+  EXPECT_EQ(10 * 1024 + (1 << 20), stats.max_bytes_in_use);
+
+  a.ClearStats();
+  a.GetStats(&stats);
+  EXPECT_EQ(0, stats.num_allocs);
+  EXPECT_EQ(0, stats.max_bytes_in_use);
+  EXPECT_EQ(0, stats.max_alloc_size);
+}
+
+TEST(SlabCPUAllocatorTest, ConcurrentAllocations) {
+  SlabCPUAllocator a(kTestReservedBytes);
+  std::vector<void*> handoff[8];
+  {
+    thread::ThreadPool pool(Env::Default(), "test", 8);
+    for (int t = 0; t < 8; ++t) {
+      pool.Schedule([&a, &handoff, t]() {
+        std::vector<void*> live;
+        for (int i = 0; i < 2000; ++i) {
+          const size_t bytes = 1 + ((i * 37 + t) % 16384);
+          void* p = a.AllocateRaw(Allocator::kAllocatorAlignment, bytes);
+          CHECK(p != nullptr);
+          memset(p, t, bytes);
+          live.push_back(p);
+          if (live.size() > 16) {
+            a.DeallocateRaw(live.front());
+            live.erase(live.begin());
+          }
+        }
+        // Left for another thread to free.
+        handoff[t] = live;
+      });
+    }
+  }
+  // Blocks freed by a thread other than the one that allocated them.
+  for (const auto& ptrs : handoff) {
+    for (void* p : ptrs) a.DeallocateRaw(p);
+  }
+  AllocatorStats stats;
+  a.GetStats(&stats);
+  EXPECT_EQ(0, stats.bytes_in_use);
+  EXPECT_EQ(8 * 2000, stats.num_allocs);
+}
+
+// Multithreaded allocate/free churn of small tensors.
+static void RunAllocationThreaded(Allocator* a, int iters, int num_threads) {
+  thread::ThreadPool pool(Env::Default(), "test", num_threads);
+  std::atomic_int_fast32_t count(iters);
+  mutex done_lock;
+  condition_variable done;
+  bool done_flag = false;
+
+  for (int t = 0; t < num_threads; t++) {
+    pool.Schedule([a, &count, &done_lock, &done, &done_flag, iters]() {
+      std::vector<int> sizes = {64, 4096, 256, 16384, 512, 2048, 128, 768};
+      int size_index = 0;
+      void* held[4] = {nullptr, nullptr, nullptr, nullptr};
+      for (int i = 0; i < iters; i++) {
+        int bytes = sizes[size_index++ % sizes.size()];
+        void*& slot = held[i % 4];
+        if (slot != nullptr) a->DeallocateRaw(slot);
+        slot = a->AllocateRaw(Allocator::kAllocatorAlignment, bytes);
+        if (count.fetch_sub(1) == 1) {
+          mutex_lock l(done_lock);
+          done_flag = true;
+          done.notify_all();
+          break;
+        }
+      }
+      for (void* p : held) {
+        if (p != nullptr) a->DeallocateRaw(p);
+      }
+    });
+  }
+  mutex_lock l(done_lock);
+  if (!done_flag) {
+    done.wait(l);
+  }
+}
+
+static void BM_CPUAllocationThreaded(int iters, int num_threads) {
+  RunAllocationThreaded(cpu_allocator(), iters, num_threads);
+  testing::ItemsProcessed(iters);
+}
+BENCHMARK(BM_CPUAllocationThreaded)->Arg(1)->Arg(4)->Arg(16);
+
+static void BM_SlabCPUAllocationThreaded(int iters, int num_threads) {
+  testing::StopTiming();
+  SlabCPUAllocator a;
+  testing::StartTiming();
+  RunAllocationThreaded(&a, iters, num_threads);
+  testing::ItemsProcessed(iters);
+}
+BENCHMARK(BM_SlabCPUAllocationThreaded)->Arg(1)->Arg(4)->Arg(16);
+
+}  // namespace
+}  // namespace tensorflow
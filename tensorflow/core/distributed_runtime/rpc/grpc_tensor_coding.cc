@@ -17,6 +17,7 @@ limitations under the License.
 #include "grpcpp/support/byte_buffer.h"
 #include "grpcpp/support/slice.h"
 #include "tensorflow/core/common_runtime/dma_helper.h"
+#include "tensorflow/core/framework/bfloat16.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/tensor_reference.h"
@@ -24,6 +25,8 @@ limitations under the License.
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/io/proto_encode_helper.h"
 #include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/snappy.h"
+#include "tensorflow/core/protobuf/config.pb.h"
 #include "tensorflow/core/protobuf/worker.pb.h"
 
 // (Omitted internal-only flag)
@@ -135,22 +138,20 @@ static void EncodeSkeleton(const Tensor& val, io::ProtoEncodeHelper* e) {
 #endif
 }
 
-void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val,
-                              ::grpc::ByteBuffer* result) {
+// Encodes "response", whose tensor field is not set, with "val" as its
+// tensor.
+static void EncodeResponseWithTensor(RecvTensorResponse* response,
+                                     const Tensor& val,
+                                     ::grpc::ByteBuffer* result) {
   const int kLargeTensorBytes = 1024;
-  RecvTensorResponse response;
-  if (is_dead) {
-    response.set_is_dead(is_dead);
-  }
-  response.set_send_start_micros(Env::Default()->NowMicros());
   if (!DataTypeCanUseMemcpy(val.dtype())) {
     // Straightforward but slow path for complicated kinds of tensor data
     // TODO(jeff,sanjay): If this becomes an issue, we could
     // go directly from val -> ByteBuffer, with some effort.
-    val.AsProtoTensorContent(response.mutable_tensor());
+    val.AsProtoTensorContent(response->mutable_tensor());
 
     // Encode full protocol buffer to a ByteBuffer
-    EncodeRecvTensorResponseToByteBuffer(response, result);
+    EncodeRecvTensorResponseToByteBuffer(*response, result);
   } else {
     // skeleton is the encoded TensorProto contents (dtype and shape), but
     // not the actual data
@@ -164,7 +165,7 @@ void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val,
          VarLengthEncodingSize(TensorProto::kTensorContentFieldNumber,
                                tdata.size()));
     string header;  // All of RecvTensorResponse except the tensor() field
-    response.AppendToString(&header);
+    response->AppendToString(&header);
 
     size_t expected_size =
         (header.size() +
@@ -242,5 +243,79 @@ void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val,
   }
 }
 
+void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val,
+                              ::grpc::ByteBuffer* result) {
+  RecvTensorResponse response;
+  if (is_dead) {
+    response.set_is_dead(is_dead);
+  }
+  response.set_send_start_micros(Env::Default()->NowMicros());
+  EncodeResponseWithTensor(&response, val, result);
+}
+
+void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val,
+                              const RecvTensorRequest& request,
+                              ::grpc::ByteBuffer* result) {
+  const int64 kDefaultMinEncodedBytes = 64 << 10;
+  const int64 min_bytes = request.encoding_min_bytes() > 0
+                              ? request.encoding_min_bytes()
+                              : kDefaultMinEncodedBytes;
+  const bool convert_float =
+      val.dtype() == DT_FLOAT &&
+      (request.float_type() == DT_HALF || request.float_type() == DT_BFLOAT16);
+  const bool compress = request.compression() == RPCOptions::SNAPPY &&
+                        DataTypeCanUseMemcpy(val.dtype());
+  if (is_dead || (!convert_float && !compress) ||
+      static_cast<int64>(val.TotalBytes()) < min_bytes) {
+    EncodeTensorToByteBuffer(is_dead, val, result);
+    return;
+  }
+
+  RecvTensorResponse response;
+  const uint64 start_micros = Env::Default()->NowMicros();
+  response.set_send_start_micros(start_micros);
+  Tensor encoded = val;
+  if (convert_float) {
+    encoded = Tensor(request.float_type(), val.shape());
+    if (request.float_type() == DT_HALF) {
+      encoded.flat<Eigen::half>() = val.flat<float>().cast<Eigen::half>();
+    } else {
+      FloatToBFloat16(val.flat<float>().data(),
+                      encoded.flat<bfloat16>().data(), val.NumElements());
+    }
+    response.set_original_dtype(DT_FLOAT);
+  }
+  if (compress) {
+    StringPiece tdata = encoded.tensor_data();
+    string compressed;
+    // Snappy may not be available, and incompressible data is better sent
+    // as it is.
+    if (port::Snappy_Compress(tdata.data(), tdata.size(), &compressed) &&
+        compressed.size() < tdata.size()) {
+      response.set_compression(RPCOptions::SNAPPY);
+      response.set_encode_micros(Env::Default()->NowMicros() - start_micros);
+      // As above, the tensor goes after the other fields, so that the
+      // receiver knows it is compressed by the time it gets to it.
+      string header;
+      response.AppendToString(&header);
+      RecvTensorResponse tensor_only;
+      TensorProto* tensor = tensor_only.mutable_tensor();
+      tensor->set_dtype(encoded.dtype());
+      encoded.shape().AsProto(tensor->mutable_tensor_shape());
+      tensor->mutable_tensor_content()->swap(compressed);
+      ::grpc::Slice slice(header.size() + tensor_only.ByteSizeLong());
+      uint8* dst =
+          const_cast<uint8*>(reinterpret_cast<const uint8*>(slice.begin()));
+      memcpy(dst, header.data(), header.size());
+      tensor_only.SerializeWithCachedSizesToArray(dst + header.size());
+      ::grpc::ByteBuffer tmp(&slice, 1);
+      result->Swap(&tmp);
+      return;
+    }
+  }
+  response.set_encode_micros(Env::Default()->NowMicros() - start_micros);
+  EncodeResponseWithTensor(&response, encoded, result);
+}
+
 }  // namespace grpc
 }  // namespace tensorflow
@@ -22,6 +22,7 @@ class ByteBuffer;
 
 namespace tensorflow {
 class Tensor;
+class RecvTensorRequest;
 class RecvTensorResponse;
 
 // TODO(jeff,sanjay): this should not be grpc specific.  Instead of
@@ -51,6 +52,13 @@ void EncodeRecvTensorResponseToByteBuffer(const RecvTensorResponse& proto,
 void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val,
                               ::grpc::ByteBuffer* result);
 
+// Like above, but compresses "val" or converts it to a smaller float type
+// if "request" asks for it and "val" is large enough, and records in the
+// response what was done.
+void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val,
+                              const RecvTensorRequest& request,
+                              ::grpc::ByteBuffer* result);
+
 }  // namespace grpc
 }  // namespace tensorflow
 
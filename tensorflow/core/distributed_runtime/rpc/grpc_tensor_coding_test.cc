@@ -17,15 +17,39 @@ limitations under the License.
 
 #include "grpcpp/support/byte_buffer.h"
 #include "grpcpp/support/slice.h"
+#include "tensorflow/core/distributed_runtime/rpc/grpc_util.h"
+#include "tensorflow/core/distributed_runtime/tensor_coding.h"
+#include "tensorflow/core/framework/device_attributes.pb.h"
+#include "tensorflow/core/framework/device_base.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/tensor_util.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/snappy.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/protobuf/config.pb.h"
 #include "tensorflow/core/protobuf/worker.pb.h"
 
 namespace tensorflow {
 
+class DummyDevice : public DeviceBase {
+ public:
+  explicit DummyDevice(Env* env) : DeviceBase(env) {
+    attr_.set_device_type("CPU");
+  }
+
+  const DeviceAttributes& attributes() const override { return attr_; }
+
+  Allocator* GetAllocator(AllocatorAttributes attr) override {
+    return cpu_allocator();
+  }
+
+ private:
+  DeviceAttributes attr_;
+};
+
 class GrpcTensorCodingTest : public ::testing::Test {
  public:
   void Validate(const Tensor& t, bool is_dead) {
@@ -100,4 +124,108 @@ TEST_F(GrpcTensorCodingTest, Simple) {
 
 TEST_F(GrpcTensorCodingTest, StringTensor) { DoTestForStrings(DT_STRING); }
 
+TEST_F(GrpcTensorCodingTest, ReceiveSharesAlignedSlice) {
+  const int64 kElems = 1 << 16;
+  Tensor a(DT_FLOAT, TensorShape({kElems}));
+  test::FillFn<float>(&a, [](int i) { return static_cast<float>(i); });
+  Tensor expected = tensor::DeepCopy(a);
+
+  // The encoded tensor contents share the memory of "a", which is aligned.
+  ::grpc::ByteBuffer buf;
+  grpc::EncodeTensorToByteBuffer(false, a, &buf);
+  DummyDevice cpu_device(Env::Default());
+  TensorResponse response;
+  response.InitAlloc(&cpu_device, AllocatorAttributes());
+  ASSERT_TRUE(GrpcMaybeParseProto(&buf, &response));
+  EXPECT_EQ(a.tensor_data().data(), response.tensor().tensor_data().data());
+
+  // The received tensor keeps the slice alive.
+  buf.Clear();
+  a = Tensor();
+  test::ExpectTensorEqual<float>(expected, response.tensor());
+}
+
+TEST_F(GrpcTensorCodingTest, ReceiveCopiesMisalignedSlice) {
+  const int64 kElems = 1 << 16;
+  Tensor a(DT_FLOAT, TensorShape({kElems + 1}));
+  test::FillFn<float>(&a, [](int i) { return static_cast<float>(i); });
+  const Tensor unaligned = a.Slice(1, kElems + 1);
+  ASSERT_FALSE(unaligned.IsAligned());
+
+  ::grpc::ByteBuffer buf;
+  grpc::EncodeTensorToByteBuffer(false, unaligned, &buf);
+  DummyDevice cpu_device(Env::Default());
+  TensorResponse response;
+  response.InitAlloc(&cpu_device, AllocatorAttributes());
+  ASSERT_TRUE(GrpcMaybeParseProto(&buf, &response));
+  EXPECT_TRUE(response.tensor().IsAligned());
+  EXPECT_NE(unaligned.tensor_data().data(),
+            response.tensor().tensor_data().data());
+  test::ExpectTensorEqual<float>(unaligned, response.tensor());
+}
+
+// Sends "t" as asked for by "request" and returns what was received.
+TensorResponse SendAndReceive(const Tensor& t,
+                              const RecvTensorRequest& request) {
+  ::grpc::ByteBuffer buf;
+  grpc::EncodeTensorToByteBuffer(false, t, request, &buf);
+  DummyDevice cpu_device(Env::Default());
+  TensorResponse response;
+  response.InitAlloc(&cpu_device, AllocatorAttributes());
+  EXPECT_TRUE(GrpcMaybeParseProto(&buf, &response));
+  return response;
+}
+
+TEST_F(GrpcTensorCodingTest, SnappyCompression) {
+  string unused;
+  if (!port::Snappy_Compress("", 0, &unused)) return;  // Not built in.
+
+  Tensor a(DT_INT64, TensorShape({1 << 15}));
+  test::FillFn<int64>(&a, [](int i) { return i % 7; });
+  const int64 num_bytes = a.TotalBytes();
+  RecvTensorRequest request;
+  request.set_compression(RPCOptions::SNAPPY);
+  TensorResponse response = SendAndReceive(a, request);
+  test::ExpectTensorEqual<int64>(a, response.tensor());
+  EXPECT_EQ(response.metadata().compression(), RPCOptions::SNAPPY);
+  EXPECT_EQ(response.coding_stats().decoded_bytes, num_bytes);
+  EXPECT_LT(response.coding_stats().encoded_bytes, num_bytes / 4);
+
+  // Small tensors are sent as they are.
+  request.set_encoding_min_bytes(num_bytes + 1);
+  response = SendAndReceive(a, request);
+  test::ExpectTensorEqual<int64>(a, response.tensor());
+  EXPECT_EQ(response.metadata().compression(), RPCOptions::NO_COMPRESSION);
+  EXPECT_EQ(response.coding_stats().encoded_bytes, 0);
+}
+
+TEST_F(GrpcTensorCodingTest, FloatConversion) {
+  Tensor a(DT_FLOAT, TensorShape({128, 256}));
+  test::FillFn<float>(&a, [](int i) { return (i % 100) * 0.25f; });
+  const int64 num_bytes = a.TotalBytes();
+  for (DataType float_type : {DT_HALF, DT_BFLOAT16}) {
+    RecvTensorRequest request;
+    request.set_float_type(float_type);
+    TensorResponse response = SendAndReceive(a, request);
+    EXPECT_EQ(response.metadata().original_dtype(), DT_FLOAT);
+    EXPECT_EQ(response.coding_stats().encoded_bytes, num_bytes / 2);
+    EXPECT_EQ(response.coding_stats().decoded_bytes, num_bytes);
+    test::ExpectTensorNear<float>(a, response.tensor(), 0.25);
+
+    // Conversion and compression can be combined.
+    request.set_compression(RPCOptions::SNAPPY);
+    response = SendAndReceive(a, request);
+    EXPECT_EQ(response.tensor().dtype(), DT_FLOAT);
+    test::ExpectTensorNear<float>(a, response.tensor(), 0.25);
+  }
+
+  // Other types are never converted.
+  Tensor b(DT_DOUBLE, TensorShape({1 << 14}));
+  test::FillFn<double>(&b, [](int i) { return i / 3.0; });
+  RecvTensorRequest request;
+  request.set_float_type(DT_HALF);
+  TensorResponse response = SendAndReceive(b, request);
+  test::ExpectTensorEqual<double>(b, response.tensor());
+}
+
 }  // namespace tensorflow
@@ -15,9 +15,65 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/rpc/grpc_util.h"
 #include "tensorflow/core/distributed_runtime/tensor_coding.h"
+#include "tensorflow/core/framework/allocation_description.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 
+namespace {
+
+// A TensorBuffer that points into a received slice and keeps it alive.
+class GrpcSliceBuffer : public TensorBuffer {
+ public:
+  GrpcSliceBuffer(const ::grpc::Slice& slice, const char* data, size_t size)
+      : slice_(slice), data_(const_cast<char*>(data)), size_(size) {}
+
+  void* data() const override { return data_; }
+  size_t size() const override { return size_; }
+  TensorBuffer* root_buffer() override { return this; }
+  void FillAllocationDescription(AllocationDescription* proto) const override {
+    proto->set_requested_bytes(static_cast<int64>(size_));
+    proto->set_allocator_name("grpc");
+  }
+  // The slice may still be referenced elsewhere, e.g. by the sender when
+  // both ends of the RPC are in the same process, so it must not be
+  // forwarded to ops that write their output in place.
+  bool OwnsMemory() const override { return false; }
+
+ private:
+  const ::grpc::Slice slice_;
+  char* const data_;
+  const size_t size_;
+};
+
+bool ZeroCopyRecvEnabled() {
+  static const bool enabled = [] {
+    bool enabled;
+    TF_CHECK_OK(ReadBoolFromEnvVar("TF_GRPC_ZERO_COPY_RECV", true, &enabled));
+    return enabled;
+  }();
+  return enabled;
+}
+
+}  // namespace
+
+TensorBuffer* GrpcByteSource::AdoptBuffer(const char* data, size_t size) {
+  if (!ZeroCopyRecvEnabled()) return nullptr;
+  std::vector<::grpc::Slice> slices;
+  if (!buffer_->Dump(&slices).ok()) return nullptr;
+  for (const ::grpc::Slice& s : slices) {
+    const char* begin = reinterpret_cast<const char*>(s.begin());
+    if (data >= begin && data + size <= begin + s.size()) {
+      return new GrpcSliceBuffer(s, data, size);
+    }
+  }
+  // The data was not read from one of the buffer's slices, e.g. because
+  // the message was compressed and the reader inflated it into memory of
+  // its own.
+  return nullptr;
+}
+
 ::grpc::Status GrpcMaybeUnparseProto(const protobuf::Message& src,
                                      grpc::ByteBuffer* dst) {
   bool own_buffer;
@@ -44,6 +44,10 @@ class GrpcByteSource : public TensorResponse::Source {
     return stream_;
   }
 
+  // Shares the received slice that holds [data, data + size). Disabled by
+  // setting TF_GRPC_ZERO_COPY_RECV=0.
+  TensorBuffer* AdoptBuffer(const char* data, size_t size) override;
+
  private:
   void DeleteStream() {
     if (stream_) {
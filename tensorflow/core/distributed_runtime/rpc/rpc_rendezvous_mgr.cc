@@ -27,6 +27,7 @@ limitations under the License.
 #include "tensorflow/core/distributed_runtime/worker_interface.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/monitoring/counter.h"
 #include "tensorflow/core/lib/strings/numbers.h"
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/platform/logging.h"
@@ -37,10 +38,20 @@ namespace tensorflow {
 
 namespace {
 
+auto* recv_tensor_coding_bytes = monitoring::Counter<1>::New(
+    "/tensorflow/core/rpc/recv_tensor_coding_bytes",
+    "Bytes of tensors received compressed or converted, as they were sent "
+    "and after decoding.",
+    "stage");
+auto* recv_tensor_coding_usecs = monitoring::Counter<1>::New(
+    "/tensorflow/core/rpc/recv_tensor_coding_usecs",
+    "Microseconds spent encoding and decoding received tensors.", "phase");
+
 class RpcRemoteRendezvous : public BaseRemoteRendezvous {
  public:
-  RpcRemoteRendezvous(const WorkerEnv* env, int64 step_id)
-      : BaseRemoteRendezvous(env, step_id) {}
+  RpcRemoteRendezvous(const WorkerEnv* env, int64 step_id,
+                      const RPCOptions& rpc_options)
+      : BaseRemoteRendezvous(env, step_id), rpc_options_(rpc_options) {}
 
  protected:
   void RecvFromRemoteAsync(const Rendezvous::ParsedKey& parsed,
@@ -48,7 +59,23 @@ class RpcRemoteRendezvous : public BaseRemoteRendezvous {
                            DoneCallback done) override;
 
  private:
-  ~RpcRemoteRendezvous() override {}
+  ~RpcRemoteRendezvous() override {
+    if (coding_stats_.encoded_bytes > 0) {
+      VLOG(1) << "Step " << step_id_ << " received "
+              << coding_stats_.decoded_bytes << " bytes of tensors as "
+              << coding_stats_.encoded_bytes << " bytes; encoding took "
+              << coding_stats_.encode_micros << "us, decoding "
+              << coding_stats_.decode_micros << "us";
+    }
+  }
+
+  void RecordCodingStats(const TensorResponse::CodingStats& stats);
+
+  const RPCOptions rpc_options_;
+
+  mutex stats_mu_;
+  // Totals for the tensors received in this step.
+  TensorResponse::CodingStats coding_stats_ GUARDED_BY(stats_mu_);
 
   TF_DISALLOW_COPY_AND_ASSIGN(RpcRemoteRendezvous);
 };
@@ -60,7 +87,8 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
 
   void Init(WorkerInterface* wi, int64 step_id, StringPiece key,
             AllocatorAttributes alloc_attrs, Device* dst_device,
-            const Rendezvous::Args& recv_args, Rendezvous::DoneCallback done) {
+            const Rendezvous::Args& recv_args, const RPCOptions& rpc_options,
+            Rendezvous::DoneCallback done) {
     wi_ = wi;
     alloc_attrs_ = alloc_attrs;
     dst_device_ = dst_device;
@@ -69,6 +97,9 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
     req_.set_step_id(step_id);
     req_.set_rendezvous_key(key.data(), key.size());
     req_.set_request_id(GetUniqueRequestId());
+    req_.set_compression(rpc_options.recv_tensor_compression());
+    req_.set_float_type(rpc_options.recv_tensor_float_type());
+    req_.set_encoding_min_bytes(rpc_options.recv_tensor_encoding_min_bytes());
   }
 
   void Reset(WorkerCacheInterface* wc) {
@@ -117,6 +148,10 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
 
   bool is_dead() const { return resp_.metadata().is_dead(); }
 
+  const TensorResponse::CodingStats& coding_stats() const {
+    return resp_.coding_stats();
+  }
+
   Device* dst_device() const { return dst_device_; }
   const Rendezvous::Args& recv_args() const { return recv_args_; }
   const Rendezvous::DoneCallback& done() const { return done_; }
@@ -239,7 +274,7 @@ void RpcRemoteRendezvous::RecvFromRemoteAsync(
   }
 
   call->Init(rwi, step_id_, parsed.FullKey(), recv_args.alloc_attrs, dst_device,
-             recv_args, std::move(done));
+             recv_args, rpc_options_, std::move(done));
 
   // Record "call" in active_ so that it can be aborted cleanly.
   RegisterCall(call);
@@ -252,6 +287,7 @@ void RpcRemoteRendezvous::RecvFromRemoteAsync(
     // If StartAbort was called prior to DeregisterCall, then the
     // current status should be bad.
     Status s = call->status();
+    if (s.ok()) RecordCodingStats(call->coding_stats());
     call->done()(s, Args(), call->recv_args(), call->tensor(), call->is_dead());
     session()->worker_cache->ReleaseWorker(call->src_worker_, call->wi_);
     call->wi_ = nullptr;
@@ -260,14 +296,35 @@ void RpcRemoteRendezvous::RecvFromRemoteAsync(
   });
 }
 
+void RpcRemoteRendezvous::RecordCodingStats(
+    const TensorResponse::CodingStats& stats) {
+  if (stats.encoded_bytes == 0) return;
+  recv_tensor_coding_bytes->GetCell("sent")->IncrementBy(stats.encoded_bytes);
+  recv_tensor_coding_bytes->GetCell("decoded")->IncrementBy(
+      stats.decoded_bytes);
+  recv_tensor_coding_usecs->GetCell("encode")->IncrementBy(
+      stats.encode_micros);
+  recv_tensor_coding_usecs->GetCell("decode")->IncrementBy(
+      stats.decode_micros);
+  mutex_lock l(stats_mu_);
+  coding_stats_.encoded_bytes += stats.encoded_bytes;
+  coding_stats_.decoded_bytes += stats.decoded_bytes;
+  coding_stats_.encode_micros += stats.encode_micros;
+  coding_stats_.decode_micros += stats.decode_micros;
+}
+
 }  // namespace
 
 RpcRendezvousMgr::RpcRendezvousMgr(const WorkerEnv* env)
     : BaseRendezvousMgr(env) {}
 
+RpcRendezvousMgr::RpcRendezvousMgr(const WorkerEnv* env,
+                                   const RPCOptions& rpc_options)
+    : BaseRendezvousMgr(env), rpc_options_(rpc_options) {}
+
 BaseRemoteRendezvous* RpcRendezvousMgr::Create(int64 step_id,
                                                const WorkerEnv* worker_env) {
-  return new RpcRemoteRendezvous(worker_env, step_id);
+  return new RpcRemoteRendezvous(worker_env, step_id, rpc_options_);
 }
 
 }  // end namespace tensorflow
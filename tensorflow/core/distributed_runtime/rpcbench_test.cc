@@ -14,8 +14,10 @@ limitations under the License.
 ==============================================================================*/
 
 #include <cstdio>
+#include <ctime>
 #include <functional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "tensorflow/cc/ops/standard_ops.h"
@@ -35,6 +37,7 @@ limitations under the License.
 #include "tensorflow/core/protobuf/cluster.pb.h"
 #include "tensorflow/core/protobuf/tensorflow_server.pb.h"
 #include "tensorflow/core/public/session.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 
@@ -165,6 +168,21 @@ string DebugString(const Tensor& x, const Tensor& y, int tensor_size) {
                          x_flat(1), y_flat(0), y_flat(1));
 }
 
+// Returns the number of tensors that cross devices in a step of "def".
+int64 NumCrossDeviceEdges(const GraphDef& def) {
+  std::unordered_map<string, string> device_of;
+  for (const NodeDef& node : def.node()) {
+    device_of[node.name()] = node.device();
+  }
+  int64 n = 0;
+  for (const NodeDef& node : def.node()) {
+    for (const string& input : node.input()) {
+      if (device_of[input.substr(0, input.find(':'))] != node.device()) ++n;
+    }
+  }
+  return n;
+}
+
 // TODO: Support sharding and depth.
 static void BM_Helper(int iters, int width, int num_stages, int tensor_size,
                       bool use_multiple_devices) {
@@ -181,11 +199,8 @@ static void BM_Helper(int iters, int width, int num_stages, int tensor_size,
 
   // Randomly initialize the input.
   Tensor x(DT_FLOAT, TensorShape({tensor_size, 1}));
-
-  testing::SetLabel(
-      strings::StrCat(def.node_size(), " nodes; ",
-                      use_multiple_devices ? "Multi device" : "Single device",
-                      "; tensor bytes/send: ", tensor_size * sizeof(float)));
+  const int64 bytes_per_step =
+      NumCrossDeviceEdges(def) * tensor_size * sizeof(float);
 
   std::vector<Tensor> outputs;
 
@@ -202,7 +217,9 @@ static void BM_Helper(int iters, int width, int num_stages, int tensor_size,
     }
   }
 
-  // Iterations.
+  // Iterations. The workers run in this process, so the CPU time covers
+  // both ends of every RPC.
+  const std::clock_t cpu_start = std::clock();
   testing::StartTiming();
   for (int i = 0; i < iters; i++) {
     outputs.clear();
@@ -210,7 +227,22 @@ static void BM_Helper(int iters, int width, int num_stages, int tensor_size,
     CHECK_EQ(size_t{1}, outputs.size());
   }
   testing::StopTiming();
+  const double cpu_nanos = 1e9 * (std::clock() - cpu_start) / CLOCKS_PER_SEC;
   TF_CHECK_OK(session->Close());
+
+  bool zero_copy_recv;
+  TF_CHECK_OK(
+      ReadBoolFromEnvVar("TF_GRPC_ZERO_COPY_RECV", true, &zero_copy_recv));
+  const int64 total_bytes = static_cast<int64>(iters) * bytes_per_step;
+  testing::BytesProcessed(total_bytes);
+  testing::SetLabel(strings::StrCat(
+      def.node_size(), " nodes; ",
+      use_multiple_devices ? "Multi device" : "Single device",
+      "; tensor bytes/send: ", tensor_size * sizeof(float),
+      "; zero-copy recv: ", zero_copy_recv ? "on" : "off",
+      total_bytes > 0
+          ? strings::Printf("; cpu ns/byte: %.3f", cpu_nanos / total_bytes)
+          : ""));
 }
 static void BM_ShardedProgram(int iters, int width, int num_stages) {
   BM_Helper(iters, width, num_stages, 2 /*tensor_size*/, true /*multi-device*/);
@@ -237,6 +269,16 @@ static void BM_RPC(int iters, int width, int tensor_size) {
 }
 BENCHMARK(BM_RPC)->ArgPair(30, 2)->ArgPair(30, 1000)->ArgPair(30, 100000);
 
+// Large tensors, where the receive side copy dominates. Compare runs with
+// TF_GRPC_ZERO_COPY_RECV=0 and =1.
+static void BM_RPCLargeTensor(int iters, int width, int tensor_size) {
+  BM_Helper(iters, width, 2 /*num_stages*/, tensor_size, true /*multi-device*/);
+}
+BENCHMARK(BM_RPCLargeTensor)
+    ->ArgPair(2, 1 << 18)
+    ->ArgPair(2, 1 << 22)
+    ->ArgPair(2, 1 << 24);
+
 static void BM_SingleDevice(int iters, int width, int num_stages) {
   BM_Helper(iters, width, num_stages, 2 /*tensor_size*/,
             false /*not multi-device*/);
@@ -18,15 +18,24 @@ limitations under the License.
 #include "google/protobuf/any.pb.h"
 
 #include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/framework/bfloat16.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/snappy.h"
 
 namespace tensorflow {
 
 TensorResponse::Source::~Source() {}
 
+TensorBuffer* TensorResponse::Source::AdoptBuffer(const char* data,
+                                                  size_t size) {
+  return nullptr;
+}
+
 void TensorResponse::Clear() {
   on_host_ = false;
+  can_adopt_buffers_ = false;
   device_ = nullptr;
   alloc_attrs_ = AllocatorAttributes();
   allocator_ = nullptr;
@@ -37,6 +46,7 @@ void TensorResponse::Clear() {
 void TensorResponse::ClearTensor() {
   meta_.Clear();
   tensor_ = Tensor();
+  coding_stats_ = CodingStats();
 }
 
 void TensorResponse::InitAlloc(DeviceBase* d, const AllocatorAttributes& aa) {
@@ -47,6 +57,7 @@ void TensorResponse::InitAlloc(DeviceBase* d, const AllocatorAttributes& aa) {
   if (alloc_attrs_.on_host() || da.device_type() == "CPU") {
     on_host_ = true;
   }
+  can_adopt_buffers_ = da.device_type() == "CPU";
   allocator_ = device_->GetAllocator(alloc_attrs_);
 }
 
@@ -87,6 +98,15 @@ Status TensorResponse::ParseFrom(Source* source) {
     if (!meta_.ParseFromCodedStream(&input) || !input.ConsumedEntireMessage()) {
       return errors::InvalidArgument("Cannot parse tensor from response");
     }
+    // Undo the sender's encoding on the host.
+    if (meta_.compression() != RPCOptions::NO_COMPRESSION ||
+        meta_.original_dtype() != DT_INVALID) {
+      if (!DecodeFromProto(cpu_allocator())) {
+        return errors::InvalidArgument("Cannot decode tensor from response");
+      }
+      tensor_.AsProtoTensorContent(meta_.mutable_tensor());
+      tensor_ = Tensor();
+    }
     Status s =
         device_->MakeTensorFromProto(meta_.tensor(), alloc_attrs_, &tensor_);
     // Reduce memory usage for big tensors.
@@ -101,8 +121,11 @@ Status TensorResponse::ParseFrom(Source* source) {
     ClearTensor();
   }
   already_used_ = true;
-  if (ParseFast(source)) return Status::OK();
+  if (ParseFast(source) && ConvertToOriginalDtype(allocator_)) {
+    return Status::OK();
+  }
   meta_.Clear();
+  coding_stats_ = CodingStats();
   if (ParseSlow(source)) return Status::OK();
   return errors::InvalidArgument("Cannot parse tensor from response");
 }
@@ -141,10 +164,141 @@ bool ReadNestedMessage(protobuf::io::CodedInputStream* input,
   return input->DecrementRecursionDepthAndPopLimit(p.first);
 }
 
+// Tensor contents smaller than this are cheaper to copy than to share.
+constexpr int kMinAdoptedTensorBytes = 64 << 10;
+
+// Uncompresses the snappy-compressed contents of a tensor with the given
+// type and shape into a new tensor allocated from "a".
+bool UncompressTensorContent(Allocator* a, DataType dtype,
+                             const TensorShapeProto& shape,
+                             StringPiece compressed, Tensor* result) {
+  if (!DataTypeCanUseMemcpy(dtype) || !TensorShape::IsValid(shape)) {
+    return false;
+  }
+  size_t num_bytes;
+  if (!port::Snappy_GetUncompressedLength(compressed.data(), compressed.size(),
+                                          &num_bytes)) {
+    return false;
+  }
+  Tensor t(a, dtype, TensorShape(shape));
+  StringPiece buf = t.tensor_data();
+  if (num_bytes != buf.size() ||
+      !port::Snappy_Uncompress(compressed.data(), compressed.size(),
+                               const_cast<char*>(buf.data()))) {
+    return false;
+  }
+  *result = std::move(t);
+  return true;
+}
+
 }  // namespace
 
+bool TensorResponse::ReadCompressedTensorContent(
+    protobuf::io::CodedInputStream* input, const TensorProto& tensor_meta,
+    int num_bytes) {
+  if (meta_.compression() != RPCOptions::SNAPPY) return false;
+  const uint64 start_micros = Env::Default()->NowMicros();
+  // Uncompress straight out of the input block if it holds all the data.
+  const void* data;
+  int size;
+  const bool direct =
+      input->GetDirectBufferPointer(&data, &size) && size >= num_bytes;
+  string scratch;
+  if (!direct && !input->ReadString(&scratch, num_bytes)) return false;
+  StringPiece compressed =
+      direct ? StringPiece(static_cast<const char*>(data), num_bytes)
+             : StringPiece(scratch);
+  Tensor t;
+  if (!UncompressTensorContent(allocator_, tensor_meta.dtype(),
+                               tensor_meta.tensor_shape(), compressed, &t)) {
+    return false;
+  }
+  if (direct && !input->Skip(num_bytes)) return false;
+  tensor_ = std::move(t);
+  coding_stats_.encoded_bytes = num_bytes;
+  coding_stats_.decoded_bytes = tensor_.TotalBytes();
+  coding_stats_.encode_micros = meta_.encode_micros();
+  coding_stats_.decode_micros = Env::Default()->NowMicros() - start_micros;
+  return true;
+}
+
+bool TensorResponse::DecodeFromProto(Allocator* a) {
+  const TensorProto& proto = meta_.tensor();
+  if (meta_.compression() == RPCOptions::NO_COMPRESSION) {
+    Tensor parsed(proto.dtype());
+    if (!parsed.FromProto(a, proto)) return false;
+    tensor_ = std::move(parsed);
+    return ConvertToOriginalDtype(a);
+  }
+  if (meta_.compression() != RPCOptions::SNAPPY) return false;
+  const uint64 start_micros = Env::Default()->NowMicros();
+  if (!UncompressTensorContent(a, proto.dtype(), proto.tensor_shape(),
+                               proto.tensor_content(), &tensor_)) {
+    return false;
+  }
+  coding_stats_.encoded_bytes = proto.tensor_content().size();
+  coding_stats_.decoded_bytes = tensor_.TotalBytes();
+  coding_stats_.encode_micros = meta_.encode_micros();
+  coding_stats_.decode_micros = Env::Default()->NowMicros() - start_micros;
+  return ConvertToOriginalDtype(a);
+}
+
+bool TensorResponse::ConvertToOriginalDtype(Allocator* a) {
+  const DataType original_dtype = meta_.original_dtype();
+  if (original_dtype == DT_INVALID || original_dtype == tensor_.dtype()) {
+    return true;
+  }
+  if (original_dtype != DT_FLOAT) return false;
+  const uint64 start_micros = Env::Default()->NowMicros();
+  Tensor t(a, DT_FLOAT, tensor_.shape());
+  if (tensor_.dtype() == DT_HALF) {
+    t.flat<float>() = tensor_.flat<Eigen::half>().cast<float>();
+  } else if (tensor_.dtype() == DT_BFLOAT16) {
+    BFloat16ToFloat(tensor_.flat<bfloat16>().data(), t.flat<float>().data(),
+                    tensor_.NumElements());
+  } else {
+    return false;
+  }
+  if (coding_stats_.encoded_bytes == 0) {
+    coding_stats_.encoded_bytes = tensor_.TotalBytes();
+  }
+  tensor_ = std::move(t);
+  coding_stats_.decoded_bytes = tensor_.TotalBytes();
+  coding_stats_.encode_micros = meta_.encode_micros();
+  coding_stats_.decode_micros += Env::Default()->NowMicros() - start_micros;
+  return true;
+}
+
+bool TensorResponse::AdoptTensorContent(Source* source,
+                                        protobuf::io::CodedInputStream* input,
+                                        const TensorProto& tensor_meta,
+                                        int num_bytes) {
+  if (!can_adopt_buffers_ || num_bytes < kMinAdoptedTensorBytes) return false;
+  const void* data;
+  int size;
+  if (!input->GetDirectBufferPointer(&data, &size) || size < num_bytes) {
+    return false;
+  }
+#if EIGEN_MAX_ALIGN_BYTES > 0
+  if (reinterpret_cast<intptr_t>(data) % EIGEN_MAX_ALIGN_BYTES != 0) {
+    return false;
+  }
+#endif
+  TensorShape shape(tensor_meta.tensor_shape());
+  if (shape.num_elements() * DataTypeSize(tensor_meta.dtype()) != num_bytes) {
+    return false;
+  }
+  TensorBuffer* buf =
+      source->AdoptBuffer(static_cast<const char*>(data), num_bytes);
+  if (buf == nullptr) return false;
+  tensor_ = Tensor(tensor_meta.dtype(), shape, buf);
+  buf->Unref();
+  return input->Skip(num_bytes);
+}
+
 bool TensorResponse::ParseTensorSubmessage(
-    protobuf::io::CodedInputStream* input, TensorProto* tensor_meta) {
+    Source* source, protobuf::io::CodedInputStream* input,
+    TensorProto* tensor_meta) {
   bool seen_tensor_content = false;
   while (true) {
     auto p = input->ReadTagWithCutoff(127);
@@ -194,13 +348,19 @@ bool TensorResponse::ParseTensorSubmessage(
         int num_bytes;
         if (!ReadVarintSizeAsInt(input, &num_bytes)) return false;
         seen_tensor_content = true;
+        if (meta_.compression() != RPCOptions::NO_COMPRESSION) {
+          if (!ReadCompressedTensorContent(input, *tensor_meta, num_bytes)) {
+            return false;
+          }
+          break;
+        }
+        if (AdoptTensorContent(source, input, *tensor_meta, num_bytes)) {
+          break;
+        }
         TensorShape shape(tensor_meta->tensor_shape());
         Tensor t(allocator_, tensor_meta->dtype(), shape);
         StringPiece buf = t.tensor_data();
         if (static_cast<size_t>(num_bytes) != buf.size()) return false;
-        // TODO(jeff,sanjay): Figure out a way to avoid this copy if
-        // the underlying ZeroCopyInputStream data is properly aligned
-        // and compatible with what allocator_ wants.
         if (!input->ReadRaw(const_cast<char*>(buf.data()), num_bytes))
           return false;
         tensor_ = std::move(t);
@@ -234,7 +394,7 @@ bool TensorResponse::ParseFast(Source* source) {
         std::pair<protobuf::io::CodedInputStream::Limit, int> p =
             input.IncrementRecursionDepthAndPushLimit(length);
         if (p.second < 0 ||
-            !ParseTensorSubmessage(&input, meta_.mutable_tensor())) {
+            !ParseTensorSubmessage(source, &input, meta_.mutable_tensor())) {
           return false;
         }
         if (!input.DecrementRecursionDepthAndPopLimit(p.first)) {
@@ -260,6 +420,26 @@ bool TensorResponse::ParseFast(Source* source) {
           return false;
         break;
       }
+      case RecvTensorResponse::kCompressionFieldNumber: {
+        uint32 v;
+        if ((wt != WIRETYPE_VARINT) || !input.ReadVarint32(&v)) return false;
+        // The tensor must come after the compression for the fast path.
+        if (meta_.has_tensor()) return false;
+        meta_.set_compression(static_cast<RPCOptions::TensorCompression>(v));
+        break;
+      }
+      case RecvTensorResponse::kOriginalDtypeFieldNumber: {
+        uint32 v;
+        if ((wt != WIRETYPE_VARINT) || !input.ReadVarint32(&v)) return false;
+        meta_.set_original_dtype(static_cast<DataType>(static_cast<int>(v)));
+        break;
+      }
+      case RecvTensorResponse::kEncodeMicrosFieldNumber: {
+        protobuf_uint64 v;
+        if ((wt != WIRETYPE_VARINT) || !input.ReadVarint64(&v)) return false;
+        meta_.set_encode_micros(static_cast<int64>(v));
+        break;
+      }
       default: {
         // Unknown tag, so don't handle we can't handle on the fast path
         return false;
@@ -275,11 +455,9 @@ bool TensorResponse::ParseSlow(Source* source) {
     return false;
   }
 
-  Tensor parsed(meta_.tensor().dtype());
-  if (!parsed.FromProto(allocator_, meta_.tensor())) {
+  if (!DecodeFromProto(allocator_)) {
     return false;
   }
-  tensor_ = std::move(parsed);
 
   // Reduce memory usage for big tensors.
   {
@@ -27,6 +27,7 @@ namespace tensorflow {
 
 class Allocator;
 class DeviceBase;
+class TensorBuffer;
 class TensorProto;
 
 // TensorResponse can be used as the destination of an RPC that returns
@@ -64,6 +65,15 @@ class TensorResponse {
     // Ownership of the returned stream is retained by the Source and
     // should not be deleted by the caller.
     virtual ::tensorflow::protobuf::io::ZeroCopyInputStream* contents() = 0;
+
+    // Returns a buffer that shares the "size" bytes at "data", which must
+    // lie within a block yielded by the current stream, and keeps them
+    // alive for as long as the buffer is referenced. Returns nullptr if
+    // the source cannot lend out that memory, in which case the caller
+    // copies it. The caller owns a reference on the result.
+    //
+    // The default implementation returns nullptr.
+    virtual TensorBuffer* AdoptBuffer(const char* data, size_t size);
   };
 
   // Parse the RecvTensorResponse encoded in the data yielded by
@@ -87,19 +97,49 @@ class TensorResponse {
   // modified.
   const RecvTensorResponse& metadata() const { return meta_; }
 
+  // How much the sender's compression or float conversion, as requested
+  // through RecvTensorRequest, shrank the parsed tensor and what it cost.
+  // All zero if the tensor was sent as it is.
+  struct CodingStats {
+    int64 encoded_bytes = 0;  // Size of the contents on the wire.
+    int64 decoded_bytes = 0;  // Size of the contents of tensor().
+    int64 encode_micros = 0;  // As reported by the sender.
+    int64 decode_micros = 0;
+  };
+  const CodingStats& coding_stats() const { return coding_stats_; }
+
  private:
-  bool ParseTensorSubmessage(protobuf::io::CodedInputStream* input,
+  bool ParseTensorSubmessage(Source* source,
+                             protobuf::io::CodedInputStream* input,
                              TensorProto* tensor_meta);
+  // Makes tensor_ share the next "num_bytes" bytes of "input" instead of
+  // copying them, if they are contiguous, suitably aligned and the source
+  // can lend them out. Returns false, without consuming any input, if not.
+  bool AdoptTensorContent(Source* source,
+                          protobuf::io::CodedInputStream* input,
+                          const TensorProto& tensor_meta, int num_bytes);
+  // Uncompresses the next "num_bytes" bytes of "input" into tensor_.
+  bool ReadCompressedTensorContent(protobuf::io::CodedInputStream* input,
+                                   const TensorProto& tensor_meta,
+                                   int num_bytes);
+  // Sets tensor_ from meta_.tensor(), undoing the sender's encoding.
+  bool DecodeFromProto(Allocator* a);
+  // Converts tensor_ back to the type the sender converted it from.
+  bool ConvertToOriginalDtype(Allocator* a);
   bool ParseFast(Source* source);
   bool ParseSlow(Source* source);
 
   bool on_host_ = false;
+  // Whether received tensor contents may be used in place, which is only
+  // the case for CPU devices since they are not picky about their memory.
+  bool can_adopt_buffers_ = false;
   DeviceBase* device_ = nullptr;
   AllocatorAttributes alloc_attrs_;
   Allocator* allocator_ = nullptr;
   bool already_used_ = false;
   Tensor tensor_;
   RecvTensorResponse meta_;
+  CodingStats coding_stats_;
 };
 
 }  // namespace tensorflow
@@ -15,6 +15,7 @@ limitations under the License.
 #include "tensorflow/core/framework/dataset.h"
 
 #include "tensorflow/core/framework/device_base.h"
+#include "tensorflow/core/framework/stats_aggregator.h"
 #include "tensorflow/core/graph/graph_def_builder.h"
 #include "tensorflow/core/graph/node_builder.h"
 
@@ -286,6 +287,39 @@ IteratorContext MakeIteratorContext(OpKernelContext* ctx) {
   return IteratorContext(params);
 }
 
+void RecordElementProfile(IteratorContext* ctx, model::Node* node,
+                          int64 latency_nanos, int64 input_nanos,
+                          const std::vector<Tensor>& element) {
+  int64 bytes = 0;
+  for (const Tensor& t : element) {
+    bytes += t.TotalBytes();
+  }
+  node->RecordOutput(latency_nanos, bytes);
+  std::shared_ptr<StatsAggregator> stats_aggregator = ctx->stats_aggregator();
+  if (stats_aggregator) {
+    stats_aggregator->AddToHistogram(
+        strings::StrCat(node->name(), "::latency"),
+        {static_cast<double>(latency_nanos) / 1000});
+    stats_aggregator->AddToHistogram(
+        strings::StrCat(node->name(), "::input_time"),
+        {static_cast<double>(input_nanos) / 1000});
+    stats_aggregator->AddToHistogram(
+        strings::StrCat(node->name(), "::bytes_produced"),
+        {static_cast<double>(bytes)});
+  }
+}
+
+void RecordBufferProfile(IteratorContext* ctx, model::Node* node,
+                         int64 buffered) {
+  node->RecordBufferSize(buffered);
+  std::shared_ptr<StatsAggregator> stats_aggregator = ctx->stats_aggregator();
+  if (stats_aggregator) {
+    stats_aggregator->AddToHistogram(
+        strings::StrCat(node->name(), "::buffered_elements"),
+        {static_cast<double>(buffered)});
+  }
+}
+
 }  // namespace dataset
 
 }  // namespace tensorflow
@@ -15,13 +15,16 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_FRAMEWORK_DATASET_H_
 #define TENSORFLOW_CORE_FRAMEWORK_DATASET_H_
 
+#include <atomic>
 #include <memory>
+#include <vector>
 
 #include "tensorflow/core/framework/attr_value.pb.h"
 #include "tensorflow/core/framework/attr_value_util.h"
 #include "tensorflow/core/framework/dataset_stateful_op_whitelist.h"
 #include "tensorflow/core/framework/function.h"
 #include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/model.h"
 #include "tensorflow/core/framework/node_def.pb.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
@@ -275,6 +278,11 @@ class IteratorContext {
 
     // The Allocator to be used to allocate the output of an iterator.
     std::function<Allocator*(AllocatorAttributes)> allocator_getter = nullptr;
+
+    // The performance model of the input pipeline, shared by all of its
+    // iterators. Iterators created with a model time their work and can
+    // have their parameters tuned by it.
+    std::shared_ptr<model::Model> model = nullptr;
   };
 
   explicit IteratorContext(Params params) : params_(std::move(params)) {}
@@ -313,6 +321,12 @@ class IteratorContext {
     return params_.stats_aggregator_getter;
   }
 
+  std::shared_ptr<model::Model> model() { return params_.model; }
+
+  void set_model(std::shared_ptr<model::Model> model) {
+    params_.model = std::move(model);
+  }
+
  private:
   Params params_;
 };
@@ -355,6 +369,11 @@ class IteratorBase {
   // properly propagate errors.
   virtual Status Initialize(IteratorContext* ctx) { return Status::OK(); }
 
+  // Gives this iterator the performance model of its input pipeline. Called
+  // before `Initialize` when the iterator is created with a model. The
+  // iterator only registers with the model once the model needs it.
+  virtual void AttachModel(const std::shared_ptr<model::Model>& model) {}
+
   // Saves the state of this iterator.
   virtual Status Save(OpKernelContext* ctx, IteratorStateWriter* writer) {
     return SaveInternal(writer);
@@ -411,6 +430,9 @@ class DatasetBase : public core::RefCounted {
   Status MakeIterator(IteratorContext* ctx, const string& prefix,
                       std::unique_ptr<IteratorBase>* iterator) const {
     *iterator = MakeIteratorInternal(prefix);
+    if (ctx->model()) {
+      (*iterator)->AttachModel(ctx->model());
+    }
     return (*iterator)->Initialize(ctx);
   }
 
@@ -497,6 +519,23 @@ class GraphDatasetBase : public DatasetBase {
   const string op_name_;
 };
 
+namespace dataset {
+
+// Records the profile of an element that the iterator of `node` produced in
+// `latency_nanos`, `input_nanos` of which it waited for its inputs, in
+// `node` and in the histograms of the `StatsAggregator` of `ctx`, if any.
+void RecordElementProfile(IteratorContext* ctx, model::Node* node,
+                          int64 latency_nanos, int64 input_nanos,
+                          const std::vector<Tensor>& element);
+
+// Records the number of elements that the iterator of `node` had buffered
+// when its consumer took an element, in `node` and in the histograms of the
+// `StatsAggregator` of `ctx`, if any.
+void RecordBufferProfile(IteratorContext* ctx, model::Node* node,
+                         int64 buffered);
+
+}  // namespace dataset
+
 // Represents an iterator that is associated with a particular parent dataset.
 template <class DatasetType>
 class DatasetIterator : public IteratorBase {
@@ -513,7 +552,12 @@ class DatasetIterator : public IteratorBase {
     params_.dataset->Ref();
   }
 
-  ~DatasetIterator() override { params_.dataset->Unref(); }
+  ~DatasetIterator() override {
+    if (node_) {
+      model_->RemoveNode(node_);
+    }
+    params_.dataset->Unref();
+  }
 
   // The dataset from which this iterator was created.
   const DatasetType* dataset() const { return params_.dataset; }
@@ -532,7 +576,43 @@ class DatasetIterator : public IteratorBase {
   Status GetNext(IteratorContext* ctx, std::vector<Tensor>* out_tensors,
                  bool* end_of_sequence) final {
     tracing::ScopedActivity activity(params_.prefix);
+    // The time spent in this call is taken off the iterator that consumes
+    // the output of this one.
+    const bool collecting = model_collecting();
+    const bool profiling = collecting && model_->profiling();
+    model::Node* node = nullptr;
+    int64 start_nanos = 0;
+    int64 start_input_nanos = 0;
+    if (collecting) {
+      node = this->node();
+      start_nanos = Env::Default()->NowMicros() * 1000;
+      if (output_node_) {
+        output_node_->StopWork(start_nanos);
+      }
+      node->StartWork(start_nanos);
+      if (profiling) {
+        start_input_nanos = node->input_time();
+      }
+    }
     Status s = GetNextInternal(ctx, out_tensors, end_of_sequence);
+    if (collecting) {
+      const int64 now_nanos = Env::Default()->NowMicros() * 1000;
+      node->StopWork(now_nanos);
+      if (s.ok() && !*end_of_sequence) {
+        node->RecordElement();
+        if (profiling) {
+          dataset::RecordElementProfile(
+              ctx, node, now_nanos - start_nanos,
+              node->input_time() - start_input_nanos, *out_tensors);
+        }
+      }
+      if (output_node_) {
+        if (profiling) {
+          output_node_->AddInputTime(now_nanos - start_nanos);
+        }
+        output_node_->StartWork(now_nanos);
+      }
+    }
     if (TF_PREDICT_FALSE(errors::IsOutOfRange(s) && !*end_of_sequence)) {
       s = errors::Internal(
           "Iterator \"", params_.prefix,
@@ -549,6 +629,10 @@ class DatasetIterator : public IteratorBase {
     return IteratorBase::Save(ctx, writer);
   }
 
+  void AttachModel(const std::shared_ptr<model::Model>& model) final {
+    model_ = model;
+  }
+
  protected:
   // Internal implementation of GetNext that is wrapped in tracing logic.
   virtual Status GetNextInternal(IteratorContext* ctx,
@@ -559,8 +643,84 @@ class DatasetIterator : public IteratorBase {
     return strings::StrCat(prefix(), ":", name);
   }
 
+  // Adds a parameter of this iterator to the performance model of its input
+  // pipeline and returns it, or returns null if the iterator was created
+  // without a model. See `model::Tunable` for the arguments; the iterator
+  // must detach the parameter before the state used by `notify` goes away.
+  std::shared_ptr<model::Tunable> AddTunable(model::Tunable::Kind kind,
+                                             int64 value, int64 min,
+                                             int64 max,
+                                             std::function<void()> notify) {
+    if (!model_) {
+      return nullptr;
+    }
+    if (min < max) {
+      node();
+      return model_->AddTunable(node_, kind, value, min, max,
+                                std::move(notify));
+    }
+    // A fixed parameter only describes the iterator, so it waits for the
+    // iterator to be registered for another reason.
+    auto tunable = std::make_shared<model::Tunable>(kind, value, min, max,
+                                                    std::move(notify));
+    mutex_lock l(node_mu_);
+    if (registered_.load(std::memory_order_relaxed)) {
+      model_->AddTunable(node_, tunable);
+    } else {
+      pending_tunables_.push_back(tunable);
+    }
+    return tunable;
+  }
+
+  // Whether the model of this iterator wants it to time its work.
+  bool model_collecting() const {
+    return model_ && (model_->collecting() || model_->profiling());
+  }
+
+  // Records that the consumer of this iterator took an element while
+  // `buffered` elements were buffered, if the model is profiling.
+  void RecordBufferSize(IteratorContext* ctx, int64 buffered) {
+    if (model_ && model_->profiling()) {
+      dataset::RecordBufferProfile(ctx, node(), buffered);
+    }
+  }
+
+  // Adds time spent on the elements of this iterator outside of
+  // `GetNextInternal`, e.g. in asynchronous function calls, to its node in
+  // the model. Only called when `model_collecting()`.
+  void AddProcessingTime(int64 delta_nanos) {
+    node()->AddProcessingTime(delta_nanos);
+  }
+
  private:
+  // Returns the node of this iterator, registering the iterator with the
+  // model on first use. Only called when the iterator has a model.
+  model::Node* node() {
+    if (!registered_.load(std::memory_order_acquire)) {
+      mutex_lock l(node_mu_);
+      if (!registered_.load(std::memory_order_relaxed)) {
+        node_ = model_->AddNode(params_.prefix);
+        output_node_ = model_->LookupOutputNode(params_.prefix);
+        for (std::shared_ptr<model::Tunable>& tunable : pending_tunables_) {
+          model_->AddTunable(node_, std::move(tunable));
+        }
+        pending_tunables_.clear();
+        registered_.store(true, std::memory_order_release);
+      }
+    }
+    return node_.get();
+  }
+
   Params params_;
+  std::shared_ptr<model::Model> model_;
+  // Set once by `node()`, before `registered_`.
+  std::shared_ptr<model::Node> node_;
+  std::shared_ptr<model::Node> output_node_;
+  std::atomic<bool> registered_{false};
+  mutex node_mu_;
+  // The fixed parameters added before the iterator was registered.
+  std::vector<std::shared_ptr<model::Tunable>> pending_tunables_
+      GUARDED_BY(node_mu_);
 };
 
 // Encapsulates the work required to plug a DatasetBase into the core TensorFlow
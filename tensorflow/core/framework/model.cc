@@ -0,0 +1,374 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/framework/model.h"
+
+#include <algorithm>
+
+#include "tensorflow/core/platform/env.h"
+
+namespace tensorflow {
+namespace model {
+namespace {
+
+// Parallelism is only raised while it improves the estimated output time of
+// the pipeline by at least this fraction.
+constexpr double kMinImprovement = 0.01;
+
+// Strips the `[index]` suffixes that iterators created per input element
+// (e.g. by interleave) add to their prefixes, so that they share a node.
+string NodeName(const string& prefix) {
+  string name;
+  name.reserve(prefix.size());
+  int depth = 0;
+  for (char c : prefix) {
+    if (c == '[') {
+      ++depth;
+    } else if (c == ']') {
+      if (depth > 0) --depth;
+    } else if (depth == 0) {
+      name.push_back(c);
+    }
+  }
+  return name;
+}
+
+// The name of the node that consumes the output of the node `name`.
+string OutputName(const string& name) {
+  size_t pos = name.rfind("::");
+  return pos == string::npos ? "" : name.substr(0, pos);
+}
+
+int64 NowNanos() { return Env::Default()->NowMicros() * 1000; }
+
+}  // namespace
+
+Tunable::Tunable(Kind kind, int64 value, int64 min, int64 max,
+                 std::function<void()> notify)
+    : kind_(kind),
+      min_(min),
+      max_(max),
+      value_(value),
+      notify_(std::move(notify)) {}
+
+void Tunable::RecordConsumption(int64 buffered) {
+  mutex_lock l(stats_mu_);
+  if (stats_.consumed == 0 || buffered < stats_.min_buffered) {
+    stats_.min_buffered = buffered;
+  }
+  ++stats_.consumed;
+  if (buffered == 0) {
+    ++stats_.waits;
+  }
+}
+
+void Tunable::Detach() {
+  mutex_lock l(mu_);
+  detached_ = true;
+}
+
+void Tunable::Set(int64 value) {
+  mutex_lock l(mu_);
+  if (detached_ || value == value_.load(std::memory_order_relaxed)) {
+    return;
+  }
+  value_.store(value, std::memory_order_relaxed);
+  if (notify_) {
+    notify_();
+  }
+}
+
+bool Tunable::detached() {
+  mutex_lock l(mu_);
+  return detached_;
+}
+
+Tunable::ConsumptionStats Tunable::TakeConsumptionStats() {
+  mutex_lock l(stats_mu_);
+  ConsumptionStats stats = stats_;
+  stats_ = ConsumptionStats();
+  return stats;
+}
+
+void Node::StartWork(int64 time_nanos) {
+  if (async()) {
+    return;
+  }
+  mutex_lock l(mu_);
+  work_start_[std::this_thread::get_id()] = time_nanos;
+}
+
+void Node::StopWork(int64 time_nanos) {
+  mutex_lock l(mu_);
+  auto it = work_start_.find(std::this_thread::get_id());
+  if (it == work_start_.end()) {
+    return;
+  }
+  AddProcessingTime(time_nanos - it->second);
+  work_start_.erase(it);
+}
+
+std::shared_ptr<Node> Model::AddNode(const string& prefix) {
+  const string name = NodeName(prefix);
+  mutex_lock l(mu_);
+  std::shared_ptr<Node>& node = nodes_[name];
+  if (!node) {
+    node = std::make_shared<Node>(name, OutputName(name));
+  }
+  ++node->num_iterators_;
+  return node;
+}
+
+std::shared_ptr<Node> Model::LookupOutputNode(const string& prefix) {
+  const string output_name = OutputName(NodeName(prefix));
+  mutex_lock l(mu_);
+  auto it = nodes_.find(output_name);
+  if (it == nodes_.end()) {
+    return nullptr;
+  }
+  return it->second;
+}
+
+void Model::RemoveNode(const std::shared_ptr<Node>& node) {
+  mutex_lock l(mu_);
+  if (--node->num_iterators_ > 0) {
+    return;
+  }
+  auto it = nodes_.find(node->name());
+  if (it != nodes_.end() && it->second == node) {
+    nodes_.erase(it);
+  }
+}
+
+std::shared_ptr<Tunable> Model::AddTunable(const std::shared_ptr<Node>& node,
+                                           Tunable::Kind kind, int64 value,
+                                           int64 min, int64 max,
+                                           std::function<void()> notify) {
+  auto tunable = std::make_shared<Tunable>(
+      kind, value == kAutoTune ? min : value, min, max, std::move(notify));
+  AddTunable(node, tunable);
+  return tunable;
+}
+
+void Model::AddTunable(const std::shared_ptr<Node>& node,
+                       std::shared_ptr<Tunable> tunable) {
+  const bool tunable_value = tunable->tunable();
+  mutex_lock l(mu_);
+  node->tunables_.push_back(std::move(tunable));
+  node->async_.store(true, std::memory_order_relaxed);
+  if (tunable_value) {
+    collecting_.store(true, std::memory_order_relaxed);
+  }
+}
+
+std::vector<Profile> Model::GetProfile() {
+  mutex_lock l(mu_);
+  std::vector<Profile> profile;
+  profile.reserve(nodes_.size());
+  for (const auto& entry : nodes_) {
+    const Node& node = *entry.second;
+    profile.emplace_back();
+    Profile& p = profile.back();
+    p.name = node.name_;
+    p.num_elements = node.num_elements();
+    p.processing_time = node.processing_time();
+    p.latency = node.latency_.load(std::memory_order_relaxed);
+    p.input_time = node.input_time();
+    p.bytes_produced = node.bytes_produced_.load(std::memory_order_relaxed);
+    p.buffered_elements =
+        node.buffered_elements_.load(std::memory_order_relaxed);
+    p.buffer_samples = node.buffer_samples_.load(std::memory_order_relaxed);
+  }
+  return profile;
+}
+
+Node* Model::BuildTree(InputMap* inputs) {
+  Node* root = nullptr;
+  for (const auto& entry : nodes_) {
+    Node* node = entry.second.get();
+    if (nodes_.count(node->output_name_) > 0) {
+      (*inputs)[node->output_name_].push_back(node);
+    } else if (!root || node->name_.size() < root->name_.size()) {
+      root = node;
+    }
+  }
+  return root;
+}
+
+double Model::OutputTime(Node* node, const InputMap& inputs,
+                         const gtl::FlatMap<Tunable*, int64>& values) {
+  const int64 num_elements = node->num_elements();
+  double self_time = 0;
+  if (num_elements > 0) {
+    self_time = static_cast<double>(node->processing_time()) / num_elements;
+  }
+  for (const auto& tunable : node->tunables_) {
+    if (tunable->kind() == Tunable::Kind::kParallelism) {
+      auto it = values.find(tunable.get());
+      int64 parallelism = it != values.end() ? it->second : tunable->value();
+      self_time /= std::max(parallelism, int64{1});
+      break;
+    }
+  }
+  double input_time = 0;
+  auto it = inputs.find(node->name_);
+  if (it != inputs.end()) {
+    for (Node* input : it->second) {
+      // The number of input elements consumed per output element, e.g. the
+      // batch size for batch.
+      double ratio = 1.0;
+      if (num_elements > 0) {
+        ratio = static_cast<double>(input->num_elements()) / num_elements;
+      }
+      input_time += ratio * OutputTime(input, inputs, values);
+    }
+  }
+  return self_time + input_time;
+}
+
+double Model::OutputTime() {
+  mutex_lock l(mu_);
+  InputMap inputs;
+  Node* root = BuildTree(&inputs);
+  if (!root) {
+    return 0;
+  }
+  return OutputTime(root, inputs, {});
+}
+
+void Model::Optimize(int64 cpu_budget) {
+  std::vector<std::pair<std::shared_ptr<Tunable>, int64>> updates;
+  {
+    mutex_lock l(mu_);
+    const int64 now = NowNanos();
+    const int64 elapsed =
+        last_optimize_nanos_ > 0 ? now - last_optimize_nanos_ : 0;
+    last_optimize_nanos_ = now;
+
+    InputMap inputs;
+    Node* root = BuildTree(&inputs);
+    if (!root || root->num_elements() == 0) {
+      return;
+    }
+
+    // Drops the parameters of iterators that went away and collects the
+    // parallelism of every node: the first parameter of the node decides.
+    gtl::FlatMap<Tunable*, int64> parallelism;
+    std::vector<Tunable*> candidates;
+    int64 total_parallelism = 0;
+    for (const auto& entry : nodes_) {
+      auto& tunables = entry.second->tunables_;
+      tunables.erase(std::remove_if(tunables.begin(), tunables.end(),
+                                    [](const std::shared_ptr<Tunable>& t) {
+                                      return t->detached();
+                                    }),
+                     tunables.end());
+      for (const auto& tunable : tunables) {
+        if (tunable->kind() != Tunable::Kind::kParallelism) continue;
+        if (tunable->tunable()) {
+          parallelism[tunable.get()] = tunable->min();
+          candidates.push_back(tunable.get());
+          total_parallelism += tunable->min();
+        } else {
+          total_parallelism += tunable->value();
+        }
+        break;
+      }
+    }
+
+    // Hands out the CPU budget one thread at a time to the node where it
+    // shortens the output time of the pipeline the most.
+    double output_time = OutputTime(root, inputs, parallelism);
+    while (total_parallelism < cpu_budget) {
+      Tunable* best = nullptr;
+      double best_output_time = output_time;
+      for (Tunable* candidate : candidates) {
+        int64& value = parallelism[candidate];
+        if (value >= candidate->max()) continue;
+        ++value;
+        double candidate_output_time = OutputTime(root, inputs, parallelism);
+        --value;
+        if (candidate_output_time < best_output_time) {
+          best = candidate;
+          best_output_time = candidate_output_time;
+        }
+      }
+      if (!best ||
+          output_time - best_output_time < kMinImprovement * output_time) {
+        break;
+      }
+      ++parallelism[best];
+      ++total_parallelism;
+      output_time = best_output_time;
+    }
+    for (const auto& entry : nodes_) {
+      Tunable* first = nullptr;
+      for (const auto& tunable : entry.second->tunables_) {
+        if (tunable->kind() != Tunable::Kind::kParallelism) continue;
+        if (!first) first = tunable.get();
+        auto it = parallelism.find(first);
+        if (it == parallelism.end() || !tunable->tunable()) continue;
+        // Iterators of the same node share the value of the first one.
+        int64 value =
+            std::min(tunable->max(), std::max(tunable->min(), it->second));
+        if (value != tunable->value()) {
+          updates.emplace_back(tunable, value);
+        }
+      }
+    }
+
+    // Grows a buffer while its consumer waits for a producer that is faster
+    // on average, i.e. when the consumer is bursty, and otherwise shrinks it
+    // towards the number of elements the consumer actually needed.
+    for (const auto& entry : nodes_) {
+      Node* node = entry.second.get();
+      for (const auto& tunable : node->tunables_) {
+        if (tunable->kind() != Tunable::Kind::kBufferSize) continue;
+        Tunable::ConsumptionStats stats = tunable->TakeConsumptionStats();
+        if (!tunable->tunable() || stats.consumed == 0 || elapsed == 0) {
+          continue;
+        }
+        const int64 value = tunable->value();
+        int64 new_value = value;
+        if (stats.waits > 0) {
+          double producer_time = 0;
+          auto it = inputs.find(node->name_);
+          if (it != inputs.end()) {
+            for (Node* input : it->second) {
+              producer_time += OutputTime(input, inputs, parallelism);
+            }
+          }
+          double consumer_interval =
+              static_cast<double>(elapsed) / stats.consumed;
+          if (producer_time < consumer_interval) {
+            new_value =
+                std::min(tunable->max(), std::max(value * 2, value + 1));
+          }
+        } else if (stats.min_buffered > 1) {
+          new_value = std::max(tunable->min(), value - stats.min_buffered / 2);
+        }
+        if (new_value != value) {
+          updates.emplace_back(tunable, new_value);
+        }
+      }
+    }
+  }
+  for (auto& update : updates) {
+    update.first->Set(update.second);
+  }
+}
+
+}  // namespace model
+}  // namespace tensorflow
@@ -0,0 +1,317 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_FRAMEWORK_MODEL_H_
+#define TENSORFLOW_CORE_FRAMEWORK_MODEL_H_
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "tensorflow/core/lib/gtl/flatmap.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace model {
+
+// The value of a tunable iterator parameter (e.g. `buffer_size` of prefetch or
+// `num_parallel_calls` of parallel map) that asks for the value to be picked
+// by the performance model of the input pipeline.
+constexpr int64 kAutoTune = -1;
+
+// A parameter of an iterator that the model can change while the iterator
+// runs. The iterator owns the parameter together with the model: it reads the
+// current value with `value()` and, when it goes away, calls `Detach()` so
+// that the model stops changing the value.
+//
+// A parameter whose `min()` and `max()` are equal is not tuned; it still tells
+// the model how the iterator is configured.
+class Tunable {
+ public:
+  enum class Kind {
+    // The number of elements an iterator processes in parallel. The sum of
+    // these over the pipeline is bounded by the CPU budget of the model.
+    kParallelism,
+    // The number of elements an iterator buffers ahead of its consumer.
+    kBufferSize,
+  };
+
+  // `notify` is called after the model changed the value, without any lock
+  // of the model held, so that the iterator can wake up threads that wait
+  // on the value.
+  Tunable(Kind kind, int64 value, int64 min, int64 max,
+          std::function<void()> notify);
+
+  Kind kind() const { return kind_; }
+  int64 value() const { return value_.load(std::memory_order_relaxed); }
+  int64 min() const { return min_; }
+  int64 max() const { return max_; }
+  bool tunable() const { return min_ < max_; }
+
+  // Records that the consumer of a buffer took an element while `buffered`
+  // elements were available; 0 means that the consumer had to wait. Used by
+  // the model to decide whether a `kBufferSize` parameter should grow or
+  // shrink.
+  void RecordConsumption(int64 buffered);
+
+  // Stops the model from changing the value and calling `notify`. Must be
+  // called before the state captured by `notify` is destroyed and must not be
+  // called with any lock taken by `notify` held.
+  void Detach();
+
+ private:
+  friend class Model;
+
+  // Sets the value and calls `notify`, unless the parameter is detached.
+  void Set(int64 value);
+
+  bool detached() LOCKS_EXCLUDED(mu_);
+
+  // Consumption statistics since the last call, for `kBufferSize`.
+  struct ConsumptionStats {
+    int64 consumed = 0;
+    int64 waits = 0;
+    int64 min_buffered = 0;
+  };
+  ConsumptionStats TakeConsumptionStats() LOCKS_EXCLUDED(stats_mu_);
+
+  const Kind kind_;
+  const int64 min_;
+  const int64 max_;
+  std::atomic<int64> value_;
+  const std::function<void()> notify_;
+  // Held while calling `notify_`, so that `Detach` waits for the call.
+  mutex mu_;
+  bool detached_ GUARDED_BY(mu_) = false;
+  // Separate from `mu_` because the iterator records consumption while
+  // holding the locks that `notify_` takes.
+  mutex stats_mu_;
+  ConsumptionStats stats_ GUARDED_BY(stats_mu_);
+};
+
+// The counters of a node recorded while the model is profiling. All times are
+// in nanoseconds and all counters accumulate over the lifetime of the node.
+struct Profile {
+  string name;
+  // The number of elements produced and the time spent producing them,
+  // excluding the time spent in the inputs of the node.
+  int64 num_elements = 0;
+  int64 processing_time = 0;
+  // The wall time of the calls to `GetNext` that produced the elements, i.e.
+  // the time the consumer of the node waited for them.
+  int64 latency = 0;
+  // The time the node spent waiting in the `GetNext` calls of its inputs.
+  int64 input_time = 0;
+  // The total size of the tensors of the produced elements.
+  int64 bytes_produced = 0;
+  // The number of elements that were buffered, summed over the times the
+  // consumer took an element from the buffer of the node.
+  int64 buffered_elements = 0;
+  int64 buffer_samples = 0;
+};
+
+// A stage of the input pipeline. All the live iterators with the same name
+// (e.g. the iterators that interleave creates for its input elements) share
+// one node; the name is the iterator prefix without the `[index]` suffixes.
+//
+// The node accumulates the number of elements produced by its iterators and
+// the time spent producing them, excluding the time spent in its inputs.
+class Node {
+ public:
+  Node(const string& name, const string& output_name)
+      : name_(name), output_name_(output_name) {}
+
+  const string& name() const { return name_; }
+
+  // Starts and stops the clock of the node for the calling thread. The clock
+  // is only running for nodes that do their work synchronously in GetNext;
+  // the work of asynchronous nodes is recorded with `AddProcessingTime`.
+  void StartWork(int64 time_nanos);
+  void StopWork(int64 time_nanos);
+
+  // Adds `delta_nanos` to the processing time of the node, e.g. the latency
+  // of a function call made by a parallel map.
+  void AddProcessingTime(int64 delta_nanos) {
+    processing_time_.fetch_add(delta_nanos, std::memory_order_relaxed);
+  }
+
+  // Records that the node produced an element.
+  void RecordElement() {
+    num_elements_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Records the latency and the size of an element produced by the node.
+  // Only called when the model is profiling.
+  void RecordOutput(int64 latency_nanos, int64 bytes) {
+    latency_.fetch_add(latency_nanos, std::memory_order_relaxed);
+    bytes_produced_.fetch_add(bytes, std::memory_order_relaxed);
+  }
+
+  // Adds `delta_nanos` to the time the node spent waiting for its inputs.
+  // Only called when the model is profiling.
+  void AddInputTime(int64 delta_nanos) {
+    input_time_.fetch_add(delta_nanos, std::memory_order_relaxed);
+  }
+
+  // Records that the consumer of the node took an element while `buffered`
+  // elements were available. Only called when the model is profiling.
+  void RecordBufferSize(int64 buffered) {
+    buffered_elements_.fetch_add(buffered, std::memory_order_relaxed);
+    buffer_samples_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  int64 num_elements() const {
+    return num_elements_.load(std::memory_order_relaxed);
+  }
+  int64 input_time() const {
+    return input_time_.load(std::memory_order_relaxed);
+  }
+  int64 processing_time() const {
+    return processing_time_.load(std::memory_order_relaxed);
+  }
+
+  // Whether the node does its work on background threads, e.g. prefetch or
+  // parallel map. Set when the node gets a parameter.
+  bool async() const { return async_.load(std::memory_order_relaxed); }
+
+ private:
+  friend class Model;
+
+  const string name_;
+  // The name of the node that consumes the output of this node.
+  const string output_name_;
+  std::atomic<int64> num_elements_{0};
+  std::atomic<int64> processing_time_{0};
+  std::atomic<int64> latency_{0};
+  std::atomic<int64> input_time_{0};
+  std::atomic<int64> bytes_produced_{0};
+  std::atomic<int64> buffered_elements_{0};
+  std::atomic<int64> buffer_samples_{0};
+  std::atomic<bool> async_{false};
+  mutex mu_;
+  // The time at which each thread started working on the node.
+  std::map<std::thread::id, int64> work_start_ GUARDED_BY(mu_);
+  // Guarded by the mutex of the model.
+  int64 num_iterators_ = 0;
+  std::vector<std::shared_ptr<Tunable>> tunables_;
+};
+
+// Models the performance of an input pipeline and tunes its parameters.
+//
+// Each iterator of the pipeline registers a node once the model needs it and
+// removes it when it is destroyed: iterators whose parallelism or buffer size
+// is set to `kAutoTune` register when they add tunable parameters to their
+// nodes, the others the first time they produce an element while the model
+// is collecting or profiling. Pipelines that neither autotune nor profile
+// therefore never touch the model. `Optimize` estimates the time the pipeline
+// takes to produce an element and sets the parameters to minimize it within
+// the given CPU budget.
+//
+// When profiling is enabled, the nodes also record the latency, size and
+// buffering of the elements of their iterators, which `GetProfile` returns
+// per stage of the pipeline.
+//
+// This class is thread-safe.
+class Model {
+ public:
+  Model() = default;
+
+  // Returns the node for the iterator with the given prefix, creating it if
+  // needed. Every call must be matched by a call to `RemoveNode`.
+  std::shared_ptr<Node> AddNode(const string& prefix) LOCKS_EXCLUDED(mu_);
+
+  // Returns the node of the iterator that consumes the output of the iterator
+  // with the given prefix, or null if there is no such node.
+  std::shared_ptr<Node> LookupOutputNode(const string& prefix)
+      LOCKS_EXCLUDED(mu_);
+
+  // Releases a node returned by `AddNode`.
+  void RemoveNode(const std::shared_ptr<Node>& node) LOCKS_EXCLUDED(mu_);
+
+  // Adds a parameter to `node` and returns it. See `Tunable` for the
+  // arguments. A `value` of `kAutoTune` starts the parameter at `min`.
+  std::shared_ptr<Tunable> AddTunable(const std::shared_ptr<Node>& node,
+                                      Tunable::Kind kind, int64 value,
+                                      int64 min, int64 max,
+                                      std::function<void()> notify)
+      LOCKS_EXCLUDED(mu_);
+
+  // Adds a parameter created by the iterator of `node` to `node`.
+  void AddTunable(const std::shared_ptr<Node>& node,
+                  std::shared_ptr<Tunable> tunable) LOCKS_EXCLUDED(mu_);
+
+  // Whether the model has any parameter to tune. Iterators only time their
+  // work when it does or when the model is profiling.
+  bool collecting() const {
+    return collecting_.load(std::memory_order_relaxed);
+  }
+
+  // Makes the iterators of the pipeline record the profile of their
+  // elements from now on. Profiling cannot be disabled again.
+  void EnableProfiling() {
+    profiling_.store(true, std::memory_order_relaxed);
+  }
+
+  bool profiling() const { return profiling_.load(std::memory_order_relaxed); }
+
+  // Returns the profile of every node of the pipeline, ordered by name.
+  std::vector<Profile> GetProfile() LOCKS_EXCLUDED(mu_);
+
+  // Sets the parameters of the pipeline: parallelism is raised greedily where
+  // it reduces the estimated output time the most while the sum of the
+  // parallelism of all the nodes stays within `cpu_budget`; buffers grow
+  // while their consumers wait for a faster producer and shrink towards the
+  // number of elements that is actually used.
+  void Optimize(int64 cpu_budget) LOCKS_EXCLUDED(mu_);
+
+  // Returns the estimated time in nanoseconds the pipeline takes to produce
+  // an element with the current parameters.
+  double OutputTime() LOCKS_EXCLUDED(mu_);
+
+ private:
+  // Maps the name of a node to the nodes whose output it consumes.
+  using InputMap = std::map<string, std::vector<Node*>>;
+
+  // Returns the root of the pipeline, i.e. the node whose output is not
+  // consumed by another node, and fills `inputs`. Returns null if there are
+  // no nodes.
+  Node* BuildTree(InputMap* inputs) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // The estimated time `node` takes to produce an element if the parameters
+  // had the values in `values` (or their current values if not present).
+  // Iterators of the same node share the value of the first parameter of
+  // each kind.
+  double OutputTime(Node* node, const InputMap& inputs,
+                    const gtl::FlatMap<Tunable*, int64>& values)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  mutex mu_;
+  std::map<string, std::shared_ptr<Node>> nodes_ GUARDED_BY(mu_);
+  std::atomic<bool> collecting_{false};
+  std::atomic<bool> profiling_{false};
+  int64 last_optimize_nanos_ GUARDED_BY(mu_) = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(Model);
+};
+
+}  // namespace model
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_FRAMEWORK_MODEL_H_
@@ -0,0 +1,193 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/framework/model.h"
+
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace model {
+namespace {
+
+// Records `num_elements` elements that took `nanos_per_element` each.
+void Produce(Node* node, int64 num_elements, int64 nanos_per_element) {
+  for (int64 i = 0; i < num_elements; ++i) {
+    node->RecordElement();
+  }
+  node->AddProcessingTime(num_elements * nanos_per_element);
+}
+
+TEST(ModelTest, IteratorsOfElementsShareNode) {
+  Model model;
+  std::shared_ptr<Node> interleave = model.AddNode("Iterator::Interleave");
+  std::shared_ptr<Node> map_0 = model.AddNode("Iterator::Interleave[0]::Map");
+  std::shared_ptr<Node> map_1 = model.AddNode("Iterator::Interleave[1]::Map");
+  EXPECT_EQ(map_0, map_1);
+  EXPECT_EQ("Iterator::Interleave::Map", map_0->name());
+  EXPECT_EQ(interleave, model.LookupOutputNode("Iterator::Interleave[2]::Map"));
+  EXPECT_EQ(nullptr, model.LookupOutputNode("Iterator::Interleave"));
+
+  model.RemoveNode(map_0);
+  EXPECT_EQ(map_1, model.AddNode("Iterator::Interleave[2]::Map"));
+  model.RemoveNode(map_1);
+  model.RemoveNode(map_1);
+  EXPECT_NE(map_1, model.AddNode("Iterator::Interleave[3]::Map"));
+}
+
+TEST(ModelTest, OutputTime) {
+  Model model;
+  std::shared_ptr<Node> batch = model.AddNode("Iterator::Batch");
+  std::shared_ptr<Node> map = model.AddNode("Iterator::Batch::ParallelMap");
+  std::shared_ptr<Tunable> parallelism =
+      model.AddTunable(map, Tunable::Kind::kParallelism, 4, 4, 4, nullptr);
+  EXPECT_TRUE(map->async());
+  EXPECT_FALSE(batch->async());
+  EXPECT_FALSE(model.collecting());
+
+  // Batches of 10 elements, 100ns per batch and 400ns per element.
+  Produce(batch.get(), 10, 100);
+  Produce(map.get(), 100, 400);
+  EXPECT_DOUBLE_EQ(100 + 10 * 400 / 4, model.OutputTime());
+}
+
+TEST(ModelTest, OptimizeParallelism) {
+  Model model;
+  std::shared_ptr<Node> batch = model.AddNode("Iterator::Batch");
+  std::shared_ptr<Node> map = model.AddNode("Iterator::Batch::ParallelMap");
+  int notified = 0;
+  std::shared_ptr<Tunable> parallelism =
+      model.AddTunable(map, Tunable::Kind::kParallelism, kAutoTune, 1, 64,
+                       [&notified]() { ++notified; });
+  EXPECT_EQ(1, parallelism->value());
+  EXPECT_TRUE(model.collecting());
+
+  Produce(batch.get(), 10, 100);
+  Produce(map.get(), 100, 400);
+  model.Optimize(8);
+  EXPECT_EQ(8, parallelism->value());
+  EXPECT_EQ(1, notified);
+
+  // Nothing changes when the model is optimized again.
+  model.Optimize(8);
+  EXPECT_EQ(8, parallelism->value());
+  EXPECT_EQ(1, notified);
+
+  // Parameters of iterators that went away are not changed.
+  parallelism->Detach();
+  model.Optimize(16);
+  EXPECT_EQ(8, parallelism->value());
+  EXPECT_EQ(1, notified);
+}
+
+TEST(ModelTest, OptimizeSplitsBudget) {
+  Model model;
+  std::shared_ptr<Node> slow = model.AddNode("Iterator::ParallelMap");
+  std::shared_ptr<Node> fast =
+      model.AddNode("Iterator::ParallelMap::ParallelMap");
+  std::shared_ptr<Tunable> slow_parallelism = model.AddTunable(
+      slow, Tunable::Kind::kParallelism, kAutoTune, 1, 64, nullptr);
+  std::shared_ptr<Tunable> fast_parallelism = model.AddTunable(
+      fast, Tunable::Kind::kParallelism, kAutoTune, 1, 64, nullptr);
+
+  Produce(slow.get(), 100, 3000);
+  Produce(fast.get(), 100, 1000);
+  model.Optimize(8);
+  EXPECT_LE(slow_parallelism->value() + fast_parallelism->value(), 8);
+  EXPECT_GT(slow_parallelism->value(), fast_parallelism->value());
+  EXPECT_GT(fast_parallelism->value(), 1);
+}
+
+TEST(ModelTest, OptimizeKeepsFixedParameters) {
+  Model model;
+  std::shared_ptr<Node> map = model.AddNode("Iterator::ParallelMap");
+  std::shared_ptr<Tunable> parallelism =
+      model.AddTunable(map, Tunable::Kind::kParallelism, 2, 2, 2, nullptr);
+  Produce(map.get(), 100, 1000);
+  model.Optimize(8);
+  EXPECT_EQ(2, parallelism->value());
+}
+
+TEST(ModelTest, OptimizeBufferSize) {
+  Model model;
+  std::shared_ptr<Node> prefetch = model.AddNode("Iterator::Prefetch");
+  std::shared_ptr<Node> map = model.AddNode("Iterator::Prefetch::Map");
+  std::shared_ptr<Tunable> buffer_size = model.AddTunable(
+      prefetch, Tunable::Kind::kBufferSize, 16, 1, 1024, nullptr);
+  Produce(prefetch.get(), 10, 0);
+  Produce(map.get(), 10, 1);
+
+  // The first call only starts the measurement.
+  buffer_size->RecordConsumption(0);
+  model.Optimize(8);
+  EXPECT_EQ(16, buffer_size->value());
+
+  // At least 10 of the 16 buffered elements were never needed.
+  for (int i = 0; i < 10; ++i) {
+    buffer_size->RecordConsumption(10 + i);
+  }
+  Env::Default()->SleepForMicroseconds(1000);
+  model.Optimize(8);
+  EXPECT_EQ(11, buffer_size->value());
+
+  // The consumer had to wait for a faster producer.
+  buffer_size->RecordConsumption(5);
+  buffer_size->RecordConsumption(0);
+  Env::Default()->SleepForMicroseconds(1000);
+  model.Optimize(8);
+  EXPECT_EQ(22, buffer_size->value());
+}
+
+TEST(ModelTest, Profile) {
+  Model model;
+  EXPECT_FALSE(model.profiling());
+  model.EnableProfiling();
+  EXPECT_TRUE(model.profiling());
+  EXPECT_FALSE(model.collecting());
+
+  std::shared_ptr<Node> prefetch = model.AddNode("Iterator::Prefetch");
+  std::shared_ptr<Node> map = model.AddNode("Iterator::Prefetch::Map");
+  Produce(map.get(), 4, 100);
+  for (int i = 0; i < 4; ++i) {
+    map->RecordOutput(150, 8);
+    prefetch->AddInputTime(150);
+  }
+  Produce(prefetch.get(), 2, 10);
+  prefetch->RecordOutput(50, 16);
+  prefetch->RecordBufferSize(3);
+  prefetch->RecordBufferSize(1);
+
+  std::vector<Profile> profile = model.GetProfile();
+  ASSERT_EQ(2, profile.size());
+  EXPECT_EQ("Iterator::Prefetch", profile[0].name);
+  EXPECT_EQ(2, profile[0].num_elements);
+  EXPECT_EQ(20, profile[0].processing_time);
+  EXPECT_EQ(50, profile[0].latency);
+  EXPECT_EQ(600, profile[0].input_time);
+  EXPECT_EQ(16, profile[0].bytes_produced);
+  EXPECT_EQ(4, profile[0].buffered_elements);
+  EXPECT_EQ(2, profile[0].buffer_samples);
+  EXPECT_EQ("Iterator::Prefetch::Map", profile[1].name);
+  EXPECT_EQ(4, profile[1].num_elements);
+  EXPECT_EQ(400, profile[1].processing_time);
+  EXPECT_EQ(600, profile[1].latency);
+  EXPECT_EQ(0, profile[1].input_time);
+  EXPECT_EQ(32, profile[1].bytes_produced);
+  EXPECT_EQ(0, profile[1].buffer_samples);
+}
+
+}  // namespace
+}  // namespace model
+}  // namespace tensorflow
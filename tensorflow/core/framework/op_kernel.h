@@ -530,6 +530,10 @@ class OpKernelContext {
     // stored in this container..
     ScopedStepContainer* step_container = nullptr;
 
+    // If set, replaces the device's allocator for allocations with default
+    // attributes during this step.
+    Allocator* step_allocator = nullptr;
+
     // Mechanism used by this op kernel invocation to communicate with
     // computations running on other devices.
     Rendezvous* rendezvous = nullptr;
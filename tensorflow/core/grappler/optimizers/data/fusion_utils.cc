@@ -0,0 +1,175 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/data/fusion_utils.h"
+
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/op_def.pb.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/protobuf.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace fusion_utils {
+namespace {
+
+constexpr char kFirstCallName[] = "first";
+constexpr char kSecondCallName[] = "second";
+
+// Arguments of functions that are not parametrized have a concrete type.
+bool HasConcreteTypes(const protobuf::RepeatedPtrField<OpDef::ArgDef>& args) {
+  for (const OpDef::ArgDef& arg : args) {
+    if (arg.type() == DT_INVALID || !arg.number_attr().empty() ||
+        !arg.type_list_attr().empty() || arg.is_ref()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns the reference to output `arg` of the function call node `call`.
+string CallOutput(const string& call, const OpDef::ArgDef& arg) {
+  return strings::StrCat(call, ":", arg.name(), ":0");
+}
+
+// Adds an argument of type `type` to `signature` and returns its name.
+string AddInputArg(DataType type, OpDef* signature) {
+  OpDef::ArgDef* arg = signature->add_input_arg();
+  arg->set_name(strings::StrCat("arg", signature->input_arg_size() - 1));
+  arg->set_type(type);
+  return arg->name();
+}
+
+// Adds an output of type `type` that returns `value` to `function`.
+void AddOutputArg(DataType type, const string& value, FunctionDef* function) {
+  OpDef* signature = function->mutable_signature();
+  OpDef::ArgDef* arg = signature->add_output_arg();
+  arg->set_name(strings::StrCat("ret", signature->output_arg_size() - 1));
+  arg->set_type(type);
+  (*function->mutable_ret())[arg->name()] = value;
+}
+
+string UniqueFunctionName(const string& prefix,
+                          const FunctionDefLibrary& library) {
+  string name = prefix;
+  for (int id = 0; FindFunction(name, library) != nullptr; ++id) {
+    name = strings::StrCat(prefix, "_", id);
+  }
+  return name;
+}
+
+}  // namespace
+
+bool CanFuseFunctions(const FunctionDef& first, const FunctionDef& second) {
+  const OpDef& first_signature = first.signature();
+  const OpDef& second_signature = second.signature();
+  if (first_signature.attr_size() > 0 || second_signature.attr_size() > 0) {
+    return false;
+  }
+  if (!HasConcreteTypes(first_signature.input_arg()) ||
+      !HasConcreteTypes(first_signature.output_arg()) ||
+      !HasConcreteTypes(second_signature.input_arg()) ||
+      !HasConcreteTypes(second_signature.output_arg())) {
+    return false;
+  }
+  if (second_signature.input_arg_size() < first_signature.output_arg_size()) {
+    return false;
+  }
+  for (int i = 0; i < first_signature.output_arg_size(); ++i) {
+    if (first_signature.output_arg(i).type() !=
+        second_signature.input_arg(i).type()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Status FuseFunctions(const FunctionDef& first, const FunctionDef& second,
+                     bool keep_first_outputs, FunctionDefLibrary* library,
+                     FunctionDef** result) {
+  if (!CanFuseFunctions(first, second)) {
+    return errors::InvalidArgument("Cannot fuse function ",
+                                   first.signature().name(), " into ",
+                                   second.signature().name(), ".");
+  }
+  const OpDef& first_signature = first.signature();
+  const OpDef& second_signature = second.signature();
+  // Copy the signatures before adding the fused function, which may
+  // invalidate references into `library`.
+  const string first_name = first_signature.name();
+  const string second_name = second_signature.name();
+  const std::vector<OpDef::ArgDef> first_inputs(
+      first_signature.input_arg().begin(), first_signature.input_arg().end());
+  const std::vector<OpDef::ArgDef> first_outputs(
+      first_signature.output_arg().begin(),
+      first_signature.output_arg().end());
+  const std::vector<OpDef::ArgDef> second_inputs(
+      second_signature.input_arg().begin(),
+      second_signature.input_arg().end());
+  const std::vector<OpDef::ArgDef> second_outputs(
+      second_signature.output_arg().begin(),
+      second_signature.output_arg().end());
+  const bool is_stateful =
+      first_signature.is_stateful() || second_signature.is_stateful();
+
+  const string fused_name = UniqueFunctionName(
+      strings::StrCat("fused_", first_name, "_", second_name), *library);
+  FunctionDef* fused = library->add_function();
+  OpDef* signature = fused->mutable_signature();
+  signature->set_name(fused_name);
+  signature->set_is_stateful(is_stateful);
+
+  NodeDef* first_call = fused->add_node_def();
+  first_call->set_name(kFirstCallName);
+  first_call->set_op(first_name);
+  for (const OpDef::ArgDef& arg : first_inputs) {
+    first_call->add_input(AddInputArg(arg.type(), signature));
+  }
+
+  NodeDef* second_call = fused->add_node_def();
+  second_call->set_name(kSecondCallName);
+  second_call->set_op(second_name);
+  for (const OpDef::ArgDef& arg : first_outputs) {
+    second_call->add_input(CallOutput(kFirstCallName, arg));
+  }
+  for (size_t i = first_outputs.size(); i < second_inputs.size(); ++i) {
+    second_call->add_input(AddInputArg(second_inputs[i].type(), signature));
+  }
+
+  if (keep_first_outputs) {
+    for (const OpDef::ArgDef& arg : first_outputs) {
+      AddOutputArg(arg.type(), CallOutput(kFirstCallName, arg), fused);
+    }
+  }
+  for (const OpDef::ArgDef& arg : second_outputs) {
+    AddOutputArg(arg.type(), CallOutput(kSecondCallName, arg), fused);
+  }
+  *result = fused;
+  return Status::OK();
+}
+
+const FunctionDef* FindFunction(const string& name,
+                                const FunctionDefLibrary& library) {
+  for (const FunctionDef& function : library.function()) {
+    if (function.signature().name() == name) {
+      return &function;
+    }
+  }
+  return nullptr;
+}
+
+}  // end namespace fusion_utils
+}  // end namespace grappler
+}  // end namespace tensorflow
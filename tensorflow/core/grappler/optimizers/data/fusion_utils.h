@@ -0,0 +1,54 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_DATA_FUSION_UTILS_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_DATA_FUSION_UTILS_H_
+
+#include "tensorflow/core/framework/function.pb.h"
+#include "tensorflow/core/lib/core/errors.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace fusion_utils {
+
+// Adds to `library` a function that calls `first` on its inputs and `second`
+// on the outputs of `first`, and returns it in `result`.
+//
+// The fused function takes the arguments of `first` followed by the
+// arguments of `second` that are not fed by `first` (i.e. the captured
+// inputs of `second`). It returns the outputs of `second`, preceded by the
+// outputs of `first` if `keep_first_outputs` is true.
+//
+// The body of the fused function consists of two function call nodes, which
+// the function runtime inlines when it instantiates the fused function.
+Status FuseFunctions(const FunctionDef& first, const FunctionDef& second,
+                     bool keep_first_outputs, FunctionDefLibrary* library,
+                     FunctionDef** result);
+
+// Returns the function with the given name, or null if `library` does not
+// contain it.
+const FunctionDef* FindFunction(const string& name,
+                                const FunctionDefLibrary& library);
+
+// Checks whether `first` and `second` can be fused, i.e. the outputs of
+// `first` match the leading arguments of `second` and neither function is
+// parametrized by attributes of the call.
+bool CanFuseFunctions(const FunctionDef& first, const FunctionDef& second);
+
+}  // end namespace fusion_utils
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_DATA_FUSION_UTILS_H_
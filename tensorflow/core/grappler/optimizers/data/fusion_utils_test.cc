@@ -0,0 +1,132 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/data/fusion_utils.h"
+
+#include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/op_def.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace fusion_utils {
+namespace {
+
+using FDH = FunctionDefHelper;
+
+FunctionDef XTimesTwo() {
+  return FDH::Create(
+      "XTimesTwo", {"x: int64"}, {"y: int64"}, {},
+      {{{"two"},
+        "Const",
+        {},
+        {{"value", test::AsScalar<int64>(2)}, {"dtype", DT_INT64}}},
+       {{"y"}, "Mul", {"x", "two:output:0"}, {{"T", DT_INT64}}}},
+      {{"y", "y:z:0"}});
+}
+
+FunctionDef XPlusY() {
+  return FDH::Create("XPlusY", {"x: int64", "y: int64"}, {"z: int64"}, {},
+                     {{{"z"}, "Add", {"x", "y"}, {{"T", DT_INT64}}}},
+                     {{"z", "z:z:0"}});
+}
+
+TEST(FusionUtilsTest, FuseFunctions) {
+  FunctionDefLibrary library;
+  *library.add_function() = XTimesTwo();
+  *library.add_function() = XPlusY();
+
+  FunctionDef* fused;
+  TF_ASSERT_OK(FuseFunctions(library.function(0), library.function(1),
+                             /*keep_first_outputs=*/false, &library, &fused));
+  EXPECT_EQ(library.function_size(), 3);
+  EXPECT_EQ(FindFunction(fused->signature().name(), library), fused);
+
+  // The fused function takes the argument of the first function and the
+  // captured argument of the second one.
+  const OpDef& signature = fused->signature();
+  ASSERT_EQ(signature.input_arg_size(), 2);
+  ASSERT_EQ(signature.output_arg_size(), 1);
+  EXPECT_EQ(signature.output_arg(0).type(), DT_INT64);
+
+  ASSERT_EQ(fused->node_def_size(), 2);
+  const NodeDef& first_call = fused->node_def(0);
+  const NodeDef& second_call = fused->node_def(1);
+  EXPECT_EQ(first_call.op(), "XTimesTwo");
+  ASSERT_EQ(first_call.input_size(), 1);
+  EXPECT_EQ(first_call.input(0), signature.input_arg(0).name());
+  EXPECT_EQ(second_call.op(), "XPlusY");
+  ASSERT_EQ(second_call.input_size(), 2);
+  EXPECT_EQ(second_call.input(0), strings::StrCat(first_call.name(), ":y:0"));
+  EXPECT_EQ(second_call.input(1), signature.input_arg(1).name());
+  EXPECT_EQ(fused->ret().at(signature.output_arg(0).name()),
+            strings::StrCat(second_call.name(), ":z:0"));
+}
+
+TEST(FusionUtilsTest, FuseFunctionsKeepingFirstOutputs) {
+  FunctionDefLibrary library;
+  *library.add_function() = XTimesTwo();
+  *library.add_function() = XPlusY();
+
+  FunctionDef* fused;
+  TF_ASSERT_OK(FuseFunctions(library.function(0), library.function(1),
+                             /*keep_first_outputs=*/true, &library, &fused));
+  const OpDef& signature = fused->signature();
+  ASSERT_EQ(signature.output_arg_size(), 2);
+  EXPECT_EQ(fused->ret().at(signature.output_arg(0).name()),
+            strings::StrCat(fused->node_def(0).name(), ":y:0"));
+  EXPECT_EQ(fused->ret().at(signature.output_arg(1).name()),
+            strings::StrCat(fused->node_def(1).name(), ":z:0"));
+
+  // Fusing the same functions again gives a function with another name.
+  FunctionDef* fused_again;
+  TF_ASSERT_OK(FuseFunctions(library.function(0), library.function(1),
+                             /*keep_first_outputs=*/true, &library,
+                             &fused_again));
+  EXPECT_NE(fused_again->signature().name(), fused->signature().name());
+}
+
+TEST(FusionUtilsTest, CannotFuseMismatchingFunctions) {
+  FunctionDef x_plus_y = XPlusY();
+  FunctionDef x_times_two = XTimesTwo();
+  EXPECT_TRUE(CanFuseFunctions(x_plus_y, x_times_two));
+  // The second argument of `XPlusY` is a captured input.
+  EXPECT_TRUE(CanFuseFunctions(x_times_two, x_plus_y));
+
+  FunctionDef polymorphic = FDH::Create(
+      "Identity", {"x: T"}, {"y: T"}, {"T: type"},
+      {{{"y"}, "Identity", {"x"}, {{"T", "$T"}}}}, {{"y", "y:output:0"}});
+  EXPECT_FALSE(CanFuseFunctions(polymorphic, x_times_two));
+  EXPECT_FALSE(CanFuseFunctions(x_times_two, polymorphic));
+
+  FunctionDef to_float = FDH::Create(
+      "ToFloat", {"x: int64"}, {"y: float"}, {},
+      {{{"y"}, "Cast", {"x"}, {{"SrcT", DT_INT64}, {"DstT", DT_FLOAT}}}},
+      {{"y", "y:y:0"}});
+  EXPECT_FALSE(CanFuseFunctions(to_float, x_times_two));
+
+  FunctionDefLibrary library;
+  FunctionDef* fused;
+  EXPECT_FALSE(
+      FuseFunctions(to_float, x_times_two, false, &library, &fused).ok());
+  EXPECT_EQ(library.function_size(), 0);
+}
+
+}  // namespace
+}  // namespace fusion_utils
+}  // namespace grappler
+}  // namespace tensorflow
@@ -0,0 +1,152 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/data/map_and_filter_fusion.h"
+
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/op_def.pb.h"
+#include "tensorflow/core/grappler/clusters/cluster.h"
+#include "tensorflow/core/grappler/graph_view.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/op_types.h"
+#include "tensorflow/core/grappler/optimizers/custom_graph_optimizer_registry.h"
+#include "tensorflow/core/grappler/optimizers/data/fusion_utils.h"
+#include "tensorflow/core/grappler/optimizers/data/graph_utils.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/platform/protobuf.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+constexpr char kMapOpName[] = "MapDataset";
+constexpr char kFilterOpName[] = "FilterByLastComponentDataset";
+
+bool HasControlInputs(const NodeDef& node) {
+  for (const string& input : node.input()) {
+    if (IsControlInput(input)) return true;
+  }
+  return false;
+}
+
+// Returns the function `node` calls in its `attr` attribute if it can be
+// fused, or null.
+const FunctionDef* FusableFunction(const NodeDef& node, const string& attr,
+                                   const FunctionDefLibrary& library) {
+  if (HasControlInputs(node)) return nullptr;
+  const NameAttrList& func = node.attr().at(attr).func();
+  // Functions parametrized by the attributes of the call are not supported.
+  if (func.attr_size() > 0) return nullptr;
+  return fusion_utils::FindFunction(func.name(), library);
+}
+
+}  // namespace
+
+Status MapAndFilterFusion::Optimize(Cluster* cluster, const GrapplerItem& item,
+                                    GraphDef* output) {
+  *output = item.graph;
+  GraphView graph(output);
+  std::set<string> nodes_to_delete;
+  const int num_nodes = output->node_size();
+  for (int i = 0; i < num_nodes; ++i) {
+    const NodeDef& filter_node = output->node(i);
+    if (filter_node.op() != "FilterDataset") continue;
+    const FunctionDef* predicate =
+        FusableFunction(filter_node, "predicate", output->library());
+    if (predicate == nullptr) continue;
+    const OpDef& predicate_signature = predicate->signature();
+    if (predicate_signature.output_arg_size() != 1 ||
+        predicate_signature.output_arg(0).type() != DT_BOOL) {
+      continue;
+    }
+
+    GraphView::InputPort input_port = graph.GetInputPort(filter_node.name(), 0);
+    const NodeDef* map_node = graph.GetRegularFanin(input_port).node;
+    if (map_node->op() != kMapOpName) continue;
+    const FunctionDef* function =
+        FusableFunction(*map_node, "f", output->library());
+    if (function == nullptr) continue;
+    // The output of the map must not be used by any other node.
+    if (graph.GetFanouts(*map_node, true).size() != 1) continue;
+    if (!fusion_utils::CanFuseFunctions(*function, *predicate)) continue;
+
+    // The fused function returns the outputs of the map function followed by
+    // the value of the predicate on them.
+    FunctionDef* fused_function;
+    TF_RETURN_IF_ERROR(fusion_utils::FuseFunctions(
+        *function, *predicate, /*keep_first_outputs=*/true,
+        output->mutable_library(), &fused_function));
+
+    NodeDef* new_map_node = output->add_node();
+    new_map_node->set_op(kMapOpName);
+    graph_utils::SetUniqueName(kMapOpName, output, new_map_node);
+
+    // Set the `input_dataset` input argument and the `other_arguments` input
+    // arguments of the map, followed by those of the filter.
+    for (const string& input : map_node->input()) {
+      new_map_node->add_input(input);
+    }
+    for (int j = 1; j < filter_node.input_size(); ++j) {
+      new_map_node->add_input(filter_node.input(j));
+    }
+
+    // Set the `f` and `Targuments` attributes.
+    (*new_map_node->mutable_attr())["f"].mutable_func()->set_name(
+        fused_function->signature().name());
+    AttrValue::ListValue* targuments =
+        (*new_map_node->mutable_attr())["Targuments"].mutable_list();
+    for (const NodeDef* node : {map_node, &filter_node}) {
+      for (int type : node->attr().at("Targuments").list().type()) {
+        targuments->add_type(static_cast<DataType>(type));
+      }
+    }
+    // Set `output_types` and `output_shapes` attributes, which include the
+    // scalar value of the predicate.
+    AttrValue output_types = map_node->attr().at("output_types");
+    output_types.mutable_list()->add_type(DT_BOOL);
+    (*new_map_node->mutable_attr())["output_types"] = output_types;
+    AttrValue output_shapes = map_node->attr().at("output_shapes");
+    output_shapes.mutable_list()->add_shape();
+    (*new_map_node->mutable_attr())["output_shapes"] = output_shapes;
+
+    NodeDef* new_filter_node = output->add_node();
+    new_filter_node->set_op(kFilterOpName);
+    graph_utils::SetUniqueName(kFilterOpName, output, new_filter_node);
+    new_filter_node->add_input(new_map_node->name());
+    for (auto key : {"output_shapes", "output_types"}) {
+      (*new_filter_node->mutable_attr())[key] = filter_node.attr().at(key);
+    }
+
+    // Mark the `Map` and `Filter` nodes for removal.
+    nodes_to_delete.insert(map_node->name());
+    nodes_to_delete.insert(filter_node.name());
+
+    graph_utils::ReplaceInput(filter_node, *new_filter_node, &graph);
+  }
+  TF_RETURN_IF_ERROR(graph_utils::DeleteNodes(nodes_to_delete, output));
+  return Status::OK();
+}
+
+void MapAndFilterFusion::Feedback(Cluster* cluster, const GrapplerItem& item,
+                                  const GraphDef& optimize_output,
+                                  double result) {
+  // no-op
+}
+
+REGISTER_GRAPH_OPTIMIZER_AS(MapAndFilterFusion, "map_and_filter_fusion");
+
+}  // end namespace grappler
+}  // end namespace tensorflow
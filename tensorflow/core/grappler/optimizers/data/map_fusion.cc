@@ -0,0 +1,137 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/data/map_fusion.h"
+
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/grappler/clusters/cluster.h"
+#include "tensorflow/core/grappler/graph_view.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/op_types.h"
+#include "tensorflow/core/grappler/optimizers/custom_graph_optimizer_registry.h"
+#include "tensorflow/core/grappler/optimizers/data/fusion_utils.h"
+#include "tensorflow/core/grappler/optimizers/data/graph_utils.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/platform/protobuf.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+constexpr char kMapOpName[] = "MapDataset";
+
+bool HasControlInputs(const NodeDef& node) {
+  for (const string& input : node.input()) {
+    if (IsControlInput(input)) return true;
+  }
+  return false;
+}
+
+// Returns the function of `map_node` if it can be fused, or null.
+const FunctionDef* FusableFunction(const NodeDef& map_node,
+                                   const FunctionDefLibrary& library) {
+  if (map_node.op() != kMapOpName || HasControlInputs(map_node)) {
+    return nullptr;
+  }
+  const NameAttrList& func = map_node.attr().at("f").func();
+  // Functions parametrized by the attributes of the call are not supported.
+  if (func.attr_size() > 0) return nullptr;
+  return fusion_utils::FindFunction(func.name(), library);
+}
+
+}  // namespace
+
+Status MapFusion::Optimize(Cluster* cluster, const GrapplerItem& item,
+                           GraphDef* output) {
+  *output = item.graph;
+  // Each pass fuses pairs of maps that do not overlap, so a chain of maps is
+  // fused into one by repeating the passes until nothing changes.
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    GraphView graph(output);
+    std::set<string> nodes_to_delete;
+    const int num_nodes = output->node_size();
+    for (int i = 0; i < num_nodes; ++i) {
+      NodeDef* map_node = output->mutable_node(i);
+      if (nodes_to_delete.count(map_node->name()) > 0) continue;
+      const FunctionDef* second =
+          FusableFunction(*map_node, output->library());
+      if (second == nullptr) continue;
+
+      GraphView::InputPort input_port = graph.GetInputPort(map_node->name(), 0);
+      NodeDef* parent = graph.GetRegularFanin(input_port).node;
+      if (nodes_to_delete.count(parent->name()) > 0) continue;
+      const FunctionDef* first = FusableFunction(*parent, output->library());
+      if (first == nullptr) continue;
+      // The output of the first map must not be used by any other node.
+      if (graph.GetFanouts(*parent, true).size() != 1) continue;
+      if (!fusion_utils::CanFuseFunctions(*first, *second)) continue;
+
+      FunctionDef* fused_function;
+      TF_RETURN_IF_ERROR(fusion_utils::FuseFunctions(
+          *first, *second, /*keep_first_outputs=*/false,
+          output->mutable_library(), &fused_function));
+
+      NodeDef* new_node = output->add_node();
+      new_node->set_op(kMapOpName);
+      graph_utils::SetUniqueName(kMapOpName, output, new_node);
+
+      // Set the `input_dataset` input argument and the `other_arguments`
+      // input arguments of the first map, followed by those of the second.
+      for (const string& input : parent->input()) {
+        new_node->add_input(input);
+      }
+      for (int j = 1; j < map_node->input_size(); ++j) {
+        new_node->add_input(map_node->input(j));
+      }
+
+      // Set the `f` and `Targuments` attributes.
+      (*new_node->mutable_attr())["f"].mutable_func()->set_name(
+          fused_function->signature().name());
+      AttrValue::ListValue* targuments =
+          (*new_node->mutable_attr())["Targuments"].mutable_list();
+      for (const NodeDef* node : {parent, map_node}) {
+        for (int type : node->attr().at("Targuments").list().type()) {
+          targuments->add_type(static_cast<DataType>(type));
+        }
+      }
+      // Set `output_types` and `output_shapes` attributes.
+      for (auto key : {"output_shapes", "output_types"}) {
+        (*new_node->mutable_attr())[key] = map_node->attr().at(key);
+      }
+
+      // Mark both `Map` nodes for removal.
+      nodes_to_delete.insert(parent->name());
+      nodes_to_delete.insert(map_node->name());
+
+      graph_utils::ReplaceInput(*map_node, *new_node, &graph);
+      changed = true;
+    }
+    TF_RETURN_IF_ERROR(graph_utils::DeleteNodes(nodes_to_delete, output));
+  }
+  return Status::OK();
+}
+
+void MapFusion::Feedback(Cluster* cluster, const GrapplerItem& item,
+                         const GraphDef& optimize_output, double result) {
+  // no-op
+}
+
+REGISTER_GRAPH_OPTIMIZER_AS(MapFusion, "map_fusion");
+
+}  // end namespace grappler
+}  // end namespace tensorflow
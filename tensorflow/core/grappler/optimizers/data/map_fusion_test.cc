@@ -0,0 +1,171 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/data/map_fusion.h"
+
+#include "tensorflow/core/framework/attr_value_util.h"
+#include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/optimizers/data/graph_utils.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+using FDH = FunctionDefHelper;
+
+FunctionDef XTimesTwo() {
+  return FDH::Create(
+      "XTimesTwo", {"x: int64"}, {"y: int64"}, {},
+      {{{"two"},
+        "Const",
+        {},
+        {{"value", test::AsScalar<int64>(2)}, {"dtype", DT_INT64}}},
+       {{"y"}, "Mul", {"x", "two:output:0"}, {{"T", DT_INT64}}}},
+      {{"y", "y:z:0"}});
+}
+
+Status AddRangeNode(GraphDef *graph, NodeDef **result) {
+  NodeDef *start_node;
+  TF_RETURN_IF_ERROR(
+      graph_utils::AddScalarConstNode<int64>(0, graph, &start_node));
+  NodeDef *stop_node;
+  TF_RETURN_IF_ERROR(
+      graph_utils::AddScalarConstNode<int64>(10, graph, &stop_node));
+  NodeDef *step_node;
+  TF_RETURN_IF_ERROR(
+      graph_utils::AddScalarConstNode<int64>(1, graph, &step_node));
+  std::vector<string> range_inputs = {start_node->name(), stop_node->name(),
+                                      step_node->name()};
+  std::vector<std::pair<string, AttrValue>> range_attrs;
+  return graph_utils::AddNode("", "RangeDataset", range_inputs, range_attrs,
+                              graph, result);
+}
+
+Status AddMapNode(const string &input, const string &function,
+                  GraphDef *graph, NodeDef **result) {
+  std::vector<std::pair<string, AttrValue>> map_attrs(4);
+  AttrValue f_attr;
+  f_attr.mutable_func()->set_name(function);
+  map_attrs[0] = std::make_pair("f", f_attr);
+  AttrValue args_attr;
+  SetAttrValue(gtl::ArraySlice<DataType>({}), &args_attr);
+  map_attrs[1] = std::make_pair("Targuments", args_attr);
+  AttrValue types_attr;
+  SetAttrValue(gtl::ArraySlice<DataType>({DT_INT64}), &types_attr);
+  map_attrs[2] = std::make_pair("output_types", types_attr);
+  AttrValue shapes_attr;
+  SetAttrValue(gtl::ArraySlice<TensorShape>({{}}), &shapes_attr);
+  map_attrs[3] = std::make_pair("output_shapes", shapes_attr);
+  return graph_utils::AddNode("", "MapDataset", {input}, map_attrs, graph,
+                              result);
+}
+
+TEST(MapFusionTest, FuseTwoMapNodesIntoOne) {
+  GrapplerItem item;
+  GraphDef *graph = &item.graph;
+  *graph->mutable_library()->add_function() = XTimesTwo();
+  NodeDef *range_node;
+  TF_ASSERT_OK(AddRangeNode(graph, &range_node));
+  NodeDef *map_node1;
+  TF_ASSERT_OK(
+      AddMapNode(range_node->name(), "XTimesTwo", graph, &map_node1));
+  NodeDef *map_node2;
+  TF_ASSERT_OK(AddMapNode(map_node1->name(), "XTimesTwo", graph, &map_node2));
+
+  MapFusion optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  EXPECT_FALSE(graph_utils::ContainsNodeWithName(map_node1->name(), output));
+  EXPECT_FALSE(graph_utils::ContainsNodeWithName(map_node2->name(), output));
+  int index = graph_utils::FindNodeWithOp("MapDataset", output);
+  ASSERT_NE(index, -1);
+  const NodeDef &fused_node = output.node(index);
+  EXPECT_EQ(fused_node.input_size(), 1);
+  EXPECT_EQ(fused_node.input(0), range_node->name());
+  EXPECT_TRUE(AreAttrValuesEqual(fused_node.attr().at("output_types"),
+                                 map_node2->attr().at("output_types")));
+
+  // The fused function calls the functions of both maps.
+  ASSERT_EQ(output.library().function_size(), 2);
+  const FunctionDef &fused_function = output.library().function(1);
+  EXPECT_EQ(fused_node.attr().at("f").func().name(),
+            fused_function.signature().name());
+  ASSERT_EQ(fused_function.node_def_size(), 2);
+  EXPECT_EQ(fused_function.node_def(0).op(), "XTimesTwo");
+  EXPECT_EQ(fused_function.node_def(1).op(), "XTimesTwo");
+}
+
+TEST(MapFusionTest, FuseChainOfMapNodes) {
+  GrapplerItem item;
+  GraphDef *graph = &item.graph;
+  *graph->mutable_library()->add_function() = XTimesTwo();
+  NodeDef *range_node;
+  TF_ASSERT_OK(AddRangeNode(graph, &range_node));
+  string input = range_node->name();
+  for (int i = 0; i < 3; ++i) {
+    NodeDef *map_node;
+    TF_ASSERT_OK(AddMapNode(input, "XTimesTwo", graph, &map_node));
+    input = map_node->name();
+  }
+  NodeDef *sink_node;
+  TF_ASSERT_OK(graph_utils::AddNode("", "Identity", {input}, {}, graph,
+                                    &sink_node));
+
+  MapFusion optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  int num_maps = 0;
+  for (const NodeDef &node : output.node()) {
+    if (node.op() == "MapDataset") ++num_maps;
+  }
+  EXPECT_EQ(num_maps, 1);
+  const NodeDef &fused_node =
+      output.node(graph_utils::FindNodeWithOp("MapDataset", output));
+  EXPECT_EQ(fused_node.input(0), range_node->name());
+  const NodeDef &new_sink_node =
+      output.node(graph_utils::FindNodeWithName(sink_node->name(), output));
+  EXPECT_EQ(new_sink_node.input(0), fused_node.name());
+}
+
+TEST(MapFusionTest, DontFuseMapWithOtherConsumers) {
+  GrapplerItem item;
+  GraphDef *graph = &item.graph;
+  *graph->mutable_library()->add_function() = XTimesTwo();
+  NodeDef *range_node;
+  TF_ASSERT_OK(AddRangeNode(graph, &range_node));
+  NodeDef *map_node1;
+  TF_ASSERT_OK(
+      AddMapNode(range_node->name(), "XTimesTwo", graph, &map_node1));
+  NodeDef *map_node2;
+  TF_ASSERT_OK(AddMapNode(map_node1->name(), "XTimesTwo", graph, &map_node2));
+  NodeDef *other_node;
+  TF_ASSERT_OK(graph_utils::AddNode("", "Identity", {map_node1->name()}, {},
+                                    graph, &other_node));
+
+  MapFusion optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  EXPECT_TRUE(graph_utils::Compare(*graph, output));
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
@@ -0,0 +1,314 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/data/map_vectorization.h"
+
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/function.pb.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/op_def.pb.h"
+#include "tensorflow/core/framework/tensor_shape.pb.h"
+#include "tensorflow/core/grappler/clusters/cluster.h"
+#include "tensorflow/core/grappler/graph_view.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/op_types.h"
+#include "tensorflow/core/grappler/optimizers/custom_graph_optimizer_registry.h"
+#include "tensorflow/core/grappler/optimizers/data/fusion_utils.h"
+#include "tensorflow/core/grappler/optimizers/data/graph_utils.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/lib/gtl/map_util.h"
+#include "tensorflow/core/platform/protobuf.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+// Ops that apply a function to each element of their input.
+const std::set<string>& UnaryCwiseOps() {
+  static const std::set<string>* ops = new std::set<string>{
+      "Abs", "Cast", "Ceil", "Cos", "Exp", "Expm1", "Floor", "Identity", "Log",
+      "Log1p", "LogicalNot", "Neg", "Reciprocal", "Relu", "Relu6", "Round",
+      "Rsqrt", "Sigmoid", "Sign", "Sin", "Sqrt", "Square", "Tanh",
+  };
+  return *ops;
+}
+
+// Ops that apply a function to each pair of elements of their inputs, with
+// broadcasting.
+const std::set<string>& BinaryCwiseOps() {
+  static const std::set<string>* ops = new std::set<string>{
+      "Add", "AddV2", "Div", "Equal", "FloorDiv", "FloorMod", "Greater",
+      "GreaterEqual", "Less", "LessEqual", "LogicalAnd", "LogicalOr", "Maximum",
+      "Minimum", "Mul", "NotEqual", "Pow", "RealDiv", "SquaredDifference",
+      "Sub",
+  };
+  return *ops;
+}
+
+// What a tensor in the map function is derived from.
+enum class Derivation {
+  // The tensor has the shape of a component of the input element.
+  kElement,
+  // The tensor is a scalar that does not depend on the input element.
+  kScalar,
+};
+
+// Returns the name of the node or function argument that produces `input`.
+string ProducerName(const string& input) {
+  return input.substr(0, input.find(':'));
+}
+
+bool IsScalarConst(const NodeDef& node) {
+  if (node.op() != "Const" || node.input_size() > 0) return false;
+  const AttrValue* value = gtl::FindOrNull(node.attr(), "value");
+  if (value == nullptr) return false;
+  const TensorShapeProto& shape = value->tensor().tensor_shape();
+  return !shape.unknown_rank() && shape.dim_size() == 0;
+}
+
+// Checks whether applying `function` to a batch of elements is the same as
+// batching the results of applying it to each element. This is the case when
+// every node of the function is elementwise, and the operands of binary ops
+// are either scalar constants or tensors with the same shape, which
+// `same_shapes` tells for the components of the element. The first
+// `num_components` arguments of `function` are the components of the element;
+// functions that use the captured arguments after them are not supported.
+bool IsElementwise(const FunctionDef& function, int num_components,
+                   bool same_shapes) {
+  const OpDef& signature = function.signature();
+  std::map<string, Derivation> derivations;
+  for (int i = 0; i < num_components; ++i) {
+    derivations[signature.input_arg(i).name()] = Derivation::kElement;
+  }
+
+  // The nodes of a function are not necessarily in topological order.
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (const NodeDef& node : function.node_def()) {
+      if (derivations.count(node.name()) > 0) continue;
+      if (IsScalarConst(node)) {
+        derivations[node.name()] = Derivation::kScalar;
+        changed = true;
+        continue;
+      }
+      int num_inputs;
+      if (UnaryCwiseOps().count(node.op()) > 0) {
+        num_inputs = 1;
+      } else if (BinaryCwiseOps().count(node.op()) > 0) {
+        num_inputs = 2;
+      } else {
+        return false;
+      }
+      if (node.input_size() != num_inputs) return false;
+
+      bool ready = true;
+      int num_element_inputs = 0;
+      for (const string& input : node.input()) {
+        if (IsControlInput(input)) return false;
+        auto it = derivations.find(ProducerName(input));
+        if (it == derivations.end()) {
+          ready = false;
+          break;
+        }
+        if (it->second == Derivation::kElement) ++num_element_inputs;
+      }
+      if (!ready) continue;
+      if (num_element_inputs > 1 && !same_shapes) return false;
+      derivations[node.name()] = num_element_inputs > 0
+                                     ? Derivation::kElement
+                                     : Derivation::kScalar;
+      changed = true;
+    }
+  }
+
+  // Nodes that were never reached depend on captured arguments.
+  for (const NodeDef& node : function.node_def()) {
+    if (derivations.count(node.name()) == 0) return false;
+  }
+  // Outputs that do not depend on the element would not be batched.
+  for (const OpDef::ArgDef& arg : signature.output_arg()) {
+    const string* ret = gtl::FindOrNull(function.ret(), arg.name());
+    if (ret == nullptr) return false;
+    auto it = derivations.find(ProducerName(*ret));
+    if (it == derivations.end() || it->second != Derivation::kElement) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool IsFullyDefined(const TensorShapeProto& shape) {
+  if (shape.unknown_rank()) return false;
+  for (const auto& dim : shape.dim()) {
+    if (dim.size() < 0) return false;
+  }
+  return true;
+}
+
+// Checks whether all the components of the elements of a dataset with the
+// given shapes have the same shape.
+bool HaveSameShapes(const AttrValue::ListValue& shapes) {
+  if (shapes.shape_size() <= 1) return true;
+  for (const TensorShapeProto& shape : shapes.shape()) {
+    if (!IsFullyDefined(shape) ||
+        shape.SerializeAsString() != shapes.shape(0).SerializeAsString()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns the function of `map_node` if it is elementwise over the elements
+// of `input_node`, or null.
+const FunctionDef* ElementwiseFunction(const NodeDef& map_node,
+                                       const NodeDef& input_node,
+                                       const FunctionDefLibrary& library) {
+  for (const string& input : map_node.input()) {
+    if (IsControlInput(input)) return nullptr;
+  }
+  const NameAttrList& func = map_node.attr().at("f").func();
+  if (func.attr_size() > 0) return nullptr;
+  const FunctionDef* function =
+      fusion_utils::FindFunction(func.name(), library);
+  if (function == nullptr || function->signature().is_stateful()) {
+    return nullptr;
+  }
+
+  const AttrValue* types = gtl::FindOrNull(input_node.attr(), "output_types");
+  const AttrValue* shapes = gtl::FindOrNull(input_node.attr(), "output_shapes");
+  if (types == nullptr || shapes == nullptr) return nullptr;
+  const int num_components = types->list().type_size();
+  if (shapes->list().shape_size() != num_components ||
+      function->signature().input_arg_size() < num_components) {
+    return nullptr;
+  }
+  // Batching serialized sparse tensors and nested datasets changes their
+  // representation.
+  for (int type : types->list().type()) {
+    if (type == DT_VARIANT) return nullptr;
+  }
+  if (!IsElementwise(*function, num_components,
+                     HaveSameShapes(shapes->list()))) {
+    return nullptr;
+  }
+  return function;
+}
+
+}  // namespace
+
+Status MapVectorization::Optimize(Cluster* cluster, const GrapplerItem& item,
+                                  GraphDef* output) {
+  *output = item.graph;
+  // Each pass moves every batch before the map that feeds it, so a chain of
+  // maps is vectorized by repeating the passes until nothing changes.
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    GraphView graph(output);
+    std::set<string> nodes_to_delete;
+    const int num_nodes = output->node_size();
+    for (int i = 0; i < num_nodes; ++i) {
+      const NodeDef& batch_node = output->node(i);
+      if (batch_node.op() != "BatchDataset" &&
+          batch_node.op() != "BatchDatasetV2") {
+        continue;
+      }
+      if (nodes_to_delete.count(batch_node.name()) > 0) continue;
+
+      GraphView::InputPort input_port =
+          graph.GetInputPort(batch_node.name(), 0);
+      const NodeDef* map_node = graph.GetRegularFanin(input_port).node;
+      if (map_node->op() != "MapDataset" &&
+          map_node->op() != "ParallelMapDataset") {
+        continue;
+      }
+      if (nodes_to_delete.count(map_node->name()) > 0) continue;
+      // The output of the map must not be used by any other node.
+      if (graph.GetFanouts(*map_node, true).size() != 1) continue;
+      input_port = graph.GetInputPort(map_node->name(), 0);
+      const NodeDef* input_node = graph.GetRegularFanin(input_port).node;
+      if (ElementwiseFunction(*map_node, *input_node, output->library()) ==
+          nullptr) {
+        continue;
+      }
+
+      NodeDef* new_batch_node = output->add_node();
+      new_batch_node->set_op(batch_node.op());
+      graph_utils::SetUniqueName(batch_node.op(), output, new_batch_node);
+      // Set the `input_dataset` input argument to the input of the map and
+      // keep the `batch_size` and `drop_remainder` input arguments.
+      new_batch_node->add_input(map_node->input(0));
+      for (int j = 1; j < batch_node.input_size(); ++j) {
+        new_batch_node->add_input(batch_node.input(j));
+      }
+      // Set `output_types` and `output_shapes` attributes to those of the
+      // input of the map, with an unknown batch dimension.
+      (*new_batch_node->mutable_attr())["output_types"] =
+          input_node->attr().at("output_types");
+      AttrValue::ListValue* shapes =
+          (*new_batch_node->mutable_attr())["output_shapes"].mutable_list();
+      for (const TensorShapeProto& shape :
+           input_node->attr().at("output_shapes").list().shape()) {
+        TensorShapeProto* batched_shape = shapes->add_shape();
+        if (shape.unknown_rank()) {
+          batched_shape->set_unknown_rank(true);
+          continue;
+        }
+        batched_shape->add_dim()->set_size(-1);
+        for (const auto& dim : shape.dim()) {
+          *batched_shape->add_dim() = dim;
+        }
+      }
+
+      NodeDef* new_map_node = output->add_node();
+      new_map_node->set_op(map_node->op());
+      graph_utils::SetUniqueName(map_node->op(), output, new_map_node);
+      // Keep the `other_arguments` (and `num_parallel_calls`) input
+      // arguments of the map.
+      new_map_node->add_input(new_batch_node->name());
+      for (int j = 1; j < map_node->input_size(); ++j) {
+        new_map_node->add_input(map_node->input(j));
+      }
+      for (auto key : {"f", "Targuments"}) {
+        (*new_map_node->mutable_attr())[key] = map_node->attr().at(key);
+      }
+      // Set `output_types` and `output_shapes` attributes.
+      for (auto key : {"output_shapes", "output_types"}) {
+        (*new_map_node->mutable_attr())[key] = batch_node.attr().at(key);
+      }
+
+      // Mark the `Map` and `Batch` nodes for removal.
+      nodes_to_delete.insert(map_node->name());
+      nodes_to_delete.insert(batch_node.name());
+
+      graph_utils::ReplaceInput(batch_node, *new_map_node, &graph);
+      changed = true;
+    }
+    TF_RETURN_IF_ERROR(graph_utils::DeleteNodes(nodes_to_delete, output));
+  }
+  return Status::OK();
+}
+
+void MapVectorization::Feedback(Cluster* cluster, const GrapplerItem& item,
+                                const GraphDef& optimize_output,
+                                double result) {
+  // no-op
+}
+
+REGISTER_GRAPH_OPTIMIZER_AS(MapVectorization, "map_vectorization");
+
+}  // end namespace grappler
+}  // end namespace tensorflow
@@ -0,0 +1,163 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/data/map_vectorization.h"
+
+#include "tensorflow/core/framework/attr_value_util.h"
+#include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/optimizers/data/graph_utils.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+using FDH = FunctionDefHelper;
+
+FunctionDef XTimesTwo() {
+  return FDH::Create(
+      "XTimesTwo", {"x: int64"}, {"y: int64"}, {},
+      {{{"two"},
+        "Const",
+        {},
+        {{"value", test::AsScalar<int64>(2)}, {"dtype", DT_INT64}}},
+       {{"y"}, "Mul", {"x", "two:output:0"}, {{"T", DT_INT64}}}},
+      {{"y", "y:z:0"}});
+}
+
+FunctionDef NumElements() {
+  return FDH::Create(
+      "NumElements", {"x: int64"}, {"y: int32"}, {},
+      {{{"y"}, "Size", {"x"}, {{"T", DT_INT64}, {"out_type", DT_INT32}}}},
+      {{"y", "y:output:0"}});
+}
+
+// Adds a dataset node without inputs whose elements are vectors of 3 int64s.
+Status AddVectorDatasetNode(GraphDef *graph, NodeDef **result) {
+  std::vector<std::pair<string, AttrValue>> attrs(2);
+  AttrValue types_attr;
+  SetAttrValue(gtl::ArraySlice<DataType>({DT_INT64}), &types_attr);
+  attrs[0] = std::make_pair("output_types", types_attr);
+  AttrValue shapes_attr;
+  SetAttrValue(gtl::ArraySlice<TensorShape>({{3}}), &shapes_attr);
+  attrs[1] = std::make_pair("output_shapes", shapes_attr);
+  return graph_utils::AddNode("", "TensorDataset", {}, attrs, graph, result);
+}
+
+Status AddMapNode(const string &input, const string &function,
+                  DataType output_type, GraphDef *graph, NodeDef **result) {
+  std::vector<std::pair<string, AttrValue>> map_attrs(4);
+  AttrValue f_attr;
+  f_attr.mutable_func()->set_name(function);
+  map_attrs[0] = std::make_pair("f", f_attr);
+  AttrValue args_attr;
+  SetAttrValue(gtl::ArraySlice<DataType>({}), &args_attr);
+  map_attrs[1] = std::make_pair("Targuments", args_attr);
+  AttrValue types_attr;
+  SetAttrValue(gtl::ArraySlice<DataType>({output_type}), &types_attr);
+  map_attrs[2] = std::make_pair("output_types", types_attr);
+  AttrValue shapes_attr;
+  SetAttrValue(gtl::ArraySlice<TensorShape>({{3}}), &shapes_attr);
+  map_attrs[3] = std::make_pair("output_shapes", shapes_attr);
+  return graph_utils::AddNode("", "MapDataset", {input}, map_attrs, graph,
+                              result);
+}
+
+Status AddBatchNode(const string &input, DataType output_type,
+                    GraphDef *graph, NodeDef **result) {
+  NodeDef *batch_size_node;
+  TF_RETURN_IF_ERROR(
+      graph_utils::AddScalarConstNode<int64>(5, graph, &batch_size_node));
+  std::vector<std::pair<string, AttrValue>> batch_attrs(2);
+  AttrValue types_attr;
+  SetAttrValue(gtl::ArraySlice<DataType>({output_type}), &types_attr);
+  batch_attrs[0] = std::make_pair("output_types", types_attr);
+  AttrValue shapes_attr;
+  SetAttrValue(gtl::ArraySlice<PartialTensorShape>({{-1, 3}}), &shapes_attr);
+  batch_attrs[1] = std::make_pair("output_shapes", shapes_attr);
+  return graph_utils::AddNode("", "BatchDataset",
+                              {input, batch_size_node->name()}, batch_attrs,
+                              graph, result);
+}
+
+TEST(MapVectorizationTest, VectorizeElementwiseMap) {
+  GrapplerItem item;
+  GraphDef *graph = &item.graph;
+  *graph->mutable_library()->add_function() = XTimesTwo();
+  NodeDef *input_node;
+  TF_ASSERT_OK(AddVectorDatasetNode(graph, &input_node));
+  NodeDef *map_node;
+  TF_ASSERT_OK(AddMapNode(input_node->name(), "XTimesTwo", DT_INT64, graph,
+                          &map_node));
+  NodeDef *batch_node;
+  TF_ASSERT_OK(AddBatchNode(map_node->name(), DT_INT64, graph, &batch_node));
+  NodeDef *sink_node;
+  TF_ASSERT_OK(graph_utils::AddNode("", "Identity", {batch_node->name()}, {},
+                                    graph, &sink_node));
+
+  MapVectorization optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  EXPECT_FALSE(graph_utils::ContainsNodeWithName(map_node->name(), output));
+  EXPECT_FALSE(graph_utils::ContainsNodeWithName(batch_node->name(), output));
+  int index = graph_utils::FindNodeWithOp("BatchDataset", output);
+  ASSERT_NE(index, -1);
+  const NodeDef &new_batch_node = output.node(index);
+  EXPECT_EQ(new_batch_node.input(0), input_node->name());
+  EXPECT_EQ(new_batch_node.input(1), batch_node->input(1));
+  const TensorShapeProto &batched_shape =
+      new_batch_node.attr().at("output_shapes").list().shape(0);
+  ASSERT_EQ(batched_shape.dim_size(), 2);
+  EXPECT_EQ(batched_shape.dim(0).size(), -1);
+  EXPECT_EQ(batched_shape.dim(1).size(), 3);
+
+  index = graph_utils::FindNodeWithOp("MapDataset", output);
+  ASSERT_NE(index, -1);
+  const NodeDef &new_map_node = output.node(index);
+  EXPECT_EQ(new_map_node.input(0), new_batch_node.name());
+  EXPECT_TRUE(AreAttrValuesEqual(new_map_node.attr().at("f"),
+                                 map_node->attr().at("f")));
+  EXPECT_TRUE(AreAttrValuesEqual(new_map_node.attr().at("output_shapes"),
+                                 batch_node->attr().at("output_shapes")));
+  const NodeDef &new_sink_node =
+      output.node(graph_utils::FindNodeWithName(sink_node->name(), output));
+  EXPECT_EQ(new_sink_node.input(0), new_map_node.name());
+}
+
+TEST(MapVectorizationTest, DontVectorizeNonElementwiseMap) {
+  GrapplerItem item;
+  GraphDef *graph = &item.graph;
+  *graph->mutable_library()->add_function() = NumElements();
+  NodeDef *input_node;
+  TF_ASSERT_OK(AddVectorDatasetNode(graph, &input_node));
+  NodeDef *map_node;
+  TF_ASSERT_OK(AddMapNode(input_node->name(), "NumElements", DT_INT32, graph,
+                          &map_node));
+  NodeDef *batch_node;
+  TF_ASSERT_OK(AddBatchNode(map_node->name(), DT_INT32, graph, &batch_node));
+
+  MapVectorization optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  EXPECT_TRUE(graph_utils::Compare(*graph, output));
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
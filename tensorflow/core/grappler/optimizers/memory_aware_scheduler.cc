@@ -0,0 +1,445 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/memory_aware_scheduler.h"
+
+#include <algorithm>
+#include <queue>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor_shape.pb.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/grappler/clusters/cluster.h"
+#include "tensorflow/core/grappler/costs/graph_memory.h"
+#include "tensorflow/core/grappler/costs/graph_properties.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/op_types.h"
+#include "tensorflow/core/grappler/optimizers/static_schedule.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/grappler/utils/topological_sort.h"
+#include "tensorflow/core/lib/core/errors.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+// The graph to schedule, as adjacency lists of node indices, along with the
+// estimated size of the outputs of the nodes and their execution times.
+struct ScheduleGraph {
+  // Distinct data and control fanins and fanouts.
+  std::vector<std::vector<int>> fanins;
+  std::vector<std::vector<int>> fanouts;
+  // Distinct data fanins and fanouts.
+  std::vector<std::vector<int>> data_fanins;
+  std::vector<std::vector<int>> data_fanouts;
+  std::vector<int64> output_bytes;
+  // Earliest start and completion times of the nodes, assuming unbounded
+  // parallelism, and their execution times (in nanoseconds).
+  std::vector<int64> start;
+  std::vector<int64> completion;
+  std::vector<int64> duration;
+};
+
+// Estimates the size of the outputs of `node` in bytes. Dimensions that are
+// unknown statically are assumed to be 1.
+int64 EstimateOutputBytes(const GraphProperties& properties,
+                          const NodeDef& node) {
+  int64 bytes = 0;
+  for (const auto& output : properties.GetOutputProperties(node.name())) {
+    const TensorShapeProto& shape = output.shape();
+    if (shape.unknown_rank()) {
+      continue;
+    }
+    int64 num_elements = 1;
+    for (const auto& dim : shape.dim()) {
+      num_elements *= dim.size() < 0 ? 1 : dim.size();
+    }
+    bytes += num_elements * DataTypeSize(output.dtype());
+  }
+  return bytes;
+}
+
+// Builds the ScheduleGraph of the topologically sorted graph of `item`.
+Status BuildScheduleGraph(const GrapplerItem& item, const Cluster* cluster,
+                          ScheduleGraph* graph) {
+  const int num_nodes = item.graph.node_size();
+  std::unordered_map<string, int> node_index;
+  for (int i = 0; i < num_nodes; ++i) {
+    node_index[item.graph.node(i).name()] = i;
+  }
+
+  graph->fanins.resize(num_nodes);
+  graph->fanouts.resize(num_nodes);
+  graph->data_fanins.resize(num_nodes);
+  graph->data_fanouts.resize(num_nodes);
+  for (int i = 0; i < num_nodes; ++i) {
+    std::unordered_set<int> fanins;
+    std::unordered_set<int> data_fanins;
+    for (const string& input : item.graph.node(i).input()) {
+      int position;
+      const string input_name = ParseNodeName(input, &position);
+      auto it = node_index.find(input_name);
+      if (it == node_index.end()) {
+        return errors::InvalidArgument("Unknown input node ", input);
+      }
+      if (fanins.insert(it->second).second) {
+        graph->fanins[i].push_back(it->second);
+        graph->fanouts[it->second].push_back(i);
+      }
+      if (position >= 0 && data_fanins.insert(it->second).second) {
+        graph->data_fanins[i].push_back(it->second);
+        graph->data_fanouts[it->second].push_back(i);
+      }
+    }
+  }
+
+  GraphProperties properties(item);
+  TF_RETURN_IF_ERROR(properties.InferStatically(false));
+  graph->output_bytes.resize(num_nodes);
+  for (int i = 0; i < num_nodes; ++i) {
+    const NodeDef& node = item.graph.node(i);
+    // Persistent tensors are allocated no matter the schedule.
+    graph->output_bytes[i] =
+        IsPersistent(node) ? 0 : EstimateOutputBytes(properties, node);
+  }
+
+  std::unordered_map<const NodeDef*, Costs::NanoSeconds> completion_times;
+  TF_RETURN_IF_ERROR(
+      EstimateEarliestExecutionTimes(item, cluster, &completion_times));
+  graph->start.resize(num_nodes);
+  graph->completion.resize(num_nodes);
+  graph->duration.resize(num_nodes);
+  for (int i = 0; i < num_nodes; ++i) {
+    graph->completion[i] = completion_times[&item.graph.node(i)].count();
+  }
+  for (int i = 0; i < num_nodes; ++i) {
+    int64 start = 0;
+    for (int fanin : graph->fanins[i]) {
+      start = std::max(start, graph->completion[fanin]);
+    }
+    graph->start[i] = start;
+    graph->duration[i] = graph->completion[i] - start;
+  }
+  return Status::OK();
+}
+
+// Computes a sequential schedule of `graph` that greedily minimizes the memory
+// usage: among the nodes that are ready, it runs the one that frees the most
+// memory (or allocates the least), and breaks ties in favor of the nodes on
+// the longest path to the end of the graph. `num_consumers` counts the users
+// of the outputs of each node, including the fetches. Sets `frees_memory` for
+// the nodes whose execution releases the last reference to a tensor.
+void ComputeMemoryMinimizingSchedule(const ScheduleGraph& graph,
+                                     const std::vector<int>& num_consumers,
+                                     std::vector<int>* schedule,
+                                     std::vector<bool>* frees_memory) {
+  const int num_nodes = graph.fanins.size();
+  // The fanouts of a node come after it in the topological order.
+  std::vector<int64> tail(num_nodes, 0);
+  for (int i = num_nodes - 1; i >= 0; --i) {
+    int64 longest_fanout = 0;
+    for (int fanout : graph.fanouts[i]) {
+      longest_fanout = std::max(longest_fanout, tail[fanout]);
+    }
+    tail[i] = graph.duration[i] + longest_fanout;
+  }
+
+  std::vector<int> remaining_consumers = num_consumers;
+  std::vector<int> pending_fanins(num_nodes);
+  std::vector<bool> scheduled(num_nodes, false);
+  auto priority = [&graph, &remaining_consumers](int node) {
+    int64 freed_bytes = -graph.output_bytes[node];
+    for (int fanin : graph.data_fanins[node]) {
+      if (remaining_consumers[fanin] == 1) {
+        freed_bytes += graph.output_bytes[fanin];
+      }
+    }
+    return freed_bytes;
+  };
+  struct ReadyNode {
+    int64 priority;
+    int64 tail;
+    int node;
+    bool operator<(const ReadyNode& other) const {
+      if (priority != other.priority) {
+        return priority < other.priority;
+      }
+      if (tail != other.tail) {
+        return tail < other.tail;
+      }
+      return node > other.node;
+    }
+  };
+  // The priority of a ready node only increases, when it becomes the last
+  // consumer of one of its inputs: the node is pushed again then, and the
+  // outdated entry is skipped.
+  std::priority_queue<ReadyNode> ready_nodes;
+  for (int i = 0; i < num_nodes; ++i) {
+    pending_fanins[i] = graph.fanins[i].size();
+    if (pending_fanins[i] == 0) {
+      ready_nodes.push({priority(i), tail[i], i});
+    }
+  }
+
+  schedule->clear();
+  schedule->reserve(num_nodes);
+  frees_memory->assign(num_nodes, false);
+  while (!ready_nodes.empty()) {
+    const ReadyNode ready_node = ready_nodes.top();
+    ready_nodes.pop();
+    const int node = ready_node.node;
+    if (scheduled[node] || ready_node.priority != priority(node)) {
+      continue;
+    }
+    scheduled[node] = true;
+    schedule->push_back(node);
+    for (int fanin : graph.data_fanins[node]) {
+      --remaining_consumers[fanin];
+      if (remaining_consumers[fanin] == 0) {
+        if (graph.output_bytes[fanin] > 0) {
+          (*frees_memory)[node] = true;
+        }
+      } else if (remaining_consumers[fanin] == 1) {
+        for (int consumer : graph.data_fanouts[fanin]) {
+          if (!scheduled[consumer] && pending_fanins[consumer] == 0) {
+            ready_nodes.push({priority(consumer), tail[consumer], consumer});
+          }
+        }
+      }
+    }
+    for (int fanout : graph.fanouts[node]) {
+      if (--pending_fanins[fanout] == 0) {
+        ready_nodes.push({priority(fanout), tail[fanout], fanout});
+      }
+    }
+  }
+}
+
+// Delays the start of `node` until `earliest_start`, and propagates the delay
+// to its transitive fanout. Returns false, and leaves the execution times
+// unchanged, if this makes the critical path longer than `max_critical_path`.
+bool DelayNode(int node, int64 earliest_start, int64 max_critical_path,
+               ScheduleGraph* graph, int64* critical_path) {
+  int64 new_critical_path = *critical_path;
+  std::vector<std::pair<int, int64>> previous_starts;
+  // Nodes are mostly processed in topological order.
+  std::set<int> delayed_nodes;
+  auto delay = [graph, &new_critical_path, &previous_starts, &delayed_nodes](
+                   int delayed_node, int64 start) {
+    if (start <= graph->start[delayed_node]) {
+      return;
+    }
+    previous_starts.emplace_back(delayed_node, graph->start[delayed_node]);
+    graph->start[delayed_node] = start;
+    graph->completion[delayed_node] = start + graph->duration[delayed_node];
+    new_critical_path =
+        std::max(new_critical_path, graph->completion[delayed_node]);
+    delayed_nodes.insert(delayed_node);
+  };
+  delay(node, earliest_start);
+  while (!delayed_nodes.empty() && new_critical_path <= max_critical_path) {
+    const int delayed_node = *delayed_nodes.begin();
+    delayed_nodes.erase(delayed_nodes.begin());
+    for (int fanout : graph->fanouts[delayed_node]) {
+      delay(fanout, graph->completion[delayed_node]);
+    }
+  }
+  if (new_critical_path > max_critical_path) {
+    for (auto it = previous_starts.rbegin(); it != previous_starts.rend();
+         ++it) {
+      graph->start[it->first] = it->second;
+      graph->completion[it->first] = it->second + graph->duration[it->first];
+    }
+    return false;
+  }
+  *critical_path = new_critical_path;
+  return true;
+}
+
+}  // namespace
+
+Status MemoryAwareScheduler::Optimize(Cluster* cluster,
+                                      const GrapplerItem& item,
+                                      GraphDef* optimized_graph) {
+  *optimized_graph = item.graph;
+  if (cluster == nullptr) {
+    VLOG(1) << "Can't estimate the memory usage without a cluster";
+    return Status::OK();
+  }
+  for (const NodeDef& node : item.graph.node()) {
+    if (IsMerge(node) || IsSwitch(node) || ModifiesFrameInfo(node)) {
+      // The execution order of loops and conditionals depends on the data.
+      VLOG(1) << "Not scheduling graph with control flow";
+      return Status::OK();
+    }
+  }
+
+  GrapplerItem scheduled_item(item, GraphDef(item.graph));
+  TF_RETURN_IF_ERROR(TopologicalSort(&scheduled_item.graph));
+  const std::unordered_map<string, DeviceProperties>& devices =
+      cluster->GetDevices();
+  GraphMemory memory(scheduled_item);
+  TF_RETURN_IF_ERROR(memory.InferStatically(devices));
+  const int64 peak_memory_before = memory.GetWorstCaseMemoryUsage();
+  if (peak_memory_before <= 0) {
+    VLOG(1) << "Peak memory usage unknown";
+    return Status::OK();
+  }
+  const GraphMemory::MemoryUsage* peak_usage = nullptr;
+  for (const auto& device : devices) {
+    const GraphMemory::MemoryUsage& usage =
+        memory.GetPeakMemoryUsage(device.first);
+    if (usage.used_memory == peak_memory_before) {
+      peak_usage = &usage;
+      break;
+    }
+  }
+  if (peak_usage == nullptr) {
+    return Status::OK();
+  }
+
+  ScheduleGraph graph;
+  TF_RETURN_IF_ERROR(BuildScheduleGraph(scheduled_item, cluster, &graph));
+  const int num_nodes = scheduled_item.graph.node_size();
+  std::unordered_map<string, int> node_index;
+  for (int i = 0; i < num_nodes; ++i) {
+    node_index[scheduled_item.graph.node(i).name()] = i;
+  }
+  std::vector<int> num_consumers(num_nodes);
+  for (int i = 0; i < num_nodes; ++i) {
+    num_consumers[i] = graph.data_fanouts[i].size();
+  }
+  for (const string& fetch : scheduled_item.fetch) {
+    auto it = node_index.find(NodeName(fetch));
+    if (it != node_index.end()) {
+      // The fetched tensors are never released.
+      ++num_consumers[it->second];
+    }
+  }
+  std::vector<int> schedule;
+  std::vector<bool> frees_memory;
+  ComputeMemoryMinimizingSchedule(graph, num_consumers, &schedule,
+                                  &frees_memory);
+  if (schedule.size() != static_cast<size_t>(num_nodes)) {
+    VLOG(1) << "Failed to schedule all the nodes of the graph";
+    return Status::OK();
+  }
+  // For every node, the last node scheduled before it that frees some memory.
+  std::vector<int> previous_release(num_nodes, -1);
+  int last_release = -1;
+  for (int node : schedule) {
+    previous_release[node] = last_release;
+    if (frees_memory[node]) {
+      last_release = node;
+    }
+  }
+
+  // Enforce the schedule for the ops that allocate the tensors live at the
+  // peak, starting with the largest ones: make each of them wait for the
+  // memory that the schedule releases before running them.
+  std::unordered_set<string> feeds;
+  for (const auto& feed : scheduled_item.feed) {
+    feeds.insert(NodeName(feed.first));
+  }
+  std::vector<int> peak_nodes;
+  std::unordered_set<int> seen_peak_nodes;
+  for (const auto& live_tensor : peak_usage->live_tensors) {
+    auto it = node_index.find(live_tensor.node);
+    if (it == node_index.end() || !seen_peak_nodes.insert(it->second).second) {
+      continue;
+    }
+    const NodeDef& node = scheduled_item.graph.node(it->second);
+    if (graph.fanins[it->second].empty() || IsPersistent(node) ||
+        feeds.count(node.name()) > 0) {
+      continue;
+    }
+    peak_nodes.push_back(it->second);
+  }
+  std::sort(peak_nodes.begin(), peak_nodes.end(),
+            [&graph](int first, int second) {
+              return graph.output_bytes[first] > graph.output_bytes[second] ||
+                     (graph.output_bytes[first] ==
+                          graph.output_bytes[second] &&
+                      first < second);
+            });
+
+  int64 initial_critical_path = 0;
+  for (int i = 0; i < num_nodes; ++i) {
+    initial_critical_path =
+        std::max(initial_critical_path, graph.completion[i]);
+  }
+  const int64 max_critical_path =
+      initial_critical_path *
+      (1.0 + std::max(0.0, static_cast<double>(max_critical_path_growth_)));
+  int64 critical_path = initial_critical_path;
+  int num_control_dependencies = 0;
+  for (int node : peak_nodes) {
+    const int release = previous_release[node];
+    if (release < 0 ||
+        std::find(graph.fanins[node].begin(), graph.fanins[node].end(),
+                  release) != graph.fanins[node].end()) {
+      continue;
+    }
+    NodeDef* node_def = scheduled_item.graph.mutable_node(node);
+    const NodeDef& release_def = scheduled_item.graph.node(release);
+    if (node_def->device() != release_def.device()) {
+      continue;
+    }
+    if (!DelayNode(node, graph.completion[release], max_critical_path, &graph,
+                   &critical_path)) {
+      VLOG(2) << "Running " << node_def->name() << " after "
+              << release_def.name() << " would lengthen the critical path";
+      continue;
+    }
+    VLOG(2) << "Running " << node_def->name() << " after "
+            << release_def.name();
+    node_def->add_input(AsControlDependency(release_def.name()));
+    graph.fanins[node].push_back(release);
+    graph.fanouts[release].push_back(node);
+    ++num_control_dependencies;
+  }
+  if (num_control_dependencies == 0) {
+    return Status::OK();
+  }
+
+  GraphMemory scheduled_memory(scheduled_item);
+  TF_RETURN_IF_ERROR(scheduled_memory.InferStatically(devices));
+  const int64 peak_memory_after = scheduled_memory.GetWorstCaseMemoryUsage();
+  if (peak_memory_after < 0 || peak_memory_after >= peak_memory_before) {
+    VLOG(1) << "Scheduling doesn't lower the predicted peak memory usage of "
+            << peak_memory_before << " bytes";
+    return Status::OK();
+  }
+  LOG(INFO) << "Adding " << num_control_dependencies
+            << " control dependencies lowers the predicted peak memory usage"
+            << " from " << peak_memory_before << " to " << peak_memory_after
+            << " bytes, and changes the critical path from "
+            << initial_critical_path << " to " << critical_path << " ns";
+  optimized_graph->Swap(&scheduled_item.graph);
+  return Status::OK();
+}
+
+void MemoryAwareScheduler::Feedback(Cluster* cluster, const GrapplerItem& item,
+                                    const GraphDef& optimized_graph,
+                                    double result) {
+  // Nothing to do for MemoryAwareScheduler.
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
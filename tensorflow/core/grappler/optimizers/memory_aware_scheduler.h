@@ -0,0 +1,51 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_MEMORY_AWARE_SCHEDULER_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_MEMORY_AWARE_SCHEDULER_H_
+
+#include "tensorflow/core/grappler/optimizers/graph_optimizer.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// Adds control dependencies to the graph to keep the executor from running
+// ops in an order that keeps many large tensors alive at the same time. The
+// optimizer computes a memory-minimizing schedule of the graph, and enforces
+// it for the ops that allocate the tensors live at the predicted memory peak,
+// as long as the critical path of the graph doesn't grow by more than
+// `max_critical_path_growth` (a fraction of its original length).
+class MemoryAwareScheduler : public GraphOptimizer {
+ public:
+  explicit MemoryAwareScheduler(float max_critical_path_growth = 0.0f)
+      : max_critical_path_growth_(max_critical_path_growth) {}
+  ~MemoryAwareScheduler() override {}
+
+  string name() const override { return "memory_aware_scheduler"; };
+
+  Status Optimize(Cluster* cluster, const GrapplerItem& item,
+                  GraphDef* optimized_graph) override;
+
+  void Feedback(Cluster* cluster, const GrapplerItem& item,
+                const GraphDef& optimized_graph, double result) override;
+
+ private:
+  float max_critical_path_growth_;
+};
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_MEMORY_AWARE_SCHEDULER_H_
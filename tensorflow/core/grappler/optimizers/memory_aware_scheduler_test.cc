@@ -0,0 +1,132 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/memory_aware_scheduler.h"
+
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/clusters/virtual_cluster.h"
+#include "tensorflow/core/grappler/costs/graph_memory.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/grappler/utils/grappler_test.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+class MemoryAwareSchedulerTest : public GrapplerTest {
+ protected:
+  void SetUp() override {
+    // Invent a CPU so that predictions remain the same from machine to machine.
+    DeviceProperties cpu_device;
+    cpu_device.set_type("CPU");
+    cpu_device.set_frequency(1000);
+    cpu_device.set_num_cores(4);
+    cpu_device.set_bandwidth(32);
+    cpu_device.set_memory_size(64 * 1024 * 1024);
+    std::unordered_map<string, DeviceProperties> devices;
+    devices["/job:localhost/replica:0/task:0/cpu:0"] = cpu_device;
+    cluster_.reset(new VirtualCluster(devices));
+    TF_CHECK_OK(cluster_->Provision());
+  }
+
+  // Builds two independent branches which each allocate large intermediate
+  // tensors and reduce them to a scalar.
+  GrapplerItem CreateTwoBranchItem() const {
+    tensorflow::Scope s =
+        tensorflow::Scope::NewRootScope().WithDevice("/cpu:0");
+    Output shape = ops::Const(s.WithOpName("shape"), {512, 512}, {2});
+    Output value = ops::Const(s.WithOpName("value"), 0.5f, {});
+    Output axes = ops::Const(s.WithOpName("axes"), {0, 1}, {2});
+    Output a1 = ops::Fill(s.WithOpName("a1"), shape, value);
+    Output a2 = ops::Square(s.WithOpName("a2"), a1);
+    Output a3 = ops::Sum(s.WithOpName("a3"), a2, axes);
+    Output b1 = ops::Fill(s.WithOpName("b1"), shape, value);
+    Output b2 = ops::Sqrt(s.WithOpName("b2"), b1);
+    Output b3 = ops::Sum(s.WithOpName("b3"), b2, axes);
+    Output c = ops::Add(s.WithOpName("c"), a3, b3);
+
+    GrapplerItem item;
+    TF_CHECK_OK(s.ToGraphDef(&item.graph));
+    item.fetch = {"c"};
+    return item;
+  }
+
+  int64 PeakMemoryUsage(const GrapplerItem& item) const {
+    GraphMemory memory(item);
+    TF_CHECK_OK(memory.InferStatically(cluster_->GetDevices()));
+    return memory.GetWorstCaseMemoryUsage();
+  }
+
+  std::unique_ptr<VirtualCluster> cluster_;
+};
+
+TEST_F(MemoryAwareSchedulerTest, SerializesIndependentBranches) {
+  GrapplerItem item = CreateTwoBranchItem();
+
+  MemoryAwareScheduler optimizer(/*max_critical_path_growth=*/1.0f);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(cluster_.get(), item, &output));
+
+  // One branch has to wait for the other to be reduced.
+  EXPECT_EQ(item.graph.node_size(), output.node_size());
+  NodeMap node_map(&output);
+  const NodeDef* a1 = node_map.GetNode("a1");
+  const NodeDef* b1 = node_map.GetNode("b1");
+  ASSERT_NE(nullptr, a1);
+  ASSERT_NE(nullptr, b1);
+  if (b1->input_size() == 3) {
+    EXPECT_EQ("^a3", b1->input(2));
+    EXPECT_EQ(2, a1->input_size());
+  } else {
+    ASSERT_EQ(3, a1->input_size());
+    EXPECT_EQ("^b3", a1->input(2));
+  }
+
+  GrapplerItem scheduled(item, std::move(output));
+  EXPECT_GT(PeakMemoryUsage(item), PeakMemoryUsage(scheduled));
+
+  auto tensors_expected = EvaluateFetchNodes(item);
+  auto tensors = EvaluateFetchNodes(scheduled);
+  ASSERT_EQ(1, tensors.size());
+  test::ExpectTensorNear<float>(tensors_expected[0], tensors[0], 1e-6);
+}
+
+TEST_F(MemoryAwareSchedulerTest, KeepsCriticalPath) {
+  GrapplerItem item = CreateTwoBranchItem();
+
+  // Running the branches one after the other would make the critical path
+  // longer.
+  MemoryAwareScheduler optimizer(/*max_critical_path_growth=*/0.0f);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(cluster_.get(), item, &output));
+  CompareGraphs(item.graph, output);
+}
+
+TEST_F(MemoryAwareSchedulerTest, NoCluster) {
+  GrapplerItem item = CreateTwoBranchItem();
+
+  MemoryAwareScheduler optimizer(/*max_critical_path_growth=*/1.0f);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+  CompareGraphs(item.graph, output);
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
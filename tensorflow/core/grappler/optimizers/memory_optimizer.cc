@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/core/grappler/optimizers/memory_optimizer.h"
 
 #include <algorithm>
+#include <map>
 #include <queue>
 #include <unordered_map>
 #include <unordered_set>
@@ -28,6 +29,8 @@ limitations under the License.
 #include "tensorflow/core/grappler/clusters/virtual_cluster.h"
 #include "tensorflow/core/grappler/costs/graph_memory.h"
 #include "tensorflow/core/grappler/costs/graph_properties.h"
+#include "tensorflow/core/grappler/costs/op_level_cost_estimator.h"
+#include "tensorflow/core/grappler/costs/utils.h"
 #include "tensorflow/core/grappler/graph_view.h"
 #include "tensorflow/core/grappler/grappler_item.h"
 #include "tensorflow/core/grappler/op_types.h"
@@ -413,6 +416,17 @@ void RecomputeSubgraph(
   }
 }
 
+// Nodes whose inputs we may want to recompute. This matches node names that
+// contain recomputation_targets_name_scope as a name scope, meaning it either
+// begins with or contains the name scope. Defaults to "gradients/" which will
+// match any node names that begins with "gradients/" or contains
+// "/gradients/".
+bool IsRecomputationTarget(const NodeDef& node,
+                           const string& recomputation_targets_name_scope) {
+  return node.name().find(recomputation_targets_name_scope) == 0 ||
+         node.name().find("/" + recomputation_targets_name_scope) != -1;
+}
+
 void RecomputationRewritingPass(RewriterConfig::MemOptType optimization_level,
                                 const string& recomputation_targets_name_scope,
                                 GraphDef* graph, const GrapplerItem& item) {
@@ -440,13 +454,7 @@ void RecomputationRewritingPass(RewriterConfig::MemOptType optimization_level,
   }
   std::function<bool(const NodeDef&)> is_target =
       [&recomputation_targets_name_scope](const NodeDef& node) {
-        // Nodes whose inputs we may want to recompute. This matches node names
-        // that contain recomputation_targets_name_scope as a name scope,
-        // meaning it either begins with or contains the name scope.
-        // Defaults to "gradients/" which will match any node names that begins
-        // with "gradients/" or contains "/gradients/".
-        return node.name().find(recomputation_targets_name_scope) == 0 ||
-               node.name().find("/" + recomputation_targets_name_scope) != -1;
+        return IsRecomputationTarget(node, recomputation_targets_name_scope);
       };
 
   if (optimization_level == RewriterConfig::RECOMPUTATION_HEURISTICS ||
@@ -1222,6 +1230,388 @@ bool SwappingPass(RewriterConfig::MemOptType optimization_level,
   return updated_graph;
 }
 
+// A forward op whose outputs are kept alive across the memory peak for the
+// backward pass, and the estimated cost of recomputing them there instead.
+struct RematerializationCandidate {
+  const NodeDef* node;
+  // Net number of bytes freed at the peak: the outputs of the node, minus the
+  // inputs that would have to be kept alive to recompute it.
+  int64 bytes_freed;
+  Costs::Duration recompute_time;
+  // Number of operations (e.g. FLOPs) executed by the recomputation.
+  double recompute_ops;
+};
+
+// Start and completion times of an op in a simulated step.
+struct OpExecutionTimes {
+  Costs::Duration start;
+  Costs::Duration completion;
+};
+
+// Simulates the execution of `item` with the virtual scheduler to estimate the
+// start and completion times of its ops.
+static Status EstimateOpExecutionTimes(
+    Cluster* cluster, const GrapplerItem& item,
+    std::unordered_map<string, OpExecutionTimes>* op_times) {
+  VirtualCluster vcluster(cluster->GetDevices());
+  TF_RETURN_IF_ERROR(vcluster.Provision());
+  TF_RETURN_IF_ERROR(vcluster.Initialize(item));
+  RunMetadata metadata;
+  Status s = vcluster.Run(item.graph, item.feed, item.fetch, &metadata);
+  if (!s.ok() && s.code() != error::RESOURCE_EXHAUSTED) {
+    return s;
+  }
+  for (const auto& dev_stats : metadata.step_stats().dev_stats()) {
+    for (const auto& node_stats : dev_stats.node_stats()) {
+      OpExecutionTimes times;
+      times.start = Costs::MicroSeconds(node_stats.all_start_micros());
+      times.completion =
+          Costs::NanoSeconds(1) +
+          Costs::MicroSeconds(node_stats.all_start_micros() +
+                              node_stats.op_end_rel_micros());
+      op_times->emplace(node_stats.node_name(), times);
+    }
+  }
+  return Status::OK();
+}
+
+// Selects the forward ops live at the memory peak described by `mem_usage`
+// which are the cheapest to recompute per byte freed, until at least
+// `required_savings` bytes are freed.
+static std::vector<RematerializationCandidate>
+SelectRematerializationCandidates(
+    const GraphMemory::MemoryUsage& mem_usage, const string& device_name,
+    const DeviceProperties& device, int64 required_savings,
+    const std::unordered_map<string, OpExecutionTimes>& op_times,
+    const NodeMap& node_map,
+    const std::unordered_map<string, const NodeDef*>& name_to_node,
+    const GraphProperties& properties, const OpLevelCostEstimator& estimator,
+    const std::function<bool(const NodeDef&)>& is_candidate,
+    const std::function<bool(const NodeDef&)>& is_target) {
+  Costs::Duration peak_time = -1;
+  for (const auto& live_tensor : mem_usage.live_tensors) {
+    if (live_tensor.allocation_time > peak_time) {
+      peak_time = live_tensor.allocation_time;
+    }
+  }
+  std::unordered_set<string> live_at_peak;
+  std::unordered_map<const NodeDef*, int64> live_bytes;
+  for (const auto& live_tensor : mem_usage.live_tensors) {
+    live_at_peak.insert(
+        strings::StrCat(live_tensor.node, ":", live_tensor.output_id));
+    const NodeDef* node = node_map.GetNode(live_tensor.node);
+    // Skip nodes inserted by TF (e.g _Send/_Recv nodes) or by the virtual
+    // scheduler.
+    if (node != nullptr) {
+      live_bytes[node] += live_tensor.memory_used;
+    }
+  }
+
+  const OpLevelCostEstimator::DeviceInfo device_info =
+      estimator.GetDeviceInfo(device);
+  std::vector<RematerializationCandidate> candidates;
+  for (const auto& live : live_bytes) {
+    const NodeDef* node = live.first;
+    if (!is_candidate(*node)) {
+      continue;
+    }
+    // Only outputs that are held across the peak for the backward pass are
+    // worth recomputing: the forward consumers must be done by the time of
+    // the peak, and the backward consumers must only start after it.
+    bool has_target_output = false;
+    bool held_across_peak = true;
+    for (const NodeDef* output : node_map.GetOutputs(node->name())) {
+      auto it = op_times.find(output->name());
+      if (it == op_times.end()) {
+        held_across_peak = false;
+        break;
+      }
+      if (is_target(*output)) {
+        has_target_output = true;
+        held_across_peak &= it->second.start > peak_time;
+      } else {
+        held_across_peak &= it->second.completion <= peak_time;
+      }
+    }
+    if (!has_target_output || !held_across_peak) {
+      continue;
+    }
+    // Nodes which depend on the backward pass can't be recomputed.
+    bool has_target_input = false;
+    int64 bytes_to_keep = 0;
+    const std::vector<OpInfo::TensorProperties>& input_props =
+        properties.GetInputProperties(node->name());
+    for (int i = 0; i < node->input_size(); ++i) {
+      int position;
+      const string input_name = ParseNodeName(node->input(i), &position);
+      const NodeDef* input_node = node_map.GetNode(input_name);
+      if (input_node == nullptr || is_target(*input_node)) {
+        has_target_input = true;
+        break;
+      }
+      // Inputs that are already live at the peak don't cost anything extra;
+      // the others now have to stay alive until the recomputation.
+      if (position >= 0 && i < static_cast<int>(input_props.size()) &&
+          live_at_peak.count(strings::StrCat(input_name, ":", position)) ==
+              0) {
+        bytes_to_keep += EstimateSize(input_props[i]);
+      }
+    }
+    if (has_target_input || live.second <= bytes_to_keep) {
+      continue;
+    }
+
+    OpContext op_context;
+    op_context.name = node->name();
+    op_context.device_name = device_name;
+    op_context.op_info =
+        BuildOpInfoWithoutDevice(*node, name_to_node, input_props);
+    *op_context.op_info.mutable_device() = device;
+    for (const auto& output : properties.GetOutputProperties(node->name())) {
+      *op_context.op_info.add_outputs() = output;
+    }
+    const Costs costs = estimator.PredictCosts(op_context);
+    if (costs.inaccurate) {
+      // We can't tell whether this op is cheap to recompute.
+      VLOG(2) << "Unknown recomputation cost for " << node->name();
+      continue;
+    }
+    RematerializationCandidate candidate;
+    candidate.node = node;
+    candidate.bytes_freed = live.second - bytes_to_keep;
+    candidate.recompute_time = costs.execution_time;
+    candidate.recompute_ops = costs.compute_time.count() * device_info.gigaops;
+    candidates.push_back(candidate);
+  }
+
+  // Rank the candidates by recomputation time per byte freed. Compare the
+  // cross products to avoid divisions, and break ties on the node names to
+  // ensure a consistent ordering.
+  std::sort(candidates.begin(), candidates.end(),
+            [](const RematerializationCandidate& first,
+               const RematerializationCandidate& second) {
+              const double first_cost =
+                  first.recompute_time.count() *
+                  static_cast<double>(second.bytes_freed);
+              const double second_cost =
+                  second.recompute_time.count() *
+                  static_cast<double>(first.bytes_freed);
+              return first_cost < second_cost ||
+                     (first_cost == second_cost &&
+                      first.node->name() < second.node->name());
+            });
+  std::vector<RematerializationCandidate> selected;
+  for (const RematerializationCandidate& candidate : candidates) {
+    if (required_savings <= 0) {
+      break;
+    }
+    selected.push_back(candidate);
+    required_savings -= candidate.bytes_freed;
+  }
+  return selected;
+}
+
+// Recomputes the forward ops selected by the cost model until the predicted
+// peak memory usage of every device fits within `memory_budget_bytes` (or
+// within the memory size of the device if no budget is specified). Each round
+// simulates the graph with the virtual scheduler to find the ops that are live
+// at the memory peak, and the rewrite of a round is rolled back if it doesn't
+// lower the predicted peak memory usage.
+bool CostModelRecomputationPass(RewriterConfig::MemOptType optimization_level,
+                                const string& recomputation_targets_name_scope,
+                                int64 memory_budget_bytes, Cluster* cluster,
+                                GrapplerItem* item) {
+  if (optimization_level != RewriterConfig::RECOMPUTATION_COST_MODEL) {
+    // Nothing to do
+    return false;
+  }
+  const std::unordered_map<string, DeviceProperties>& devices =
+      cluster->GetDevices();
+  // Do not recompute nodes which are fed, since the recomputed node would not
+  // take on the fed value (i.e. gradients would be incorrect).
+  std::unordered_set<string> feeds;
+  for (const auto& feed : item->feed) {
+    feeds.insert(NodeName(feed.first));
+  }
+  const string recomputed_prefix = strings::StrCat(kRecomputedNodePrefix, "/");
+  std::function<bool(const NodeDef&)> is_target =
+      [&recomputation_targets_name_scope](const NodeDef& node) {
+        return IsRecomputationTarget(node, recomputation_targets_name_scope);
+      };
+  std::function<bool(const NodeDef&)> is_candidate =
+      [&feeds, &recomputed_prefix, &is_target](const NodeDef& node) {
+        return !is_target(node) && feeds.count(node.name()) == 0 &&
+               node.name().compare(0, recomputed_prefix.size(),
+                                   recomputed_prefix) != 0 &&
+               NumNonControlInputs(node) > 0 && IsFreeOfSideEffect(node) &&
+               !IsPersistent(node) && !IsMerge(node) && !IsSwitch(node) &&
+               !ModifiesFrameInfo(node);
+      };
+
+  struct DeviceReport {
+    int64 initial_peak = -1;
+    int64 final_peak = -1;
+    int num_recomputed = 0;
+    double recompute_ops = 0;
+    // Statistics of the last round, which only count once the round is known
+    // to lower the peak memory usage.
+    int pending_num_recomputed = 0;
+    double pending_recompute_ops = 0;
+  };
+  std::map<string, DeviceReport> reports;
+  OpLevelCostEstimator estimator;
+  GraphDef previous_graph;
+  bool updated_graph = false;
+  // Bound the number of simulations to avoid long processing times on graphs
+  // that simply won't fit in memory.
+  const int kMaxRounds = 10;
+  for (int round = 0;; ++round) {
+    // The recomputation helpers rely on a topological numbering of the nodes.
+    // This invalidates all NodeDef pointers, so it needs to be done before we
+    // start collecting those.
+    if (!TopologicalSort(&item->graph).ok()) {
+      break;
+    }
+    GraphMemory memory(*item);
+    Status s = memory.InferStatically(devices);
+    if (!s.ok()) {
+      VLOG(1) << "Failed to infer memory usage: " << s.error_message();
+      break;
+    }
+    if (round > 0) {
+      bool improved = false;
+      for (auto& report : reports) {
+        DeviceReport& device_report = report.second;
+        if (device_report.pending_num_recomputed > 0 &&
+            memory.GetPeakMemoryUsage(report.first).used_memory <
+                device_report.final_peak) {
+          improved = true;
+        }
+      }
+      if (!improved) {
+        VLOG(1) << "Recomputation didn't lower the peak memory usage, "
+                   "reverting the last round";
+        item->graph.Swap(&previous_graph);
+        break;
+      }
+      updated_graph = true;
+      for (auto& report : reports) {
+        DeviceReport& device_report = report.second;
+        device_report.final_peak =
+            memory.GetPeakMemoryUsage(report.first).used_memory;
+        device_report.num_recomputed += device_report.pending_num_recomputed;
+        device_report.recompute_ops += device_report.pending_recompute_ops;
+        device_report.pending_num_recomputed = 0;
+        device_report.pending_recompute_ops = 0;
+      }
+    }
+    if (round == kMaxRounds) {
+      break;
+    }
+
+    std::unordered_map<string, OpExecutionTimes> op_times;
+    if (!EstimateOpExecutionTimes(cluster, *item, &op_times).ok()) {
+      break;
+    }
+    GraphProperties properties(*item);
+    if (!properties.InferStatically(false).ok()) {
+      break;
+    }
+    NodeMap node_map(&item->graph);
+    std::unordered_map<string, const NodeDef*> name_to_node;
+    for (const auto& node : item->graph.node()) {
+      name_to_node[node.name()] = &node;
+    }
+    std::unordered_set<const NodeDef*> recomputed_nodes;
+    for (const auto& device : devices) {
+      const string& name = device.first;
+      const GraphMemory::MemoryUsage& mem_usage =
+          memory.GetPeakMemoryUsage(name);
+      if (mem_usage.used_memory < 0) {
+        VLOG(1) << "Peak memory usage unknown for device " << name;
+        continue;
+      }
+      DeviceReport& report = reports[name];
+      if (round == 0) {
+        report.initial_peak = mem_usage.used_memory;
+        report.final_peak = mem_usage.used_memory;
+      }
+      const int64 budget = memory_budget_bytes > 0
+                               ? memory_budget_bytes
+                               : device.second.memory_size();
+      if (budget <= 0 || mem_usage.used_memory <= budget) {
+        continue;
+      }
+      for (const RematerializationCandidate& candidate :
+           SelectRematerializationCandidates(
+               mem_usage, name, device.second, mem_usage.used_memory - budget,
+               op_times, node_map, name_to_node, properties, estimator,
+               is_candidate, is_target)) {
+        VLOG(1) << "Will recompute " << candidate.node->name() << " to free "
+                << candidate.bytes_freed << " bytes on " << name << " for "
+                << candidate.recompute_ops << " extra operations";
+        recomputed_nodes.insert(candidate.node);
+        ++report.pending_num_recomputed;
+        report.pending_recompute_ops += candidate.recompute_ops;
+      }
+    }
+    if (recomputed_nodes.empty()) {
+      break;
+    }
+
+    previous_graph = item->graph;
+    std::unordered_map<const NodeDef*, int> topological_numbering;
+    for (int node_number = 0; node_number < item->graph.node_size();
+         ++node_number) {
+      topological_numbering[item->graph.mutable_node(node_number)] =
+          item->graph.node_size() - node_number - 1;
+    }
+    // Recompute connected groups of selected nodes together, so that the
+    // recomputed nodes feed each other instead of keeping the originals alive.
+    std::unordered_set<const NodeDef*> visited_nodes;
+    for (const NodeDef* recomputed_node : recomputed_nodes) {
+      if (visited_nodes.count(recomputed_node) > 0) {
+        continue;
+      }
+      RecomputedSubGraph subgraph;
+      subgraph.recomputed_source_nodes.insert(recomputed_node);
+      connected_subgraph(node_map,
+                         true,  // Collect inputs
+                         true,  // Collect outputs
+                         [&recomputed_nodes](const NodeDef& node) {
+                           return recomputed_nodes.count(&node) != 0;
+                         },
+                         &subgraph.recomputed_source_nodes);
+      visited_nodes.insert(subgraph.recomputed_source_nodes.begin(),
+                           subgraph.recomputed_source_nodes.end());
+      for (const NodeDef* node : subgraph.recomputed_source_nodes) {
+        for (NodeDef* output : node_map.GetOutputs(node->name())) {
+          if (is_target(*output)) {
+            subgraph.target_nodes.insert(output);
+          }
+        }
+      }
+      RecomputeSubgraph(subgraph.recomputed_source_nodes, subgraph.target_nodes,
+                        node_map, topological_numbering, &item->graph);
+    }
+  }
+
+  for (const auto& report : reports) {
+    const DeviceReport& device_report = report.second;
+    if (device_report.num_recomputed == 0) {
+      continue;
+    }
+    LOG(INFO) << "Recomputing " << device_report.num_recomputed
+              << " ops lowers the predicted peak memory usage of "
+              << report.first << " from " << device_report.initial_peak
+              << " to " << device_report.final_peak << " bytes ("
+              << device_report.initial_peak - device_report.final_peak
+              << " bytes saved) for " << device_report.recompute_ops
+              << " extra operations per step";
+  }
+  return updated_graph;
+}
+
 // TODO(rmlarsen): Add distributed TF test.
 Status RelaxAllocatorConstraints(GraphDef* optimized_graph) {
   std::unordered_set<string> devices;
@@ -1305,6 +1695,12 @@ Status MemoryOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
                              item);
 
   GrapplerItem optimized_item(item, optimized_graph);
+  if (cluster != nullptr) {
+    CostModelRecomputationPass(optimization_level_,
+                               recomputation_targets_name_scope_,
+                               memory_budget_bytes_, cluster, &optimized_item);
+  }
+
   std::unordered_set<string> skip_list;
   // Bound the number of rewrite passes to avoid long processing times on graphs
   // that simply won't fit in memory.
@@ -0,0 +1,137 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/memory_optimizer.h"
+
+#include <memory>
+#include <unordered_map>
+
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/clusters/virtual_cluster.h"
+#include "tensorflow/core/grappler/costs/graph_memory.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/grappler/utils/grappler_test.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+// Tests of the RECOMPUTATION_COST_MODEL rewrite, which only needs CPU
+// devices, unlike the swapping tests in memory_optimizer_test.cc.
+class RecomputationCostModelTest : public GrapplerTest {
+ public:
+  static std::unique_ptr<VirtualCluster> CreateVirtualCluster() {
+    DeviceProperties cpu_device;
+    cpu_device.set_type("CPU");
+    cpu_device.set_frequency(1000);
+    cpu_device.set_num_cores(4);
+    cpu_device.set_bandwidth(32);
+    cpu_device.set_memory_size(1024 * 1024);
+    std::unordered_map<string, DeviceProperties> devices;
+    devices["/job:localhost/replica:0/task:0/cpu:0"] = cpu_device;
+    return std::unique_ptr<VirtualCluster>(new VirtualCluster(devices));
+  }
+};
+
+// Builds a forward chain of activations which are all held for the backward
+// pass.
+GrapplerItem CreateRecomputationCostModelItem() {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output x = ops::Placeholder(s.WithOpName("x").WithDevice("/cpu:0"), DT_FLOAT,
+                              ops::Placeholder::Shape({128, 256}));
+  Output a = ops::Sigmoid(s.WithOpName("a").WithDevice("/cpu:0"), x);
+  Output b = ops::Square(s.WithOpName("b").WithDevice("/cpu:0"), a);
+  Output c = ops::Square(s.WithOpName("c").WithDevice("/cpu:0"), b);
+  Output d = ops::Square(s.WithOpName("d").WithDevice("/cpu:0"), c);
+  Output grad_c =
+      ops::Mul(s.WithOpName("gradients/c_grad").WithDevice("/cpu:0"), d, c);
+  Output grad_b = ops::Mul(
+      s.WithOpName("gradients/b_grad").WithDevice("/cpu:0"), grad_c, b);
+  Output grad_a = ops::Mul(
+      s.WithOpName("gradients/a_grad").WithDevice("/cpu:0"), grad_b, a);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch = {"gradients/a_grad"};
+  return item;
+}
+
+TEST_F(RecomputationCostModelTest, RecomputesActivations) {
+  GrapplerItem item = CreateRecomputationCostModelItem();
+  Tensor x = GenerateRandomTensor<DT_FLOAT>(TensorShape({128, 256}));
+  item.feed.emplace_back("x", x);
+
+  std::unique_ptr<VirtualCluster> cluster(CreateVirtualCluster());
+  const string cpu = "/job:localhost/replica:0/task:0/cpu:0";
+  GraphMemory memory(item);
+  TF_ASSERT_OK(memory.InferStatically(cluster->GetDevices()));
+  const int64 peak = memory.GetPeakMemoryUsage(cpu).used_memory;
+  ASSERT_GT(peak, 0);
+
+  // Ask for the smallest possible savings.
+  MemoryOptimizer optimizer(RewriterConfig::RECOMPUTATION_COST_MODEL,
+                            "gradients/", peak - 1);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(cluster.get(), item, &output));
+
+  int num_recomputed = 0;
+  NodeMap node_map(&output);
+  for (const NodeDef& node : output.node()) {
+    if (str_util::StartsWith(node.name(), "Recomputed/")) {
+      ++num_recomputed;
+      // Recomputed ops only feed the backward pass.
+      for (const NodeDef* fanout : node_map.GetOutputs(node.name())) {
+        EXPECT_TRUE(str_util::StartsWith(fanout->name(), "gradients/") ||
+                    str_util::StartsWith(fanout->name(), "Recomputed/"));
+      }
+    }
+  }
+  EXPECT_LE(1, num_recomputed);
+  EXPECT_EQ(nullptr, node_map.GetNode("Recomputed/x"));
+  EXPECT_EQ(nullptr, node_map.GetNode("Recomputed/gradients/c_grad"));
+
+  GrapplerItem optimized(item, std::move(output));
+  GraphMemory optimized_memory(optimized);
+  TF_ASSERT_OK(optimized_memory.InferStatically(cluster->GetDevices()));
+  EXPECT_GT(peak, optimized_memory.GetPeakMemoryUsage(cpu).used_memory);
+
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch, item.feed);
+  auto tensors = EvaluateNodes(optimized.graph, item.fetch, item.feed);
+  ASSERT_EQ(1, tensors.size());
+  test::ExpectTensorNear<float>(tensors_expected[0], tensors[0], 1e-6);
+}
+
+TEST_F(RecomputationCostModelTest, WithinBudget) {
+  GrapplerItem item = CreateRecomputationCostModelItem();
+
+  std::unique_ptr<VirtualCluster> cluster(CreateVirtualCluster());
+  MemoryOptimizer optimizer(RewriterConfig::RECOMPUTATION_COST_MODEL,
+                            "gradients/", 64 * 1024 * 1024);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(cluster.get(), item, &output));
+  EXPECT_EQ(item.graph.node_size(), output.node_size());
+  for (const NodeDef& node : output.node()) {
+    EXPECT_FALSE(str_util::StartsWith(node.name(), "Recomputed"));
+  }
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
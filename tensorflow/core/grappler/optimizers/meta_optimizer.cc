@@ -26,15 +26,20 @@ limitations under the License.
 #include "tensorflow/core/grappler/optimizers/function_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/layout_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/loop_optimizer.h"
+#include "tensorflow/core/grappler/optimizers/memory_aware_scheduler.h"
 #include "tensorflow/core/grappler/optimizers/memory_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/model_pruner.h"
+#include "tensorflow/core/grappler/optimizers/optimized_graph_cache.h"
 #include "tensorflow/core/grappler/optimizers/remapper.h"
 #include "tensorflow/core/grappler/optimizers/scoped_allocator_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/shape_optimizer.h"
 #include "tensorflow/core/grappler/utils/colocation.h"
 #include "tensorflow/core/grappler/utils/functions.h"
 #include "tensorflow/core/grappler/utils/topological_sort.h"
+#include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
 
 namespace tensorflow {
 namespace grappler {
@@ -85,6 +90,9 @@ std::unique_ptr<GraphOptimizer> MetaOptimizer::MakeNewOptimizer(
   MK_OPT("remap", new Remapper(cfg_.remapping()));
   MK_OPT("layout", new LayoutOptimizer());
   MK_OPT("memory", new MemoryOptimizer(RewriterConfig::MANUAL));
+  MK_OPT("memory_scheduling",
+         new MemoryAwareScheduler(
+             cfg_.memory_aware_scheduling_max_critical_path_growth()));
   MK_OPT("arithmetic", new ArithmeticOptimizer(cfg_.arithmetic_optimization()));
   MK_OPT("autoparallel", new AutoParallel(cfg_.auto_parallel().num_replicas()));
   MK_OPT("loop", new LoopOptimizer(cfg_.loop_optimization()));
@@ -139,17 +147,23 @@ Status MetaOptimizer::InitializeOptimizers(
     if (cfg_.memory_optimizer_target_node_name_scope().empty()) {
       optimizers->emplace_back(
           // Use the default target node name prefix "gradients/"
-          new MemoryOptimizer(cfg_.memory_optimization()));
+          new MemoryOptimizer(cfg_.memory_optimization(), "gradients/",
+                              cfg_.memory_optimizer_budget_bytes()));
     } else {
       optimizers->emplace_back(
           new MemoryOptimizer(cfg_.memory_optimization(),
-                              cfg_.memory_optimizer_target_node_name_scope()));
+                              cfg_.memory_optimizer_target_node_name_scope(),
+                              cfg_.memory_optimizer_budget_bytes()));
     }
   }
   if (cfg_.auto_parallel().enable()) {
     optimizers->emplace_back(
         new AutoParallel(cfg_.auto_parallel().num_replicas()));
   }
+  if (cfg_.memory_aware_scheduling() == RewriterConfig::ON) {
+    optimizers->emplace_back(new MemoryAwareScheduler(
+        cfg_.memory_aware_scheduling_max_critical_path_growth()));
+  }
   if (cfg_.scoped_allocator_optimization()) {
     optimizers->emplace_back(new ScopedAllocatorOptimizer(
         cfg_.scoped_allocator_optimization(), cfg_.scoped_allocator_opts()));
@@ -230,6 +244,7 @@ Status MetaOptimizer::OptimizeGraph(Cluster* cluster, const GrapplerItem& item,
   bool is_optimized = false;
   GraphOptimizationResult optimization_result(item.id);
   GraphOptimizer* fusion_optimizer = nullptr;
+  GraphOptimizer* ms_optimizer = nullptr;
   GraphOptimizer* sa_optimizer = nullptr;
 
   for (int iteration = 0; iteration < NumIterations(cfg_); ++iteration) {
@@ -254,6 +269,10 @@ Status MetaOptimizer::OptimizeGraph(Cluster* cluster, const GrapplerItem& item,
         if (fusion_optimizer == nullptr) fusion_optimizer = optimizer.get();
         continue;
       }
+      if (optimizer->name() == "memory_aware_scheduler") {
+        if (ms_optimizer == nullptr) ms_optimizer = optimizer.get();
+        continue;
+      }
       Status status = RunOptimizer(optimizer.get(), cluster, &optimized_item,
                                    optimized_graph, &optimization_result);
       if (status.ok()) is_optimized = true;
@@ -272,6 +291,14 @@ Status MetaOptimizer::OptimizeGraph(Cluster* cluster, const GrapplerItem& item,
     if (status.ok()) is_optimized = true;
   }
 
+  // MemoryAwareScheduler orders the ops of the final graph, so it runs after
+  // all the optimizers that rewrite it.
+  if (ms_optimizer != nullptr) {
+    Status status = RunOptimizer(ms_optimizer, cluster, &optimized_item,
+                                 optimized_graph, &optimization_result);
+    if (status.ok()) is_optimized = true;
+  }
+
   // ScopedAllocatorOptimizer must run last.
   if (sa_optimizer != nullptr) {
     Status status = RunOptimizer(sa_optimizer, cluster, &optimized_item,
@@ -325,7 +352,56 @@ Status MetaOptimizer::RunOptimizer(
 Status MetaOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
                                GraphDef* optimized_graph) {
   optimization_results_.clear();
+  if (cfg_.optimized_graph_cache_dir().empty()) {
+    return OptimizeGraphAndFunctionLibrary(cluster, item, optimized_graph);
+  }
+
+  const OptimizedGraphCache cache(cfg_.optimized_graph_cache_dir());
+  const Fprint128 key = OptimizedGraphCache::Fingerprint(item, cluster, cfg_);
+  GraphOptimizationResult cache_result(item.id);
+  const uint64 start_us = Env::Default()->NowMicros();
+
+  uint64 cached_optimization_time_us = 0;
+  Status status =
+      cache.Lookup(key, optimized_graph, &cached_optimization_time_us);
+  if (status.ok()) {
+    const uint64 lookup_time_us = Env::Default()->NowMicros() - start_us;
+    const uint64 saved_time_us =
+        cached_optimization_time_us > lookup_time_us
+            ? cached_optimization_time_us - lookup_time_us
+            : 0;
+    VLOG(1) << "Loaded optimized graph of " << item.id << " from the cache in "
+            << lookup_time_us << " us";
+    cache_result.results.push_back(
+        {"optimized_graph_cache",
+         strings::StrCat("hit, loaded in ", lookup_time_us / 1000.0,
+                         " ms, saved ", saved_time_us / 1000.0, " ms")});
+    optimization_results_.push_back(cache_result);
+    return Status::OK();
+  }
+  if (!errors::IsNotFound(status)) {
+    LOG(WARNING) << "Ignoring optimized graph cache entry: " << status;
+  }
+
+  TF_RETURN_IF_ERROR(
+      OptimizeGraphAndFunctionLibrary(cluster, item, optimized_graph));
+  const uint64 optimization_time_us = Env::Default()->NowMicros() - start_us;
+  VLOG(1) << "Caching optimized graph of " << item.id << ", optimized in "
+          << optimization_time_us << " us";
+  status = cache.Insert(key, *optimized_graph, optimization_time_us);
+  if (!status.ok()) {
+    LOG(WARNING) << "Failed to cache the optimized graph: " << status;
+  }
+  cache_result.results.push_back(
+      {"optimized_graph_cache",
+       strings::StrCat("miss, optimized in ", optimization_time_us / 1000.0,
+                       " ms", status.ok() ? "" : ", not cached")});
+  optimization_results_.push_back(cache_result);
+  return Status::OK();
+}
 
+Status MetaOptimizer::OptimizeGraphAndFunctionLibrary(
+    Cluster* cluster, const GrapplerItem& item, GraphDef* optimized_graph) {
   // 1. Optimize main graph
   TF_RETURN_IF_ERROR(OptimizeGraph(cluster, item, optimized_graph));
 
@@ -423,6 +499,7 @@ bool MetaOptimizerEnabled(const RewriterConfig& cfg) {
          cfg.dependency_optimization() != RewriterConfig::OFF ||
          cfg.auto_parallel().enable() ||
          cfg.memory_optimization() != RewriterConfig::NO_MEM_OPT ||
+         cfg.memory_aware_scheduling() == RewriterConfig::ON ||
          cfg.debug_stripper() == RewriterConfig::ON ||
          cfg.scoped_allocator_optimization() == RewriterConfig::ON ||
          !cfg.optimizers().empty() || !cfg.custom_optimizers().empty();
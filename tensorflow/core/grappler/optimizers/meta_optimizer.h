@@ -53,6 +53,11 @@ class MetaOptimizer : public GraphOptimizer {
   Status InitializeOptimizersByName(
       std::vector<std::unique_ptr<GraphOptimizer>>* optimizers) const;
 
+  // Optimize the main graph of the item, and then its function library.
+  Status OptimizeGraphAndFunctionLibrary(Cluster* cluster,
+                                         const GrapplerItem& item,
+                                         GraphDef* optimized_graph);
+
   // Run optimization pass over a single GrapplerItem. Meta optimizer might run
   // multiple such passes: 1) for the main graph 2) for the function library
   Status OptimizeGraph(Cluster* cluster, const GrapplerItem& item,
@@ -25,6 +25,7 @@ limitations under the License.
 #include "tensorflow/core/grappler/utils.h"
 #include "tensorflow/core/grappler/utils/grappler_test.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/platform/test.h"
 
 namespace tensorflow {
@@ -98,6 +99,33 @@ TEST_F(MetaOptimizerTest, RunOptimizersTwice) {
   TF_EXPECT_OK(status);
 }
 
+TEST_F(MetaOptimizerTest, LoadsOptimizedGraphFromCache) {
+  TrivialTestGraphInputYielder fake_input(4, 1, 10, false, {"CPU:0"});
+  GrapplerItem item;
+  CHECK(fake_input.NextItem(&item));
+
+  RewriterConfig rewriter_config;
+  rewriter_config.add_optimizers("TestOptimizer");
+  rewriter_config.set_min_graph_nodes(-1);
+  rewriter_config.set_optimized_graph_cache_dir(
+      io::JoinPath(testing::TmpDir(), "meta_optimizer_graph_cache"));
+
+  TestOptimizer::SetOptimized(false);
+  MetaOptimizer optimizer(nullptr, rewriter_config);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+  EXPECT_TRUE(TestOptimizer::IsOptimized());
+
+  // The second session loads the optimized graph without running the
+  // optimizers again.
+  TestOptimizer::SetOptimized(false);
+  MetaOptimizer cached_optimizer(nullptr, rewriter_config);
+  GraphDef cached_output;
+  TF_EXPECT_OK(cached_optimizer.Optimize(nullptr, item, &cached_output));
+  EXPECT_FALSE(TestOptimizer::IsOptimized());
+  EXPECT_EQ(output.DebugString(), cached_output.DebugString());
+}
+
 TEST_F(MetaOptimizerTest, OptimizeFunctionLibrary) {
   using test::function::NDef;
 
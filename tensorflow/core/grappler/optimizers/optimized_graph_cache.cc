@@ -0,0 +1,181 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/optimized_graph_cache.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/framework/versions.h"
+#include "tensorflow/core/lib/core/coding.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/raw_coding.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/strings/numbers.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/public/version.h"
+
+namespace tensorflow {
+namespace grappler {
+
+namespace {
+
+// Identifies the format of cache entries. Entries start with a header made
+// of the magic number, the two halves of the key, and the optimization time.
+constexpr uint64 kCacheEntryMagic = 0x31656863436f7446ull;
+constexpr size_t kCacheEntryHeaderSize = 4 * sizeof(uint64);
+
+void AppendLengthPrefixed(const string& value, string* dst) {
+  core::PutFixed64(dst, value.size());
+  dst->append(value);
+}
+
+}  // namespace
+
+Fprint128 OptimizedGraphCache::Fingerprint(const GrapplerItem& item,
+                                           const Cluster* cluster,
+                                           const RewriterConfig& cfg) {
+  string buffer;
+  // Graphs optimized by a different version of TensorFlow may use different
+  // ops, or have been optimized differently.
+  AppendLengthPrefixed(TF_VERSION_STRING, &buffer);
+  core::PutFixed64(&buffer, TF_GRAPH_DEF_VERSION);
+
+  string serialized;
+  SerializeToStringDeterministic(item.graph, &serialized);
+  AppendLengthPrefixed(serialized, &buffer);
+
+  const std::unordered_set<string> preserved = item.NodesToPreserve();
+  std::vector<string> nodes_to_preserve(preserved.begin(), preserved.end());
+  std::sort(nodes_to_preserve.begin(), nodes_to_preserve.end());
+  core::PutFixed64(&buffer, nodes_to_preserve.size());
+  for (const string& node : nodes_to_preserve) {
+    AppendLengthPrefixed(node, &buffer);
+  }
+
+  // Only the types and shapes of the fed tensors affect the optimizations.
+  std::vector<string> feeds;
+  for (const auto& feed : item.feed) {
+    feeds.push_back(strings::StrCat(feed.first, ":",
+                                    DataTypeString(feed.second.dtype()), ":",
+                                    feed.second.shape().DebugString()));
+  }
+  std::sort(feeds.begin(), feeds.end());
+  core::PutFixed64(&buffer, feeds.size());
+  for (const string& feed : feeds) {
+    AppendLengthPrefixed(feed, &buffer);
+  }
+
+  std::vector<string> devices;
+  if (cluster != nullptr) {
+    for (const auto& device : cluster->GetDevices()) {
+      SerializeToStringDeterministic(device.second, &serialized);
+      devices.push_back(strings::StrCat(device.first, ":", serialized));
+    }
+  }
+  std::sort(devices.begin(), devices.end());
+  core::PutFixed64(&buffer, devices.size());
+  for (const string& device : devices) {
+    AppendLengthPrefixed(device, &buffer);
+  }
+
+  // The location of the cache doesn't change the optimized graph.
+  RewriterConfig config = cfg;
+  config.clear_optimized_graph_cache_dir();
+  SerializeToStringDeterministic(config, &serialized);
+  AppendLengthPrefixed(serialized, &buffer);
+
+  return Fingerprint128(buffer);
+}
+
+Status OptimizedGraphCache::Lookup(const Fprint128& key,
+                                   GraphDef* optimized_graph,
+                                   uint64* optimization_time_us) const {
+  const string path = EntryPath(key);
+  TF_RETURN_IF_ERROR(env_->FileExists(path));
+  string contents;
+  TF_RETURN_IF_ERROR(ReadFileToString(env_, path, &contents));
+
+  if (contents.size() < kCacheEntryHeaderSize ||
+      core::DecodeFixed64(contents.data()) != kCacheEntryMagic) {
+    return errors::DataLoss("Invalid optimized graph cache entry ", path);
+  }
+  if (core::DecodeFixed64(contents.data() + 8) != key.low64 ||
+      core::DecodeFixed64(contents.data() + 16) != key.high64) {
+    return errors::DataLoss("Mismatched key in optimized graph cache entry ",
+                            path);
+  }
+  GraphDef graph;
+  if (!graph.ParseFromArray(contents.data() + kCacheEntryHeaderSize,
+                            contents.size() - kCacheEntryHeaderSize)) {
+    return errors::DataLoss("Can't parse optimized graph cache entry ", path);
+  }
+  // The key covers the version of TensorFlow that wrote the entry, but don't
+  // rely on it to load a graph this binary can't run.
+  Status status = CheckVersions(graph.versions(), TF_GRAPH_DEF_VERSION,
+                                TF_GRAPH_DEF_VERSION_MIN_PRODUCER, "GraphDef",
+                                "graph");
+  if (!status.ok()) {
+    return errors::NotFound("Ignoring optimized graph cache entry ", path,
+                            ": ", status.error_message());
+  }
+
+  *optimization_time_us = core::DecodeFixed64(contents.data() + 24);
+  optimized_graph->Swap(&graph);
+  return Status::OK();
+}
+
+Status OptimizedGraphCache::Insert(const Fprint128& key,
+                                   const GraphDef& optimized_graph,
+                                   uint64 optimization_time_us) const {
+  TF_RETURN_IF_ERROR(env_->RecursivelyCreateDir(directory_));
+
+  string contents;
+  core::PutFixed64(&contents, kCacheEntryMagic);
+  core::PutFixed64(&contents, key.low64);
+  core::PutFixed64(&contents, key.high64);
+  core::PutFixed64(&contents, optimization_time_us);
+  if (!optimized_graph.AppendToString(&contents)) {
+    return errors::Internal("Can't serialize the optimized graph");
+  }
+
+  // Write to a temporary file first so that concurrent readers never see a
+  // partially written entry.
+  const string path = EntryPath(key);
+  string tmp_path = path;
+  if (!env_->CreateUniqueFileName(&tmp_path, ".tmp")) {
+    return errors::Internal("Can't create a temporary file name for ", path);
+  }
+  Status status = WriteStringToFile(env_, tmp_path, contents);
+  if (status.ok()) {
+    status = env_->RenameFile(tmp_path, path);
+  }
+  if (!status.ok()) {
+    env_->DeleteFile(tmp_path).IgnoreError();
+  }
+  return status;
+}
+
+string OptimizedGraphCache::EntryPath(const Fprint128& key) const {
+  return io::JoinPath(directory_,
+                      strings::StrCat(strings::FpToString(key.high64),
+                                      strings::FpToString(key.low64),
+                                      ".graph"));
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
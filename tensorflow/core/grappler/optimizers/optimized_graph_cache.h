@@ -0,0 +1,68 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_OPTIMIZED_GRAPH_CACHE_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_OPTIMIZED_GRAPH_CACHE_H_
+
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/grappler/clusters/cluster.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/protobuf/rewriter_config.pb.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// A cache of optimized graphs on the local file system, keyed by a
+// fingerprint of everything the meta optimizer output depends on: the input
+// graph, the nodes to preserve, the feeds, the devices of the cluster, the
+// RewriterConfig, and the version of TensorFlow. Each entry is stored in its
+// own file, so the cache can be shared by concurrent processes.
+class OptimizedGraphCache {
+ public:
+  explicit OptimizedGraphCache(const string& directory,
+                               Env* env = Env::Default())
+      : directory_(directory), env_(env) {}
+
+  // Computes the cache key of `item` optimized with `cfg` for the devices of
+  // `cluster` (which may be null).
+  static Fprint128 Fingerprint(const GrapplerItem& item, const Cluster* cluster,
+                               const RewriterConfig& cfg);
+
+  // Looks up the optimized graph cached under `key`. Returns NotFound if
+  // there is no entry, or if it holds a graph this version of TensorFlow
+  // can't consume, and DataLoss if the entry is corrupted. On success,
+  // `optimization_time_us` is set to the time it originally took to optimize
+  // the graph.
+  Status Lookup(const Fprint128& key, GraphDef* optimized_graph,
+                uint64* optimization_time_us) const;
+
+  // Caches `optimized_graph` under `key`, replacing any existing entry.
+  Status Insert(const Fprint128& key, const GraphDef& optimized_graph,
+                uint64 optimization_time_us) const;
+
+ private:
+  string EntryPath(const Fprint128& key) const;
+
+  const string directory_;
+  Env* const env_;
+};
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_OPTIMIZED_GRAPH_CACHE_H_
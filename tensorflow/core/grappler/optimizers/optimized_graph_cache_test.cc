@@ -0,0 +1,147 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/optimized_graph_cache.h"
+
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/grappler/clusters/virtual_cluster.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/inputs/trivial_test_graph_input_yielder.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/public/version.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+class OptimizedGraphCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    TrivialTestGraphInputYielder fake_input(4, 1, 10, false, {"CPU:0"});
+    CHECK(fake_input.NextItem(&item_));
+  }
+
+  string CacheDir(const string& name) {
+    return io::JoinPath(testing::TmpDir(), "optimized_graph_cache", name);
+  }
+
+  bool SameKey(const Fprint128& a, const Fprint128& b) {
+    return a.low64 == b.low64 && a.high64 == b.high64;
+  }
+
+  GrapplerItem item_;
+};
+
+TEST_F(OptimizedGraphCacheTest, Fingerprint) {
+  RewriterConfig cfg;
+  const Fprint128 key = OptimizedGraphCache::Fingerprint(item_, nullptr, cfg);
+  EXPECT_TRUE(
+      SameKey(key, OptimizedGraphCache::Fingerprint(item_, nullptr, cfg)));
+
+  // The location of the cache is not part of the key.
+  RewriterConfig cache_cfg = cfg;
+  cache_cfg.set_optimized_graph_cache_dir(CacheDir("fingerprint"));
+  EXPECT_TRUE(SameKey(
+      key, OptimizedGraphCache::Fingerprint(item_, nullptr, cache_cfg)));
+
+  RewriterConfig other_cfg = cfg;
+  other_cfg.set_constant_folding(RewriterConfig::OFF);
+  EXPECT_FALSE(SameKey(
+      key, OptimizedGraphCache::Fingerprint(item_, nullptr, other_cfg)));
+
+  GrapplerItem other_item = item_;
+  other_item.fetch.push_back(item_.graph.node(0).name());
+  EXPECT_FALSE(SameKey(
+      key, OptimizedGraphCache::Fingerprint(other_item, nullptr, cfg)));
+
+  other_item = item_;
+  other_item.graph.mutable_node(0)->set_device("/device:CPU:1");
+  EXPECT_FALSE(SameKey(
+      key, OptimizedGraphCache::Fingerprint(other_item, nullptr, cfg)));
+
+  DeviceProperties cpu_device;
+  cpu_device.set_type("CPU");
+  cpu_device.set_frequency(1000);
+  cpu_device.set_num_cores(4);
+  VirtualCluster cluster({{"/device:CPU:0", cpu_device}});
+  EXPECT_FALSE(
+      SameKey(key, OptimizedGraphCache::Fingerprint(item_, &cluster, cfg)));
+}
+
+TEST_F(OptimizedGraphCacheTest, InsertAndLookup) {
+  const OptimizedGraphCache cache(CacheDir("insert_and_lookup"));
+  const Fprint128 key =
+      OptimizedGraphCache::Fingerprint(item_, nullptr, RewriterConfig());
+
+  GraphDef graph;
+  uint64 optimization_time_us = 0;
+  EXPECT_TRUE(errors::IsNotFound(
+      cache.Lookup(key, &graph, &optimization_time_us)));
+
+  TF_EXPECT_OK(cache.Insert(key, item_.graph, 1234));
+  TF_EXPECT_OK(cache.Lookup(key, &graph, &optimization_time_us));
+  EXPECT_EQ(1234, optimization_time_us);
+  EXPECT_EQ(item_.graph.DebugString(), graph.DebugString());
+
+  // Entries can be replaced.
+  GraphDef empty_graph;
+  *empty_graph.mutable_versions() = item_.graph.versions();
+  TF_EXPECT_OK(cache.Insert(key, empty_graph, 10));
+  TF_EXPECT_OK(cache.Lookup(key, &graph, &optimization_time_us));
+  EXPECT_EQ(10, optimization_time_us);
+  EXPECT_EQ(0, graph.node_size());
+}
+
+TEST_F(OptimizedGraphCacheTest, IgnoresIncompatibleVersions) {
+  const OptimizedGraphCache cache(CacheDir("incompatible_versions"));
+  const Fprint128 key =
+      OptimizedGraphCache::Fingerprint(item_, nullptr, RewriterConfig());
+
+  GraphDef future_graph = item_.graph;
+  future_graph.mutable_versions()->set_min_consumer(TF_GRAPH_DEF_VERSION + 1);
+  TF_EXPECT_OK(cache.Insert(key, future_graph, 1234));
+
+  GraphDef graph;
+  uint64 optimization_time_us = 0;
+  EXPECT_TRUE(errors::IsNotFound(
+      cache.Lookup(key, &graph, &optimization_time_us)));
+}
+
+TEST_F(OptimizedGraphCacheTest, IgnoresCorruptedEntries) {
+  const string dir = CacheDir("corrupted_entries");
+  const OptimizedGraphCache cache(dir);
+  const Fprint128 key =
+      OptimizedGraphCache::Fingerprint(item_, nullptr, RewriterConfig());
+  TF_EXPECT_OK(cache.Insert(key, item_.graph, 1234));
+
+  std::vector<string> entries;
+  TF_ASSERT_OK(Env::Default()->GetChildren(dir, &entries));
+  ASSERT_EQ(1, entries.size());
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), io::JoinPath(dir, entries[0]),
+                                 "garbage"));
+
+  GraphDef graph;
+  uint64 optimization_time_us = 0;
+  EXPECT_TRUE(errors::IsDataLoss(
+      cache.Lookup(key, &graph, &optimization_time_us)));
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
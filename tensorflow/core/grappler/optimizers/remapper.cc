@@ -15,18 +15,415 @@ limitations under the License.
 
 #include "tensorflow/core/grappler/optimizers/remapper.h"
 
+#include <algorithm>
+
+#include "tensorflow/core/framework/attr_value_util.h"
 #include "tensorflow/core/framework/versions.pb.h"
 #include "tensorflow/core/grappler/costs/graph_properties.h"
 #include "tensorflow/core/grappler/graph_view.h"
 #include "tensorflow/core/grappler/grappler_item.h"
 #include "tensorflow/core/grappler/op_types.h"
 #include "tensorflow/core/grappler/optimizers/constant_folding.h"
+#include "tensorflow/core/grappler/optimizers/symbolic_shapes.h"
 #include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/device_name_utils.h"
 
 namespace tensorflow {
 namespace grappler {
 
+namespace {
+
+// A Conv2D or MatMul node, followed by a BiasAdd or an inference mode
+// FusedBatchNorm (Conv2D only), and optionally by an activation. Each node of
+// the chain is the only consumer of the previous one.
+struct ContractionWithOutputStage {
+  const NodeDef* contraction = nullptr;
+  const NodeDef* output_stage = nullptr;
+  const NodeDef* activation = nullptr;
+
+  // The last node of the chain. The fused node takes over its name, so that
+  // its consumers do not need to be updated.
+  const NodeDef* root() const {
+    return activation != nullptr ? activation : output_stage;
+  }
+};
+
+// _FusedConv2D and _FusedMatMul are only implemented on CPU.
+bool NodeIsOnCpu(const NodeDef& node) {
+  string task;
+  string device;
+  return DeviceNameUtils::SplitDeviceName(node.device(), &task, &device) &&
+         str_util::StartsWith(device, DEVICE_CPU);
+}
+
+bool HasSupportedDataType(const NodeDef& node) {
+  const DataType dtype = GetDataTypeFromAttr(node, "T");
+  return dtype == DT_FLOAT || dtype == DT_DOUBLE;
+}
+
+bool HasNhwcDataFormat(const NodeDef& node) {
+  return node.attr().count("data_format") == 0 ||
+         node.attr().at("data_format").s() == "NHWC";
+}
+
+bool IsSupportedActivation(const NodeDef& node) {
+  return node.op() == "Relu" || node.op() == "Relu6" || node.op() == "Elu";
+}
+
+bool IsInferenceBatchNorm(const NodeDef& node) {
+  return (node.op() == "FusedBatchNorm" || node.op() == "FusedBatchNormV2") &&
+         (node.attr().count("is_training") == 0 ||
+          !node.attr().at("is_training").b());
+}
+
+// Returns true if the only thing that consumes `node` is the first regular
+// input of `consumer`, and `node` can be removed from the graph.
+bool IsOnlyConsumedBy(const GraphView& graph, const NodeDef& node,
+                      const NodeDef& consumer,
+                      const std::unordered_set<string>& nodes_to_preserve) {
+  if (nodes_to_preserve.count(node.name()) > 0) return false;
+  const auto fanouts =
+      graph.GetFanoutEdges(node, /*include_controlled_edges=*/true);
+  if (fanouts.size() != 1) return false;
+  const GraphView::Edge& edge = *fanouts.begin();
+  return edge.src.port_id == 0 && edge.tgt.node == &consumer &&
+         edge.tgt.port_id == 0;
+}
+
+// Checks whether `root` ends a contraction chain that can be replaced by a
+// _FusedConv2D or _FusedMatMul node.
+bool FindContractionWithOutputStage(
+    const GraphView& graph, const NodeDef& root,
+    const std::unordered_set<string>& nodes_to_preserve,
+    ContractionWithOutputStage* matched) {
+  ContractionWithOutputStage match;
+  const NodeDef* node = &root;
+
+  if (IsSupportedActivation(*node)) {
+    match.activation = node;
+    node = graph.GetRegularFanin(graph.GetInputPort(node->name(), 0)).node;
+    if (node == nullptr ||
+        !IsOnlyConsumedBy(graph, *node, *match.activation,
+                          nodes_to_preserve)) {
+      return false;
+    }
+  }
+
+  if (!IsBiasAdd(*node) && !IsInferenceBatchNorm(*node)) return false;
+  match.output_stage = node;
+  if (match.activation == nullptr) {
+    // The root FusedBatchNorm keeps its name, but the fused node only has the
+    // first output.
+    for (const GraphView::Edge& edge :
+         graph.GetFanoutEdges(*node, /*include_controlled_edges=*/false)) {
+      if (edge.src.port_id != 0) return false;
+    }
+  }
+  node = graph.GetRegularFanin(graph.GetInputPort(node->name(), 0)).node;
+  if (node == nullptr ||
+      !IsOnlyConsumedBy(graph, *node, *match.output_stage,
+                        nodes_to_preserve)) {
+    return false;
+  }
+
+  const bool is_conv2d = node->op() == "Conv2D";
+  if (!is_conv2d && node->op() != "MatMul") return false;
+  if (!is_conv2d && !IsBiasAdd(*match.output_stage)) return false;
+  match.contraction = node;
+
+  // All nodes of the chain must be placed on the same CPU device, compute in
+  // the same supported data type and use the NHWC layout.
+  const DataType dtype = GetDataTypeFromAttr(*match.contraction, "T");
+  for (const NodeDef* n :
+       {match.contraction, match.output_stage, match.activation}) {
+    if (n == nullptr) continue;
+    if (!NodeIsOnCpu(*n) || n->device() != match.contraction->device() ||
+        !HasSupportedDataType(*n) || GetDataTypeFromAttr(*n, "T") != dtype ||
+        !HasNhwcDataFormat(*n)) {
+      return false;
+    }
+  }
+
+  *matched = match;
+  return true;
+}
+
+void AddFusedContractionNode(const ContractionWithOutputStage& match,
+                             GraphDef* optimized_graph) {
+  const NodeDef& contraction = *match.contraction;
+  const NodeDef& output_stage = *match.output_stage;
+  const bool is_conv2d = contraction.op() == "Conv2D";
+  const bool is_batch_norm = IsInferenceBatchNorm(output_stage);
+
+  NodeDef* fused = optimized_graph->add_node();
+  fused->set_name(match.root()->name());
+  fused->set_op(is_conv2d ? "_FusedConv2D" : "_FusedMatMul");
+  fused->set_device(contraction.device());
+
+  *fused->add_input() = contraction.input(0);
+  *fused->add_input() = contraction.input(1);
+  const int num_args = is_batch_norm ? 4 : 1;
+  for (int i = 1; i <= num_args; ++i) {
+    *fused->add_input() = output_stage.input(i);
+  }
+  // Keep the control dependencies of all the fused nodes.
+  for (const NodeDef* node :
+       {match.contraction, match.output_stage, match.activation}) {
+    if (node == nullptr) continue;
+    for (const string& input : node->input()) {
+      if (IsControlInput(input)) *fused->add_input() = input;
+    }
+  }
+
+  auto* attr = fused->mutable_attr();
+  const auto& src_attr = contraction.attr();
+  (*attr)["T"] = src_attr.at("T");
+  if (is_conv2d) {
+    for (const char* name : {"strides", "padding", "data_format", "dilations",
+                             "use_cudnn_on_gpu"}) {
+      if (src_attr.count(name) > 0) (*attr)[name] = src_attr.at(name);
+    }
+  } else {
+    for (const char* name : {"transpose_a", "transpose_b"}) {
+      if (src_attr.count(name) > 0) (*attr)[name] = src_attr.at(name);
+    }
+  }
+
+  std::vector<string> fused_ops = {is_batch_norm ? "FusedBatchNorm"
+                                                 : "BiasAdd"};
+  if (match.activation != nullptr) fused_ops.push_back(match.activation->op());
+  SetAttrValue(fused_ops, &(*attr)["fused_ops"]);
+  SetAttrValue(num_args, &(*attr)["num_args"]);
+  if (is_batch_norm && output_stage.attr().count("epsilon") > 0) {
+    (*attr)["epsilon"] = output_stage.attr().at("epsilon");
+  }
+}
+
+// Elementwise ops that can be evaluated by a _FusedElementwise node.
+// WARN: This should be consistent with kernels/fused_elementwise_op.cc.
+bool IsFusibleUnaryOp(const NodeDef& node) {
+  static const std::unordered_set<string>* ops =
+      new std::unordered_set<string>({"Abs", "Erf", "Exp", "Floor", "Log",
+                                      "Log1p", "Neg", "Reciprocal", "Relu",
+                                      "Relu6", "Rsqrt", "Sigmoid", "Sqrt",
+                                      "Square", "Tanh"});
+  return ops->count(node.op()) > 0;
+}
+
+bool IsFusibleBinaryOp(const NodeDef& node) {
+  static const std::unordered_set<string>* ops =
+      new std::unordered_set<string>({"Add", "AddV2", "Div", "Maximum",
+                                      "Minimum", "Mul", "Pow", "RealDiv",
+                                      "SquaredDifference", "Sub"});
+  return ops->count(node.op()) > 0;
+}
+
+bool IsFusibleElementwiseOp(const NodeDef& node) {
+  return (IsFusibleUnaryOp(node) || IsFusibleBinaryOp(node)) &&
+         NodeIsOnCpu(node) && HasSupportedDataType(node);
+}
+
+// A tree of elementwise ops that is evaluated by a single _FusedElementwise
+// node. The fused node takes over the name of the tree root.
+struct ElementwiseExpression {
+  const NodeDef* root = nullptr;
+  // Tensors consumed by the expression.
+  std::vector<string> inputs;
+  // Fused nodes and their ops, in evaluation order.
+  std::vector<const NodeDef*> nodes;
+  std::vector<string> op_names;
+  // Operands of the ops: `k < inputs.size()` refers to an input, and larger
+  // values to the result of op `k - inputs.size()`.
+  std::vector<int> operands;
+};
+
+// Grows an ElementwiseExpression from its root towards the inputs, fusing the
+// elementwise ops that only feed other ops of the expression and produce a
+// result of the same shape as the root.
+class ElementwiseExpressionBuilder {
+ public:
+  // Upper bound on the number of fused ops, to keep the kernel setup cheap.
+  static constexpr int kMaxFusedOps = 64;
+
+  ElementwiseExpressionBuilder(
+      const GraphView& graph, const GraphProperties& properties,
+      const std::unordered_set<string>& nodes_to_preserve,
+      const std::unordered_set<string>& fused_nodes)
+      : graph_(graph),
+        properties_(properties),
+        nodes_to_preserve_(nodes_to_preserve),
+        fused_nodes_(fused_nodes) {}
+
+  // Returns true if `node` can be evaluated as a part of the expression that
+  // contains `consumer`.
+  bool CanFuseInto(const NodeDef& node, const NodeDef& consumer) const {
+    if (!IsFusibleElementwiseOp(node) || fused_nodes_.count(node.name()) > 0 ||
+        nodes_to_preserve_.count(node.name()) > 0 ||
+        node.device() != consumer.device() ||
+        GetDataTypeFromAttr(node, "T") != GetDataTypeFromAttr(consumer, "T")) {
+      return false;
+    }
+    for (const GraphView::Edge& edge :
+         graph_.GetFanoutEdges(node, /*include_controlled_edges=*/true)) {
+      if (edge.tgt.node != &consumer || edge.tgt.port_id < 0) return false;
+    }
+    const auto& props = properties_.GetOutputProperties(node.name());
+    const auto& consumer_props =
+        properties_.GetOutputProperties(consumer.name());
+    return !props.empty() && !consumer_props.empty() &&
+           ShapesSymbolicallyEqual(props[0].shape(), consumer_props[0].shape());
+  }
+
+  // Returns true if `node` is the root of an expression, i.e. it is not fused
+  // into its consumer.
+  bool IsRoot(const NodeDef& node) const {
+    if (!IsFusibleElementwiseOp(node) || fused_nodes_.count(node.name()) > 0) {
+      return false;
+    }
+    const auto fanouts =
+        graph_.GetFanoutEdges(node, /*include_controlled_edges=*/true);
+    if (fanouts.empty()) return true;
+    const NodeDef& consumer = *fanouts.begin()->tgt.node;
+    return !IsFusibleElementwiseOp(consumer) ||
+           fused_nodes_.count(consumer.name()) > 0 ||
+           !CanFuseInto(node, consumer);
+  }
+
+  // Builds the expression rooted at `root`. Returns false if it is not worth
+  // fusing, or if one of its inputs can't be broadcasted by the kernel.
+  bool Build(const NodeDef& root, ElementwiseExpression* expression) {
+    const auto& props = properties_.GetOutputProperties(root.name());
+    if (props.empty() || props[0].shape().unknown_rank()) return false;
+    root_shape_ = props[0].shape();
+    expression_ = ElementwiseExpression();
+    expression_.root = &root;
+    op_index_.clear();
+    has_full_input_ = false;
+    num_visited_ = 0;
+    if (AddNode(root) < 0 || !has_full_input_) return false;
+
+    const int num_ops = expression_.op_names.size();
+    const bool has_binary_op = std::any_of(
+        expression_.nodes.begin(), expression_.nodes.end(),
+        [](const NodeDef* node) { return IsFusibleBinaryOp(*node); });
+    if (num_ops < 2 || !has_binary_op) return false;
+
+    // Results of the ops are numbered after the inputs.
+    const int num_inputs = expression_.inputs.size();
+    for (int& operand : expression_.operands) {
+      if (operand < 0) operand = num_inputs - operand - 1;
+    }
+    *expression = std::move(expression_);
+    return true;
+  }
+
+ private:
+  // Adds `node` and the fusible ops that feed it to the expression. Returns
+  // the index of the node op, or -1 if the expression can't be fused.
+  int AddNode(const NodeDef& node) {
+    ++num_visited_;
+    const int num_inputs = IsFusibleBinaryOp(node) ? 2 : 1;
+    const auto& input_props = properties_.GetInputProperties(node.name());
+    if (input_props.size() != static_cast<size_t>(num_inputs)) return -1;
+
+    int operands[2];
+    for (int i = 0; i < num_inputs; ++i) {
+      const GraphView::OutputPort fanin =
+          graph_.GetRegularFanin(graph_.GetInputPort(node.name(), i));
+      if (fanin.node == nullptr) return -1;
+
+      // Results of the fused ops are encoded as negative operands until the
+      // number of inputs is known.
+      const auto it = op_index_.find(fanin.node);
+      if (it != op_index_.end()) {
+        operands[i] = -it->second - 1;
+        continue;
+      }
+      if (num_visited_ < kMaxFusedOps && CanFuseInto(*fanin.node, node)) {
+        const int op_index = AddNode(*fanin.node);
+        if (op_index < 0) return -1;
+        operands[i] = -op_index - 1;
+        continue;
+      }
+
+      // The kernel broadcasts inputs with a single element, all other inputs
+      // must have the shape of the root.
+      const TensorShapeProto& shape = input_props[i].shape();
+      if (ShapesSymbolicallyEqual(shape, root_shape_)) {
+        has_full_input_ = true;
+      } else if (!IsScalarLike(shape)) {
+        return -1;
+      }
+      const string& input = node.input(i);
+      const auto input_it = std::find(expression_.inputs.begin(),
+                                      expression_.inputs.end(), input);
+      operands[i] = input_it - expression_.inputs.begin();
+      if (input_it == expression_.inputs.end()) {
+        expression_.inputs.push_back(input);
+      }
+    }
+
+    const int op_index = expression_.op_names.size();
+    op_index_[&node] = op_index;
+    expression_.nodes.push_back(&node);
+    expression_.op_names.push_back(node.op());
+    expression_.operands.insert(expression_.operands.end(), operands,
+                                operands + num_inputs);
+    return op_index;
+  }
+
+  // Returns true if `shape` has a single element and broadcasting it against
+  // the root shape does not change the result shape.
+  bool IsScalarLike(const TensorShapeProto& shape) const {
+    if (shape.unknown_rank() || shape.dim_size() > root_shape_.dim_size()) {
+      return false;
+    }
+    return std::all_of(
+        shape.dim().begin(), shape.dim().end(),
+        [](const TensorShapeProto::Dim& dim) { return dim.size() == 1; });
+  }
+
+  const GraphView& graph_;
+  const GraphProperties& properties_;
+  const std::unordered_set<string>& nodes_to_preserve_;
+  const std::unordered_set<string>& fused_nodes_;
+
+  TensorShapeProto root_shape_;
+  ElementwiseExpression expression_;
+  std::unordered_map<const NodeDef*, int> op_index_;
+  bool has_full_input_ = false;
+  int num_visited_ = 0;
+};
+
+void AddFusedElementwiseNode(const ElementwiseExpression& expression,
+                             GraphDef* optimized_graph) {
+  const NodeDef& root = *expression.root;
+
+  NodeDef* fused = optimized_graph->add_node();
+  fused->set_name(root.name());
+  fused->set_op("_FusedElementwise");
+  fused->set_device(root.device());
+
+  for (const string& input : expression.inputs) *fused->add_input() = input;
+  // Keep the control dependencies of all the fused nodes.
+  for (const NodeDef* node : expression.nodes) {
+    for (const string& input : node->input()) {
+      if (IsControlInput(input)) *fused->add_input() = input;
+    }
+  }
+  DedupControlInputs(fused);
+
+  auto* attr = fused->mutable_attr();
+  (*attr)["T"] = root.attr().at("T");
+  SetAttrValue(static_cast<int>(expression.inputs.size()), &(*attr)["N"]);
+  SetAttrValue(expression.op_names, &(*attr)["op_names"]);
+  SetAttrValue(expression.operands, &(*attr)["operands"]);
+}
+
+}  // namespace
+
 void AddBatchNormNodes(GraphDef* optimized_graph, const NodeDef& fused_node) {
   const string& x = fused_node.input(0);
   string scale = fused_node.input(1);
@@ -171,9 +568,72 @@ Status Remapper::Optimize(Cluster* /*cluster*/, const GrapplerItem& item,
   TF_RETURN_IF_ERROR(properties.InferStatically(false));
   GraphView graph(const_cast<GraphDef*>(&item.graph));
 
+  // Chains of Conv2D or MatMul, BiasAdd or FusedBatchNorm, and an activation
+  // are replaced with a single node that applies the output stage right after
+  // the contraction. The fused nodes are keyed by the name of the chain root.
+  std::unordered_map<string, ContractionWithOutputStage> fused_roots;
+  std::unordered_set<string> fused_nodes;
+  const std::unordered_set<string> nodes_to_preserve = item.NodesToPreserve();
+#ifndef INTEL_MKL
+  // With MKL, the graph rewrite pass fuses these nodes into MKL kernels.
+  // Look for the chains ending with an activation first, so that their
+  // BiasAdd or FusedBatchNorm is not claimed by a shorter chain.
+  for (bool activation_roots : {true, false}) {
+    for (const NodeDef& node : item.graph.node()) {
+      if (IsSupportedActivation(node) != activation_roots) continue;
+      ContractionWithOutputStage match;
+      if (!FindContractionWithOutputStage(graph, node, nodes_to_preserve,
+                                          &match) ||
+          fused_nodes.count(match.contraction->name()) > 0) {
+        continue;
+      }
+      fused_roots[node.name()] = match;
+      for (const NodeDef* fused_node :
+           {match.contraction, match.output_stage, match.activation}) {
+        if (fused_node != nullptr) fused_nodes.insert(fused_node->name());
+      }
+    }
+  }
+#endif  // !INTEL_MKL
+
+  // Trees of elementwise ops are replaced with a single node that evaluates
+  // them in one pass over the inputs, without materializing the intermediate
+  // results.
+  std::unordered_map<string, ElementwiseExpression> elementwise_roots;
+  ElementwiseExpressionBuilder builder(graph, properties, nodes_to_preserve,
+                                       fused_nodes);
+  for (const NodeDef& node : item.graph.node()) {
+    ElementwiseExpression expression;
+    if (!builder.IsRoot(node) || !builder.Build(node, &expression)) continue;
+    for (const NodeDef* fused_node : expression.nodes) {
+      if (fused_node != &node) fused_nodes.insert(fused_node->name());
+    }
+    elementwise_roots[node.name()] = std::move(expression);
+  }
+
   // During inference, most of the inputs to FusedBatchNorm are constant, and we
   // can therefore replace the op with a much cheaper set of primitives.
   for (const NodeDef& node : item.graph.node()) {
+    const auto fused_root = fused_roots.find(node.name());
+    if (fused_root != fused_roots.end()) {
+      VLOG(1) << "Fusing " << fused_root->second.contraction->op()
+              << " node " << fused_root->second.contraction->name()
+              << " with its output stage " << node.name();
+      AddFusedContractionNode(fused_root->second, optimized_graph);
+      continue;
+    }
+    const auto elementwise_root = elementwise_roots.find(node.name());
+    if (elementwise_root != elementwise_roots.end()) {
+      VLOG(1) << "Fusing elementwise ops rooted at " << node.name() << ": ["
+              << str_util::Join(elementwise_root->second.op_names, ", ")
+              << "]";
+      AddFusedElementwiseNode(elementwise_root->second, optimized_graph);
+      continue;
+    }
+    if (fused_nodes.count(node.name()) > 0) {
+      // Replaced by the fused node above.
+      continue;
+    }
     if (node.op() == "FusedBatchNorm" || node.op() == "FusedBatchNormV2") {
       bool optimizable = (node.attr().count("T") == 0 ||
                           node.attr().at("T").type() == DT_FLOAT);
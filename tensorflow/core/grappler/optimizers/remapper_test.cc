@@ -91,5 +91,352 @@ TEST_F(RemapperTest, FusedBatchNormNCHW) {
   }
 }
 
+TEST_F(RemapperTest, FuseConv2DWithBiasAndRelu) {
+  using ::tensorflow::ops::Placeholder;
+
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+
+  auto input_shape = ops::Placeholder::Shape({8, 32, 32, 3});
+  auto filter_shape = ops::Placeholder::Shape({1, 1, 3, 128});
+  auto bias_shape = ops::Placeholder::Shape({128});
+
+  auto input = Placeholder(s.WithOpName("input"), DT_FLOAT, input_shape);
+  auto filter = Placeholder(s.WithOpName("filter"), DT_FLOAT, filter_shape);
+  auto bias = Placeholder(s.WithOpName("bias"), DT_FLOAT, bias_shape);
+
+  std::vector<int> strides = {1, 1, 1, 1};
+  auto conv = ops::Conv2D(s.WithOpName("conv"), input, filter, strides, "SAME");
+  auto bias_add = ops::BiasAdd(s.WithOpName("bias_add"), conv, bias);
+  auto relu = ops::Relu(s.WithOpName("relu"), bias_add);
+  auto fetch = ops::Identity(s.WithOpName("fetch"), relu);
+
+  auto input_t = GenerateRandomTensor<DT_FLOAT>({8, 32, 32, 3});
+  auto filter_t = GenerateRandomTensor<DT_FLOAT>({1, 1, 3, 128});
+  auto bias_t = GenerateRandomTensor<DT_FLOAT>({128});
+
+  GrapplerItem item;
+  item.fetch = {"fetch"};
+  item.feed = {{"input", input_t}, {"filter", filter_t}, {"bias", bias_t}};
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  // Place all nodes on CPU.
+  for (int i = 0; i < item.graph.node_size(); ++i) {
+    item.graph.mutable_node(i)->set_device("/device:CPU:0");
+  }
+
+  Remapper optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_CHECK_OK(optimizer.Optimize(nullptr, item, &output));
+
+  int found = 0;
+  for (const NodeDef& node : output.node()) {
+    EXPECT_NE("conv", node.name());
+    EXPECT_NE("bias_add", node.name());
+    if (node.name() == "relu") {
+      EXPECT_EQ("_FusedConv2D", node.op());
+      ASSERT_EQ(3, node.input_size());
+      EXPECT_EQ("input", node.input(0));
+      EXPECT_EQ("filter", node.input(1));
+      EXPECT_EQ("bias", node.input(2));
+      EXPECT_EQ(1, node.attr().at("num_args").i());
+      const auto& fused_ops = node.attr().at("fused_ops").list().s();
+      ASSERT_EQ(2, fused_ops.size());
+      EXPECT_EQ("BiasAdd", fused_ops[0]);
+      EXPECT_EQ("Relu", fused_ops[1]);
+      found++;
+    }
+  }
+  EXPECT_EQ(1, found);
+
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch, item.feed);
+  auto tensors = EvaluateNodes(output, item.fetch, item.feed);
+  EXPECT_EQ(1, tensors_expected.size());
+  EXPECT_EQ(1, tensors.size());
+  test::ExpectTensorNear<float>(tensors_expected[0], tensors[0], 1e-6);
+}
+
+TEST_F(RemapperTest, FuseConv2DWithBatchNorm) {
+  using ::tensorflow::ops::Placeholder;
+
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+
+  auto input_shape = ops::Placeholder::Shape({8, 32, 32, 3});
+  auto filter_shape = ops::Placeholder::Shape({3, 3, 3, 16});
+  auto scale_shape = ops::Placeholder::Shape({16});
+
+  auto input = Placeholder(s.WithOpName("input"), DT_FLOAT, input_shape);
+  auto filter = Placeholder(s.WithOpName("filter"), DT_FLOAT, filter_shape);
+  auto scale = Placeholder(s.WithOpName("scale"), DT_FLOAT, scale_shape);
+  auto offset = Placeholder(s.WithOpName("offset"), DT_FLOAT, scale_shape);
+  auto mean = Placeholder(s.WithOpName("mean"), DT_FLOAT, scale_shape);
+  auto variance = Placeholder(s.WithOpName("variance"), DT_FLOAT, scale_shape);
+
+  std::vector<int> strides = {1, 1, 1, 1};
+  auto conv = ops::Conv2D(s.WithOpName("conv"), input, filter, strides, "SAME");
+  ops::FusedBatchNorm::Attrs attrs;
+  attrs = attrs.IsTraining(false);
+  auto batch_norm = ops::FusedBatchNorm(s.WithOpName("batch_norm"), conv, scale,
+                                        offset, mean, variance, attrs);
+  auto fetch = ops::Identity(s.WithOpName("fetch"), batch_norm.y);
+
+  // Keep the values small, the batch norm is computed in a different order
+  // once it is fused.
+  Tensor input_t(DT_FLOAT, {8, 32, 32, 3});
+  input_t.flat<float>().setRandom();
+  Tensor filter_t(DT_FLOAT, {3, 3, 3, 16});
+  filter_t.flat<float>().setRandom();
+  Tensor scale_t(DT_FLOAT, {16});
+  scale_t.flat<float>().setRandom();
+  Tensor offset_t(DT_FLOAT, {16});
+  offset_t.flat<float>().setRandom();
+  Tensor mean_t(DT_FLOAT, {16});
+  mean_t.flat<float>().setRandom();
+  Tensor variance_t(DT_FLOAT, {16});
+  variance_t.flat<float>() = variance_t.flat<float>().setRandom().abs() + 0.5f;
+
+  GrapplerItem item;
+  item.fetch = {"fetch"};
+  item.feed = {{"input", input_t}, {"filter", filter_t},
+               {"scale", scale_t}, {"offset", offset_t},
+               {"mean", mean_t},   {"variance", variance_t}};
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  // Place all nodes on CPU.
+  for (int i = 0; i < item.graph.node_size(); ++i) {
+    item.graph.mutable_node(i)->set_device("/device:CPU:0");
+  }
+
+  Remapper optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_CHECK_OK(optimizer.Optimize(nullptr, item, &output));
+
+  int found = 0;
+  for (const NodeDef& node : output.node()) {
+    EXPECT_NE("conv", node.name());
+    if (node.name() == "batch_norm") {
+      EXPECT_EQ("_FusedConv2D", node.op());
+      ASSERT_EQ(6, node.input_size());
+      EXPECT_EQ("scale", node.input(2));
+      EXPECT_EQ("variance", node.input(5));
+      EXPECT_EQ(4, node.attr().at("num_args").i());
+      const auto& fused_ops = node.attr().at("fused_ops").list().s();
+      ASSERT_EQ(1, fused_ops.size());
+      EXPECT_EQ("FusedBatchNorm", fused_ops[0]);
+      found++;
+    }
+  }
+  EXPECT_EQ(1, found);
+
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch, item.feed);
+  auto tensors = EvaluateNodes(output, item.fetch, item.feed);
+  EXPECT_EQ(1, tensors_expected.size());
+  EXPECT_EQ(1, tensors.size());
+  test::ExpectTensorNear<float>(tensors_expected[0], tensors[0], 1e-5);
+}
+
+TEST_F(RemapperTest, FuseMatMulWithBiasAndElu) {
+  using ::tensorflow::ops::Placeholder;
+
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+
+  auto lhs_shape = ops::Placeholder::Shape({8, 32});
+  auto rhs_shape = ops::Placeholder::Shape({32, 64});
+  auto bias_shape = ops::Placeholder::Shape({64});
+
+  auto lhs = Placeholder(s.WithOpName("lhs"), DT_FLOAT, lhs_shape);
+  auto rhs = Placeholder(s.WithOpName("rhs"), DT_FLOAT, rhs_shape);
+  auto bias = Placeholder(s.WithOpName("bias"), DT_FLOAT, bias_shape);
+
+  auto matmul = ops::MatMul(s.WithOpName("matmul"), lhs, rhs);
+  auto bias_add = ops::BiasAdd(s.WithOpName("bias_add"), matmul, bias);
+  auto elu = ops::Elu(s.WithOpName("elu"), bias_add);
+  auto fetch = ops::Identity(s.WithOpName("fetch"), elu);
+
+  auto lhs_t = GenerateRandomTensor<DT_FLOAT>({8, 32});
+  auto rhs_t = GenerateRandomTensor<DT_FLOAT>({32, 64});
+  auto bias_t = GenerateRandomTensor<DT_FLOAT>({64});
+
+  GrapplerItem item;
+  item.fetch = {"fetch"};
+  item.feed = {{"lhs", lhs_t}, {"rhs", rhs_t}, {"bias", bias_t}};
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  // Place all nodes on CPU.
+  for (int i = 0; i < item.graph.node_size(); ++i) {
+    item.graph.mutable_node(i)->set_device("/device:CPU:0");
+  }
+
+  Remapper optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_CHECK_OK(optimizer.Optimize(nullptr, item, &output));
+
+  int found = 0;
+  for (const NodeDef& node : output.node()) {
+    EXPECT_NE("matmul", node.name());
+    EXPECT_NE("bias_add", node.name());
+    if (node.name() == "elu") {
+      EXPECT_EQ("_FusedMatMul", node.op());
+      ASSERT_EQ(3, node.input_size());
+      EXPECT_EQ("lhs", node.input(0));
+      EXPECT_EQ("rhs", node.input(1));
+      EXPECT_EQ("bias", node.input(2));
+      const auto& fused_ops = node.attr().at("fused_ops").list().s();
+      ASSERT_EQ(2, fused_ops.size());
+      EXPECT_EQ("BiasAdd", fused_ops[0]);
+      EXPECT_EQ("Elu", fused_ops[1]);
+      found++;
+    }
+  }
+  EXPECT_EQ(1, found);
+
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch, item.feed);
+  auto tensors = EvaluateNodes(output, item.fetch, item.feed);
+  EXPECT_EQ(1, tensors_expected.size());
+  EXPECT_EQ(1, tensors.size());
+  test::ExpectTensorNear<float>(tensors_expected[0], tensors[0], 1e-6);
+}
+
+TEST_F(RemapperTest, DoNotFuseWhenIntermediateIsConsumed) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope().WithDevice(
+      "/device:CPU:0");
+
+  auto lhs = ops::Placeholder(s.WithOpName("lhs"), DT_FLOAT,
+                              ops::Placeholder::Shape({8, 32}));
+  auto rhs = ops::Placeholder(s.WithOpName("rhs"), DT_FLOAT,
+                              ops::Placeholder::Shape({32, 64}));
+  auto bias = ops::Placeholder(s.WithOpName("bias"), DT_FLOAT,
+                               ops::Placeholder::Shape({64}));
+
+  auto matmul = ops::MatMul(s.WithOpName("matmul"), lhs, rhs);
+  auto bias_add = ops::BiasAdd(s.WithOpName("bias_add"), matmul, bias);
+  auto relu = ops::Relu(s.WithOpName("relu"), bias_add);
+  auto other = ops::Identity(s.WithOpName("other"), bias_add);
+
+  GrapplerItem item;
+  item.fetch = {"relu", "other"};
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  Remapper optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_CHECK_OK(optimizer.Optimize(nullptr, item, &output));
+
+  // The MatMul and the BiasAdd are still fused, but the Relu has to read the
+  // BiasAdd output, so it stays a separate node.
+  int found = 0;
+  for (const NodeDef& node : output.node()) {
+    EXPECT_NE("matmul", node.name());
+    if (node.name() == "bias_add") {
+      EXPECT_EQ("_FusedMatMul", node.op());
+      found++;
+    }
+    if (node.name() == "relu") {
+      EXPECT_EQ("Relu", node.op());
+      found++;
+    }
+  }
+  EXPECT_EQ(2, found);
+}
+
+TEST_F(RemapperTest, FuseElementwiseOps) {
+  using ::tensorflow::ops::Placeholder;
+
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope().WithDevice(
+      "/device:CPU:0");
+
+  auto shape = ops::Placeholder::Shape({8, 16});
+  auto a = Placeholder(s.WithOpName("a"), DT_FLOAT, shape);
+  auto b = Placeholder(s.WithOpName("b"), DT_FLOAT, shape);
+  auto c = Placeholder(s.WithOpName("c"), DT_FLOAT, shape);
+  auto scale = ops::Const(s.WithOpName("scale"), 0.5f, {});
+
+  // y = sigmoid(a) * tanh(b) + c * scale
+  auto sigmoid = ops::Sigmoid(s.WithOpName("sigmoid"), a);
+  auto tanh = ops::Tanh(s.WithOpName("tanh"), b);
+  auto gate = ops::Mul(s.WithOpName("gate"), sigmoid, tanh);
+  auto scaled = ops::Mul(s.WithOpName("scaled"), c, scale);
+  auto add = ops::Add(s.WithOpName("add"), gate, scaled);
+  auto fetch = ops::Identity(s.WithOpName("fetch"), add);
+
+  GrapplerItem item;
+  item.fetch = {"fetch"};
+  item.feed = {{"a", GenerateRandomTensor<DT_FLOAT>({8, 16})},
+               {"b", GenerateRandomTensor<DT_FLOAT>({8, 16})},
+               {"c", GenerateRandomTensor<DT_FLOAT>({8, 16})}};
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  Remapper optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_CHECK_OK(optimizer.Optimize(nullptr, item, &output));
+
+  int found = 0;
+  for (const NodeDef& node : output.node()) {
+    EXPECT_NE("sigmoid", node.name());
+    EXPECT_NE("tanh", node.name());
+    EXPECT_NE("gate", node.name());
+    EXPECT_NE("scaled", node.name());
+    if (node.name() == "add") {
+      EXPECT_EQ("_FusedElementwise", node.op());
+      EXPECT_EQ("/device:CPU:0", node.device());
+      ASSERT_EQ(4, node.input_size());
+      EXPECT_EQ("a", node.input(0));
+      EXPECT_EQ("b", node.input(1));
+      EXPECT_EQ("c", node.input(2));
+      EXPECT_EQ("scale", node.input(3));
+      EXPECT_EQ(4, node.attr().at("N").i());
+      const auto& op_names = node.attr().at("op_names").list().s();
+      ASSERT_EQ(5, op_names.size());
+      EXPECT_EQ("Sigmoid", op_names[0]);
+      EXPECT_EQ("Tanh", op_names[1]);
+      EXPECT_EQ("Mul", op_names[2]);
+      EXPECT_EQ("Mul", op_names[3]);
+      EXPECT_EQ("Add", op_names[4]);
+      const auto& operands = node.attr().at("operands").list().i();
+      const std::vector<int64> expected_operands = {0, 1, 4, 5, 2, 3, 6, 7};
+      EXPECT_EQ(expected_operands,
+                std::vector<int64>(operands.begin(), operands.end()));
+      found++;
+    }
+  }
+  EXPECT_EQ(1, found);
+
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch, item.feed);
+  auto tensors = EvaluateNodes(output, item.fetch, item.feed);
+  EXPECT_EQ(1, tensors_expected.size());
+  EXPECT_EQ(1, tensors.size());
+  test::ExpectTensorNear<float>(tensors_expected[0], tensors[0], 1e-6);
+}
+
+TEST_F(RemapperTest, DoNotFuseElementwiseOpsWithBroadcast) {
+  using ::tensorflow::ops::Placeholder;
+
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope().WithDevice(
+      "/device:CPU:0");
+
+  auto x = Placeholder(s.WithOpName("x"), DT_FLOAT,
+                       ops::Placeholder::Shape({8, 16}));
+  auto bias = Placeholder(s.WithOpName("bias"), DT_FLOAT,
+                          ops::Placeholder::Shape({16}));
+
+  // The kernel only broadcasts single element inputs.
+  auto add = ops::Add(s.WithOpName("add"), x, bias);
+  auto relu = ops::Relu(s.WithOpName("relu"), add);
+  // Chains of unary ops are left to the arithmetic optimizer.
+  auto exp = ops::Exp(s.WithOpName("exp"), x);
+  auto log = ops::Log(s.WithOpName("log"), exp);
+
+  GrapplerItem item;
+  item.fetch = {"relu", "log"};
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  Remapper optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_CHECK_OK(optimizer.Optimize(nullptr, item, &output));
+
+  EXPECT_EQ(item.graph.node_size(), output.node_size());
+  for (const NodeDef& node : output.node()) {
+    EXPECT_NE("_FusedElementwise", node.op());
+  }
+}
+
 }  // namespace grappler
 }  // namespace tensorflow
@@ -0,0 +1,122 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Implements the _FusedConv2D op: a Conv2D followed by a BiasAdd or an
+// inference mode FusedBatchNorm, and optionally an activation. The graph
+// remapper (grappler/optimizers/remapper.cc) creates these nodes on CPU.
+
+#define EIGEN_USE_THREADS
+
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/register_types.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/kernels/conv_ops.h"
+#include "tensorflow/core/kernels/fused_output_stage.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/util/tensor_format.h"
+
+namespace tensorflow {
+
+typedef Eigen::ThreadPoolDevice CPUDevice;
+
+// The convolution runs through the same launcher as Conv2D and writes straight
+// into the op output. The output stage then rewrites it in place, in a single
+// pass, which replaces the extra passes over the output, the intermediate
+// allocations and the per-kernel dispatch of the unfused BiasAdd, batch norm
+// and activation nodes. (The Eigen version we build against has no output
+// kernel hook in TensorContraction, so the output stage cannot run on each
+// contraction block while it is still in cache.)
+template <typename T>
+class FusedConv2DOp : public OpKernel {
+ public:
+  explicit FusedConv2DOp(OpKernelConstruction* context) : OpKernel(context) {
+    OP_REQUIRES_OK(context, InitConv2DParameters(context, &params_));
+    OP_REQUIRES(context, params_.data_format == FORMAT_NHWC,
+                errors::Unimplemented("Fused Conv2D only supports NHWC tensor "
+                                      "format for now."));
+    OP_REQUIRES_OK(context,
+                   InitFusedOutputStageParams(context,
+                                              /*allow_batch_norm=*/true,
+                                              &output_stage_params_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    // Input tensor is of the following dimensions:
+    // [ batch, in_rows, in_cols, in_depth ]
+    const Tensor& input = context->input(0);
+
+    // Input filter is of the following dimensions:
+    // [ filter_rows, filter_cols, in_depth, out_depth]
+    const Tensor& filter = context->input(1);
+
+    Conv2DDimensions dimensions;
+    OP_REQUIRES_OK(context,
+                   ComputeConv2DDimension(params_, input, filter, &dimensions));
+
+    // Fused arguments follow the input and the filter.
+    FusedOutputStage<T> output_stage(output_stage_params_);
+    OP_REQUIRES_OK(context, output_stage.Init(context, /*first_arg=*/2,
+                                              dimensions.out_depth));
+
+    TensorShape out_shape = ShapeFromFormat(
+        params_.data_format, dimensions.batch, dimensions.out_rows,
+        dimensions.out_cols, dimensions.out_depth);
+
+    // Output tensor is of the following dimensions:
+    // [ in_batch, out_rows, out_cols, out_depth ]
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context, context->allocate_output(0, out_shape, &output));
+
+    // If there is nothing to compute, return.
+    if (out_shape.num_elements() == 0) {
+      return;
+    }
+
+    LaunchConv2DOp<CPUDevice, T>()(
+        context, /*use_cudnn=*/false, /*cudnn_use_autotune=*/false, input,
+        filter, dimensions.dilation_rows, dimensions.dilation_cols,
+        dimensions.stride_rows, dimensions.stride_cols, params_.padding,
+        output, params_.data_format);
+    if (!context->status().ok()) {
+      return;
+    }
+
+    // In NHWC the output channels are innermost, so the output is a
+    // [batch * out_rows * out_cols, out_depth] matrix.
+    output_stage.Apply(
+        context, output->shaped<T, 2>({out_shape.num_elements() /
+                                           dimensions.out_depth,
+                                       dimensions.out_depth}));
+  }
+
+ private:
+  Conv2DParameters params_;
+  FusedOutputStageParams output_stage_params_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(FusedConv2DOp);
+};
+
+#define REGISTER_CPU(T)                                               \
+  REGISTER_KERNEL_BUILDER(                                            \
+      Name("_FusedConv2D").Device(DEVICE_CPU).TypeConstraint<T>("T"), \
+      FusedConv2DOp<T>);
+
+TF_CALL_float(REGISTER_CPU);
+TF_CALL_double(REGISTER_CPU);
+
+#undef REGISTER_CPU
+
+}  // namespace tensorflow
@@ -22,6 +22,7 @@ limitations under the License.
 #include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/graph/node_builder.h"
 #include "tensorflow/core/kernels/conv_ops_gpu.h"
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/kernels/ops_util.h"
@@ -520,4 +521,295 @@ TEST_F(ConvOpTest, HandwrittenConv) { HandwrittenConv(); }
 
 TEST_F(ConvOpTest, AnisotropicStride) { AnisotropicStrides(); }
 
+class FusedConv2DOpTest : public OpsTestBase {
+ protected:
+  static constexpr float kEpsilon = 0.001f;
+
+  // Runs Conv2D followed by `fused_ops` as separate nodes in a session.
+  void RunUnfused(const Tensor& input_data, const Tensor& filter_data,
+                  const std::vector<Tensor>& args_data,
+                  const std::vector<string>& fused_ops, int stride,
+                  const string& padding, Tensor* output) {
+    auto root = tensorflow::Scope::NewRootScope();
+    using namespace ::tensorflow::ops;  // NOLINT(build/namespaces)
+
+    Output input =
+        Const(root.WithOpName("input"), Input::Initializer(input_data));
+    Output filter =
+        Const(root.WithOpName("filter"), Input::Initializer(filter_data));
+    Output result = Conv2D(root.WithOpName("conv"), input, filter,
+                           {1, stride, stride, 1}, padding);
+
+    if (fused_ops[0] == "BiasAdd") {
+      Output bias =
+          Const(root.WithOpName("bias"), Input::Initializer(args_data[0]));
+      result = BiasAdd(root.WithOpName("bias_add"), result, bias);
+    } else {
+      Output scale =
+          Const(root.WithOpName("scale"), Input::Initializer(args_data[0]));
+      Output offset =
+          Const(root.WithOpName("offset"), Input::Initializer(args_data[1]));
+      Output mean =
+          Const(root.WithOpName("mean"), Input::Initializer(args_data[2]));
+      Output variance =
+          Const(root.WithOpName("variance"), Input::Initializer(args_data[3]));
+      result = FusedBatchNorm(
+                   root.WithOpName("batch_norm"), result, scale, offset, mean,
+                   variance,
+                   FusedBatchNorm::IsTraining(false).Epsilon(kEpsilon))
+                   .y;
+    }
+
+    if (fused_ops.size() > 1) {
+      if (fused_ops[1] == "Relu") {
+        result = Relu(root.WithOpName("activation"), result);
+      } else if (fused_ops[1] == "Relu6") {
+        result = Relu6(root.WithOpName("activation"), result);
+      } else if (fused_ops[1] == "Elu") {
+        result = Elu(root.WithOpName("activation"), result);
+      }
+    }
+
+    tensorflow::GraphDef graph;
+    TF_ASSERT_OK(root.ToGraphDef(&graph));
+
+    std::unique_ptr<tensorflow::Session> session(
+        tensorflow::NewSession(tensorflow::SessionOptions()));
+    TF_ASSERT_OK(session->Create(graph));
+
+    std::vector<Tensor> unfused_tensors;
+    TF_ASSERT_OK(
+        session->Run({}, {result.node()->name()}, {}, &unfused_tensors));
+    *output = unfused_tensors[0];
+  }
+
+  // Runs a single _FusedConv2D kernel.
+  void RunFused(const Tensor& input_data, const Tensor& filter_data,
+                const std::vector<Tensor>& args_data,
+                const std::vector<string>& fused_ops, int stride,
+                const string& padding, Tensor* output) {
+    const int num_args = static_cast<int>(args_data.size());
+    TF_ASSERT_OK(NodeDefBuilder("fused_conv", "_FusedConv2D")
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(num_args, DT_FLOAT))
+                     .Attr("num_args", num_args)
+                     .Attr("T", DT_FLOAT)
+                     .Attr("strides", {1, stride, stride, 1})
+                     .Attr("padding", padding)
+                     .Attr("fused_ops", fused_ops)
+                     .Attr("epsilon", kEpsilon)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+
+    AddInputFromArray<float>(input_data.shape(), input_data.flat<float>());
+    AddInputFromArray<float>(filter_data.shape(), filter_data.flat<float>());
+    for (const Tensor& arg : args_data) {
+      AddInputFromArray<float>(arg.shape(), arg.flat<float>());
+    }
+    TF_ASSERT_OK(RunOpKernel());
+    *output = *GetOutput(0);
+  }
+
+  void VerifyFusedConv2D(int filter_size, int stride, const string& padding,
+                         const std::vector<string>& fused_ops) {
+    const int depth = 3;
+    const int filter_count = 8;
+
+    Tensor input(DT_FLOAT, {2, 9, 9, depth});
+    input.flat<float>().setRandom();
+    Tensor filter(DT_FLOAT, {filter_size, filter_size, depth, filter_count});
+    filter.flat<float>().setRandom();
+
+    std::vector<Tensor> args;
+    if (fused_ops[0] == "BiasAdd") {
+      Tensor bias(DT_FLOAT, {filter_count});
+      bias.flat<float>().setRandom();
+      args.push_back(bias);
+    } else {
+      for (int i = 0; i < 4; ++i) {
+        Tensor arg(DT_FLOAT, {filter_count});
+        arg.flat<float>().setRandom();
+        args.push_back(arg);
+      }
+      // Variance must be positive.
+      args[3].flat<float>() = args[3].flat<float>().abs() + 0.5f;
+    }
+
+    Tensor unfused;
+    RunUnfused(input, filter, args, fused_ops, stride, padding, &unfused);
+    Tensor fused;
+    RunFused(input, filter, args, fused_ops, stride, padding, &fused);
+    test::ExpectTensorNear<float>(unfused, fused, 1e-5);
+  }
+};
+
+constexpr float FusedConv2DOpTest::kEpsilon;
+
+TEST_F(FusedConv2DOpTest, OneByOneConvolutionWithBias) {
+  VerifyFusedConv2D(1, 1, "SAME", {"BiasAdd"});
+}
+
+TEST_F(FusedConv2DOpTest, OneByOneConvolutionWithBiasAndRelu) {
+  VerifyFusedConv2D(1, 1, "SAME", {"BiasAdd", "Relu"});
+}
+
+TEST_F(FusedConv2DOpTest, SpatialConvolutionWithBiasAndRelu) {
+  VerifyFusedConv2D(3, 1, "SAME", {"BiasAdd", "Relu"});
+}
+
+TEST_F(FusedConv2DOpTest, SpatialConvolutionWithBiasAndRelu6) {
+  VerifyFusedConv2D(3, 1, "SAME", {"BiasAdd", "Relu6"});
+}
+
+TEST_F(FusedConv2DOpTest, SpatialConvolutionWithBiasAndElu) {
+  VerifyFusedConv2D(3, 1, "SAME", {"BiasAdd", "Elu"});
+}
+
+TEST_F(FusedConv2DOpTest, SpatialConvolutionWithBatchNorm) {
+  VerifyFusedConv2D(3, 1, "SAME", {"FusedBatchNorm"});
+}
+
+TEST_F(FusedConv2DOpTest, StridedConvolutionWithBatchNormAndRelu) {
+  VerifyFusedConv2D(3, 2, "VALID", {"FusedBatchNorm", "Relu"});
+}
+
+TEST_F(FusedConv2DOpTest, UnsupportedFusion) {
+  TF_ASSERT_OK(NodeDefBuilder("fused_conv", "_FusedConv2D")
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(1, DT_FLOAT))
+                   .Attr("num_args", 1)
+                   .Attr("T", DT_FLOAT)
+                   .Attr("strides", {1, 1, 1, 1})
+                   .Attr("padding", "SAME")
+                   .Attr("fused_ops", {"BiasAdd", "Tanh"})
+                   .Finalize(node_def()));
+  Status status = InitOp();
+  EXPECT_EQ(error::UNIMPLEMENTED, status.code());
+}
+
+TEST_F(FusedConv2DOpTest, InvalidBiasShape) {
+  TF_ASSERT_OK(NodeDefBuilder("fused_conv", "_FusedConv2D")
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(1, DT_FLOAT))
+                   .Attr("num_args", 1)
+                   .Attr("T", DT_FLOAT)
+                   .Attr("strides", {1, 1, 1, 1})
+                   .Attr("padding", "SAME")
+                   .Attr("fused_ops", {"BiasAdd"})
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  AddInputFromArray<float>(TensorShape({1, 2, 2, 1}), {1, 2, 3, 4});
+  AddInputFromArray<float>(TensorShape({1, 1, 1, 2}), {1, 2});
+  AddInputFromArray<float>(TensorShape({3}), {1, 2, 3});
+  Status status = RunOpKernel();
+  EXPECT_EQ(error::INVALID_ARGUMENT, status.code());
+}
+
+// Conv2D followed by a BiasAdd or a FusedBatchNorm, and a Relu, either as
+// separate nodes or as a single _FusedConv2D node.
+static Graph* Conv2DWithOutputStage(int batch, int height, int width,
+                                    int in_depth, int filter_size,
+                                    int out_depth, bool batch_norm,
+                                    bool fused) {
+  Graph* g = new Graph(OpRegistry::Global());
+
+  Tensor input_t(DT_FLOAT, TensorShape({batch, height, width, in_depth}));
+  input_t.flat<float>().setRandom();
+  Tensor filter_t(DT_FLOAT, TensorShape({filter_size, filter_size, in_depth,
+                                         out_depth}));
+  filter_t.flat<float>().setRandom();
+
+  std::vector<NodeBuilder::NodeOut> args;
+  for (int i = 0; i < (batch_norm ? 4 : 1); ++i) {
+    Tensor arg_t(DT_FLOAT, TensorShape({out_depth}));
+    arg_t.flat<float>() = arg_t.flat<float>().setRandom().abs() + 0.5f;
+    args.push_back(test::graph::Constant(g, arg_t));
+  }
+
+  Node* input = test::graph::Constant(g, input_t);
+  Node* filter = test::graph::Constant(g, filter_t);
+  Node* node;
+
+  if (fused) {
+    const std::vector<string> fused_ops = {
+        batch_norm ? "FusedBatchNorm" : "BiasAdd", "Relu"};
+    TF_CHECK_OK(NodeBuilder(g->NewName("fused_conv"), "_FusedConv2D")
+                    .Input(input)
+                    .Input(filter)
+                    .Input(args)
+                    .Attr("T", DT_FLOAT)
+                    .Attr("num_args", static_cast<int>(args.size()))
+                    .Attr("strides", {1, 1, 1, 1})
+                    .Attr("padding", "SAME")
+                    .Attr("fused_ops", fused_ops)
+                    .Finalize(g, &node));
+    return g;
+  }
+
+  TF_CHECK_OK(NodeBuilder(g->NewName("conv"), "Conv2D")
+                  .Input(input)
+                  .Input(filter)
+                  .Attr("T", DT_FLOAT)
+                  .Attr("strides", {1, 1, 1, 1})
+                  .Attr("padding", "SAME")
+                  .Finalize(g, &node));
+  if (batch_norm) {
+    TF_CHECK_OK(NodeBuilder(g->NewName("batch_norm"), "FusedBatchNorm")
+                    .Input(node)
+                    .Input(args[0])
+                    .Input(args[1])
+                    .Input(args[2])
+                    .Input(args[3])
+                    .Attr("T", DT_FLOAT)
+                    .Attr("is_training", false)
+                    .Finalize(g, &node));
+  } else {
+    TF_CHECK_OK(NodeBuilder(g->NewName("bias_add"), "BiasAdd")
+                    .Input(node)
+                    .Input(args[0])
+                    .Attr("T", DT_FLOAT)
+                    .Finalize(g, &node));
+  }
+  TF_CHECK_OK(NodeBuilder(g->NewName("relu"), "Relu")
+                  .Input(node)
+                  .Attr("T", DT_FLOAT)
+                  .Finalize(g, &node));
+  return g;
+}
+
+#define BM_Conv2DWithOutputStage(N, H, W, C, FS, FC, BN, FUSED, LABEL)     \
+  static void BM_Conv2DWithOutputStage_##LABEL(int iters) {               \
+    testing::UseRealTime();                                               \
+    testing::ItemsProcessed(static_cast<int64>(iters) * N * H * W * C *   \
+                            FS * FS * FC * 2);                            \
+    test::Benchmark("cpu", Conv2DWithOutputStage(N, H, W, C, FS, FC, BN,  \
+                                                 FUSED))                  \
+        .Run(iters);                                                      \
+  }                                                                       \
+  BENCHMARK(BM_Conv2DWithOutputStage_##LABEL);
+
+#define BM_Conv2DBiasRelu(N, H, W, C, FS, FC, LABEL)                      \
+  BM_Conv2DWithOutputStage(N, H, W, C, FS, FC, false, false,              \
+                           LABEL##_BiasAddRelu);                          \
+  BM_Conv2DWithOutputStage(N, H, W, C, FS, FC, false, true,               \
+                           LABEL##_FusedBiasAddRelu);                     \
+  BM_Conv2DWithOutputStage(N, H, W, C, FS, FC, true, false,               \
+                           LABEL##_BatchNormRelu);                        \
+  BM_Conv2DWithOutputStage(N, H, W, C, FS, FC, true, true,                \
+                           LABEL##_FusedBatchNormRelu);
+
+// ResNet-50 inference, batch size 8: the 3x3 and the reducing 1x1 convolution
+// of the first bottleneck block in each stage.
+BM_Conv2DBiasRelu(8, 56, 56, 64, 3, 64, resnet50_conv2_3x3);
+BM_Conv2DBiasRelu(8, 56, 56, 256, 1, 64, resnet50_conv2_1x1);
+BM_Conv2DBiasRelu(8, 28, 28, 128, 3, 128, resnet50_conv3_3x3);
+BM_Conv2DBiasRelu(8, 28, 28, 512, 1, 128, resnet50_conv3_1x1);
+BM_Conv2DBiasRelu(8, 14, 14, 256, 3, 256, resnet50_conv4_3x3);
+BM_Conv2DBiasRelu(8, 14, 14, 1024, 1, 256, resnet50_conv4_1x1);
+BM_Conv2DBiasRelu(8, 7, 7, 512, 3, 512, resnet50_conv5_3x3);
+BM_Conv2DBiasRelu(8, 7, 7, 2048, 1, 512, resnet50_conv5_1x1);
+
 }  // namespace tensorflow
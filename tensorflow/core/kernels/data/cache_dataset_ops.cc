@@ -14,6 +14,7 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/kernels/data/cache_shards.h"
 #include "tensorflow/core/kernels/data/dataset.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/env.h"
@@ -29,7 +30,20 @@ namespace {
 class CacheDatasetOp : public UnaryDatasetOpKernel {
  public:
   explicit CacheDatasetOp(OpKernelConstruction* ctx)
-      : UnaryDatasetOpKernel(ctx) {}
+      : UnaryDatasetOpKernel(ctx) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("num_shards", &num_shards_));
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("compression_type", &compression_type_));
+    OP_REQUIRES(ctx,
+                compression_type_.empty() || compression_type_ == "ZLIB" ||
+                    compression_type_ == "GZIP",
+                errors::InvalidArgument("Unsupported compression_type: ",
+                                        compression_type_));
+    OP_REQUIRES(ctx, num_shards_ > 0 || compression_type_.empty(),
+                errors::InvalidArgument(
+                    "compression_type is only supported when num_shards is "
+                    "greater than 0, got: ",
+                    compression_type_));
+  }
 
   void MakeDataset(OpKernelContext* ctx, DatasetBase* input,
                    DatasetBase** output) override {
@@ -41,7 +55,8 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
     if (filename.empty()) {
       *output = new MemoryDataset(input);
     } else {
-      *output = new FileDataset(ctx, input, filename, ctx->env());
+      *output = new FileDataset(ctx, input, filename, ctx->env(), num_shards_,
+                                compression_type_);
     }
   }
 
@@ -49,11 +64,14 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
   class FileDataset : public GraphDatasetBase {
    public:
     explicit FileDataset(OpKernelContext* ctx, const DatasetBase* input,
-                         string filename, Env* env)
+                         string filename, Env* env, int64 num_shards,
+                         const string& compression_type)
         : GraphDatasetBase(ctx),
           input_(input),
           filename_(std::move(filename)),
           env_(env),
+          num_shards_(num_shards),
+          compression_type_(compression_type),
           num_tensors_(input->output_dtypes().size()),
           tensor_index_padding_size_(StringPaddingSize(num_tensors_)),
           item_index_padding_size_(StringPaddingSize(kMaxItems)),
@@ -91,11 +109,52 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
       TF_RETURN_IF_ERROR(b->AddParentDataset(ctx, input_, &input_graph));
       Node* filename = nullptr;
       TF_RETURN_IF_ERROR(b->AddScalar(filename_, &filename));
-      TF_RETURN_IF_ERROR(b->AddDataset(this, {input_graph, filename}, output));
+      AttrValue num_shards;
+      b->BuildAttrValue(num_shards_, &num_shards);
+      AttrValue compression_type;
+      b->BuildAttrValue(compression_type_, &compression_type);
+      TF_RETURN_IF_ERROR(
+          b->AddDataset(this, {input_graph, filename},
+                        {std::make_pair("num_shards", num_shards),
+                         std::make_pair("compression_type", compression_type)},
+                        output));
       return Status::OK();
     }
 
    private:
+    // Whether the cache has been completely written, in either format.
+    bool CacheCompleted() const {
+      return env_->FileExists(MetaFilename(filename_)).ok() ||
+             env_->FileExists(CacheShardsIndexFilename(filename_)).ok();
+    }
+
+    // Creates `lockfile`, which is used to catch concurrent iterators writing
+    // to the same cache files.
+    Status CreateLockfile(const string& lockfile) const {
+      if (env_->FileExists(lockfile).ok()) {
+        // Attempt to read the contents of the lockfile.
+        char contents_scratch[151] = {0};  // Initialize all to 0.
+        StringPiece contents;
+        std::unique_ptr<RandomAccessFile> file;
+        if (env_->NewRandomAccessFile(lockfile, &file).ok()) {
+          file->Read(0, 150, &contents, contents_scratch).IgnoreError();
+        }
+        return errors::AlreadyExists(
+            "There appears to be a concurrent caching iterator running - "
+            "cache lockfile already exists ('",
+            lockfile,
+            "'). If you are sure no other running TF computations are using "
+            "this cache prefix, delete the lockfile and re-initialize the "
+            "iterator. Lockfile contents: ",
+            contents);
+      }
+      // Create the file, and write some basic contents.
+      std::unique_ptr<WritableFile> file;
+      TF_RETURN_IF_ERROR(env_->NewWritableFile(lockfile, &file));
+      return file->Append(
+          strings::StrCat("Created at: ", env_->NowSeconds()));
+    }
+
     static size_t StringPaddingSize(size_t num_tensors) {
       return strings::Printf("%zu", num_tensors - 1).size();
     }
@@ -109,9 +168,7 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
      public:
       explicit FileCacheIterator(const Params& params)
           : DatasetIterator<FileDataset>(params) {
-        if (params.dataset->env_
-                ->FileExists(MetaFilename(params.dataset->filename_))
-                .ok()) {
+        if (params.dataset->CacheCompleted()) {
           mode_ = Mode::read;
         } else {
           mode_ = Mode::write;
@@ -145,10 +202,7 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
           TF_RETURN_IF_ERROR(reader->ReadScalar(full_name("mode"), &temp));
           mode_ = static_cast<Mode>(temp);
         }
-        if (mode_ == Mode::write &&
-            dataset()
-                ->env_->FileExists(MetaFilename(dataset()->filename_))
-                .ok()) {
+        if (mode_ == Mode::write && dataset()->CacheCompleted()) {
           // This could happen if the cache was completely written after the
           // checkpoint was saved.
           LOG(WARNING)
@@ -335,44 +389,20 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
 
           // 2. Check that there isn't a concurrent iterator that is writing
           // to cache.
-          if (dataset()->env_->FileExists(lockfile_).ok()) {
-            // Attempt to read the contents of the lockfile.
-            char contents_scratch[151] = {0};  // Initialize all to 0.
-            StringPiece contents;
-            std::unique_ptr<RandomAccessFile> file;
-            if (dataset()->env_->NewRandomAccessFile(lockfile_, &file).ok()) {
-              file->Read(0, 150, &contents, contents_scratch).IgnoreError();
-            }
-            return errors::AlreadyExists(
-                "There appears to be a concurrent caching iterator running - "
-                "cache lockfile already exists ('",
-                lockfile_,
-                "'). If you are sure no other running TF computations are "
-                "using "
-                "this cache prefix, delete the lockfile and re-initialize the "
-                "iterator. Lockfile contents: ",
-                contents);
-          } else {
-            // Create the file, and write some basic contents.
-            std::unique_ptr<WritableFile> lockfile;
-            TF_RETURN_IF_ERROR(
-                dataset()->env_->NewWritableFile(lockfile_, &lockfile));
-            TF_RETURN_IF_ERROR(lockfile->Append(strings::StrCat(
-                "Created at: ", dataset()->env_->NowSeconds())));
-
-            // At this point we know that
-            // 1. There is no conflicting checkpoint with prefix `filename_`.
-            // 2. There is no concurrent session that is trying to write a ckpt
-            //    to filename.
-            // So it is safe to create a BundleWriter here. Note that it is
-            // unsafe to initialize the BundleWriter anywhere the above
-            // conditions are not met since BundleWriter's constructor creates
-            // new temp files which can delete the temp files created by a
-            // BundleWriter in another Session.
-            writer_.reset(new BundleWriter(dataset()->env_, filename_));
-            lockfile_created_ = true;
-            return Status::OK();
-          }
+          TF_RETURN_IF_ERROR(dataset()->CreateLockfile(lockfile_));
+
+          // At this point we know that
+          // 1. There is no conflicting checkpoint with prefix `filename_`.
+          // 2. There is no concurrent session that is trying to write a ckpt
+          //    to filename.
+          // So it is safe to create a BundleWriter here. Note that it is
+          // unsafe to initialize the BundleWriter anywhere the above
+          // conditions are not met since BundleWriter's constructor creates
+          // new temp files which can delete the temp files created by a
+          // BundleWriter in another Session.
+          writer_.reset(new BundleWriter(dataset()->env_, filename_));
+          lockfile_created_ = true;
+          return Status::OK();
         }
 
         Status Finish() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
@@ -504,6 +534,258 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
         bool iterator_restored_ GUARDED_BY(mu_);
       };  // FileReaderIterator
 
+      // ShardedWriterIterator passes through and caches items from the input
+      // FileDataset in the sharded format described in cache_shards.h.
+      //
+      // Element `i` is queued to the writer of shard `i % num_shards_`, which
+      // serializes, compresses and writes it on its own thread, so the shards
+      // are written in parallel. On each call to `SaveInternal` the writers of
+      // the current generation are closed, and the next element starts a new
+      // generation. When all elements have been produced, the index file is
+      // written, which marks the cache as complete.
+      class ShardedWriterIterator : public DatasetIterator<FileDataset> {
+       public:
+        explicit ShardedWriterIterator(const Params& params)
+            : DatasetIterator<FileDataset>(params) {}
+
+        Status Initialize(IteratorContext* ctx) override {
+          return dataset()->input_->MakeIterator(ctx, prefix(), &input_impl_);
+        }
+
+        Status GetNextInternal(IteratorContext* ctx,
+                               std::vector<Tensor>* out_tensors,
+                               bool* end_of_sequence) override {
+          mutex_lock l(mu_);
+          TF_RETURN_IF_ERROR(EnsureWritersExist());
+          TF_RETURN_IF_ERROR(
+              input_impl_->GetNext(ctx, out_tensors, end_of_sequence));
+          if (*end_of_sequence) {
+            return Finish();
+          }
+          if (out_tensors->size() != dataset()->num_tensors_) {
+            return errors::Internal(
+                "Upstream iterator returned invalid number of tensors. "
+                "Expected ",
+                dataset()->num_tensors_, " got: ", out_tensors->size());
+          }
+          TF_RETURN_IF_ERROR(
+              writers_[cur_index_ % dataset()->num_shards_]->Add(*out_tensors));
+          cur_index_++;
+          return Status::OK();
+        }
+
+       protected:
+        Status SaveInternal(IteratorStateWriter* writer) override {
+          mutex_lock l(mu_);
+          if (iteration_completed_) {
+            TF_RETURN_IF_ERROR(
+                writer->WriteScalar(full_name("iteration_completed"), ""));
+            return Status::OK();
+          }
+          // Nothing was written in the current generation if there are no
+          // writers, in which case the generation is not closed. This ensures
+          // that we never write empty generations.
+          if (!writers_.empty()) {
+            TF_RETURN_IF_ERROR(CloseWriters());
+            // Note: As in `FileWriterIterator`, the lockfiles of all
+            // generations are kept until the entire cache has been written.
+            generation_++;
+          }
+          TF_RETURN_IF_ERROR(SaveParent(writer, input_impl_));
+          TF_RETURN_IF_ERROR(
+              writer->WriteScalar(full_name("cur_index"), cur_index_));
+          TF_RETURN_IF_ERROR(
+              writer->WriteScalar(full_name("generation"), generation_));
+          return Status::OK();
+        }
+
+        Status RestoreInternal(IteratorContext* ctx,
+                               IteratorStateReader* reader) override {
+          mutex_lock l(mu_);
+          writers_.clear();
+          if (reader->Contains(full_name("iteration_completed"))) {
+            iteration_completed_ = true;
+            return Status::OK();
+          }
+          TF_RETURN_IF_ERROR(RestoreParent(ctx, reader, input_impl_));
+          TF_RETURN_IF_ERROR(
+              reader->ReadScalar(full_name("cur_index"), &cur_index_));
+          TF_RETURN_IF_ERROR(
+              reader->ReadScalar(full_name("generation"), &generation_));
+          return Status::OK();
+        }
+
+       private:
+        string LockfileName(int64 generation) const {
+          return strings::StrCat(dataset()->filename_, "_", generation,
+                                 ".lockfile");
+        }
+
+        // Creates the writers of the current generation, after checking
+        // that no other iterator writes to the same cache.
+        Status EnsureWritersExist() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+          if (iteration_completed_) {
+            return errors::OutOfRange(
+                "Attempting to call get_next after iteration should have "
+                "finished.");
+          }
+          if (!writers_.empty()) return Status::OK();
+
+          const string index_filename =
+              CacheShardsIndexFilename(dataset()->filename_);
+          if (dataset()->env_->FileExists(index_filename).ok()) {
+            return errors::AlreadyExists("Existing cache files found: \n",
+                                         index_filename, "\n",
+                                         "To continue delete the above file.");
+          }
+          TF_RETURN_IF_ERROR(
+              dataset()->CreateLockfile(LockfileName(generation_)));
+
+          writers_.resize(dataset()->num_shards_);
+          for (int64 i = 0; i < dataset()->num_shards_; ++i) {
+            TF_RETURN_IF_ERROR(CacheShardWriter::Create(
+                dataset()->env_,
+                CacheShardFilename(dataset()->filename_, generation_, i,
+                                   dataset()->num_shards_),
+                dataset()->compression_type_, &writers_[i]));
+          }
+          return Status::OK();
+        }
+
+        Status CloseWriters() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+          Status s;
+          for (auto& writer : writers_) {
+            s.Update(writer->Close());
+          }
+          writers_.clear();
+          return s;
+        }
+
+        Status Finish() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+          iteration_completed_ = true;
+          TF_RETURN_IF_ERROR(CloseWriters());
+          CacheShardsIndex index;
+          index.num_shards = dataset()->num_shards_;
+          index.num_generations = generation_ + 1;
+          index.compression_type = dataset()->compression_type_;
+          TF_RETURN_IF_ERROR(WriteCacheShardsIndex(
+              dataset()->env_, dataset()->filename_, index));
+          // Delete all lockfiles.
+          for (int64 i = 0; i <= generation_; ++i) {
+            TF_RETURN_IF_ERROR(dataset()->env_->DeleteFile(LockfileName(i)));
+          }
+          return Status::OK();
+        }
+
+        mutex mu_;
+        int64 cur_index_ GUARDED_BY(mu_) = 0;
+        // Index of the current generation. This gets incremented whenever the
+        // iterator is saved after writing to the current generation.
+        int64 generation_ GUARDED_BY(mu_) = 0;
+        std::unique_ptr<IteratorBase> input_impl_ GUARDED_BY(mu_);
+        // The writers of the shards of the current generation, or empty if
+        // nothing was written to it yet.
+        std::vector<std::unique_ptr<CacheShardWriter>> writers_
+            GUARDED_BY(mu_);
+        bool iteration_completed_ GUARDED_BY(mu_) = false;
+      };  // ShardedWriterIterator
+
+      // ShardedReaderIterator reads a cache in the sharded format, taking the
+      // elements from the shards in turn to produce them in their original
+      // order.
+      class ShardedReaderIterator : public DatasetIterator<FileDataset> {
+       public:
+        explicit ShardedReaderIterator(const Params& params)
+            : DatasetIterator<FileDataset>(params) {}
+
+        Status Initialize(IteratorContext* ctx) override {
+          mutex_lock l(mu_);
+          CacheShardsIndex index;
+          TF_RETURN_IF_ERROR(ReadCacheShardsIndex(
+              dataset()->env_, dataset()->filename_, &index));
+          readers_.clear();
+          for (int64 i = 0; i < index.num_shards; ++i) {
+            readers_.emplace_back(new CacheShardReader(
+                dataset()->env_, dataset()->filename_, index, i));
+          }
+          return Status::OK();
+        }
+
+        Status GetNextInternal(IteratorContext* ctx,
+                               std::vector<Tensor>* out_tensors,
+                               bool* end_of_sequence) override {
+          mutex_lock l(mu_);
+          CacheShardReader* reader =
+              readers_[cur_index_ % readers_.size()].get();
+          TF_RETURN_IF_ERROR(reader->GetNext(ctx->allocator({}),
+                                             dataset()->num_tensors_,
+                                             out_tensors, end_of_sequence));
+          if (!*end_of_sequence) {
+            cur_index_++;
+          }
+          return Status::OK();
+        }
+
+       protected:
+        Status SaveInternal(IteratorStateWriter* writer) override {
+          mutex_lock l(mu_);
+          TF_RETURN_IF_ERROR(
+              writer->WriteScalar(full_name("cur_index"), cur_index_));
+          for (size_t i = 0; i < readers_.size(); ++i) {
+            TF_RETURN_IF_ERROR(writer->WriteScalar(
+                full_name(strings::StrCat("shard_", i, "_generation")),
+                readers_[i]->generation()));
+            TF_RETURN_IF_ERROR(writer->WriteScalar(
+                full_name(strings::StrCat("shard_", i, "_offset")),
+                static_cast<int64>(readers_[i]->offset())));
+          }
+          return Status::OK();
+        }
+
+        Status RestoreInternal(IteratorContext* ctx,
+                               IteratorStateReader* reader) override {
+          mutex_lock l(mu_);
+          int64 cur_index;
+          TF_RETURN_IF_ERROR(
+              reader->ReadScalar(full_name("cur_index"), &cur_index));
+          if (!reader->Contains(full_name("shard_0_generation"))) {
+            // The checkpoint was saved while the cache was being written, so
+            // the position of the shards is not known and the elements that
+            // were produced are skipped.
+            cur_index_ = 0;
+            std::vector<Tensor> element;
+            bool end_of_sequence = false;
+            while (cur_index_ < cur_index && !end_of_sequence) {
+              CacheShardReader* shard_reader =
+                  readers_[cur_index_ % readers_.size()].get();
+              TF_RETURN_IF_ERROR(shard_reader->GetNext(
+                  ctx->allocator({}), dataset()->num_tensors_, &element,
+                  &end_of_sequence));
+              cur_index_++;
+            }
+            return Status::OK();
+          }
+          cur_index_ = cur_index;
+          for (size_t i = 0; i < readers_.size(); ++i) {
+            int64 generation;
+            int64 offset;
+            TF_RETURN_IF_ERROR(reader->ReadScalar(
+                full_name(strings::StrCat("shard_", i, "_generation")),
+                &generation));
+            TF_RETURN_IF_ERROR(reader->ReadScalar(
+                full_name(strings::StrCat("shard_", i, "_offset")), &offset));
+            readers_[i]->Seek(generation, offset);
+          }
+          return Status::OK();
+        }
+
+       private:
+        mutex mu_;
+        int64 cur_index_ GUARDED_BY(mu_) = 0;
+        std::vector<std::unique_ptr<CacheShardReader>> readers_
+            GUARDED_BY(mu_);
+      };  // ShardedReaderIterator
+
       void InitializeIterator() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
         // We intentionally use the same prefix for both `FileReaderIterator`
         // and `FileWriterIterator`. Since at any time there will be at most
@@ -513,12 +795,27 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
         // checkpoint in `write` mode and the cache has been completely
         // flushed to disk since then. In that case we simply build a
         // `FileReaderIterator` and seek to the `cur_index`.
+        // The format of the cache is decided by the files on disk when
+        // reading, and by `num_shards_` when writing.
         switch (mode_) {
           case Mode::read:
-            iterator_.reset(new FileReaderIterator({dataset(), prefix()}));
+            if (dataset()
+                    ->env_
+                    ->FileExists(CacheShardsIndexFilename(dataset()->filename_))
+                    .ok()) {
+              iterator_.reset(
+                  new ShardedReaderIterator({dataset(), prefix()}));
+            } else {
+              iterator_.reset(new FileReaderIterator({dataset(), prefix()}));
+            }
             break;
           case Mode::write:
-            iterator_.reset(new FileWriterIterator({dataset(), prefix()}));
+            if (dataset()->num_shards_ > 0) {
+              iterator_.reset(
+                  new ShardedWriterIterator({dataset(), prefix()}));
+            } else {
+              iterator_.reset(new FileWriterIterator({dataset(), prefix()}));
+            }
         }
       }
 
@@ -531,6 +828,10 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
     const DatasetBase* const input_;
     const string filename_;
     Env* const env_;
+    // The number of shards of a cache in the sharded format, or 0 to write
+    // the cache with a single `BundleWriter`.
+    const int64 num_shards_;
+    const string compression_type_;
     const size_t num_tensors_;
     const size_t tensor_index_padding_size_;
     static const size_t kMaxItems = 10000000;  // 10 million
@@ -683,10 +984,184 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
         GUARDED_BY(mu_);
     mutable bool writer_iterator_created_ GUARDED_BY(mu_) = false;
   };  // MemoryDataset
-};    // CacheDatasetOp
+
+  int64 num_shards_;
+  string compression_type_;
+};  // CacheDatasetOp
+
+// See documentation in ../ops/dataset_ops.cc for a high-level description of
+// the following op.
+
+class CacheShardsDatasetOp : public UnaryDatasetOpKernel {
+ public:
+  explicit CacheShardsDatasetOp(OpKernelConstruction* ctx)
+      : UnaryDatasetOpKernel(ctx) {}
+
+  void MakeDataset(OpKernelContext* ctx, DatasetBase* input,
+                   DatasetBase** output) override {
+    string filename;
+    OP_REQUIRES_OK(ctx,
+                   ParseScalarArgument<string>(ctx, "filename", &filename));
+    std::vector<int64> shards;
+    OP_REQUIRES_OK(ctx, ParseVectorArgument<int64>(ctx, "shards", &shards));
+    *output = new Dataset(ctx, input, std::move(filename), std::move(shards));
+  }
+
+ private:
+  class Dataset : public GraphDatasetBase {
+   public:
+    Dataset(OpKernelContext* ctx, const DatasetBase* input, string filename,
+            std::vector<int64> shards)
+        : GraphDatasetBase(ctx),
+          input_(input),
+          filename_(std::move(filename)),
+          shards_(std::move(shards)) {
+      input_->Ref();
+    }
+
+    ~Dataset() override { input_->Unref(); }
+
+    std::unique_ptr<IteratorBase> MakeIteratorInternal(
+        const string& prefix) const override {
+      return std::unique_ptr<IteratorBase>(
+          new Iterator({this, strings::StrCat(prefix, "::CacheShards")}));
+    }
+
+    const DataTypeVector& output_dtypes() const override {
+      return input_->output_dtypes();
+    }
+
+    const std::vector<PartialTensorShape>& output_shapes() const override {
+      return input_->output_shapes();
+    }
+
+    string DebugString() const override {
+      return "CacheShardsDatasetOp::Dataset";
+    }
+
+   protected:
+    Status AsGraphDefInternal(OpKernelContext* ctx, DatasetGraphDefBuilder* b,
+                              Node** output) const override {
+      Node* input_graph = nullptr;
+      TF_RETURN_IF_ERROR(b->AddParentDataset(ctx, input_, &input_graph));
+      Node* filename = nullptr;
+      TF_RETURN_IF_ERROR(b->AddScalar(filename_, &filename));
+      Node* shards = nullptr;
+      TF_RETURN_IF_ERROR(b->AddVector(shards_, &shards));
+      TF_RETURN_IF_ERROR(
+          b->AddDataset(this, {input_graph, filename, shards}, output));
+      return Status::OK();
+    }
+
+   private:
+    // Reads the shards one after the other.
+    class Iterator : public DatasetIterator<Dataset> {
+     public:
+      explicit Iterator(const Params& params)
+          : DatasetIterator<Dataset>(params) {}
+
+      Status Initialize(IteratorContext* ctx) override {
+        mutex_lock l(mu_);
+        env_ = ctx->env();
+        Status s = ReadCacheShardsIndex(env_, dataset()->filename_, &index_);
+        if (errors::IsNotFound(s)) {
+          return errors::FailedPrecondition(
+              "The cache ", dataset()->filename_,
+              " has not been completely written in the sharded format.");
+        }
+        TF_RETURN_IF_ERROR(s);
+        for (int64 shard : dataset()->shards_) {
+          if (shard < 0 || shard >= index_.num_shards) {
+            return errors::InvalidArgument("The cache ", dataset()->filename_,
+                                           " has no shard ", shard, ".");
+          }
+        }
+        return Status::OK();
+      }
+
+      Status GetNextInternal(IteratorContext* ctx,
+                             std::vector<Tensor>* out_tensors,
+                             bool* end_of_sequence) override {
+        mutex_lock l(mu_);
+        while (shard_index_ < static_cast<int64>(dataset()->shards_.size())) {
+          if (!reader_) {
+            reader_.reset(new CacheShardReader(
+                env_, dataset()->filename_, index_,
+                dataset()->shards_[shard_index_]));
+          }
+          bool end_of_shard = false;
+          TF_RETURN_IF_ERROR(
+              reader_->GetNext(ctx->allocator({}),
+                               dataset()->output_dtypes().size(), out_tensors,
+                               &end_of_shard));
+          if (!end_of_shard) {
+            *end_of_sequence = false;
+            return Status::OK();
+          }
+          reader_.reset();
+          shard_index_++;
+        }
+        *end_of_sequence = true;
+        return Status::OK();
+      }
+
+     protected:
+      Status SaveInternal(IteratorStateWriter* writer) override {
+        mutex_lock l(mu_);
+        TF_RETURN_IF_ERROR(
+            writer->WriteScalar(full_name("shard_index"), shard_index_));
+        if (reader_) {
+          TF_RETURN_IF_ERROR(writer->WriteScalar(full_name("generation"),
+                                                 reader_->generation()));
+          TF_RETURN_IF_ERROR(writer->WriteScalar(
+              full_name("offset"), static_cast<int64>(reader_->offset())));
+        }
+        return Status::OK();
+      }
+
+      Status RestoreInternal(IteratorContext* ctx,
+                             IteratorStateReader* reader) override {
+        mutex_lock l(mu_);
+        TF_RETURN_IF_ERROR(
+            reader->ReadScalar(full_name("shard_index"), &shard_index_));
+        reader_.reset();
+        if (reader->Contains(full_name("generation"))) {
+          if (shard_index_ < 0 ||
+              shard_index_ >= static_cast<int64>(dataset()->shards_.size())) {
+            return errors::DataLoss("Invalid shard index ", shard_index_);
+          }
+          int64 generation;
+          int64 offset;
+          TF_RETURN_IF_ERROR(
+              reader->ReadScalar(full_name("generation"), &generation));
+          TF_RETURN_IF_ERROR(reader->ReadScalar(full_name("offset"), &offset));
+          reader_.reset(new CacheShardReader(
+              env_, dataset()->filename_, index_,
+              dataset()->shards_[shard_index_]));
+          reader_->Seek(generation, offset);
+        }
+        return Status::OK();
+      }
+
+     private:
+      mutex mu_;
+      Env* env_ GUARDED_BY(mu_) = nullptr;
+      CacheShardsIndex index_ GUARDED_BY(mu_);
+      // The position in `dataset()->shards_` of the shard being read.
+      int64 shard_index_ GUARDED_BY(mu_) = 0;
+      std::unique_ptr<CacheShardReader> reader_ GUARDED_BY(mu_);
+    };
+
+    const DatasetBase* const input_;
+    const string filename_;
+    const std::vector<int64> shards_;
+  };
+};
 
 REGISTER_KERNEL_BUILDER(Name("CacheDataset").Device(DEVICE_CPU),
                         CacheDatasetOp);
+REGISTER_KERNEL_BUILDER(Name("CacheShardsDataset").Device(DEVICE_CPU),
+                        CacheShardsDatasetOp);
 
 }  // namespace
 
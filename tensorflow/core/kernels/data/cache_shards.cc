@@ -0,0 +1,223 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/data/cache_shards.h"
+
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/lib/strings/numbers.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/lib/strings/stringprintf.h"
+
+namespace tensorflow {
+namespace {
+
+// The number of elements a shard writer queues before `Add` blocks.
+constexpr size_t kMaxBufferedElements = 16;
+
+}  // namespace
+
+string CacheShardsIndexFilename(const string& prefix) {
+  return strings::StrCat(prefix, ".shards");
+}
+
+string CacheShardFilename(const string& prefix, int64 generation, int64 shard,
+                          int64 num_shards) {
+  return strings::Printf("%s_%lld.shard-%05lld-of-%05lld", prefix.c_str(),
+                         static_cast<long long>(generation),
+                         static_cast<long long>(shard),
+                         static_cast<long long>(num_shards));
+}
+
+Status WriteCacheShardsIndex(Env* env, const string& prefix,
+                             const CacheShardsIndex& index) {
+  const string filename = CacheShardsIndexFilename(prefix);
+  const string tmp_filename = strings::StrCat(filename, ".tempstate");
+  TF_RETURN_IF_ERROR(WriteStringToFile(
+      env, tmp_filename,
+      strings::StrCat(index.num_shards, "\n", index.num_generations, "\n",
+                      index.compression_type, "\n")));
+  return env->RenameFile(tmp_filename, filename);
+}
+
+Status ReadCacheShardsIndex(Env* env, const string& prefix,
+                            CacheShardsIndex* index) {
+  const string filename = CacheShardsIndexFilename(prefix);
+  string contents;
+  TF_RETURN_IF_ERROR(ReadFileToString(env, filename, &contents));
+  std::vector<string> lines = str_util::Split(contents, '\n');
+  if (lines.size() < 3 ||
+      !strings::safe_strto64(lines[0], &index->num_shards) ||
+      !strings::safe_strto64(lines[1], &index->num_generations) ||
+      index->num_shards <= 0 || index->num_generations < 0) {
+    return errors::DataLoss("Invalid cache index file ", filename);
+  }
+  index->compression_type = lines[2];
+  return Status::OK();
+}
+
+Status CacheShardWriter::Create(Env* env, const string& filename,
+                                const string& compression_type,
+                                std::unique_ptr<CacheShardWriter>* writer) {
+  std::unique_ptr<WritableFile> file;
+  TF_RETURN_IF_ERROR(env->NewWritableFile(filename, &file));
+  CacheShardWriter* shard_writer =
+      new CacheShardWriter(std::move(file), compression_type);
+  writer->reset(shard_writer);
+  shard_writer->thread_.reset(
+      env->StartThread(ThreadOptions(), "tf_data_cache_shard_writer",
+                       [shard_writer]() { shard_writer->WriterThread(); }));
+  return Status::OK();
+}
+
+CacheShardWriter::CacheShardWriter(std::unique_ptr<WritableFile> file,
+                                   const string& compression_type)
+    : file_(std::move(file)),
+      record_writer_(file_.get(),
+                     io::RecordWriterOptions::CreateRecordWriterOptions(
+                         compression_type)) {}
+
+CacheShardWriter::~CacheShardWriter() {
+  Status s = Close();
+  if (!s.ok()) {
+    LOG(ERROR) << "Could not finish writing a cache shard: " << s;
+  }
+}
+
+Status CacheShardWriter::Add(std::vector<Tensor> element) {
+  mutex_lock l(mu_);
+  while (status_.ok() && buffer_.size() >= kMaxBufferedElements) {
+    cond_var_.wait(l);
+  }
+  TF_RETURN_IF_ERROR(status_);
+  buffer_.push_back(std::move(element));
+  cond_var_.notify_all();
+  return Status::OK();
+}
+
+Status CacheShardWriter::Close() {
+  if (!closed_) {
+    closed_ = true;
+    {
+      mutex_lock l(mu_);
+      closing_ = true;
+      cond_var_.notify_all();
+    }
+    // Waits for the writer thread to write the queued elements.
+    thread_.reset();
+    Status s = record_writer_.Close();
+    s.Update(file_->Close());
+    mutex_lock l(mu_);
+    status_.Update(s);
+  }
+  mutex_lock l(mu_);
+  return status_;
+}
+
+void CacheShardWriter::WriterThread() {
+  string record;
+  while (true) {
+    std::vector<Tensor> element;
+    {
+      mutex_lock l(mu_);
+      while (buffer_.empty() && !closing_) {
+        cond_var_.wait(l);
+      }
+      if (buffer_.empty()) {
+        return;
+      }
+      element = std::move(buffer_.front());
+      buffer_.pop_front();
+      cond_var_.notify_all();
+      if (!status_.ok()) {
+        continue;
+      }
+    }
+    Status s;
+    for (const Tensor& t : element) {
+      TensorProto proto;
+      t.AsProtoTensorContent(&proto);
+      proto.SerializeToString(&record);
+      s = record_writer_.WriteRecord(record);
+      if (!s.ok()) break;
+    }
+    if (!s.ok()) {
+      mutex_lock l(mu_);
+      status_.Update(s);
+      cond_var_.notify_all();
+    }
+  }
+}
+
+CacheShardReader::CacheShardReader(Env* env, const string& prefix,
+                                   const CacheShardsIndex& index, int64 shard)
+    : env_(env), prefix_(prefix), index_(index), shard_(shard) {}
+
+Status CacheShardReader::GetNext(Allocator* allocator, size_t num_components,
+                                 std::vector<Tensor>* element,
+                                 bool* end_of_shard) {
+  element->clear();
+  string record;
+  while (generation_ < index_.num_generations) {
+    if (!record_reader_) {
+      TF_RETURN_IF_ERROR(env_->NewRandomAccessFile(
+          CacheShardFilename(prefix_, generation_, shard_, index_.num_shards),
+          &file_));
+      record_reader_.reset(new io::RecordReader(
+          file_.get(), io::RecordReaderOptions::CreateRecordReaderOptions(
+                           index_.compression_type)));
+    }
+    Status s = record_reader_->ReadRecord(&offset_, &record);
+    if (errors::IsOutOfRange(s)) {
+      // Moves on to the next generation.
+      Seek(generation_ + 1, 0);
+      continue;
+    }
+    TF_RETURN_IF_ERROR(s);
+    element->reserve(num_components);
+    for (size_t i = 0; i < num_components; ++i) {
+      if (i > 0) {
+        s = record_reader_->ReadRecord(&offset_, &record);
+        if (errors::IsOutOfRange(s)) {
+          return errors::DataLoss("Truncated element in cache shard ", shard_,
+                                  " of ", prefix_);
+        }
+        TF_RETURN_IF_ERROR(s);
+      }
+      TensorProto proto;
+      Tensor t;
+      if (!proto.ParseFromString(record) || !t.FromProto(allocator, proto)) {
+        return errors::DataLoss("Invalid tensor in cache shard ", shard_,
+                                " of ", prefix_);
+      }
+      element->push_back(std::move(t));
+    }
+    *end_of_shard = false;
+    return Status::OK();
+  }
+  *end_of_shard = true;
+  return Status::OK();
+}
+
+void CacheShardReader::Seek(int64 generation, uint64 offset) {
+  if (generation != generation_) {
+    record_reader_.reset();
+    file_.reset();
+    generation_ = generation;
+  }
+  offset_ = offset;
+}
+
+}  // namespace tensorflow
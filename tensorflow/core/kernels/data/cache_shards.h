@@ -0,0 +1,143 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_KERNELS_DATA_CACHE_SHARDS_H_
+#define TENSORFLOW_CORE_KERNELS_DATA_CACHE_SHARDS_H_
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/io/record_reader.h"
+#include "tensorflow/core/lib/io/record_writer.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// The sharded file format of CacheDataset.
+//
+// The elements of a cache with prefix `p` and `N` shards are distributed round
+// robin over the shards: the element with index `i` is written to shard
+// `i % N`. Each shard is a TFRecord file, optionally compressed, that holds
+// one serialized `TensorProto` per component of its elements.
+//
+// A cache is written in one or more generations: whenever the writing iterator
+// is saved, the shards of the current generation are closed and a new
+// generation is started, so that a restored iterator never has to truncate a
+// file. Shard `s` of generation `g` is in `CacheShardFilename(p, g, s, N)`.
+// Reading the generations of a shard in order yields its elements in order.
+//
+// The cache is complete once the file `CacheShardsIndexFilename(p)` exists.
+
+// The contents of the index file of a complete cache.
+struct CacheShardsIndex {
+  int64 num_shards = 0;
+  int64 num_generations = 0;
+  string compression_type;
+};
+
+string CacheShardsIndexFilename(const string& prefix);
+
+string CacheShardFilename(const string& prefix, int64 generation, int64 shard,
+                          int64 num_shards);
+
+// Atomically writes the index file of the cache with prefix `prefix`.
+Status WriteCacheShardsIndex(Env* env, const string& prefix,
+                             const CacheShardsIndex& index);
+
+Status ReadCacheShardsIndex(Env* env, const string& prefix,
+                            CacheShardsIndex* index);
+
+// Writes the elements of one shard of one generation.
+//
+// Elements are serialized, compressed and written on a background thread of
+// the writer, so that the writers of the shards of a cache work in parallel.
+// Errors of the background thread are returned by the next call to `Add` or
+// `Close`.
+//
+// This class is thread-compatible.
+class CacheShardWriter {
+ public:
+  static Status Create(Env* env, const string& filename,
+                       const string& compression_type,
+                       std::unique_ptr<CacheShardWriter>* writer);
+
+  // Calls `Close` and logs if an error occurs.
+  ~CacheShardWriter();
+
+  // Queues `element` for writing. Blocks while the writer is behind by more
+  // than a few elements.
+  Status Add(std::vector<Tensor> element);
+
+  // Writes all queued elements and closes the file.
+  Status Close();
+
+ private:
+  CacheShardWriter(std::unique_ptr<WritableFile> file,
+                   const string& compression_type);
+
+  void WriterThread();
+
+  std::unique_ptr<WritableFile> file_;
+  io::RecordWriter record_writer_;
+  std::unique_ptr<Thread> thread_;
+  bool closed_ = false;
+
+  mutex mu_;
+  condition_variable cond_var_;
+  std::deque<std::vector<Tensor>> buffer_ GUARDED_BY(mu_);
+  bool closing_ GUARDED_BY(mu_) = false;
+  Status status_ GUARDED_BY(mu_);
+};
+
+// Reads the elements of one shard of a complete cache, across generations.
+//
+// This class is thread-compatible.
+class CacheShardReader {
+ public:
+  CacheShardReader(Env* env, const string& prefix,
+                   const CacheShardsIndex& index, int64 shard);
+
+  // Reads the next element of the shard, or sets `*end_of_shard`.
+  Status GetNext(Allocator* allocator, size_t num_components,
+                 std::vector<Tensor>* element, bool* end_of_shard);
+
+  // The position of the next element, for saving the reader.
+  int64 generation() const { return generation_; }
+  uint64 offset() const { return offset_; }
+
+  // Moves to a position returned by `generation()` and `offset()`.
+  void Seek(int64 generation, uint64 offset);
+
+ private:
+  Env* const env_;
+  const string prefix_;
+  const CacheShardsIndex index_;
+  const int64 shard_;
+  int64 generation_ = 0;
+  uint64 offset_ = 0;
+  // The file of `generation_`, opened on the first read.
+  std::unique_ptr<RandomAccessFile> file_;
+  std::unique_ptr<io::RecordReader> record_reader_;
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_DATA_CACHE_SHARDS_H_
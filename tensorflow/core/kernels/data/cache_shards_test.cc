@@ -0,0 +1,149 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/data/cache_shards.h"
+
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+std::vector<Tensor> MakeElement(int64 i) {
+  return {test::AsScalar<int64>(i),
+          test::AsTensor<string>({strings::StrCat("element ", i), "x"})};
+}
+
+void ExpectElement(int64 i, const std::vector<Tensor>& element) {
+  std::vector<Tensor> expected = MakeElement(i);
+  ASSERT_EQ(expected.size(), element.size());
+  test::ExpectTensorEqual<int64>(expected[0], element[0]);
+  test::ExpectTensorEqual<string>(expected[1], element[1]);
+}
+
+// Writes elements [begin, end) of a cache with `num_shards` shards to
+// `generation`.
+void WriteGeneration(const string& prefix, int64 generation, int64 num_shards,
+                     const string& compression_type, int64 begin,
+                     int64 end) {
+  std::vector<std::unique_ptr<CacheShardWriter>> writers(num_shards);
+  for (int64 i = 0; i < num_shards; ++i) {
+    TF_ASSERT_OK(CacheShardWriter::Create(
+        Env::Default(),
+        CacheShardFilename(prefix, generation, i, num_shards),
+        compression_type, &writers[i]));
+  }
+  for (int64 i = begin; i < end; ++i) {
+    TF_ASSERT_OK(writers[i % num_shards]->Add(MakeElement(i)));
+  }
+  for (auto& writer : writers) {
+    TF_ASSERT_OK(writer->Close());
+  }
+}
+
+class CacheShardsTest : public ::testing::TestWithParam<string> {};
+
+TEST_P(CacheShardsTest, ReadsShardsAcrossGenerations) {
+  const string prefix = io::JoinPath(
+      testing::TmpDir(), strings::StrCat("generations_", GetParam()));
+  WriteGeneration(prefix, 0, 3, GetParam(), 0, 7);
+  WriteGeneration(prefix, 1, 3, GetParam(), 7, 20);
+  CacheShardsIndex index;
+  index.num_shards = 3;
+  index.num_generations = 2;
+  index.compression_type = GetParam();
+  TF_ASSERT_OK(WriteCacheShardsIndex(Env::Default(), prefix, index));
+
+  CacheShardsIndex read_index;
+  TF_ASSERT_OK(ReadCacheShardsIndex(Env::Default(), prefix, &read_index));
+  EXPECT_EQ(3, read_index.num_shards);
+  EXPECT_EQ(2, read_index.num_generations);
+  EXPECT_EQ(GetParam(), read_index.compression_type);
+
+  for (int64 shard = 0; shard < 3; ++shard) {
+    CacheShardReader reader(Env::Default(), prefix, read_index, shard);
+    std::vector<Tensor> element;
+    bool end_of_shard = false;
+    for (int64 i = shard; i < 20; i += 3) {
+      TF_ASSERT_OK(
+          reader.GetNext(cpu_allocator(), 2, &element, &end_of_shard));
+      ASSERT_FALSE(end_of_shard);
+      ExpectElement(i, element);
+    }
+    TF_ASSERT_OK(reader.GetNext(cpu_allocator(), 2, &element, &end_of_shard));
+    EXPECT_TRUE(end_of_shard);
+  }
+}
+
+TEST_P(CacheShardsTest, SeeksToSavedPosition) {
+  const string prefix = io::JoinPath(testing::TmpDir(),
+                                     strings::StrCat("seek_", GetParam()));
+  WriteGeneration(prefix, 0, 2, GetParam(), 0, 6);
+  WriteGeneration(prefix, 1, 2, GetParam(), 6, 10);
+  CacheShardsIndex index;
+  index.num_shards = 2;
+  index.num_generations = 2;
+  index.compression_type = GetParam();
+
+  std::vector<Tensor> element;
+  bool end_of_shard = false;
+  CacheShardReader reader(Env::Default(), prefix, index, 1);
+  for (int64 i = 1; i < 7; i += 2) {
+    TF_ASSERT_OK(reader.GetNext(cpu_allocator(), 2, &element, &end_of_shard));
+    ExpectElement(i, element);
+  }
+
+  CacheShardReader restored(Env::Default(), prefix, index, 1);
+  restored.Seek(reader.generation(), reader.offset());
+  for (int64 i = 7; i < 10; i += 2) {
+    TF_ASSERT_OK(
+        restored.GetNext(cpu_allocator(), 2, &element, &end_of_shard));
+    ASSERT_FALSE(end_of_shard);
+    ExpectElement(i, element);
+  }
+  TF_ASSERT_OK(restored.GetNext(cpu_allocator(), 2, &element, &end_of_shard));
+  EXPECT_TRUE(end_of_shard);
+}
+
+INSTANTIATE_TEST_CASE_P(CompressionTypes, CacheShardsTest,
+                        ::testing::Values("", "ZLIB"));
+
+TEST(CacheShardsIndexTest, RejectsInvalidIndex) {
+  const string prefix = io::JoinPath(testing::TmpDir(), "invalid");
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(),
+                                 CacheShardsIndexFilename(prefix), "x\n"));
+  CacheShardsIndex index;
+  EXPECT_TRUE(errors::IsDataLoss(
+      ReadCacheShardsIndex(Env::Default(), prefix, &index)));
+}
+
+TEST(CacheShardReaderTest, TruncatedElement) {
+  const string prefix = io::JoinPath(testing::TmpDir(), "truncated");
+  WriteGeneration(prefix, 0, 1, "", 0, 1);
+  CacheShardsIndex index;
+  index.num_shards = 1;
+  index.num_generations = 1;
+  CacheShardReader reader(Env::Default(), prefix, index, 0);
+  std::vector<Tensor> element;
+  bool end_of_shard = false;
+  // Reading elements with a third component runs out of records.
+  EXPECT_TRUE(errors::IsDataLoss(
+      reader.GetNext(cpu_allocator(), 3, &element, &end_of_shard)));
+}
+
+}  // namespace
+}  // namespace tensorflow
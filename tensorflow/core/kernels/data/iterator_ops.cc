@@ -15,11 +15,14 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/function.h"
 #include "tensorflow/core/common_runtime/graph_runner.h"
 #include "tensorflow/core/common_runtime/renamed_device.h"
+#include "tensorflow/core/common_runtime/step_stats_collector.h"
 #include "tensorflow/core/common_runtime/threadpool_device.h"
 #include "tensorflow/core/framework/iterator.pb.h"
+#include "tensorflow/core/framework/model.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/resource_op_kernel.h"
 #include "tensorflow/core/framework/stats_aggregator.h"
+#include "tensorflow/core/framework/step_stats.pb.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/variant_op_registry.h"
 #include "tensorflow/core/graph/graph_constructor.h"
@@ -31,6 +34,7 @@ limitations under the License.
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/public/session_options.h"
 
@@ -43,6 +47,11 @@ namespace {
 
 const char kIteratorVariantTypeName[] = "tensorflow::Iterator";
 
+// The performance model of an iterator is optimized often while the input
+// pipeline warms up, then less and less often.
+const int64 kMinOptimizePeriodMs = 10;
+const int64 kMaxOptimizePeriodMs = 1000;
+
 Status VerifyTypesMatch(const DataTypeVector& expected,
                         const DataTypeVector& received) {
   if (expected.size() != received.size()) {
@@ -94,9 +103,20 @@ class IteratorResource : public ResourceBase {
         pflr_(std::move(pflr)),
         lib_(lib),
         iterator_(nullptr),
+        model_(std::make_shared<model::Model>()),
         output_dtypes_(output_dtypes),
         output_shapes_(output_shapes) {}
 
+  ~IteratorResource() override {
+    {
+      mutex_lock l(optimize_mu_);
+      cancelled_ = true;
+      optimize_cond_var_.notify_all();
+    }
+    // Joins the thread.
+    optimize_thread_.reset();
+  }
+
   Status GetNext(IteratorContext* ctx, std::vector<Tensor>* out_tensors,
                  bool* end_of_sequence) {
     std::shared_ptr<IteratorBase> captured_iterator(iterator_);
@@ -104,6 +124,10 @@ class IteratorResource : public ResourceBase {
       if (lib_ != nullptr) {
         ctx->set_lib(lib_);
       }
+      ctx->set_model(model_);
+      if (model_->collecting()) {
+        EnsureOptimizeThreadStarted(ctx);
+      }
       return captured_iterator->GetNext(ctx, out_tensors, end_of_sequence);
     } else {
       return errors::FailedPrecondition(
@@ -159,6 +183,7 @@ class IteratorResource : public ResourceBase {
     TF_RETURN_IF_ERROR(GetDatasetFromVariantTensor(outputs[0], &dataset));
 
     IteratorContext iter_ctx = dataset::MakeIteratorContext(ctx);
+    iter_ctx.set_model(model_);
     std::unique_ptr<IteratorBase> iterator;
     TF_RETURN_IF_ERROR(dataset->MakeIterator(&iter_ctx, "Iterator", &iterator));
     TF_RETURN_IF_ERROR(set_iterator(std::move(iterator)));
@@ -169,6 +194,7 @@ class IteratorResource : public ResourceBase {
       params.env = ctx->env();
       params.runner = *(ctx->runner());
       params.lib = lib;
+      params.model = model_;
       DeviceBase* device = lib->device();
       params.allocator_getter = [device](AllocatorAttributes attrs) {
         return device->GetAllocator(attrs);
@@ -215,7 +241,36 @@ class IteratorResource : public ResourceBase {
     return output_shapes_;
   }
 
+  // The performance model shared by the iterators of this resource. Iterators
+  // must be created with it for their parameters to be autotuned.
+  std::shared_ptr<model::Model> model() const { return model_; }
+
  private:
+  void EnsureOptimizeThreadStarted(IteratorContext* ctx) {
+    mutex_lock l(optimize_mu_);
+    if (!optimize_thread_) {
+      optimize_thread_.reset(ctx->env()->StartThread(
+          {}, "tf_data_model", [this]() { OptimizeThread(); }));
+    }
+  }
+
+  void OptimizeThread() {
+    int64 period_ms = kMinOptimizePeriodMs;
+    while (true) {
+      {
+        mutex_lock l(optimize_mu_);
+        if (!cancelled_) {
+          optimize_cond_var_.wait_for(l, std::chrono::milliseconds(period_ms));
+        }
+        if (cancelled_) {
+          return;
+        }
+      }
+      model_->Optimize(port::NumSchedulableCPUs());
+      period_ms = std::min(period_ms * 2, kMaxOptimizePeriodMs);
+    }
+  }
+
   // The following (device_mgr_, flib_def_, pflr_) are only used when the
   // IteratorResource is shared between sessions and in that case we create
   // a new FLR. Otherwise these are set to null.
@@ -226,6 +281,11 @@ class IteratorResource : public ResourceBase {
   std::shared_ptr<IteratorBase> iterator_;
   mutex mu_;
   std::shared_ptr<const FunctionLibraryDefinition> lib_def_ GUARDED_BY(mu_);
+  const std::shared_ptr<model::Model> model_;
+  mutex optimize_mu_;
+  condition_variable optimize_cond_var_;
+  bool cancelled_ GUARDED_BY(optimize_mu_) = false;
+  std::unique_ptr<Thread> optimize_thread_ GUARDED_BY(optimize_mu_);
   const DataTypeVector output_dtypes_;
   const std::vector<PartialTensorShape> output_shapes_;
 };
@@ -655,6 +715,7 @@ class MakeIteratorOp : public OpKernel {
     core::ScopedUnref unref(iterator_resource);
 
     IteratorContext iter_ctx = dataset::MakeIteratorContext(ctx);
+    iter_ctx.set_model(iterator_resource->model());
     std::unique_ptr<IteratorBase> iterator;
     OP_REQUIRES_OK(ctx,
                    dataset->MakeIterator(&iter_ctx, "Iterator", &iterator));
@@ -952,6 +1013,7 @@ class OneShotIteratorOp : public AsyncOpKernel {
     DatasetBase* dataset;
     TF_RETURN_IF_ERROR(GetDatasetFromVariantTensor(return_values[0], &dataset));
     IteratorContext iter_ctx = dataset::MakeIteratorContext(ctx);
+    iter_ctx.set_model((*iterator)->model());
     std::unique_ptr<IteratorBase> iter;
     TF_RETURN_IF_ERROR(dataset->MakeIterator(&iter_ctx, "Iterator", &iter));
     TF_RETURN_IF_ERROR((*iterator)->set_iterator(std::move(iter)));
@@ -995,6 +1057,88 @@ class OneShotIteratorOp : public AsyncOpKernel {
   const int graph_def_version_;
 };
 
+// Adds the profile of the input pipeline of an iterator to the step stats of
+// a traced step: each stage that produced elements during the lifetime of
+// this object becomes a node named after the stage, whose duration is the
+// time its consumer waited for those elements and whose timeline label lists
+// the rest of its profile. The nodes are placed on a "<device>/tf_data"
+// pseudo-device, so that timelines show the pipeline on its own row.
+//
+// Tracing a step enables profiling for the rest of the lifetime of the
+// iterator, so the first traced step may not see every stage.
+class ScopedStepProfile {
+ public:
+  ScopedStepProfile(OpKernelContext* ctx, std::shared_ptr<model::Model> model)
+      : ctx_(ctx), model_(std::move(model)) {
+    if (ctx_->stats_collector() == nullptr) {
+      return;
+    }
+    model_->EnableProfiling();
+    start_micros_ = ctx_->env()->NowMicros();
+    for (model::Profile& profile : model_->GetProfile()) {
+      string name = profile.name;
+      start_profile_.emplace(std::move(name), std::move(profile));
+    }
+  }
+
+  ~ScopedStepProfile() {
+    if (start_micros_ < 0) {
+      return;
+    }
+    const string device = strings::StrCat(ctx_->device()->name(), "/tf_data");
+    for (const model::Profile& profile : model_->GetProfile()) {
+      model::Profile delta = profile;
+      auto it = start_profile_.find(profile.name);
+      if (it != start_profile_.end()) {
+        delta.num_elements -= it->second.num_elements;
+        delta.processing_time -= it->second.processing_time;
+        delta.latency -= it->second.latency;
+        delta.input_time -= it->second.input_time;
+        delta.bytes_produced -= it->second.bytes_produced;
+        delta.buffered_elements -= it->second.buffered_elements;
+        delta.buffer_samples -= it->second.buffer_samples;
+      }
+      if (delta.num_elements <= 0) {
+        continue;
+      }
+      const int64 latency_micros = delta.latency / 1000;
+      NodeExecStats* stats = new NodeExecStats;
+      stats->set_node_name(profile.name);
+      stats->set_all_start_micros(start_micros_);
+      stats->set_op_start_rel_micros(0);
+      stats->set_op_end_rel_micros(latency_micros);
+      stats->set_all_end_rel_micros(latency_micros);
+      // Timelines show the arguments of labels of the form
+      // "name = op(arg, ...)".
+      size_t pos = profile.name.rfind("::");
+      const string op =
+          pos == string::npos ? profile.name : profile.name.substr(pos + 2);
+      string label = strings::StrCat(
+          profile.name, " = ", op, "(elements: ", delta.num_elements,
+          ", latency: ", latency_micros,
+          "us, processing_time: ", delta.processing_time / 1000,
+          "us, input_time: ", delta.input_time / 1000,
+          "us, bytes_produced: ", delta.bytes_produced);
+      if (delta.buffer_samples > 0) {
+        strings::StrAppend(&label, ", buffered_elements: ",
+                           static_cast<double>(delta.buffered_elements) /
+                               delta.buffer_samples);
+      }
+      strings::StrAppend(&label, ")");
+      stats->set_timeline_label(label);
+      ctx_->stats_collector()->Save(device, stats);
+    }
+  }
+
+ private:
+  OpKernelContext* const ctx_;
+  const std::shared_ptr<model::Model> model_;
+  int64 start_micros_ = -1;
+  std::map<string, model::Profile> start_profile_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ScopedStepProfile);
+};
+
 class IteratorGetNextOp : public AsyncOpKernel {
  public:
   explicit IteratorGetNextOp(OpKernelConstruction* ctx)
@@ -1025,8 +1169,11 @@ class IteratorGetNextOp : public AsyncOpKernel {
           };
           IteratorContext iter_ctx(std::move(params));
 
-          Status s =
-              iterator->GetNext(&iter_ctx, &components, &end_of_sequence);
+          Status s;
+          {
+            ScopedStepProfile step_profile(ctx, iterator->model());
+            s = iterator->GetNext(&iter_ctx, &components, &end_of_sequence);
+          }
           // NOTE(mrry): We must unref the iterator before calling `done()`, to
           // avoid destruction races.
           iterator->Unref();
@@ -1073,8 +1220,12 @@ class IteratorGetNextSyncOp : public OpKernel {
     };
     IteratorContext iter_ctx(std::move(params));
 
-    OP_REQUIRES_OK(ctx,
-                   iterator->GetNext(&iter_ctx, &components, &end_of_sequence));
+    Status s;
+    {
+      ScopedStepProfile step_profile(ctx, iterator->model());
+      s = iterator->GetNext(&iter_ctx, &components, &end_of_sequence);
+    }
+    OP_REQUIRES_OK(ctx, s);
     OP_REQUIRES(ctx, !end_of_sequence, errors::OutOfRange("End of sequence"));
 
     for (int i = 0; i < components.size(); ++i) {
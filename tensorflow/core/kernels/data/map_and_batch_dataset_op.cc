@@ -17,6 +17,7 @@ limitations under the License.
 #include <utility>
 
 #include "tensorflow/core/common_runtime/function.h"
+#include "tensorflow/core/framework/model.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/kernels/data/captured_function.h"
@@ -26,6 +27,7 @@ limitations under the License.
 #include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/tracing.h"
 
 namespace tensorflow {
@@ -69,17 +71,23 @@ class MapAndBatchDatasetOp : public UnaryDatasetOpKernel {
         int64 num_parallel_batches;
         OP_REQUIRES_OK(ctx, ParseScalarArgument(ctx, "num_parallel_batches",
                                                 &num_parallel_batches));
-        num_parallel_calls = num_parallel_batches * batch_size;
-        OP_REQUIRES(ctx, num_parallel_batches > 0,
+        OP_REQUIRES(ctx,
+                    num_parallel_batches > 0 ||
+                        num_parallel_batches == model::kAutoTune,
                     errors::InvalidArgument(
                         "num_parallel_batches must be greater than zero."));
+        num_parallel_calls = num_parallel_batches == model::kAutoTune
+                                 ? model::kAutoTune
+                                 : num_parallel_batches * batch_size;
         break;
       case 2:
         OP_REQUIRES_OK(ctx, ParseScalarArgument(ctx, "num_parallel_calls",
                                                 &num_parallel_calls));
-        OP_REQUIRES(ctx, num_parallel_calls > 0,
-                    errors::InvalidArgument(
-                        "num_parallel_calls must be greater than zero."));
+        OP_REQUIRES(
+            ctx,
+            num_parallel_calls > 0 || num_parallel_calls == model::kAutoTune,
+            errors::InvalidArgument(
+                "num_parallel_calls must be greater than zero."));
         break;
       default:
         OP_REQUIRES(ctx, false,
@@ -192,6 +200,9 @@ class MapAndBatchDatasetOp : public UnaryDatasetOpKernel {
           : DatasetIterator<Dataset>(params) {}
 
       ~Iterator() override {
+        if (num_parallel_calls_) {
+          num_parallel_calls_->Detach();
+        }
         mutex_lock l(mu_);
         // Cancel the runner thread.
         cancelled_ = true;
@@ -203,6 +214,22 @@ class MapAndBatchDatasetOp : public UnaryDatasetOpKernel {
       }
 
       Status Initialize(IteratorContext* ctx) override {
+        const int64 num_parallel_calls = dataset()->num_parallel_calls_;
+        if (num_parallel_calls == model::kAutoTune) {
+          // Without a model, one call per core is the best guess.
+          default_num_parallel_calls_ = port::NumSchedulableCPUs();
+          num_parallel_calls_ = AddTunable(
+              model::Tunable::Kind::kParallelism, model::kAutoTune, 1,
+              port::NumSchedulableCPUs(), [this]() {
+                mutex_lock l(mu_);
+                cond_var_.notify_all();
+              });
+        } else {
+          default_num_parallel_calls_ = num_parallel_calls;
+          num_parallel_calls_ =
+              AddTunable(model::Tunable::Kind::kParallelism, num_parallel_calls,
+                         num_parallel_calls, num_parallel_calls, nullptr);
+        }
         return dataset()->input_->MakeIterator(ctx, prefix(), &input_impl_);
       }
 
@@ -358,9 +385,17 @@ class MapAndBatchDatasetOp : public UnaryDatasetOpKernel {
                                    std::vector<Tensor> input_element) {
               std::shared_ptr<std::vector<Tensor>> return_values(
                   new std::vector<Tensor>());
+              const bool collecting = model_collecting();
+              const int64 start_micros =
+                  collecting ? ctx->env()->NowMicros() : 0;
               dataset()->captured_func_->RunAsync(
                   ctx.get(), std::move(input_element), return_values.get(),
-                  [this, ctx, result, return_values, offset](Status status) {
+                  [this, ctx, result, return_values, offset, collecting,
+                   start_micros](Status status) {
+                    if (collecting) {
+                      AddProcessingTime(
+                          (ctx->env()->NowMicros() - start_micros) * 1000);
+                    }
                     Callback(ctx, result, return_values, offset, status);
                   });
             },
@@ -419,8 +454,15 @@ class MapAndBatchDatasetOp : public UnaryDatasetOpKernel {
         result->output_allocated = true;
       }
 
+      // The number of calls that may be in flight, which the model of the
+      // input pipeline may change at any time.
+      int64 NumParallelCalls() {
+        return num_parallel_calls_ ? num_parallel_calls_->value()
+                                   : default_num_parallel_calls_;
+      }
+
       int MaxBatchResults() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
-        return (dataset()->num_parallel_calls_ + dataset()->batch_size_ - 1) /
+        return (NumParallelCalls() + dataset()->batch_size_ - 1) /
                dataset()->batch_size_;
       }
 
@@ -472,12 +514,12 @@ class MapAndBatchDatasetOp : public UnaryDatasetOpKernel {
       void RunnerThread(const std::shared_ptr<IteratorContext>& ctx)
           LOCKS_EXCLUDED(mu_) {
         std::vector<std::pair<std::shared_ptr<BatchResult>, int64>> new_calls;
-        new_calls.reserve(dataset()->num_parallel_calls_);
+        new_calls.reserve(NumParallelCalls());
         while (true) {
           {
             mutex_lock l(mu_);
             while (!cancelled_ &&
-                   (num_calls_ >= dataset()->num_parallel_calls_ ||
+                   (num_calls_ >= NumParallelCalls() ||
                     batch_results_.size() > MaxBatchResults() ||
                     (batch_results_.size() == MaxBatchResults() &&
                      call_counter_ % dataset()->batch_size_ == 0))) {
@@ -488,7 +530,7 @@ class MapAndBatchDatasetOp : public UnaryDatasetOpKernel {
               return;
             }
 
-            while (num_calls_ < dataset()->num_parallel_calls_ &&
+            while (num_calls_ < NumParallelCalls() &&
                    (batch_results_.size() < MaxBatchResults() ||
                     (batch_results_.size() == MaxBatchResults() &&
                      call_counter_ % dataset()->batch_size_ != 0))) {
@@ -644,6 +686,10 @@ class MapAndBatchDatasetOp : public UnaryDatasetOpKernel {
       std::deque<std::shared_ptr<BatchResult>> batch_results_ GUARDED_BY(mu_);
       std::unique_ptr<Thread> runner_thread_ GUARDED_BY(mu_);
       bool cancelled_ GUARDED_BY(mu_) = false;
+      // Set when the iterator has a model; may be tuned if the dataset was
+      // created with `num_parallel_calls` set to `model::kAutoTune`.
+      std::shared_ptr<model::Tunable> num_parallel_calls_;
+      int64 default_num_parallel_calls_ = 0;
     };
 
     const DatasetBase* const input_;
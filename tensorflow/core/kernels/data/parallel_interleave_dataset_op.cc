@@ -15,6 +15,7 @@ limitations under the License.
 #include <deque>
 
 #include "tensorflow/core/common_runtime/function.h"
+#include "tensorflow/core/framework/model.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/kernels/data/captured_function.h"
@@ -28,6 +29,10 @@ namespace tensorflow {
 
 namespace {
 
+// The largest per-iterator output buffer the model of the input pipeline may
+// choose for an autotuned `buffer_output_elements`.
+constexpr int64 kMaxBufferOutputElements = 64;
+
 // See documentation in ../ops/dataset_ops.cc for a high-level
 // description of the following op.
 
@@ -69,9 +74,11 @@ class ParallelInterleaveDatasetOp : public UnaryDatasetOpKernel {
     int64 buffer_output_elements = 0;
     OP_REQUIRES_OK(ctx, ParseScalarArgument(ctx, "buffer_output_elements",
                                             &buffer_output_elements));
-    OP_REQUIRES(
-        ctx, buffer_output_elements > 0,
-        errors::InvalidArgument("`buffer_output_elements` must be > 0"));
+    OP_REQUIRES(ctx,
+                buffer_output_elements > 0 ||
+                    buffer_output_elements == model::kAutoTune,
+                errors::InvalidArgument(
+                    "`buffer_output_elements` must be > 0"));
 
     int64 prefetch_input_elements = 0;
     OP_REQUIRES_OK(ctx, ParseScalarArgument(ctx, "prefetch_input_elements",
@@ -240,6 +247,9 @@ class ParallelInterleaveDatasetOp : public UnaryDatasetOpKernel {
             worker_thread_states_(dataset()->num_threads()) {}
 
       ~Iterator() override {
+        if (buffer_output_elements_) {
+          buffer_output_elements_->Detach();
+        }
         mutex_lock l(mu_);
         cancelled_ = true;
         // Notify all workers in case they are blocked.
@@ -249,6 +259,28 @@ class ParallelInterleaveDatasetOp : public UnaryDatasetOpKernel {
       }
 
       Status Initialize(IteratorContext* ctx) override {
+        // The worker threads run the interleaved iterators in parallel. Their
+        // number decides the order of the output, so only the size of their
+        // output buffers is tuned.
+        const int64 num_threads = dataset()->num_threads();
+        num_threads_ = AddTunable(model::Tunable::Kind::kParallelism,
+                                  num_threads, num_threads, num_threads,
+                                  nullptr);
+        const int64 buffer_output_elements = dataset()->buffer_output_elements_;
+        if (buffer_output_elements == model::kAutoTune) {
+          buffer_output_elements_ = AddTunable(
+              model::Tunable::Kind::kBufferSize, model::kAutoTune, 1,
+              kMaxBufferOutputElements, [this]() {
+                mutex_lock l(mu_);
+                for (auto& worker : workers_) {
+                  worker.cond_var.notify_all();
+                }
+              });
+        } else {
+          buffer_output_elements_ = AddTunable(
+              model::Tunable::Kind::kBufferSize, buffer_output_elements,
+              buffer_output_elements, buffer_output_elements, nullptr);
+        }
         return dataset()->input_->MakeIterator(ctx, prefix(), &input_impl_);
       }
 
@@ -260,6 +292,7 @@ class ParallelInterleaveDatasetOp : public UnaryDatasetOpKernel {
                              bool* end_of_sequence) override {
         mutex_lock l(mu_);
         TF_RETURN_IF_ERROR(EnsureWorkerThreadsStarted(ctx));
+        bool waited = false;
         while (!cancelled_) {
           // Wait for an item to become available, blocking if necessary. If we
           // are allowed to be sloppy, we can skip over input datasets that do
@@ -287,6 +320,12 @@ class ParallelInterleaveDatasetOp : public UnaryDatasetOpKernel {
                 block_count_ = 0;
               }
               *end_of_sequence = false;
+              const int64 buffered =
+                  waited ? 0 : current_worker->outputs.size();
+              if (buffer_output_elements_) {
+                buffer_output_elements_->RecordConsumption(buffered);
+              }
+              RecordBufferSize(ctx, buffered);
               Status s = current_worker->outputs.front().status;
               current_worker->outputs.front().output.swap(*out_tensors);
               current_worker->outputs.pop_front();
@@ -341,6 +380,7 @@ class ParallelInterleaveDatasetOp : public UnaryDatasetOpKernel {
 
           if (must_wait_for_input) {
             // Wait for elements to become available.
+            waited = true;
             if (dataset()->sloppy_) {
               sloppy_cond_var_.wait(l);
             } else {
@@ -496,6 +536,19 @@ class ParallelInterleaveDatasetOp : public UnaryDatasetOpKernel {
         explicit OutputElem(const Status& s) : status(s) {}
       };
 
+      // The number of elements each worker may buffer, which the model of the
+      // input pipeline may change at any time. Without a model, an autotuned
+      // buffer defaults to two blocks.
+      int64 BufferOutputElements() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        if (buffer_output_elements_) {
+          return buffer_output_elements_->value();
+        }
+        if (dataset()->buffer_output_elements_ == model::kAutoTune) {
+          return 2 * dataset()->block_length_;
+        }
+        return dataset()->buffer_output_elements_;
+      }
+
       // Worker threads operate on their relevant WorkerState structs.
       //
       // WorkerState's fields are all protected by mu_;
@@ -703,8 +756,9 @@ class ParallelInterleaveDatasetOp : public UnaryDatasetOpKernel {
           if (!iterator_creation_status.ok()) {
             mutex_lock l(mu_);
             // Wait for space in the prefetch queue.
-            while (!cancelled_ && workers_[thread_index].outputs.size() ==
-                                      dataset()->buffer_output_elements_) {
+            while (!cancelled_ &&
+                   static_cast<int64>(workers_[thread_index].outputs.size()) >=
+                       BufferOutputElements()) {
               workers_[thread_index].cond_var.wait(l);
             }
             if (cancelled_) return;
@@ -752,8 +806,10 @@ class ParallelInterleaveDatasetOp : public UnaryDatasetOpKernel {
                 mutex_lock l(mu_);
 
                 // Wait for space in the prefetch queue.
-                while (!cancelled_ && workers_[thread_index].outputs.size() ==
-                                          dataset()->buffer_output_elements_) {
+                while (!cancelled_ &&
+                       static_cast<int64>(
+                           workers_[thread_index].outputs.size()) >=
+                           BufferOutputElements()) {
                   workers_[thread_index].cond_var.wait(l);
                 }
                 if (cancelled_) return;
@@ -1032,6 +1088,9 @@ class ParallelInterleaveDatasetOp : public UnaryDatasetOpKernel {
       size_t block_count_ GUARDED_BY(mu_) = 0;
       // Flag to instruct the worker threads to exit.
       bool cancelled_ GUARDED_BY(mu_) = false;
+      // Set when the iterator has a model.
+      std::shared_ptr<model::Tunable> num_threads_;
+      std::shared_ptr<model::Tunable> buffer_output_elements_;
       // The worker threads. This must be last to ensure the
       // threads have exited before any other members are deallocated.
       // TODO(b/65178177): Avoid allocating additional threads.
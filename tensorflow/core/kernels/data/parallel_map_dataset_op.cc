@@ -15,12 +15,14 @@ limitations under the License.
 #include <deque>
 
 #include "tensorflow/core/common_runtime/function.h"
+#include "tensorflow/core/framework/model.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/kernels/data/captured_function.h"
 #include "tensorflow/core/kernels/data/dataset.h"
 #include "tensorflow/core/lib/core/error_codes.pb.h"
 #include "tensorflow/core/lib/random/random.h"
+#include "tensorflow/core/platform/cpu_info.h"
 
 namespace tensorflow {
 
@@ -53,9 +55,10 @@ class ParallelMapDatasetOp : public UnaryDatasetOpKernel {
     int32 num_parallel_calls;
     OP_REQUIRES_OK(ctx, ParseScalarArgument(ctx, "num_parallel_calls",
                                             &num_parallel_calls));
-    OP_REQUIRES(ctx, num_parallel_calls > 0,
-                errors::InvalidArgument(
-                    "num_parallel_calls must be greater than zero."));
+    OP_REQUIRES(
+        ctx, num_parallel_calls > 0 || num_parallel_calls == model::kAutoTune,
+        errors::InvalidArgument(
+            "num_parallel_calls must be greater than zero."));
 
     std::unique_ptr<CapturedFunction> captured_func;
     OP_REQUIRES_OK(ctx, CapturedFunction::Create(
@@ -154,6 +157,9 @@ class ParallelMapDatasetOp : public UnaryDatasetOpKernel {
           : DatasetIterator<Dataset>(params) {}
 
       ~Iterator() override {
+        if (num_parallel_calls_) {
+          num_parallel_calls_->Detach();
+        }
         // TODO(mrry): Replace this cancellation logic with a
         // CancellationManager. The syntax would be more heavyweight,
         // but it would be possible to thread a cancellation manager
@@ -170,6 +176,22 @@ class ParallelMapDatasetOp : public UnaryDatasetOpKernel {
       }
 
       Status Initialize(IteratorContext* ctx) override {
+        const int64 num_parallel_calls = dataset()->num_parallel_calls_;
+        if (num_parallel_calls == model::kAutoTune) {
+          // Without a model, one call per core is the best guess.
+          default_num_parallel_calls_ = port::NumSchedulableCPUs();
+          num_parallel_calls_ = AddTunable(
+              model::Tunable::Kind::kParallelism, model::kAutoTune, 1,
+              port::NumSchedulableCPUs(), [this]() {
+                mutex_lock l(mu_);
+                cond_var_.notify_all();
+              });
+        } else {
+          default_num_parallel_calls_ = num_parallel_calls;
+          num_parallel_calls_ =
+              AddTunable(model::Tunable::Kind::kParallelism, num_parallel_calls,
+                         num_parallel_calls, num_parallel_calls, nullptr);
+        }
         return dataset()->input_->MakeIterator(ctx, prefix(), &input_impl_);
       }
 
@@ -307,7 +329,13 @@ class ParallelMapDatasetOp : public UnaryDatasetOpKernel {
         // Call `func_(input_element)`, store the result in
         // `result->return_values`, and notify `result->notification` to unblock
         // a consumer.
-        auto done = [this, result](Status status) {
+        const bool collecting = model_collecting();
+        const int64 start_micros = collecting ? ctx->env()->NowMicros() : 0;
+        auto done = [this, ctx, result, collecting,
+                     start_micros](Status status) {
+          if (collecting) {
+            AddProcessingTime((ctx->env()->NowMicros() - start_micros) * 1000);
+          }
           result->status.Update(status);
           CallCompleted(result);
         };
@@ -315,7 +343,14 @@ class ParallelMapDatasetOp : public UnaryDatasetOpKernel {
                                             &result->return_values, done);
       }
 
-      int64 MaxInvocationResults() { return dataset()->num_parallel_calls_; }
+      // The number of calls that may be in flight, which the model of the
+      // input pipeline may change at any time.
+      int64 NumParallelCalls() {
+        return num_parallel_calls_ ? num_parallel_calls_->value()
+                                   : default_num_parallel_calls_;
+      }
+
+      int64 MaxInvocationResults() { return NumParallelCalls(); }
 
       Status ProcessResult(const std::shared_ptr<InvocationResult>& result,
                            std::vector<Tensor>* out_tensors,
@@ -337,19 +372,19 @@ class ParallelMapDatasetOp : public UnaryDatasetOpKernel {
 
       void RunnerThread(const std::shared_ptr<IteratorContext>& ctx) {
         std::vector<std::shared_ptr<InvocationResult>> new_calls;
-        new_calls.reserve(dataset()->num_parallel_calls_);
+        new_calls.reserve(NumParallelCalls());
         while (true) {
           {
             mutex_lock l(mu_);
             while (!cancelled_ &&
-                   (num_calls_ >= dataset()->num_parallel_calls_ ||
+                   (num_calls_ >= NumParallelCalls() ||
                     invocation_results_.size() >= MaxInvocationResults())) {
               cond_var_.wait(l);
             }
             if (cancelled_) {
               return;
             }
-            while (num_calls_ < dataset()->num_parallel_calls_ &&
+            while (num_calls_ < NumParallelCalls() &&
                    invocation_results_.size() < MaxInvocationResults()) {
               invocation_results_.emplace_back(new InvocationResult());
               new_calls.push_back(invocation_results_.back());
@@ -419,6 +454,10 @@ class ParallelMapDatasetOp : public UnaryDatasetOpKernel {
           GUARDED_BY(mu_);
       std::unique_ptr<Thread> runner_thread_ GUARDED_BY(mu_);
       bool cancelled_ GUARDED_BY(mu_) = false;
+      // Set when the iterator has a model; may be tuned if the dataset was
+      // created with `num_parallel_calls` set to `model::kAutoTune`.
+      std::shared_ptr<model::Tunable> num_parallel_calls_;
+      int64 default_num_parallel_calls_ = 0;
     };
 
     const DatasetBase* const input_;
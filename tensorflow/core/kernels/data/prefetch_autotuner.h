@@ -35,6 +35,10 @@ namespace tensorflow {
 // Note: in the current implementation, we never decrease the buffer_limit().
 // This should change in the future!
 //
+// Prefetch iterators that are created with a performance model of their input
+// pipeline (see framework/model.h) let the model tune their buffer size
+// instead.
+//
 // PrefetchAutotuner is NOT thread safe.
 class PrefetchAutotuner {
  public:
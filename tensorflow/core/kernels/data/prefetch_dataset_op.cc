@@ -14,6 +14,7 @@ limitations under the License.
 ==============================================================================*/
 #include <deque>
 
+#include "tensorflow/core/framework/model.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/kernels/data/dataset.h"
@@ -24,6 +25,10 @@ namespace tensorflow {
 
 namespace {
 
+// The largest buffer the model of the input pipeline may choose for an
+// autotuned `buffer_size`.
+constexpr int64 kMaxBufferSize = 1024;
+
 // See documentation in ../ops/dataset_ops.cc for a high-level
 // description of the following op.
 
@@ -98,6 +103,9 @@ class PrefetchDatasetOp : public UnaryDatasetOpKernel {
         // but it would be possible to thread a cancellation manager
         // through the IteratorContext to upstream,
         // potentially-blocking iterators, when we add these.
+        if (buffer_size_) {
+          buffer_size_->Detach();
+        }
         {
           mutex_lock l(mu_);
           cancelled_ = true;
@@ -106,6 +114,21 @@ class PrefetchDatasetOp : public UnaryDatasetOpKernel {
       }
 
       Status Initialize(IteratorContext* ctx) override {
+        // With a model, the buffer size is tuned by the model for the whole
+        // input pipeline instead of by `auto_tuner_`.
+        const int64 buffer_size = dataset()->buffer_size_;
+        if (buffer_size == PrefetchAutotuner::kAutoTune) {
+          buffer_size_ = AddTunable(model::Tunable::Kind::kBufferSize,
+                                    model::kAutoTune, 1, kMaxBufferSize,
+                                    [this]() {
+                                      mutex_lock l(mu_);
+                                      cond_var_.notify_all();
+                                    });
+        } else {
+          buffer_size_ = AddTunable(model::Tunable::Kind::kBufferSize,
+                                    buffer_size, buffer_size, buffer_size,
+                                    nullptr);
+        }
         return dataset()->input_->MakeIterator(ctx, prefix(), &input_impl_);
       }
 
@@ -117,9 +140,12 @@ class PrefetchDatasetOp : public UnaryDatasetOpKernel {
           TF_RETURN_IF_ERROR(EnsurePrefetchThreadStarted(ctx));
           // Wait until the next element in the buffer has been
           // produced, or we are shutting down.
+          const size_t buffered = buffer_.size();
           while (!cancelled_ && buffer_.empty() && !prefetch_thread_finished_ &&
-                 auto_tuner_.buffer_limit() != 0) {
-            auto_tuner_.RecordEmpty();
+                 BufferLimit() != 0) {
+            if (!buffer_size_) {
+              auto_tuner_.RecordEmpty();
+            }
             cond_var_.wait(l);
           }
 
@@ -129,6 +155,10 @@ class PrefetchDatasetOp : public UnaryDatasetOpKernel {
           }
 
           if (!buffer_.empty()) {
+            if (buffer_size_) {
+              buffer_size_->RecordConsumption(buffered);
+            }
+            RecordBufferSize(ctx, buffered);
             return Consume(out_tensors, end_of_sequence);
           }
 
@@ -137,7 +167,7 @@ class PrefetchDatasetOp : public UnaryDatasetOpKernel {
             return Status::OK();
           }
 
-          DCHECK_EQ(auto_tuner_.buffer_limit(), 0);
+          DCHECK_EQ(BufferLimit(), 0);
         }
 
         mutex_lock parent_l(parent_mu_);
@@ -218,6 +248,13 @@ class PrefetchDatasetOp : public UnaryDatasetOpKernel {
         std::vector<Tensor> value;
       };
 
+      // The number of elements to prefetch, which the model of the input
+      // pipeline may change at any time.
+      int64 BufferLimit() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        return buffer_size_ ? buffer_size_->value()
+                            : auto_tuner_.buffer_limit();
+      }
+
       Status Consume(std::vector<Tensor>* out_tensors, bool* end_of_sequence)
           EXCLUSIVE_LOCKS_REQUIRED(mu_) {
         // A new element is available. Forward the status from computing it, and
@@ -262,7 +299,7 @@ class PrefetchDatasetOp : public UnaryDatasetOpKernel {
           {
             mutex_lock l(mu_);
             while (!cancelled_ &&
-                   buffer_.size() >= auto_tuner_.buffer_limit()) {
+                   static_cast<int64>(buffer_.size()) >= BufferLimit()) {
               cond_var_.wait(l);
             }
 
@@ -344,6 +381,8 @@ class PrefetchDatasetOp : public UnaryDatasetOpKernel {
       std::unique_ptr<IteratorBase> input_impl_ GUARDED_BY(parent_mu_);
       condition_variable cond_var_;
       PrefetchAutotuner auto_tuner_ GUARDED_BY(mu_);
+      // Set when the iterator has a model.
+      std::shared_ptr<model::Tunable> buffer_size_;
       std::deque<BufferElement> buffer_ GUARDED_BY(mu_);
       std::unique_ptr<Thread> prefetch_thread_ GUARDED_BY(mu_);
       bool cancelled_ GUARDED_BY(mu_) = false;
@@ -19,23 +19,72 @@ limitations under the License.
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/kernels/data/dataset.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/io/buffered_inputstream.h"
 #include "tensorflow/core/lib/io/inputbuffer.h"
 #include "tensorflow/core/lib/io/random_inputstream.h"
+#include "tensorflow/core/lib/io/readahead_random_access_file.h"
 #include "tensorflow/core/lib/io/record_reader.h"
 #include "tensorflow/core/lib/io/zlib_compression_options.h"
 #include "tensorflow/core/lib/io/zlib_inputstream.h"
+#include "tensorflow/core/platform/cpu_info.h"
 
 namespace tensorflow {
 
 namespace {
 
+// The size of the blocks that are read ahead when `buffer_size` is 0.
+constexpr int64 kDefaultReadaheadBlockSize = 256 << 10;
+
+// Returns the thread pool on which the files of all the datasets below are
+// read ahead. Its threads mostly wait for I/O, so there are more of them than
+// CPUs.
+thread::ThreadPool* ReadaheadThreadPool() {
+  static thread::ThreadPool* pool = new thread::ThreadPool(
+      Env::Default(), "tf_data_readahead",
+      std::max(16, 2 * port::NumSchedulableCPUs()));
+  return pool;
+}
+
+// Returns the thread pool on which the checksums of mapped TFRecord files are
+// verified. It is separate from the runners of the iterators, because the
+// iterators wait for the verification while holding their locks and must not
+// depend on the threads that may be blocked on them.
+thread::ThreadPool* VerifyChecksumsThreadPool() {
+  static thread::ThreadPool* pool =
+      new thread::ThreadPool(Env::Default(), "tf_record_verify",
+                             std::max(1, port::NumSchedulableCPUs()));
+  return pool;
+}
+
+// Opens `filename` for reading. If `num_readahead_blocks` is positive, the
+// returned file reads up to that many blocks of `block_size` bytes ahead of
+// its reader.
+Status NewRandomAccessFile(Env* env, const string& filename, int64 block_size,
+                           int64 num_readahead_blocks,
+                           std::unique_ptr<RandomAccessFile>* result) {
+  std::unique_ptr<RandomAccessFile> file;
+  TF_RETURN_IF_ERROR(env->NewRandomAccessFile(filename, &file));
+  if (num_readahead_blocks > 0) {
+    file.reset(new io::ReadaheadRandomAccessFile(
+        std::move(file), ReadaheadThreadPool(),
+        block_size > 0 ? block_size : kDefaultReadaheadBlockSize,
+        num_readahead_blocks));
+  }
+  *result = std::move(file);
+  return Status::OK();
+}
+
 // See documentation in ../ops/dataset_ops.cc for a high-level
 // description of the following ops.
 
 class TextLineDatasetOp : public DatasetOpKernel {
  public:
-  using DatasetOpKernel::DatasetOpKernel;
+  explicit TextLineDatasetOp(OpKernelConstruction* ctx)
+      : DatasetOpKernel(ctx) {
+    OP_REQUIRES_OK(
+        ctx, ctx->GetAttr("num_readahead_blocks", &num_readahead_blocks_));
+  }
 
   void MakeDataset(OpKernelContext* ctx, DatasetBase** output) override {
     const Tensor* filenames_tensor;
@@ -78,7 +127,7 @@ class TextLineDatasetOp : public DatasetOpKernel {
     }
 
     *output = new Dataset(ctx, std::move(filenames), compression_type,
-                          zlib_compression_options);
+                          zlib_compression_options, num_readahead_blocks_);
   }
 
  private:
@@ -86,12 +135,14 @@ class TextLineDatasetOp : public DatasetOpKernel {
    public:
     Dataset(OpKernelContext* ctx, std::vector<string> filenames,
             const string& compression_type,
-            const io::ZlibCompressionOptions& options)
+            const io::ZlibCompressionOptions& options,
+            int64 num_readahead_blocks)
         : GraphDatasetBase(ctx),
           filenames_(std::move(filenames)),
           compression_type_(compression_type),
           use_compression_(!compression_type.empty()),
-          options_(options) {}
+          options_(options),
+          num_readahead_blocks_(num_readahead_blocks) {}
 
     std::unique_ptr<IteratorBase> MakeIteratorInternal(
         const string& prefix) const override {
@@ -122,8 +173,12 @@ class TextLineDatasetOp : public DatasetOpKernel {
       TF_RETURN_IF_ERROR(b->AddScalar(compression_type_, &compression_type));
       TF_RETURN_IF_ERROR(
           b->AddScalar(options_.input_buffer_size, &buffer_size));
+      AttrValue num_readahead_blocks;
+      b->BuildAttrValue(num_readahead_blocks_, &num_readahead_blocks);
       TF_RETURN_IF_ERROR(b->AddDataset(
-          this, {filenames, compression_type, buffer_size}, output));
+          this, {filenames, compression_type, buffer_size},
+          {std::make_pair("num_readahead_blocks", num_readahead_blocks)},
+          output));
       return Status::OK();
     }
 
@@ -217,8 +272,10 @@ class TextLineDatasetOp : public DatasetOpKernel {
         }
 
         // Actually move on to next file.
-        TF_RETURN_IF_ERROR(env->NewRandomAccessFile(
-            dataset()->filenames_[current_file_index_], &file_));
+        TF_RETURN_IF_ERROR(NewRandomAccessFile(
+            env, dataset()->filenames_[current_file_index_],
+            dataset()->options_.input_buffer_size,
+            dataset()->num_readahead_blocks_, &file_));
         input_stream_.reset(
             new io::RandomAccessInputStream(file_.get(), false));
 
@@ -260,7 +317,10 @@ class TextLineDatasetOp : public DatasetOpKernel {
     const string compression_type_;
     const bool use_compression_;
     const io::ZlibCompressionOptions options_;
+    const int64 num_readahead_blocks_;
   };
+
+  int64 num_readahead_blocks_;
 };
 
 REGISTER_KERNEL_BUILDER(Name("TextLineDataset").Device(DEVICE_CPU),
@@ -268,7 +328,11 @@ REGISTER_KERNEL_BUILDER(Name("TextLineDataset").Device(DEVICE_CPU),
 
 class FixedLengthRecordDatasetOp : public DatasetOpKernel {
  public:
-  using DatasetOpKernel::DatasetOpKernel;
+  explicit FixedLengthRecordDatasetOp(OpKernelConstruction* ctx)
+      : DatasetOpKernel(ctx) {
+    OP_REQUIRES_OK(
+        ctx, ctx->GetAttr("num_readahead_blocks", &num_readahead_blocks_));
+  }
 
   void MakeDataset(OpKernelContext* ctx, DatasetBase** output) override {
     const Tensor* filenames_tensor;
@@ -311,7 +375,7 @@ class FixedLengthRecordDatasetOp : public DatasetOpKernel {
     }
 
     *output = new Dataset(ctx, std::move(filenames), header_bytes, record_bytes,
-                          footer_bytes, buffer_size);
+                          footer_bytes, buffer_size, num_readahead_blocks_);
   }
 
  private:
@@ -319,13 +383,14 @@ class FixedLengthRecordDatasetOp : public DatasetOpKernel {
    public:
     explicit Dataset(OpKernelContext* ctx, std::vector<string> filenames,
                      int64 header_bytes, int64 record_bytes, int64 footer_bytes,
-                     int64 buffer_size)
+                     int64 buffer_size, int64 num_readahead_blocks)
         : GraphDatasetBase(ctx),
           filenames_(std::move(filenames)),
           header_bytes_(header_bytes),
           record_bytes_(record_bytes),
           footer_bytes_(footer_bytes),
-          buffer_size_(buffer_size) {}
+          buffer_size_(buffer_size),
+          num_readahead_blocks_(num_readahead_blocks) {}
 
     std::unique_ptr<IteratorBase> MakeIteratorInternal(
         const string& prefix) const override {
@@ -361,9 +426,12 @@ class FixedLengthRecordDatasetOp : public DatasetOpKernel {
       TF_RETURN_IF_ERROR(b->AddScalar(record_bytes_, &record_bytes));
       TF_RETURN_IF_ERROR(b->AddScalar(footer_bytes_, &footer_bytes));
       TF_RETURN_IF_ERROR(b->AddScalar(buffer_size_, &buffer_size));
+      AttrValue num_readahead_blocks;
+      b->BuildAttrValue(num_readahead_blocks_, &num_readahead_blocks);
       TF_RETURN_IF_ERROR(b->AddDataset(
           this,
           {filenames, header_bytes, record_bytes, footer_bytes, buffer_size},
+          {std::make_pair("num_readahead_blocks", num_readahead_blocks)},
           output));
       return Status::OK();
     }
@@ -427,8 +495,10 @@ class FixedLengthRecordDatasetOp : public DatasetOpKernel {
                 " bytes, which is not an exact multiple of the record length (",
                 dataset()->record_bytes_, " bytes).");
           }
-          TF_RETURN_IF_ERROR(ctx->env()->NewRandomAccessFile(
-              dataset()->filenames_[current_file_index_], &file_));
+          TF_RETURN_IF_ERROR(NewRandomAccessFile(
+              ctx->env(), dataset()->filenames_[current_file_index_],
+              dataset()->buffer_size_, dataset()->num_readahead_blocks_,
+              &file_));
           input_buffer_.reset(
               new io::InputBuffer(file_.get(), dataset()->buffer_size_));
           TF_RETURN_IF_ERROR(
@@ -470,8 +540,10 @@ class FixedLengthRecordDatasetOp : public DatasetOpKernel {
           TF_RETURN_IF_ERROR(ctx->env()->GetFileSize(
               dataset()->filenames_[current_file_index_], &file_size));
           file_pos_limit_ = file_size - dataset()->footer_bytes_;
-          TF_RETURN_IF_ERROR(ctx->env()->NewRandomAccessFile(
-              dataset()->filenames_[current_file_index_], &file_));
+          TF_RETURN_IF_ERROR(NewRandomAccessFile(
+              ctx->env(), dataset()->filenames_[current_file_index_],
+              dataset()->buffer_size_, dataset()->num_readahead_blocks_,
+              &file_));
           input_buffer_.reset(
               new io::InputBuffer(file_.get(), dataset()->buffer_size_));
           TF_RETURN_IF_ERROR(input_buffer_->Seek(current_pos));
@@ -494,7 +566,10 @@ class FixedLengthRecordDatasetOp : public DatasetOpKernel {
     const int64 record_bytes_;
     const int64 footer_bytes_;
     const int64 buffer_size_;
+    const int64 num_readahead_blocks_;
   };
+
+  int64 num_readahead_blocks_;
 };
 
 REGISTER_KERNEL_BUILDER(Name("FixedLengthRecordDataset").Device(DEVICE_CPU),
@@ -502,7 +577,12 @@ REGISTER_KERNEL_BUILDER(Name("FixedLengthRecordDataset").Device(DEVICE_CPU),
 
 class TFRecordDatasetOp : public DatasetOpKernel {
  public:
-  using DatasetOpKernel::DatasetOpKernel;
+  explicit TFRecordDatasetOp(OpKernelConstruction* ctx)
+      : DatasetOpKernel(ctx) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("use_mmap", &use_mmap_));
+    OP_REQUIRES_OK(
+        ctx, ctx->GetAttr("num_readahead_blocks", &num_readahead_blocks_));
+  }
 
   void MakeDataset(OpKernelContext* ctx, DatasetBase** output) override {
     const Tensor* filenames_tensor;
@@ -527,19 +607,25 @@ class TFRecordDatasetOp : public DatasetOpKernel {
     OP_REQUIRES(ctx, buffer_size >= 0,
                 errors::InvalidArgument(
                     "`buffer_size` must be >= 0 (0 == no buffering)"));
+    OP_REQUIRES(ctx, !use_mmap_ || compression_type.empty(),
+                errors::InvalidArgument(
+                    "`use_mmap` is not supported for compressed files."));
 
-    *output =
-        new Dataset(ctx, std::move(filenames), compression_type, buffer_size);
+    *output = new Dataset(ctx, std::move(filenames), compression_type,
+                          buffer_size, use_mmap_, num_readahead_blocks_);
   }
 
  private:
   class Dataset : public GraphDatasetBase {
    public:
     explicit Dataset(OpKernelContext* ctx, std::vector<string> filenames,
-                     const string& compression_type, int64 buffer_size)
+                     const string& compression_type, int64 buffer_size,
+                     bool use_mmap, int64 num_readahead_blocks)
         : GraphDatasetBase(ctx),
           filenames_(std::move(filenames)),
           compression_type_(compression_type),
+          use_mmap_(use_mmap),
+          num_readahead_blocks_(num_readahead_blocks),
           options_(io::RecordReaderOptions::CreateRecordReaderOptions(
               compression_type)) {
       if (buffer_size > 0) {
@@ -575,8 +661,15 @@ class TFRecordDatasetOp : public DatasetOpKernel {
       TF_RETURN_IF_ERROR(b->AddScalar(compression_type_, &compression_type));
       Node* buffer_size = nullptr;
       TF_RETURN_IF_ERROR(b->AddScalar(options_.buffer_size, &buffer_size));
+      AttrValue use_mmap;
+      b->BuildAttrValue(use_mmap_, &use_mmap);
+      AttrValue num_readahead_blocks;
+      b->BuildAttrValue(num_readahead_blocks_, &num_readahead_blocks);
       TF_RETURN_IF_ERROR(b->AddDataset(
-          this, {filenames, compression_type, buffer_size}, output));
+          this, {filenames, compression_type, buffer_size},
+          {std::make_pair("use_mmap", use_mmap),
+           std::make_pair("num_readahead_blocks", num_readahead_blocks)},
+          output));
       return Status::OK();
     }
 
@@ -592,9 +685,21 @@ class TFRecordDatasetOp : public DatasetOpKernel {
         mutex_lock l(mu_);
         do {
           // We are currently processing a file, so try to read the next record.
-          if (reader_) {
+          if (reader_ || mmap_reader_) {
             Tensor result_tensor(ctx->allocator({}), DT_STRING, {});
-            Status s = reader_->ReadRecord(&result_tensor.scalar<string>()());
+            Status s;
+            if (mmap_reader_) {
+              // String tensors own their bytes, so the record is copied once,
+              // straight from the mapping.
+              StringPiece record;
+              s = mmap_reader_->ReadRecord(&mmap_offset_, &record);
+              if (s.ok()) {
+                result_tensor.scalar<string>()().assign(record.data(),
+                                                        record.size());
+              }
+            } else {
+              s = reader_->ReadRecord(&result_tensor.scalar<string>()());
+            }
             if (s.ok()) {
               out_tensors->emplace_back(std::move(result_tensor));
               *end_of_sequence = false;
@@ -615,7 +720,7 @@ class TFRecordDatasetOp : public DatasetOpKernel {
             return Status::OK();
           }
 
-          TF_RETURN_IF_ERROR(SetupStreamsLocked(ctx->env()));
+          TF_RETURN_IF_ERROR(SetupStreamsLocked(ctx));
         } while (true);
       }
 
@@ -625,7 +730,10 @@ class TFRecordDatasetOp : public DatasetOpKernel {
         TF_RETURN_IF_ERROR(writer->WriteScalar(full_name("current_file_index"),
                                                current_file_index_));
 
-        if (reader_) {
+        if (mmap_reader_) {
+          TF_RETURN_IF_ERROR(writer->WriteScalar(
+              full_name("offset"), static_cast<int64>(mmap_offset_)));
+        } else if (reader_) {
           TF_RETURN_IF_ERROR(
               writer->WriteScalar(full_name("offset"), reader_->TellOffset()));
         }
@@ -643,15 +751,20 @@ class TFRecordDatasetOp : public DatasetOpKernel {
         if (reader->Contains(full_name("offset"))) {
           int64 offset;
           TF_RETURN_IF_ERROR(reader->ReadScalar(full_name("offset"), &offset));
-          TF_RETURN_IF_ERROR(SetupStreamsLocked(ctx->env()));
-          TF_RETURN_IF_ERROR(reader_->SeekOffset(offset));
+          TF_RETURN_IF_ERROR(SetupStreamsLocked(ctx));
+          if (mmap_reader_) {
+            mmap_offset_ = offset;
+          } else {
+            TF_RETURN_IF_ERROR(reader_->SeekOffset(offset));
+          }
         }
         return Status::OK();
       }
 
      private:
       // Sets up reader streams to read from the file at `current_file_index_`.
-      Status SetupStreamsLocked(Env* env) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      Status SetupStreamsLocked(IteratorContext* ctx)
+          EXCLUSIVE_LOCKS_REQUIRED(mu_) {
         if (current_file_index_ >= dataset()->filenames_.size()) {
           return errors::InvalidArgument(
               "current_file_index_:", current_file_index_,
@@ -659,9 +772,35 @@ class TFRecordDatasetOp : public DatasetOpKernel {
         }
 
         // Actually move on to next file.
+        Env* env = ctx->env();
         const string& next_filename =
             dataset()->filenames_[current_file_index_];
-        TF_RETURN_IF_ERROR(env->NewRandomAccessFile(next_filename, &file_));
+        if (dataset()->use_mmap_) {
+          Status s = io::MemmappedRecordReader::Create(env, next_filename,
+                                                       &mmap_reader_);
+          if (s.ok()) {
+            mmap_offset_ = 0;
+            // Verifies the checksums of the whole file up front, so that
+            // reading the records only parses their headers.
+            thread::ThreadPool* pool = VerifyChecksumsThreadPool();
+            s = mmap_reader_->VerifyChecksums(
+                [pool](std::function<void()> fn) {
+                  pool->Schedule(std::move(fn));
+                },
+                pool->NumThreads());
+            if (!s.ok()) {
+              mmap_reader_.reset();
+            }
+            return s;
+          }
+          // File systems that cannot map files are read sequentially.
+          if (!errors::IsUnimplemented(s)) {
+            return s;
+          }
+        }
+        TF_RETURN_IF_ERROR(NewRandomAccessFile(
+            env, next_filename, dataset()->options_.buffer_size,
+            dataset()->num_readahead_blocks_, &file_));
         reader_.reset(
             new io::SequentialRecordReader(file_.get(), dataset()->options_));
         return Status::OK();
@@ -671,6 +810,7 @@ class TFRecordDatasetOp : public DatasetOpKernel {
       void ResetStreamsLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
         reader_.reset();
         file_.reset();
+        mmap_reader_.reset();
       }
 
       mutex mu_;
@@ -680,12 +820,20 @@ class TFRecordDatasetOp : public DatasetOpKernel {
       // we must destroy `reader_` before `file_`.
       std::unique_ptr<RandomAccessFile> file_ GUARDED_BY(mu_);
       std::unique_ptr<io::SequentialRecordReader> reader_ GUARDED_BY(mu_);
+      // Used instead of `file_` and `reader_` when `use_mmap` is set.
+      std::unique_ptr<io::MemmappedRecordReader> mmap_reader_ GUARDED_BY(mu_);
+      uint64 mmap_offset_ GUARDED_BY(mu_) = 0;
     };
 
     const std::vector<string> filenames_;
     const string compression_type_;
+    const bool use_mmap_;
+    const int64 num_readahead_blocks_;
     io::RecordReaderOptions options_;
   };
+
+  bool use_mmap_;
+  int64 num_readahead_blocks_;
 };
 
 REGISTER_KERNEL_BUILDER(Name("TFRecordDataset").Device(DEVICE_CPU),
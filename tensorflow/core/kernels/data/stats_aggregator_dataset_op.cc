@@ -85,6 +85,10 @@ class SetStatsAggregatorDatasetOp : public UnaryDatasetOpKernel {
           : DatasetIterator<Dataset>(params) {}
 
       Status Initialize(IteratorContext* ctx) override {
+        // The stages of the pipeline report their profile to the aggregator.
+        if (ctx->model()) {
+          ctx->model()->EnableProfiling();
+        }
         return dataset()->input_->MakeIterator(ctx, prefix(), &input_impl_);
       }
 
@@ -103,6 +107,7 @@ class SetStatsAggregatorDatasetOp : public UnaryDatasetOpKernel {
         params.lib = ctx->lib();
         params.function_library = ctx->function_library();
         params.allocator_getter = ctx->allocator_getter();
+        params.model = ctx->model();
         IteratorContext set_stats_aggregator_ctx(params);
         return input_impl_->GetNext(&set_stats_aggregator_ctx, out_tensors,
                                     end_of_sequence);
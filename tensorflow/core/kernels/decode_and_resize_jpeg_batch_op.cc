@@ -0,0 +1,201 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// See docs in ../ops/image_ops.cc
+
+#include <limits>
+#include <vector>
+
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/kernels/crop_resize_bilinear_core.h"
+#include "tensorflow/core/kernels/image_resizer_state.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/jpeg/jpeg_mem.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/work_sharder.h"
+
+namespace tensorflow {
+namespace {
+
+// Decodes a batch of JPEG images and resizes each of them with bilinear
+// interpolation into its slice of a single [batch, height, width, channels]
+// output. Images are decoded in parallel, and libjpeg's DCT scaling is used to
+// decode each one at the smallest of 1, 1/2, 1/4 and 1/8 of its size that is
+// still at least as large as the output, so most of the work for large
+// images is never done.
+class DecodeAndResizeJpegBatchOp : public OpKernel {
+ public:
+  explicit DecodeAndResizeJpegBatchOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("channels", &channels_));
+    OP_REQUIRES(context, channels_ == 1 || channels_ == 3,
+                errors::InvalidArgument("channels must be 1 or 3, got ",
+                                        channels_));
+    flags_.components = channels_;
+    OP_REQUIRES_OK(context, context->GetAttr("align_corners", &align_corners_));
+    OP_REQUIRES_OK(context, context->GetAttr("fancy_upscaling",
+                                             &flags_.fancy_upscaling));
+    OP_REQUIRES_OK(context,
+                   context->GetAttr("try_recover_truncated",
+                                    &flags_.try_recover_truncated_jpeg));
+    OP_REQUIRES_OK(context, context->GetAttr("acceptable_fraction",
+                                             &flags_.min_acceptable_fraction));
+
+    // The TensorFlow-chosen default for jpeg decoding is IFAST, sacrificing
+    // image quality for speed.
+    flags_.dct_method = JDCT_IFAST;
+    string dct_method;
+    OP_REQUIRES_OK(context, context->GetAttr("dct_method", &dct_method));
+    OP_REQUIRES(
+        context,
+        (dct_method.empty() || dct_method == "INTEGER_FAST" ||
+         dct_method == "INTEGER_ACCURATE"),
+        errors::InvalidArgument("dct_method must be one of "
+                                "{'', 'INTEGER_FAST', 'INTEGER_ACCURATE'}"));
+    if (dct_method == "INTEGER_ACCURATE") {
+      flags_.dct_method = JDCT_ISLOW;
+    }
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& contents = context->input(0);
+    OP_REQUIRES(context, TensorShapeUtils::IsVector(contents.shape()),
+                errors::InvalidArgument("contents must be 1-D, got shape ",
+                                        contents.shape().DebugString()));
+    const Tensor& size = context->input(1);
+    OP_REQUIRES(context, size.dims() == 1 && size.NumElements() == 2,
+                errors::InvalidArgument("size must be 1-D with 2 elements, "
+                                        "got shape ",
+                                        size.shape().DebugString()));
+    const int64 out_height = size.vec<int32>()(0);
+    const int64 out_width = size.vec<int32>()(1);
+    OP_REQUIRES(context, out_height > 0 && out_width > 0,
+                errors::InvalidArgument("output dimensions must be positive, "
+                                        "got ",
+                                        out_height, " x ", out_width));
+
+    const int64 batch_size = contents.NumElements();
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(
+        context,
+        context->allocate_output(
+            0, TensorShape({batch_size, out_height, out_width, channels_}),
+            &output));
+    if (batch_size == 0) return;
+
+    const auto contents_flat = contents.flat<string>();
+    float* const output_data = output->flat<float>().data();
+    const int64 image_size = out_height * out_width * channels_;
+    std::vector<Status> statuses(batch_size);
+    auto decode_and_resize = [&](int64 start, int64 limit) {
+      // Decoded images are staged in a buffer that is reused within a shard.
+      std::vector<uint8> decoded;
+      for (int64 i = start; i < limit; ++i) {
+        statuses[i] = DecodeAndResize(contents_flat(i), out_height, out_width,
+                                      &decoded, output_data + i * image_size);
+      }
+    };
+    // Decoding dominates, at a few hundred cycles per output pixel for
+    // typical input-to-output size ratios.
+    const int64 cost_per_image = 300 * image_size;
+    const DeviceBase::CpuWorkerThreads& worker_threads =
+        *(context->device()->tensorflow_cpu_worker_threads());
+    Shard(worker_threads.num_threads, worker_threads.workers, batch_size,
+          cost_per_image, decode_and_resize);
+
+    for (int64 i = 0; i < batch_size; ++i) {
+      OP_REQUIRES(context, statuses[i].ok(),
+                  errors::InvalidArgument("Image ", i, " of the batch: ",
+                                          statuses[i].error_message()));
+    }
+  }
+
+ private:
+  Status DecodeAndResize(StringPiece input, int64 out_height, int64 out_width,
+                         std::vector<uint8>* decoded, float* output) const {
+    // The 4th byte of JPEG is '\xe0' or '\xe1', so check just the first three
+    if (!str_util::StartsWith(input, "\xff\xd8\xff")) {
+      return errors::InvalidArgument("Expected a JPEG image, data size ",
+                                     input.size());
+    }
+    if (input.size() > std::numeric_limits<int>::max()) {
+      return errors::InvalidArgument("JPEG contents are too large for int: ",
+                                     input.size());
+    }
+
+    // Use local copy of flags to avoid race condition as the class member is
+    // shared among different invocations.
+    jpeg::UncompressFlags flags = flags_;
+    flags.min_scaled_width = out_width;
+    flags.min_scaled_height = out_height;
+    int64 in_height = 0;
+    int64 in_width = 0;
+    if (jpeg::Uncompress(
+            input.data(), input.size(), flags, nullptr /* nwarn */,
+            [&](int width, int height, int channels) -> uint8* {
+              in_height = height;
+              in_width = width;
+              decoded->resize(static_cast<size_t>(height) * width * channels);
+              return decoded->data();
+            }) == nullptr) {
+      return errors::InvalidArgument("Invalid JPEG data, data size ",
+                                     input.size());
+    }
+
+    const uint8* image = decoded->data();
+    if (in_height == out_height && in_width == out_width) {
+      std::copy(image, image + out_height * out_width * channels_, output);
+      return Status::OK();
+    }
+
+    // Same interpolation as ResizeBilinear.
+    const float height_scale =
+        CalculateResizeScale(in_height, out_height, align_corners_);
+    const float width_scale =
+        CalculateResizeScale(in_width, out_width, align_corners_);
+    std::vector<internal::CachedInterpolation> ys(out_height + 1);
+    std::vector<internal::CachedInterpolation> xs(out_width + 1);
+    internal::compute_interpolation_weights(out_height, in_height,
+                                            height_scale, ys.data());
+    internal::compute_interpolation_weights(out_width, in_width, width_scale,
+                                            xs.data());
+    // Scale x interpolation weights to avoid a multiplication during
+    // iteration.
+    for (size_t i = 0; i < xs.size(); ++i) {
+      xs[i].lower *= channels_;
+      xs[i].upper *= channels_;
+    }
+    internal::crop_resize_single_image(
+        image, in_height, in_width, out_height, out_width, channels_, 0,
+        out_width - 1, xs.data(), 0, out_height - 1, ys.data(), 0.0f, false,
+        false, output);
+    return Status::OK();
+  }
+
+  int channels_;
+  bool align_corners_;
+  jpeg::UncompressFlags flags_;
+};
+
+REGISTER_KERNEL_BUILDER(Name("DecodeAndResizeJpegBatch").Device(DEVICE_CPU),
+                        DecodeAndResizeJpegBatchOp);
+
+}  // namespace
+}  // namespace tensorflow
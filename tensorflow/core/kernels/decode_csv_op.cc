@@ -14,6 +14,7 @@ limitations under the License.
 ==============================================================================*/
 
 // See docs in ../ops/parsing_ops.cc.
+#include <deque>
 #include <vector>
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
@@ -21,6 +22,7 @@ limitations under the License.
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/strings/numbers.h"
+#include "tensorflow/core/util/csv_scanner.h"
 
 namespace tensorflow {
 
@@ -50,6 +52,7 @@ class DecodeCSVOp : public OpKernel {
     OP_REQUIRES(ctx, delim.size() == 1,
                 errors::InvalidArgument("field_delim should be only 1 char"));
     delim_ = delim[0];
+    scanner_.reset(new CsvScanner(delim_, use_quote_delim_));
     OP_REQUIRES_OK(ctx, ctx->GetAttr("na_value", &na_value_));
   }
 
@@ -78,10 +81,16 @@ class DecodeCSVOp : public OpKernel {
       OP_REQUIRES_OK(ctx, output.allocate(i, records->shape(), &out));
     }
 
+    // Fields point into the record, or into `unescaped` for quoted fields
+    // that contain escaped quotes. Both are reused across records.
+    std::vector<StringPiece> fields;
+    std::deque<string> unescaped;
     for (int64 i = 0; i < records_size; ++i) {
       const StringPiece record(records_t(i));
-      std::vector<string> fields;
-      ExtractFields(ctx, record, &fields);
+      fields.clear();
+      unescaped.clear();
+      ExtractFields(ctx, record, &fields, &unescaped);
+      if (!ctx->status().ok()) return;
       OP_REQUIRES(ctx, fields.size() == out_type_.size(),
                   errors::InvalidArgument("Expect ", out_type_.size(),
                                           " fields but have ", fields.size(),
@@ -142,7 +151,7 @@ class DecodeCSVOp : public OpKernel {
               output[f]->flat<float>()(i) = record_defaults[f].flat<float>()(0);
             } else {
               float value;
-              OP_REQUIRES(ctx, strings::safe_strtof(fields[f].c_str(), &value),
+              OP_REQUIRES(ctx, strings::safe_strtof(fields[f], &value),
                           errors::InvalidArgument(
                               "Field ", f, " in record ", i,
                               " is not a valid float: ", fields[f]));
@@ -162,7 +171,7 @@ class DecodeCSVOp : public OpKernel {
                   record_defaults[f].flat<double>()(0);
             } else {
               double value;
-              OP_REQUIRES(ctx, strings::safe_strtod(fields[f].c_str(), &value),
+              OP_REQUIRES(ctx, strings::safe_strtod(fields[f], &value),
                           errors::InvalidArgument(
                               "Field ", f, " in record ", i,
                               " is not a valid double: ", fields[f]));
@@ -181,7 +190,7 @@ class DecodeCSVOp : public OpKernel {
               output[f]->flat<string>()(i) =
                   record_defaults[f].flat<string>()(0);
             } else {
-              output[f]->flat<string>()(i) = fields[f];
+              output[f]->flat<string>()(i) = string(fields[f]);
             }
             break;
           }
@@ -202,14 +211,17 @@ class DecodeCSVOp : public OpKernel {
   bool select_all_cols_;
   string na_value_;
 
+  std::unique_ptr<CsvScanner> scanner_;
+
   void ExtractFields(OpKernelContext* ctx, StringPiece input,
-                     std::vector<string>* result) {
-    int64 current_idx = 0;
+                     std::vector<StringPiece>* result,
+                     std::deque<string>* unescaped) {
+    size_t current_idx = 0;
     int64 num_fields_parsed = 0;
     int64 selector_idx = 0;  // Keep track of index into select_cols
 
     if (!input.empty()) {
-      while (static_cast<size_t>(current_idx) < input.size()) {
+      while (current_idx < input.size()) {
         if (input[current_idx] == '\n' || input[current_idx] == '\r') {
           current_idx++;
           continue;
@@ -226,50 +238,53 @@ class DecodeCSVOp : public OpKernel {
         }
 
         // This is the body of the field;
-        string field;
+        StringPiece field;
         if (!quoted) {
-          while (static_cast<size_t>(current_idx) < input.size() &&
-                 input[current_idx] != delim_) {
-            OP_REQUIRES(ctx,
-                        (!use_quote_delim_ || input[current_idx] != '"') &&
-                            input[current_idx] != '\n' &&
-                            input[current_idx] != '\r',
-                        errors::InvalidArgument(
-                            "Unquoted fields cannot have quotes/CRLFs inside"));
-            if (include) field += input[current_idx];
-            current_idx++;
-          }
+          const size_t end = scanner_->FindFieldEnd(input, current_idx);
+          OP_REQUIRES(ctx, end == input.size() || input[end] == delim_,
+                      errors::InvalidArgument(
+                          "Unquoted fields cannot have quotes/CRLFs inside"));
+          if (include) field = input.substr(current_idx, end - current_idx);
 
           // Go to next field or the end
-          current_idx++;
+          current_idx = end + 1;
         } else if (use_quote_delim_) {
-          // Quoted field needs to be ended with '"' and delim or end
-          while (
-              (static_cast<size_t>(current_idx) < input.size() - 1) &&
-              (input[current_idx] != '"' || input[current_idx + 1] != delim_)) {
-            if (input[current_idx] != '"') {
-              if (include) field += input[current_idx];
-              current_idx++;
-            } else {
-              OP_REQUIRES(
-                  ctx, input[current_idx + 1] == '"',
-                  errors::InvalidArgument("Quote inside a string has to be "
-                                          "escaped by another quote"));
-              if (include) field += '"';
-              current_idx += 2;
+          // Quoted field needs to be ended with '"' and delim or end. Runs
+          // between escaped quotes are only copied if there are any.
+          string* buffer = nullptr;
+          size_t quote = scanner_->FindQuote(input, current_idx);
+          while (quote + 1 < input.size() && input[quote + 1] != delim_) {
+            OP_REQUIRES(
+                ctx, input[quote + 1] == '"',
+                errors::InvalidArgument("Quote inside a string has to be "
+                                        "escaped by another quote"));
+            if (include) {
+              if (buffer == nullptr) {
+                unescaped->emplace_back();
+                buffer = &unescaped->back();
+              }
+              // Keep the first quote of the pair.
+              buffer->append(input.data() + current_idx,
+                             quote + 1 - current_idx);
             }
+            current_idx = quote + 2;
+            quote = scanner_->FindQuote(input, current_idx);
           }
 
-          OP_REQUIRES(
-              ctx,
-              (static_cast<size_t>(current_idx) < input.size() &&
-               input[current_idx] == '"' &&
-               (static_cast<size_t>(current_idx) == input.size() - 1 ||
-                input[current_idx + 1] == delim_)),
-              errors::InvalidArgument("Quoted field has to end with quote "
-                                      "followed by delim or end"));
+          OP_REQUIRES(ctx, quote < input.size(),
+                      errors::InvalidArgument("Quoted field has to end with "
+                                              "quote followed by delim or "
+                                              "end"));
+          if (include) {
+            if (buffer == nullptr) {
+              field = input.substr(current_idx, quote - current_idx);
+            } else {
+              buffer->append(input.data() + current_idx, quote - current_idx);
+              field = *buffer;
+            }
+          }
 
-          current_idx += 2;
+          current_idx = quote + 2;
         }
 
         num_fields_parsed++;
@@ -285,7 +300,7 @@ class DecodeCSVOp : public OpKernel {
                                    static_cast<size_t>(num_fields_parsed));
       // Check if the last field is missing
       if (include && input[input.size() - 1] == delim_)
-        result->push_back(string());
+        result->push_back(StringPiece());
     }
   }
 };
@@ -0,0 +1,95 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace {
+
+// Returns the text of one CSV field of the given type.
+string MakeField(DataType dtype, int column) {
+  switch (dtype) {
+    case DT_FLOAT:
+      return strings::StrCat(column, ".", 1000 + column);
+    case DT_INT64:
+      return strings::StrCat(1729 * (column + 1));
+    case DT_STRING:
+      // Every other string field is quoted, with an escaped quote in it.
+      return column % 2 ? "\"abcd,1234 \"\"efgh\"\"\"" : "abcd1234abcd1234";
+    default:
+      LOG(FATAL) << "Unsupported type " << DataTypeString(dtype);
+  }
+}
+
+// Builds a graph that decodes `batch_size` records of `num_columns` columns of
+// type `dtype`.
+static Graph* DecodeCSV(DataType dtype, int batch_size, int num_columns) {
+  Graph* g = new Graph(OpRegistry::Global());
+  string record;
+  for (int i = 0; i < num_columns; ++i) {
+    strings::StrAppend(&record, i > 0 ? "," : "", MakeField(dtype, i));
+  }
+  Tensor records(DT_STRING, TensorShape({batch_size}));
+  for (int i = 0; i < batch_size; ++i) {
+    records.flat<string>()(i) = record;
+  }
+
+  std::vector<NodeBuilder::NodeOut> record_defaults;
+  for (int i = 0; i < num_columns; ++i) {
+    record_defaults.emplace_back(
+        test::graph::Constant(g, Tensor(dtype, TensorShape({0}))));
+  }
+
+  Node* ret;
+  TF_EXPECT_OK(NodeBuilder(g->NewName("n"), "DecodeCSV")
+                   .Input(test::graph::Constant(g, records))
+                   .Input(record_defaults)
+                   .Finalize(g, &ret));
+  return g;
+}
+
+// B == batch size, C == number of columns. The narrow (4 column) and wide
+// (200 column) files are the two shapes the CSV readers are tuned for.
+#define BM_DecodeCSV(TYPE, B, C)                                         \
+  static void BM_DecodeCSV_##TYPE##_##B##_##C(int iters) {              \
+    testing::UseRealTime();                                              \
+    testing::ItemsProcessed(static_cast<int64>(iters) * B * C);          \
+    test::Benchmark("cpu", DecodeCSV(TYPE, B, C)).Run(iters);            \
+  }                                                                      \
+  BENCHMARK(BM_DecodeCSV_##TYPE##_##B##_##C);
+
+#define BM_AllDecodeCSV(TYPE) \
+  BM_DecodeCSV(TYPE, 1, 4);   \
+  BM_DecodeCSV(TYPE, 128, 4); \
+  BM_DecodeCSV(TYPE, 1, 200); \
+  BM_DecodeCSV(TYPE, 128, 200);
+
+BM_AllDecodeCSV(DT_FLOAT);
+BM_AllDecodeCSV(DT_INT64);
+BM_AllDecodeCSV(DT_STRING);
+
+}  // namespace
+}  // namespace tensorflow
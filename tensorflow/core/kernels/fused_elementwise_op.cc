@@ -0,0 +1,388 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// See docs in ../ops/math_ops.cc.
+
+#define EIGEN_USE_THREADS
+
+#include <unordered_map>
+#include <vector>
+
+#include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/kernels/cwise_ops.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+
+namespace tensorflow {
+
+typedef Eigen::ThreadPoolDevice CPUDevice;
+
+namespace {
+
+// A value read by an instruction of the fused expression: either a block of
+// the same length as the instruction output, or a single value that is
+// broadcasted over the whole block.
+template <typename T>
+struct Operand {
+  const T* data;
+  bool is_scalar;
+};
+
+// Compute functions for the ops supported by the _FusedElementwise kernel.
+// WARN: This should be consistent with grappler/optimizers/remapper.cc.
+template <typename T>
+struct FusedElementwiseSupport {
+  using ConstBlock = typename TTypes<T>::UnalignedConstFlat;
+  using Block = typename TTypes<T>::UnalignedFlat;
+
+  using UnaryFn = void (*)(const ConstBlock&, Block*);
+  using BinaryFn = void (*)(const Operand<T>&, const Operand<T>&, int64,
+                            Block*);
+
+  struct Fn {
+    UnaryFn unary_fn;
+    BinaryFn binary_fn;
+    int cost;
+
+    int arity() const { return unary_fn != nullptr ? 1 : 2; }
+  };
+
+  static const FusedElementwiseSupport& Get() {
+    static const FusedElementwiseSupport* support =
+        new FusedElementwiseSupport();
+    return *support;
+  }
+
+  const Fn* Find(const string& op_name) const {
+    auto it = fns.find(op_name);
+    return it == fns.end() ? nullptr : &it->second;
+  }
+
+ private:
+  template <typename Functor>
+  static void ComputeUnary(const ConstBlock& in, Block* out) {
+    *out = in.unaryExpr(typename Functor::func());
+  }
+
+  static void ComputeRelu(const ConstBlock& in, Block* out) {
+    *out = in.cwiseMax(static_cast<T>(0));
+  }
+
+  static void ComputeRelu6(const ConstBlock& in, Block* out) {
+    *out = in.cwiseMax(static_cast<T>(0)).cwiseMin(static_cast<T>(6));
+  }
+
+  template <typename Functor>
+  static void ComputeBinary(const Operand<T>& x, const Operand<T>& y,
+                            int64 len, Block* out) {
+    using Binary = typename Functor::func;
+    if (!x.is_scalar && !y.is_scalar) {
+      *out = ConstBlock(x.data, len).binaryExpr(ConstBlock(y.data, len),
+                                                Binary());
+    } else if (x.is_scalar && !y.is_scalar) {
+      using Left = Eigen::internal::scalar_left<T, T, Binary>;
+      *out = ConstBlock(y.data, len).unaryExpr(Left(x.data));
+    } else if (!x.is_scalar && y.is_scalar) {
+      using Right = Eigen::internal::scalar_right<T, T, Binary>;
+      *out = ConstBlock(x.data, len).unaryExpr(Right(y.data));
+    } else {
+      out->setConstant(Binary()(*x.data, *y.data));
+    }
+  }
+
+  template <typename Functor>
+  void RegisterUnary(const string& name) {
+    fns[name] = {ComputeUnary<Functor>, nullptr,
+                 Eigen::internal::functor_traits<typename Functor::func>::Cost};
+  }
+
+  template <typename Functor>
+  void RegisterBinary(const string& name) {
+    fns[name] = {nullptr, ComputeBinary<Functor>,
+                 Eigen::internal::functor_traits<typename Functor::func>::Cost};
+  }
+
+  FusedElementwiseSupport() {
+    using MaxCost = Eigen::internal::functor_traits<
+        Eigen::internal::scalar_max_op<T>>;
+
+    // clang-format off
+    RegisterUnary<functor::abs<T>>("Abs");
+    RegisterUnary<functor::erf<T>>("Erf");
+    RegisterUnary<functor::exp<T>>("Exp");
+    RegisterUnary<functor::floor<T>>("Floor");
+    RegisterUnary<functor::log<T>>("Log");
+    RegisterUnary<functor::log1p<T>>("Log1p");
+    RegisterUnary<functor::neg<T>>("Neg");
+    RegisterUnary<functor::inverse<T>>("Reciprocal");
+    RegisterUnary<functor::rsqrt<T>>("Rsqrt");
+    RegisterUnary<functor::sigmoid<T>>("Sigmoid");
+    RegisterUnary<functor::sqrt<T>>("Sqrt");
+    RegisterUnary<functor::square<T>>("Square");
+    RegisterUnary<functor::tanh<T>>("Tanh");
+    fns["Relu"]  = {ComputeRelu,  nullptr, MaxCost::Cost};
+    fns["Relu6"] = {ComputeRelu6, nullptr, 2 * MaxCost::Cost};
+
+    RegisterBinary<functor::add<T>>("Add");
+    RegisterBinary<functor::add<T>>("AddV2");
+    RegisterBinary<functor::div<T>>("Div");
+    RegisterBinary<functor::maximum<T>>("Maximum");
+    RegisterBinary<functor::minimum<T>>("Minimum");
+    RegisterBinary<functor::mul<T>>("Mul");
+    RegisterBinary<functor::pow<T>>("Pow");
+    RegisterBinary<functor::div<T>>("RealDiv");
+    RegisterBinary<functor::squared_difference<T>>("SquaredDifference");
+    RegisterBinary<functor::sub<T>>("Sub");
+    // clang-format on
+  }
+
+  std::unordered_map<string, Fn> fns;
+};
+
+}  // namespace
+
+// Evaluates an expression of elementwise ops, given as a sequence of
+// instructions in topological order, in a single pass over the inputs.
+//
+// Instruction `i` applies op_names[i] to the next 1 or 2 entries of the
+// `operands` list. An operand `k < N` refers to the k-th input of the kernel,
+// and an operand `k >= N` refers to the result of the instruction `k - N`. The
+// result of the last instruction is the kernel output.
+//
+// The inputs are processed in blocks small enough for all intermediate results
+// to stay in L1 cache, so each input is read from memory once and the output
+// is written once, no matter how many ops are fused together.
+template <typename T>
+class FusedElementwiseOp : public OpKernel {
+ public:
+  using Support = FusedElementwiseSupport<T>;
+  using ConstBlock = typename Support::ConstBlock;
+  using Block = typename Support::Block;
+
+  explicit FusedElementwiseOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    std::vector<string> op_names;
+    std::vector<int32> operands;
+    OP_REQUIRES_OK(context, context->GetAttr("N", &num_inputs_));
+    OP_REQUIRES_OK(context, context->GetAttr("op_names", &op_names));
+    OP_REQUIRES_OK(context, context->GetAttr("operands", &operands));
+    OP_REQUIRES(context, !op_names.empty(),
+                errors::InvalidArgument(
+                    "Fused elementwise op must have at least one op"));
+
+    const Support& support = Support::Get();
+    int next_operand = 0;
+    for (int i = 0; i < static_cast<int>(op_names.size()); ++i) {
+      const typename Support::Fn* fn = support.Find(op_names[i]);
+      OP_REQUIRES(context, fn != nullptr,
+                  errors::InvalidArgument(
+                      "Do not have a compute function registered for op: ",
+                      op_names[i]));
+      OP_REQUIRES(context, next_operand + fn->arity() <=
+                               static_cast<int>(operands.size()),
+                  errors::InvalidArgument("Not enough operands for op ", i,
+                                          ": ", op_names[i]));
+
+      Instruction instruction;
+      instruction.fn = fn;
+      for (int j = 0; j < fn->arity(); ++j) {
+        const int32 operand = operands[next_operand++];
+        OP_REQUIRES(
+            context, operand >= 0 && operand < num_inputs_ + i,
+            errors::InvalidArgument("Op ", i, " (", op_names[i],
+                                    ") has an invalid operand: ", operand));
+        instruction.operands[j] = operand;
+      }
+      instructions_.push_back(instruction);
+      cost_ += fn->cost;
+    }
+    OP_REQUIRES(context, next_operand == static_cast<int>(operands.size()),
+                errors::InvalidArgument("Expected ", next_operand,
+                                        " operands but got ", operands.size()));
+
+    AllocateScratchSlots();
+
+    VLOG(2) << "Fused elementwise ops: [" << str_util::Join(op_names, ", ")
+            << "]; cost=" << cost_ << " scratch_slots=" << num_scratch_slots_;
+  }
+
+  void Compute(OpKernelContext* ctx) override {
+    OP_REQUIRES(ctx, ctx->num_inputs() == num_inputs_,
+                errors::InvalidArgument("Expected ", num_inputs_,
+                                        " inputs but got ", ctx->num_inputs()));
+
+    // The output has the shape of the highest rank input. Inputs with a single
+    // element are broadcasted, all other inputs must have the output shape.
+    int output_index = 0;
+    for (int i = 1; i < num_inputs_; ++i) {
+      const Tensor& in = ctx->input(i);
+      const Tensor& out = ctx->input(output_index);
+      if (in.dims() > out.dims() ||
+          (in.dims() == out.dims() && out.NumElements() == 1)) {
+        output_index = i;
+      }
+    }
+    const TensorShape& output_shape = ctx->input(output_index).shape();
+
+    std::vector<int> forwardable_inputs;
+    std::vector<Operand<T>> inputs(num_inputs_);
+    int num_full_inputs = 0;
+    for (int i = 0; i < num_inputs_; ++i) {
+      const Tensor& in = ctx->input(i);
+      const bool same_shape = in.shape() == output_shape;
+      OP_REQUIRES(ctx, same_shape || in.NumElements() == 1,
+                  errors::InvalidArgument(
+                      "Inputs must be scalars or have the same shape: input ",
+                      i, " has shape ", in.shape().DebugString(),
+                      " but the output shape is ",
+                      output_shape.DebugString()));
+      if (same_shape) forwardable_inputs.push_back(i);
+      inputs[i] = {in.flat<T>().data(), !same_shape};
+      num_full_inputs += same_shape;
+    }
+
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(ctx, ctx->forward_input_or_allocate_output(
+                            forwardable_inputs, 0, output_shape, &output));
+    if (output->NumElements() == 0) return;
+    T* out_data = output->flat<T>().data();
+
+    auto compute_fn = [this, &inputs, out_data](int64 begin, int64 end) {
+      std::vector<T> scratch(num_scratch_slots_ * BlockSize());
+      for (int64 start = begin; start < end; start += BlockSize()) {
+        const int64 len = std::min<int64>(BlockSize(), end - start);
+        EvaluateBlock(inputs, start, len, scratch.data(), out_data + start);
+      }
+    };
+
+    const CPUDevice& device = ctx->eigen_device<CPUDevice>();
+    const int kOverheadCycles = static_cast<int>(instructions_.size()) * 10;
+    Eigen::TensorOpCost cost(/*bytes_loaded=*/sizeof(T) * num_full_inputs,
+                             /*bytes_stored=*/sizeof(T),
+                             kOverheadCycles + cost_);
+    device.parallelFor(output->NumElements(), cost, AlignBlockSize,
+                       std::move(compute_fn));
+  }
+
+ private:
+  using Packet = typename Eigen::internal::packet_traits<T>::type;
+  static const int kPacketSize = Eigen::internal::unpacket_traits<Packet>::size;
+
+  // Number of values in a block of intermediate results. A few live blocks
+  // should fit into L1 cache together with the input and output blocks.
+  static constexpr int64 BlockSize() { return 4096 / sizeof(T); }
+
+  static inline int64 AlignBlockSize(int64 block_size) {
+    if (block_size >= BlockSize()) {
+      return (block_size + BlockSize() - 1) & ~(BlockSize() - 1);
+    }
+    return (block_size + kPacketSize - 1) & ~(kPacketSize - 1);
+  }
+
+  struct Instruction {
+    const typename Support::Fn* fn;
+    int operands[2];
+    // Index of the scratch block that holds the instruction result, or -1 for
+    // the last instruction that writes directly into the output.
+    int scratch_slot;
+  };
+
+  // Assigns scratch blocks to instruction results, reusing the block of a
+  // result after its last use.
+  void AllocateScratchSlots() {
+    const int num_instructions = instructions_.size();
+    std::vector<int> last_use(num_instructions, -1);
+    for (int i = 0; i < num_instructions; ++i) {
+      for (int j = 0; j < instructions_[i].fn->arity(); ++j) {
+        const int operand = instructions_[i].operands[j];
+        if (operand >= num_inputs_) last_use[operand - num_inputs_] = i;
+      }
+    }
+
+    std::vector<int> free_slots;
+    for (int i = 0; i < num_instructions; ++i) {
+      Instruction& instruction = instructions_[i];
+      // Elementwise ops can safely write their result into the block of an
+      // operand that is not used afterwards.
+      for (int j = 0; j < instruction.fn->arity(); ++j) {
+        const int operand = instruction.operands[j] - num_inputs_;
+        if (operand >= 0 && last_use[operand] == i &&
+            (j == 0 || instruction.operands[0] != instruction.operands[1])) {
+          free_slots.push_back(instructions_[operand].scratch_slot);
+        }
+      }
+      if (i == num_instructions - 1) {
+        instruction.scratch_slot = -1;
+      } else if (free_slots.empty()) {
+        instruction.scratch_slot = num_scratch_slots_++;
+      } else {
+        instruction.scratch_slot = free_slots.back();
+        free_slots.pop_back();
+      }
+    }
+  }
+
+  void EvaluateBlock(const std::vector<Operand<T>>& inputs, int64 start,
+                     int64 len, T* scratch, T* out) const {
+    auto resolve = [&](int operand) -> Operand<T> {
+      if (operand < num_inputs_) {
+        const Operand<T>& input = inputs[operand];
+        return {input.is_scalar ? input.data : input.data + start,
+                input.is_scalar};
+      }
+      const Instruction& producer = instructions_[operand - num_inputs_];
+      return {scratch + producer.scratch_slot * BlockSize(), false};
+    };
+
+    for (const Instruction& instruction : instructions_) {
+      Block result(instruction.scratch_slot < 0
+                       ? out
+                       : scratch + instruction.scratch_slot * BlockSize(),
+                   len);
+      const Operand<T> x = resolve(instruction.operands[0]);
+      if (instruction.fn->arity() == 2) {
+        const Operand<T> y = resolve(instruction.operands[1]);
+        instruction.fn->binary_fn(x, y, len, &result);
+      } else if (x.is_scalar) {
+        T value;
+        Block scalar_result(&value, 1);
+        instruction.fn->unary_fn(ConstBlock(x.data, 1), &scalar_result);
+        result.setConstant(value);
+      } else {
+        instruction.fn->unary_fn(ConstBlock(x.data, len), &result);
+      }
+    }
+  }
+
+  int num_inputs_ = 0;
+  std::vector<Instruction> instructions_;
+  int num_scratch_slots_ = 0;
+  int cost_ = 0;
+};
+
+#define REGISTER_CPU(T)                                                    \
+  REGISTER_KERNEL_BUILDER(                                                 \
+      Name("_FusedElementwise").Device(DEVICE_CPU).TypeConstraint<T>("T"), \
+      FusedElementwiseOp<T>);
+
+REGISTER_CPU(float);
+REGISTER_CPU(double);
+
+#undef REGISTER_CPU
+
+}  // namespace tensorflow
@@ -0,0 +1,274 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cmath>
+
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/kernels/ops_util.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+class FusedElementwiseOpTest : public OpsTestBase {
+ protected:
+  template <typename T>
+  Status InitFusedOp(int num_inputs, const std::vector<string>& op_names,
+                     const std::vector<int>& operands) {
+    TF_CHECK_OK(NodeDefBuilder("fused_elementwise", "_FusedElementwise")
+                    .Input(FakeInput(num_inputs, DataTypeToEnum<T>::v()))
+                    .Attr("T", DataTypeToEnum<T>::v())
+                    .Attr("op_names", op_names)
+                    .Attr("operands", operands)
+                    .Finalize(node_def()));
+    return InitOp();
+  }
+};
+
+TEST_F(FusedElementwiseOpTest, ScaleAndShift) {
+  // y = x * scale + shift
+  TF_ASSERT_OK(InitFusedOp<float>(3, {"Mul", "Add"}, {0, 1, 3, 2}));
+  AddInputFromArray<float>(TensorShape({2, 3}), {1, 2, 3, 4, 5, 6});
+  AddInputFromArray<float>(TensorShape({}), {2});
+  AddInputFromArray<float>(TensorShape({1}), {-1});
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({2, 3}));
+  test::FillValues<float>(&expected, {1, 3, 5, 7, 9, 11});
+  test::ExpectTensorEqual<float>(expected, *GetOutput(0));
+}
+
+TEST_F(FusedElementwiseOpTest, ScalarOnTheLeft) {
+  // y = 1 - square(x)
+  TF_ASSERT_OK(InitFusedOp<double>(2, {"Square", "Sub"}, {1, 0, 2}));
+  AddInputFromArray<double>(TensorShape({}), {1});
+  AddInputFromArray<double>(TensorShape({4}), {0, 1, 2, 3});
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(allocator(), DT_DOUBLE, TensorShape({4}));
+  test::FillValues<double>(&expected, {1, 0, -3, -8});
+  test::ExpectTensorEqual<double>(expected, *GetOutput(0));
+}
+
+TEST_F(FusedElementwiseOpTest, SigmoidTimesTanh) {
+  // y = sigmoid(a) * tanh(b)
+  TF_ASSERT_OK(InitFusedOp<float>(2, {"Sigmoid", "Tanh", "Mul"}, {0, 1, 2, 3}));
+  const std::vector<float> a = {-2.0f, -0.5f, 0.0f, 0.5f, 2.0f};
+  const std::vector<float> b = {1.0f, -1.0f, 0.25f, 3.0f, -0.1f};
+  AddInputFromArray<float>(TensorShape({5}), a);
+  AddInputFromArray<float>(TensorShape({5}), b);
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({5}));
+  auto expected_flat = expected.flat<float>();
+  for (size_t i = 0; i < a.size(); ++i) {
+    expected_flat(i) = std::tanh(b[i]) / (1.0f + std::exp(-a[i]));
+  }
+  test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-6);
+}
+
+TEST_F(FusedElementwiseOpTest, Gelu) {
+  // y = 0.5 * x * (1 + erf(x / sqrt(2)))
+  TF_ASSERT_OK(InitFusedOp<float>(4, {"Mul", "Erf", "Add", "Mul", "Mul"},
+                                  {0, 3, 4, 2, 5, 1, 0, 7, 6}));
+  const int64 size = 10000;
+  Tensor x(DT_FLOAT, TensorShape({size / 100, 100}));
+  x.flat<float>().setRandom();
+  AddInputFromArray<float>(x.shape(), x.flat<float>());
+  AddInputFromArray<float>(TensorShape({}), {0.5f});
+  AddInputFromArray<float>(TensorShape({}), {1.0f});
+  AddInputFromArray<float>(TensorShape({}), {static_cast<float>(M_SQRT1_2)});
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(allocator(), DT_FLOAT, x.shape());
+  for (int64 i = 0; i < size; ++i) {
+    const float v = x.flat<float>()(i);
+    expected.flat<float>()(i) =
+        0.5f * v * (1.0f + std::erf(v * static_cast<float>(M_SQRT1_2)));
+  }
+  test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-5);
+}
+
+TEST_F(FusedElementwiseOpTest, ReusesIntermediateResults) {
+  // t = x * y; z = relu(t + x); out = (t - z) * z
+  TF_ASSERT_OK(InitFusedOp<double>(2, {"Mul", "Add", "Relu", "Sub", "Mul"},
+                                   {0, 1, 2, 0, 3, 2, 4, 5, 4}));
+  const int64 size = 100000;
+  Tensor x(DT_DOUBLE, TensorShape({size}));
+  Tensor y(DT_DOUBLE, TensorShape({size}));
+  x.flat<double>().setRandom();
+  y.flat<double>().setRandom();
+  x.flat<double>() = x.flat<double>() - 0.5;
+  AddInputFromArray<double>(x.shape(), x.flat<double>());
+  AddInputFromArray<double>(y.shape(), y.flat<double>());
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(allocator(), DT_DOUBLE, x.shape());
+  for (int64 i = 0; i < size; ++i) {
+    const double t = x.flat<double>()(i) * y.flat<double>()(i);
+    const double z = std::max(0.0, t + x.flat<double>()(i));
+    expected.flat<double>()(i) = (t - z) * z;
+  }
+  test::ExpectTensorNear<double>(expected, *GetOutput(0), 1e-12);
+}
+
+TEST_F(FusedElementwiseOpTest, InvalidOperand) {
+  // The operand of the first op refers to its own result.
+  Status status = InitFusedOp<float>(1, {"Exp", "Neg"}, {1, 1});
+  EXPECT_TRUE(errors::IsInvalidArgument(status));
+  EXPECT_TRUE(str_util::StrContains(status.error_message(),
+                                    "has an invalid operand"));
+}
+
+TEST_F(FusedElementwiseOpTest, UnsupportedOp) {
+  Status status = InitFusedOp<float>(2, {"Atan2"}, {0, 1});
+  EXPECT_TRUE(errors::IsInvalidArgument(status));
+}
+
+TEST_F(FusedElementwiseOpTest, IncompatibleShapes) {
+  TF_ASSERT_OK(InitFusedOp<float>(2, {"Add", "Exp"}, {0, 1, 2}));
+  AddInputFromArray<float>(TensorShape({2, 2}), {1, 2, 3, 4});
+  AddInputFromArray<float>(TensorShape({2}), {1, 2});
+  Status status = RunOpKernel();
+  EXPECT_TRUE(errors::IsInvalidArgument(status));
+  EXPECT_TRUE(str_util::StrContains(status.error_message(),
+                                    "must be scalars or have the same shape"));
+}
+
+// Performance benchmarks below.
+//
+// Both variants report the bytes that have to cross the memory bus at least
+// once: the full inputs and the output. The unfused graphs also write and read
+// back every intermediate result, and the difference in the reported
+// bandwidth shows how much of that traffic the fused kernel avoids.
+
+// y = x * scale + shift, with scalar scale and shift.
+static Graph* ScaleAndShift(int tensor_size, bool fused) {
+  Graph* g = new Graph(OpRegistry::Global());
+
+  Tensor x_t(DT_FLOAT, TensorShape({tensor_size}));
+  x_t.flat<float>().setRandom();
+  Node* x = test::graph::Constant(g, x_t);
+  Node* scale = test::graph::Constant(g, test::AsScalar<float>(0.5f));
+  Node* shift = test::graph::Constant(g, test::AsScalar<float>(1.0f));
+
+  if (fused) {
+    TF_CHECK_OK(NodeBuilder(g->NewName("n"), "_FusedElementwise")
+                    .Input({x, scale, shift})
+                    .Attr("T", DT_FLOAT)
+                    .Attr("op_names", {"Mul", "Add"})
+                    .Attr("operands", {0, 1, 3, 2})
+                    .Finalize(g, nullptr));
+  } else {
+    test::graph::Binary(g, "Add", test::graph::Binary(g, "Mul", x, scale),
+                        shift);
+  }
+  return g;
+}
+
+// y = sigmoid(a) * tanh(b) + c * scale, with a scalar scale.
+static Graph* GatedSum(int tensor_size, bool fused) {
+  Graph* g = new Graph(OpRegistry::Global());
+
+  std::vector<Node*> in;
+  for (int i = 0; i < 3; ++i) {
+    Tensor t(DT_FLOAT, TensorShape({tensor_size}));
+    t.flat<float>().setRandom();
+    in.push_back(test::graph::Constant(g, t));
+  }
+  in.push_back(test::graph::Constant(g, test::AsScalar<float>(0.5f)));
+
+  if (fused) {
+    TF_CHECK_OK(NodeBuilder(g->NewName("n"), "_FusedElementwise")
+                    .Input({in[0], in[1], in[2], in[3]})
+                    .Attr("T", DT_FLOAT)
+                    .Attr("op_names", {"Sigmoid", "Tanh", "Mul", "Mul", "Add"})
+                    .Attr("operands", {0, 1, 4, 5, 2, 3, 6, 7})
+                    .Finalize(g, nullptr));
+  } else {
+    Node* gate = test::graph::Binary(g, "Mul",
+                                     test::graph::Unary(g, "Sigmoid", in[0]),
+                                     test::graph::Unary(g, "Tanh", in[1]));
+    test::graph::Binary(g, "Add", gate,
+                        test::graph::Binary(g, "Mul", in[2], in[3]));
+  }
+  return g;
+}
+
+// y = 0.5 * x * (1 + erf(x / sqrt(2)))
+static Graph* Gelu(int tensor_size, bool fused) {
+  Graph* g = new Graph(OpRegistry::Global());
+
+  Tensor x_t(DT_FLOAT, TensorShape({tensor_size}));
+  x_t.flat<float>().setRandom();
+  Node* x = test::graph::Constant(g, x_t);
+  Node* half = test::graph::Constant(g, test::AsScalar<float>(0.5f));
+  Node* one = test::graph::Constant(g, test::AsScalar<float>(1.0f));
+  Node* rsqrt2 = test::graph::Constant(
+      g, test::AsScalar<float>(static_cast<float>(M_SQRT1_2)));
+
+  if (fused) {
+    TF_CHECK_OK(NodeBuilder(g->NewName("n"), "_FusedElementwise")
+                    .Input({x, half, one, rsqrt2})
+                    .Attr("T", DT_FLOAT)
+                    .Attr("op_names", {"Mul", "Erf", "Add", "Mul", "Mul"})
+                    .Attr("operands", {0, 3, 4, 2, 5, 1, 0, 7, 6})
+                    .Finalize(g, nullptr));
+  } else {
+    Node* erf =
+        test::graph::Unary(g, "Erf", test::graph::Binary(g, "Mul", x, rsqrt2));
+    test::graph::Binary(g, "Mul", test::graph::Binary(g, "Mul", half, x),
+                        test::graph::Binary(g, "Add", one, erf));
+  }
+  return g;
+}
+
+// BM_<Expression>_<fused>_<tensor_size>
+#define BM_FusedElementwise(EXPR, FUSED, N, NUM_INPUTS)                \
+  static void BM_##EXPR##_##FUSED##_##N(int iters) {                   \
+    const int64 bytes = static_cast<int64>(N) * (NUM_INPUTS + 1) * 4;  \
+    testing::ItemsProcessed(static_cast<int64>(iters) * N);            \
+    testing::BytesProcessed(static_cast<int64>(iters) * bytes);        \
+    test::Benchmark("cpu", EXPR(N, FUSED)).Run(iters);                 \
+  }                                                                    \
+  BENCHMARK(BM_##EXPR##_##FUSED##_##N);
+
+#define BM_FusedAndUnfused(EXPR, N, NUM_INPUTS)   \
+  BM_FusedElementwise(EXPR, false, N, NUM_INPUTS) \
+  BM_FusedElementwise(EXPR, true, N, NUM_INPUTS)
+
+BM_FusedAndUnfused(ScaleAndShift, 10000, 1);
+BM_FusedAndUnfused(ScaleAndShift, 1000000, 1);
+BM_FusedAndUnfused(ScaleAndShift, 10000000, 1);
+
+BM_FusedAndUnfused(GatedSum, 10000, 3);
+BM_FusedAndUnfused(GatedSum, 1000000, 3);
+BM_FusedAndUnfused(GatedSum, 10000000, 3);
+
+BM_FusedAndUnfused(Gelu, 10000, 1);
+BM_FusedAndUnfused(Gelu, 1000000, 1);
+BM_FusedAndUnfused(Gelu, 10000000, 1);
+
+}  // namespace
+}  // namespace tensorflow
@@ -0,0 +1,79 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/fused_output_stage.h"
+
+#include "tensorflow/core/lib/strings/str_util.h"
+
+namespace tensorflow {
+
+Status InitFusedOutputStageParams(const OpKernelConstruction* context,
+                                  bool allow_batch_norm,
+                                  FusedOutputStageParams* params) {
+  std::vector<string> fused_ops;
+  TF_RETURN_IF_ERROR(context->GetAttr("fused_ops", &fused_ops));
+  int num_args;
+  TF_RETURN_IF_ERROR(context->GetAttr("num_args", &num_args));
+
+  const auto unimplemented = [&fused_ops]() {
+    return errors::Unimplemented("Fusion is not implemented: [",
+                                 str_util::Join(fused_ops, ","), "]");
+  };
+  if (fused_ops.empty() || fused_ops.size() > 2) return unimplemented();
+
+  int expected_num_args;
+  if (fused_ops[0] == "BiasAdd") {
+    params->batch_norm = false;
+    expected_num_args = 1;
+  } else if (allow_batch_norm && fused_ops[0] == "FusedBatchNorm") {
+    params->batch_norm = true;
+    expected_num_args = 4;
+    TF_RETURN_IF_ERROR(context->GetAttr("epsilon", &params->epsilon));
+  } else {
+    return unimplemented();
+  }
+
+  params->activation = FusedActivation::kNone;
+  if (fused_ops.size() == 2) {
+    if (fused_ops[1] == "Relu") {
+      params->activation = FusedActivation::kRelu;
+    } else if (fused_ops[1] == "Relu6") {
+      params->activation = FusedActivation::kRelu6;
+    } else if (fused_ops[1] == "Elu") {
+      params->activation = FusedActivation::kElu;
+    } else {
+      return unimplemented();
+    }
+  }
+
+  if (num_args != expected_num_args) {
+    return errors::InvalidArgument("Fused ", fused_ops[0], " expects ",
+                                   expected_num_args, " arguments, got ",
+                                   num_args);
+  }
+  return Status::OK();
+}
+
+Status ValidateFusedArgument(const Tensor& arg, StringPiece name,
+                             int64 channels) {
+  if (arg.dims() != 1 || arg.dim_size(0) != channels) {
+    return errors::InvalidArgument(name, " must be a vector of size ",
+                                   channels, ", got shape ",
+                                   arg.shape().DebugString());
+  }
+  return Status::OK();
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,160 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Output stage shared by the _FusedConv2D and _FusedMatMul kernels: a
+// per-channel affine transform (BiasAdd, or an inference mode FusedBatchNorm
+// folded into a scale and an offset) followed by an optional activation,
+// applied in place to the contraction output viewed as a [rows, channels]
+// matrix.
+
+#ifndef TENSORFLOW_CORE_KERNELS_FUSED_OUTPUT_STAGE_H_
+#define TENSORFLOW_CORE_KERNELS_FUSED_OUTPUT_STAGE_H_
+
+#include "third_party/eigen3/Eigen/Core"
+#include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/util/work_sharder.h"
+
+namespace tensorflow {
+
+enum class FusedActivation { kNone, kRelu, kRelu6, kElu };
+
+struct FusedOutputStageParams {
+  // If false, the output stage is a BiasAdd with a single [channels] argument.
+  // If true, it is a FusedBatchNorm with four [channels] arguments: scale,
+  // offset, mean and variance.
+  bool batch_norm = false;
+  FusedActivation activation = FusedActivation::kNone;
+  float epsilon = 0.0f;
+};
+
+// Initializes and validates the output stage from the `fused_ops`, `num_args`
+// and `epsilon` attributes. The supported fusions are "BiasAdd" and, if
+// `allow_batch_norm` is true, "FusedBatchNorm", optionally followed by one of
+// "Relu", "Relu6" or "Elu".
+Status InitFusedOutputStageParams(const OpKernelConstruction* context,
+                                  bool allow_batch_norm,
+                                  FusedOutputStageParams* params);
+
+// Returns an error unless `arg` is a vector of `channels` elements.
+Status ValidateFusedArgument(const Tensor& arg, StringPiece name,
+                             int64 channels);
+
+template <typename T>
+class FusedOutputStage {
+ public:
+  explicit FusedOutputStage(const FusedOutputStageParams& params)
+      : params_(params) {}
+
+  // Reads the fused arguments, which start at input `first_arg`. Batch norm
+  // statistics are folded into a per-channel scale and offset here, once per
+  // invocation, so that `Apply` touches every output element exactly once.
+  Status Init(OpKernelContext* context, int first_arg, int64 channels) {
+    if (!params_.batch_norm) {
+      const Tensor& bias = context->input(first_arg);
+      TF_RETURN_IF_ERROR(ValidateFusedArgument(bias, "bias", channels));
+      offset_ = bias;
+      return Status::OK();
+    }
+
+    const Tensor& scale = context->input(first_arg);
+    const Tensor& offset = context->input(first_arg + 1);
+    const Tensor& mean = context->input(first_arg + 2);
+    const Tensor& variance = context->input(first_arg + 3);
+    TF_RETURN_IF_ERROR(ValidateFusedArgument(scale, "scale", channels));
+    TF_RETURN_IF_ERROR(ValidateFusedArgument(offset, "offset", channels));
+    TF_RETURN_IF_ERROR(ValidateFusedArgument(mean, "mean", channels));
+    TF_RETURN_IF_ERROR(ValidateFusedArgument(variance, "variance", channels));
+
+    TF_RETURN_IF_ERROR(context->allocate_temp(
+        DataTypeToEnum<T>::value, TensorShape({channels}), &scale_));
+    TF_RETURN_IF_ERROR(context->allocate_temp(
+        DataTypeToEnum<T>::value, TensorShape({channels}), &offset_));
+    auto folded_scale = scale_.vec<T>();
+    folded_scale = (variance.vec<T>() + static_cast<T>(params_.epsilon))
+                       .rsqrt() *
+                   scale.vec<T>();
+    offset_.vec<T>() = offset.vec<T>() - mean.vec<T>() * folded_scale;
+    return Status::OK();
+  }
+
+  // Applies the output stage in place. Rows are sharded over the intra-op
+  // threads, and each row goes through the affine transform and the
+  // activation while it is still in L1.
+  void Apply(OpKernelContext* context,
+             typename TTypes<T>::Matrix output) const {
+    const int64 rows = output.dimension(0);
+    const int64 channels = output.dimension(1);
+    if (rows == 0 || channels == 0) return;
+
+    T* data = output.data();
+    const T* scale = params_.batch_norm ? scale_.vec<T>().data() : nullptr;
+    const T* offset = offset_.vec<T>().data();
+    const FusedActivation activation = params_.activation;
+
+    auto apply_rows = [data, scale, offset, channels, activation](int64 begin,
+                                                                  int64 end) {
+      for (int64 row = begin; row < end; ++row) {
+        ApplyRow(data + row * channels, scale, offset, channels, activation);
+      }
+    };
+
+    const int64 cost_per_row =
+        channels * (activation == FusedActivation::kElu ? 20 : 4);
+    const DeviceBase::CpuWorkerThreads& worker_threads =
+        *context->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads.num_threads, worker_threads.workers, rows,
+          cost_per_row, apply_rows);
+  }
+
+ private:
+  using Array = Eigen::Array<T, Eigen::Dynamic, 1>;
+
+  static void ApplyRow(T* row, const T* scale, const T* offset, int64 channels,
+                       FusedActivation activation) {
+    Eigen::Map<Array> x(row, channels);
+    Eigen::Map<const Array> b(offset, channels);
+    if (scale != nullptr) {
+      x = x * Eigen::Map<const Array>(scale, channels) + b;
+    } else {
+      x += b;
+    }
+    switch (activation) {
+      case FusedActivation::kNone:
+        break;
+      case FusedActivation::kRelu:
+        x = x.cwiseMax(static_cast<T>(0));
+        break;
+      case FusedActivation::kRelu6:
+        x = x.cwiseMax(static_cast<T>(0)).cwiseMin(static_cast<T>(6));
+        break;
+      case FusedActivation::kElu:
+        x = (x < static_cast<T>(0)).select(x.exp() - static_cast<T>(1), x);
+        break;
+    }
+  }
+
+  const FusedOutputStageParams params_;
+  Tensor scale_;
+  Tensor offset_;
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_FUSED_OUTPUT_STAGE_H_
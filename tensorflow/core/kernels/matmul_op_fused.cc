@@ -0,0 +1,115 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Implements the _FusedMatMul op: a MatMul followed by a BiasAdd and
+// optionally an activation. The graph remapper
+// (grappler/optimizers/remapper.cc) creates these nodes on CPU.
+
+#define EIGEN_USE_THREADS
+
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/register_types.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/kernels/fill_functor.h"
+#include "tensorflow/core/kernels/fused_output_stage.h"
+#include "tensorflow/core/kernels/matmul_op.h"
+#include "tensorflow/core/lib/core/errors.h"
+
+namespace tensorflow {
+
+typedef Eigen::ThreadPoolDevice CPUDevice;
+
+// See conv_ops_fused_output.cc for how the output stage is applied.
+template <typename T>
+class FusedMatMulOp : public OpKernel {
+ public:
+  explicit FusedMatMulOp(OpKernelConstruction* context) : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("transpose_a", &transpose_a_));
+    OP_REQUIRES_OK(context, context->GetAttr("transpose_b", &transpose_b_));
+    OP_REQUIRES_OK(context,
+                   InitFusedOutputStageParams(context,
+                                              /*allow_batch_norm=*/false,
+                                              &output_stage_params_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& a = context->input(0);
+    const Tensor& b = context->input(1);
+
+    // Check that the dimensions of the two matrices are valid.
+    OP_REQUIRES(context, TensorShapeUtils::IsMatrix(a.shape()),
+                errors::InvalidArgument("In[0] is not a matrix"));
+    OP_REQUIRES(context, TensorShapeUtils::IsMatrix(b.shape()),
+                errors::InvalidArgument("In[1] is not a matrix"));
+    Eigen::array<Eigen::IndexPair<Eigen::DenseIndex>, 1> dim_pair;
+    dim_pair[0].first = transpose_a_ ? 0 : 1;
+    dim_pair[0].second = transpose_b_ ? 1 : 0;
+
+    OP_REQUIRES(
+        context,
+        a.dim_size(dim_pair[0].first) == b.dim_size(dim_pair[0].second),
+        errors::InvalidArgument(
+            "Matrix size-incompatible: In[0]: ", a.shape().DebugString(),
+            ", In[1]: ", b.shape().DebugString()));
+    const int a_dim_remaining = 1 - dim_pair[0].first;
+    const int b_dim_remaining = 1 - dim_pair[0].second;
+    TensorShape out_shape(
+        {a.dim_size(a_dim_remaining), b.dim_size(b_dim_remaining)});
+
+    // Fused arguments follow the two matrices.
+    FusedOutputStage<T> output_stage(output_stage_params_);
+    OP_REQUIRES_OK(context, output_stage.Init(context, /*first_arg=*/2,
+                                              out_shape.dim_size(1)));
+
+    Tensor* out = nullptr;
+    OP_REQUIRES_OK(context, context->allocate_output(0, out_shape, &out));
+
+    if (out->NumElements() == 0) {
+      return;
+    }
+
+    const CPUDevice& d = context->eigen_device<CPUDevice>();
+    if (a.NumElements() == 0 || b.NumElements() == 0) {
+      // The product of [x, 0] and [0, y] matrices is all zeros, but the output
+      // stage still applies to it.
+      functor::SetZeroFunctor<CPUDevice, T>()(d, out->flat<T>());
+    } else {
+      functor::MatMul<CPUDevice>(d, out->matrix<T>(), a.matrix<T>(),
+                                 b.matrix<T>(), dim_pair);
+    }
+
+    output_stage.Apply(context, out->matrix<T>());
+  }
+
+ private:
+  bool transpose_a_;
+  bool transpose_b_;
+  FusedOutputStageParams output_stage_params_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(FusedMatMulOp);
+};
+
+#define REGISTER_CPU(T)                                               \
+  REGISTER_KERNEL_BUILDER(                                            \
+      Name("_FusedMatMul").Device(DEVICE_CPU).TypeConstraint<T>("T"), \
+      FusedMatMulOp<T>);
+
+TF_CALL_float(REGISTER_CPU);
+TF_CALL_double(REGISTER_CPU);
+
+#undef REGISTER_CPU
+
+}  // namespace tensorflow
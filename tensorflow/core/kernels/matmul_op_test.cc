@@ -14,7 +14,12 @@ limitations under the License.
 ==============================================================================*/
 
 #include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
 
@@ -127,4 +132,152 @@ BM_Matmul(2000, 1, 2000, true, false);
 BM_Matmul(2000, 1, 2000, false, true);
 BM_Matmul(2000, 1, 2000, true, true);
 
+class FusedMatMulOpTest : public OpsTestBase {
+ protected:
+  void VerifyFusedMatMul(int m, int k, int n, bool transpose_a,
+                         bool transpose_b,
+                         const std::vector<string>& fused_ops) {
+    TF_ASSERT_OK(NodeDefBuilder("fused_matmul", "_FusedMatMul")
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(1, DT_FLOAT))
+                     .Attr("num_args", 1)
+                     .Attr("T", DT_FLOAT)
+                     .Attr("transpose_a", transpose_a)
+                     .Attr("transpose_b", transpose_b)
+                     .Attr("fused_ops", fused_ops)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+
+    Tensor a(DT_FLOAT, transpose_a ? TensorShape({k, m}) : TensorShape({m, k}));
+    a.flat<float>().setRandom();
+    Tensor b(DT_FLOAT, transpose_b ? TensorShape({n, k}) : TensorShape({k, n}));
+    b.flat<float>().setRandom();
+    Tensor bias(DT_FLOAT, TensorShape({n}));
+    bias.flat<float>().setRandom();
+
+    // Compute the expected result with plain loops.
+    Tensor expected(DT_FLOAT, TensorShape({m, n}));
+    auto a_matrix = a.matrix<float>();
+    auto b_matrix = b.matrix<float>();
+    for (int i = 0; i < m; ++i) {
+      for (int j = 0; j < n; ++j) {
+        float sum = bias.vec<float>()(j);
+        for (int l = 0; l < k; ++l) {
+          sum += (transpose_a ? a_matrix(l, i) : a_matrix(i, l)) *
+                 (transpose_b ? b_matrix(j, l) : b_matrix(l, j));
+        }
+        if (fused_ops.size() > 1) {
+          if (fused_ops[1] == "Relu") {
+            sum = std::max(sum, 0.0f);
+          } else if (fused_ops[1] == "Relu6") {
+            sum = std::min(std::max(sum, 0.0f), 6.0f);
+          } else if (fused_ops[1] == "Elu") {
+            sum = sum < 0.0f ? std::expm1(sum) : sum;
+          }
+        }
+        expected.matrix<float>()(i, j) = sum;
+      }
+    }
+
+    AddInputFromArray<float>(a.shape(), a.flat<float>());
+    AddInputFromArray<float>(b.shape(), b.flat<float>());
+    AddInputFromArray<float>(bias.shape(), bias.flat<float>());
+    TF_ASSERT_OK(RunOpKernel());
+    test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-5);
+  }
+};
+
+TEST_F(FusedMatMulOpTest, WithBias) {
+  VerifyFusedMatMul(8, 16, 4, false, false, {"BiasAdd"});
+}
+
+TEST_F(FusedMatMulOpTest, WithBiasAndRelu) {
+  VerifyFusedMatMul(8, 16, 4, false, false, {"BiasAdd", "Relu"});
+}
+
+TEST_F(FusedMatMulOpTest, WithBiasAndRelu6Transposed) {
+  VerifyFusedMatMul(8, 16, 4, true, true, {"BiasAdd", "Relu6"});
+}
+
+TEST_F(FusedMatMulOpTest, WithBiasAndElu) {
+  VerifyFusedMatMul(1, 32, 5, false, true, {"BiasAdd", "Elu"});
+}
+
+TEST_F(FusedMatMulOpTest, EmptyInnerDimension) {
+  VerifyFusedMatMul(3, 0, 4, false, false, {"BiasAdd", "Relu"});
+}
+
+TEST_F(FusedMatMulOpTest, BatchNormIsNotSupported) {
+  TF_ASSERT_OK(NodeDefBuilder("fused_matmul", "_FusedMatMul")
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(4, DT_FLOAT))
+                   .Attr("num_args", 4)
+                   .Attr("T", DT_FLOAT)
+                   .Attr("fused_ops", {"FusedBatchNorm"})
+                   .Finalize(node_def()));
+  Status status = InitOp();
+  EXPECT_EQ(error::UNIMPLEMENTED, status.code());
+}
+
+// MatMul followed by a BiasAdd and a Relu, either as separate nodes or as a
+// single _FusedMatMul node.
+static Graph* MatmulBiasRelu(int m, int k, int n, bool fused) {
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor in0(DT_FLOAT, TensorShape({m, k}));
+  in0.flat<float>().setRandom();
+  Tensor in1(DT_FLOAT, TensorShape({k, n}));
+  in1.flat<float>().setRandom();
+  Tensor bias(DT_FLOAT, TensorShape({n}));
+  bias.flat<float>().setRandom();
+
+  Node* a = test::graph::Constant(g, in0);
+  Node* b = test::graph::Constant(g, in1);
+  Node* c = test::graph::Constant(g, bias);
+  Node* node;
+  if (fused) {
+    TF_CHECK_OK(NodeBuilder(g->NewName("fused_matmul"), "_FusedMatMul")
+                    .Input(a)
+                    .Input(b)
+                    .Input({NodeBuilder::NodeOut(c)})
+                    .Attr("T", DT_FLOAT)
+                    .Attr("num_args", 1)
+                    .Attr("fused_ops", {"BiasAdd", "Relu"})
+                    .Finalize(g, &node));
+    return g;
+  }
+  node = test::graph::Matmul(g, a, b, false, false);
+  TF_CHECK_OK(NodeBuilder(g->NewName("bias_add"), "BiasAdd")
+                  .Input(node)
+                  .Input(c)
+                  .Attr("T", DT_FLOAT)
+                  .Finalize(g, &node));
+  TF_CHECK_OK(NodeBuilder(g->NewName("relu"), "Relu")
+                  .Input(node)
+                  .Attr("T", DT_FLOAT)
+                  .Finalize(g, &node));
+  return g;
+}
+
+#define BM_MatmulBiasReluDev(M, K, N, FUSED, LABEL)                       \
+  static void BM_MatmulBiasRelu##_##M##_##K##_##N##_##LABEL(int iters) { \
+    testing::UseRealTime();                                              \
+    testing::ItemsProcessed(static_cast<int64>(iters) * M * K * N * 2);  \
+    test::Benchmark("cpu", MatmulBiasRelu(M, K, N, FUSED)).Run(iters);   \
+  }                                                                      \
+  BENCHMARK(BM_MatmulBiasRelu##_##M##_##K##_##N##_##LABEL);
+
+#define BM_MatmulBiasRelu(M, K, N)               \
+  BM_MatmulBiasReluDev(M, K, N, false, unfused); \
+  BM_MatmulBiasReluDev(M, K, N, true, fused);
+
+// Hidden layers of a wide-and-deep model's deep MLP at inference batch sizes.
+BM_MatmulBiasRelu(1, 1024, 512);
+BM_MatmulBiasRelu(1, 512, 256);
+BM_MatmulBiasRelu(32, 1024, 512);
+BM_MatmulBiasRelu(32, 512, 256);
+BM_MatmulBiasRelu(256, 1024, 512);
+BM_MatmulBiasRelu(256, 512, 256);
+
 }  // end namespace tensorflow
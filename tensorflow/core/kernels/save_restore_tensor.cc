@@ -226,6 +226,21 @@ void RestoreTensor(OpKernelContext* context,
 #undef READER_COPY
 }
 
+namespace {
+
+Status CheckRestoredDtype(const string& tensor_name, DataType expected,
+                          const Tensor& restored_tensor) {
+  if (expected != restored_tensor.dtype()) {
+    return errors::InvalidArgument(
+        "tensor_name = ", tensor_name, "; expected dtype ",
+        DataTypeString(expected), " does not equal restored dtype ",
+        DataTypeString(restored_tensor.dtype()));
+  }
+  return Status::OK();
+}
+
+}  // namespace
+
 Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
                         const Tensor& tensor_names,
                         const Tensor& shape_and_slices,
@@ -246,9 +261,11 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
   BundleReader reader(Env::Default(), prefix_string);
   TF_RETURN_IF_ERROR(reader.status());
 
-  // TODO(zongheng): potential optimization: one Seek() in first lookup.
-  // TODO(zongheng): consider measuring speed and issuing concurrent lookups
-  // within a fixed memory budget.
+  // Slices are restored one at a time here, while whole tensors are read
+  // concurrently by LookupMany() below.
+  std::vector<size_t> full_tensor_idx;
+  std::vector<string> full_tensor_names;
+  std::vector<Tensor*> full_tensors;
   TensorShape restored_full_shape;
   Tensor* restored_tensor = nullptr;
   for (auto i : sorted_name_idx) {
@@ -259,38 +276,44 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
         reader.LookupTensorShape(tensor_name, &restored_full_shape));
 
     if (shape_and_slice.empty()) {
-      // Lookup the full tensor.
       TF_RETURN_IF_ERROR(
           context->allocate_output(i, restored_full_shape, &restored_tensor));
-      TF_RETURN_IF_ERROR(reader.Lookup(tensor_name, restored_tensor));
-    } else {
-      // Lookup the slice.
-      TensorShape parsed_full_shape;
-      TensorSlice parsed_slice;
-      TensorShape parsed_slice_shape;
-
-      TF_RETURN_IF_ERROR(
-          checkpoint::ParseShapeAndSlice(shape_and_slice, &parsed_full_shape,
-                                         &parsed_slice, &parsed_slice_shape));
-      if (!restored_full_shape.IsSameSize(parsed_full_shape)) {
-        return errors::InvalidArgument(
-            "tensor_name = ", tensor_name, "; shape in shape_and_slice spec ",
-            parsed_full_shape.DebugString(),
-            " does not match the shape stored in checkpoint: ",
-            restored_full_shape.DebugString());
-      }
-
-      TF_RETURN_IF_ERROR(
-          context->allocate_output(i, parsed_slice_shape, &restored_tensor));
-      TF_RETURN_IF_ERROR(
-          reader.LookupSlice(tensor_name, parsed_slice, restored_tensor));
+      full_tensor_idx.push_back(i);
+      full_tensor_names.push_back(tensor_name);
+      full_tensors.push_back(restored_tensor);
+      continue;
     }
-    if (dtypes[i] != restored_tensor->dtype()) {
+    // Lookup the slice.
+    TensorShape parsed_full_shape;
+    TensorSlice parsed_slice;
+    TensorShape parsed_slice_shape;
+
+    TF_RETURN_IF_ERROR(
+        checkpoint::ParseShapeAndSlice(shape_and_slice, &parsed_full_shape,
+                                       &parsed_slice, &parsed_slice_shape));
+    if (!restored_full_shape.IsSameSize(parsed_full_shape)) {
       return errors::InvalidArgument(
-          "tensor_name = ", tensor_name, "; expected dtype ",
-          DataTypeString(dtypes[i]), " does not equal restored dtype ",
-          DataTypeString(restored_tensor->dtype()));
+          "tensor_name = ", tensor_name, "; shape in shape_and_slice spec ",
+          parsed_full_shape.DebugString(),
+          " does not match the shape stored in checkpoint: ",
+          restored_full_shape.DebugString());
     }
+
+    TF_RETURN_IF_ERROR(
+        context->allocate_output(i, parsed_slice_shape, &restored_tensor));
+    TF_RETURN_IF_ERROR(
+        reader.LookupSlice(tensor_name, parsed_slice, restored_tensor));
+    TF_RETURN_IF_ERROR(
+        CheckRestoredDtype(tensor_name, dtypes[i], *restored_tensor));
+  }
+
+  // Lookup the full tensors.
+  TF_RETURN_IF_ERROR(reader.LookupMany(
+      full_tensor_names, full_tensors,
+      context->device()->tensorflow_cpu_worker_threads()->workers));
+  for (size_t j = 0; j < full_tensor_idx.size(); ++j) {
+    TF_RETURN_IF_ERROR(CheckRestoredDtype(
+        full_tensor_names[j], dtypes[full_tensor_idx[j]], *full_tensors[j]));
   }
   return Status::OK();
 }
@@ -29,6 +29,7 @@ limitations under the License.
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/saved_tensor_slice_util.h"
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 #include "tensorflow/core/util/tensor_slice_reader.h"
@@ -90,7 +91,18 @@ void ValidateInputs(bool is_save_op, OpKernelContext* context,
 // Saves a list of named tensors using the tensor bundle library.
 class SaveV2 : public OpKernel {
  public:
-  explicit SaveV2(OpKernelConstruction* context) : OpKernel(context) {}
+  explicit SaveV2(OpKernelConstruction* context) : OpKernel(context) {
+    // Large checkpoints can be split over several data files, which are
+    // written in parallel.
+    int64 num_shards;
+    OP_REQUIRES_OK(context, ReadInt64FromEnvVar("TF_SAVE_V2_NUM_DATA_SHARDS",
+                                                1, &num_shards));
+    OP_REQUIRES(context, num_shards >= 1 && num_shards <= 99999,
+                errors::InvalidArgument(
+                    "TF_SAVE_V2_NUM_DATA_SHARDS must be in [1, 99999], got ",
+                    num_shards));
+    writer_options_.num_shards = num_shards;
+  }
 
   void Compute(OpKernelContext* context) override {
     const Tensor& prefix = context->input(0);
@@ -105,9 +117,10 @@ class SaveV2 : public OpKernel {
     const auto& tensor_names_flat = tensor_names.flat<string>();
     const auto& shape_and_slices_flat = shape_and_slices.flat<string>();
 
-    BundleWriter writer(Env::Default(), prefix_string);
+    BundleWriter writer(Env::Default(), prefix_string, writer_options_);
     OP_REQUIRES_OK(context, writer.status());
-    VLOG(1) << "BundleWriter, prefix_string: " << prefix_string;
+    VLOG(1) << "BundleWriter, prefix_string: " << prefix_string
+            << ", num_shards: " << writer_options_.num_shards;
 
     for (int i = 0; i < num_tensors; ++i) {
       const string& tensor_name = tensor_names_flat(i);
@@ -136,6 +149,9 @@ class SaveV2 : public OpKernel {
     }
     OP_REQUIRES_OK(context, writer.Finish());
   }
+
+ private:
+  BundleWriter::Options writer_options_;
 };
 REGISTER_KERNEL_BUILDER(Name("SaveV2").Device(DEVICE_CPU), SaveV2);
 
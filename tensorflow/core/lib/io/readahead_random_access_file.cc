@@ -0,0 +1,124 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/lib/io/readahead_random_access_file.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "tensorflow/core/lib/core/errors.h"
+
+namespace tensorflow {
+namespace io {
+
+ReadaheadRandomAccessFile::ReadaheadRandomAccessFile(
+    std::unique_ptr<RandomAccessFile> file, thread::ThreadPool* pool,
+    size_t block_size, int num_blocks)
+    : file_(std::move(file)),
+      pool_(pool),
+      block_size_(std::max(block_size, size_t{1})),
+      num_blocks_(std::max(num_blocks, 0)) {}
+
+ReadaheadRandomAccessFile::~ReadaheadRandomAccessFile() {
+  mutex_lock l(mu_);
+  while (num_in_flight_ > 0) {
+    cond_var_.wait(l);
+  }
+}
+
+void ReadaheadRandomAccessFile::ScheduleReadLocked(uint64 offset) const {
+  std::shared_ptr<Block> block = std::make_shared<Block>();
+  block->offset = offset;
+  blocks_.push_back(block);
+  ++num_in_flight_;
+  pool_->Schedule([this, block]() {
+    string data;
+    data.resize(block_size_);
+    StringPiece result;
+    Status s = file_->Read(block->offset, block_size_, &result, &data[0]);
+    if (result.data() == data.data()) {
+      data.resize(result.size());
+    } else {
+      data.assign(result.data(), result.size());
+    }
+    mutex_lock l(mu_);
+    block->data.swap(data);
+    block->status = s;
+    block->done = true;
+    --num_in_flight_;
+    cond_var_.notify_all();
+  });
+}
+
+std::shared_ptr<ReadaheadRandomAccessFile::Block>
+ReadaheadRandomAccessFile::GetBlockLocked(uint64 offset) const {
+  while (!blocks_.empty() && blocks_.front()->offset < offset) {
+    blocks_.pop_front();
+  }
+  if (!blocks_.empty() && blocks_.front()->offset != offset) {
+    blocks_.clear();
+  }
+  if (blocks_.empty()) {
+    ScheduleReadLocked(offset);
+  }
+  while (blocks_.size() <= static_cast<size_t>(num_blocks_)) {
+    const Block& last = *blocks_.back();
+    // Nothing is left to read after a short or failed read.
+    if (last.done && (last.data.size() < block_size_ || !last.status.ok())) {
+      break;
+    }
+    ScheduleReadLocked(last.offset + block_size_);
+  }
+  return blocks_.front();
+}
+
+Status ReadaheadRandomAccessFile::Read(uint64 offset, size_t n,
+                                       StringPiece* result,
+                                       char* scratch) const {
+  mutex_lock l(mu_);
+  Status s;
+  size_t copied = 0;
+  while (copied < n) {
+    const uint64 position = offset + copied;
+    const uint64 block_offset = position - position % block_size_;
+    std::shared_ptr<Block> block = GetBlockLocked(block_offset);
+    while (!block->done) {
+      cond_var_.wait(l);
+    }
+    if (!block->status.ok() && !errors::IsOutOfRange(block->status)) {
+      // Drops the blocks so that the next read retries.
+      blocks_.clear();
+      s = block->status;
+      break;
+    }
+    const size_t skip = position - block_offset;
+    const size_t available =
+        block->data.size() > skip ? block->data.size() - skip : 0;
+    const size_t to_copy = std::min(n - copied, available);
+    memcpy(scratch + copied, block->data.data() + skip, to_copy);
+    copied += to_copy;
+    if (copied < n && block->data.size() < block_size_) {
+      s = errors::OutOfRange("EOF reached, read ", copied, " bytes of ", n,
+                             " requested at offset ", offset);
+      break;
+    }
+  }
+  *result = StringPiece(scratch, copied);
+  return s;
+}
+
+}  // namespace io
+}  // namespace tensorflow
@@ -0,0 +1,90 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_LIB_IO_READAHEAD_RANDOM_ACCESS_FILE_H_
+#define TENSORFLOW_CORE_LIB_IO_READAHEAD_RANDOM_ACCESS_FILE_H_
+
+#include <deque>
+#include <memory>
+
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/file_system.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace io {
+
+// Wraps a RandomAccessFile and reads it ahead of its reader in blocks of
+// `block_size` bytes on the threads of `pool`.
+//
+// While the file is read sequentially, the block being read and the
+// `num_blocks` blocks after it are either buffered or being read, so that
+// the latency of the underlying file (e.g. on a network file system) is
+// overlapped with the work of the reader. A read outside of these blocks
+// discards them and restarts the readahead at its offset.
+//
+// Like any RandomAccessFile, this class is safe for concurrent use, but
+// concurrent readers at different offsets keep discarding each other's
+// blocks.
+class ReadaheadRandomAccessFile : public RandomAccessFile {
+ public:
+  // `pool` must outlive *this.
+  ReadaheadRandomAccessFile(std::unique_ptr<RandomAccessFile> file,
+                            thread::ThreadPool* pool, size_t block_size,
+                            int num_blocks);
+
+  // Waits for the reads that are in flight.
+  ~ReadaheadRandomAccessFile() override;
+
+  Status Read(uint64 offset, size_t n, StringPiece* result,
+              char* scratch) const override;
+
+ private:
+  struct Block {
+    uint64 offset;
+    bool done = false;
+    Status status;
+    string data;
+  };
+
+  // Returns the block that starts at `offset` and schedules the reads of the
+  // blocks after it, dropping the blocks before it.
+  std::shared_ptr<Block> GetBlockLocked(uint64 offset) const
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  void ScheduleReadLocked(uint64 offset) const EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const std::unique_ptr<RandomAccessFile> file_;
+  thread::ThreadPool* const pool_;  // Not owned.
+  const size_t block_size_;
+  const int num_blocks_;
+
+  mutable mutex mu_;
+  mutable condition_variable cond_var_;
+  // Consecutive blocks, starting with the block that was read last.
+  mutable std::deque<std::shared_ptr<Block>> blocks_ GUARDED_BY(mu_);
+  mutable int num_in_flight_ GUARDED_BY(mu_) = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ReadaheadRandomAccessFile);
+};
+
+}  // namespace io
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_LIB_IO_READAHEAD_RANDOM_ACCESS_FILE_H_
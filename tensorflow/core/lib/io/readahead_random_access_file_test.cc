@@ -0,0 +1,310 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/lib/io/readahead_random_access_file.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/null_file_system.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace io {
+namespace {
+
+// A file system with files in memory whose reads can be held back, like the
+// reads of a remote file system that take a while to complete.
+class SlowFileSystem : public NullFileSystem {
+ public:
+  void AddFile(const string& fname, const string& contents) {
+    files_[fname] = contents;
+  }
+
+  Status NewRandomAccessFile(
+      const string& fname, std::unique_ptr<RandomAccessFile>* result) override {
+    auto it = files_.find(fname);
+    if (it == files_.end()) {
+      return errors::NotFound(fname);
+    }
+    result->reset(new SlowFile(this, it->second));
+    return Status::OK();
+  }
+
+  // Makes the reads of the files of this file system wait until
+  // `ResumeReads()` is called.
+  void HoldReads() {
+    mutex_lock l(mu_);
+    held_ = true;
+  }
+
+  // Completes the reads that are held and stops holding reads.
+  void ResumeReads() {
+    mutex_lock l(mu_);
+    held_ = false;
+    cond_var_.notify_all();
+  }
+
+  // Waits until `n` reads of the files of this file system have started.
+  void WaitForReads(int64 n) {
+    mutex_lock l(mu_);
+    while (num_reads_ < n) {
+      cond_var_.wait(l);
+    }
+  }
+
+  // Waits until `n` reads of the files of this file system have completed.
+  void WaitForCompletedReads(int64 n) {
+    mutex_lock l(mu_);
+    while (num_completed_reads_ < n) {
+      cond_var_.wait(l);
+    }
+  }
+
+  // The number of reads of the files of this file system.
+  int64 num_reads() {
+    mutex_lock l(mu_);
+    return num_reads_;
+  }
+
+  // The offsets of the reads of the files of this file system, in the order
+  // in which they started.
+  std::vector<uint64> read_offsets() {
+    mutex_lock l(mu_);
+    return read_offsets_;
+  }
+
+  // Fails the reads that start at or after `offset`.
+  void FailReadsAfter(uint64 offset) {
+    mutex_lock l(mu_);
+    fail_offset_ = offset;
+  }
+
+ private:
+  class SlowFile : public RandomAccessFile {
+   public:
+    SlowFile(SlowFileSystem* fs, const string& contents)
+        : fs_(fs), contents_(contents) {}
+
+    Status Read(uint64 offset, size_t n, StringPiece* result,
+                char* scratch) const override {
+      mutex_lock l(fs_->mu_);
+      ++fs_->num_reads_;
+      fs_->read_offsets_.push_back(offset);
+      fs_->cond_var_.notify_all();
+      while (fs_->held_) {
+        fs_->cond_var_.wait(l);
+      }
+      ++fs_->num_completed_reads_;
+      fs_->cond_var_.notify_all();
+      if (offset >= fs_->fail_offset_) {
+        *result = StringPiece();
+        return errors::Unavailable("read failed at ", offset);
+      }
+      if (offset >= contents_.size()) {
+        *result = StringPiece();
+        return errors::OutOfRange("EOF");
+      }
+      const size_t m = std::min<size_t>(n, contents_.size() - offset);
+      memcpy(scratch, contents_.data() + offset, m);
+      *result = StringPiece(scratch, m);
+      return m < n ? errors::OutOfRange("EOF") : Status::OK();
+    }
+
+   private:
+    SlowFileSystem* const fs_;
+    const string contents_;
+  };
+
+  std::map<string, string> files_;
+  mutex mu_;
+  condition_variable cond_var_;
+  bool held_ GUARDED_BY(mu_) = false;
+  int64 num_reads_ GUARDED_BY(mu_) = 0;
+  int64 num_completed_reads_ GUARDED_BY(mu_) = 0;
+  std::vector<uint64> read_offsets_ GUARDED_BY(mu_);
+  uint64 fail_offset_ GUARDED_BY(mu_) = kuint64max;
+};
+
+string RandomContents(size_t size) {
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  string contents(size, '\0');
+  for (size_t i = 0; i < size; ++i) {
+    contents[i] = static_cast<char>(rnd.Uniform(256));
+  }
+  return contents;
+}
+
+std::unique_ptr<RandomAccessFile> OpenFile(SlowFileSystem* fs,
+                                           const string& fname,
+                                           thread::ThreadPool* pool,
+                                           size_t block_size, int num_blocks) {
+  std::unique_ptr<RandomAccessFile> file;
+  TF_CHECK_OK(fs->NewRandomAccessFile(fname, &file));
+  return std::unique_ptr<RandomAccessFile>(new ReadaheadRandomAccessFile(
+      std::move(file), pool, block_size, num_blocks));
+}
+
+TEST(ReadaheadRandomAccessFileTest, SequentialReads) {
+  const string contents = RandomContents(10000);
+  SlowFileSystem fs;
+  fs.AddFile("f", contents);
+  thread::ThreadPool pool(Env::Default(), "test", 4);
+
+  for (int num_blocks : {0, 1, 4}) {
+    for (size_t read_size : {1, 37, 100, 250}) {
+      std::unique_ptr<RandomAccessFile> file =
+          OpenFile(&fs, "f", &pool, 100, num_blocks);
+      string scratch(read_size, '\0');
+      StringPiece result;
+      uint64 offset = 0;
+      Status s;
+      while (s.ok()) {
+        s = file->Read(offset, read_size, &result, &scratch[0]);
+        EXPECT_EQ(contents.substr(offset, read_size), result);
+        offset += result.size();
+      }
+      EXPECT_TRUE(errors::IsOutOfRange(s)) << s;
+      EXPECT_EQ(contents.size(), offset);
+    }
+  }
+}
+
+TEST(ReadaheadRandomAccessFileTest, RandomReads) {
+  const string contents = RandomContents(10000);
+  SlowFileSystem fs;
+  fs.AddFile("f", contents);
+  thread::ThreadPool pool(Env::Default(), "test", 4);
+  std::unique_ptr<RandomAccessFile> file = OpenFile(&fs, "f", &pool, 64, 2);
+
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  string scratch(500, '\0');
+  for (int i = 0; i < 100; ++i) {
+    const uint64 offset = rnd.Uniform(contents.size() + 10);
+    const size_t n = rnd.Uniform(scratch.size());
+    StringPiece result;
+    Status s = file->Read(offset, n, &result, &scratch[0]);
+    if (offset + n <= contents.size()) {
+      TF_EXPECT_OK(s);
+    } else {
+      EXPECT_TRUE(errors::IsOutOfRange(s)) << s;
+    }
+    EXPECT_EQ(offset < contents.size() ? contents.substr(offset, n) : "",
+              result);
+  }
+}
+
+TEST(ReadaheadRandomAccessFileTest, ReadsAhead) {
+  const string contents = RandomContents(1000);
+  SlowFileSystem fs;
+  fs.AddFile("f", contents);
+  thread::ThreadPool pool(Env::Default(), "test", 8);
+  std::unique_ptr<RandomAccessFile> file = OpenFile(&fs, "f", &pool, 100, 4);
+
+  // The first block and the 4 blocks after it are all read before any of
+  // their reads completes.
+  fs.HoldReads();
+  char scratch[10];
+  StringPiece result;
+  Status s;
+  {
+    std::unique_ptr<Thread> reader(Env::Default()->StartThread(
+        ThreadOptions(), "reader",
+        [&]() { s = file->Read(0, 10, &result, scratch); }));
+    fs.WaitForReads(5);
+    fs.ResumeReads();
+  }
+  TF_ASSERT_OK(s);
+  EXPECT_EQ(contents.substr(0, 10), result);
+  EXPECT_EQ(5, fs.num_reads());
+
+  // Reading the second block schedules the sixth.
+  TF_ASSERT_OK(file->Read(100, 10, &result, scratch));
+  EXPECT_EQ(contents.substr(100, 10), result);
+  fs.WaitForReads(6);
+  EXPECT_EQ(6, fs.num_reads());
+  EXPECT_EQ(500, fs.read_offsets().back());
+}
+
+TEST(ReadaheadRandomAccessFileTest, HidesLatency) {
+  const string contents = RandomContents(2000);
+  SlowFileSystem fs;
+  fs.AddFile("f", contents);
+  thread::ThreadPool pool(Env::Default(), "test", 8);
+  std::unique_ptr<RandomAccessFile> file = OpenFile(&fs, "f", &pool, 100, 4);
+
+  char scratch[100];
+  StringPiece result;
+  TF_ASSERT_OK(file->Read(0, 100, &result, scratch));
+  fs.WaitForCompletedReads(5);
+
+  // While the reads of the file are held, the reader still gets the 4 blocks
+  // that were read ahead of it, and each of them schedules the read of a
+  // further block.
+  fs.HoldReads();
+  for (uint64 offset = 100; offset < 500; offset += 100) {
+    TF_ASSERT_OK(file->Read(offset, 100, &result, scratch));
+    EXPECT_EQ(contents.substr(offset, 100), result);
+  }
+  fs.WaitForReads(9);
+  // The reads that are in flight at the same time may start in any order.
+  std::vector<uint64> offsets = fs.read_offsets();
+  std::sort(offsets.begin(), offsets.end());
+  EXPECT_EQ(std::vector<uint64>({0, 100, 200, 300, 400, 500, 600, 700, 800}),
+            offsets);
+
+  // The reader waits for the blocks that are not read yet.
+  fs.ResumeReads();
+  for (uint64 offset = 500; offset < contents.size(); offset += 100) {
+    TF_ASSERT_OK(file->Read(offset, 100, &result, scratch));
+    EXPECT_EQ(contents.substr(offset, 100), result);
+  }
+}
+
+TEST(ReadaheadRandomAccessFileTest, PropagatesErrors) {
+  const string contents = RandomContents(1000);
+  SlowFileSystem fs;
+  fs.AddFile("f", contents);
+  fs.FailReadsAfter(300);
+  thread::ThreadPool pool(Env::Default(), "test", 4);
+  std::unique_ptr<RandomAccessFile> file = OpenFile(&fs, "f", &pool, 100, 4);
+
+  char scratch[150];
+  StringPiece result;
+  TF_ASSERT_OK(file->Read(0, 150, &result, scratch));
+  TF_ASSERT_OK(file->Read(150, 150, &result, scratch));
+  EXPECT_EQ(contents.substr(150, 150), result);
+  Status s = file->Read(300, 150, &result, scratch);
+  EXPECT_TRUE(errors::IsUnavailable(s)) << s;
+
+  // The failed read is retried.
+  fs.FailReadsAfter(kuint64max);
+  TF_ASSERT_OK(file->Read(300, 150, &result, scratch));
+  EXPECT_EQ(contents.substr(300, 150), result);
+}
+
+}  // namespace
+}  // namespace io
+}  // namespace tensorflow
@@ -17,6 +17,9 @@ limitations under the License.
 
 #include <limits.h>
 
+#include <algorithm>
+
+#include "tensorflow/core/lib/core/blocking_counter.h"
 #include "tensorflow/core/lib/core/coding.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/hash/crc32c.h"
@@ -24,6 +27,8 @@ limitations under the License.
 #include "tensorflow/core/lib/io/compression.h"
 #include "tensorflow/core/lib/io/random_inputstream.h"
 #include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/file_system.h"
+#include "tensorflow/core/platform/mutex.h"
 
 namespace tensorflow {
 namespace io {
@@ -152,5 +157,124 @@ SequentialRecordReader::SequentialRecordReader(
     RandomAccessFile* file, const RecordReaderOptions& options)
     : underlying_(file, options), offset_(0) {}
 
+Status MemmappedRecordReader::Create(
+    Env* env, const string& filename,
+    std::unique_ptr<MemmappedRecordReader>* result) {
+  uint64 file_size;
+  TF_RETURN_IF_ERROR(env->GetFileSize(filename, &file_size));
+  std::unique_ptr<ReadOnlyMemoryRegion> region;
+  // Empty files cannot be mapped.
+  if (file_size > 0) {
+    TF_RETURN_IF_ERROR(env->NewReadOnlyMemoryRegionFromFile(filename, &region));
+  }
+  result->reset(new MemmappedRecordReader(std::move(region)));
+  return Status::OK();
+}
+
+MemmappedRecordReader::MemmappedRecordReader(
+    std::unique_ptr<ReadOnlyMemoryRegion> region)
+    : region_(std::move(region)) {
+  if (region_) {
+    data_ = static_cast<const char*>(region_->data());
+    size_ = region_->length();
+  }
+}
+
+MemmappedRecordReader::~MemmappedRecordReader() = default;
+
+Status MemmappedRecordReader::ParseRecord(uint64 offset, bool verify,
+                                          StringPiece* record,
+                                          uint64* next_offset) const {
+  static const size_t kHeaderSize = sizeof(uint64) + sizeof(uint32);
+  static const size_t kFooterSize = sizeof(uint32);
+
+  if (offset >= size_) {
+    return errors::OutOfRange("eof");
+  }
+  const uint64 available = size_ - offset;
+  if (available < kHeaderSize) {
+    return errors::DataLoss("truncated record at ", offset);
+  }
+  const char* header = data_ + offset;
+  if (verify && crc32c::Unmask(core::DecodeFixed32(header + sizeof(uint64))) !=
+                    crc32c::Value(header, sizeof(uint64))) {
+    return errors::DataLoss("corrupted record at ", offset);
+  }
+  const uint64 length = core::DecodeFixed64(header);
+  if (available - kHeaderSize < kFooterSize ||
+      length > available - kHeaderSize - kFooterSize) {
+    return errors::DataLoss("truncated record at ", offset);
+  }
+  const char* data = header + kHeaderSize;
+  if (verify && crc32c::Unmask(core::DecodeFixed32(data + length)) !=
+                    crc32c::Value(data, length)) {
+    return errors::DataLoss("corrupted record at ", offset);
+  }
+  *record = StringPiece(data, length);
+  *next_offset = offset + kHeaderSize + length + kFooterSize;
+  return Status::OK();
+}
+
+Status MemmappedRecordReader::ReadRecord(uint64* offset, StringPiece* record) {
+  return ParseRecord(*offset, !verified_, record, offset);
+}
+
+Status MemmappedRecordReader::VerifyChecksums(
+    const std::function<void(std::function<void()>)>& runner,
+    int num_shards) {
+  if (verified_) {
+    return Status::OK();
+  }
+  // Splits the file into shards of about the same size at record boundaries.
+  // Only the lengths in the headers of the records are read here; the
+  // checksums are verified by the shards.
+  static const size_t kHeaderSize = sizeof(uint64) + sizeof(uint32);
+  static const size_t kFooterSize = sizeof(uint32);
+  const uint64 shard_size = size_ / std::max(num_shards, 1) + 1;
+  std::vector<uint64> boundaries = {0};
+  uint64 offset = 0;
+  while (size_ - offset >= kHeaderSize + kFooterSize) {
+    const uint64 length = core::DecodeFixed64(data_ + offset);
+    // The shard that contains a truncated record reports it.
+    if (length > size_ - offset - kHeaderSize - kFooterSize) break;
+    offset += kHeaderSize + length + kFooterSize;
+    if (offset >= boundaries.back() + shard_size && offset < size_) {
+      boundaries.push_back(offset);
+    }
+  }
+  boundaries.push_back(size_);
+
+  mutex mu;
+  Status status;
+  uint64 status_offset = size_;
+  BlockingCounter counter(boundaries.size() - 1);
+  for (size_t i = 0; i + 1 < boundaries.size(); ++i) {
+    const uint64 start = boundaries[i];
+    const uint64 limit = boundaries[i + 1];
+    runner([this, start, limit, &mu, &status, &status_offset, &counter]() {
+      StringPiece record;
+      uint64 offset = start;
+      while (offset < limit) {
+        const uint64 record_offset = offset;
+        Status s = ParseRecord(record_offset, true, &record, &offset);
+        if (!s.ok()) {
+          // Reports the error of the first bad record in the file.
+          mutex_lock l(mu);
+          if (record_offset < status_offset) {
+            status = s;
+            status_offset = record_offset;
+          }
+          break;
+        }
+      }
+      counter.DecrementCount();
+    });
+  }
+  counter.Wait();
+  TF_RETURN_IF_ERROR(status);
+  verified_ = true;
+  return Status::OK();
+}
+
 }  // namespace io
 }  // namespace tensorflow
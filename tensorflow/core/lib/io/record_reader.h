@@ -16,6 +16,9 @@ limitations under the License.
 #ifndef TENSORFLOW_LIB_IO_RECORD_READER_H_
 #define TENSORFLOW_LIB_IO_RECORD_READER_H_
 
+#include <functional>
+#include <memory>
+
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/stringpiece.h"
 #include "tensorflow/core/lib/io/inputstream_interface.h"
@@ -28,7 +31,9 @@ limitations under the License.
 
 namespace tensorflow {
 
+class Env;
 class RandomAccessFile;
+class ReadOnlyMemoryRegion;
 
 namespace io {
 
@@ -119,6 +124,57 @@ class SequentialRecordReader {
   uint64 offset_ = 0;
 };
 
+// Low-level interface to read uncompressed TFRecord files that are mapped
+// into memory.
+//
+// Records are returned as StringPieces that point into the mapping, so
+// reading a record does not copy it. The StringPieces stay valid as long as
+// the reader.
+//
+// Note: this class is not thread safe; external synchronization required.
+class MemmappedRecordReader {
+ public:
+  // Maps the file "filename" into memory and creates a reader for it.
+  // Returns UNIMPLEMENTED if the file system of "filename" does not support
+  // memory mapping.
+  static Status Create(Env* env, const string& filename,
+                       std::unique_ptr<MemmappedRecordReader>* result);
+
+  // Create a reader that will return log records from "*region".
+  explicit MemmappedRecordReader(std::unique_ptr<ReadOnlyMemoryRegion> region);
+
+  ~MemmappedRecordReader();
+
+  // Read the record at "*offset" into *record and update *offset to
+  // point to the offset of the next record.  Returns OK on success,
+  // OUT_OF_RANGE for end of file, or something else for an error.
+  Status ReadRecord(uint64* offset, StringPiece* record);
+
+  // Verifies the checksums of all the records in the file, in parallel on
+  // up to "num_shards" closures scheduled with "runner". Once the file is
+  // verified, ReadRecord no longer checks the checksums of the records it
+  // returns. Returns DATA_LOSS if the file is corrupted or truncated.
+  Status VerifyChecksums(
+      const std::function<void(std::function<void()>)>& runner,
+      int num_shards);
+
+  // Returns the size of the file in bytes.
+  uint64 size() const { return size_; }
+
+ private:
+  // Parses the record at "offset" into *record and stores the offset of the
+  // next record in *next_offset, verifying the checksums if "verify" is true.
+  Status ParseRecord(uint64 offset, bool verify, StringPiece* record,
+                     uint64* next_offset) const;
+
+  std::unique_ptr<ReadOnlyMemoryRegion> region_;
+  const char* data_ = nullptr;
+  uint64 size_ = 0;
+  bool verified_ = false;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(MemmappedRecordReader);
+};
+
 }  // namespace io
 }  // namespace tensorflow
 
@@ -23,9 +23,13 @@ limitations under the License.
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 
 namespace tensorflow {
 
@@ -98,6 +102,32 @@ void VerifyFlush(const io::RecordWriterOptions& options) {
   }
 }
 
+// Writes `records` to the file `fname` without compression.
+void WriteRecords(const string& fname, const std::vector<string>& records) {
+  Env* env = Env::Default();
+  std::unique_ptr<WritableFile> file;
+  TF_CHECK_OK(env->NewWritableFile(fname, &file));
+  io::RecordWriter writer(file.get());
+  for (const string& record : records) {
+    TF_CHECK_OK(writer.WriteRecord(record));
+  }
+  TF_CHECK_OK(writer.Flush());
+  TF_CHECK_OK(file->Close());
+}
+
+// Overwrites the byte at `offset` of the file `fname`.
+void CorruptFile(const string& fname, uint64 offset) {
+  Env* env = Env::Default();
+  string contents;
+  TF_CHECK_OK(ReadFileToString(env, fname, &contents));
+  contents[offset] ^= 0x1;
+  TF_CHECK_OK(WriteStringToFile(env, fname, contents));
+}
+
+std::function<void(std::function<void()>)> Runner(thread::ThreadPool* pool) {
+  return [pool](std::function<void()> fn) { pool->Schedule(std::move(fn)); };
+}
+
 }  // namespace
 
 TEST(RecordReaderWriterTest, TestFlush) {
@@ -189,4 +219,146 @@ TEST(RecordReaderWriterTest, TestZlib) {
   }
 }
 
+TEST(RecordReaderWriterTest, TestMemmapped) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/record_reader_writer_memmapped_test";
+  std::vector<string> records;
+  for (int i = 0; i < 100; ++i) {
+    records.push_back(string(i, 'a' + i % 26));
+  }
+  WriteRecords(fname, records);
+
+  for (bool verify_in_parallel : {false, true}) {
+    std::unique_ptr<io::MemmappedRecordReader> reader;
+    TF_ASSERT_OK(io::MemmappedRecordReader::Create(env, fname, &reader));
+    EXPECT_EQ(GetFileSize(fname), reader->size());
+    if (verify_in_parallel) {
+      thread::ThreadPool pool(env, "test", 4);
+      TF_ASSERT_OK(reader->VerifyChecksums(Runner(&pool), 8));
+    }
+    uint64 offset = 0;
+    StringPiece record;
+    for (const string& expected : records) {
+      TF_ASSERT_OK(reader->ReadRecord(&offset, &record));
+      EXPECT_EQ(expected, record);
+    }
+    EXPECT_TRUE(errors::IsOutOfRange(reader->ReadRecord(&offset, &record)));
+
+    // Records can be read again from any record boundary.
+    offset = 0;
+    TF_ASSERT_OK(reader->ReadRecord(&offset, &record));
+    TF_ASSERT_OK(reader->ReadRecord(&offset, &record));
+    EXPECT_EQ(records[1], record);
+  }
+}
+
+TEST(RecordReaderWriterTest, TestMemmappedEmptyFile) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/record_reader_writer_memmapped_empty";
+  WriteRecords(fname, {});
+
+  std::unique_ptr<io::MemmappedRecordReader> reader;
+  TF_ASSERT_OK(io::MemmappedRecordReader::Create(env, fname, &reader));
+  thread::ThreadPool pool(env, "test", 4);
+  TF_EXPECT_OK(reader->VerifyChecksums(Runner(&pool), 8));
+  uint64 offset = 0;
+  StringPiece record;
+  EXPECT_TRUE(errors::IsOutOfRange(reader->ReadRecord(&offset, &record)));
+}
+
+TEST(RecordReaderWriterTest, TestMemmappedCorrupted) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/record_reader_writer_memmapped_corrupt";
+  // Each record takes 12 bytes of header, 10 bytes of data and 4 bytes of
+  // footer. Corrupts the data of the 8th record.
+  WriteRecords(fname, std::vector<string>(20, "0123456789"));
+  CorruptFile(fname, 7 * 26 + 12 + 3);
+
+  std::unique_ptr<io::MemmappedRecordReader> reader;
+  TF_ASSERT_OK(io::MemmappedRecordReader::Create(env, fname, &reader));
+  thread::ThreadPool pool(env, "test", 4);
+  Status s = reader->VerifyChecksums(Runner(&pool), 8);
+  EXPECT_TRUE(errors::IsDataLoss(s));
+  EXPECT_TRUE(str_util::StrContains(s.error_message(), "at 182")) << s;
+
+  uint64 offset = 0;
+  StringPiece record;
+  for (int i = 0; i < 7; ++i) {
+    TF_ASSERT_OK(reader->ReadRecord(&offset, &record));
+  }
+  EXPECT_TRUE(errors::IsDataLoss(reader->ReadRecord(&offset, &record)));
+}
+
+TEST(RecordReaderWriterTest, TestMemmappedTruncated) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/record_reader_writer_memmapped_trunc";
+  WriteRecords(fname, {"abc", "defg"});
+  string contents;
+  TF_ASSERT_OK(ReadFileToString(env, fname, &contents));
+  TF_ASSERT_OK(
+      WriteStringToFile(env, fname, contents.substr(0, contents.size() - 1)));
+
+  std::unique_ptr<io::MemmappedRecordReader> reader;
+  TF_ASSERT_OK(io::MemmappedRecordReader::Create(env, fname, &reader));
+  thread::ThreadPool pool(env, "test", 4);
+  EXPECT_TRUE(errors::IsDataLoss(reader->VerifyChecksums(Runner(&pool), 8)));
+  uint64 offset = 0;
+  StringPiece record;
+  TF_ASSERT_OK(reader->ReadRecord(&offset, &record));
+  EXPECT_EQ("abc", record);
+  EXPECT_TRUE(errors::IsDataLoss(reader->ReadRecord(&offset, &record)));
+}
+
+// Reads a file of about 64MB of records of `record_size` bytes into strings,
+// like TFRecordDataset does, with the reader selected by `mode`:
+//   0: SequentialRecordReader with a 256KB buffer.
+//   1: MemmappedRecordReader, verifying checksums while reading.
+//   2: MemmappedRecordReader, verifying checksums in parallel first.
+static void BM_ReadRecords(int iters, int mode, int record_size) {
+  testing::StopTiming();
+  Env* env = Env::Default();
+  string fname = strings::StrCat(testing::TmpDir(), "/record_reader_bm_",
+                                 record_size);
+  const int num_records = (64 << 20) / record_size;
+  WriteRecords(fname, std::vector<string>(num_records, string(record_size,
+                                                              'x')));
+  thread::ThreadPool pool(env, "bm", port::NumSchedulableCPUs());
+  testing::BytesProcessed(static_cast<int64>(iters) * num_records *
+                          record_size);
+  string record;
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    if (mode == 0) {
+      std::unique_ptr<RandomAccessFile> file;
+      TF_CHECK_OK(env->NewRandomAccessFile(fname, &file));
+      io::RecordReaderOptions options;
+      options.buffer_size = 256 << 10;
+      io::SequentialRecordReader reader(file.get(), options);
+      while (reader.ReadRecord(&record).ok()) {
+      }
+    } else {
+      std::unique_ptr<io::MemmappedRecordReader> reader;
+      TF_CHECK_OK(io::MemmappedRecordReader::Create(env, fname, &reader));
+      if (mode == 2) {
+        TF_CHECK_OK(
+            reader->VerifyChecksums(Runner(&pool), port::NumSchedulableCPUs()));
+      }
+      uint64 offset = 0;
+      StringPiece piece;
+      while (reader->ReadRecord(&offset, &piece).ok()) {
+        record.assign(piece.data(), piece.size());
+      }
+    }
+  }
+  testing::StopTiming();
+  TF_CHECK_OK(env->DeleteFile(fname));
+}
+BENCHMARK(BM_ReadRecords)
+    ->ArgPair(0, 200)
+    ->ArgPair(1, 200)
+    ->ArgPair(2, 200)
+    ->ArgPair(0, 100 << 10)
+    ->ArgPair(1, 100 << 10)
+    ->ArgPair(2, 100 << 10);
+
 }  // namespace tensorflow
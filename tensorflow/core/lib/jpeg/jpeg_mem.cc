@@ -85,7 +85,7 @@ uint8* UncompressLow(const void* srcdata, FewerArgsForCompiler* argball) {
   // unpack the argball
   const int datasize = argball->datasize_;
   const auto& flags = argball->flags_;
-  const int ratio = flags.ratio;
+  int ratio = flags.ratio;
   int components = flags.components;
   int stride = flags.stride;              // may be 0
   int64* const nwarn = argball->pnwarn_;  // may be NULL
@@ -147,6 +147,10 @@ uint8* UncompressLow(const void* srcdata, FewerArgsForCompiler* argball) {
       jpeg_destroy_decompress(&cinfo);
       return nullptr;
   }
+  if (flags.min_scaled_width > 0 && flags.min_scaled_height > 0) {
+    ratio = ScaledDecodeRatio(cinfo.image_width, cinfo.image_height,
+                              flags.min_scaled_width, flags.min_scaled_height);
+  }
   cinfo.do_fancy_upsampling = boolean(flags.fancy_upscaling);
   cinfo.scale_num = 1;
   cinfo.scale_denom = ratio;
@@ -531,6 +535,17 @@ uint8* Uncompress(const void* srcdata, int datasize,
   return result;
 }
 
+int ScaledDecodeRatio(int width, int height, int min_width, int min_height) {
+  // libjpeg rounds scaled dimensions up.
+  for (int ratio : {8, 4, 2}) {
+    if ((width + ratio - 1) / ratio >= min_width &&
+        (height + ratio - 1) / ratio >= min_height) {
+      return ratio;
+    }
+  }
+  return 1;
+}
+
 // ----------------------------------------------------------------------------
 // Computes image information from jpeg header.
 // Returns true on success; false on failure.
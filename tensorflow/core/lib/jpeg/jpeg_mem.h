@@ -72,8 +72,20 @@ struct UncompressFlags {
   int crop_width = 0;
   // Height of the output image.
   int crop_height = 0;
+
+  // If both are positive, `ratio` is ignored and chosen per image instead:
+  // the largest of 1, 2, 4 and 8 for which the scaled image is still at least
+  // min_scaled_width x min_scaled_height (or 1 if the image is smaller).
+  // This lets callers that resize afterwards skip most of the IDCT work.
+  // A crop window is in the coordinates of the scaled image.
+  int min_scaled_width = 0;
+  int min_scaled_height = 0;
 };
 
+// Returns the largest libjpeg scaling denominator (1, 2, 4 or 8) for which a
+// width x height image decodes to at least min_width x min_height pixels.
+int ScaledDecodeRatio(int width, int height, int min_width, int min_height);
+
 // Uncompress some raw JPEG data given by the pointer srcdata and the length
 // datasize.
 // - width and height are the address where to store the size of the
@@ -95,6 +95,53 @@ TEST(JpegMemTest, Jpeg) {
   TestJPEG(env, data_path + "jpeg_merge_test1_cmyk.jpg");
 }
 
+TEST(JpegMemTest, ScaledDecodeRatio) {
+  EXPECT_EQ(8, ScaledDecodeRatio(128, 256, 16, 32));
+  EXPECT_EQ(4, ScaledDecodeRatio(128, 256, 17, 32));
+  EXPECT_EQ(4, ScaledDecodeRatio(128, 256, 30, 60));
+  EXPECT_EQ(2, ScaledDecodeRatio(128, 256, 33, 60));
+  EXPECT_EQ(1, ScaledDecodeRatio(128, 256, 100, 10));
+  EXPECT_EQ(1, ScaledDecodeRatio(128, 256, 200, 300));
+  // Scaled sizes are rounded up.
+  EXPECT_EQ(8, ScaledDecodeRatio(129, 257, 17, 33));
+}
+
+TEST(JpegMemTest, DecodeWithMinScaledSize) {
+  const string data_path = kTestData;
+  string jpeg;
+  ReadFileToStringOrDie(Env::Default(), data_path + "jpeg_merge_test1.jpg",
+                        &jpeg);
+  const uint8* const temp = bit_cast<const uint8*>(jpeg.data());
+  int w, h, c;
+  std::unique_ptr<uint8[]> imgdata;
+
+  // The image is 128x256; 30x60 is reached at a quarter of the size.
+  UncompressFlags flags;
+  flags.ratio = 2;
+  flags.min_scaled_width = 30;
+  flags.min_scaled_height = 60;
+  imgdata.reset(Uncompress(temp, jpeg.size(), flags, &w, &h, &c, nullptr));
+  ASSERT_NE(imgdata, nullptr);
+  EXPECT_EQ(32, w);
+  EXPECT_EQ(64, h);
+
+  // The result matches decoding with that ratio directly.
+  UncompressFlags ratio_flags;
+  ratio_flags.ratio = 4;
+  int w4, h4, c4;
+  std::unique_ptr<uint8[]> imgdata4(
+      Uncompress(temp, jpeg.size(), ratio_flags, &w4, &h4, &c4, nullptr));
+  ASSERT_NE(imgdata4, nullptr);
+  EXPECT_EQ(0, memcmp(imgdata.get(), imgdata4.get(), w * h * c));
+
+  // Images smaller than the minimum are decoded at full size.
+  flags.min_scaled_width = 300;
+  imgdata.reset(Uncompress(temp, jpeg.size(), flags, &w, &h, &c, nullptr));
+  ASSERT_NE(imgdata, nullptr);
+  EXPECT_EQ(128, w);
+  EXPECT_EQ(256, h);
+}
+
 void TestCropAndDecodeJpeg(Env* env, const string& jpegfile,
                            const UncompressFlags& default_flags) {
   // Read the data from the jpeg file into memory
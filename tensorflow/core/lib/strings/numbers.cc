@@ -123,6 +123,54 @@ StringToFloatConverter() {
   return converter;
 }
 
+// Parses `str` if it is a plain decimal of the form [-]d+[.d+] whose digits,
+// read as an integer m, satisfy m <= `max_mantissa` with at most
+// `max_fraction_digits` digits after the point. In that range both m and
+// 10^k are exactly representable in T, so the single division m / 10^k is
+// correctly rounded and gives the same result as the general converter.
+// Returns false for anything else (spaces, exponents, hex, inf/nan, ...).
+template <typename T>
+bool ParseSimpleDecimal(StringPiece str, uint64 max_mantissa,
+                        int max_fraction_digits, T* value) {
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+  static const double kPowersOfTen[] = {
+      1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+  const char* p = str.data();
+  const char* end = p + str.size();
+  const bool negative = p < end && *p == '-';
+  if (negative) ++p;
+  uint64 mantissa = 0;
+  int num_digits = 0;
+  int fraction_digits = 0;
+  for (; p < end && isdigit(*p); ++p, ++num_digits) {
+    mantissa = mantissa * 10 + (*p - '0');
+  }
+  if (num_digits == 0) return false;
+  if (p < end && *p == '.') {
+    ++p;
+    for (; p < end && isdigit(*p); ++p, ++fraction_digits) {
+      mantissa = mantissa * 10 + (*p - '0');
+    }
+    if (fraction_digits == 0) return false;
+  }
+  // 19 digits always fit in a uint64.
+  if (p != end || num_digits + fraction_digits > 19 ||
+      mantissa > max_mantissa || fraction_digits > max_fraction_digits) {
+    return false;
+  }
+  T result = static_cast<T>(mantissa);
+  if (fraction_digits > 0) {
+    result /= static_cast<T>(kPowersOfTen[fraction_digits]);
+  }
+  *value = negative ? -result : result;
+  return true;
+#else
+  // Excess intermediate precision would round twice.
+  return false;
+#endif
+}
+
 }  // namespace
 
 namespace strings {
@@ -232,11 +280,15 @@ bool safe_strto64(StringPiece str, int64* value) {
 
   if (!isdigit(SafeFirstChar(str))) return false;
 
+  // Comparing against precomputed bounds avoids a division per digit.
+  const int64 vlimit_div10 = vlimit / 10;
+  const int vlimit_last_digit = sign * static_cast<int>(vlimit % 10);
   int64 result = 0;
   if (sign == 1) {
     do {
       int digit = SafeFirstChar(str) - '0';
-      if ((vlimit - digit) / 10 < result) {
+      if (result > vlimit_div10 ||
+          (result == vlimit_div10 && digit > vlimit_last_digit)) {
         return false;
       }
       result = result * 10 + digit;
@@ -245,7 +297,8 @@ bool safe_strto64(StringPiece str, int64* value) {
   } else {
     do {
       int digit = SafeFirstChar(str) - '0';
-      if ((vlimit + digit) / 10 > result) {
+      if (result < vlimit_div10 ||
+          (result == vlimit_div10 && digit > vlimit_last_digit)) {
         return false;
       }
       result = result * 10 - digit;
@@ -332,6 +385,9 @@ bool safe_strtou32(StringPiece str, uint32* value) {
 }
 
 bool safe_strtof(StringPiece str, float* value) {
+  // Integers up to 2^24 and powers of ten up to 10^10 are exact in a float.
+  if (ParseSimpleDecimal<float>(str, 1ULL << 24, 10, value)) return true;
+
   int processed_characters_count = -1;
   auto len = str.size();
 
@@ -345,6 +401,9 @@ bool safe_strtof(StringPiece str, float* value) {
 }
 
 bool safe_strtod(StringPiece str, double* value) {
+  // Integers up to 2^53 and powers of ten up to 10^22 are exact in a double.
+  if (ParseSimpleDecimal<double>(str, 1ULL << 53, 22, value)) return true;
+
   int processed_characters_count = -1;
   auto len = str.size();
 
@@ -211,6 +211,9 @@ TEST(safe_strto64, Int64s) {
   // Overflow
   EXPECT_EQ(false, safe_strto64("9223372036854775808", &result));
   EXPECT_EQ(false, safe_strto64("-9223372036854775809", &result));
+  EXPECT_EQ(false, safe_strto64("92233720368547758070", &result));
+  EXPECT_EQ(true, safe_strto64("922337203685477580", &result));
+  EXPECT_EQ(922337203685477580, result);
 
   // Check that the StringPiece's length is respected.
   EXPECT_EQ(true, safe_strto64(StringPiece("123", 1), &result));
@@ -379,5 +382,40 @@ TEST(safe_strtod, Double) {
   EXPECT_TRUE(std::isnan(result));
 }
 
+// Plain decimals take an exact shortcut; check that it agrees with the general
+// converter at the edges of its range.
+TEST(safe_strtod, SimpleDecimals) {
+  float f = 0;
+  EXPECT_TRUE(safe_strtof("0.1", &f));
+  EXPECT_EQ(0.1f, f);
+  EXPECT_TRUE(safe_strtof("-2.5", &f));
+  EXPECT_EQ(-2.5f, f);
+  EXPECT_TRUE(safe_strtof("16777216", &f));
+  EXPECT_EQ(16777216.0f, f);
+  EXPECT_TRUE(safe_strtof("16777217", &f));
+  EXPECT_EQ(16777216.0f, f);
+  EXPECT_TRUE(safe_strtof("0.0000000001", &f));
+  EXPECT_EQ(1e-10f, f);
+  EXPECT_TRUE(safe_strtof("0.00000000001", &f));
+  EXPECT_EQ(1e-11f, f);
+  EXPECT_TRUE(safe_strtof("-0", &f));
+  EXPECT_EQ(0.0f, f);
+  EXPECT_TRUE(std::signbit(f));
+  EXPECT_FALSE(safe_strtof("1.2.3", &f));
+  EXPECT_FALSE(safe_strtof("-", &f));
+
+  double d = 0;
+  EXPECT_TRUE(safe_strtod("3.14159", &d));
+  EXPECT_EQ(3.14159, d);
+  EXPECT_TRUE(safe_strtod("9007199254740993", &d));
+  EXPECT_EQ(9007199254740992.0, d);
+  EXPECT_TRUE(safe_strtod("1234567890.123456789", &d));
+  EXPECT_EQ(1234567890.123456789, d);
+  EXPECT_TRUE(safe_strtod("0.0000000000000000000001", &d));
+  EXPECT_EQ(1e-22, d);
+  EXPECT_TRUE(safe_strtod("0.00000000000000000000001", &d));
+  EXPECT_EQ(1e-23, d);
+}
+
 }  // namespace strings
 }  // namespace tensorflow
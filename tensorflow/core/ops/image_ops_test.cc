@@ -142,6 +142,38 @@ TEST(ImageOpsTest, DecodeAndCropJpeg_InvalidCropWindow) {
   INFER_OK(op, "[];[?]", "[?,?,?]");
 }
 
+TEST(ImageOpsTest, DecodeAndResizeJpegBatch_ShapeFn) {
+  const char* op_name = "DecodeAndResizeJpegBatch";
+  ShapeInferenceTestOp op(op_name);
+  op.input_tensors.resize(2);
+
+  // Rank and size checks.
+  INFER_ERROR("Shape must be rank 1 but is rank 0", op, "[];[2]");
+  INFER_ERROR("Shape must be rank 1 but is rank 0", op, "[?];[]");
+  INFER_ERROR("Dimension must be 2 but is 3", op, "[?];[3]");
+
+  // The default is 3 channels; the size is not known until it is constant.
+  INFER_OK(op, "[8];[2]", "[d0_0,?,?,3]");
+  Tensor size_tensor = test::AsTensor<int32>({224, 192});
+  op.input_tensors[1] = &size_tensor;
+  INFER_OK(op, "[8];[2]", "[d0_0,224,192,3]");
+
+  TF_ASSERT_OK(NodeDefBuilder("test", op_name)
+                   .Input({"contents", 0, DT_STRING})
+                   .Input({"size", 1, DT_INT32})
+                   .Attr("channels", 1)
+                   .Finalize(&op.node_def));
+  INFER_OK(op, "[?];[2]", "[d0_0,224,192,1]");
+
+  // Every image in the batch must have the same number of channels.
+  TF_ASSERT_OK(NodeDefBuilder("test", op_name)
+                   .Input({"contents", 0, DT_STRING})
+                   .Input({"size", 1, DT_INT32})
+                   .Attr("channels", 0)
+                   .Finalize(&op.node_def));
+  INFER_ERROR("channels must be 1 or 3, got 0", op, "[?];[2]");
+}
+
 TEST(ImageOpsTest, EncodeImage_ShapeFn) {
   for (const char* op_name : {"EncodeJpeg", "EncodePng"}) {
     ShapeInferenceTestOp op(op_name);
@@ -254,6 +254,39 @@ REGISTER_OP("_UnaryOpsComposition")
 expected to create these operators.
 )doc");
 
+REGISTER_OP("_FusedElementwise")
+    .Input("inputs: N * T")
+    .Output("y: T")
+    .Attr("T: {float, double}")
+    .Attr("N: int >= 1")
+    .Attr("op_names: list(string)")
+    .Attr("operands: list(int)")
+    .SetShapeFn([](InferenceContext* c) {
+      // Inputs with a single element are broadcasted, all other inputs must
+      // have the same shape, which is also the shape of the output.
+      ShapeHandle output = c->UnknownShape();
+      ShapeHandle scalar_like;
+      bool has_full_input = false;
+      for (int i = 0; i < c->num_inputs(); ++i) {
+        ShapeHandle input = c->input(i);
+        if (c->FullyDefined(input) && c->Value(c->NumElements(input)) == 1) {
+          if (!c->RankKnown(scalar_like) ||
+              c->Rank(input) > c->Rank(scalar_like)) {
+            scalar_like = input;
+          }
+          continue;
+        }
+        TF_RETURN_IF_ERROR(c->Merge(output, input, &output));
+        has_full_input = true;
+      }
+      c->set_output(0, has_full_input ? output : scalar_like);
+      return Status::OK();
+    })
+    .Doc(R"doc(
+*NOTE*: Do not invoke this operator directly in Python. Graph rewrite pass is
+expected to create these operators.
+)doc");
+
 #undef UNARY
 #undef UNARY_REAL
 #undef UNARY_COMPLEX
@@ -744,6 +777,22 @@ REGISTER_OP("MatMul")
     .Attr("T: {bfloat16, half, float, double, int32, complex64, complex128}")
     .SetShapeFn(shape_inference::MatMulShape);
 
+REGISTER_OP("_FusedMatMul")
+    .Input("a: T")
+    .Input("b: T")
+    .Input("args: num_args * T")
+    .Output("product: T")
+    .Attr("transpose_a: bool = false")
+    .Attr("transpose_b: bool = false")
+    .Attr("T: {float, double}")
+    .Attr("num_args: int >= 0")
+    .Attr("fused_ops: list(string) = []")
+    .SetShapeFn(shape_inference::MatMulShape)
+    .Doc(R"doc(
+*NOTE*: Do not invoke this operator directly in Python. Grappler is
+expected to create these operators.
+)doc");
+
 REGISTER_OP("SparseMatMul")
     .Input("a: Ta")
     .Input("b: Tb")
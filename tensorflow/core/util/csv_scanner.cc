@@ -0,0 +1,168 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/util/csv_scanner.h"
+
+#include <string.h>
+
+#include "tensorflow/core/platform/cpu_info.h"
+
+#if defined(__x86_64__) && \
+    (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+#define TF_CSV_SCANNER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace tensorflow {
+
+#ifdef TF_CSV_SCANNER_X86
+namespace {
+
+// The bodies below are compiled for the named instruction set regardless of
+// the flags the rest of the file is built with; CsvScanner only calls them
+// after checking the CPU at runtime.
+
+__attribute__((target("avx2"))) size_t FindFieldEndAvx2(
+    const char* data, size_t pos, size_t size, char delim, bool quotes) {
+  const __m256i d = _mm256_set1_epi8(delim);
+  const __m256i lf = _mm256_set1_epi8('\n');
+  const __m256i cr = _mm256_set1_epi8('\r');
+  // With quotes disabled, comparing against the delimiter twice keeps the
+  // loop branch-free.
+  const __m256i q = _mm256_set1_epi8(quotes ? '"' : delim);
+  for (; pos + 32 <= size; pos += 32) {
+    const __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+    const __m256i hits = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(chunk, d),
+                        _mm256_cmpeq_epi8(chunk, lf)),
+        _mm256_or_si256(_mm256_cmpeq_epi8(chunk, cr),
+                        _mm256_cmpeq_epi8(chunk, q)));
+    const uint32 mask = static_cast<uint32>(_mm256_movemask_epi8(hits));
+    if (mask != 0) return pos + __builtin_ctz(mask);
+  }
+  return pos;
+}
+
+__attribute__((target("avx2"))) size_t FindQuoteAvx2(const char* data,
+                                                     size_t pos, size_t size) {
+  const __m256i q = _mm256_set1_epi8('"');
+  for (; pos + 32 <= size; pos += 32) {
+    const __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+    const uint32 mask =
+        static_cast<uint32>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, q)));
+    if (mask != 0) return pos + __builtin_ctz(mask);
+  }
+  return pos;
+}
+
+__attribute__((target("sse4.2"))) size_t FindFieldEndSse42(
+    const char* data, size_t pos, size_t size, char delim, bool quotes) {
+  const __m128i needle = _mm_setr_epi8(delim, '\n', '\r', '"', 0, 0, 0, 0, 0,
+                                       0, 0, 0, 0, 0, 0, 0);
+  const int needle_size = quotes ? 4 : 3;
+  for (; pos + 16 <= size; pos += 16) {
+    const __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+    const int index = _mm_cmpestri(
+        needle, needle_size, chunk, 16,
+        _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_LEAST_SIGNIFICANT);
+    if (index < 16) return pos + index;
+  }
+  return pos;
+}
+
+__attribute__((target("sse4.2"))) size_t FindQuoteSse42(const char* data,
+                                                        size_t pos,
+                                                        size_t size) {
+  const __m128i q = _mm_set1_epi8('"');
+  for (; pos + 16 <= size; pos += 16) {
+    const __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+    const uint32 mask =
+        static_cast<uint32>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, q)));
+    if (mask != 0) return pos + __builtin_ctz(mask);
+  }
+  return pos;
+}
+
+}  // namespace
+#endif  // TF_CSV_SCANNER_X86
+
+CsvScanner::CsvScanner(char delim, bool use_quote_delim)
+    : delim_(delim), use_quote_delim_(use_quote_delim), isa_(Isa::kScalar) {
+  memset(is_field_end_, 0, sizeof(is_field_end_));
+  is_field_end_[static_cast<uint8>(delim)] = true;
+  is_field_end_[static_cast<uint8>('\n')] = true;
+  is_field_end_[static_cast<uint8>('\r')] = true;
+  if (use_quote_delim) is_field_end_[static_cast<uint8>('"')] = true;
+#ifdef TF_CSV_SCANNER_X86
+  if (port::TestCPUFeature(port::CPUFeature::AVX2)) {
+    isa_ = Isa::kAvx2;
+  } else if (port::TestCPUFeature(port::CPUFeature::SSE4_2)) {
+    isa_ = Isa::kSse42;
+  }
+#endif
+}
+
+size_t CsvScanner::FindFieldEnd(StringPiece data, size_t pos) const {
+#ifdef TF_CSV_SCANNER_X86
+  switch (isa_) {
+    case Isa::kAvx2:
+      pos = FindFieldEndAvx2(data.data(), pos, data.size(), delim_,
+                             use_quote_delim_);
+      break;
+    case Isa::kSse42:
+      pos = FindFieldEndSse42(data.data(), pos, data.size(), delim_,
+                              use_quote_delim_);
+      break;
+    case Isa::kScalar:
+      break;
+  }
+#endif
+  // The vector loops stop at the first match or before the last partial
+  // block; either way the scalar loop finishes the job.
+  return FindFieldEndScalar(data, pos);
+}
+
+size_t CsvScanner::FindQuote(StringPiece data, size_t pos) const {
+#ifdef TF_CSV_SCANNER_X86
+  switch (isa_) {
+    case Isa::kAvx2:
+      pos = FindQuoteAvx2(data.data(), pos, data.size());
+      break;
+    case Isa::kSse42:
+      pos = FindQuoteSse42(data.data(), pos, data.size());
+      break;
+    case Isa::kScalar:
+      break;
+  }
+#endif
+  if (pos >= data.size()) return data.size();
+  const void* quote = memchr(data.data() + pos, '"', data.size() - pos);
+  return quote == nullptr
+             ? data.size()
+             : static_cast<const char*>(quote) - data.data();
+}
+
+size_t CsvScanner::FindFieldEndScalar(StringPiece data, size_t pos) const {
+  for (; pos < data.size(); ++pos) {
+    if (is_field_end_[static_cast<uint8>(data[pos])]) return pos;
+  }
+  return data.size();
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,65 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_UTIL_CSV_SCANNER_H_
+#define TENSORFLOW_CORE_UTIL_CSV_SCANNER_H_
+
+#include <stddef.h>
+
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// Finds the bytes that delimit CSV fields. The scanner compares 32 (AVX2) or
+// 16 (SSE4.2) bytes at a time when the CPU supports it, and falls back to a
+// byte-at-a-time table lookup otherwise. The instruction set is chosen once,
+// at construction, so a binary built without -mavx2 still uses the wide path
+// on machines that have it.
+//
+// CsvScanner is immutable after construction and may be shared across threads.
+class CsvScanner {
+ public:
+  // `delim` separates fields. If `use_quote_delim` is true, '"' starts and
+  // ends quoted fields and is reported by FindFieldEnd().
+  CsvScanner(char delim, bool use_quote_delim);
+
+  // Returns the position of the first byte at or after `pos` that ends an
+  // unquoted field: the field delimiter, '\n', '\r' or, if quotes are used,
+  // '"'. Returns `data.size()` if there is no such byte.
+  size_t FindFieldEnd(StringPiece data, size_t pos) const;
+
+  // Returns the position of the first '"' at or after `pos`, or `data.size()`
+  // if there is none.
+  size_t FindQuote(StringPiece data, size_t pos) const;
+
+  char delim() const { return delim_; }
+  bool use_quote_delim() const { return use_quote_delim_; }
+
+ private:
+  enum class Isa { kScalar, kSse42, kAvx2 };
+
+  size_t FindFieldEndScalar(StringPiece data, size_t pos) const;
+
+  const char delim_;
+  const bool use_quote_delim_;
+  Isa isa_;
+  // `is_field_end_[c]` is true for every byte that FindFieldEnd() stops at.
+  bool is_field_end_[256];
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_UTIL_CSV_SCANNER_H_
@@ -0,0 +1,108 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/util/csv_scanner.h"
+
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+size_t NaiveFind(StringPiece data, size_t pos, StringPiece needles) {
+  for (; pos < data.size(); ++pos) {
+    if (needles.find(data[pos]) != StringPiece::npos) return pos;
+  }
+  return data.size();
+}
+
+TEST(CsvScannerTest, FindFieldEnd) {
+  CsvScanner scanner(',', true);
+  StringPiece line = "a,bb,\"c\"\r\n";
+  EXPECT_EQ(1, scanner.FindFieldEnd(line, 0));
+  EXPECT_EQ(4, scanner.FindFieldEnd(line, 2));
+  EXPECT_EQ(5, scanner.FindFieldEnd(line, 5));
+  EXPECT_EQ(7, scanner.FindFieldEnd(line, 6));
+  EXPECT_EQ(8, scanner.FindFieldEnd(line, 8));
+  EXPECT_EQ(9, scanner.FindFieldEnd(line, 9));
+  EXPECT_EQ(line.size(), scanner.FindFieldEnd(line, line.size()));
+  EXPECT_EQ(0, scanner.FindFieldEnd("", 0));
+}
+
+TEST(CsvScannerTest, QuotesDisabled) {
+  CsvScanner scanner('\t', false);
+  EXPECT_EQ(4, scanner.FindFieldEnd("a\"b\"\tc", 0));
+  EXPECT_EQ(1, scanner.FindQuote("a\"b\"\tc", 0));
+}
+
+TEST(CsvScannerTest, FindQuote) {
+  CsvScanner scanner(',', true);
+  EXPECT_EQ(3, scanner.FindQuote("a,b\"", 0));
+  EXPECT_EQ(4, scanner.FindQuote("a,b\"", 4));
+  EXPECT_EQ(0, scanner.FindQuote("", 0));
+}
+
+// Checks every start position of random lines that are long enough to cover
+// the vector loops and their scalar tails.
+TEST(CsvScannerTest, MatchesNaiveScan) {
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  const char kAlphabet[] = "abc012,;\"\n\r";
+  for (char delim : {',', ';'}) {
+    for (bool quotes : {false, true}) {
+      CsvScanner scanner(delim, quotes);
+      const string needles =
+          strings::StrCat(string(1, delim), "\n\r", quotes ? "\"" : "");
+      for (int size : {0, 1, 15, 16, 17, 31, 32, 33, 100, 257}) {
+        string data;
+        for (int i = 0; i < size; ++i) {
+          // Make the special bytes rare so that matches land in every lane.
+          data += rnd.OneIn(8) ? kAlphabet[6 + rnd.Uniform(5)]
+                               : kAlphabet[rnd.Uniform(6)];
+        }
+        for (size_t pos = 0; pos <= data.size(); ++pos) {
+          EXPECT_EQ(NaiveFind(data, pos, needles),
+                    scanner.FindFieldEnd(data, pos))
+              << data << " at " << pos;
+          EXPECT_EQ(NaiveFind(data, pos, "\""), scanner.FindQuote(data, pos))
+              << data << " at " << pos;
+        }
+      }
+    }
+  }
+}
+
+static void BM_FindFieldEnd(int iters, int field_size) {
+  testing::StopTiming();
+  CsvScanner scanner(',', true);
+  string line;
+  for (int i = 0; i < 200; ++i) {
+    strings::StrAppend(&line, string(field_size, '7'), ",");
+  }
+  testing::BytesProcessed(static_cast<int64>(iters) * line.size());
+  testing::StartTiming();
+  while (--iters >= 0) {
+    size_t pos = 0;
+    while (pos < line.size()) {
+      pos = scanner.FindFieldEnd(line, pos) + 1;
+    }
+  }
+}
+BENCHMARK(BM_FindFieldEnd)->Arg(1)->Arg(8)->Arg(64);
+
+}  // namespace
+}  // namespace tensorflow
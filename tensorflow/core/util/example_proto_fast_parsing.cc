@@ -14,6 +14,7 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/util/example_proto_fast_parsing.h"
 
+#include <unordered_map>
 #include <vector>
 
 #include "tensorflow/core/example/example.pb.h"
@@ -26,6 +27,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
+#include "tensorflow/core/lib/hash/hash.h"
 #include "tensorflow/core/lib/monitoring/counter.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/protobuf.h"
@@ -280,24 +282,36 @@ bool ParseString(protobuf::io::CodedInputStream* stream, StringPiece* result) {
   return true;
 }
 
-bool ParseFeatureMapEntry(protobuf::io::CodedInputStream* stream,
-                          parsed::FeatureMapEntry* feature_map_entry) {
+bool ParseMapEntry(protobuf::io::CodedInputStream* stream, StringPiece* key,
+                   StringPiece* value) {
   DCHECK(stream != nullptr);
-  DCHECK(feature_map_entry != nullptr);
+  DCHECK(key != nullptr);
+  DCHECK(value != nullptr);
   uint32 length;
   if (!stream->ReadVarint32(&length)) return false;
   auto limit = stream->PushLimit(length);
   if (!stream->ExpectTag(kDelimitedTag(1))) return false;
-  if (!ParseString(stream, &feature_map_entry->first)) return false;
+  if (!ParseString(stream, key)) return false;
   if (!stream->ExpectTag(kDelimitedTag(2))) return false;
-  StringPiece feature_string_piece;
-  if (!ParseString(stream, &feature_string_piece)) return false;
-  feature_map_entry->second = parsed::Feature(feature_string_piece);
+  if (!ParseString(stream, value)) return false;
   if (!stream->ExpectAtEnd()) return false;
   stream->PopLimit(limit);
   return true;
 }
 
+bool ParseFeatureMapEntry(protobuf::io::CodedInputStream* stream,
+                          parsed::FeatureMapEntry* feature_map_entry) {
+  DCHECK(stream != nullptr);
+  DCHECK(feature_map_entry != nullptr);
+  StringPiece feature_string_piece;
+  if (!ParseMapEntry(stream, &feature_map_entry->first,
+                     &feature_string_piece)) {
+    return false;
+  }
+  feature_map_entry->second = parsed::Feature(feature_string_piece);
+  return true;
+}
+
 bool ParseFeatures(protobuf::io::CodedInputStream* stream,
                    parsed::Example* example) {
   DCHECK(stream != nullptr);
@@ -340,6 +354,26 @@ bool ParseExample(StringPiece serialized, parsed::Example* example) {
   return ParseExample(&stream, example);
 }
 
+// Parses a serialized FeatureList into the Features of its steps.
+bool ParseFeatureList(StringPiece serialized,
+                      std::vector<parsed::Feature>* feature_list) {
+  DCHECK(feature_list != nullptr);
+  feature_list->clear();
+  protobuf::io::CodedInputStream stream(
+      reinterpret_cast<const uint8*>(serialized.data()), serialized.size());
+  EnableAliasing(&stream);
+  while (!stream.ExpectAtEnd()) {
+    if (!stream.ExpectTag(kDelimitedTag(1))) {
+      if (!SkipExtraneousTag(&stream)) return false;
+      continue;
+    }
+    StringPiece feature;
+    if (!ParseString(&stream, &feature)) return false;
+    feature_list->emplace_back(feature);
+  }
+  return true;
+}
+
 }  // namespace
 
 bool TestFastParse(const string& serialized, Example* example) {
@@ -445,6 +479,61 @@ struct SeededHasher {
   uint64 seed{0xDECAFCAFFE};
 };
 
+using ConfigIndex = PresizedCuckooMap<std::pair<size_t, Type>>;
+
+// Fills config_index with the hashes of the feature names in config, changing
+// the seed of hasher until they do not collide.
+Status BuildConfigIndex(const Config& config, SeededHasher* hasher,
+                        ConfigIndex* config_index) {
+  const size_t config_size = config.dense.size() + config.sparse.size();
+  bool ok = true;
+  for (size_t i = 0; i < 1000; ++i) {
+    for (size_t d = 0; d < config.dense.size(); ++d) {
+      ok &= config_index->InsertUnique((*hasher)(config.dense[d].feature_name),
+                                       {d, Type::Dense});
+    }
+    for (size_t d = 0; d < config.sparse.size(); ++d) {
+      ok &= config_index->InsertUnique((*hasher)(config.sparse[d].feature_name),
+                                       {d, Type::Sparse});
+    }
+    if (ok) break;
+    LOG(WARNING) << "Collision found. This should happen only if you have "
+                    "around 2^32 entries in your config.";
+    hasher->seed++;
+    config_index->Clear(config_size);
+  }
+  if (!ok) {
+    return errors::Internal(
+        "Could not avoid collision. This should not happen.");
+  }
+  return Status::OK();
+}
+
+// Calculates the number of minibatches the examples are parsed in.
+// In main regime make each minibatch around kMiniBatchSizeBytes bytes.
+// Apply 'special logic' below for small and big regimes.
+size_t GetNumMiniBatches(gtl::ArraySlice<string> serialized) {
+  // This parameter affects performance in a big and data-dependent way.
+  const size_t kMiniBatchSizeBytes = 50000;
+
+  size_t result = 0;
+  size_t minibatch_bytes = 0;
+  for (size_t i = 0; i < serialized.size(); i++) {
+    if (minibatch_bytes == 0) {  // start minibatch
+      result++;
+    }
+    minibatch_bytes += serialized[i].size() + 1;
+    if (minibatch_bytes > kMiniBatchSizeBytes) {
+      minibatch_bytes = 0;
+    }
+  }
+  // 'special logic'
+  const size_t min_minibatches = std::min<size_t>(8, serialized.size());
+  const size_t max_minibatches = 64;
+  return std::max<size_t>(min_minibatches,
+                          std::min<size_t>(max_minibatches, result));
+}
+
 template <typename T>
 class LimitedArraySlice {
  public:
@@ -492,8 +581,8 @@ void LogSparseFeatureDataLoss(StringPiece feature_name) {
 Status FastParseSerializedExample(
     const string& serialized_example, const string& example_name,
     const size_t example_index, const Config& config,
-    const PresizedCuckooMap<std::pair<size_t, Type>>& config_index,
-    SeededHasher hasher, std::vector<Tensor>* output_dense,
+    const ConfigIndex& config_index, SeededHasher hasher,
+    std::vector<Tensor>* output_dense,
     std::vector<SparseBuffer>* output_varlen_dense,
     std::vector<SparseBuffer>* output_sparse) {
   DCHECK(output_dense != nullptr);
@@ -862,6 +951,267 @@ void FillAndCopyVarLen(
   }
 }
 
+// Finds the serialized FeatureLists of the feature lists in config in the
+// serialized SequenceExample. Slot d of feature_lists and found is
+// config.dense[d] and slot config.dense.size() + d is config.sparse[d].
+// The context and the feature lists not in config are skipped.
+bool ParseSequenceExampleFeatureLists(StringPiece serialized,
+                                      const Config& config,
+                                      const ConfigIndex& config_index,
+                                      SeededHasher hasher,
+                                      std::vector<StringPiece>* feature_lists,
+                                      std::vector<bool>* found) {
+  DCHECK(feature_lists != nullptr);
+  DCHECK(found != nullptr);
+  protobuf::io::CodedInputStream stream(
+      reinterpret_cast<const uint8*>(serialized.data()), serialized.size());
+  EnableAliasing(&stream);
+  // As in ParseExample, the input may be several concatenated protos, and the
+  // last entry of a feature list wins.
+  while (!stream.ExpectAtEnd()) {
+    if (!stream.ExpectTag(kDelimitedTag(2))) {
+      if (!SkipExtraneousTag(&stream)) return false;
+      continue;
+    }
+    uint32 length;
+    if (!stream.ReadVarint32(&length)) return false;
+    auto limit = stream.PushLimit(length);
+    while (!stream.ExpectAtEnd()) {
+      if (!stream.ExpectTag(kDelimitedTag(1))) return false;
+      StringPiece feature_list_name;
+      StringPiece feature_list;
+      if (!ParseMapEntry(&stream, &feature_list_name, &feature_list)) {
+        return false;
+      }
+      std::pair<size_t, Type> d_and_type;
+      if (!config_index.Find(hasher(feature_list_name), &d_and_type)) continue;
+      const size_t d = d_and_type.first;
+      const bool is_dense = d_and_type.second == Type::Dense;
+      // Testing for PresizedCuckooMap collision.
+      const string& config_feature_name = is_dense
+                                              ? config.dense[d].feature_name
+                                              : config.sparse[d].feature_name;
+      if (feature_list_name != config_feature_name) continue;
+      const size_t slot = is_dense ? d : config.dense.size() + d;
+      (*feature_lists)[slot] = feature_list;
+      (*found)[slot] = true;
+    }
+    stream.PopLimit(limit);
+  }
+  return true;
+}
+
+Status FeatureListTypeError(StringPiece example_name,
+                            StringPiece feature_list_name, size_t step,
+                            DataType expected_dtype,
+                            const parsed::Feature& feature) {
+  // Only parse the whole Feature to show it in the error message.
+  Feature proto;
+  proto.ParseFromArray(feature.GetSerialized().data(),
+                       feature.GetSerialized().size());
+  return errors::InvalidArgument(
+      "Name: ", example_name, ", Feature list: ", feature_list_name,
+      ", Index: ", step, ".  Data types don't match. Expected type: ",
+      DataTypeString(expected_dtype), "  Feature is: ",
+      ProtoDebugString(proto));
+}
+
+// Returns the error the context of the serialized SequenceExample has
+// according to config, worded as the errors of the generic
+// SequenceExample parser, or OK if it has none of the errors it checks for.
+Status CheckSequenceExampleContext(StringPiece serialized,
+                                   StringPiece example_name,
+                                   const Config& config) {
+  parsed::Example context;
+  if (!ParseExample(serialized, &context)) return Status::OK();
+  // As for the features of Examples, the last entry of a feature wins.
+  std::unordered_map<StringPiece, parsed::Feature, StringPieceHasher> features;
+  for (const parsed::FeatureMapEntry& entry : context) {
+    features[entry.first] = entry.second;
+  }
+
+  auto type_error = [&](const string& key, DataType expected_dtype,
+                        const parsed::Feature& feature) {
+    Feature proto;
+    proto.ParseFromArray(feature.GetSerialized().data(),
+                         feature.GetSerialized().size());
+    return errors::InvalidArgument(
+        "Name: ", example_name, ", Context feature: ", key,
+        ".  Data types don't match. Expected type: ",
+        DataTypeString(expected_dtype), "  Feature is: ",
+        ProtoDebugString(proto));
+  };
+  for (const Config::Dense& dense : config.dense) {
+    auto it = features.find(dense.feature_name);
+    if (it == features.end()) {
+      if (dense.default_value.NumElements() == 0) {
+        return errors::InvalidArgument(
+            "Name: ", example_name, ", Context feature '", dense.feature_name,
+            "' is required but could not be found.");
+      }
+      continue;
+    }
+    parsed::Feature feature = it->second;
+    DataType dtype;
+    if (!feature.ParseDataType(&dtype).ok() || dtype != dense.dtype) {
+      return type_error(dense.feature_name, dense.dtype, it->second);
+    }
+  }
+  for (const Config::Sparse& sparse : config.sparse) {
+    auto it = features.find(sparse.feature_name);
+    if (it == features.end()) continue;
+    parsed::Feature feature = it->second;
+    DataType dtype;
+    if (!feature.ParseDataType(&dtype).ok() ||
+        (dtype != DT_INVALID && dtype != sparse.dtype)) {
+      return type_error(sparse.feature_name, sparse.dtype, it->second);
+    }
+  }
+  return Status::OK();
+}
+
+// Parses the steps of dense feature list d of example example_index into the
+// [batch, max_steps] + shape tensor out, and pads the remaining steps.
+Status ParseDenseFeatureList(const Config& config, size_t d,
+                             size_t example_index, StringPiece example_name,
+                             const std::vector<parsed::Feature>& steps,
+                             Tensor* out) {
+  const Config::Dense& dense = config.dense[d];
+  const size_t num_elements = dense.elements_per_stride;
+  const size_t max_steps = out->dim_size(1);
+  DCHECK_LE(steps.size(), max_steps);
+  for (size_t t = 0; t < steps.size(); ++t) {
+    parsed::Feature feature = steps[t];
+    DataType example_dtype;
+    TF_RETURN_IF_ERROR(feature.ParseDataType(&example_dtype));
+    if (example_dtype != dense.dtype) {
+      return FeatureListTypeError(example_name, dense.feature_name, t,
+                                  dense.dtype, steps[t]);
+    }
+
+    auto step_error = [&](StringPiece suffix) {
+      return errors::InvalidArgument("Name: ", example_name,
+                                     ", Key: ", dense.feature_name,
+                                     ", Index: ", t, ".  ", suffix);
+    };
+    auto parse_error = [&] {
+      return step_error("Can't parse serialized SequenceExample.");
+    };
+    auto shape_error = [&](size_t size, StringPiece type_str) {
+      return step_error(strings::StrCat(
+          "Number of ", type_str, " values != expected.  values size: ", size,
+          " but output shape: ", dense.shape.DebugString()));
+    };
+
+    const size_t offset = (example_index * max_steps + t) * num_elements;
+    switch (dense.dtype) {
+      case DT_INT64: {
+        LimitedArraySlice<int64> slice(out->flat<int64>().data() + offset,
+                                       num_elements);
+        if (!feature.ParseInt64List(&slice)) return parse_error();
+        if (slice.EndDistance() != 0) {
+          return shape_error(num_elements - slice.EndDistance(), "int64");
+        }
+        break;
+      }
+      case DT_FLOAT: {
+        LimitedArraySlice<float> slice(out->flat<float>().data() + offset,
+                                       num_elements);
+        if (!feature.ParseFloatList(&slice)) return parse_error();
+        if (slice.EndDistance() != 0) {
+          return shape_error(num_elements - slice.EndDistance(), "float");
+        }
+        break;
+      }
+      case DT_STRING: {
+        LimitedArraySlice<string> slice(out->flat<string>().data() + offset,
+                                        num_elements);
+        if (!feature.ParseBytesList(&slice)) return parse_error();
+        if (slice.EndDistance() != 0) {
+          return shape_error(num_elements - slice.EndDistance(), "bytes");
+        }
+        break;
+      }
+      default:
+        LOG(FATAL) << "Should not happen.";
+    }
+  }
+
+  // Strings are already empty.
+  const size_t padding_begin =
+      (example_index * max_steps + steps.size()) * num_elements;
+  const size_t padding_end = (example_index + 1) * max_steps * num_elements;
+  switch (dense.dtype) {
+    case DT_INT64:
+      std::fill(out->flat<int64>().data() + padding_begin,
+                out->flat<int64>().data() + padding_end, 0);
+      break;
+    case DT_FLOAT:
+      std::fill(out->flat<float>().data() + padding_begin,
+                out->flat<float>().data() + padding_end, 0.0f);
+      break;
+    default:
+      break;
+  }
+  return Status::OK();
+}
+
+// Sparse feature list values of the examples of a minibatch.
+struct SparseFeatureListBuffer {
+  // Values of all the steps; values.example_end_indices holds where each step
+  // ends.
+  SparseBuffer values;
+  // Number of steps of each example.
+  std::vector<size_t> num_steps;
+};
+
+// Appends the steps of sparse feature list d of one example to out.
+Status ParseSparseFeatureList(const Config& config, size_t d,
+                              StringPiece example_name,
+                              const std::vector<parsed::Feature>& steps,
+                              SparseFeatureListBuffer* out) {
+  const Config::Sparse& sparse = config.sparse[d];
+  SparseBuffer& values = out->values;
+  for (size_t t = 0; t < steps.size(); ++t) {
+    parsed::Feature feature = steps[t];
+    DataType example_dtype;
+    TF_RETURN_IF_ERROR(feature.ParseDataType(&example_dtype));
+    if (example_dtype != DT_INVALID && example_dtype != sparse.dtype) {
+      return FeatureListTypeError(example_name, sparse.feature_name, t,
+                                  sparse.dtype, steps[t]);
+    }
+
+    // Steps without a value are empty.
+    const bool has_values = example_dtype != DT_INVALID;
+    bool ok = true;
+    size_t end_index = 0;
+    switch (sparse.dtype) {
+      case DT_INT64:
+        if (has_values) ok = feature.ParseInt64List(&values.int64_list);
+        end_index = values.int64_list.size();
+        break;
+      case DT_FLOAT:
+        if (has_values) ok = feature.ParseFloatList(&values.float_list);
+        end_index = values.float_list.size();
+        break;
+      case DT_STRING:
+        if (has_values) ok = feature.ParseBytesList(&values.bytes_list);
+        end_index = values.bytes_list.size();
+        break;
+      default:
+        LOG(FATAL) << "Should not happen.";
+    }
+    if (!ok) {
+      return errors::InvalidArgument(
+          "Name: ", example_name, ", Key: ", sparse.feature_name,
+          ", Index: ", t, ".  Can't parse serialized SequenceExample.");
+    }
+    values.example_end_indices.push_back(end_index);
+  }
+  out->num_steps.push_back(steps.size());
+  return Status::OK();
+}
+
 }  // namespace
 
 Status FastParseExample(const Config& config,
@@ -880,27 +1230,8 @@ Status FastParseExample(const Config& config,
   size_t config_size = config.dense.size() + config.sparse.size();
   SeededHasher hasher;
   // Build config index.
-  PresizedCuckooMap<std::pair<size_t, Type>> config_index(config_size);
-  bool ok = true;
-  for (size_t i = 0; i < 1000; ++i) {
-    for (size_t d = 0; d < config.dense.size(); ++d) {
-      ok &= config_index.InsertUnique(hasher(config.dense[d].feature_name),
-                                      {d, Type::Dense});
-    }
-    for (size_t d = 0; d < config.sparse.size(); ++d) {
-      ok &= config_index.InsertUnique(hasher(config.sparse[d].feature_name),
-                                      {d, Type::Sparse});
-    }
-    if (ok) break;
-    LOG(WARNING) << "Collision found. This should happen only if you have "
-                    "around 2^32 entries in your config.";
-    hasher.seed++;
-    config_index.Clear(config_size);
-  }
-  if (!ok) {
-    return errors::Internal(
-        "Could not avoid collision. This should not happen.");
-  }
+  ConfigIndex config_index(config_size);
+  TF_RETURN_IF_ERROR(BuildConfigIndex(config, &hasher, &config_index));
 
   // Allocate dense output for fixed length dense values
   // (variable-length dense and sparse have to be buffered).
@@ -915,30 +1246,7 @@ Status FastParseExample(const Config& config,
     fixed_dense_values[d] = Tensor(config.dense[d].dtype, out_shape);
   }
 
-  // This parameter affects performance in a big and data-dependent way.
-  const size_t kMiniBatchSizeBytes = 50000;
-
-  // Calculate number of minibatches.
-  // In main regime make each minibatch around kMiniBatchSizeBytes bytes.
-  // Apply 'special logic' below for small and big regimes.
-  const size_t num_minibatches = [&] {
-    size_t result = 0;
-    size_t minibatch_bytes = 0;
-    for (size_t i = 0; i < serialized.size(); i++) {
-      if (minibatch_bytes == 0) {  // start minibatch
-        result++;
-      }
-      minibatch_bytes += serialized[i].size() + 1;
-      if (minibatch_bytes > kMiniBatchSizeBytes) {
-        minibatch_bytes = 0;
-      }
-    }
-    // 'special logic'
-    const size_t min_minibatches = std::min<size_t>(8, serialized.size());
-    const size_t max_minibatches = 64;
-    return std::max<size_t>(min_minibatches,
-                            std::min<size_t>(max_minibatches, result));
-  }();
+  const size_t num_minibatches = GetNumMiniBatches(serialized);
 
   auto first_example_of_minibatch = [&](size_t minibatch) -> size_t {
     return (serialized.size() * minibatch) / num_minibatches;
@@ -1142,27 +1450,8 @@ Status FastParseSingleExample(const Config& config, const string& serialized,
   size_t config_size = config.dense.size() + config.sparse.size();
   SeededHasher hasher;
   // Build config index.
-  PresizedCuckooMap<std::pair<size_t, Type>> config_index(config_size);
-  bool ok = true;
-  for (size_t i = 0; i < 1000; ++i) {
-    for (size_t d = 0; d < config.dense.size(); ++d) {
-      ok &= config_index.InsertUnique(hasher(config.dense[d].feature_name),
-                                      {d, Type::Dense});
-    }
-    for (size_t d = 0; d < config.sparse.size(); ++d) {
-      ok &= config_index.InsertUnique(hasher(config.sparse[d].feature_name),
-                                      {d, Type::Sparse});
-    }
-    if (ok) break;
-    LOG(WARNING) << "Collision found. This should happen only if you have "
-                    "around 2^32 entries in your config.";
-    hasher.seed++;
-    config_index.Clear(config_size);
-  }
-  if (!ok) {
-    return errors::Internal(
-        "Could not avoid collision. This should not happen.");
-  }
+  ConfigIndex config_index(config_size);
+  TF_RETURN_IF_ERROR(BuildConfigIndex(config, &hasher, &config_index));
 
   // Allocate dense output tensors.
   for (size_t d = 0; d < config.dense.size(); ++d) {
@@ -1455,5 +1744,273 @@ Status FastParseSingleExample(const Config& config, const string& serialized,
   return Status::OK();
 }
 
+Status FastParseSequenceExample(
+    const Config& context_config, const Config& feature_list_config,
+    gtl::ArraySlice<string> serialized, gtl::ArraySlice<string> example_names,
+    thread::ThreadPool* thread_pool, Result* context_result,
+    Result* feature_list_result, std::vector<Tensor>* dense_feature_lengths) {
+  DCHECK(context_result != nullptr);
+  DCHECK(feature_list_result != nullptr);
+  DCHECK(dense_feature_lengths != nullptr);
+
+  // The context of a SequenceExample has the field number and type of the
+  // features of an Example, and the feature lists are skipped like any other
+  // unknown field, so the context is parsed exactly as Examples are.
+  Status context_status = FastParseExample(
+      context_config, serialized, example_names, thread_pool, context_result);
+  if (!context_status.ok()) {
+    // Report the first problem with a context as ParseSingleSequenceExample
+    // always has. This is only done on failure to keep parsing fast.
+    for (size_t e = 0; e < serialized.size(); ++e) {
+      TF_RETURN_IF_ERROR(CheckSequenceExampleContext(
+          serialized[e],
+          !example_names.empty() ? example_names[e] : "<unknown>",
+          context_config));
+    }
+    return context_status;
+  }
+
+  const Config& config = feature_list_config;
+  // Check config so we can safely CHECK(false) in switches on config.*.dtype
+  for (auto& c : config.sparse) {
+    TF_RETURN_IF_ERROR(CheckConfigDataType(c.dtype));
+  }
+  for (auto& c : config.dense) {
+    TF_RETURN_IF_ERROR(CheckConfigDataType(c.dtype));
+  }
+
+  const size_t num_dense = config.dense.size();
+  const size_t config_size = num_dense + config.sparse.size();
+  SeededHasher hasher;
+  ConfigIndex config_index(config_size);
+  TF_RETURN_IF_ERROR(BuildConfigIndex(config, &hasher, &config_index));
+
+  const size_t batch_size = serialized.size();
+  dense_feature_lengths->clear();
+  for (size_t d = 0; d < num_dense; ++d) {
+    dense_feature_lengths->emplace_back(DT_INT64,
+                                        TensorShape({int64(batch_size)}));
+  }
+
+  const size_t num_minibatches = GetNumMiniBatches(serialized);
+  auto first_example_of_minibatch = [&](size_t minibatch) -> size_t {
+    return (batch_size * minibatch) / num_minibatches;
+  };
+  auto example_name = [&](size_t e) -> StringPiece {
+    return !example_names.empty() ? StringPiece(example_names[e])
+                                  : StringPiece("<unknown>");
+  };
+
+  // The dense feature lists can only be allocated once the longest one is
+  // known. So the first pass over the minibatches counts their steps, keeping
+  // the serialized FeatureLists around, and parses the sparse ones into
+  // buffers; the second pass parses the dense ones into the outputs.
+  std::vector<StringPiece> dense_feature_lists(batch_size * num_dense);
+  std::vector<std::vector<SparseFeatureListBuffer>> sparse_buffers(
+      num_minibatches);
+  auto FindFeatureListsOfMiniBatch = [&](size_t minibatch) -> Status {
+    sparse_buffers[minibatch].resize(config.sparse.size());
+    std::vector<StringPiece> feature_lists(config_size);
+    std::vector<bool> found(config_size);
+    std::vector<parsed::Feature> steps;
+    const size_t start = first_example_of_minibatch(minibatch);
+    const size_t end = first_example_of_minibatch(minibatch + 1);
+    for (size_t e = start; e < end; ++e) {
+      std::fill(found.begin(), found.end(), false);
+      if (!ParseSequenceExampleFeatureLists(serialized[e], config, config_index,
+                                            hasher, &feature_lists, &found)) {
+        return errors::InvalidArgument(
+            "Could not parse example input, value: '", serialized[e], "'");
+      }
+      auto parse_error = [&](StringPiece feature_list_name) {
+        return errors::InvalidArgument(
+            "Name: ", example_name(e), ", Feature list: ", feature_list_name,
+            ".  Can't parse serialized SequenceExample.");
+      };
+      for (size_t d = 0; d < num_dense; ++d) {
+        const string& key = config.dense[d].feature_name;
+        // Missing dense feature lists that are allowed to be missing have no
+        // steps.
+        if (!found[d] && !config.dense[d].missing_assumed_empty) {
+          return errors::InvalidArgument(
+              "Name: ", example_name(e), ", Feature list '", key,
+              "' is required but could not be found.  Did you mean to "
+              "include it in feature_list_dense_missing_assumed_empty or "
+              "feature_list_dense_defaults?");
+        }
+        steps.clear();
+        if (found[d] && !ParseFeatureList(feature_lists[d], &steps)) {
+          return parse_error(key);
+        }
+        dense_feature_lists[e * num_dense + d] =
+            found[d] ? feature_lists[d] : StringPiece();
+        (*dense_feature_lengths)[d].vec<int64>()(e) = steps.size();
+      }
+      for (size_t d = 0; d < config.sparse.size(); ++d) {
+        const size_t slot = num_dense + d;
+        steps.clear();
+        if (found[slot] && !ParseFeatureList(feature_lists[slot], &steps)) {
+          return parse_error(config.sparse[d].feature_name);
+        }
+        TF_RETURN_IF_ERROR(
+            ParseSparseFeatureList(config, d, example_name(e), steps,
+                                   &sparse_buffers[minibatch][d]));
+      }
+    }
+    return Status::OK();
+  };
+
+  std::vector<Status> status_of_minibatch(num_minibatches);
+  ParallelFor(
+      [&](size_t minibatch) {
+        status_of_minibatch[minibatch] = FindFeatureListsOfMiniBatch(minibatch);
+      },
+      num_minibatches, thread_pool);
+  for (Status& status : status_of_minibatch) {
+    TF_RETURN_IF_ERROR(status);
+  }
+
+  // Allocate dense output, padded to the longest feature list in the batch.
+  for (size_t d = 0; d < num_dense; ++d) {
+    const auto lengths = (*dense_feature_lengths)[d].vec<int64>();
+    int64 max_steps = 0;
+    for (size_t e = 0; e < batch_size; ++e) {
+      max_steps = std::max(max_steps, lengths(e));
+    }
+    TensorShape out_shape;
+    out_shape.AddDim(batch_size);
+    out_shape.AddDim(max_steps);
+    for (const int64 dim : config.dense[d].shape.dim_sizes()) {
+      out_shape.AddDim(dim);
+    }
+    feature_list_result->dense_values.emplace_back(config.dense[d].dtype,
+                                                   out_shape);
+  }
+
+  if (num_dense > 0) {
+    auto ParseDenseFeatureListsOfMiniBatch = [&](size_t minibatch) -> Status {
+      std::vector<parsed::Feature> steps;
+      const size_t start = first_example_of_minibatch(minibatch);
+      const size_t end = first_example_of_minibatch(minibatch + 1);
+      for (size_t e = start; e < end; ++e) {
+        for (size_t d = 0; d < num_dense; ++d) {
+          // Already parsed successfully in the first pass.
+          CHECK(ParseFeatureList(dense_feature_lists[e * num_dense + d],
+                                 &steps));
+          TF_RETURN_IF_ERROR(ParseDenseFeatureList(
+              config, d, e, example_name(e), steps,
+              &feature_list_result->dense_values[d]));
+        }
+      }
+      return Status::OK();
+    };
+    ParallelFor(
+        [&](size_t minibatch) {
+          status_of_minibatch[minibatch] =
+              ParseDenseFeatureListsOfMiniBatch(minibatch);
+        },
+        num_minibatches, thread_pool);
+    for (Status& status : status_of_minibatch) {
+      TF_RETURN_IF_ERROR(status);
+    }
+  }
+
+  // Merge SparseFeatureListBuffers from all minibatches for every
+  // config.sparse.
+  for (size_t d = 0; d < config.sparse.size(); ++d) {
+    size_t total_num_values = 0;
+    size_t max_num_steps = 0;
+    size_t max_num_values = 0;
+    for (auto& minibatch_buffers : sparse_buffers) {
+      const SparseFeatureListBuffer& buffer = minibatch_buffers[d];
+      const std::vector<size_t>& end_indices =
+          buffer.values.example_end_indices;
+      size_t begin_index = 0;
+      for (size_t end_index : end_indices) {
+        max_num_values = std::max(max_num_values, end_index - begin_index);
+        begin_index = end_index;
+      }
+      total_num_values += begin_index;
+      for (size_t num_steps : buffer.num_steps) {
+        max_num_steps = std::max(max_num_steps, num_steps);
+      }
+    }
+
+    TensorShape indices_shape;
+    indices_shape.AddDim(total_num_values);
+    indices_shape.AddDim(3);
+    feature_list_result->sparse_indices.emplace_back(DT_INT64, indices_shape);
+    Tensor* indices = &feature_list_result->sparse_indices.back();
+
+    TensorShape values_shape;
+    values_shape.AddDim(total_num_values);
+    feature_list_result->sparse_values.emplace_back(config.sparse[d].dtype,
+                                                    values_shape);
+    Tensor* values = &feature_list_result->sparse_values.back();
+
+    feature_list_result->sparse_shapes.emplace_back(DT_INT64,
+                                                    TensorShape({3}));
+    auto shapes_shape_t =
+        feature_list_result->sparse_shapes.back().vec<int64>();
+    shapes_shape_t(0) = batch_size;
+    shapes_shape_t(1) = max_num_steps;
+    shapes_shape_t(2) = max_num_values;
+
+    int64* ix_p = indices->flat<int64>().data();
+    size_t offset = 0;
+    for (size_t i = 0; i < sparse_buffers.size(); ++i) {
+      SparseFeatureListBuffer& buffer = sparse_buffers[i][d];
+      const std::vector<size_t>& end_indices =
+          buffer.values.example_end_indices;
+
+      // Update indices.
+      size_t value_index = 0;
+      size_t step_index = 0;
+      size_t example_index = first_example_of_minibatch(i);
+      for (size_t num_steps : buffer.num_steps) {
+        for (size_t t = 0; t < num_steps; ++t) {
+          const size_t end_index = end_indices[step_index++];
+          for (size_t j = 0; value_index < end_index; ++value_index, ++j) {
+            // Columns: example index, step, value index in the step.
+            *ix_p = example_index;
+            *(ix_p + 1) = t;
+            *(ix_p + 2) = j;
+            ix_p += 3;
+          }
+        }
+        ++example_index;
+      }
+
+      // Copy values over.
+      switch (config.sparse[d].dtype) {
+        case DT_INT64: {
+          std::copy(buffer.values.int64_list.begin(),
+                    buffer.values.int64_list.end(),
+                    values->flat<int64>().data() + offset);
+          break;
+        }
+        case DT_FLOAT: {
+          std::copy(buffer.values.float_list.begin(),
+                    buffer.values.float_list.end(),
+                    values->flat<float>().data() + offset);
+          break;
+        }
+        case DT_STRING: {
+          std::move(buffer.values.bytes_list.begin(),
+                    buffer.values.bytes_list.end(),
+                    values->flat<string>().data() + offset);
+          break;
+        }
+        default:
+          LOG(FATAL) << "Should not happen.";
+      }
+
+      offset += value_index;
+    }
+  }
+
+  return Status::OK();
+}
+
 }  // namespace example
 }  // namespace tensorflow
@@ -50,6 +50,9 @@ struct FastParseExampleConfig {
     Tensor default_value;
     bool variable_length;
     std::size_t elements_per_stride;
+    // Only used for the feature lists of FastParseSequenceExample: a missing
+    // dense feature list is treated as empty instead of being an error.
+    bool missing_assumed_empty;
   };
 
   struct Sparse {
@@ -85,6 +88,30 @@ typedef FastParseExampleConfig FastParseSingleExampleConfig;
 Status FastParseSingleExample(const FastParseSingleExampleConfig& config,
                               const string& serialized, Result* result);
 
+// Parses a batch of serialized SequenceExample protos.
+// The context features are parsed into context_result according to
+// context_config, exactly as FastParseExample parses Examples, except that
+// errors refer to them as context features.
+// The feature lists are parsed into feature_list_result according to
+// feature_list_config:
+//  - dense feature list d has shape [batch, max_steps] + shape, where
+//    max_steps is the largest number of steps in the batch. Shorter lists are
+//    padded with zeros (empty strings). The number of steps of every example
+//    is stored in the int64 [batch] tensor (*dense_feature_lengths)[d].
+//    A missing dense feature list is an error unless its
+//    missing_assumed_empty is set, in which case it is treated as empty.
+//  - sparse feature list d has [N, 3] indices (example, step, value index)
+//    and dense shape [batch, max_steps, max_values_per_step].
+// Features and feature lists that are not in the configs are skipped without
+// being parsed. Minibatches of examples are parsed in parallel on
+// thread_pool, if given.
+Status FastParseSequenceExample(
+    const FastParseExampleConfig& context_config,
+    const FastParseExampleConfig& feature_list_config,
+    gtl::ArraySlice<string> serialized, gtl::ArraySlice<string> example_names,
+    thread::ThreadPool* thread_pool, Result* context_result,
+    Result* feature_list_result, std::vector<Tensor>* dense_feature_lengths);
+
 // This function parses serialized Example and populates given example.
 // It uses the same specialized parser as FastParseExample which is efficient.
 // But then constructs Example which is relatively slow.
@@ -17,8 +17,12 @@ limitations under the License.
 
 #include "tensorflow/core/example/example.pb.h"
 #include "tensorflow/core/example/feature.pb.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/random/philox_random.h"
 #include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
@@ -346,6 +350,239 @@ TEST(TestFastParseExample, Empty) {
   EXPECT_TRUE(status.ok()) << status;
 }
 
+// Builds a SequenceExample with context features "label" (int64) and
+// "unused", and feature lists "frames" (float pairs), "tokens" (sparse int64)
+// and "unused" with num_steps steps each.
+SequenceExample MakeSequenceExample(int64 label, int num_steps) {
+  SequenceExample example;
+  auto& context = *example.mutable_context()->mutable_feature();
+  context["label"].mutable_int64_list()->add_value(label);
+  context["unused"].mutable_bytes_list()->add_value("context");
+  auto& feature_lists =
+      *example.mutable_feature_lists()->mutable_feature_list();
+  for (int t = 0; t < num_steps; ++t) {
+    auto* frame = feature_lists["frames"].add_feature()->mutable_float_list();
+    frame->add_value(t);
+    frame->add_value(t + 0.5f);
+    auto* tokens = feature_lists["tokens"].add_feature()->mutable_int64_list();
+    for (int i = 0; i <= t; ++i) tokens->add_value(label * 100 + i);
+    feature_lists["unused"].add_feature()->mutable_bytes_list()->add_value(
+        "step");
+  }
+  return example;
+}
+
+void MakeSequenceExampleConfigs(FastParseExampleConfig* context_config,
+                                FastParseExampleConfig* feature_list_config) {
+  context_config->dense.push_back({"label", DT_INT64, PartialTensorShape({}),
+                                   Tensor(), false, 1});
+  feature_list_config->dense.push_back(
+      {"frames", DT_FLOAT, PartialTensorShape({2}), Tensor(), false, 2});
+  feature_list_config->sparse.push_back({"tokens", DT_INT64});
+}
+
+TEST(FastParseSequenceExample, Batch) {
+  std::vector<string> serialized = {Serialize(MakeSequenceExample(1, 2)),
+                                    Serialize(MakeSequenceExample(2, 3))};
+  FastParseExampleConfig context_config;
+  FastParseExampleConfig feature_list_config;
+  MakeSequenceExampleConfigs(&context_config, &feature_list_config);
+
+  Result context_result;
+  Result feature_list_result;
+  std::vector<Tensor> dense_feature_lengths;
+  TF_ASSERT_OK(FastParseSequenceExample(
+      context_config, feature_list_config, serialized, {}, nullptr,
+      &context_result, &feature_list_result, &dense_feature_lengths));
+
+  ASSERT_EQ(1, context_result.dense_values.size());
+  EXPECT_EQ(1, context_result.dense_values[0].flat<int64>()(0));
+  EXPECT_EQ(2, context_result.dense_values[0].flat<int64>()(1));
+
+  // The first example is padded to the three steps of the second one.
+  ASSERT_EQ(1, feature_list_result.dense_values.size());
+  const Tensor& frames = feature_list_result.dense_values[0];
+  EXPECT_EQ(TensorShape({2, 3, 2}), frames.shape());
+  auto frames_t = frames.tensor<float, 3>();
+  EXPECT_EQ(1.0f, frames_t(0, 1, 0));
+  EXPECT_EQ(1.5f, frames_t(0, 1, 1));
+  EXPECT_EQ(0.0f, frames_t(0, 2, 0));
+  EXPECT_EQ(0.0f, frames_t(0, 2, 1));
+  EXPECT_EQ(2.5f, frames_t(1, 2, 1));
+  ASSERT_EQ(1, dense_feature_lengths.size());
+  EXPECT_EQ(2, dense_feature_lengths[0].vec<int64>()(0));
+  EXPECT_EQ(3, dense_feature_lengths[0].vec<int64>()(1));
+
+  // Step t of example b has t + 1 tokens.
+  ASSERT_EQ(1, feature_list_result.sparse_values.size());
+  EXPECT_EQ(3 + 6, feature_list_result.sparse_values[0].NumElements());
+  auto shape_t = feature_list_result.sparse_shapes[0].vec<int64>();
+  EXPECT_EQ(2, shape_t(0));
+  EXPECT_EQ(3, shape_t(1));
+  EXPECT_EQ(3, shape_t(2));
+  // The last value is example 1, step 2, value 2.
+  auto indices_t = feature_list_result.sparse_indices[0].matrix<int64>();
+  EXPECT_EQ(1, indices_t(8, 0));
+  EXPECT_EQ(2, indices_t(8, 1));
+  EXPECT_EQ(2, indices_t(8, 2));
+  EXPECT_EQ(202, feature_list_result.sparse_values[0].vec<int64>()(8));
+}
+
+TEST(FastParseSequenceExample, MissingFeatureList) {
+  std::vector<string> serialized = {Serialize(MakeSequenceExample(1, 2)),
+                                    Serialize(MakeSequenceExample(2, 0))};
+  FastParseExampleConfig context_config;
+  FastParseExampleConfig feature_list_config;
+  MakeSequenceExampleConfigs(&context_config, &feature_list_config);
+
+  Result context_result;
+  Result feature_list_result;
+  std::vector<Tensor> dense_feature_lengths;
+  Status status = FastParseSequenceExample(
+      context_config, feature_list_config, serialized, {"in0", "in1"}, nullptr,
+      &context_result, &feature_list_result, &dense_feature_lengths);
+  EXPECT_TRUE(str_util::StrContains(
+      status.error_message(), "Name: in1, Feature list 'frames' is required"))
+      << status;
+
+  // Missing feature lists allowed to be missing have no steps.
+  feature_list_config.dense[0].missing_assumed_empty = true;
+  context_result = Result();
+  feature_list_result = Result();
+  TF_ASSERT_OK(FastParseSequenceExample(
+      context_config, feature_list_config, serialized, {}, nullptr,
+      &context_result, &feature_list_result, &dense_feature_lengths));
+  EXPECT_EQ(TensorShape({2, 2, 2}),
+            feature_list_result.dense_values[0].shape());
+  EXPECT_EQ(0, dense_feature_lengths[0].vec<int64>()(1));
+  auto shape_t = feature_list_result.sparse_shapes[0].vec<int64>();
+  EXPECT_EQ(2, shape_t(1));
+  EXPECT_EQ(2, shape_t(2));
+}
+
+TEST(FastParseSequenceExample, WrongDataType) {
+  SequenceExample example = MakeSequenceExample(1, 2);
+  (*example.mutable_feature_lists()->mutable_feature_list())["frames"]
+      .add_feature()
+      ->mutable_int64_list()
+      ->add_value(3);
+  std::vector<string> serialized = {Serialize(example)};
+  FastParseExampleConfig context_config;
+  FastParseExampleConfig feature_list_config;
+  MakeSequenceExampleConfigs(&context_config, &feature_list_config);
+
+  Result context_result;
+  Result feature_list_result;
+  std::vector<Tensor> dense_feature_lengths;
+  Status status = FastParseSequenceExample(
+      context_config, feature_list_config, serialized, {"in1"}, nullptr,
+      &context_result, &feature_list_result, &dense_feature_lengths);
+  EXPECT_TRUE(str_util::StrContains(status.error_message(),
+                                    "Name: in1, Feature list: frames, Index: "
+                                    "2.  Data types don't match. Expected "
+                                    "type: float"))
+      << status;
+}
+
+TEST(FastParseSequenceExample, ContextErrors) {
+  FastParseExampleConfig context_config;
+  FastParseExampleConfig feature_list_config;
+  MakeSequenceExampleConfigs(&context_config, &feature_list_config);
+  Result context_result;
+  Result feature_list_result;
+  std::vector<Tensor> dense_feature_lengths;
+
+  SequenceExample example = MakeSequenceExample(1, 2);
+  example.mutable_context()->mutable_feature()->erase("label");
+  Status status = FastParseSequenceExample(
+      context_config, feature_list_config, {Serialize(example)}, {"in1"},
+      nullptr, &context_result, &feature_list_result, &dense_feature_lengths);
+  EXPECT_TRUE(str_util::StrContains(
+      status.error_message(),
+      "Name: in1, Context feature 'label' is required but could not be "
+      "found."))
+      << status;
+
+  example = MakeSequenceExample(1, 2);
+  (*example.mutable_context()->mutable_feature())["label"]
+      .mutable_float_list()
+      ->add_value(1);
+  status = FastParseSequenceExample(
+      context_config, feature_list_config, {Serialize(example)}, {"in1"},
+      nullptr, &context_result, &feature_list_result, &dense_feature_lengths);
+  EXPECT_TRUE(str_util::StrContains(status.error_message(),
+                                    "Name: in1, Context feature: label.  Data "
+                                    "types don't match. Expected type: int64"))
+      << status;
+}
+
+TEST(FastParseSequenceExample, Empty) {
+  FastParseExampleConfig context_config;
+  FastParseExampleConfig feature_list_config;
+  MakeSequenceExampleConfigs(&context_config, &feature_list_config);
+  Result context_result;
+  Result feature_list_result;
+  std::vector<Tensor> dense_feature_lengths;
+  TF_ASSERT_OK(FastParseSequenceExample(
+      context_config, feature_list_config, gtl::ArraySlice<string>(),
+      gtl::ArraySlice<string>(), nullptr, &context_result,
+      &feature_list_result, &dense_feature_lengths));
+  EXPECT_EQ(TensorShape({0, 0, 2}),
+            feature_list_result.dense_values[0].shape());
+  EXPECT_EQ(0, feature_list_result.sparse_values[0].NumElements());
+}
+
+// Parses batch_size SequenceExamples of num_steps steps, either with
+// FastParseSequenceExample or by deserializing them into protos.
+void BM_ParseSequenceExample(int iters, int batch_size, int num_steps,
+                             bool fast) {
+  testing::StopTiming();
+  std::vector<string> serialized;
+  size_t num_bytes = 0;
+  for (int i = 0; i < batch_size; ++i) {
+    serialized.push_back(Serialize(MakeSequenceExample(i, num_steps)));
+    num_bytes += serialized.back().size();
+  }
+  FastParseExampleConfig context_config;
+  FastParseExampleConfig feature_list_config;
+  MakeSequenceExampleConfigs(&context_config, &feature_list_config);
+  thread::ThreadPool pool(Env::Default(), "test", 4);
+  testing::BytesProcessed(static_cast<int64>(iters) * num_bytes);
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    if (fast) {
+      Result context_result;
+      Result feature_list_result;
+      std::vector<Tensor> dense_feature_lengths;
+      TF_CHECK_OK(FastParseSequenceExample(
+          context_config, feature_list_config, serialized, {}, &pool,
+          &context_result, &feature_list_result, &dense_feature_lengths));
+    } else {
+      for (const string& s : serialized) {
+        SequenceExample example;
+        CHECK(example.ParseFromString(s));
+      }
+    }
+  }
+}
+
+#define BM_SequenceExample(B, T)                                             \
+  static void BM_FastParseSequenceExample_##B##_##T(int iters) {             \
+    BM_ParseSequenceExample(iters, B, T, true);                              \
+  }                                                                          \
+  BENCHMARK(BM_FastParseSequenceExample_##B##_##T);                          \
+  static void BM_ParseSequenceExampleProto_##B##_##T(int iters) {            \
+    BM_ParseSequenceExample(iters, B, T, false);                             \
+  }                                                                          \
+  BENCHMARK(BM_ParseSequenceExampleProto_##B##_##T);
+
+BM_SequenceExample(1, 10);
+BM_SequenceExample(1, 100);
+BM_SequenceExample(128, 10);
+BM_SequenceExample(128, 100);
+
+#undef BM_SequenceExample
+
 }  // namespace
 }  // namespace example
 }  // namespace tensorflow
@@ -19,6 +19,7 @@ limitations under the License.
 #include <cstdlib>
 #include <cstring>
 #include <memory>
+#include <numeric>
 #include <utility>
 
 #include "tensorflow/core/framework/register_types.h"
@@ -34,6 +35,7 @@ limitations under the License.
 #include "tensorflow/core/framework/versions.pb.h"
 #include "tensorflow/core/lib/core/coding.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
 #include "tensorflow/core/lib/gtl/stl_util.h"
 #include "tensorflow/core/lib/hash/crc32c.h"
@@ -41,6 +43,7 @@ limitations under the License.
 #include "tensorflow/core/lib/io/table_builder.h"
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/util/saved_tensor_slice_util.h"
 #include "tensorflow/core/util/tensor_slice_util.h"
 
@@ -365,6 +368,74 @@ Status PadAlignment(FileOutputBuffer* out, int alignment, int64* size) {
   return status;
 }
 
+// Appends "val" to "out", whose current size is "size", and pads the data to
+// "alignment".  Fills in the offset, size and checksum of "entry", and
+// updates "size" to the new size of "out".
+Status AppendTensor(const Tensor& val, int alignment, FileOutputBuffer* out,
+                    int64* size, BundleEntryProto* entry) {
+  entry->set_offset(*size);
+  size_t data_bytes_written = 0;
+  uint32 crc32c = 0;
+  out->clear_crc32c();
+  if (val.dtype() == DT_STRING) {
+    TF_RETURN_IF_ERROR(
+        WriteStringTensor(val, out, &data_bytes_written, &crc32c));
+  } else if (val.dtype() == DT_VARIANT) {
+    TF_RETURN_IF_ERROR(
+        WriteVariantTensor(val, out, &data_bytes_written, &crc32c));
+  } else {
+    TF_RETURN_IF_ERROR(WriteTensor(val, out, &data_bytes_written));
+    crc32c = out->crc32c();
+  }
+  entry->set_size(data_bytes_written);
+  entry->set_crc32c(crc32c::Mask(crc32c));
+  *size += data_bytes_written;
+  return PadAlignment(out, alignment, size);
+}
+
+// Writes the data file "path" of a bundle, holding "tensors" in that order.
+Status WriteDataFile(
+    Env* env, const string& path, int32 shard_id, int alignment,
+    const std::vector<std::pair<const Tensor*, BundleEntryProto*>>& tensors) {
+  std::unique_ptr<WritableFile> file;
+  TF_RETURN_IF_ERROR(env->NewWritableFile(path, &file));
+  FileOutputBuffer out(file.release(), 8 << 20 /* 8MB write buffer */);
+  int64 size = 0;
+  for (const auto& p : tensors) {
+    p.second->set_shard_id(shard_id);
+    TF_RETURN_IF_ERROR(
+        AppendTensor(*p.first, alignment, &out, &size, p.second));
+  }
+  VLOG(1) << "Wrote " << tensors.size() << " tensors, " << size
+          << " bytes to file " << path;
+  return out.Close();
+}
+
+// Reads the data of a tensor whose dtype can be memcpy'd straight into
+// "backing_buffer", and checksums it into "actual_crc32c".
+Status ReadFlatTensor(const RandomAccessFile* file,
+                      const BundleEntryProto& entry, char* backing_buffer,
+                      uint32* actual_crc32c) {
+  StringPiece sp;
+  TF_RETURN_IF_ERROR(
+      file->Read(entry.offset(), entry.size(), &sp, backing_buffer));
+  if (sp.data() != backing_buffer) {
+    memmove(backing_buffer, sp.data(), entry.size());
+  }
+  *actual_crc32c = crc32c::Value(backing_buffer, entry.size());
+  return Status::OK();
+}
+
+Status CheckCrc32c(const BundleEntryProto& entry, uint32 actual_crc32c) {
+  if (crc32c::Unmask(entry.crc32c()) != actual_crc32c) {
+    return errors::DataLoss(
+        "Checksum does not match: stored ",
+        strings::Printf("%08u", crc32c::Unmask(entry.crc32c())),
+        " vs. calculated on the restored bytes ", actual_crc32c);
+  }
+  return Status::OK();
+}
+
 }  // namespace
 
 BundleWriter::BundleWriter(Env* env, StringPiece prefix, const Options& options)
@@ -381,6 +452,11 @@ BundleWriter::BundleWriter(Env* env, StringPiece prefix, const Options& options)
   if (!status_.ok() && !errors::IsAlreadyExists(status_)) {
     return;
   }
+  // With several data files, they are only created by Finish().
+  if (options_.num_shards > 1) {
+    status_ = Status::OK();
+    return;
+  }
   const string filename = DataFilename(prefix_, 0, 1);
   std::unique_ptr<WritableFile> wrapper;
   status_ = env_->NewWritableFile(tmp_data_path_, &wrapper);
@@ -404,27 +480,14 @@ Status BundleWriter::Add(StringPiece key, const Tensor& val) {
   entry->set_dtype(val.dtype());
   val.shape().AsProto(entry->mutable_shape());
   entry->set_shard_id(0);
-  entry->set_offset(size_);
 
-  // Updates the data file.
-  size_t data_bytes_written = 0;
-  uint32 crc32c = 0;
-  out_->clear_crc32c();
-  if (val.dtype() == DT_STRING) {
-    status_ = WriteStringTensor(val, out_.get(), &data_bytes_written, &crc32c);
-  } else if (val.dtype() == DT_VARIANT) {
-    status_ = WriteVariantTensor(val, out_.get(), &data_bytes_written, &crc32c);
-  } else {
-    status_ = WriteTensor(val, out_.get(), &data_bytes_written);
-    crc32c = out_->crc32c();
-  }
-
-  if (status_.ok()) {
-    entry->set_size(data_bytes_written);
-    entry->set_crc32c(crc32c::Mask(crc32c));
-    size_ += data_bytes_written;
-    status_ = PadAlignment(out_.get(), options_.data_alignment, &size_);
+  if (options_.num_shards > 1) {
+    pending_.push_back({key_string, entry, val});
+    return status_;
   }
+  // Updates the data file.
+  status_ =
+      AppendTensor(val, options_.data_alignment, out_.get(), &size_, entry);
   return status_;
 }
 
@@ -472,6 +535,7 @@ Status BundleWriter::AddSlice(StringPiece full_tensor_key,
 // TODO(zongheng): on metadata write failure or !status_.ok(), consider removing
 // the orphaned data file.
 Status BundleWriter::Finish() {
+  int num_shards = 1;
   if (out_) {
     status_.Update(out_->Close());
     out_ = nullptr;
@@ -481,6 +545,9 @@ Status BundleWriter::Finish() {
     } else {
       Env::Default()->DeleteFile(tmp_data_path_).IgnoreError();
     }
+  } else if (options_.num_shards > 1 && status_.ok()) {
+    status_ = WriteShards(&num_shards);
+    pending_.clear();
   }
   if (!status_.ok()) return status_;
   // Build key -> BundleEntryProto table.
@@ -495,7 +562,7 @@ Status BundleWriter::Finish() {
     table::TableBuilder builder(options, file.get());
     // Header entry.
     BundleHeaderProto header;
-    header.set_num_shards(1);
+    header.set_num_shards(num_shards);
     header.set_endianness(BundleHeaderProto::LITTLE);
     if (!port::kLittleEndian) header.set_endianness(BundleHeaderProto::BIG);
     VersionDef* version = header.mutable_version();
@@ -523,6 +590,74 @@ Status BundleWriter::Finish() {
   return Status::OK();
 }
 
+Status BundleWriter::WriteShards(int* num_shards) {
+  // Every file gets at least one tensor, as MergeBundles() only renames the
+  // data files that some entry refers to.
+  const int n = std::max<int>(
+      1, std::min<size_t>(options_.num_shards, pending_.size()));
+  *num_shards = n;
+
+  // Largest tensors first, each to the file with the fewest bytes so far.
+  std::vector<int> order(pending_.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+    return pending_[a].val.TotalBytes() > pending_[b].val.TotalBytes();
+  });
+  std::vector<std::vector<int>> shards(n);
+  std::vector<int64> shard_bytes(n, 0);
+  for (size_t i = 0; i < order.size(); ++i) {
+    int shard = i;
+    if (i >= static_cast<size_t>(n)) {
+      shard = std::min_element(shard_bytes.begin(), shard_bytes.end()) -
+              shard_bytes.begin();
+    }
+    shards[shard].push_back(order[i]);
+    shard_bytes[shard] += pending_[order[i]].val.TotalBytes();
+  }
+
+  std::vector<string> tmp_paths(n);
+  std::vector<Status> statuses(n);
+  {
+    // There may be many more files than cores, so they are written on a pool
+    // no larger than the machine.
+    const int num_threads =
+        std::max(1, std::min(n, port::NumSchedulableCPUs()));
+    thread::ThreadPool pool(env_, ThreadOptions(), "bundle_writer", num_threads,
+                            false /* low_latency_hint */);
+    for (int shard = 0; shard < n; ++shard) {
+      // Within a file, tensors are stored in key order, which is the order
+      // readers usually look them up in.
+      std::sort(shards[shard].begin(), shards[shard].end(),
+                [this](int a, int b) {
+                  return pending_[a].key < pending_[b].key;
+                });
+      tmp_paths[shard] = strings::StrCat(DataFilename(prefix_, shard, n),
+                                         ".tempstate", random::New64());
+      pool.Schedule([this, shard, &shards, &tmp_paths, &statuses]() {
+        std::vector<std::pair<const Tensor*, BundleEntryProto*>> tensors;
+        tensors.reserve(shards[shard].size());
+        for (int i : shards[shard]) {
+          tensors.emplace_back(&pending_[i].val, pending_[i].entry);
+        }
+        statuses[shard] = WriteDataFile(env_, tmp_paths[shard], shard,
+                                        options_.data_alignment, tensors);
+      });
+    }
+  }  // Waits for all files to be written.
+
+  Status status;
+  for (const Status& s : statuses) status.Update(s);
+  for (int shard = 0; shard < n; ++shard) {
+    if (status.ok()) {
+      status = env_->RenameFile(tmp_paths[shard],
+                                DataFilename(prefix_, shard, n));
+      if (status.ok()) continue;
+    }
+    env_->DeleteFile(tmp_paths[shard]).IgnoreError();
+  }
+  return status;
+}
+
 // Merging tensor bundles.
 
 // Accumulator of metadata states during a merge.
@@ -804,17 +939,8 @@ Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
     }
   }
 
-  // Open the data file if it has not been opened.
-  io::InputBuffer* buffered_file = data_[entry.shard_id()];
-  if (buffered_file == nullptr) {
-    std::unique_ptr<RandomAccessFile> file = nullptr;
-    TF_RETURN_IF_ERROR(env_->NewRandomAccessFile(
-        DataFilename(prefix_, entry.shard_id(), num_shards_), &file));
-    buffered_file = new io::InputBuffer(file.release(), kBufferSize);
-    // The InputBuffer and RandomAccessFile objects are both released in dtor.
-    data_[entry.shard_id()] = buffered_file;
-  }
-  CHECK(buffered_file != nullptr);
+  io::InputBuffer* buffered_file = nullptr;
+  TF_RETURN_IF_ERROR(GetDataFile(entry.shard_id(), &buffered_file));
 
   TF_RETURN_IF_ERROR(buffered_file->Seek(entry.offset()));
   uint32 actual_crc32c = 0;
@@ -823,17 +949,13 @@ Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
     char* backing_buffer = const_cast<char*>((ret->tensor_data().data()));
     size_t unused_bytes_read;
     if (entry.size() > kBufferSize) {
-      StringPiece sp;
-      TF_RETURN_IF_ERROR(buffered_file->file()->Read(
-          entry.offset(), entry.size(), &sp, backing_buffer));
-      if (sp.data() != backing_buffer) {
-        memmove(backing_buffer, sp.data(), entry.size());
-      }
+      TF_RETURN_IF_ERROR(ReadFlatTensor(buffered_file->file(), entry,
+                                        backing_buffer, &actual_crc32c));
     } else {
       TF_RETURN_IF_ERROR(buffered_file->ReadNBytes(entry.size(), backing_buffer,
                                                    &unused_bytes_read));
+      actual_crc32c = crc32c::Value(backing_buffer, entry.size());
     }
-    actual_crc32c = crc32c::Value(backing_buffer, entry.size());
   } else if (entry.dtype() == DT_VARIANT) {
     // Relies on io::InputBuffer's buffering, because we issue many neighboring
     // reads for a single string tensor.
@@ -846,18 +968,28 @@ Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
         buffered_file, ret->NumElements(), entry.offset(), entry.size(),
         GetStringBackingBuffer(*ret), &actual_crc32c));
   }
-  if (crc32c::Unmask(entry.crc32c()) != actual_crc32c) {
-    return errors::DataLoss(
-        "Checksum does not match: stored ",
-        strings::Printf("%08u", crc32c::Unmask(entry.crc32c())),
-        " vs. calculated on the restored bytes ", actual_crc32c);
-  }
+  TF_RETURN_IF_ERROR(CheckCrc32c(entry, actual_crc32c));
 
   *val = *ret;
   if (ret != val) delete ret;
   return Status::OK();
 }
 
+Status BundleReader::GetDataFile(int32 shard_id,
+                                 io::InputBuffer** buffered_file) {
+  // Open the data file if it has not been opened.
+  io::InputBuffer*& data_file = data_[shard_id];
+  if (data_file == nullptr) {
+    std::unique_ptr<RandomAccessFile> file = nullptr;
+    TF_RETURN_IF_ERROR(env_->NewRandomAccessFile(
+        DataFilename(prefix_, shard_id, num_shards_), &file));
+    // The InputBuffer and RandomAccessFile objects are both released in dtor.
+    data_file = new io::InputBuffer(file.release(), kBufferSize);
+  }
+  *buffered_file = data_file;
+  return Status::OK();
+}
+
 Status BundleReader::Lookup(StringPiece key, Tensor* val) {
   CHECK(val != nullptr);
   BundleEntryProto entry;
@@ -872,6 +1004,77 @@ Status BundleReader::Lookup(StringPiece key, Tensor* val) {
   }
 }
 
+Status BundleReader::LookupMany(gtl::ArraySlice<string> keys,
+                                gtl::ArraySlice<Tensor*> vals,
+                                thread::ThreadPool* pool) {
+  CHECK_EQ(keys.size(), vals.size());
+  // Reads to issue concurrently, with the file each reads from.
+  struct FlatRead {
+    BundleEntryProto entry;
+    Tensor* val;
+    const RandomAccessFile* file;
+  };
+  std::vector<FlatRead> reads;
+  int64 total_bytes = 0;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    CHECK(vals[i] != nullptr);
+    BundleEntryProto entry;
+    TF_RETURN_IF_ERROR(GetBundleEntryProto(keys[i], &entry));
+    if (!entry.slices().empty() || !DataTypeCanUseMemcpy(entry.dtype()) ||
+        entry.dtype() != vals[i]->dtype() || vals[i]->NumElements() == 0) {
+      if (entry.slices().empty()) {
+        TF_RETURN_IF_ERROR(GetValue(entry, vals[i]));
+      } else {
+        TF_RETURN_IF_ERROR(GetSliceValue(
+            keys[i], entry,
+            /* a full slice */ TensorSlice(TensorShape(entry.shape()).dims()),
+            vals[i]));
+      }
+      continue;
+    }
+    if (entry.size() != vals[i]->TotalBytes()) {
+      return errors::DataLoss("Invalid size in bundle entry: key ", keys[i],
+                              "; stored size ", entry.size(),
+                              "; expected size ", vals[i]->TotalBytes());
+    }
+    io::InputBuffer* buffered_file = nullptr;
+    TF_RETURN_IF_ERROR(GetDataFile(entry.shard_id(), &buffered_file));
+    total_bytes += entry.size();
+    reads.push_back({std::move(entry), vals[i], buffered_file->file()});
+  }
+  if (reads.empty()) return Status::OK();
+
+  std::vector<Status> statuses(reads.size());
+  auto read_range = [&reads, &statuses](int64 begin, int64 end) {
+    for (int64 i = begin; i < end; ++i) {
+      const FlatRead& read = reads[i];
+      uint32 actual_crc32c = 0;
+      statuses[i] = ReadFlatTensor(
+          read.file, read.entry,
+          const_cast<char*>(read.val->tensor_data().data()), &actual_crc32c);
+      if (statuses[i].ok()) {
+        statuses[i] = CheckCrc32c(read.entry, actual_crc32c);
+      }
+    }
+  };
+  if (pool == nullptr || reads.size() == 1) {
+    read_range(0, reads.size());
+  } else {
+    // Reading and checksumming take roughly a cycle per byte.
+    pool->ParallelFor(reads.size(),
+                      std::max<int64>(total_bytes / reads.size(), kBufferSize),
+                      read_range);
+  }
+  for (size_t i = 0; i < reads.size(); ++i) {
+    if (!statuses[i].ok()) {
+      errors::AppendToMessage(&statuses[i], "; while reading data file ",
+                              reads[i].entry.shard_id(), " of ", prefix_);
+      return statuses[i];
+    }
+  }
+  return Status::OK();
+}
+
 Status BundleReader::ReadCurrent(Tensor* val) {
   CHECK(val != nullptr);
   BundleEntryProto entry;
@@ -38,10 +38,12 @@ limitations under the License.
 //   BundleReader reader(env, "/fs/model/train/ckpt-step/ckpt");
 //   reader.Lookup("name", &tensor);
 //
-// A tensor bundle can be built using BundleWriter.  Each BundleWriter builds a
-// single data file bundle.  Multiple bundles can then be merged by
-// MergeBundles() without reading and writing large chunk of data: it reads the
-// metadata files and outputs a single merged metadata.  Typical usage:
+// A tensor bundle can be built using BundleWriter.  By default each
+// BundleWriter builds a single data file bundle (see
+// BundleWriter::Options::num_shards to write several data files in parallel).
+// Multiple bundles can then be merged by MergeBundles() without reading and
+// writing large chunk of data: it reads the metadata files and outputs a
+// single merged metadata.  Typical usage:
 //
 //   worker 0:
 //     BundleWriter writer(env, "/fs/model/train/ckpt-step/tmp/worker0-step");
@@ -66,11 +68,13 @@ limitations under the License.
 #include <map>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_slice.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/array_slice.h"
 #include "tensorflow/core/lib/io/inputbuffer.h"
 #include "tensorflow/core/lib/io/table.h"
@@ -112,6 +116,13 @@ class BundleWriter {
     // Alignment, in bytes, for tensor data.
     // Must be >= 1. The default size of 1 densely packs tensors.
     int data_alignment{1};
+    // Number of data files to spread the tensors over.  With more than one,
+    // Add() only records the tensors (without copying their buffers, so they
+    // must not be modified until Finish()), and Finish() writes the data
+    // files in parallel, on at most one thread per schedulable CPU.  Tensors
+    // are assigned largest first to the file with the fewest bytes so far.
+    // No more files are written than there are tensors.
+    int num_shards{1};
   };
   BundleWriter(Env* env, StringPiece prefix,
                const Options& options = Options());
@@ -146,6 +157,18 @@ class BundleWriter {
   Status status() const { return status_; }
 
  private:
+  // A tensor added to a writer with more than one data file, to be written
+  // by Finish().
+  struct PendingTensor {
+    string key;
+    BundleEntryProto* entry;  // Points into "entries_".
+    Tensor val;
+  };
+
+  // Writes "pending_" to options_.num_shards data files (or fewer), and
+  // stores the number of files written in "num_shards".
+  Status WriteShards(int* num_shards);
+
   Env* const env_;  // Not owned.
   const Options options_;
   const string prefix_;
@@ -154,6 +177,7 @@ class BundleWriter {
   std::unique_ptr<FileOutputBuffer> out_;
   int64 size_;  // Number of bytes written into out_.
   std::map<string, BundleEntryProto> entries_;
+  std::vector<PendingTensor> pending_;
   Status status_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(BundleWriter);
@@ -218,6 +242,19 @@ class BundleReader {
   // REQUIRES: status().ok()
   Status Lookup(StringPiece key, Tensor* val) TF_MUST_USE_RESULT;
 
+  // Looks up the tensors keyed by "keys" into "vals", as Lookup() does for
+  // each of them.  Whole tensors of dtypes that can be memcpy'd are read and
+  // checksummed concurrently on "pool" (serially if it is null), reading
+  // each straight into the buffer of its "vals" entry; the others are read
+  // one at a time.
+  //
+  // Stops at the first error, in which case any of "vals" may contain
+  // nonsense data.
+  // REQUIRES: status().ok() && keys.size() == vals.size()
+  Status LookupMany(gtl::ArraySlice<string> keys,
+                    gtl::ArraySlice<Tensor*> vals,
+                    thread::ThreadPool* pool) TF_MUST_USE_RESULT;
+
   // Looks up the tensor pointed to by the internal iterator.
   //
   // On error, "val" may contain nonsense data.
@@ -274,6 +311,11 @@ class BundleReader {
   Status GetValue(const BundleEntryProto& entry,
                   Tensor* val) TF_MUST_USE_RESULT;
 
+  // Returns in "buffered_file" the data file "shard_id", opening it if it has
+  // not been opened yet.
+  Status GetDataFile(int32 shard_id,
+                     io::InputBuffer** buffered_file) TF_MUST_USE_RESULT;
+
   // Reads the slice described by "slice_spec".  The corresponding full tensor
   // has key "ful_tensor_key" and metadata proto "full_tensor_entry".
   // REQUIRES: full_tensor_entry.slices_size() > 0
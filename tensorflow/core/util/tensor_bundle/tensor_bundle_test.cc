@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 
 #include <random>
+#include <set>
 #include <vector>
 
 #include "tensorflow/core/framework/tensor_testutil.h"
@@ -24,6 +25,7 @@ limitations under the License.
 #include "tensorflow/core/framework/variant_op_registry.h"
 #include "tensorflow/core/framework/versions.pb.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/lib/io/table_builder.h"
 #include "tensorflow/core/lib/strings/str_util.h"
@@ -583,6 +585,145 @@ TEST(TensorBundleTest, DirectoryStructure) {
                           "merged.data-00001-of-00002"});
 }
 
+TEST(TensorBundleTest, MultipleDataFiles) {
+  Env* env = Env::Default();
+  BundleWriter::Options opts;
+  opts.num_shards = 3;
+  {
+    BundleWriter writer(env, Prefix("multi"), opts);
+    TF_EXPECT_OK(writer.Add("big", Constant(1.f, TensorShape({1000}))));
+    TF_EXPECT_OK(writer.Add("medium", Constant(2.f, TensorShape({100}))));
+    TF_EXPECT_OK(writer.Add("small", Constant_2x3<int32>(3)));
+    TF_EXPECT_OK(writer.Add("strings", test::AsTensor<string>({"a", "bc"})));
+    TF_EXPECT_OK(writer.AddSlice("part", TensorShape({4, 3}),
+                                 TensorSlice::ParseOrDie("0,2:-"),
+                                 Constant_2x3<double>(4.)));
+    TF_EXPECT_OK(writer.AddSlice("part", TensorShape({4, 3}),
+                                 TensorSlice::ParseOrDie("2,2:-"),
+                                 Constant_2x3<double>(5.)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  for (int i = 0; i < 3; ++i) {
+    TF_EXPECT_OK(env->FileExists(DataFilename(Prefix("multi"), i, 3)));
+  }
+  {
+    BundleReader reader(env, Prefix("multi"));
+    TF_ASSERT_OK(reader.status());
+    // The largest tensors are spread over all files.
+    std::set<int> shard_ids;
+    for (const char* key : {"big", "medium", "strings"}) {
+      reader.Seek(key);
+      ASSERT_TRUE(reader.Valid());
+      BundleEntryProto entry;
+      ASSERT_TRUE(
+          entry.ParseFromArray(reader.value().data(), reader.value().size()));
+      shard_ids.insert(entry.shard_id());
+    }
+    EXPECT_EQ(3, shard_ids.size());
+
+    Expect<float>(&reader, "big", Constant(1.f, TensorShape({1000})));
+    Expect<float>(&reader, "medium", Constant(2.f, TensorShape({100})));
+    Expect<int32>(&reader, "small", Constant_2x3<int32>(3));
+    Expect<string>(&reader, "strings", test::AsTensor<string>({"a", "bc"}));
+    Tensor part(DT_DOUBLE, TensorShape({4, 3}));
+    TF_ASSERT_OK(reader.Lookup("part", &part));
+    test::ExpectTensorEqual<double>(
+        part, test::AsTensor<double>({4, 4, 4, 4, 4, 4, 5, 5, 5, 5, 5, 5},
+                                     TensorShape({4, 3})));
+  }
+
+  // Merging keeps every data file.
+  TF_ASSERT_OK(MergeBundles(env, {Prefix("multi")}, Prefix("multi_merged")));
+  BundleReader reader(env, Prefix("multi_merged"));
+  TF_ASSERT_OK(reader.status());
+  Expect<float>(&reader, "big", Constant(1.f, TensorShape({1000})));
+  Expect<float>(&reader, "medium", Constant(2.f, TensorShape({100})));
+  Expect<int32>(&reader, "small", Constant_2x3<int32>(3));
+}
+
+TEST(TensorBundleTest, MoreDataFilesThanTensors) {
+  Env* env = Env::Default();
+  BundleWriter::Options opts;
+  opts.num_shards = 4;
+  {
+    BundleWriter writer(env, Prefix("few"), opts);
+    TF_EXPECT_OK(writer.Add("foo", Constant_2x3(1.f)));
+    TF_EXPECT_OK(writer.Add("bar", Constant_2x3(2.f)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  TF_EXPECT_OK(env->FileExists(DataFilename(Prefix("few"), 0, 2)));
+  TF_EXPECT_OK(env->FileExists(DataFilename(Prefix("few"), 1, 2)));
+  EXPECT_FALSE(env->FileExists(DataFilename(Prefix("few"), 0, 4)).ok());
+  BundleReader reader(env, Prefix("few"));
+  TF_ASSERT_OK(reader.status());
+  Expect<float>(&reader, "foo", Constant_2x3(1.f));
+  Expect<float>(&reader, "bar", Constant_2x3(2.f));
+
+  // An empty bundle still has a data file.
+  {
+    BundleWriter writer(env, Prefix("none"), opts);
+    TF_ASSERT_OK(writer.Finish());
+  }
+  TF_EXPECT_OK(env->FileExists(DataFilename(Prefix("none"), 0, 1)));
+}
+
+TEST(TensorBundleTest, LookupMany) {
+  Env* env = Env::Default();
+  BundleWriter::Options opts;
+  opts.num_shards = 2;
+  {
+    BundleWriter writer(env, Prefix("many"), opts);
+    for (int i = 0; i < 10; ++i) {
+      TF_EXPECT_OK(writer.Add(strings::StrCat("t", i),
+                              Constant(i, TensorShape({100 * (i + 1)}))));
+    }
+    TF_EXPECT_OK(writer.Add("strings", test::AsTensor<string>({"a", "bc"})));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  thread::ThreadPool pool(env, "test", 4);
+  std::vector<string> keys;
+  std::vector<Tensor> vals;
+  for (int i = 0; i < 10; ++i) {
+    keys.push_back(strings::StrCat("t", i));
+    vals.emplace_back(DT_INT32, TensorShape({100 * (i + 1)}));
+  }
+  keys.push_back("strings");
+  vals.emplace_back(DT_STRING, TensorShape({2}));
+  std::vector<Tensor*> val_ptrs;
+  for (Tensor& val : vals) val_ptrs.push_back(&val);
+  {
+    BundleReader reader(env, Prefix("many"));
+    TF_ASSERT_OK(reader.status());
+    TF_ASSERT_OK(reader.LookupMany(keys, val_ptrs, &pool));
+    for (int i = 0; i < 10; ++i) {
+      test::ExpectTensorEqual<int32>(vals[i],
+                                     Constant(i, TensorShape({100 * (i + 1)})));
+    }
+    test::ExpectTensorEqual<string>(vals[10],
+                                    test::AsTensor<string>({"a", "bc"}));
+  }
+  {  // Not found.
+    BundleReader reader(env, Prefix("many"));
+    TF_ASSERT_OK(reader.status());
+    Tensor val(DT_INT32, TensorShape({100}));
+    EXPECT_TRUE(errors::IsNotFound(
+        reader.LookupMany({"t0", "nonexist"}, {vals.data(), &val}, &pool)));
+  }
+  {  // Corrupted data.
+    const string datafile = DataFilename(Prefix("many"), 1, 2);
+    string data;
+    TF_ASSERT_OK(ReadFileToString(env, datafile, &data));
+    data[data.size() / 2] = ~data[data.size() / 2];
+    TF_ASSERT_OK(WriteStringToFile(env, datafile, data));
+    BundleReader reader(env, Prefix("many"));
+    TF_ASSERT_OK(reader.status());
+    Status status = reader.LookupMany(keys, val_ptrs, &pool);
+    EXPECT_TRUE(errors::IsDataLoss(status));
+    EXPECT_TRUE(
+        str_util::StrContains(status.ToString(), "Checksum does not match"));
+  }
+}
+
 TEST(TensorBundleTest, Error) {
   {  // Dup keys.
     BundleWriter writer(Env::Default(), Prefix("dup"));
@@ -859,4 +1000,97 @@ BM_BundleAlignment(4096, 512);
 BM_BundleAlignment(4096, 4096);
 BM_BundleAlignment(4096, 1048576);
 
+// Saves "num_tensors" float tensors of "tensor_bytes" each into
+// "num_shards" data files.
+static void BM_BundleWrite(int iters, int num_shards, int num_tensors,
+                           int tensor_bytes) {
+  testing::StopTiming();
+  std::vector<Tensor> tensors;
+  for (int i = 0; i < num_tensors; ++i) {
+    tensors.push_back(Constant(i * 1.f, TensorShape({tensor_bytes / 4})));
+  }
+  BundleWriter::Options opts;
+  opts.num_shards = num_shards;
+  testing::BytesProcessed(static_cast<int64>(iters) * num_tensors *
+                          tensor_bytes);
+  testing::UseRealTime();
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    BundleWriter writer(Env::Default(), Prefix("bm_write"), opts);
+    for (int j = 0; j < num_tensors; ++j) {
+      TF_CHECK_OK(writer.Add(strings::StrCat("t", j), tensors[j]));
+    }
+    TF_CHECK_OK(writer.Finish());
+  }
+  testing::StopTiming();
+}
+
+// Restores the tensors written as in BM_BundleWrite, with "num_threads"
+// threads (one at a time with Lookup() if 0).
+static void BM_BundleRead(int iters, int num_shards, int num_threads,
+                          int num_tensors, int tensor_bytes) {
+  testing::StopTiming();
+  const string prefix = Prefix(strings::StrCat("bm_read_", num_shards));
+  {
+    BundleWriter::Options opts;
+    opts.num_shards = num_shards;
+    BundleWriter writer(Env::Default(), prefix, opts);
+    for (int j = 0; j < num_tensors; ++j) {
+      TF_CHECK_OK(writer.Add(
+          strings::StrCat("t", j),
+          Constant(j * 1.f, TensorShape({tensor_bytes / 4}))));
+    }
+    TF_CHECK_OK(writer.Finish());
+  }
+  std::unique_ptr<thread::ThreadPool> pool;
+  if (num_threads > 0) {
+    pool.reset(new thread::ThreadPool(Env::Default(), "bm_read", num_threads));
+  }
+  std::vector<string> keys;
+  std::vector<Tensor> vals;
+  std::vector<Tensor*> val_ptrs;
+  for (int j = 0; j < num_tensors; ++j) {
+    keys.push_back(strings::StrCat("t", j));
+    vals.emplace_back(DT_FLOAT, TensorShape({tensor_bytes / 4}));
+  }
+  for (Tensor& val : vals) val_ptrs.push_back(&val);
+  testing::BytesProcessed(static_cast<int64>(iters) * num_tensors *
+                          tensor_bytes);
+  testing::UseRealTime();
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    BundleReader reader(Env::Default(), prefix);
+    TF_CHECK_OK(reader.status());
+    if (pool == nullptr) {
+      for (int j = 0; j < num_tensors; ++j) {
+        TF_CHECK_OK(reader.Lookup(keys[j], val_ptrs[j]));
+      }
+    } else {
+      TF_CHECK_OK(reader.LookupMany(keys, val_ptrs, pool.get()));
+    }
+  }
+  testing::StopTiming();
+}
+
+#define BM_BundleWriteShards(SHARDS)               \
+  static void BM_BundleWrite_##SHARDS(int iters) { \
+    BM_BundleWrite(iters, SHARDS, 32, 4 << 20);    \
+  }                                                \
+  BENCHMARK(BM_BundleWrite_##SHARDS)
+
+BM_BundleWriteShards(1);
+BM_BundleWriteShards(4);
+BM_BundleWriteShards(16);
+
+#define BM_BundleReadShards(SHARDS, THREADS)                  \
+  static void BM_BundleRead_##SHARDS##_##THREADS(int iters) { \
+    BM_BundleRead(iters, SHARDS, THREADS, 32, 4 << 20);       \
+  }                                                           \
+  BENCHMARK(BM_BundleRead_##SHARDS##_##THREADS)
+
+BM_BundleReadShards(1, 0);
+BM_BundleReadShards(1, 4);
+BM_BundleReadShards(4, 4);
+BM_BundleReadShards(16, 16);
+
 }  // namespace tensorflow
@@ -31,6 +31,7 @@ from tensorflow.python.framework import errors
 from tensorflow.python.framework import ops
 from tensorflow.python.ops import array_ops
 from tensorflow.python.ops import variables
+from tensorflow.python.platform import gfile
 from tensorflow.python.platform import test
 
 
@@ -200,6 +201,88 @@ class FilesystemCacheDatasetTest(test.TestCase):
       self.assertAllEqual(elements, elements_itr2)
 
 
+class ShardedFilesystemCacheDatasetTest(test.TestCase):
+
+  def setUp(self):
+    self.tmp_dir = tempfile.mkdtemp()
+    self.cache_prefix = path.join(self.tmp_dir, "cache")
+
+  def tearDown(self):
+    if self.tmp_dir:
+      shutil.rmtree(self.tmp_dir, ignore_errors=True)
+
+  def _testCacheDatasetPassthrough(self, compression_type):
+    components = (np.arange(10), np.array([b"a", b"bb"] * 5))
+    count_placeholder = array_ops.placeholder_with_default(
+        constant_op.constant(1, dtypes.int64), shape=[])
+    cache_dataset = (dataset_ops.Dataset.from_tensor_slices(components)
+                     .repeat(count_placeholder)
+                     .cache(self.cache_prefix, num_shards=3,
+                            compression_type=compression_type))
+    iterator = cache_dataset.make_initializable_iterator()
+    get_next = iterator.get_next()
+
+    with self.test_session() as sess:
+      sess.run(iterator.initializer)
+      cached_elements = []
+      for _ in range(10):
+        cached_elements.append(sess.run(get_next))
+      with self.assertRaises(errors.OutOfRangeError):
+        sess.run(get_next)
+      self.assertEqual(list(zip(*components)), cached_elements)
+      self.assertEqual(3, len(gfile.Glob(self.cache_prefix + "_0.shard-*")))
+
+      # Re-initialize with an empty upstream (to throw errors.OutOfRangeError
+      # if we didn't use the cache).
+      sess.run(iterator.initializer, feed_dict={count_placeholder: 0})
+      replayed_elements = []
+      for _ in range(10):
+        replayed_elements.append(sess.run(get_next))
+      with self.assertRaises(errors.OutOfRangeError):
+        sess.run(get_next)
+      self.assertEqual(cached_elements, replayed_elements)
+
+  def testCacheDatasetPassthrough(self):
+    self._testCacheDatasetPassthrough(None)
+
+  def testCacheDatasetPassthroughCompressed(self):
+    self._testCacheDatasetPassthrough("ZLIB")
+
+  def testConcurrentWriters(self):
+    dataset = dataset_ops.Dataset.range(10)
+    iterator1 = dataset.cache(
+        self.cache_prefix, num_shards=2).make_initializable_iterator()
+    iterator2 = dataset.cache(
+        self.cache_prefix, num_shards=2).make_initializable_iterator()
+    get_next1 = iterator1.get_next()
+    get_next2 = iterator2.get_next()
+
+    with self.test_session() as sess:
+      sess.run(iterator1.initializer)
+      sess.run(get_next1)  # this should succeed
+
+      sess.run(iterator2.initializer)
+      with self.assertRaises(errors.AlreadyExistsError):
+        sess.run(get_next2)
+
+      sess.run(get_next1)  # this should continue to succeed
+
+  def testInvalidCompressionType(self):
+    dataset = dataset_ops.Dataset.range(10).cache(
+        self.cache_prefix, num_shards=2, compression_type="LZ4")
+    iterator = dataset.make_initializable_iterator()
+    with self.test_session() as sess:
+      with self.assertRaises(errors.InvalidArgumentError):
+        sess.run(iterator.initializer)
+
+  def testCompressionTypeRequiresShards(self):
+    dataset = dataset_ops.Dataset.range(10).cache(
+        self.cache_prefix, compression_type="ZLIB")
+    iterator = dataset.make_initializable_iterator()
+    with self.test_session() as sess:
+      with self.assertRaises(errors.InvalidArgumentError):
+        sess.run(iterator.initializer)
+
 class MemoryCacheDatasetTest(test.TestCase):
 
   def testCacheDatasetPassthrough(self):
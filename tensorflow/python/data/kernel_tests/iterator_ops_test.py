@@ -768,6 +768,37 @@ class IteratorTest(test.TestCase):
         with self.assertRaises(errors.InvalidArgumentError):
           sess.run(restore_op)
 
+  def testTracedGetNextProfilesPipeline(self):
+    dataset = dataset_ops.Dataset.range(100).map(lambda x: x * 2).batch(10)
+    next_element = dataset.make_one_shot_iterator().get_next()
+
+    with self.test_session() as sess:
+      # Untraced steps do not add the pipeline to the step stats.
+      run_metadata = config_pb2.RunMetadata()
+      sess.run(next_element, run_metadata=run_metadata)
+      self.assertFalse(run_metadata.step_stats.dev_stats)
+
+      for _ in range(2):
+        run_metadata = config_pb2.RunMetadata()
+        sess.run(
+            next_element,
+            options=config_pb2.RunOptions(
+                trace_level=config_pb2.RunOptions.FULL_TRACE),
+            run_metadata=run_metadata)
+        stages = {}
+        for dev_stats in run_metadata.step_stats.dev_stats:
+          if dev_stats.device.endswith("/tf_data"):
+            for node_stats in dev_stats.node_stats:
+              stages[node_stats.node_name] = node_stats.timeline_label
+        self.assertItemsEqual(
+            ["Iterator::Batch", "Iterator::Batch::Map",
+             "Iterator::Batch::Map::Range"], stages.keys())
+        self.assertIn("Iterator::Batch = Batch(elements: 1,",
+                      stages["Iterator::Batch"])
+        self.assertIn("bytes_produced: 80", stages["Iterator::Batch"])
+        self.assertIn("Iterator::Batch::Map = Map(elements: 10,",
+                      stages["Iterator::Batch::Map"])
+
   def testRepeatedGetNextWarning(self):
     iterator = dataset_ops.Dataset.range(10).make_one_shot_iterator()
     warnings.simplefilter("always")
@@ -170,6 +170,25 @@ class TextLineDatasetTest(test.TestCase):
       with self.assertRaises(errors.OutOfRangeError):
         sess.run(iterator.get_next())
 
+  def testTextLineDatasetReadahead(self):
+    for compression_type in [None, "GZIP"]:
+      test_filenames = self._createFiles(
+          2, 5, crlf=True, compression_type=compression_type)
+      dataset = readers.TextLineDataset(
+          test_filenames,
+          compression_type=compression_type,
+          buffer_size=10,
+          num_readahead_blocks=4)
+      iterator = dataset.make_one_shot_iterator()
+      next_element = iterator.get_next()
+
+      with self.test_session() as sess:
+        for j in range(2):
+          for i in range(5):
+            self.assertEqual(self._lineText(j, i), sess.run(next_element))
+        with self.assertRaises(errors.OutOfRangeError):
+          sess.run(next_element)
+
   def testIteratorResourceCleanup(self):
     filename = os.path.join(self.get_temp_dir(), "text.txt")
     with open(filename, "wt") as f:
@@ -309,6 +328,24 @@ class FixedLengthRecordReaderTest(test.TestCase):
       with self.assertRaises(errors.OutOfRangeError):
         sess.run(iterator.get_next())
 
+  def testFixedLengthRecordDatasetReadahead(self):
+    test_filenames = self._createFiles()
+    dataset = readers.FixedLengthRecordDataset(
+        test_filenames,
+        self._record_bytes,
+        self._header_bytes,
+        self._footer_bytes,
+        buffer_size=10,
+        num_readahead_blocks=2)
+    iterator = dataset.make_one_shot_iterator()
+
+    with self.test_session() as sess:
+      for j in range(self._num_files):
+        for i in range(self._num_records):
+          self.assertEqual(self._record(j, i), sess.run(iterator.get_next()))
+      with self.assertRaises(errors.OutOfRangeError):
+        sess.run(iterator.get_next())
+
   def testFixedLengthRecordDatasetWrongSize(self):
     test_filenames = self._createFiles()
     dataset = readers.FixedLengthRecordDataset(
@@ -781,6 +818,50 @@ class TFRecordDatasetTest(test.TestCase):
       with self.assertRaises(errors.OutOfRangeError):
         sess.run(next_element)
 
+  def testReadWithReadahead(self):
+    d = readers.TFRecordDataset(
+        self.test_filenames, buffer_size=16, num_readahead_blocks=4)
+    iterator = d.make_one_shot_iterator()
+    next_element = iterator.get_next()
+    with self.test_session() as sess:
+      for j in range(self._num_files):
+        for i in range(self._num_records):
+          self.assertAllEqual(self._record(j, i), sess.run(next_element))
+      with self.assertRaises(errors.OutOfRangeError):
+        sess.run(next_element)
+
+  def testReadWithMmap(self):
+    d = readers.TFRecordDataset(self.test_filenames, use_mmap=True)
+    iterator = d.make_one_shot_iterator()
+    next_element = iterator.get_next()
+    with self.test_session() as sess:
+      for j in range(self._num_files):
+        for i in range(self._num_records):
+          self.assertAllEqual(self._record(j, i), sess.run(next_element))
+      with self.assertRaises(errors.OutOfRangeError):
+        sess.run(next_element)
+
+  def testReadCorruptedFileWithMmap(self):
+    with open(self.test_filenames[0], "r+b") as f:
+      # Corrupts the data of the first record, after its 12 byte header.
+      f.seek(12)
+      f.write(b"X")
+    d = readers.TFRecordDataset(self.test_filenames, use_mmap=True)
+    iterator = d.make_one_shot_iterator()
+    next_element = iterator.get_next()
+    with self.test_session() as sess:
+      with self.assertRaises(errors.DataLossError):
+        sess.run(next_element)
+
+  def testMmapRequiresUncompressedFiles(self):
+    d = readers.TFRecordDataset(
+        self.test_filenames, compression_type="GZIP", use_mmap=True)
+    iterator = d.make_one_shot_iterator()
+    next_element = iterator.get_next()
+    with self.test_session() as sess:
+      with self.assertRaises(errors.InvalidArgumentError):
+        sess.run(next_element)
+
   def testReadFromDatasetOfFiles(self):
     files = dataset_ops.Dataset.from_tensor_slices(self.test_filenames)
     d = readers.TFRecordDataset(files)
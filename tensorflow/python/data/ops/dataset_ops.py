@@ -608,6 +608,8 @@ class Dataset(object):
     Args:
       buffer_size: A `tf.int64` scalar `tf.Tensor`, representing the
         maximum number of elements that will be buffered when prefetching.
+        If the value `tf.contrib.data.AUTOTUNE` is used, then the buffer size
+        is tuned dynamically.
 
     Returns:
       Dataset: A `Dataset`.
@@ -697,18 +699,25 @@ class Dataset(object):
     """
     return ShuffleDataset(self, buffer_size, seed, reshuffle_each_iteration)
 
-  def cache(self, filename=""):
+  def cache(self, filename="", num_shards=0, compression_type=None):
     """Caches the elements in this dataset.
 
     Args:
       filename: A `tf.string` scalar `tf.Tensor`, representing the name of a
         directory on the filesystem to use for caching tensors in this Dataset.
         If a filename is not provided, the dataset will be cached in memory.
+      num_shards: (Optional.) If greater than 0, the cache is written as
+        `num_shards` files in parallel, which can later be read separately
+        with `tf.contrib.data.read_cache_shards`. Defaults to 0, which writes
+        the cache as a single tensor bundle.
+      compression_type: (Optional.) One of `"ZLIB"` or `"GZIP"`, to compress
+        the files of a cache with `num_shards` greater than 0. Defaults to no
+        compression. Not supported when `num_shards` is 0.
 
     Returns:
       Dataset: A `Dataset`.
     """
-    return CacheDataset(self, filename)
+    return CacheDataset(self, filename, num_shards, compression_type)
 
   def take(self, count):
     """Creates a `Dataset` with at most `count` elements from this dataset.
@@ -977,7 +986,9 @@ class Dataset(object):
        `self.output_types`) to another nested structure of tensors.
       num_parallel_calls: (Optional.) A `tf.int32` scalar `tf.Tensor`,
         representing the number elements to process in parallel. If not
-        specified, elements will be processed sequentially.
+        specified, elements will be processed sequentially. If the value
+        `tf.contrib.data.AUTOTUNE` is used, then the number of parallel calls
+        is set dynamically based on available CPU.
 
     Returns:
       Dataset: A `Dataset`.
@@ -1784,17 +1795,22 @@ class RangeDataset(Dataset):
 class CacheDataset(Dataset):
   """A `Dataset` that caches elements of its input."""
 
-  def __init__(self, input_dataset, filename):
+  def __init__(self, input_dataset, filename, num_shards=0,
+               compression_type=None):
     """See `Dataset.cache()` for details."""
     super(CacheDataset, self).__init__()
     self._input_dataset = input_dataset
     self._filename = ops.convert_to_tensor(
         filename, dtype=dtypes.string, name="filename")
+    self._num_shards = num_shards
+    self._compression_type = compression_type or ""
 
   def _as_variant_tensor(self):
     return gen_dataset_ops.cache_dataset(
         self._input_dataset._as_variant_tensor(),  # pylint: disable=protected-access
         filename=self._filename,
+        num_shards=self._num_shards,
+        compression_type=self._compression_type,
         **flat_structure(self))
 
   @property
@@ -35,7 +35,8 @@ _DEFAULT_READER_BUFFER_SIZE_BYTES = 256 * 1024  # 256 KB
 class TextLineDataset(dataset_ops.Dataset):
   """A `Dataset` comprising lines from one or more text files."""
 
-  def __init__(self, filenames, compression_type=None, buffer_size=None):
+  def __init__(self, filenames, compression_type=None, buffer_size=None,
+               num_readahead_blocks=0):
     """Creates a `TextLineDataset`.
 
     Args:
@@ -45,6 +46,10 @@ class TextLineDataset(dataset_ops.Dataset):
       buffer_size: (Optional.) A `tf.int64` scalar denoting the number of bytes
         to buffer. A value of 0 results in the default buffering values chosen
         based on the compression type.
+      num_readahead_blocks: (Optional.) A Python integer. The number of blocks
+        of `buffer_size` bytes to read ahead of the reader on a background I/O
+        thread pool, which hides the latency of remote filesystems. Defaults
+        to reading on the calling thread.
     """
     super(TextLineDataset, self).__init__()
     self._filenames = ops.convert_to_tensor(
@@ -56,10 +61,12 @@ class TextLineDataset(dataset_ops.Dataset):
         argument_dtype=dtypes.string)
     self._buffer_size = convert.optional_param_to_tensor(
         "buffer_size", buffer_size, _DEFAULT_READER_BUFFER_SIZE_BYTES)
+    self._num_readahead_blocks = num_readahead_blocks
 
   def _as_variant_tensor(self):
     return gen_dataset_ops.text_line_dataset(
-        self._filenames, self._compression_type, self._buffer_size)
+        self._filenames, self._compression_type, self._buffer_size,
+        num_readahead_blocks=self._num_readahead_blocks)
 
   @property
   def output_classes(self):
@@ -77,7 +84,8 @@ class TextLineDataset(dataset_ops.Dataset):
 class _TFRecordDataset(dataset_ops.Dataset):
   """A `Dataset` comprising records from one or more TFRecord files."""
 
-  def __init__(self, filenames, compression_type=None, buffer_size=None):
+  def __init__(self, filenames, compression_type=None, buffer_size=None,
+               use_mmap=False, num_readahead_blocks=0):
     """Creates a `TFRecordDataset`.
 
     Args:
@@ -86,6 +94,10 @@ class _TFRecordDataset(dataset_ops.Dataset):
         `""` (no compression), `"ZLIB"`, or `"GZIP"`.
       buffer_size: (Optional.) A `tf.int64` scalar representing the number of
         bytes in the read buffer. 0 means no buffering.
+      use_mmap: (Optional.) A Python `bool`. Whether to memory-map
+        uncompressed files.
+      num_readahead_blocks: (Optional.) A Python integer. The number of blocks
+        of `buffer_size` bytes to read ahead of the reader.
     """
     super(_TFRecordDataset, self).__init__()
     # Force the type to string even if filenames is an empty list.
@@ -100,10 +112,14 @@ class _TFRecordDataset(dataset_ops.Dataset):
         "buffer_size",
         buffer_size,
         argument_default=_DEFAULT_READER_BUFFER_SIZE_BYTES)
+    self._use_mmap = use_mmap
+    self._num_readahead_blocks = num_readahead_blocks
 
   def _as_variant_tensor(self):
     return gen_dataset_ops.tf_record_dataset(
-        self._filenames, self._compression_type, self._buffer_size)
+        self._filenames, self._compression_type, self._buffer_size,
+        use_mmap=self._use_mmap,
+        num_readahead_blocks=self._num_readahead_blocks)
 
   @property
   def output_classes(self):
@@ -208,11 +224,13 @@ class TFRecordDataset(dataset_ops.Dataset):
   """A `Dataset` comprising records from one or more TFRecord files."""
 
   def __init__(self, filenames, compression_type=None, buffer_size=None,
-               num_parallel_reads=None):
+               num_parallel_reads=None, use_mmap=False, num_readahead_blocks=0):
     """Creates a `TFRecordDataset` to read for one or more TFRecord files.
 
     NOTE: The `num_parallel_reads` argument can be used to improve performance
-    when reading from a remote filesystem.
+    when reading from a remote filesystem. The `use_mmap` argument can be used
+    to improve performance when reading uncompressed files from a local
+    filesystem.
 
     Args:
       filenames: A `tf.string` tensor or `tf.data.Dataset` containing one or
@@ -224,6 +242,14 @@ class TFRecordDataset(dataset_ops.Dataset):
       num_parallel_reads: (Optional.) A `tf.int64` scalar representing the
         number of files to read in parallel. Defaults to reading files
         sequentially.
+      use_mmap: (Optional.) A Python `bool`. If `True`, uncompressed files are
+        memory-mapped instead of read through a buffer, and the checksums of
+        each file are verified in parallel when it is opened. Files on
+        filesystems that do not support memory-mapping are read as usual.
+      num_readahead_blocks: (Optional.) A Python integer. The number of blocks
+        of `buffer_size` bytes to read ahead of the reader on a background I/O
+        thread pool, which hides the latency of remote filesystems. Defaults
+        to reading on the calling thread.
 
     Raises:
       TypeError: If any argument does not have the expected type.
@@ -247,9 +273,12 @@ class TFRecordDataset(dataset_ops.Dataset):
     self._compression_type = compression_type
     self._buffer_size = buffer_size
     self._num_parallel_reads = num_parallel_reads
+    self._use_mmap = use_mmap
+    self._num_readahead_blocks = num_readahead_blocks
 
     def read_one_file(filename):
-      return _TFRecordDataset(filename, compression_type, buffer_size)
+      return _TFRecordDataset(filename, compression_type, buffer_size,
+                              use_mmap, num_readahead_blocks)
 
     if num_parallel_reads is None:
       self._impl = filenames.flat_map(read_one_file)
@@ -263,11 +292,15 @@ class TFRecordDataset(dataset_ops.Dataset):
              filenames=None,
              compression_type=None,
              buffer_size=None,
-             num_parallel_reads=None):
+             num_parallel_reads=None,
+             use_mmap=None,
+             num_readahead_blocks=None):
     return TFRecordDataset(filenames or self._filenames,
                            compression_type or self._compression_type,
                            buffer_size or self._buffer_size,
-                           num_parallel_reads or self._num_parallel_reads)
+                           num_parallel_reads or self._num_parallel_reads,
+                           use_mmap or self._use_mmap,
+                           num_readahead_blocks or self._num_readahead_blocks)
 
   def _as_variant_tensor(self):
     return self._impl._as_variant_tensor()  # pylint: disable=protected-access
@@ -294,7 +327,8 @@ class FixedLengthRecordDataset(dataset_ops.Dataset):
                record_bytes,
                header_bytes=None,
                footer_bytes=None,
-               buffer_size=None):
+               buffer_size=None,
+               num_readahead_blocks=0):
     """Creates a `FixedLengthRecordDataset`.
 
     Args:
@@ -307,6 +341,10 @@ class FixedLengthRecordDataset(dataset_ops.Dataset):
         bytes to ignore at the end of a file.
       buffer_size: (Optional.) A `tf.int64` scalar representing the number of
         bytes to buffer when reading.
+      num_readahead_blocks: (Optional.) A Python integer. The number of blocks
+        of `buffer_size` bytes to read ahead of the reader on a background I/O
+        thread pool, which hides the latency of remote filesystems. Defaults
+        to reading on the calling thread.
     """
     super(FixedLengthRecordDataset, self).__init__()
     self._filenames = ops.convert_to_tensor(
@@ -320,11 +358,13 @@ class FixedLengthRecordDataset(dataset_ops.Dataset):
         "footer_bytes", footer_bytes)
     self._buffer_size = convert.optional_param_to_tensor(
         "buffer_size", buffer_size, _DEFAULT_READER_BUFFER_SIZE_BYTES)
+    self._num_readahead_blocks = num_readahead_blocks
 
   def _as_variant_tensor(self):
     return gen_dataset_ops.fixed_length_record_dataset(
         self._filenames, self._header_bytes, self._record_bytes,
-        self._footer_bytes, self._buffer_size)
+        self._footer_bytes, self._buffer_size,
+        num_readahead_blocks=self._num_readahead_blocks)
 
   @property
   def output_classes(self):
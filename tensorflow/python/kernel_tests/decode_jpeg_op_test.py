@@ -186,6 +186,75 @@ class DecodeJpegBenchmark(test.Benchmark):
           iters=num_iters,
           wall_time=duration_decode_after_crop)
 
+  def _evalDecodeAndResizeJpeg(self, image_name, batch_size, num_iters,
+                               fused, tile=None):
+    """Evaluate decoding and resizing a batch of images to 224x224.
+
+    Args:
+      image_name: a string of image file name (without suffix).
+      batch_size: the number of images decoded per step.
+      num_iters: number of iterations for evaluation.
+      fused: If true, use DecodeAndResizeJpegBatch instead of a DecodeJpeg
+          and a ResizeBilinear op per image.
+      tile: if not None, tile the image to composite a larger fake image.
+
+    Returns:
+      The duration of the run in seconds.
+    """
+    ops.reset_default_graph()
+
+    image_file_path = os.path.join(prefix_path, image_name)
+    single_image = image_ops.decode_jpeg(
+        io_ops.read_file(image_file_path), channels=3, name='single_image')
+    if tile is not None:
+      single_image = array_ops.tile(single_image, tile)
+    image_content = variable_scope.get_variable(
+        'batch_image_%s' % image_name,
+        initializer=image_ops.encode_jpeg(single_image))
+
+    with session.Session() as sess:
+      sess.run(variables.global_variables_initializer())
+      size = [224, 224]
+      if fused:
+        r = image_ops.decode_and_resize_jpeg_batch(
+            array_ops.fill([batch_size], image_content), size)
+      else:
+        images = []
+        for _ in xrange(batch_size):
+          image = image_ops.decode_jpeg(image_content, channels=3)
+          images.append(
+              image_ops.resize_bilinear(array_ops.expand_dims(image, 0), size))
+        r = array_ops.concat(images, 0)
+      r = control_flow_ops.group(r)
+
+      for _ in xrange(3):
+        # Skip warm up time.
+        sess.run(r)
+
+      start_time = time.time()
+      for _ in xrange(num_iters):
+        sess.run(r)
+    return time.time() - start_time
+
+  def benchmarkDecodeAndResizeJpegBatch(self):
+    """Evaluate batched DecodeAndResizeJpegBatch against decode + resize."""
+    num_iters = 10
+    batch_size = 64
+    # 500x375 and, tiled, an ImageNet-sized 2000x1500 image.
+    for label, tile in [('medium', None), ('large', [4, 4, 1])]:
+      duration_separate = self._evalDecodeAndResizeJpeg(
+          'medium.jpg', batch_size, num_iters, False, tile)
+      duration_fused = self._evalDecodeAndResizeJpeg(
+          'medium.jpg', batch_size, num_iters, True, tile)
+      self.report_benchmark(
+          name='decode_resize_jpeg_%s_b%d' % (label, batch_size),
+          iters=num_iters,
+          wall_time=duration_separate)
+      self.report_benchmark(
+          name='decode_and_resize_jpeg_batch_%s_b%d' % (label, batch_size),
+          iters=num_iters,
+          wall_time=duration_fused)
+
 
 if __name__ == '__main__':
   test.main()
@@ -3111,6 +3111,43 @@ class JpegTest(test_util.TensorFlowTestCase):
             lambda e: "Invalid JPEG data or crop window" in str(e)):
           sess.run(result)
 
+  def testDecodeAndResizeJpegBatch(self):
+    with self.test_session() as sess:
+      base = "tensorflow/core/lib/jpeg/testdata"
+      # 128x256 and 240x180 (width x height).
+      jpegs = [
+          io_ops.read_file(os.path.join(base, name))
+          for name in ["jpeg_merge_test1.jpg", "small.jpg"]
+      ]
+      # Both images are decoded at a quarter of their size for the small
+      # output, and at full size for the large one.
+      for size, ratio in [([40, 30], 4), ([300, 200], 1)]:
+        for channels in [1, 3]:
+          expected = array_ops.concat([
+              image_ops.resize_bilinear(
+                  array_ops.expand_dims(
+                      image_ops.decode_jpeg(
+                          jpeg, channels=channels, ratio=ratio), 0), size)
+              for jpeg in jpegs
+          ], 0)
+          batch = image_ops.decode_and_resize_jpeg_batch(
+              array_ops.stack(jpegs), size, channels=channels)
+          self.assertAllEqual([2] + size + [channels],
+                              batch.get_shape().as_list())
+          expected, batch = sess.run([expected, batch])
+          self.assertAllClose(expected, batch)
+
+  def testDecodeAndResizeJpegBatchWithInvalidImage(self):
+    with self.test_session() as sess:
+      base = "tensorflow/core/lib/jpeg/testdata"
+      jpeg = io_ops.read_file(os.path.join(base, "jpeg_merge_test1.jpg"))
+      contents = array_ops.stack([jpeg, constant_op.constant("not a jpeg")])
+      result = image_ops.decode_and_resize_jpeg_batch(contents, [32, 32])
+      with self.assertRaisesWithPredicateMatch(
+          errors.InvalidArgumentError,
+          lambda e: "Image 1 of the batch" in str(e)):
+        sess.run(result)
+
   def testSynthetic(self):
     with self.test_session(use_gpu=True) as sess:
       # Encode it, then decode it, then encode it